@@ -0,0 +1,499 @@
+#include "TestDgmOctree.h"
+
+//CCLib
+#include <DgmOctree.h>
+#include <PointCloud.h>
+#include <ReferenceCloud.h>
+
+//Qt
+#include <QAtomicInt>
+#include <QtConcurrentRun>
+
+//system
+#include <algorithm>
+#include <random>
+#include <vector>
+
+using namespace CCLib;
+
+//! Point cloud with per-point normals
+class CloudWithNormals : public PointCloud
+{
+public:
+	std::vector<CCVector3> normals;
+
+	bool normalsAvailable() const override { return !normals.empty(); }
+	const CCVector3* getNormal(PointIndexType index) const override { return &normals[index]; }
+};
+
+//! Creates a random cloud (with a fixed seed)
+static void FillRandomCloud(PointCloud& cloud, unsigned count, unsigned seed)
+{
+	std::mt19937 gen(seed);
+	std::uniform_real_distribution<PointCoordinateType> dist(0, 100);
+
+	QVERIFY(cloud.reserve(count));
+	for (unsigned i = 0; i < count; ++i)
+	{
+		cloud.addPoint(CCVector3(dist(gen), dist(gen), dist(gen)));
+	}
+}
+
+//! Creates random query points (some of them lying outside of the clouds created with FillRandomCloud)
+static std::vector<CCVector3> RandomQueries(unsigned count, unsigned seed)
+{
+	std::mt19937 gen(seed);
+	std::uniform_real_distribution<PointCoordinateType> dist(-10, 110);
+
+	std::vector<CCVector3> queries(count);
+	for (CCVector3& Q : queries)
+	{
+		Q = CCVector3(dist(gen), dist(gen), dist(gen));
+	}
+	return queries;
+}
+
+//! Returns the sorted square distances between a query point and all the points of a cloud
+static std::vector<double> SortedSquareDistances(const PointCloud& cloud, const CCVector3& Q)
+{
+	std::vector<double> squareDistances(cloud.size());
+	for (unsigned i = 0; i < cloud.size(); ++i)
+	{
+		squareDistances[i] = (*cloud.getPoint(i) - Q).norm2d();
+	}
+	std::sort(squareDistances.begin(), squareDistances.end());
+	return squareDistances;
+}
+
+//! Cell function: flags all the points of the cell and counts the cells
+/** Parameters:
+	- (std::vector<int>*) per-point visit counter
+	- (QAtomicInt*) number of visited cells
+**/
+static bool CountPointsInCell(const DgmOctree::octreeCell& cell, void** additionalParameters, NormalizedProgress*)
+{
+	std::vector<int>& visits = *static_cast<std::vector<int>*>(additionalParameters[0]);
+	QAtomicInt& cellCount = *static_cast<QAtomicInt*>(additionalParameters[1]);
+
+	//the points of two different cells are disjoint: no need to synchronize
+	for (unsigned i = 0; i < cell.points->size(); ++i)
+	{
+		++visits[cell.points->getPointGlobalIndex(i)];
+	}
+	cellCount.fetchAndAddRelaxed(1);
+
+	return true;
+}
+
+//! Cell function that always fails
+static bool FailOnCell(const DgmOctree::octreeCell&, void** additionalParameters, NormalizedProgress*)
+{
+	QAtomicInt& cellCount = *static_cast<QAtomicInt*>(additionalParameters[0]);
+	cellCount.fetchAndAddRelaxed(1);
+
+	return false;
+}
+
+//! Cell function: checks that copies of the cell points are consistent
+/** Parameters:
+	- (QAtomicInt*) number of inconsistent cells
+**/
+static bool CopyCellPoints(const DgmOctree::octreeCell& cell, void** additionalParameters, NormalizedProgress*)
+{
+	QAtomicInt& errorCount = *static_cast<QAtomicInt*>(additionalParameters[0]);
+
+	ReferenceCloud copy(*cell.points);
+	ReferenceCloud merged(cell.points->getAssociatedCloud());
+	if (	!merged.add(*cell.points)
+		||	copy.size() != cell.points->size()
+		||	merged.size() != cell.points->size()
+		||	cell.points->normalsAvailable() != cell.points->getAssociatedCloud()->normalsAvailable())
+	{
+		errorCount.fetchAndAddRelaxed(1);
+		return true;
+	}
+
+	const DgmOctree::cellsContainer& pointsAndCodes = cell.parentOctree->pointsAndTheirCellCodes();
+	for (unsigned i = 0; i < cell.points->size(); ++i)
+	{
+		unsigned globalIndex = pointsAndCodes[cell.index + i].theIndex;
+		if (	cell.points->getPointGlobalIndex(i) != globalIndex
+			||	copy.getPointGlobalIndex(i) != globalIndex
+			||	merged.getPointGlobalIndex(i) != globalIndex
+			||	cell.points->getPoint(i) != cell.points->getAssociatedCloud()->getPoint(globalIndex)
+			||	cell.points->getNormal(i) != cell.points->getAssociatedCloud()->getNormal(globalIndex))
+		{
+			errorCount.fetchAndAddRelaxed(1);
+			break;
+		}
+	}
+
+	return true;
+}
+
+//! Runs a full traversal and checks that each point has been visited exactly once
+static bool TraverseAndCheck(DgmOctree& octree, unsigned char level, unsigned& processedCells)
+{
+	std::vector<int> visits(octree.associatedCloud()->size(), 0);
+	QAtomicInt cellCount(0);
+	void* additionalParameters[2] = { &visits, &cellCount };
+
+	processedCells = octree.executeFunctionForAllCellsAtLevel(level, CountPointsInCell, additionalParameters, true);
+
+	if (static_cast<int>(processedCells) != cellCount.load())
+	{
+		return false;
+	}
+	for (int v : visits)
+	{
+		if (v != 1)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+//! Checks that the octree structure is sorted and contains each point exactly once
+static bool CheckOctreeStructure(const DgmOctree& octree)
+{
+	const DgmOctree::cellsContainer& codes = octree.pointsAndTheirCellCodes();
+	std::vector<int> visits(octree.associatedCloud()->size(), 0);
+	for (std::size_t i = 0; i < codes.size(); ++i)
+	{
+		if (i != 0 && codes[i - 1].theCode > codes[i].theCode)
+		{
+			return false;
+		}
+		++visits[codes[i].theIndex];
+	}
+	for (int v : visits)
+	{
+		if (v != 1)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+void TestDgmOctree::buildSortsCodes() const
+{
+	PointCloud cloud;
+	FillRandomCloud(cloud, 500000, 6);
+
+	DgmOctree octree(&cloud);
+	QCOMPARE(octree.build(), static_cast<int>(cloud.size()));
+	QVERIFY(CheckOctreeStructure(octree));
+
+	//compare with a standard sort
+	DgmOctree::cellsContainer expectedCodes = octree.pointsAndTheirCellCodes();
+	std::sort(expectedCodes.begin(), expectedCodes.end(), DgmOctree::IndexAndCode::codeComp);
+	for (std::size_t i = 0; i < expectedCodes.size(); ++i)
+	{
+		QCOMPARE(octree.pointsAndTheirCellCodes()[i].theCode, expectedCodes[i].theCode);
+	}
+}
+
+void TestDgmOctree::appendPoints() const
+{
+	PointCloud cloud;
+	FillRandomCloud(cloud, 300000, 7);
+
+	DgmOctree octree(&cloud);
+	QVERIFY(octree.build() > 0);
+
+	//append points inside the octree box
+	unsigned previousCount = cloud.size();
+	{
+		PointCloud newPoints;
+		FillRandomCloud(newPoints, 200000, 8);
+		QVERIFY(cloud.reserve(previousCount + newPoints.size()));
+		for (unsigned i = 0; i < newPoints.size(); ++i)
+		{
+			cloud.addPoint(*newPoints.getPoint(i) * static_cast<PointCoordinateType>(0.5));
+		}
+	}
+	QCOMPARE(octree.appendPoints(previousCount), static_cast<int>(cloud.size()));
+	QVERIFY(CheckOctreeStructure(octree));
+
+	//the result must be the same as a full build with the same bounding-box
+	DgmOctree reference(&cloud);
+	QCOMPARE(reference.build(octree.getOctreeMins(), octree.getOctreeMaxs()), static_cast<int>(cloud.size()));
+	for (std::size_t i = 0; i < cloud.size(); ++i)
+	{
+		QCOMPARE(octree.pointsAndTheirCellCodes()[i].theCode, reference.pointsAndTheirCellCodes()[i].theCode);
+	}
+	for (unsigned char level = 1; level <= DgmOctree::MAX_OCTREE_LEVEL; ++level)
+	{
+		QCOMPARE(octree.getCellNumber(level), reference.getCellNumber(level));
+	}
+
+	//append points outside of the octree box (full rebuild)
+	previousCount = cloud.size();
+	cloud.addPoint(CCVector3(200, 200, 200));
+	QCOMPARE(octree.appendPoints(previousCount), static_cast<int>(cloud.size()));
+	QVERIFY(CheckOctreeStructure(octree));
+
+	//with user-defined boxes, the new points must be filtered the same way as by a full build
+	PointCloud filteredCloud;
+	FillRandomCloud(filteredCloud, 100000, 9);
+	const CCVector3 octreeMin(0, 0, 0), octreeMax(100, 100, 100);
+	const CCVector3 filterMin(20, 20, 20), filterMax(60, 60, 60);
+
+	DgmOctree filtered(&filteredCloud);
+	QVERIFY(filtered.build(octreeMin, octreeMax, &filterMin, &filterMax) > 0);
+
+	previousCount = filteredCloud.size();
+	{
+		PointCloud newPoints;
+		FillRandomCloud(newPoints, 50000, 10);
+		QVERIFY(filteredCloud.reserve(previousCount + newPoints.size() + 1));
+		for (unsigned i = 0; i < newPoints.size(); ++i)
+		{
+			filteredCloud.addPoint(*newPoints.getPoint(i));
+		}
+		filteredCloud.addPoint(CCVector3(200, 200, 200)); //outside of both boxes
+	}
+	int projectedCount = filtered.appendPoints(previousCount);
+
+	DgmOctree filteredReference(&filteredCloud);
+	QCOMPARE(filteredReference.build(octreeMin, octreeMax, &filterMin, &filterMax), projectedCount);
+	QVERIFY(projectedCount < static_cast<int>(filteredCloud.size()));
+	QVERIFY((filtered.getOctreeMins() - octreeMin).norm2() == 0);
+	for (int i = 0; i < projectedCount; ++i)
+	{
+		QCOMPARE(filtered.pointsAndTheirCellCodes()[i].theCode, filteredReference.pointsAndTheirCellCodes()[i].theCode);
+	}
+}
+
+void TestDgmOctree::executeFunctionForAllCellsAtLevel() const
+{
+	PointCloud cloud;
+	FillRandomCloud(cloud, 100000, 0);
+
+	DgmOctree octree(&cloud);
+	QVERIFY(octree.build() > 0);
+
+	for (unsigned char level = 1; level <= 8; ++level)
+	{
+		unsigned processedCells = 0;
+		QVERIFY(TraverseAndCheck(octree, level, processedCells));
+		QCOMPARE(processedCells, octree.getCellNumber(level));
+	}
+}
+
+void TestDgmOctree::executeFunctionForAllCellsStartingAtLevel() const
+{
+	PointCloud cloud;
+	FillRandomCloud(cloud, 100000, 1);
+
+	DgmOctree octree(&cloud);
+	QVERIFY(octree.build() > 0);
+
+	std::vector<int> visits(cloud.size(), 0);
+	QAtomicInt cellCount(0);
+	void* additionalParameters[2] = { &visits, &cellCount };
+
+	unsigned processedCells = octree.executeFunctionForAllCellsStartingAtLevel(4, CountPointsInCell, additionalParameters, 10, 50, true);
+	QVERIFY(processedCells != 0);
+	QCOMPARE(static_cast<int>(processedCells), cellCount.load());
+	for (int v : visits)
+	{
+		QCOMPARE(v, 1);
+	}
+}
+
+void TestDgmOctree::cancelTraversal() const
+{
+	PointCloud cloud;
+	FillRandomCloud(cloud, 100000, 2);
+
+	DgmOctree octree(&cloud);
+	QVERIFY(octree.build() > 0);
+
+	QAtomicInt cellCount(0);
+	void* additionalParameters[1] = { &cellCount };
+
+	const unsigned char level = 6;
+	QCOMPARE(octree.executeFunctionForAllCellsAtLevel(level, FailOnCell, additionalParameters, true), 0u);
+	//at most one cell per thread should have been processed
+	QVERIFY(cellCount.load() <= QThread::idealThreadCount());
+}
+
+void TestDgmOctree::cellPointsCopy() const
+{
+	CloudWithNormals cloud;
+	FillRandomCloud(cloud, 50000, 5);
+	cloud.normals.resize(cloud.size(), CCVector3(0, 0, 1));
+
+	DgmOctree octree(&cloud);
+	QVERIFY(octree.build() > 0);
+
+	QAtomicInt errorCount(0);
+	void* additionalParameters[1] = { &errorCount };
+
+	QVERIFY(octree.executeFunctionForAllCellsAtLevel(5, CopyCellPoints, additionalParameters, false) != 0);
+	QVERIFY(octree.executeFunctionForAllCellsAtLevel(5, CopyCellPoints, additionalParameters, true) != 0);
+	QVERIFY(octree.executeFunctionForAllCellsStartingAtLevel(3, CopyCellPoints, additionalParameters, 10, 50, true) != 0);
+	QCOMPARE(errorCount.load(), 0);
+}
+
+void TestDgmOctree::concurrentTraversals() const
+{
+	PointCloud cloud1;
+	FillRandomCloud(cloud1, 200000, 3);
+	PointCloud cloud2;
+	FillRandomCloud(cloud2, 150000, 4);
+
+	DgmOctree octree1(&cloud1);
+	QVERIFY(octree1.build() > 0);
+	DgmOctree octree2(&cloud2);
+	QVERIFY(octree2.build() > 0);
+
+	const unsigned char level = 7;
+	for (int run = 0; run < 10; ++run)
+	{
+		unsigned processedCells1 = 0;
+		unsigned processedCells2 = 0;
+
+		QFuture<bool> future1 = QtConcurrent::run(TraverseAndCheck, std::ref(octree1), level, std::ref(processedCells1));
+		QFuture<bool> future2 = QtConcurrent::run(TraverseAndCheck, std::ref(octree2), level, std::ref(processedCells2));
+
+		QVERIFY(future1.result());
+		QVERIFY(future2.result());
+		QCOMPARE(processedCells1, octree1.getCellNumber(level));
+		QCOMPARE(processedCells2, octree2.getCellNumber(level));
+	}
+}
+
+void TestDgmOctree::batchNearestNeighbours() const
+{
+	PointCloud cloud;
+	FillRandomCloud(cloud, 20000, 9);
+
+	DgmOctree octree(&cloud);
+	QVERIFY(octree.build() > 0);
+
+	const std::vector<CCVector3> queries = RandomQueries(1000, 10);
+	const unsigned k = 12;
+	const unsigned char level = 6;
+
+	DgmOctree::BatchNeighbourhoods result;
+	QVERIFY(octree.findNearestNeighborsBatch(queries.data(), static_cast<PointIndexType>(queries.size()), k, level, result));
+	QCOMPARE(result.queryCount(), static_cast<PointIndexType>(queries.size()));
+	QCOMPARE(result.indexes.size(), static_cast<std::size_t>(result.offsets.back()));
+
+	for (unsigned q = 0; q < queries.size(); ++q)
+	{
+		QCOMPARE(result.neighbourCount(q), static_cast<std::size_t>(k));
+
+		const std::vector<double> expected = SortedSquareDistances(cloud, queries[q]);
+		for (unsigned j = 0; j < k; ++j)
+		{
+			const std::size_t n = result.offsets[q] + j;
+			QCOMPARE(result.squareDistances[n], expected[j]);
+			QCOMPARE(result.squareDistances[n], (*cloud.getPoint(result.indexes[n]) - queries[q]).norm2d());
+		}
+	}
+
+	//same result without multi-threading
+	DgmOctree::BatchNeighbourhoods sequentialResult;
+	QVERIFY(octree.findNearestNeighborsBatch(queries.data(), static_cast<PointIndexType>(queries.size()), k, level, sequentialResult, 0, false));
+	QVERIFY(sequentialResult.offsets == result.offsets);
+	QVERIFY(sequentialResult.squareDistances == result.squareDistances);
+
+	//bounded search
+	const double maxSearchDist = 2.0;
+	QVERIFY(octree.findNearestNeighborsBatch(queries.data(), static_cast<PointIndexType>(queries.size()), k, level, result, maxSearchDist));
+	for (unsigned q = 0; q < queries.size(); ++q)
+	{
+		QVERIFY(result.neighbourCount(q) <= k);
+		for (std::size_t n = result.offsets[q]; n < result.offsets[q + 1]; ++n)
+		{
+			QVERIFY(result.squareDistances[n] <= maxSearchDist * maxSearchDist);
+		}
+	}
+}
+
+void TestDgmOctree::batchSphericalNeighbourhoods() const
+{
+	PointCloud cloud;
+	FillRandomCloud(cloud, 20000, 11);
+
+	DgmOctree octree(&cloud);
+	QVERIFY(octree.build() > 0);
+
+	const std::vector<CCVector3> queries = RandomQueries(1000, 12);
+	const PointCoordinateType radius = 5;
+	const unsigned char level = octree.findBestLevelForAGivenNeighbourhoodSizeExtraction(radius);
+
+	DgmOctree::BatchNeighbourhoods result;
+	QVERIFY(octree.findNeighborsInASphereBatch(queries.data(), static_cast<PointIndexType>(queries.size()), radius, level, result));
+	QCOMPARE(result.queryCount(), static_cast<PointIndexType>(queries.size()));
+	QCOMPARE(result.indexes.size(), static_cast<std::size_t>(result.offsets.back()));
+
+	const double squareRadius = static_cast<double>(radius) * radius;
+	for (unsigned q = 0; q < queries.size(); ++q)
+	{
+		std::vector<PointIndexType> expected;
+		for (PointIndexType i = 0; i < cloud.size(); ++i)
+		{
+			if ((*cloud.getPoint(i) - queries[q]).norm2d() <= squareRadius)
+			{
+				expected.push_back(i);
+			}
+		}
+
+		QCOMPARE(result.neighbourCount(q), expected.size());
+		std::vector<PointIndexType> found(result.indexes.begin() + result.offsets[q], result.indexes.begin() + result.offsets[q + 1]);
+		QVERIFY(std::is_sorted(result.squareDistances.begin() + result.offsets[q], result.squareDistances.begin() + result.offsets[q + 1]));
+		std::sort(found.begin(), found.end());
+		QVERIFY(found == expected);
+	}
+}
+
+void TestDgmOctree::benchmarkNearestNeighboursPerPoint() const
+{
+	PointCloud cloud;
+	FillRandomCloud(cloud, 200000, 13);
+
+	DgmOctree octree(&cloud);
+	QVERIFY(octree.build() > 0);
+
+	const std::vector<CCVector3> queries = RandomQueries(20000, 14);
+	const unsigned k = 16;
+	const unsigned char level = 6;
+
+	QBENCHMARK
+	{
+		ReferenceCloud Yk(&cloud);
+		for (const CCVector3& Q : queries)
+		{
+			Yk.clear(false);
+			double maxSquareDist = 0;
+			octree.findPointNeighbourhood(&Q, &Yk, k, level, maxSquareDist);
+		}
+	}
+}
+
+void TestDgmOctree::benchmarkNearestNeighboursBatch() const
+{
+	PointCloud cloud;
+	FillRandomCloud(cloud, 200000, 13);
+
+	DgmOctree octree(&cloud);
+	QVERIFY(octree.build() > 0);
+
+	const std::vector<CCVector3> queries = RandomQueries(20000, 14);
+	const unsigned k = 16;
+	const unsigned char level = 6;
+
+	DgmOctree::BatchNeighbourhoods result;
+	QBENCHMARK
+	{
+		QVERIFY(octree.findNearestNeighborsBatch(queries.data(), static_cast<PointIndexType>(queries.size()), k, level, result));
+	}
+}
+
+QTEST_MAIN(TestDgmOctree)
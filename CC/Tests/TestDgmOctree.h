@@ -0,0 +1,45 @@
+
+#ifndef CC_TEST_DGM_OCTREE_HEADER
+#define CC_TEST_DGM_OCTREE_HEADER
+
+#include <QObject>
+#include <QtTest/QtTest>
+
+class TestDgmOctree : public QObject
+{
+Q_OBJECT
+private slots:
+	/* Build tests */
+	void buildSortsCodes() const;
+
+	void appendPoints() const;
+
+	/* Cell traversal tests */
+	void executeFunctionForAllCellsAtLevel() const;
+
+	void executeFunctionForAllCellsStartingAtLevel() const;
+
+	void cancelTraversal() const;
+
+	/* The points of a cell are a view on the octree: copies must behave as standard ReferenceCloud */
+	void cellPointsCopy() const;
+
+	/*
+	 * Reentrance test: two traversals (on two different clouds/octrees)
+	 * are run at the same time, each one must visit all of its points once
+	 */
+	void concurrentTraversals() const;
+
+	/* Batched neighbourhood queries (compared with a brute force search) */
+	void batchNearestNeighbours() const;
+
+	void batchSphericalNeighbourhoods() const;
+
+	/* Benchmarks: per-point queries vs. batched queries */
+	void benchmarkNearestNeighboursPerPoint() const;
+
+	void benchmarkNearestNeighboursBatch() const;
+};
+
+
+#endif //CC_TEST_DGM_OCTREE_HEADER
@@ -0,0 +1,204 @@
+#include "TestGeometricalAnalysisTools.h"
+
+//CCLib
+#include <DgmOctree.h>
+#include <GeometricalAnalysisTools.h>
+#include <Neighbourhood.h>
+#include <PointCloud.h>
+#include <ReferenceCloud.h>
+#include <ScalarField.h>
+
+//system
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+using namespace CCLib;
+
+//! Samples a noisy wavy surface (with a fixed seed)
+static void SampleSurface(PointCloud& cloud, unsigned count)
+{
+	std::mt19937 gen(17);
+	std::uniform_real_distribution<PointCoordinateType> dist(0, 20);
+	std::normal_distribution<PointCoordinateType> noise(0, static_cast<PointCoordinateType>(0.02));
+
+	QVERIFY(cloud.reserve(count));
+	for (unsigned i = 0; i < count; ++i)
+	{
+		PointCoordinateType x = dist(gen);
+		PointCoordinateType y = dist(gen);
+		PointCoordinateType z = 2 * std::sin(x / 3) * std::cos(y / 4) + noise(gen);
+		cloud.addPoint(CCVector3(x, y, z));
+	}
+}
+
+typedef GeometricalAnalysisTools GAT;
+
+//! Computes a characteristic at a single point, from its own spherical neighbourhood
+/** Reference implementation (one neighbourhood extraction per point and per
+	characteristic), independent from the cell-based computation.
+**/
+static ScalarType ComputeReferenceValue(const GAT::CharacteristicDesc& desc, PointCloud& cloud, const DgmOctree& octree, unsigned char level, unsigned index)
+{
+	const CCVector3 P = *cloud.getPoint(index);
+
+	DgmOctree::NeighboursSet neighbours;
+	const PointIndexType neighborCount = static_cast<PointIndexType>(octree.getPointsInSphericalNeighbourhood(P, desc.radius, neighbours, level));
+
+	//the roughness is computed without the query point
+	ReferenceCloud neighboursCloud(&cloud);
+	for (const DgmOctree::PointDescriptor& p : neighbours)
+	{
+		if (desc.charac != GAT::Roughness || p.pointIndex != index)
+		{
+			neighboursCloud.addPointIndex(p.pointIndex);
+		}
+	}
+	Neighbourhood Z(&neighboursCloud);
+
+	switch (desc.charac)
+	{
+	case GAT::Feature:
+		return (neighborCount > 3 ? static_cast<ScalarType>(Z.computeFeature(static_cast<Neighbourhood::GeomFeature>(desc.subOption))) : NAN_VALUE);
+	case GAT::Curvature:
+		return (neighborCount > 5 ? Z.computeCurvature(P, static_cast<Neighbourhood::CurvatureType>(desc.subOption)) : NAN_VALUE);
+	case GAT::LocalDensity:
+		//only the 3D density is tested
+		return static_cast<ScalarType>(neighborCount / (4.0 * M_PI / 3.0 * std::pow(static_cast<double>(desc.radius), 3.0)));
+	case GAT::Roughness:
+		return (neighborCount > 3 ? Z.computeRoughness(P) : NAN_VALUE);
+	case GAT::MomentOrder1:
+		return Z.computeMomentOrder1(P);
+	default:
+		break;
+	}
+
+	return NAN_VALUE;
+}
+
+//! Returns the maximum relative difference accepted between the cell-based and the reference values
+static double Tolerance(const GAT::CharacteristicDesc& desc)
+{
+	switch (desc.charac)
+	{
+	case GAT::Roughness:
+	case GAT::Curvature:
+		//the local plane / quadric fitting is done in single precision
+		return 5.0e-5;
+	default:
+		return 1.0e-5;
+	}
+}
+
+//! Returns the relative difference between two characteristic values (or -1 if only one of them is valid)
+static double RelativeDifference(ScalarType a, ScalarType b)
+{
+	if (!ScalarField::ValidValue(a) || !ScalarField::ValidValue(b))
+		return (!ScalarField::ValidValue(a) && !ScalarField::ValidValue(b) ? 0.0 : -1.0);
+
+	return std::abs(static_cast<double>(a) - b) / std::max(1.0, std::max(std::abs(static_cast<double>(a)), std::abs(static_cast<double>(b))));
+}
+
+void TestGeometricalAnalysisTools::multiFeaturesMatchSinglePasses() const
+{
+	PointCloud cloud;
+	SampleSurface(cloud, 5000);
+
+	std::vector<std::pair<GAT::GeomCharacteristic, int>> characs;
+	for (int f = Neighbourhood::EigenValuesSum; f <= Neighbourhood::Verticality; ++f)
+		characs.emplace_back(GAT::Feature, f);
+	characs.emplace_back(GAT::Roughness, 0);
+	characs.emplace_back(GAT::Curvature, Neighbourhood::MEAN_CURV);
+	characs.emplace_back(GAT::Curvature, Neighbourhood::NORMAL_CHANGE_RATE);
+	characs.emplace_back(GAT::LocalDensity, GAT::DENSITY_3D);
+	characs.emplace_back(GAT::MomentOrder1, 0);
+
+	const PointCoordinateType radii[3] = { static_cast<PointCoordinateType>(0.4), static_cast<PointCoordinateType>(1.5), static_cast<PointCoordinateType>(0.8) };
+
+	//all the characteristics at once
+	std::vector<ScalarField*> sfs;
+	std::vector<GAT::CharacteristicDesc> descs;
+	for (PointCoordinateType r : radii)
+	{
+		for (const auto& c : characs)
+		{
+			ScalarField* sf = new ScalarField;
+			sf->link();
+			QVERIFY(sf->resizeSafe(cloud.size()));
+			sfs.push_back(sf);
+			descs.emplace_back(c.first, c.second, r, sf);
+		}
+	}
+	QCOMPARE(GAT::ComputeCharacteristics(descs, &cloud), GAT::NoError);
+
+	//reference values: one spherical neighbourhood extraction per point
+	DgmOctree octree(&cloud);
+	QVERIFY(octree.build() > 0);
+	for (size_t i = 0; i < descs.size(); ++i)
+	{
+		const GAT::CharacteristicDesc& desc = descs[i];
+		const unsigned char level = octree.findBestLevelForAGivenNeighbourhoodSizeExtraction(desc.radius);
+
+		const double tolerance = Tolerance(desc);
+		unsigned mismatchCount = 0;
+		unsigned validCount = 0;
+		for (unsigned j = 0; j < cloud.size(); ++j)
+		{
+			ScalarType value = desc.sf->getValue(j);
+			double diff = RelativeDifference(value, ComputeReferenceValue(desc, cloud, octree, level, j));
+			if (diff < 0 || diff > tolerance)
+				++mismatchCount;
+			if (ScalarField::ValidValue(value))
+				++validCount;
+		}
+		QVERIFY2(mismatchCount == 0, qPrintable(QString("characteristic %1: %2 mismatches").arg(i).arg(mismatchCount)));
+		QVERIFY2(validCount != 0, qPrintable(QString("characteristic %1: no valid value").arg(i)));
+	}
+
+	for (ScalarField* sf : sfs)
+		sf->release();
+}
+
+void TestGeometricalAnalysisTools::invalidCharacteristics() const
+{
+	PointCloud cloud;
+	SampleSurface(cloud, 1000);
+
+	typedef GeometricalAnalysisTools GAT;
+	const PointCoordinateType radius = 1;
+
+	//empty list
+	QCOMPARE(GAT::ComputeCharacteristics(std::vector<GAT::CharacteristicDesc>(), &cloud), GAT::InvalidInput);
+
+	//the approximate density has no radius
+	{
+		std::vector<GAT::CharacteristicDesc> descs{ GAT::CharacteristicDesc(GAT::ApproxLocalDensity, GAT::DENSITY_KNN, radius) };
+		QCOMPARE(GAT::ComputeCharacteristics(descs, &cloud), GAT::UnhandledCharacteristic);
+	}
+
+	//only one characteristic can be stored in the cloud 'current' scalar field
+	{
+		std::vector<GAT::CharacteristicDesc> descs{	GAT::CharacteristicDesc(GAT::Roughness, 0, radius),
+													GAT::CharacteristicDesc(GAT::Feature, Neighbourhood::Planarity, radius) };
+		QCOMPARE(GAT::ComputeCharacteristics(descs, &cloud), GAT::InvalidInput);
+	}
+
+	//output scalar fields must be large enough
+	{
+		ScalarField* sf = new ScalarField;
+		sf->link();
+		QVERIFY(sf->resizeSafe(cloud.size() / 2));
+		std::vector<GAT::CharacteristicDesc> descs{ GAT::CharacteristicDesc(GAT::Roughness, 0, radius, sf) };
+		QCOMPARE(GAT::ComputeCharacteristics(descs, &cloud), GAT::InvalidInput);
+		sf->release();
+	}
+
+	//invalid radius
+	{
+		std::vector<GAT::CharacteristicDesc> descs{ GAT::CharacteristicDesc(GAT::Roughness, 0, 0) };
+		QCOMPARE(GAT::ComputeCharacteristics(descs, &cloud), GAT::InvalidInput);
+	}
+}
+
+QTEST_MAIN(TestGeometricalAnalysisTools)
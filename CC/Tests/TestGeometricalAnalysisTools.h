@@ -0,0 +1,19 @@
+#ifndef CC_TEST_GEOMETRICAL_ANALYSIS_TOOLS_HEADER
+#define CC_TEST_GEOMETRICAL_ANALYSIS_TOOLS_HEADER
+
+#include <QObject>
+#include <QtTest/QtTest>
+
+class TestGeometricalAnalysisTools : public QObject
+{
+Q_OBJECT
+private slots:
+	/* Computing several characteristics at several radii at once must give the same values as a per-point computation */
+	void multiFeaturesMatchSinglePasses() const;
+
+	/* Invalid requests must be rejected before any computation */
+	void invalidCharacteristics() const;
+};
+
+
+#endif //CC_TEST_GEOMETRICAL_ANALYSIS_TOOLS_HEADER
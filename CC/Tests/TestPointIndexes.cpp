@@ -0,0 +1,141 @@
+#include "TestPointIndexes.h"
+
+//CCLib
+#include <DgmOctree.h>
+#include <PointCloud.h>
+#include <ReferenceCloud.h>
+
+//system
+#include <algorithm>
+#include <limits>
+#include <random>
+
+using namespace CCLib;
+
+//! Creates a random cloud (with a fixed seed)
+static void FillRandomCloud(PointCloud& cloud, PointIndexType count, unsigned seed)
+{
+	std::mt19937 gen(seed);
+	std::uniform_real_distribution<PointCoordinateType> dist(0, 100);
+
+	QVERIFY(cloud.reserve(count));
+	for (PointIndexType i = 0; i < count; ++i)
+	{
+		cloud.addPoint(CCVector3(dist(gen), dist(gen), dist(gen)));
+	}
+}
+
+//! Cell function: sums the global indexes of the points of the cell
+/** Parameters:
+	- (double*) sum of the indexes (not thread-safe: single thread only)
+**/
+static bool SumCellIndexes(const DgmOctree::octreeCell& cell, void** additionalParameters, NormalizedProgress*)
+{
+	double* sum = static_cast<double*>(additionalParameters[0]);
+	for (PointIndexType i = 0; i < cell.points->size(); ++i)
+	{
+		*sum += cell.points->getPointGlobalIndex(i);
+	}
+	return true;
+}
+
+void TestPointIndexes::indexType() const
+{
+#ifdef CC_CORE_LIB_USES_64BIT_INDEXES
+	QCOMPARE(sizeof(PointIndexType), static_cast<size_t>(8));
+#else
+	QCOMPARE(sizeof(PointIndexType), static_cast<size_t>(4));
+#endif
+	QVERIFY(!std::numeric_limits<PointIndexType>::is_signed);
+
+	//the octree codes are stored along with the point indexes
+	QVERIFY(sizeof(DgmOctree::IndexAndCode::theIndex) == sizeof(PointIndexType));
+}
+
+void TestPointIndexes::indexesBeyond32Bits() const
+{
+#ifdef CC_CORE_LIB_USES_64BIT_INDEXES
+	const PointIndexType bigIndex = static_cast<PointIndexType>(std::numeric_limits<unsigned>::max()) + 12345;
+
+	PointCloud cloud;
+	ReferenceCloud refCloud(&cloud);
+	QVERIFY(refCloud.addPointIndex(bigIndex));
+	QVERIFY(refCloud.addPointIndex(bigIndex + 1, bigIndex + 3));
+	QCOMPARE(refCloud.size(), static_cast<PointIndexType>(3));
+	QCOMPARE(refCloud.getPointGlobalIndex(0), bigIndex);
+	QCOMPARE(refCloud.getPointGlobalIndex(2), bigIndex + 2);
+
+	DgmOctree::IndexAndCode ic(bigIndex, 0);
+	QCOMPARE(ic.theIndex, bigIndex);
+
+	DgmOctree::PointDescriptor desc(nullptr, bigIndex, 1.0);
+	QCOMPARE(desc.pointIndex, bigIndex);
+#endif
+}
+
+void TestPointIndexes::memoryFootprint() const
+{
+	//octree structure: one (index, code) pair per point
+	qDebug("Octree: %u bytes per point", static_cast<unsigned>(sizeof(DgmOctree::IndexAndCode)));
+	//reference clouds (subsets, neighbourhoods, etc.): one index per point
+	qDebug("Reference cloud: %u bytes per point", static_cast<unsigned>(sizeof(PointIndexType)));
+	//neighbourhoods (nearest neighbours search)
+	qDebug("Neighbour descriptor: %u bytes per point", static_cast<unsigned>(sizeof(DgmOctree::PointDescriptor)));
+
+	//the code is at least as large as the index: the padding absorbs the 64 bits indexes
+	QVERIFY(sizeof(DgmOctree::IndexAndCode) <= 2 * std::max(sizeof(DgmOctree::CellCode), sizeof(PointIndexType)));
+}
+
+void TestPointIndexes::benchmarkOctreeBuild() const
+{
+	PointCloud cloud;
+	FillRandomCloud(cloud, 2000000, 21);
+
+	QBENCHMARK
+	{
+		DgmOctree octree(&cloud);
+		QVERIFY(octree.build() > 0);
+	}
+}
+
+void TestPointIndexes::benchmarkOctreeTraversal() const
+{
+	PointCloud cloud;
+	FillRandomCloud(cloud, 2000000, 22);
+
+	DgmOctree octree(&cloud);
+	QVERIFY(octree.build() > 0);
+
+	QBENCHMARK
+	{
+		double sum = 0;
+		void* additionalParameters[] = { &sum };
+		QVERIFY(octree.executeFunctionForAllCellsAtLevel(8, SumCellIndexes, additionalParameters, false) != 0);
+
+		//each index is visited once
+		const double n = static_cast<double>(cloud.size());
+		QCOMPARE(sum, n * (n - 1) / 2);
+	}
+}
+
+void TestPointIndexes::benchmarkReferenceCloud() const
+{
+	PointCloud cloud;
+	FillRandomCloud(cloud, 2000000, 23);
+
+	QBENCHMARK
+	{
+		ReferenceCloud refCloud(&cloud);
+		QVERIFY(refCloud.reserve(cloud.size()));
+		for (PointIndexType i = 0; i < cloud.size(); i += 2)
+		{
+			refCloud.addPointIndex(i);
+		}
+
+		CCVector3 bbMin, bbMax;
+		refCloud.getBoundingBox(bbMin, bbMax);
+		QVERIFY(bbMin.x <= bbMax.x);
+	}
+}
+
+QTEST_MAIN(TestPointIndexes)
@@ -0,0 +1,29 @@
+#ifndef CC_TEST_POINT_INDEXES_HEADER
+#define CC_TEST_POINT_INDEXES_HEADER
+
+#include <QObject>
+#include <QtTest/QtTest>
+
+class TestPointIndexes : public QObject
+{
+Q_OBJECT
+private slots:
+	/* The index type must match the build configuration (CC_CORE_LIB_USES_64BIT_INDEXES) */
+	void indexType() const;
+
+	/* Indexes beyond the 32 bits range must survive a round trip in the index containers (64 bits builds only) */
+	void indexesBeyond32Bits() const;
+
+	/* Reports the memory consumed by the index containers (per point) */
+	void memoryFootprint() const;
+
+	/* Compare the results of these benchmarks between a 32 bits and a 64 bits build */
+	void benchmarkOctreeBuild() const;
+
+	void benchmarkOctreeTraversal() const;
+
+	void benchmarkReferenceCloud() const;
+};
+
+
+#endif //CC_TEST_POINT_INDEXES_HEADER
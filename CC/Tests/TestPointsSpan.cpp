@@ -0,0 +1,310 @@
+#include "TestPointsSpan.h"
+
+//CCLib
+#include <DgmOctree.h>
+#include <GeometricalAnalysisTools.h>
+#include <Neighbourhood.h>
+#include <PointCloud.h>
+#include <PointsSpan.h>
+#include <ReferenceCloud.h>
+
+//system
+#include <random>
+#include <vector>
+
+using namespace CCLib;
+
+//! Creates a random cloud (with a fixed seed)
+static void FillRandomCloud(PointCloud& cloud, PointIndexType count, unsigned seed)
+{
+	std::mt19937 gen(seed);
+	std::uniform_real_distribution<PointCoordinateType> dist(0, 100);
+
+	QVERIFY(cloud.reserve(count));
+	for (PointIndexType i = 0; i < count; ++i)
+	{
+		cloud.addPoint(CCVector3(dist(gen), dist(gen), dist(gen)));
+	}
+}
+
+//! Exact comparison of two points
+static inline bool SamePoint(const CCVector3& A, const CCVector3& B)
+{
+	return A.x == B.x && A.y == B.y && A.z == B.z;
+}
+
+//! Creates a random subset of a cloud (with a fixed seed)
+static void FillRandomSubset(ReferenceCloud& subset, PointIndexType count, unsigned seed)
+{
+	std::mt19937 gen(seed);
+	std::uniform_int_distribution<PointIndexType> dist(0, subset.getAssociatedCloud()->size() - 1);
+
+	QVERIFY(subset.reserve(count));
+	for (PointIndexType i = 0; i < count; ++i)
+	{
+		QVERIFY(subset.addPointIndex(dist(gen)));
+	}
+}
+
+//! Cell function: checks the points span of the cell against the virtual accessors
+/** Parameters:
+	- (unsigned*) number of cells with a valid span (not thread-safe: single thread only)
+**/
+static bool CheckCellSpan(const DgmOctree::octreeCell& cell, void** additionalParameters, NormalizedProgress*)
+{
+	unsigned* validCells = static_cast<unsigned*>(additionalParameters[0]);
+
+	PointsSpan span;
+	if (!cell.points->getPointsSpan(span) || span.count != cell.points->size())
+	{
+		return true;
+	}
+
+	for (PointIndexType i = 0; i < span.count; ++i)
+	{
+		if (!SamePoint(span[i], *cell.points->getPoint(i)))
+		{
+			return true;
+		}
+	}
+
+	++(*validCells);
+	return true;
+}
+
+//! Cell function: modifies the set of points of the cell and checks its content
+/** Parameters:
+	- (unsigned*) number of cells modified as expected (not thread-safe: single thread only)
+**/
+static bool ModifyCellPoints(const DgmOctree::octreeCell& cell, void** additionalParameters, NormalizedProgress*)
+{
+	unsigned* validCells = static_cast<unsigned*>(additionalParameters[0]);
+
+	ReferenceCloud* points = cell.points;
+	const PointIndexType count = points->size();
+	std::vector<PointIndexType> indexes(count);
+	for (PointIndexType i = 0; i < count; ++i)
+	{
+		indexes[i] = points->getPointGlobalIndex(i);
+	}
+
+	//append the cell to itself, then change and move some indexes
+	ReferenceCloud copy(*points);
+	if (!points->add(copy) || points->size() != 2 * count)
+	{
+		return true;
+	}
+	points->setPointIndex(0, indexes.back());
+	points->swap(0, count);
+	if (!points->addPointIndex(indexes.front()))
+	{
+		return true;
+	}
+
+	bool valid = (points->size() == 2 * count + 1
+				&& points->getPointGlobalIndex(0) == indexes.front()
+				&& points->getPointGlobalIndex(count) == indexes.back()
+				&& points->getPointGlobalIndex(2 * count) == indexes.front());
+	for (PointIndexType i = 1; i < count; ++i)
+	{
+		valid &= (points->getPointGlobalIndex(i) == indexes[i] && points->getPointGlobalIndex(count + i) == indexes[i]);
+	}
+
+	if (valid)
+	{
+		++(*validCells);
+	}
+	return true;
+}
+
+//! Gravity center and covariance matrix of a cloud, without the points span
+static void ComputeMomentsWithVirtualAccess(GenericIndexedCloud* cloud, CCVector3d& G, double cov[6])
+{
+	const PointIndexType count = cloud->size();
+	G = CCVector3d(0, 0, 0);
+	for (PointIndexType i = 0; i < count; ++i)
+	{
+		G += CCVector3d::fromArray(cloud->getPoint(i)->u);
+	}
+	G /= count;
+
+	std::fill(cov, cov + 6, 0.0);
+	for (PointIndexType i = 0; i < count; ++i)
+	{
+		const CCVector3d P = CCVector3d::fromArray(cloud->getPoint(i)->u) - G;
+		cov[0] += P.x * P.x; cov[1] += P.x * P.y; cov[2] += P.x * P.z;
+		cov[3] += P.y * P.y; cov[4] += P.y * P.z; cov[5] += P.z * P.z;
+	}
+}
+
+//! Gravity center and covariance matrix of a cloud, with the points span (if any)
+static void ComputeMomentsWithDirectAccess(GenericIndexedCloud* cloud, CCVector3d& G, double cov[6])
+{
+	const PointIndexType count = cloud->size();
+	G = CCVector3d(0, 0, 0);
+	ForEachPoint(cloud, [&G](PointIndexType, const CCVector3& P) { G += CCVector3d::fromArray(P.u); });
+	G /= count;
+
+	std::fill(cov, cov + 6, 0.0);
+	ForEachPoint(cloud, [&G, cov](PointIndexType, const CCVector3& Q)
+	{
+		const CCVector3d P = CCVector3d::fromArray(Q.u) - G;
+		cov[0] += P.x * P.x; cov[1] += P.x * P.y; cov[2] += P.x * P.z;
+		cov[3] += P.y * P.y; cov[4] += P.y * P.z; cov[5] += P.z * P.z;
+	});
+}
+
+void TestPointsSpan::spans() const
+{
+	PointCloud cloud;
+	FillRandomCloud(cloud, 1000, 31);
+
+	PointsSpan span;
+	QVERIFY(cloud.getPointsSpan(span));
+	QCOMPARE(span.count, cloud.size());
+	QVERIFY(span.indexes == nullptr);
+	QVERIFY(span.points == cloud.getPoint(0));
+
+	ReferenceCloud subset(&cloud);
+	FillRandomSubset(subset, 100, 32);
+	QVERIFY(subset.getPointsSpan(span));
+	QCOMPARE(span.count, subset.size());
+	QVERIFY(span.indexes != nullptr);
+	for (PointIndexType i = 0; i < subset.size(); ++i)
+	{
+		QVERIFY(SamePoint(span[i], *subset.getPoint(i)));
+	}
+
+	//only one level of indirection is supported
+	ReferenceCloud subsubset(&subset);
+	QVERIFY(subsubset.addPointIndex(0, 10));
+	QVERIFY(!subsubset.getPointsSpan(span));
+
+	//the iteration order must be the same with or without the span
+	PointIndexType expectedIndex = 0;
+	bool sameOrder = true;
+	ForEachPoint(&subsubset, [&](PointIndexType i, const CCVector3& P)
+	{
+		sameOrder &= (i == expectedIndex && SamePoint(P, *subset.getPoint(i)));
+		++expectedIndex;
+	});
+	QVERIFY(sameOrder);
+	QCOMPARE(expectedIndex, subsubset.size());
+
+	//same thing with the cloud iterator (GenericCloud interface)
+	expectedIndex = 0;
+	ForEachPoint(static_cast<GenericCloud*>(&subsubset), [&](PointIndexType i, const CCVector3& P)
+	{
+		sameOrder &= (i == expectedIndex && SamePoint(P, *subset.getPoint(i)));
+		++expectedIndex;
+	});
+	QVERIFY(sameOrder);
+	QCOMPARE(expectedIndex, subsubset.size());
+}
+
+void TestPointsSpan::octreeCellSpan() const
+{
+	PointCloud cloud;
+	FillRandomCloud(cloud, 100000, 33);
+
+	DgmOctree octree(&cloud);
+	QVERIFY(octree.build() > 0);
+
+	const unsigned char level = 6;
+	unsigned validCells = 0;
+	void* additionalParameters[] = { &validCells };
+	QVERIFY(octree.executeFunctionForAllCellsAtLevel(level, CheckCellSpan, additionalParameters, false) != 0);
+	QCOMPARE(validCells, octree.getCellNumber(level));
+}
+
+void TestPointsSpan::octreeCellModification() const
+{
+	PointCloud cloud;
+	FillRandomCloud(cloud, 100000, 38);
+
+	DgmOctree octree(&cloud);
+	QVERIFY(octree.build() > 0);
+
+	const unsigned char level = 6;
+	unsigned validCells = 0;
+	void* additionalParameters[] = { &validCells };
+	QVERIFY(octree.executeFunctionForAllCellsAtLevel(level, ModifyCellPoints, additionalParameters, false) != 0);
+	QCOMPARE(validCells, octree.getCellNumber(level));
+
+	//the octree structure must not have been modified
+	validCells = 0;
+	QVERIFY(octree.executeFunctionForAllCellsAtLevel(level, CheckCellSpan, additionalParameters, false) != 0);
+	QCOMPARE(validCells, octree.getCellNumber(level));
+}
+
+void TestPointsSpan::kernelsConsistency() const
+{
+	PointCloud cloud;
+	FillRandomCloud(cloud, 10000, 34);
+
+	ReferenceCloud subset(&cloud);
+	FillRandomSubset(subset, 5000, 35);
+
+	//a subset of a subset doesn't have a span (virtual path)
+	ReferenceCloud subsubset(&subset);
+	QVERIFY(subsubset.addPointIndex(0, subset.size()));
+
+	const CCVector3* G1 = Neighbourhood(&subset).getGravityCenter();
+	const CCVector3* G2 = Neighbourhood(&subsubset).getGravityCenter();
+	QVERIFY(G1 && G2);
+	QVERIFY((*G1 - *G2).norm() < 1.0e-4);
+
+	SquareMatrixd C1 = Neighbourhood(&subset).computeCovarianceMatrix();
+	SquareMatrixd C2 = Neighbourhood(&subsubset).computeCovarianceMatrix();
+	SquareMatrixd C3 = GeometricalAnalysisTools::ComputeCovarianceMatrix(&subsubset, G2->u);
+	QVERIFY(C1.isValid() && C2.isValid() && C3.isValid());
+	for (unsigned r = 0; r < 3; ++r)
+	{
+		for (unsigned c = 0; c < 3; ++c)
+		{
+			QVERIFY(std::abs(C1.m_values[r][c] - C2.m_values[r][c]) < 1.0e-3);
+			QVERIFY(std::abs(C1.m_values[r][c] - C3.m_values[r][c]) < 1.0e-3);
+		}
+	}
+
+	CCVector3 bbMin1, bbMax1, bbMin2, bbMax2;
+	subset.getBoundingBox(bbMin1, bbMax1);
+	subsubset.getBoundingBox(bbMin2, bbMax2);
+	QVERIFY(SamePoint(bbMin1, bbMin2) && SamePoint(bbMax1, bbMax2));
+}
+
+void TestPointsSpan::benchmarkDirectAccess() const
+{
+	PointCloud cloud;
+	FillRandomCloud(cloud, 2000000, 36);
+
+	ReferenceCloud subset(&cloud);
+	FillRandomSubset(subset, 1000000, 37);
+
+	QBENCHMARK
+	{
+		CCVector3d G;
+		double cov[6];
+		ComputeMomentsWithDirectAccess(&subset, G, cov);
+		QVERIFY(cov[0] > 0);
+	}
+}
+
+void TestPointsSpan::benchmarkVirtualAccess() const
+{
+	PointCloud cloud;
+	FillRandomCloud(cloud, 2000000, 36);
+
+	ReferenceCloud subset(&cloud);
+	FillRandomSubset(subset, 1000000, 37);
+
+	QBENCHMARK
+	{
+		CCVector3d G;
+		double cov[6];
+		ComputeMomentsWithVirtualAccess(&subset, G, cov);
+		QVERIFY(cov[0] > 0);
+	}
+}
+
+QTEST_MAIN(TestPointsSpan)
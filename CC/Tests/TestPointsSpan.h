@@ -0,0 +1,30 @@
+#ifndef CC_TEST_POINTS_SPAN_HEADER
+#define CC_TEST_POINTS_SPAN_HEADER
+
+#include <QObject>
+#include <QtTest/QtTest>
+
+class TestPointsSpan : public QObject
+{
+Q_OBJECT
+private slots:
+	/* Point clouds expose their points directly, reference clouds through their indexes */
+	void spans() const;
+
+	/* The zero-copy view on the points of an octree cell reads the indexes in the octree structure */
+	void octreeCellSpan() const;
+
+	/* Modifying the points of an octree cell copies the viewed indexes first (the octree is left untouched) */
+	void octreeCellModification() const;
+
+	/* The direct and the virtual paths must give the same results */
+	void kernelsConsistency() const;
+
+	/* Gravity center + covariance matrix of a large subset: direct span vs. virtual accessors */
+	void benchmarkDirectAccess() const;
+
+	void benchmarkVirtualAccess() const;
+};
+
+
+#endif //CC_TEST_POINTS_SPAN_HEADER
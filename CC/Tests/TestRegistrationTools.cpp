@@ -0,0 +1,216 @@
+#include "TestRegistrationTools.h"
+
+//CCLib
+#include <PointCloud.h>
+#include <RegistrationTools.h>
+
+//system
+#include <cmath>
+#include <random>
+#include <vector>
+
+using namespace CCLib;
+
+//! Point cloud with per-point normals
+/** Null normals are considered as missing (getNormal returns nullptr).
+**/
+class CloudWithNormals : public PointCloud
+{
+public:
+	std::vector<CCVector3> normals;
+
+	bool normalsAvailable() const override { return !normals.empty(); }
+	const CCVector3* getNormal(PointIndexType index) const override { return (normals[index].norm2() != 0 ? &normals[index] : nullptr); }
+};
+
+//! Smooth (wavy) test surface
+static inline PointCoordinateType SurfaceHeight(PointCoordinateType x, PointCoordinateType y)
+{
+	return 2 * std::sin(x / 4) * std::cos(y / 5);
+}
+
+//! Normal of the test surface
+static inline CCVector3 SurfaceNormal(PointCoordinateType x, PointCoordinateType y)
+{
+	CCVector3 N(-std::cos(x / 4) * std::cos(y / 5) / 2, std::sin(x / 4) * std::sin(y / 5) * 2 / 5, 1);
+	N.normalize();
+	return N;
+}
+
+//! Samples the test surface (with a fixed seed)
+static void SampleSurface(PointCloud& cloud, std::vector<CCVector3>* normals, unsigned count, unsigned seed)
+{
+	std::mt19937 gen(seed);
+	std::uniform_real_distribution<PointCoordinateType> dist(0, 40);
+
+	QVERIFY(cloud.reserve(count));
+	if (normals)
+		normals->reserve(count);
+	for (unsigned i = 0; i < count; ++i)
+	{
+		PointCoordinateType x = dist(gen);
+		PointCoordinateType y = dist(gen);
+		cloud.addPoint(CCVector3(x, y, SurfaceHeight(x, y)));
+		if (normals)
+			normals->push_back(SurfaceNormal(x, y));
+	}
+}
+
+//! Returns a small rigid transformation (~3 degrees around a tilted axis + translation)
+static RegistrationTools::ScaledTransformation SmallMotion()
+{
+	CCVector3d axis(0.2, 0.3, 1.0);
+	axis.normalize();
+	double angle_rad = 3.0 * M_PI / 180.0;
+	double q[4] = { cos(angle_rad / 2), axis.x * sin(angle_rad / 2), axis.y * sin(angle_rad / 2), axis.z * sin(angle_rad / 2) };
+
+	RegistrationTools::ScaledTransformation motion;
+	motion.R.initFromQuaternion(q);
+	motion.T = CCVector3(static_cast<PointCoordinateType>(0.4), static_cast<PointCoordinateType>(-0.3), static_cast<PointCoordinateType>(0.2));
+	return motion;
+}
+
+//! Creates the model (with normals) and the data (moved) clouds
+static void CreateClouds(CloudWithNormals& model, PointCloud& data, PointCloud& dataGroundTruth)
+{
+	SampleSurface(model, &model.normals, 20000, 1);
+	SampleSurface(dataGroundTruth, nullptr, 5000, 2);
+
+	RegistrationTools::ScaledTransformation motion = SmallMotion();
+	QVERIFY(data.reserve(dataGroundTruth.size()));
+	for (unsigned i = 0; i < dataGroundTruth.size(); ++i)
+	{
+		data.addPoint(motion.apply(*dataGroundTruth.getPoint(i)));
+	}
+}
+
+//! Returns the max. distance between the registered data points and their true position
+static double MaxRegistrationError(PointCloud& data, PointCloud& dataGroundTruth, const RegistrationTools::ScaledTransformation& trans)
+{
+	double maxError = 0;
+	for (unsigned i = 0; i < data.size(); ++i)
+	{
+		CCVector3 P = *data.getPoint(i);
+		if (trans.R.isValid())
+			P = trans.R * P;
+		P = P * trans.s + trans.T;
+		maxError = std::max(maxError, (P - *dataGroundTruth.getPoint(i)).normd());
+	}
+	return maxError;
+}
+
+static ICPRegistrationTools::RESULT_TYPE RunICP(CloudWithNormals& model,
+												PointCloud& data,
+												ICPRegistrationTools::Parameters& params,
+												RegistrationTools::ScaledTransformation& trans)
+{
+	params.convType = ICPRegistrationTools::MAX_ERROR_CONVERGENCE;
+	params.minRMSDecrease = 1.0e-6;
+	params.samplingLimit = 50000;
+
+	double finalRMS = 0;
+	unsigned finalPointCount = 0;
+	return ICPRegistrationTools::Register(&model, nullptr, &data, params, trans, finalRMS, finalPointCount);
+}
+
+void TestRegistrationTools::icpPointToPoint() const
+{
+	CloudWithNormals model;
+	PointCloud data, dataGroundTruth;
+	CreateClouds(model, data, dataGroundTruth);
+
+	ICPRegistrationTools::Parameters params;
+	params.errorMetric = ICPRegistrationTools::POINT_TO_POINT;
+
+	RegistrationTools::ScaledTransformation trans;
+	QCOMPARE(RunICP(model, data, params, trans), ICPRegistrationTools::ICP_APPLY_TRANSFO);
+	QVERIFY(MaxRegistrationError(data, dataGroundTruth, trans) < 0.3);
+}
+
+void TestRegistrationTools::icpPointToPlane() const
+{
+	CloudWithNormals model;
+	PointCloud data, dataGroundTruth;
+	CreateClouds(model, data, dataGroundTruth);
+
+	ICPRegistrationTools::Parameters params;
+	params.errorMetric = ICPRegistrationTools::POINT_TO_PLANE;
+
+	RegistrationTools::ScaledTransformation trans;
+	QCOMPARE(RunICP(model, data, params, trans), ICPRegistrationTools::ICP_APPLY_TRANSFO);
+	QVERIFY(MaxRegistrationError(data, dataGroundTruth, trans) < 0.1);
+}
+
+void TestRegistrationTools::icpPointToPlaneWithoutNormals() const
+{
+	CloudWithNormals model;
+	PointCloud data, dataGroundTruth;
+	CreateClouds(model, data, dataGroundTruth);
+	model.normals.clear();
+
+	ICPRegistrationTools::Parameters params;
+	params.errorMetric = ICPRegistrationTools::POINT_TO_PLANE;
+
+	RegistrationTools::ScaledTransformation trans;
+	QCOMPARE(RunICP(model, data, params, trans), ICPRegistrationTools::ICP_ERROR_INVALID_INPUT);
+}
+
+void TestRegistrationTools::icpPointToPlaneMissingNormals() const
+{
+	CloudWithNormals model;
+	PointCloud data, dataGroundTruth;
+	CreateClouds(model, data, dataGroundTruth);
+	for (size_t i = 0; i < model.normals.size(); i += 2)
+	{
+		model.normals[i] = CCVector3(0, 0, 0);
+	}
+
+	ICPRegistrationTools::Parameters params;
+	params.errorMetric = ICPRegistrationTools::POINT_TO_PLANE;
+
+	RegistrationTools::ScaledTransformation trans;
+	QCOMPARE(RunICP(model, data, params, trans), ICPRegistrationTools::ICP_APPLY_TRANSFO);
+	QVERIFY(MaxRegistrationError(data, dataGroundTruth, trans) < 0.3);
+}
+
+void TestRegistrationTools::icpIterationStats() const
+{
+	CloudWithNormals model;
+	PointCloud data, dataGroundTruth;
+	CreateClouds(model, data, dataGroundTruth);
+
+	std::vector<ICPRegistrationTools::IterationStats> pointToPointStats;
+	{
+		ICPRegistrationTools::Parameters params;
+		params.errorMetric = ICPRegistrationTools::POINT_TO_POINT;
+		params.iterationStats = &pointToPointStats;
+		RegistrationTools::ScaledTransformation trans;
+		QCOMPARE(RunICP(model, data, params, trans), ICPRegistrationTools::ICP_APPLY_TRANSFO);
+	}
+
+	std::vector<ICPRegistrationTools::IterationStats> pointToPlaneStats;
+	{
+		ICPRegistrationTools::Parameters params;
+		params.errorMetric = ICPRegistrationTools::POINT_TO_PLANE;
+		params.iterationStats = &pointToPlaneStats;
+		RegistrationTools::ScaledTransformation trans;
+		QCOMPARE(RunICP(model, data, params, trans), ICPRegistrationTools::ICP_APPLY_TRANSFO);
+	}
+
+	QVERIFY(pointToPointStats.size() > 1);
+	for (size_t i = 0; i < pointToPointStats.size(); ++i)
+	{
+		QCOMPARE(pointToPointStats[i].iteration, static_cast<unsigned>(i));
+		QCOMPARE(pointToPointStats[i].pointCount, data.size());
+		QVERIFY(pointToPointStats[i].closestPointsTime_ms >= 0);
+		QVERIFY(pointToPointStats[i].registrationTime_ms >= 0);
+		if (i != 0)
+			QVERIFY(pointToPointStats[i].rms <= pointToPointStats[i - 1].rms);
+	}
+
+	//point-to-plane should converge (much) faster
+	QVERIFY(!pointToPlaneStats.empty());
+	QVERIFY(pointToPlaneStats.size() < pointToPointStats.size());
+}
+
+QTEST_MAIN(TestRegistrationTools)
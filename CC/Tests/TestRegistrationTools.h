@@ -0,0 +1,27 @@
+#ifndef CC_TEST_REGISTRATION_TOOLS_HEADER
+#define CC_TEST_REGISTRATION_TOOLS_HEADER
+
+#include <QObject>
+#include <QtTest/QtTest>
+
+class TestRegistrationTools : public QObject
+{
+Q_OBJECT
+private slots:
+	/* ICP must recover a small rigid transformation between two samplings of the same surface */
+	void icpPointToPoint() const;
+
+	void icpPointToPlane() const;
+
+	/* The point-to-plane metric requires model normals */
+	void icpPointToPlaneWithoutNormals() const;
+
+	/* The model points without normal fall back to the point-to-point metric */
+	void icpPointToPlaneMissingNormals() const;
+
+	/* Per-iteration statistics */
+	void icpIterationStats() const;
+};
+
+
+#endif //CC_TEST_REGISTRATION_TOOLS_HEADER
@@ -0,0 +1,246 @@
+#include "TestSymmetricMatrix3.h"
+
+//CCLib
+#include <Jacobi.h>
+#include <Neighbourhood.h>
+#include <PointCloud.h>
+#include <SymmetricMatrix3.h>
+
+//system
+#include <cmath>
+#include <random>
+#include <vector>
+
+using namespace CCLib;
+
+//! Checks that the eigen vectors are orthonormal and that M.v = lambda.v
+static void CheckDecomposition(const SymmetricMatrix3d& M, const double eigValues[3], const CCVector3d eigVectors[3])
+{
+	double scale = 0;
+	for (unsigned r = 0; r < 3; ++r)
+		for (unsigned c = 0; c < 3; ++c)
+			scale = std::max(scale, std::abs(M.getValue(r, c)));
+	scale = std::max(scale, 1.0e-300);
+
+	//decreasing order
+	QVERIFY(eigValues[0] >= eigValues[1]);
+	QVERIFY(eigValues[1] >= eigValues[2]);
+
+	for (unsigned i = 0; i < 3; ++i)
+	{
+		QVERIFY(std::abs(eigVectors[i].norm() - 1.0) < 1.0e-9);
+		for (unsigned j = i + 1; j < 3; ++j)
+			QVERIFY(std::abs(eigVectors[i].dot(eigVectors[j])) < 1.0e-9);
+
+		const CCVector3d& v = eigVectors[i];
+		CCVector3d Mv(	M.m00 * v.x + M.m01 * v.y + M.m02 * v.z,
+						M.m01 * v.x + M.m11 * v.y + M.m12 * v.z,
+						M.m02 * v.x + M.m12 * v.y + M.m22 * v.z);
+		QVERIFY((Mv - v * eigValues[i]).norm() < 1.0e-9 * scale);
+	}
+}
+
+//! Computes the covariance matrix of a random anisotropic neighbourhood
+static SymmetricMatrix3d RandomCovariance(std::mt19937& gen, PointCloud& points)
+{
+	std::uniform_real_distribution<double> dist(-1.0, 1.0);
+	const double sx = std::abs(dist(gen)) * 10;
+	const double sy = std::abs(dist(gen));
+	const double sz = std::abs(dist(gen)) * 0.01;
+
+	points.reset();
+	for (unsigned i = 0; i < 24; ++i)
+	{
+		CCVector3d P(dist(gen) * sx, dist(gen) * sy, dist(gen) * sz);
+		//random rotation (around a random axis)
+		CCVector3d axis(dist(gen), dist(gen), dist(gen));
+		axis.normalize();
+		const double angle = 1.2;
+		CCVector3d R = P * std::cos(angle) + axis.cross(P) * std::sin(angle) + axis * (axis.dot(P) * (1 - std::cos(angle)));
+		points.addPoint(CCVector3::fromArray(R.u));
+	}
+
+	Neighbourhood Z(&points);
+	return Z.computeCovarianceMatrix3x3();
+}
+
+void TestSymmetricMatrix3::eigenDecompositionMatchesJacobi() const
+{
+	std::mt19937 gen(7);
+	PointCloud points;
+	QVERIFY(points.reserve(24));
+
+	for (unsigned t = 0; t < 1000; ++t)
+	{
+		const SymmetricMatrix3d M = RandomCovariance(gen, points);
+
+		double eigValues[3];
+		CCVector3d eigVectors[3];
+		QVERIFY(M.computeEigenValuesAndVectors(eigValues, eigVectors));
+		CheckDecomposition(M, eigValues, eigVectors);
+
+		SquareMatrixd jacobiVectors;
+		std::vector<double> jacobiValues;
+		QVERIFY(Jacobi<double>::ComputeEigenValuesAndVectors(M.toSquareMatrix(), jacobiVectors, jacobiValues, true));
+		QVERIFY(Jacobi<double>::SortEigenValuesAndVectors(jacobiVectors, jacobiValues));
+
+		for (unsigned i = 0; i < 3; ++i)
+		{
+			QVERIFY(std::abs(eigValues[i] - jacobiValues[i]) < 1.0e-9 * std::abs(jacobiValues[0]));
+
+			CCVector3d v;
+			Jacobi<double>::GetEigenVector(jacobiVectors, i, v.u);
+			QVERIFY(std::abs(std::abs(v.dot(eigVectors[i])) - 1.0) < 1.0e-6);
+		}
+	}
+}
+
+void TestSymmetricMatrix3::degenerateCases() const
+{
+	double eigValues[3];
+	CCVector3d eigVectors[3];
+
+	//null matrix
+	{
+		SymmetricMatrix3d M;
+		QVERIFY(M.computeEigenValuesAndVectors(eigValues, eigVectors));
+		QCOMPARE(eigValues[0], 0.0);
+		QCOMPARE(eigValues[2], 0.0);
+		CheckDecomposition(M, eigValues, eigVectors);
+	}
+
+	//isotropic matrix (triple eigen value)
+	{
+		SymmetricMatrix3d M(3, 0, 0, 3, 0, 3);
+		QVERIFY(M.computeEigenValuesAndVectors(eigValues, eigVectors));
+		QCOMPARE(eigValues[0], 3.0);
+		QCOMPARE(eigValues[2], 3.0);
+		CheckDecomposition(M, eigValues, eigVectors);
+	}
+
+	//diagonal matrix (unsorted)
+	{
+		SymmetricMatrix3d M(1, 0, 0, 5, 0, 2);
+		QVERIFY(M.computeEigenValuesAndVectors(eigValues, eigVectors));
+		QCOMPARE(eigValues[0], 5.0);
+		QCOMPARE(eigValues[1], 2.0);
+		QCOMPARE(eigValues[2], 1.0);
+		CheckDecomposition(M, eigValues, eigVectors);
+	}
+
+	//double eigen values (isotropic disc and rank 1)
+	{
+		const CCVector3d N(1.0 / 3, 2.0 / 3, 2.0 / 3); //unit vector
+		const double coefs[2][2] = { { 2.0, 0.5 }, { 0.0, 4.0 } };
+		for (const auto& c : coefs)
+		{
+			//M = a.I + b.N.N^t
+			SymmetricMatrix3d M(c[0] + c[1] * N.x * N.x, c[1] * N.x * N.y, c[1] * N.x * N.z,
+								c[0] + c[1] * N.y * N.y, c[1] * N.y * N.z,
+								c[0] + c[1] * N.z * N.z);
+			QVERIFY(M.computeEigenValuesAndVectors(eigValues, eigVectors));
+			CheckDecomposition(M, eigValues, eigVectors);
+			QVERIFY(std::abs(eigValues[0] - (c[0] + c[1])) < 1.0e-12);
+			QVERIFY(std::abs(std::abs(eigVectors[0].dot(N)) - 1.0) < 1.0e-9);
+		}
+	}
+
+	//collinear and coplanar points
+	{
+		PointCloud points;
+		QVERIFY(points.reserve(10));
+		for (int i = 0; i < 10; ++i)
+			points.addPoint(CCVector3(static_cast<PointCoordinateType>(1 + i), static_cast<PointCoordinateType>(2 + 2 * i), static_cast<PointCoordinateType>(3 - i)));
+		{
+			Neighbourhood Z(&points);
+			const SymmetricMatrix3d M = Z.computeCovarianceMatrix3x3();
+			QVERIFY(M.computeEigenValuesAndVectors(eigValues, eigVectors));
+			CheckDecomposition(M, eigValues, eigVectors);
+			QVERIFY(eigValues[1] < 1.0e-9 * eigValues[0]);
+		}
+
+		points.reset();
+		for (unsigned i = 0; i < 10; ++i)
+			points.addPoint(CCVector3(static_cast<PointCoordinateType>(i % 3), static_cast<PointCoordinateType>(i / 3), 7));
+		{
+			Neighbourhood Z(&points);
+			const SymmetricMatrix3d M = Z.computeCovarianceMatrix3x3();
+			QVERIFY(M.computeEigenValuesAndVectors(eigValues, eigVectors));
+			CheckDecomposition(M, eigValues, eigVectors);
+			QVERIFY(std::abs(eigValues[2]) < 1.0e-12);
+			QVERIFY(std::abs(std::abs(eigVectors[2].z) - 1.0) < 1.0e-12);
+
+			//the LS plane goes through the same path
+			const CCVector3* N = Z.getLSPlaneNormal();
+			QVERIFY(N);
+			QVERIFY(std::abs(std::abs(N->z) - 1) < 1.0e-6);
+		}
+	}
+}
+
+//! Random small neighbourhoods (for the benchmarks)
+static std::vector<PointCloud*> RandomNeighbourhoods()
+{
+	std::mt19937 gen(11);
+	std::uniform_real_distribution<PointCoordinateType> dist(0, 1);
+
+	std::vector<PointCloud*> neighbourhoods(20000);
+	for (PointCloud*& cloud : neighbourhoods)
+	{
+		cloud = new PointCloud;
+		cloud->reserve(16);
+		for (unsigned i = 0; i < 16; ++i)
+			cloud->addPoint(CCVector3(dist(gen), dist(gen), dist(gen) / 10));
+	}
+	return neighbourhoods;
+}
+
+void TestSymmetricMatrix3::benchmarkJacobi() const
+{
+	std::vector<PointCloud*> neighbourhoods = RandomNeighbourhoods();
+
+	double sum = 0;
+	QBENCHMARK
+	{
+		for (PointCloud* cloud : neighbourhoods)
+		{
+			Neighbourhood Z(cloud);
+			SquareMatrixd eigVectors;
+			std::vector<double> eigValues;
+			if (Jacobi<double>::ComputeEigenValuesAndVectors(Z.computeCovarianceMatrix(), eigVectors, eigValues, true))
+			{
+				Jacobi<double>::SortEigenValuesAndVectors(eigVectors, eigValues);
+				sum += eigValues[2];
+			}
+		}
+	}
+	QVERIFY(sum > 0);
+
+	for (PointCloud* cloud : neighbourhoods)
+		delete cloud;
+}
+
+void TestSymmetricMatrix3::benchmarkSymmetricMatrix3() const
+{
+	std::vector<PointCloud*> neighbourhoods = RandomNeighbourhoods();
+
+	double sum = 0;
+	QBENCHMARK
+	{
+		for (PointCloud* cloud : neighbourhoods)
+		{
+			Neighbourhood Z(cloud);
+			const double* eigValues = Z.getEigenValues();
+			if (eigValues)
+			{
+				sum += eigValues[2];
+			}
+		}
+	}
+	QVERIFY(sum > 0);
+
+	for (PointCloud* cloud : neighbourhoods)
+		delete cloud;
+}
+
+QTEST_MAIN(TestSymmetricMatrix3)
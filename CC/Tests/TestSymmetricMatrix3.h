@@ -0,0 +1,24 @@
+#ifndef CC_TEST_SYMMETRIC_MATRIX_3_HEADER
+#define CC_TEST_SYMMETRIC_MATRIX_3_HEADER
+
+#include <QObject>
+#include <QtTest/QtTest>
+
+class TestSymmetricMatrix3 : public QObject
+{
+Q_OBJECT
+private slots:
+	/* The closed-form solver must agree with the Jacobi method on random covariance matrices */
+	void eigenDecompositionMatchesJacobi() const;
+
+	/* Null, isotropic, diagonal, rank 1 and rank 2 matrices, multiple eigen values */
+	void degenerateCases() const;
+
+	/* Covariance + eigen decomposition of many small neighbourhoods (Jacobi vs. fixed size solver) */
+	void benchmarkJacobi() const;
+
+	void benchmarkSymmetricMatrix3() const;
+};
+
+
+#endif //CC_TEST_SYMMETRIC_MATRIX_3_HEADER
@@ -19,10 +19,24 @@
 #ifndef CC_TYPES_HEADER
 #define CC_TYPES_HEADER
 
+//system
+#include <cstdint>
+
 //! Type of the coordinates of a (N-D) point
 using PointCoordinateType = float;
 
 //! Type of a single scalar field value
 using ScalarType = float;
 
+//! Type of a point index (and of a number of points)
+/** 64 bits indexes (to handle clouds with more than 4 billion points)
+	can be enabled with the CC_CORE_LIB_USES_64BIT_INDEXES definition
+	(see the COMPILE_CC_CORE_LIB_WITH_64BIT_INDEXES CMake option).
+**/
+#ifdef CC_CORE_LIB_USES_64BIT_INDEXES
+using PointIndexType = std::uint64_t;
+#else
+using PointIndexType = unsigned;
+#endif
+
 #endif //CC_TYPES_HEADER
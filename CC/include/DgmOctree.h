@@ -105,7 +105,7 @@ public:
 	using cellCodesContainer = std::vector<CellCode>;
 
 	//! Octree cell indexes container
-	using cellIndexesContainer = std::vector<unsigned int>;
+	using cellIndexesContainer = std::vector<PointIndexType>;
 
 	//! Structure used during nearest neighbour search
 	/** Association between a point, its index and its square distance to the query point.
@@ -116,7 +116,7 @@ public:
 		//! Point
 		const CCVector3* point;
 		//! Point index
-		unsigned pointIndex;
+		PointIndexType pointIndex;
 		//! Point associated distance value
 		double squareDistd;
 
@@ -129,7 +129,7 @@ public:
 		}
 
 		//! Constructor with point and its index
-		PointDescriptor(const CCVector3* P, unsigned index)
+		PointDescriptor(const CCVector3* P, PointIndexType index)
 			: point(P)
 			, pointIndex(index)
 			, squareDistd(-1.0)
@@ -137,7 +137,7 @@ public:
 		}
 
 		//! Constructor with point, its index and square distance
-		PointDescriptor(const CCVector3* P, unsigned index, double d2)
+		PointDescriptor(const CCVector3* P, PointIndexType index, double d2)
 			: point(P)
 			, pointIndex(index)
 			, squareDistd(d2)
@@ -254,7 +254,7 @@ public:
 		/** This field is only used by the "unique nearest neighbour" search algorithm
 			(see DgmOctree::findTheNearestNeighborStartingFromCell).
 		**/
-		unsigned theNearestPointIndex;
+		PointIndexType theNearestPointIndex;
 
 		//! Default constructor
 		NearestNeighboursSearchStruct()
@@ -319,7 +319,7 @@ public:
 	struct IndexAndCode
 	{
 		//! index
-		unsigned theIndex;
+		PointIndexType theIndex;
 		//! cell code
 		CellCode theCode;
 
@@ -331,18 +331,17 @@ public:
 		}
 
 		//! Constructor from an index and a code
-		IndexAndCode(unsigned index, CellCode code)
+		IndexAndCode(PointIndexType index, CellCode code)
 			: theIndex(index)
 			, theCode(code)
 		{
 		}
 
 		//! Copy constructor
-		IndexAndCode(const IndexAndCode& ic)
-			: theIndex(ic.theIndex)
-			, theCode(ic.theCode)
-		{
-		}
+		IndexAndCode(const IndexAndCode& ic) = default;
+
+		//! Assignment operator
+		IndexAndCode& operator = (const IndexAndCode& ic) = default;
 
 		//! Code-based 'less than' comparison operator
 		inline bool operator < (const IndexAndCode& iac) const
@@ -391,8 +390,11 @@ public:
 		//! Truncated cell code
 		CellCode truncatedCode;														//8 bytes
 		//! Cell index in octree structure (see m_thePointsAndTheirCellCodes)
-		unsigned index;																//4 bytes
+		PointIndexType index;														//4 bytes (8 bytes with 64 bits indexes)
 		//! Set of points lying inside this cell
+		/** Zero-copy view on the octree structure (the indexes are only
+			copied if the set is modified).
+		**/
 		ReferenceCloud* points;														//8 bytes
 		//! Cell level of subdivision
 		unsigned char level;														//1 byte (+ 3 for alignment)
@@ -440,7 +442,7 @@ public:
 	//! Builds the structure
 	/** Octree 3D limits are determined automatically.
 		\param progressCb the client application can get some notification of the process progress through this callback mechanism (see GenericProgressCallback)
-		\return the number of points projected in the octree
+		\return the number of points projected in the octree (clamped to INT_MAX - see getNumberOfProjectedPoints)
 	**/
 	int build(GenericProgressCallback* progressCb = nullptr);
 
@@ -453,7 +455,7 @@ public:
 		\param pointsMinFilter the lower limits for the projected points along X, Y and Z (is specified)
 		\param pointsMaxFilter the upper limits for the projected points along X, Y and Z (is specified)
 		\param progressCb the client application can get some notification of the process progress through this callback mechanism (see GenericProgressCallback)
-		\return the number of points projected in the octree
+		\return the number of points projected in the octree (clamped to INT_MAX - see getNumberOfProjectedPoints)
 	**/
 	int build(	const CCVector3& octreeMin,
 				const CCVector3& octreeMax,
@@ -461,12 +463,26 @@ public:
 				const CCVector3* pointsMaxFilter = nullptr,
 				GenericProgressCallback* progressCb = nullptr);
 
+	//! Updates the structure after points have been appended to the associated cloud
+	/** The new points (i.e. the points with an index >= firstPointIndex) are projected
+		and sorted on their own, then merged with the existing (sorted) structure.
+		The points bounding-box is extended to the new points. If some of them lie
+		outside of the octree bounding-box, the octree is rebuilt from scratch.
+		If the octree has been built with user-defined boundaries (see the second
+		version of DgmOctree::build), the boundaries are kept as is and the new
+		points are filtered the same way.
+		\param firstPointIndex index of the first new point in the associated cloud
+		\param progressCb the client application can get some notification of the process progress through this callback mechanism (see GenericProgressCallback)
+		\return the number of points projected in the octree (clamped to INT_MAX - see getNumberOfProjectedPoints)
+	**/
+	virtual int appendPoints(PointIndexType firstPointIndex, GenericProgressCallback* progressCb = nullptr);
+
 	/**** GETTERS ****/
 
 	//! Returns the number of points projected into the octree
 	/** \return the number of projected points
 	**/
-	inline unsigned getNumberOfProjectedPoints() const { return m_numberOfProjectedPoints; }
+	inline PointIndexType getNumberOfProjectedPoints() const { return m_numberOfProjectedPoints; }
 
 	//! Returns the lower boundaries of the octree
 	/** \return the lower coordinates along X,Y and Z
@@ -548,7 +564,7 @@ public:
 		\return success
 	**/
 	bool getPointsInCellByCellIndex(ReferenceCloud* cloud,
-									unsigned cellIndex,
+									PointIndexType cellIndex,
 									unsigned char level,
 									bool clearOutputCloud = true) const;
 
@@ -642,6 +658,74 @@ public:
 												double radius,
 												bool sortValues = true) const;
 
+	//! Neighbourhoods of a batch of query points (flat/CSR-like storage)
+	/** The neighbours of the i-th query point are stored in 'indexes' and 'squareDistances'
+		between offsets[i] (included) and offsets[i+1] (excluded).
+	**/
+	struct BatchNeighbourhoods
+	{
+		//! Offsets of each query neighbourhood (size = number of queries + 1)
+		std::vector<std::size_t> offsets;
+		//! Neighbours indexes (in the associated cloud)
+		std::vector<PointIndexType> indexes;
+		//! Neighbours square distances to their query point
+		std::vector<double> squareDistances;
+
+		//! Returns the number of queries
+		inline PointIndexType queryCount() const { return offsets.empty() ? 0 : static_cast<PointIndexType>(offsets.size() - 1); }
+		//! Returns the number of neighbours of a given query point
+		inline std::size_t neighbourCount(PointIndexType queryIndex) const { return offsets[queryIndex + 1] - offsets[queryIndex]; }
+		//! Clears the structure
+		inline void clear() { offsets.clear(); indexes.clear(); squareDistances.clear(); }
+	};
+
+	//! Finds the nearest neighbours of a batch of query points
+	/** Optimized for many queries: the query points are sorted by octree cell so that
+		the queries falling in the same cell share the same neighbour cells visits (see
+		DgmOctree::findNearestNeighborsStartingFromCell). The query points are processed
+		in parallel (if Qt support is enabled).
+		The neighbours of each query point are sorted by increasing distance.
+		\param queryPoints query points
+		\param queryCount number of query points
+		\param maxNumberOfNeighbors the maximal number of neighbours to find for each query point
+		\param level the subdivision level of the octree at which to perform the search
+		\param[out] result neighbourhoods
+		\param maxSearchDist the maximum search distance (ignored if <= 0) - farther neighbours are discarded
+		\param multiThread whether to use multi-threading or not
+		\param progressCb the client method can get some notification of the process progress through this callback mechanism (see GenericProgressCallback)
+		\return success (false if an error occurred or if the process was cancelled)
+	**/
+	bool findNearestNeighborsBatch(	const CCVector3* queryPoints,
+									PointIndexType queryCount,
+									unsigned maxNumberOfNeighbors,
+									unsigned char level,
+									BatchNeighbourhoods& result,
+									double maxSearchDist = 0,
+									bool multiThread = true,
+									GenericProgressCallback* progressCb = nullptr) const;
+
+	//! Finds the neighbours of a batch of query points inside a sphere
+	/** Same principle as DgmOctree::findNearestNeighborsBatch but for a spatially bounded
+		search (see DgmOctree::findNeighborsInASphereStartingFromCell).
+		\param queryPoints query points
+		\param queryCount number of query points
+		\param radius the sphere radius
+		\param level the subdivision level of the octree at which to perform the search (see DgmOctree::findBestLevelForAGivenNeighbourhoodSizeExtraction)
+		\param[out] result neighbourhoods
+		\param sortValues specifies if the neighbours needs to be sorted by their distance to the query point or not
+		\param multiThread whether to use multi-threading or not
+		\param progressCb the client method can get some notification of the process progress through this callback mechanism (see GenericProgressCallback)
+		\return success (false if an error occurred or if the process was cancelled)
+	**/
+	bool findNeighborsInASphereBatch(	const CCVector3* queryPoints,
+										PointIndexType queryCount,
+										double radius,
+										unsigned char level,
+										BatchNeighbourhoods& result,
+										bool sortValues = true,
+										bool multiThread = true,
+										GenericProgressCallback* progressCb = nullptr) const;
+
 public: //extraction of points inside geometrical volumes (sphere, cylinder, box, etc.)
 
 	//deprecated
@@ -926,7 +1010,7 @@ public:	/***** CELLS POSITION HANDLING *****/
 	unsigned char findBestLevelForAGivenCellNumber(unsigned indicativeNumberOfCells) const;
 
 	//! Returns the ith cell code
-	inline const CellCode& getCellCode(unsigned index) const { return m_thePointsAndTheirCellCodes[index].theCode; }
+	inline const CellCode& getCellCode(PointIndexType index) const { return m_thePointsAndTheirCellCodes[index].theCode; }
 
 	//! Returns the list of codes corresponding to the octree cells for a given level of subdivision
 	/** Only the non empty cells are represented in the octree structure.
@@ -1060,7 +1144,9 @@ public:	/***** CELLS POSITION HANDLING *****/
 		number of points, avoiding great loss of performances. The only limitation is when the
 		level of subdivision is deepest level. In this case no more splitting is possible.
 
-		Parallel processing is based on QtConcurrent::map system.
+		Parallel processing relies on a private pool of threads that steal cells from each
+		other. This method is reentrant: several traversals (of the same octree or of
+		different ones) can run at the same time.
 
 		\param startingLevel the initial level of subdivision
 		\param func the function to apply
@@ -1070,7 +1156,7 @@ public:	/***** CELLS POSITION HANDLING *****/
 		\param multiThread whether to use parallel processing or not
 		\param progressCb the client application can get some notification of the process progress through this callback mechanism (see GenericProgressCallback)
 		\param functionTitle function title
-		\param maxThreadCount the maximum number of threads to use (0 = all). Ignored if 'multiThread' is false.
+		\param maxThreadCount the maximum number of threads to use, the calling thread included (0 = all). Ignored if 'multiThread' is false.
 		\return the number of processed cells (or 0 is something went wrong)
 	**/
 	unsigned executeFunctionForAllCellsStartingAtLevel(	unsigned char startingLevel,
@@ -1087,7 +1173,9 @@ public:	/***** CELLS POSITION HANDLING *****/
 	/** The function to apply should be of the form DgmOctree::octreeCellFunc. In this case
 		the octree cells are scanned one by one at the same level of subdivision.
 
-		Parallel processing is based on QtConcurrent::map system.
+		Parallel processing relies on a private pool of threads that steal cells from each
+		other. This method is reentrant: several traversals (of the same octree or of
+		different ones) can run at the same time.
 
 		\param level the level of subdivision
 		\param func the function to apply
@@ -1095,7 +1183,7 @@ public:	/***** CELLS POSITION HANDLING *****/
 		\param multiThread whether to use parallel processing or not
 		\param progressCb the client application can get some notification of the process progress through this callback mechanism (see GenericProgressCallback)
 		\param functionTitle function title
-		\param maxThreadCount the maximum number of threads to use (0 = all). Ignored if 'multiThread' is false.
+		\param maxThreadCount the maximum number of threads to use, the calling thread included (0 = all). Ignored if 'multiThread' is false.
 		\return the number of processed cells (or 0 is something went wrong)
 	**/
 	unsigned executeFunctionForAllCellsAtLevel(	unsigned char level,
@@ -1164,10 +1252,10 @@ protected:
 	GenericIndexedCloudPersist* m_theAssociatedCloud;
 
 	//! Number of points projected in the octree
-	unsigned m_numberOfProjectedPoints;
+	PointIndexType m_numberOfProjectedPoints;
 	
 	//! Nearest power of 2 less than the number of points (used for binary search)
-	unsigned m_nearestPow2;
+	PointIndexType m_nearestPow2;
 
 	//! Min coordinates of the octree bounding-box
 	CCVector3 m_dimMin;
@@ -1178,6 +1266,8 @@ protected:
 	CCVector3 m_pointsMin;
 	//! Max coordinates of the bounding-box of the set of points projected in the octree
 	CCVector3 m_pointsMax;
+	//! Whether the octree and points boxes are user-defined (see the second version of DgmOctree::build)
+	bool m_userDefinedBoxes;
 
 	//! Cell dimensions for all subdivision levels
 	PointCoordinateType m_cellSize[MAX_OCTREE_LEVEL+2];
@@ -1186,7 +1276,7 @@ protected:
 	//! Number of cells per level of subdivision
 	unsigned m_cellCount[MAX_OCTREE_LEVEL+1];
 	//! Max cell population per level of subdivision
-	unsigned m_maxCellPopulation[MAX_OCTREE_LEVEL+1];
+	PointIndexType m_maxCellPopulation[MAX_OCTREE_LEVEL+1];
 	//! Average cell population per level of subdivision
 	double m_averageCellPopulation[MAX_OCTREE_LEVEL+1];
 	//! Std. dev. of cell population per level of subdivision
@@ -1198,10 +1288,46 @@ protected:
 
 	//! Generic method to build the octree structure
 	/** \param progressCb the client application can get some notification of the process progress through this callback mechanism (see GenericProgressCallback)
-		\return the number of points projected in the octree
+		\return the number of points projected in the octree (clamped to INT_MAX - see getNumberOfProjectedPoints)
 	**/
 	int genericBuild(GenericProgressCallback* progressCb = nullptr);
 
+	//! Computes the cell codes (at the deepest level) of a range of points
+	/** Points falling outside of the 'points' bounding-box are skipped. Computation
+		is done in parallel if possible.
+		\param firstPointIndex index of the first point to project
+		\param lastPointIndex index of the last point to project (excluded)
+		\param codes output codes (should be already allocated with enough space)
+		\param fillIndexes min and max cell indexes at the deepest level (output)
+		\param nprogress optional progress notification (one step per point)
+		\param[out] projectedCount the number of projected points (stored at the beginning of 'codes')
+		\return false if the process has been cancelled
+	**/
+	bool projectPoints(	PointIndexType firstPointIndex,
+						PointIndexType lastPointIndex,
+						cellsContainer& codes,
+						int fillIndexes[6],
+						NormalizedProgress* nprogress,
+						PointIndexType& projectedCount) const;
+
+	//! Sorts a set of cells by ascending code order
+	/** Relies on a multi-threaded LSD radix sort if possible (requires a temporary buffer
+		as large as the input set) or on ParallelSort otherwise.
+	**/
+	static void SortCellCodes(cellsContainer& codes);
+
+	//! Updates the 'fill indexes' of the lower levels from the deepest level
+	void updateFillIndexes();
+
+	//! Sorts a batch of query points by cell code
+	/** Query points lying outside of the octree are associated to the nearest cell.
+		\warning may throw std::bad_alloc
+		\param queryPoints query points
+		\param queryCount number of query points
+		\param sortedQueries query indexes and cell codes (at the deepest level) sorted by ascending code order
+	**/
+	void sortQueriesByCellCode(const CCVector3* queryPoints, PointIndexType queryCount, cellsContainer& sortedQueries) const;
+
 	//! Updates the tables containing octree limits and boundaries
 	void updateMinAndMaxTables();
 
@@ -1254,7 +1380,7 @@ protected:
 		\param bitDec binary shift corresponding to the level of subdivision (see GET_BIT_SHIFT)
 		\return the index of the cell (or 'm_numberOfProjectedPoints' if none found)
 	**/
-	unsigned getCellIndex(CellCode truncatedCellCode, unsigned char bitDec) const;
+	PointIndexType getCellIndex(CellCode truncatedCellCode, unsigned char bitDec) const;
 
 	//! Returns the index of a given cell represented by its code
 	/** Same algorithm as the other "getCellIndex" method, but in an optimized form.
@@ -1265,7 +1391,7 @@ protected:
 		\param end last index of the sub-list in which to perform the binary search
 		\return the index of the cell (or 'm_numberOfProjectedPoints' if none found)
 	**/
-	unsigned getCellIndex(CellCode truncatedCellCode, unsigned char bitDec, unsigned begin, unsigned end) const;
+	PointIndexType getCellIndex(CellCode truncatedCellCode, unsigned char bitDec, PointIndexType begin, PointIndexType end) const;
 };
 
 }
@@ -36,10 +36,10 @@ public:
 	/** \param associatedSet associated NeighboursSet
 		\param count number of values to use (0 = all)
 	**/
-	DgmOctreeReferenceCloud(DgmOctree::NeighboursSet* associatedSet, unsigned count = 0);
+	DgmOctreeReferenceCloud(DgmOctree::NeighboursSet* associatedSet, PointIndexType count = 0);
 
 	//**** inherited form GenericCloud ****//
-	inline unsigned size() const override { return m_size; }
+	inline PointIndexType size() const override { return m_size; }
 	void forEach(genericPointAction action) override;
 	void getBoundingBox(CCVector3& bbMin, CCVector3& bbMax) override;
 	//virtual unsigned char testVisibility(const CCVector3& P) const; //not supported
@@ -47,13 +47,13 @@ public:
 	inline const CCVector3* getNextPoint() override { return (m_globalIterator < size() ? m_set->at(m_globalIterator++).point : nullptr); }
 	inline bool enableScalarField() override { return true; } //use DgmOctree::PointDescriptor::squareDistd by default
 	inline bool isScalarFieldEnabled() const override { return true; } //use DgmOctree::PointDescriptor::squareDistd by default
-	inline void setPointScalarValue(unsigned pointIndex, ScalarType value) override { assert(pointIndex < size()); m_set->at(pointIndex).squareDistd = static_cast<double>(value); }
-	inline ScalarType getPointScalarValue(unsigned pointIndex) const override { assert(pointIndex < size()); return static_cast<ScalarType>(m_set->at(pointIndex).squareDistd); }
+	inline void setPointScalarValue(PointIndexType pointIndex, ScalarType value) override { assert(pointIndex < size()); m_set->at(pointIndex).squareDistd = static_cast<double>(value); }
+	inline ScalarType getPointScalarValue(PointIndexType pointIndex) const override { assert(pointIndex < size()); return static_cast<ScalarType>(m_set->at(pointIndex).squareDistd); }
 	//**** inherited form GenericIndexedCloud ****//
-	inline const CCVector3* getPoint(unsigned index) override { assert(index < size()); return m_set->at(index).point; }
-	inline void getPoint(unsigned index, CCVector3& P) const override { assert(index < size()); P = *m_set->at(index).point; }
+	inline const CCVector3* getPoint(PointIndexType index) override { assert(index < size()); return m_set->at(index).point; }
+	inline void getPoint(PointIndexType index, CCVector3& P) const override { assert(index < size()); P = *m_set->at(index).point; }
 	//**** inherited form GenericIndexedCloudPersist ****//
-	inline const CCVector3* getPointPersistentPtr(unsigned index) override { assert(index < size()); return m_set->at(index).point; }
+	inline const CCVector3* getPointPersistentPtr(PointIndexType index) override { assert(index < size()); return m_set->at(index).point; }
 
 	//! Forwards global iterator
 	inline void forwardIterator() { ++m_globalIterator; }
@@ -64,7 +64,7 @@ protected:
 	virtual void computeBB();
 
 	//! Iterator on the point references container
-	unsigned m_globalIterator;
+	PointIndexType m_globalIterator;
 
 	//! Bounding-box min corner
 	CCVector3 m_bbMin;
@@ -77,7 +77,7 @@ protected:
 	DgmOctree::NeighboursSet* m_set;
 
 	//! Number of points
-	unsigned m_size;
+	PointIndexType m_size;
 };
 
 }
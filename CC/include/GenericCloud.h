@@ -28,6 +28,8 @@
 namespace CCLib
 {
 
+struct PointsSpan;
+
 //! A generic 3D point cloud interface for data communication between library and client applications
 class CC_CORE_LIB_API GenericCloud
 {
@@ -47,7 +49,7 @@ public:
 	/**	Virtual method to request the cloud size
 		\return the cloud size
 	**/
-	virtual unsigned size() const = 0;
+	virtual PointIndexType size() const = 0;
 
 	//! Fast iteration mechanism
 	/**	Virtual method to apply a function to the whole cloud
@@ -92,6 +94,14 @@ public:
 	**/
 	virtual const CCVector3* getNextPoint() = 0;
 
+	//! Returns a direct view on the points coordinates (if possible)
+	/**	Lets the core algorithms bypass the virtual accessors when the points
+		are stored contiguously in memory (see ForEachPoint in PointsSpan.h).
+		\param span output view (only valid as long as the cloud is not modified)
+		\return whether the points can be accessed directly (default: false)
+	**/
+	virtual bool getPointsSpan(PointsSpan& span) const { (void)span; return false; }
+
 	//!	Enables the scalar field associated to the cloud
 	/** If the scalar field structure is not yet initialized/allocated,
 		this method gives the signal for its creation. Otherwise, if possible
@@ -104,10 +114,10 @@ public:
 	virtual bool isScalarFieldEnabled() const = 0;
 
 	//! Sets the ith point associated scalar value
-	virtual void setPointScalarValue(unsigned pointIndex, ScalarType value) = 0;
+	virtual void setPointScalarValue(PointIndexType pointIndex, ScalarType value) = 0;
 
 	//! Returns the ith point associated scalar value
-	virtual ScalarType getPointScalarValue(unsigned pointIndex) const = 0;
+	virtual ScalarType getPointScalarValue(PointIndexType pointIndex) const = 0;
 };
 
 }
@@ -76,6 +76,47 @@ public:
 											GenericProgressCallback* progressCb = nullptr,
 											DgmOctree* inputOctree = nullptr);
 
+	//! Description of a characteristic to compute with ComputeCharacteristics
+	struct CharacteristicDesc
+	{
+		//! Default constructor
+		CharacteristicDesc(GeomCharacteristic c, int option, PointCoordinateType r, ScalarField* outputSF = nullptr)
+			: charac(c)
+			, subOption(option)
+			, radius(r)
+			, sf(outputSF)
+		{}
+
+		//! Geometric characteristic (ApproxLocalDensity is not supported)
+		GeomCharacteristic charac;
+		//! Feature / curvature type / local density computation algorithm or nothing (0)
+		int subOption;
+		//! Neighbouring sphere radius
+		PointCoordinateType radius;
+		//! Output scalar field (same size as the cloud)
+		/** If not set, the values are stored in the cloud 'current' scalar field
+			(only one characteristic can use it).
+		**/
+		ScalarField* sf;
+	};
+
+	//! Computes several geometric characteristics at once
+	/** Characteristics can be computed at different radii. The neighbourhood of each point
+		is only extracted once (with the largest radius). The neighbours are then sorted by
+		distance so that the smaller neighbourhoods are simply prefixes of the largest one.
+		The covariance matrix and its eigen values are only computed once per point and per
+		radius, whatever the number of (eigen-based) features.
+		\param characteristics characteristics to compute (with their output scalar fields)
+		\param cloud cloud to compute the characteristics on
+		\param progressCb client application can get some notification of the process progress through this callback mechanism (see GenericProgressCallback)
+		\param inputOctree if not set as input, octree will be automatically computed.
+		\return success (0) or error code (<0)
+	**/
+	static ErrorCode ComputeCharacteristics(const std::vector<CharacteristicDesc>& characteristics,
+											GenericIndexedCloudPersist* cloud,
+											GenericProgressCallback* progressCb = nullptr,
+											DgmOctree* inputOctree = nullptr);
+
 	//! Computes the local density (approximate)
 	/** Old method (based only on the distance to the nearest neighbor).
 		\warning As only one neighbor is extracted, the DENSITY_KNN type corresponds in fact to the (inverse) distance to the nearest neighbor.
@@ -202,12 +243,12 @@ public:
 
 protected:
 
-	//! Computes geom characteristic inside a cell
+	//! Computes several geom characteristics inside a cell
 	/**	\param cell structure describing the cell on which processing is applied
 		\param additionalParameters see method description
 		\param nProgress optional (normalized) progress notification (per-point)
 	**/
-	static bool ComputeGeomCharacteristicAtLevel(	const DgmOctree::octreeCell& cell,
+	static bool ComputeGeomCharacteristicsAtLevel(	const DgmOctree::octreeCell& cell,
 													void** additionalParameters,
 													NormalizedProgress* nProgress = nullptr);
 	//! Computes approximate point density inside a cell
@@ -351,7 +351,7 @@ public:
 		CCVector3 halfCellDimensions(cellLength / 2, cellLength / 2, cellLength / 2);
 
 		//number of points
-		unsigned numberOfPoints = cloud->size();
+		PointIndexType numberOfPoints = cloud->size();
 
 		//progress notification
 		NormalizedProgress nProgress(progressCb, numberOfPoints);
@@ -360,7 +360,7 @@ public:
 			if (progressCb->textCanBeEdited())
 			{
 				char buffer[64];
-				sprintf(buffer, "Points: %u", numberOfPoints);
+				sprintf(buffer, "Points: %llu", static_cast<unsigned long long>(numberOfPoints));
 				progressCb->setInfo(buffer);
 				progressCb->setMethodTitle("Intersect Grid/Cloud");
 			}
@@ -370,7 +370,7 @@ public:
 
 		//for each point: look for the intersecting cell
 		cloud->placeIteratorAtBeginning();
-		for (unsigned n = 0; n<numberOfPoints; ++n)
+		for (PointIndexType n = 0; n<numberOfPoints; ++n)
 		{
 			CCVector3 P = *cloud->getNextPoint() - gridMinCorner;
 			Tuple3i cellPos(std::min(static_cast<int>(P.x / cellLength), static_cast<int>(size().x) - 1),
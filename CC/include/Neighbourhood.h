@@ -23,6 +23,7 @@
 #include "CCMiscTools.h"
 #include "GenericIndexedCloudPersist.h"
 #include "SquareMatrix.h"
+#include "SymmetricMatrix3.h"
 
 
 namespace CCLib
@@ -43,7 +44,8 @@ class CC_CORE_LIB_API Neighbourhood
 		enum GeomElement {		FLAG_DEPRECATED			= 0,
 								FLAG_GRAVITY_CENTER		= 1,
 								FLAG_LS_PLANE			= 2,
-								FLAG_QUADRIC			= 4 };
+								FLAG_QUADRIC			= 4,
+								FLAG_EIGEN				= 8 };
 
 		//! Curvature type
 		enum CurvatureType {	GAUSSIAN_CURV = 1,
@@ -95,7 +97,7 @@ class CC_CORE_LIB_API Neighbourhood
 															bool useOXYasBase = false)
 		{
 			//need at least one point ;)
-			unsigned count = (m_associatedCloud ? m_associatedCloud->size() : 0);
+			PointIndexType count = (m_associatedCloud ? m_associatedCloud->size() : 0);
 			if (!count)
 				return false;
 
@@ -137,7 +139,7 @@ class CC_CORE_LIB_API Neighbourhood
 			}
 
 			//project the points
-			for (unsigned i = 0; i < count; ++i)
+			for (PointIndexType i = 0; i < count; ++i)
 			{
 				//we recenter current point
 				const CCVector3 P = *m_associatedCloud->getPoint(i) - G;
@@ -266,8 +268,28 @@ class CC_CORE_LIB_API Neighbourhood
 		bool compute3DQuadric(double quadricEquation[10]);
 
 		//! Computes the covariance matrix
+		/** \warning Allocates memory: prefer computeCovarianceMatrix3x3 in per-point processes
+		**/
 		CCLib::SquareMatrixd computeCovarianceMatrix();
 
+		//! Computes the covariance matrix (fixed size version, no memory allocation)
+		CCLib::SymmetricMatrix3d computeCovarianceMatrix3x3();
+
+		//! Returns the eigen values of the covariance matrix
+		/** Returns an array of 3 values, sorted in decreasing order. They are only computed
+			once and shared by all the eigen-based features (see computeFeature,
+			computeMomentOrder1, computeCurvature, getLSPlane, etc.).
+			\return 0 if computation failed
+		**/
+		const double* getEigenValues();
+
+		//! Returns the eigen vectors of the covariance matrix
+		/** Returns an array of 3 unit vectors, in the same order as the eigen values
+			(see getEigenValues).
+			\return 0 if computation failed
+		**/
+		const CCVector3d* getEigenVectors();
+
 		//! Returns the set 'radius' (i.e. the distance between the gravity center and the its farthest point)
 		PointCoordinateType computeLargestRadius();
 
@@ -302,6 +324,16 @@ class CC_CORE_LIB_API Neighbourhood
 		**/
 		CCVector3 m_gravityCenter;
 		
+		//! Eigen values of the covariance matrix (sorted in decreasing order)
+		/** Only valid if 'structuresValidity & EIGEN != 0'.
+		**/
+		double m_eigValues[3];
+
+		//! Eigen vectors of the covariance matrix (same order as m_eigValues)
+		/** Only valid if 'structuresValidity & EIGEN != 0'.
+		**/
+		CCVector3d m_eigVectors[3];
+
 		//! Geometrical elements validity (flags)
 		unsigned char m_structuresValidity;
 
@@ -311,6 +343,8 @@ class CC_CORE_LIB_API Neighbourhood
 		bool computeLeastSquareBestFittingPlane();
 		//! Computes best fitting 2.5D quadric
 		bool computeQuadric();
+		//! Computes the (sorted) eigen values and vectors of the covariance matrix
+		bool computeEigenValuesAndVectors();
 
 		//! Associated cloud
 		GenericIndexedCloudPersist* m_associatedCloud;
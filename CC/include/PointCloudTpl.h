@@ -22,6 +22,7 @@
 //Local
 #include "BoundingBox.h"
 #include "GenericIndexedCloudPersist.h"
+#include "PointsSpan.h"
 #include "ScalarField.h"
 
 //STL
@@ -53,7 +54,7 @@ namespace CCLib
 			deleteAllScalarFields();
 		}
 
-		inline unsigned size() const override { return static_cast<unsigned>(m_points.size()); }
+		inline PointIndexType size() const override { return static_cast<PointIndexType>(m_points.size()); }
 
 		void forEach(GenericCloud::genericPointAction action) override
 		{
@@ -65,8 +66,8 @@ namespace CCLib
 				return;
 			}
 
-			unsigned n = size();
-			for (unsigned i = 0; i < n; ++i)
+			PointIndexType n = size();
+			for (PointIndexType i = 0; i < n; ++i)
 			{
 				action(m_points[i], (*currentOutScalarFieldArray)[i]);
 			}
@@ -90,6 +91,12 @@ namespace CCLib
 		void placeIteratorAtBeginning() override { m_currentPointIndex = 0; }
 		
 		const CCVector3* getNextPoint() override { return (m_currentPointIndex < m_points.size() ? point(m_currentPointIndex++) : 0); }
+
+		bool getPointsSpan(PointsSpan& span) const override
+		{
+			span = PointsSpan(m_points.data(), size());
+			return true;
+		}
 		
 		bool enableScalarField() override
 		{
@@ -138,7 +145,7 @@ namespace CCLib
 			return (sfValuesCount != 0 && sfValuesCount >= m_points.size());
 		}
 
-		void setPointScalarValue(unsigned pointIndex, ScalarType value) override
+		void setPointScalarValue(PointIndexType pointIndex, ScalarType value) override
 		{
 			assert(m_currentInScalarFieldIndex >= 0 && m_currentInScalarFieldIndex < static_cast<int>(m_scalarFields.size()));
 			//slow version
@@ -150,19 +157,19 @@ namespace CCLib
 			m_scalarFields[m_currentInScalarFieldIndex]->setValue(pointIndex, value);
 		}
 		
-		ScalarType getPointScalarValue(unsigned pointIndex) const override
+		ScalarType getPointScalarValue(PointIndexType pointIndex) const override
 		{
 			assert(m_currentOutScalarFieldIndex >= 0 && m_currentOutScalarFieldIndex < static_cast<int>(m_scalarFields.size()));
 
 			return m_scalarFields[m_currentOutScalarFieldIndex]->getValue(pointIndex);
 		}
 
-		inline const CCVector3* getPoint(unsigned index) override { return point(index); }
-		inline const CCVector3* getPoint(unsigned index) const { return point(index); }
-		inline void getPoint(unsigned index, CCVector3& P) const override { P = *point(index); }
+		inline const CCVector3* getPoint(PointIndexType index) override { return point(index); }
+		inline const CCVector3* getPoint(PointIndexType index) const { return point(index); }
+		inline void getPoint(PointIndexType index, CCVector3& P) const override { P = *point(index); }
 
-		inline const CCVector3* getPointPersistentPtr(unsigned index) override { return point(index); }
-		inline const CCVector3* getPointPersistentPtr(unsigned index) const { return point(index); }
+		inline const CCVector3* getPointPersistentPtr(PointIndexType index) override { return point(index); }
+		inline const CCVector3* getPointPersistentPtr(PointIndexType index) const { return point(index); }
 
 		//! Resizes the point database
 		/** The cloud database is resized with the specified size. If the new size
@@ -172,7 +179,7 @@ namespace CCLib
 			\param newNumberOfPoints the new number of points
 			\return true if the method succeeds, false otherwise
 		**/
-		virtual bool resize(unsigned newCount)
+		virtual bool resize(PointIndexType newCount)
 		{
 			std::size_t oldCount = m_points.size();
 
@@ -215,7 +222,7 @@ namespace CCLib
 			\param newNumberOfPoints the new number of points
 			\return true if the method succeeds, false otherwise
 		**/
-		virtual bool reserve(unsigned newCapacity)
+		virtual bool reserve(PointIndexType newCapacity)
 		{
 			//we try to enlarge the 3D points array
 			try
@@ -466,11 +473,11 @@ namespace CCLib
 		}
 
 		//! Returns cloud capacity (i.e. reserved size)
-		inline unsigned capacity() const { return static_cast<unsigned>(m_points.capacity()); }
+		inline PointIndexType capacity() const { return static_cast<PointIndexType>(m_points.capacity()); }
 
 	protected:
 		//! Swaps two points (and their associated scalar values!)
-		virtual void swapPoints(unsigned firstIndex, unsigned secondIndex)
+		virtual void swapPoints(PointIndexType firstIndex, PointIndexType secondIndex)
 		{
 			if (firstIndex == secondIndex
 				|| firstIndex >= m_points.size()
@@ -492,14 +499,14 @@ namespace CCLib
 			\param index point index
 			\return pointer on point stored data
 		**/
-		inline CCVector3* point(unsigned index) { assert(index < size()); return &(m_points[index]); }
+		inline CCVector3* point(PointIndexType index) { assert(index < size()); return &(m_points[index]); }
 
 		//! Returns const access to a given point
 		/** WARNING: index must be valid
 			\param index point index
 			\return pointer on point stored data
 		**/
-		inline const CCVector3* point(unsigned index) const { assert(index < size()); return &(m_points[index]); }
+		inline const CCVector3* point(PointIndexType index) const { assert(index < size()); return &(m_points[index]); }
 
 		//! 3D Points database
 		std::vector<CCVector3> m_points;
@@ -508,7 +515,7 @@ namespace CCLib
 		BoundingBox m_bbox;
 
 		//! 'Iterator' on the points db
-		unsigned m_currentPointIndex;
+		PointIndexType m_currentPointIndex;
 
 		//! Associated scalar fields
 		std::vector<ScalarField*> m_scalarFields;
@@ -0,0 +1,141 @@
+//##########################################################################
+//#                                                                        #
+//#                               CCLIB                                    #
+//#                                                                        #
+//#  This program is free software; you can redistribute it and/or modify  #
+//#  it under the terms of the GNU Library General Public License as       #
+//#  published by the Free Software Foundation; version 2 or later of the  #
+//#  License.                                                              #
+//#                                                                        #
+//#  This program is distributed in the hope that it will be useful,       #
+//#  but WITHOUT ANY WARRANTY; without even the implied warranty of        #
+//#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the          #
+//#  GNU General Public License for more details.                          #
+//#                                                                        #
+//#                    COPYRIGHT: CloudCompare project                     #
+//#                                                                        #
+//##########################################################################
+
+#ifndef CC_POINTS_SPAN_HEADER
+#define CC_POINTS_SPAN_HEADER
+
+//Local
+#include "GenericIndexedCloud.h"
+
+//System
+#include <cstddef>
+
+namespace CCLib
+{
+
+//! Direct (read-only) view on the points of a cloud
+/** The points coordinates are stored contiguously in memory. If 'indexes' is
+	defined, the ith point of the view is points[indexes[i * indexStride]]
+	(e.g. a subset of a cloud). Otherwise it's simply points[i].
+	See GenericCloud::getPointsSpan.
+	\warning The view is only valid as long as the cloud is not modified
+**/
+struct PointsSpan
+{
+	//! Default constructor (empty view)
+	PointsSpan()
+		: points(nullptr)
+		, indexes(nullptr)
+		, indexStride(1)
+		, count(0)
+	{}
+
+	//! Constructor
+	PointsSpan(const CCVector3* _points, PointIndexType _count, const PointIndexType* _indexes = nullptr, std::size_t _indexStride = 1)
+		: points(_points)
+		, indexes(_indexes)
+		, indexStride(_indexStride)
+		, count(_count)
+	{}
+
+	//! Returns the ith point of the view
+	inline const CCVector3& operator[](PointIndexType i) const { return indexes ? points[indexes[i * indexStride]] : points[i]; }
+
+	//! Points coordinates
+	const CCVector3* points;
+	//! Indexes of the points (optional)
+	const PointIndexType* indexes;
+	//! Step between two consecutive indexes (in number of indexes)
+	std::size_t indexStride;
+	//! Number of points in the view
+	PointIndexType count;
+};
+
+//! Applies a function to all the points of a span
+/** The test on the presence of indexes is done once, so that the
+	function can be inlined (and vectorized) in a plain loop.
+	\param span points span
+	\param func function or functor called as func(PointIndexType i, const CCVector3& P)
+**/
+template <class Function> inline void ForEachPoint(const PointsSpan& span, Function&& func)
+{
+	if (span.indexes)
+	{
+		const PointIndexType* index = span.indexes;
+		for (PointIndexType i = 0; i < span.count; ++i, index += span.indexStride)
+		{
+			func(i, span.points[*index]);
+		}
+	}
+	else
+	{
+		for (PointIndexType i = 0; i < span.count; ++i)
+		{
+			func(i, span.points[i]);
+		}
+	}
+}
+
+//! Applies a function to all the points of a cloud (read-only)
+/** Uses the points span of the cloud if available (see GenericCloud::getPointsSpan)
+	and the cloud global iterator otherwise.
+	\param cloud input cloud
+	\param func function or functor called as func(PointIndexType i, const CCVector3& P)
+**/
+template <class Function> inline void ForEachPoint(GenericCloud* cloud, Function&& func)
+{
+	PointsSpan span;
+	if (cloud->getPointsSpan(span))
+	{
+		ForEachPoint(span, func);
+		return;
+	}
+
+	cloud->placeIteratorAtBeginning();
+	PointIndexType i = 0;
+	for (const CCVector3* P = cloud->getNextPoint(); P; P = cloud->getNextPoint(), ++i)
+	{
+		func(i, *P);
+	}
+}
+
+//! Applies a function to all the points of an indexed cloud (read-only)
+/** Uses the points span of the cloud if available (see GenericCloud::getPointsSpan)
+	and GenericIndexedCloud::getPoint otherwise (the cloud global iterator is left untouched).
+	\param cloud input cloud
+	\param func function or functor called as func(PointIndexType i, const CCVector3& P)
+**/
+template <class Function> inline void ForEachPoint(GenericIndexedCloud* cloud, Function&& func)
+{
+	PointsSpan span;
+	if (cloud->getPointsSpan(span))
+	{
+		ForEachPoint(span, func);
+		return;
+	}
+
+	PointIndexType count = cloud->size();
+	for (PointIndexType i = 0; i < count; ++i)
+	{
+		func(i, *cloud->getPoint(i));
+	}
+}
+
+}
+
+#endif //CC_POINTS_SPAN_HEADER
@@ -48,28 +48,31 @@ public:
 	~ReferenceCloud() override = default;
 
 	//**** inherited form GenericCloud ****//
-	inline unsigned size() const override { return static_cast<unsigned>(m_theIndexes.size()); }
+	inline PointIndexType size() const override { return static_cast<PointIndexType>(m_theIndexes.size()); }
 	void forEach(genericPointAction action) override;
 	void getBoundingBox(CCVector3& bbMin, CCVector3& bbMax) override;
 	inline unsigned char testVisibility(const CCVector3& P) const override { assert(m_theAssociatedCloud); return m_theAssociatedCloud->testVisibility(P); }
 	inline void placeIteratorAtBeginning() override { m_globalIterator = 0; }
 	inline const CCVector3* getNextPoint() override { assert(m_theAssociatedCloud); return (m_globalIterator < size() ? m_theAssociatedCloud->getPoint(m_theIndexes[m_globalIterator++]) : nullptr); }
+	bool getPointsSpan(PointsSpan& span) const override;
 	inline bool enableScalarField() override { assert(m_theAssociatedCloud); return m_theAssociatedCloud->enableScalarField(); }
 	inline bool isScalarFieldEnabled() const override { assert(m_theAssociatedCloud); return m_theAssociatedCloud->isScalarFieldEnabled(); }
-	inline void setPointScalarValue(unsigned pointIndex, ScalarType value) override { assert(m_theAssociatedCloud && pointIndex < size()); m_theAssociatedCloud->setPointScalarValue(m_theIndexes[pointIndex], value); }
-	inline ScalarType getPointScalarValue(unsigned pointIndex) const override { assert(m_theAssociatedCloud && pointIndex < size()); return m_theAssociatedCloud->getPointScalarValue(m_theIndexes[pointIndex]); }
+	inline void setPointScalarValue(PointIndexType pointIndex, ScalarType value) override { assert(m_theAssociatedCloud && pointIndex < size()); m_theAssociatedCloud->setPointScalarValue(m_theIndexes[pointIndex], value); }
+	inline ScalarType getPointScalarValue(PointIndexType pointIndex) const override { assert(m_theAssociatedCloud && pointIndex < size()); return m_theAssociatedCloud->getPointScalarValue(m_theIndexes[pointIndex]); }
 
 	//**** inherited form GenericIndexedCloud ****//
-	inline const CCVector3* getPoint(unsigned index) override { assert(m_theAssociatedCloud && index < size()); return m_theAssociatedCloud->getPoint(m_theIndexes[index]); }
-	inline void getPoint(unsigned index, CCVector3& P) const override { assert(m_theAssociatedCloud && index < size()); m_theAssociatedCloud->getPoint(m_theIndexes[index], P); }
+	inline const CCVector3* getPoint(PointIndexType index) override { assert(m_theAssociatedCloud && index < size()); return m_theAssociatedCloud->getPoint(m_theIndexes[index]); }
+	inline void getPoint(PointIndexType index, CCVector3& P) const override { assert(m_theAssociatedCloud && index < size()); m_theAssociatedCloud->getPoint(m_theIndexes[index], P); }
+	inline bool normalsAvailable() const override { return m_theAssociatedCloud && m_theAssociatedCloud->normalsAvailable(); }
+	inline const CCVector3* getNormal(PointIndexType index) const override { assert(m_theAssociatedCloud && index < size()); return m_theAssociatedCloud->getNormal(m_theIndexes[index]); }
 
 	//**** inherited form GenericIndexedCloudPersist ****//
-	inline const CCVector3* getPointPersistentPtr(unsigned index) override { assert(m_theAssociatedCloud && index < size()); return m_theAssociatedCloud->getPointPersistentPtr(m_theIndexes[index]); }
+	inline const CCVector3* getPointPersistentPtr(PointIndexType index) override { assert(m_theAssociatedCloud && index < size()); return m_theAssociatedCloud->getPointPersistentPtr(m_theIndexes[index]); }
 
 	//! Returns global index (i.e. relative to the associated cloud) of a given element
 	/** \param localIndex local index (i.e. relative to the internal index container)
 	**/
-	inline virtual unsigned getPointGlobalIndex(unsigned localIndex) const { return m_theIndexes[localIndex]; }
+	inline virtual PointIndexType getPointGlobalIndex(PointIndexType localIndex) const { return m_theIndexes[localIndex]; }
 
 	//! Returns the coordinates of the point pointed by the current element
 	/** Returns a persistent pointer.
@@ -77,7 +80,7 @@ public:
 	virtual const CCVector3* getCurrentPointCoordinates() const;
 
 	//! Returns the global index of the point pointed by the current element
-	inline virtual unsigned getCurrentPointGlobalIndex() const { assert(m_globalIterator < size()); return m_theIndexes[m_globalIterator]; }
+	inline virtual PointIndexType getCurrentPointGlobalIndex() const { assert(m_globalIterator < size()); return m_theIndexes[m_globalIterator]; }
 
     //! Returns the current point associated scalar value
 	inline virtual ScalarType getCurrentPointScalarValue() const { assert(m_theAssociatedCloud && m_globalIterator<size()); return m_theAssociatedCloud->getPointScalarValue(m_theIndexes[m_globalIterator]); }
@@ -95,33 +98,33 @@ public:
 	/** \param globalIndex a point global index
 		\return false if not enough memory
 	**/
-	virtual bool addPointIndex(unsigned globalIndex);
+	virtual bool addPointIndex(PointIndexType globalIndex);
 
 	//! Point global index insertion mechanism (range)
 	/** \param firstIndex first point global index of range
 		\param lastIndex last point global index of range (excluded)
 		\return false if not enough memory
 	**/
-	virtual bool addPointIndex(unsigned firstIndex, unsigned lastIndex);
+	virtual bool addPointIndex(PointIndexType firstIndex, PointIndexType lastIndex);
 
 	//! Sets global index for a given element
 	/** \param localIndex local index
         \param globalIndex global index
 	**/
-	virtual void setPointIndex(unsigned localIndex, unsigned globalIndex);
+	virtual void setPointIndex(PointIndexType localIndex, PointIndexType globalIndex);
 
 	//! Reserves some memory for hosting the point references
 	/** \param n the number of points (references)
 	**/
-	virtual bool reserve(unsigned n);
+	virtual bool reserve(PointIndexType n);
 
 	//! Presets the size of the vector used to store point references
 	/** \param n the number of points (references)
 	**/
-	virtual bool resize(unsigned n);
+	virtual bool resize(PointIndexType n);
 
 	//! Returns max capacity
-	inline virtual unsigned capacity() const { return static_cast<unsigned>(m_theIndexes.capacity()); }
+	inline virtual PointIndexType capacity() const { return static_cast<PointIndexType>(m_theIndexes.capacity()); }
 
 	//! Swaps two point references
 	/** the point references indexes should be smaller than the total
@@ -129,7 +132,7 @@ public:
 		\param i the first point index
 		\param j the second point index
 	**/
-	inline virtual void swap(unsigned i, unsigned j) { std::swap(m_theIndexes[i], m_theIndexes[j]); }
+	inline virtual void swap(PointIndexType i, PointIndexType j) { std::swap(m_theIndexes[i], m_theIndexes[j]); }
 
 	//! Removes current element
 	/** WARNING: this method change the structure size!
@@ -139,7 +142,7 @@ public:
 	//! Removes a given element
 	/** WARNING: this method change the structure size!
 	**/
-	virtual void removePointGlobalIndex(unsigned localIndex);
+	virtual void removePointGlobalIndex(PointIndexType localIndex);
 
     //! Returns the associated (source) cloud
 	inline virtual GenericIndexedCloudPersist* getAssociatedCloud() { return m_theAssociatedCloud; }
@@ -155,7 +158,7 @@ public:
 		- the clouds must have the same reference cloud!
 		- no verification for duplicates!
 	**/
-	bool add(const ReferenceCloud& cloud);
+	virtual bool add(const ReferenceCloud& cloud);
 	
 	//! Invalidates the bounding-box
 	inline void invalidateBoundingBox() { m_bbox.setValidity(false); }
@@ -163,13 +166,13 @@ public:
 protected:
 
 	//! Container of 3D point indexes
-	using ReferencesContainer = std::vector<unsigned int>;
+	using ReferencesContainer = std::vector<PointIndexType>;
 
 	//! Indexes of (some of) the associated cloud points
 	ReferencesContainer m_theIndexes;
 
 	//! Iterator on the point references container
-	unsigned m_globalIterator;
+	PointIndexType m_globalIterator;
 
 	//! Bounding-box
 	BoundingBox m_bbox;
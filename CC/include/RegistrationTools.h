@@ -22,6 +22,8 @@
 //Local
 #include "PointProjectionTools.h"
 
+//System
+#include <vector>
 
 namespace CCLib
 {
@@ -94,6 +96,29 @@ protected:
 										ScalarField* coupleWeights = nullptr,
 										PointCoordinateType aPrioriScale = 1.0f);
 
+	//! ICP Registration procedure (point-to-plane variant)
+	/** Determines the rigid transformation that minimizes the (squared) distances
+		between the points of P and the tangent planes of their equivalent points in X
+		(Chen & Medioni, "Object modelling by registration of multiple range images", 1992).
+		The rotation is linearized (small angles assumption) around the gravity center of P,
+		so that the problem boils down to a 6x6 linear system.
+
+			X = R.P + T
+
+		Warning: P and X must have the same size, and must be in the same
+		order (i.e. P[i] is the point equivalent to X[i] for all 'i').
+
+		\param P the cloud to register (data)
+		\param X the reference cloud (model) - must have normals (the couples without normal use the point-to-point residual)
+		\param trans the resulting transformation
+		\param coupleWeights weights for each (Pi,Xi) couple (optional)
+		\return success
+	**/
+	static bool PointToPlaneRegistrationProcedure(	GenericIndexedCloud* P,
+													GenericIndexedCloud* X,
+													ScaledTransformation& trans,
+													ScalarField* coupleWeights = nullptr);
+
 };
 
 //! Horn point cloud registration algorithm
@@ -157,6 +182,36 @@ public:
 		ICP_ERROR_INVALID_INPUT			= 105,
 	};
 
+	//! Error metric (i.e. what is minimized at each iteration)
+	enum ERROR_METRIC
+	{
+		POINT_TO_POINT	= 0,	/**< Distance between each data point and its closest model point (Besl et al.) **/
+		POINT_TO_PLANE	= 1,	/**< Distance between each data point and the tangent plane of its closest model point (Chen & Medioni) - requires model normals **/
+	};
+
+	//! Per-iteration statistics
+	struct IterationStats
+	{
+		IterationStats()
+			: iteration(0)
+			, rms(0)
+			, pointCount(0)
+			, closestPointsTime_ms(0)
+			, registrationTime_ms(0)
+		{}
+
+		//! Iteration index
+		unsigned iteration;
+		//! Error (RMS) at the beginning of the iteration
+		double rms;
+		//! Number of points used for this iteration
+		unsigned pointCount;
+		//! Time spent to find the closest points (before this iteration)
+		double closestPointsTime_ms;
+		//! Time spent to compute the registration transformation
+		double registrationTime_ms;
+	};
+
 	//! ICP Parameters
 	struct Parameters
 	{
@@ -172,6 +227,8 @@ public:
 			, dataWeights(nullptr)
 			, transformationFilters(SKIP_NONE)
 			, maxThreadCount(0)
+			, errorMetric(POINT_TO_POINT)
+			, iterationStats(nullptr)
 		{}
 
 		//! Convergence type
@@ -206,12 +263,23 @@ public:
 
 		//! Maximum number of threads to use (0 = max)
 		int maxThreadCount;
+
+		//! Error metric
+		/** POINT_TO_PLANE requires a model cloud with normals (see GenericIndexedCloud::normalsAvailable)
+			and doesn't support scale adjustment.
+		**/
+		ERROR_METRIC errorMetric;
+
+		//! Per-iteration statistics (optional output)
+		std::vector<IterationStats>* iterationStats;
 	};
 
 	//! Registers two clouds or a cloud and a mesh
 	/** This method implements the ICP algorithm (Besl et al.).
 		\warning Be sure to activate an INPUT/OUTPUT scalar field on the point cloud.
 		\warning The mesh is always the reference/model entity.
+		If the model entity is a cloud, its search structure (octree) is only computed once, and
+		the closest points of the (moving) data cloud are then searched in parallel at each iteration.
 		\param modelCloud the reference cloud or the vertices of the reference mesh --> won't move
 		\param modelMesh the reference mesh (optional) --> won't move
 		\param dataCloud the cloud to register --> will move
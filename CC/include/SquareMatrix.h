@@ -361,7 +361,7 @@ namespace CCLib
 					//we scale the matrix to make the pivot equal to 1
 					if (tempM[i][i] != 1.0)
 					{
-						const Scalar& tmpVal = tempM[i][i];
+						const Scalar tmpVal = tempM[i][i];
 						for (unsigned k = i; k < 2 * m_matrixSize; ++k)
 							tempM[i][k] /= tmpVal;
 					}
@@ -371,7 +371,7 @@ namespace CCLib
 					{
 						if (tempM[j][i] != 0)
 						{
-							const Scalar& tmpVal = tempM[j][i];
+							const Scalar tmpVal = tempM[j][i];
 							for (unsigned k = i; k < 2 * m_matrixSize; k++)
 								tempM[j][k] -= tempM[i][k] * tmpVal;
 						}
@@ -387,7 +387,7 @@ namespace CCLib
 					{
 						if (tempM[j][i] != 0)
 						{
-							const Scalar& tmpVal = tempM[j][i];
+							const Scalar tmpVal = tempM[j][i];
 							for (unsigned k = i; k < 2 * m_matrixSize; k++)
 								tempM[j][k] -= tempM[i][k] * tmpVal;
 						}
@@ -0,0 +1,287 @@
+//##########################################################################
+//#                                                                        #
+//#                               CCLIB                                    #
+//#                                                                        #
+//#  This program is free software; you can redistribute it and/or modify  #
+//#  it under the terms of the GNU Library General Public License as       #
+//#  published by the Free Software Foundation; version 2 or later of the  #
+//#  License.                                                              #
+//#                                                                        #
+//#  This program is distributed in the hope that it will be useful,       #
+//#  but WITHOUT ANY WARRANTY; without even the implied warranty of        #
+//#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the          #
+//#  GNU General Public License for more details.                          #
+//#                                                                        #
+//#                    COPYRIGHT: CloudCompare project                     #
+//#                                                                        #
+//##########################################################################
+
+#ifndef CC_SYMMETRIC_MATRIX_3_HEADER
+#define CC_SYMMETRIC_MATRIX_3_HEADER
+
+//Local
+#include "CCGeom.h"
+#include "SquareMatrix.h"
+
+//System
+#include <algorithm>
+#include <cmath>
+
+namespace CCLib
+{
+
+//! Symmetric 3x3 matrix (typically a covariance matrix)
+/** Contrary to SquareMatrixTpl, this structure has a fixed size and doesn't
+	allocate any memory. It comes with a non-iterative eigen solver.
+**/
+template <typename Scalar> class SymmetricMatrix3Tpl
+{
+public:
+
+	//! Default constructor (null matrix)
+	SymmetricMatrix3Tpl()
+		: m00(0), m01(0), m02(0)
+		, m11(0), m12(0)
+		, m22(0)
+	{}
+
+	//! Constructor from the upper triangular coefficients
+	SymmetricMatrix3Tpl(Scalar _m00, Scalar _m01, Scalar _m02, Scalar _m11, Scalar _m12, Scalar _m22)
+		: m00(_m00), m01(_m01), m02(_m02)
+		, m11(_m11), m12(_m12)
+		, m22(_m22)
+	{}
+
+	//! Returns the coefficient at a given position
+	Scalar getValue(unsigned row, unsigned column) const
+	{
+		static const unsigned char s_indexes[3][3] = { { 0, 1, 2 }, { 1, 3, 4 }, { 2, 4, 5 } };
+		const Scalar* values = &m00;
+		return values[s_indexes[row][column]];
+	}
+
+	//! Converts this matrix to a (generic) square matrix
+	SquareMatrixTpl<Scalar> toSquareMatrix() const
+	{
+		SquareMatrixTpl<Scalar> M(3);
+		if (M.isValid())
+		{
+			for (unsigned r = 0; r < 3; ++r)
+				for (unsigned c = 0; c < 3; ++c)
+					M.m_values[r][c] = getValue(r, c);
+		}
+		return M;
+	}
+
+	//! Computes the eigen values and eigen vectors of this matrix
+	/** Non-iterative method, robust to the degenerate cases (null matrix, multiple eigen values, etc.).
+		See "A Robust Eigensolver for 3x3 Symmetric Matrices", D. Eberly, 2014.
+		\param[out] eigenValues eigen values, sorted in decreasing order
+		\param[out] eigenVectors corresponding (unit and orthogonal) eigen vectors
+		\return success
+	**/
+	bool computeEigenValuesAndVectors(Scalar eigenValues[3], Vector3Tpl<Scalar> eigenVectors[3]) const
+	{
+		//precondition the matrix by factoring out the maximum absolute value of the components
+		//(this guards against floating-point overflow when computing the eigen values)
+		const Scalar maxAbsElement = std::max(	std::max(std::max(std::abs(m00), std::abs(m01)), std::max(std::abs(m02), std::abs(m11))),
+												std::max(std::abs(m12), std::abs(m22)) );
+		if (maxAbsElement != maxAbsElement) //NaN
+		{
+			return false;
+		}
+
+		if (maxAbsElement == 0)
+		{
+			//null matrix
+			eigenValues[0] = eigenValues[1] = eigenValues[2] = 0;
+			eigenVectors[0] = Vector3Tpl<Scalar>(1, 0, 0);
+			eigenVectors[1] = Vector3Tpl<Scalar>(0, 1, 0);
+			eigenVectors[2] = Vector3Tpl<Scalar>(0, 0, 1);
+			return true;
+		}
+
+		const Scalar invMax = 1 / maxAbsElement;
+		const Scalar a00 = m00 * invMax;
+		const Scalar a01 = m01 * invMax;
+		const Scalar a02 = m02 * invMax;
+		const Scalar a11 = m11 * invMax;
+		const Scalar a12 = m12 * invMax;
+		const Scalar a22 = m22 * invMax;
+
+		Scalar eval[3]; //in increasing order
+		Vector3Tpl<Scalar> evec[3];
+
+		const Scalar norm = a01 * a01 + a02 * a02 + a12 * a12;
+		if (norm > 0)
+		{
+			//eigen values (trigonometric solution of the characteristic polynomial)
+			const Scalar q = (a00 + a11 + a22) / 3;
+			const Scalar b00 = a00 - q;
+			const Scalar b11 = a11 - q;
+			const Scalar b22 = a22 - q;
+			const Scalar p = std::sqrt((b00 * b00 + b11 * b11 + b22 * b22 + 2 * norm) / 6);
+			const Scalar c00 = b11 * b22 - a12 * a12;
+			const Scalar c01 = a01 * b22 - a12 * a02;
+			const Scalar c02 = a01 * a12 - b11 * a02;
+			const Scalar det = (b00 * c00 - a01 * c01 + a02 * c02) / (p * p * p);
+			const Scalar halfDet = std::min(std::max(det / 2, static_cast<Scalar>(-1)), static_cast<Scalar>(1));
+			const Scalar angle = std::acos(halfDet) / 3;
+			static const Scalar s_twoThirdsPi = static_cast<Scalar>(2.09439510239319549);
+			const Scalar beta2 = std::cos(angle) * 2;
+			const Scalar beta0 = std::cos(angle + s_twoThirdsPi) * 2;
+			const Scalar beta1 = -(beta0 + beta2);
+			eval[0] = q + p * beta0;
+			eval[1] = q + p * beta1;
+			eval[2] = q + p * beta2;
+
+			//eigen vectors: the one associated to the most isolated eigen value is computed first
+			if (halfDet >= 0)
+			{
+				ComputeEigenVector0(a00, a01, a02, a11, a12, a22, eval[2], evec[2]);
+				ComputeEigenVector1(a00, a01, a02, a11, a12, a22, evec[2], eval[1], evec[1]);
+				evec[0] = evec[1].cross(evec[2]);
+			}
+			else
+			{
+				ComputeEigenVector0(a00, a01, a02, a11, a12, a22, eval[0], evec[0]);
+				ComputeEigenVector1(a00, a01, a02, a11, a12, a22, evec[0], eval[1], evec[1]);
+				evec[2] = evec[0].cross(evec[1]);
+			}
+		}
+		else
+		{
+			//diagonal matrix
+			eval[0] = a00;
+			eval[1] = a11;
+			eval[2] = a22;
+			evec[0] = Vector3Tpl<Scalar>(1, 0, 0);
+			evec[1] = Vector3Tpl<Scalar>(0, 1, 0);
+			evec[2] = Vector3Tpl<Scalar>(0, 0, 1);
+		}
+
+		//sort the eigen values in decreasing order (and revert the preconditioning)
+		unsigned char order[3] = { 0, 1, 2 };
+		if (eval[order[0]] < eval[order[1]]) std::swap(order[0], order[1]);
+		if (eval[order[1]] < eval[order[2]]) std::swap(order[1], order[2]);
+		if (eval[order[0]] < eval[order[1]]) std::swap(order[0], order[1]);
+		for (unsigned i = 0; i < 3; ++i)
+		{
+			eigenValues[i] = eval[order[i]] * maxAbsElement;
+			eigenVectors[i] = evec[order[i]];
+		}
+
+		return true;
+	}
+
+	//! Upper triangular coefficients
+	Scalar m00, m01, m02, m11, m12, m22;
+
+protected:
+
+	//! Computes the eigen vector associated to a simple eigen value
+	static void ComputeEigenVector0(Scalar a00, Scalar a01, Scalar a02, Scalar a11, Scalar a12, Scalar a22, Scalar eval0, Vector3Tpl<Scalar>& evec0)
+	{
+		//the eigen vector is orthogonal to the rows of (A - eval0.I): we take the most robust cross product
+		const Vector3Tpl<Scalar> row0(a00 - eval0, a01, a02);
+		const Vector3Tpl<Scalar> row1(a01, a11 - eval0, a12);
+		const Vector3Tpl<Scalar> row2(a02, a12, a22 - eval0);
+		const Vector3Tpl<Scalar> r0xr1 = row0.cross(row1);
+		const Vector3Tpl<Scalar> r0xr2 = row0.cross(row2);
+		const Vector3Tpl<Scalar> r1xr2 = row1.cross(row2);
+		const Scalar d0 = r0xr1.norm2();
+		const Scalar d1 = r0xr2.norm2();
+		const Scalar d2 = r1xr2.norm2();
+
+		if (d0 >= d1 && d0 >= d2)
+			evec0 = (d0 > 0 ? r0xr1 / std::sqrt(d0) : Vector3Tpl<Scalar>(1, 0, 0));
+		else if (d1 >= d2)
+			evec0 = r0xr2 / std::sqrt(d1);
+		else
+			evec0 = r1xr2 / std::sqrt(d2);
+	}
+
+	//! Computes the eigen vector associated to the middle eigen value (orthogonal to evec0)
+	static void ComputeEigenVector1(Scalar a00, Scalar a01, Scalar a02, Scalar a11, Scalar a12, Scalar a22, const Vector3Tpl<Scalar>& evec0, Scalar eval1, Vector3Tpl<Scalar>& evec1)
+	{
+		//orthonormal base (U, V) of the plane orthogonal to evec0
+		Vector3Tpl<Scalar> U;
+		if (std::abs(evec0.x) > std::abs(evec0.y))
+		{
+			const Scalar invLength = 1 / std::sqrt(evec0.x * evec0.x + evec0.z * evec0.z);
+			U = Vector3Tpl<Scalar>(-evec0.z * invLength, 0, evec0.x * invLength);
+		}
+		else
+		{
+			const Scalar invLength = 1 / std::sqrt(evec0.y * evec0.y + evec0.z * evec0.z);
+			U = Vector3Tpl<Scalar>(0, evec0.z * invLength, -evec0.y * invLength);
+		}
+		const Vector3Tpl<Scalar> V = evec0.cross(U);
+
+		//restriction of (A - eval1.I) to this plane (2x2 symmetric matrix)
+		const Vector3Tpl<Scalar> AU(a00 * U.x + a01 * U.y + a02 * U.z, a01 * U.x + a11 * U.y + a12 * U.z, a02 * U.x + a12 * U.y + a22 * U.z);
+		const Vector3Tpl<Scalar> AV(a00 * V.x + a01 * V.y + a02 * V.z, a01 * V.x + a11 * V.y + a12 * V.z, a02 * V.x + a12 * V.y + a22 * V.z);
+		Scalar n00 = U.dot(AU) - eval1;
+		Scalar n01 = U.dot(AV);
+		Scalar n11 = V.dot(AV) - eval1;
+
+		const Scalar absN00 = std::abs(n00);
+		const Scalar absN01 = std::abs(n01);
+		const Scalar absN11 = std::abs(n11);
+		if (absN00 >= absN11)
+		{
+			if (std::max(absN00, absN01) > 0)
+			{
+				if (absN00 >= absN01)
+				{
+					n01 /= n00;
+					n00 = 1 / std::sqrt(1 + n01 * n01);
+					n01 *= n00;
+				}
+				else
+				{
+					n00 /= n01;
+					n01 = 1 / std::sqrt(1 + n00 * n00);
+					n00 *= n01;
+				}
+				evec1 = U * n01 - V * n00;
+			}
+			else
+			{
+				//multiple eigen value: any vector of the plane will do
+				evec1 = U;
+			}
+		}
+		else
+		{
+			if (std::max(absN11, absN01) > 0)
+			{
+				if (absN11 >= absN01)
+				{
+					n01 /= n11;
+					n11 = 1 / std::sqrt(1 + n01 * n01);
+					n01 *= n11;
+				}
+				else
+				{
+					n11 /= n01;
+					n01 = 1 / std::sqrt(1 + n11 * n11);
+					n11 *= n01;
+				}
+				evec1 = U * n11 - V * n01;
+			}
+			else
+			{
+				//multiple eigen value: any vector of the plane will do
+				evec1 = U;
+			}
+		}
+	}
+};
+
+//! Default symmetric 3x3 matrix type
+using SymmetricMatrix3d = SymmetricMatrix3Tpl<double>;
+
+} //namespace CCLib
+
+#endif //CC_SYMMETRIC_MATRIX_3_HEADER
@@ -69,7 +69,7 @@ int AutoSegmentationTools::labelConnectedComponents(GenericIndexedCloudPersist*
 
 bool AutoSegmentationTools::extractConnectedComponents(GenericIndexedCloudPersist* theCloud, ReferenceCloudContainer& cc)
 {
-	unsigned numberOfPoints = (theCloud ? theCloud->size() : 0);
+	PointIndexType numberOfPoints = (theCloud ? theCloud->size() : 0);
 	if (numberOfPoints == 0)
 	{
 		return false;
@@ -88,7 +88,7 @@ bool AutoSegmentationTools::extractConnectedComponents(GenericIndexedCloudPersis
 		cc.pop_back();
 	}
 
-	for (unsigned i = 0; i < numberOfPoints; ++i)
+	for (PointIndexType i = 0; i < numberOfPoints; ++i)
 	{
 		ScalarType slabel = theCloud->getPointScalarValue(i);
 		if (slabel >= 1) //labels start from 1! (this test rejects NaN values as well)
@@ -138,7 +138,7 @@ bool AutoSegmentationTools::frontPropagationBasedSegmentation(	GenericIndexedClo
 																bool applyGaussianFilter,
 																float alpha)
 {
-	unsigned numberOfPoints = (theCloud ? theCloud->size() : 0);
+	PointIndexType numberOfPoints = (theCloud ? theCloud->size() : 0);
 	if (numberOfPoints == 0)
 	{
 		return false;
@@ -198,7 +198,7 @@ bool AutoSegmentationTools::frontPropagationBasedSegmentation(	GenericIndexedClo
 		{
 			progressCb->setMethodTitle("FM Propagation");
 			char buffer[256];
-			sprintf(buffer, "Octree level: %i\nNumber of points: %u", octreeLevel, numberOfPoints);
+			sprintf(buffer, "Octree level: %i\nNumber of points: %llu", octreeLevel, static_cast<unsigned long long>(numberOfPoints));
 			progressCb->setInfo(buffer);
 		}
 		progressCb->update(0);
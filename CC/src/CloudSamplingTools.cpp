@@ -24,6 +24,7 @@
 #include <GenericProgressCallback.h>
 #include <Neighbourhood.h>
 #include <PointCloud.h>
+#include <PointsSpan.h>
 #include <ReferenceCloud.h>
 #include <ScalarField.h>
 #include <ScalarFieldTools.h>
@@ -198,7 +199,7 @@ ReferenceCloud* CloudSamplingTools::subsampleCloudRandomly(GenericIndexedCloudPe
 {
 	assert(inputCloud);
 
-	unsigned theCloudSize = inputCloud->size();
+	PointIndexType theCloudSize = inputCloud->size();
 
 	//we put all input points in a ReferenceCloud
 	ReferenceCloud* newCloud = new ReferenceCloud(inputCloud);
@@ -258,7 +259,7 @@ ReferenceCloud* CloudSamplingTools::resampleCloudSpatially(GenericIndexedCloudPe
 															GenericProgressCallback* progressCb/*=0*/)
 {
 	assert(inputCloud);
-	unsigned cloudSize = inputCloud->size();
+	PointIndexType cloudSize = inputCloud->size();
 
 	DgmOctree* octree = inputOctree;
 	if (!octree)
@@ -275,7 +276,7 @@ ReferenceCloud* CloudSamplingTools::resampleCloudSpatially(GenericIndexedCloudPe
 	//output cloud
 	ReferenceCloud* sampledCloud = new ReferenceCloud(inputCloud);
 	const unsigned c_reserveStep = 65536;
-	if (!sampledCloud->reserve(std::min(cloudSize, c_reserveStep)))
+	if (!sampledCloud->reserve(std::min<PointIndexType>(cloudSize, c_reserveStep)))
 	{
 		if (!inputOctree)
 			delete octree;
@@ -362,7 +363,7 @@ ReferenceCloud* CloudSamplingTools::resampleCloudSpatially(GenericIndexedCloudPe
 		{
 			progressCb->setMethodTitle("Spatial resampling");
 			char buffer[256];
-			sprintf(buffer, "Points: %u\nMin dist.: %f", cloudSize, minDistance);
+			sprintf(buffer, "Points: %llu\nMin dist.: %f", static_cast<unsigned long long>(cloudSize), minDistance);
 			progressCb->setInfo(buffer);
 		}
 		progressCb->update(0);
@@ -377,7 +378,7 @@ ReferenceCloud* CloudSamplingTools::resampleCloudSpatially(GenericIndexedCloudPe
 	unsigned char octreeLevel = bestOctreeLevel.front();
 	//default distance between points
 	PointCoordinateType minDistBetweenPoints = minDistance;
-	for (unsigned i = 0; i < cloudSize; i++)
+	for (PointIndexType i = 0; i < cloudSize; i++)
 	{
 		//no mark? we skip this point
 		if (markers[i] != 0)
@@ -497,7 +498,7 @@ ReferenceCloud* CloudSamplingTools::sorFilter(	GenericIndexedCloudPersist* input
 
 	for (unsigned step = 0; step < 1; ++step) //fake loop for easy break
 	{
-		unsigned pointCount = inputCloud->size();
+		PointIndexType pointCount = inputCloud->size();
 
 		std::vector<PointCoordinateType> meanDistances;
 		try
@@ -534,7 +535,7 @@ ReferenceCloud* CloudSamplingTools::sorFilter(	GenericIndexedCloudPersist* input
 			//deduce the average distance and std. dev.
 			double sumDist = 0;
 			double sumSquareDist = 0;
-			for (unsigned i = 0; i < pointCount; ++i)
+			for (PointIndexType i = 0; i < pointCount; ++i)
 			{
 				sumDist += meanDistances[i];
 				sumSquareDist += meanDistances[i] * meanDistances[i];
@@ -557,7 +558,7 @@ ReferenceCloud* CloudSamplingTools::sorFilter(	GenericIndexedCloudPersist* input
 				break;
 			}
 
-			for (unsigned i = 0; i < pointCount; ++i)
+			for (PointIndexType i = 0; i < pointCount; ++i)
 			{
 				if (meanDistances[i] <= maxDist)
 				{
@@ -609,7 +610,7 @@ ReferenceCloud* CloudSamplingTools::noiseFilter(GenericIndexedCloudPersist* inpu
 
 	ReferenceCloud* filteredCloud = new ReferenceCloud(inputCloud);
 
-	unsigned pointCount = inputCloud->size();
+	PointIndexType pointCount = inputCloud->size();
 	if (!filteredCloud->reserve(pointCount))
 	{
 		//not enough memory
@@ -698,12 +699,12 @@ bool CloudSamplingTools::subsampleCellAtLevel(	const DgmOctree::octreeCell& cell
 	ReferenceCloud* cloud						= static_cast<ReferenceCloud*>(additionalParameters[0]);
 	SUBSAMPLING_CELL_METHOD subsamplingMethod	= *static_cast<SUBSAMPLING_CELL_METHOD*>(additionalParameters[1]);
 
-	unsigned selectedPointIndex = 0;
-	unsigned pointsCount = cell.points->size();
+	PointIndexType selectedPointIndex = 0;
+	PointIndexType pointsCount = cell.points->size();
 
 	if (subsamplingMethod == RANDOM_POINT)
 	{
-		selectedPointIndex = (static_cast<unsigned>(rand()) % pointsCount);
+		selectedPointIndex = (static_cast<PointIndexType>(rand()) % pointsCount);
 
 		if (nProgress && !nProgress->steps(pointsCount))
 		{
@@ -715,21 +716,20 @@ bool CloudSamplingTools::subsampleCellAtLevel(	const DgmOctree::octreeCell& cell
 		CCVector3 center;
 		cell.parentOctree->computeCellCenter(cell.truncatedCode,cell.level,center,true);
 
-		PointCoordinateType minSquareDist = (*cell.points->getPoint(0) - center).norm2();
-
-		for (unsigned i=1; i<pointsCount; ++i)
+		PointCoordinateType minSquareDist = -1;
+		ForEachPoint(cell.points, [&](PointIndexType i, const CCVector3& P)
 		{
-			PointCoordinateType squareDist = (*cell.points->getPoint(i) - center).norm2();
-			if (squareDist < minSquareDist)
+			PointCoordinateType squareDist = (P - center).norm2();
+			if (minSquareDist < 0 || squareDist < minSquareDist)
 			{
 				selectedPointIndex = i;
 				minSquareDist = squareDist;
 			}
+		});
 
-			if (nProgress && !nProgress->oneStep())
-			{
-				return false;
-			}
+		if (nProgress && !nProgress->steps(pointsCount))
+		{
+			return false;
 		}
 	}
 
@@ -760,10 +760,10 @@ bool CloudSamplingTools::applyNoiseFilterAtLevel(	const DgmOctree::octreeCell& c
 	cell.parentOctree->getCellPos(cell.truncatedCode, cell.level, nNSS.cellPos, true);
 	cell.parentOctree->computeCellCenter(nNSS.cellPos, cell.level, nNSS.cellCenter);
 
-	unsigned n = cell.points->size(); //number of points in the current cell
+	PointIndexType n = cell.points->size(); //number of points in the current cell
 
 	//for each point in the cell
-	for (unsigned i = 0; i < n; ++i)
+	for (PointIndexType i = 0; i < n; ++i)
 	{
 		cell.points->getPoint(i, nNSS.queryPoint);
 
@@ -779,7 +779,7 @@ bool CloudSamplingTools::applyNoiseFilterAtLevel(	const DgmOctree::octreeCell& c
 		if (neighborCount > 3) //we want 3 points or more (other than the point itself!)
 		{
 			//find the query point in the nearest neighbors set and place it at the end
-			const unsigned globalIndex = cell.points->getPointGlobalIndex(i);
+			const PointIndexType globalIndex = cell.points->getPointGlobalIndex(i);
 			unsigned localIndex = 0;
 			while (localIndex < neighborCount && nNSS.pointsInNeighbourhood[localIndex].pointIndex != globalIndex)
 				++localIndex;
@@ -832,7 +832,7 @@ bool CloudSamplingTools::applyNoiseFilterAtLevel(	const DgmOctree::octreeCell& c
 			if (!removeIsolatedPoints)
 			{
 				//we keep the point
-				unsigned globalIndex = cell.points->getPointGlobalIndex(i);
+				PointIndexType globalIndex = cell.points->getPointGlobalIndex(i);
 				cloud->addPointIndex(globalIndex);
 			}
 		}
@@ -860,13 +860,13 @@ bool CloudSamplingTools::applySORFilterAtLevel(	const DgmOctree::octreeCell& cel
 	cell.parentOctree->getCellPos(cell.truncatedCode, cell.level, nNSS.cellPos, true);
 	cell.parentOctree->computeCellCenter(nNSS.cellPos, cell.level, nNSS.cellCenter);
 
-	unsigned n = cell.points->size(); //number of points in the current cell
+	PointIndexType n = cell.points->size(); //number of points in the current cell
 
 	//for each point in the cell
-	for (unsigned i = 0; i < n; ++i)
+	for (PointIndexType i = 0; i < n; ++i)
 	{
 		cell.points->getPoint(i, nNSS.queryPoint);
-		const unsigned globalIndex = cell.points->getPointGlobalIndex(i);
+		const PointIndexType globalIndex = cell.points->getPointGlobalIndex(i);
 
 		//look for the k nearest neighbors
 		cell.parentOctree->findNearestNeighborsStartingFromCell(nNSS);
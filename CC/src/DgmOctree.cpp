@@ -22,12 +22,15 @@
 #include <CCMiscTools.h>
 #include <GenericProgressCallback.h>
 #include <ParallelSort.h>
+#include <PointsSpan.h>
 #include <RayAndBox.h>
 #include <ReferenceCloud.h>
 #include <ScalarField.h>
 
 //system
+#include <atomic>
 #include <cstdio>
+#include <limits>
 #include <set>
 
 //DGM: tests in progress
@@ -41,8 +44,77 @@
 #endif
 #endif
 
+#ifdef ENABLE_MT_OCTREE
+#include <QtConcurrentMap>
+#include <QThread>
+#endif
+
 using namespace CCLib;
 
+/**********************************/
+/*      PARALLEL PROCESSING       */
+/**********************************/
+
+//! Chunk of a range of indexes
+struct IndexChunk
+{
+	//! First index
+	PointIndexType first;
+	//! Last index (excluded)
+	PointIndexType last;
+	//! Chunk index
+	unsigned index;
+};
+
+//! Splits [0 ; count[ in chunks (at least 'minChunkSize' wide, except the last one)
+/** Without multi-threading support, a single chunk is returned.
+**/
+static std::vector<IndexChunk> SplitInChunks(PointIndexType count, unsigned minChunkSize)
+{
+	unsigned chunkCount = 1;
+#ifdef ENABLE_MT_OCTREE
+	//a few chunks per thread for a better load balancing
+	chunkCount = static_cast<unsigned>(std::max(1, 4 * QThread::idealThreadCount()));
+	chunkCount = static_cast<unsigned>(std::max<PointIndexType>(1, std::min<PointIndexType>(chunkCount, count / std::max(1u, minChunkSize))));
+#else
+	(void)minChunkSize;
+#endif
+
+	std::vector<IndexChunk> chunks(chunkCount);
+	for (unsigned i = 0; i < chunkCount; ++i)
+	{
+		chunks[i].first = static_cast<PointIndexType>((static_cast<unsigned long long>(count) * i) / chunkCount);
+		chunks[i].last = static_cast<PointIndexType>((static_cast<unsigned long long>(count) * (i + 1)) / chunkCount);
+		chunks[i].index = i;
+	}
+	return chunks;
+}
+
+//! Converts a number of projected points to the value returned by DgmOctree::build
+/** With 64 bits indexes, the number of points may exceed the capacity of an int.
+	The caller should then rely on DgmOctree::getNumberOfProjectedPoints.
+**/
+static inline int ProjectedCountToInt(PointIndexType count)
+{
+	return static_cast<int>(std::min<PointIndexType>(count, static_cast<PointIndexType>(std::numeric_limits<int>::max())));
+}
+
+//! Applies a function to each chunk (in parallel if possible)
+template <class Func> static void ForEachChunk(std::vector<IndexChunk>& chunks, Func func)
+{
+#ifdef ENABLE_MT_OCTREE
+	if (chunks.size() > 1)
+	{
+		QtConcurrent::blockingMap(chunks, func);
+		return;
+	}
+#endif
+	for (IndexChunk& chunk : chunks)
+	{
+		func(chunk);
+	}
+}
+
 /**********************************/
 /* PRE COMPUTED VALUES AND TABLES */
 /**********************************/
@@ -187,6 +259,7 @@ DgmOctree::DgmOctree(GenericIndexedCloudPersist* cloud)
 	: m_theAssociatedCloud(cloud)
 	, m_numberOfProjectedPoints(0)
 	, m_nearestPow2(0)
+	, m_userDefinedBoxes(false)
 {
 	clear();
 
@@ -213,6 +286,7 @@ int DgmOctree::build(GenericProgressCallback* progressCb)
 		clear();
 
 	updateMinAndMaxTables();
+	m_userDefinedBoxes = false;
 
 	return genericBuild(progressCb);
 }
@@ -232,13 +306,14 @@ int DgmOctree::build(	const CCVector3& octreeMin,
 	//the user can specify boundaries for points different than the octree box!
 	m_pointsMin = (pointsMinFilter ? *pointsMinFilter : m_dimMin);
 	m_pointsMax = (pointsMaxFilter ? *pointsMaxFilter : m_dimMax);
+	m_userDefinedBoxes = true;
 
 	return genericBuild(progressCb);
 }
 
 int DgmOctree::genericBuild(GenericProgressCallback* progressCb)
 {
-	unsigned pointCount = (m_theAssociatedCloud ? m_theAssociatedCloud->size() : 0);
+	PointIndexType pointCount = (m_theAssociatedCloud ? m_theAssociatedCloud->size() : 0);
 	if (pointCount == 0)
 	{
 		//no cloud/point?!
@@ -268,7 +343,7 @@ int DgmOctree::genericBuild(GenericProgressCallback* progressCb)
 		{
 			progressCb->setMethodTitle("Build Octree");
 			char infosBuffer[256];
-			sprintf(infosBuffer, "Projecting %u points\nMax. depth: %i", pointCount, MAX_OCTREE_LEVEL);
+			sprintf(infosBuffer, "Projecting %llu points\nMax. depth: %i", static_cast<unsigned long long>(pointCount), MAX_OCTREE_LEVEL);
 			progressCb->setInfo(infosBuffer);
 		}
 		progressCb->update(0);
@@ -279,92 +354,23 @@ int DgmOctree::genericBuild(GenericProgressCallback* progressCb)
 	//fill indexes table (we'll fill the max. level, then deduce the others from this one)
 	int* fillIndexesAtMaxLevel = m_fillIndexes + (MAX_OCTREE_LEVEL * 6);
 
-	//for all points
-	cellsContainer::iterator it = m_thePointsAndTheirCellCodes.begin();
-	for (unsigned i=0; i<pointCount; i++)
+	//compute the cell codes of all points
+	PointIndexType projectedCount = 0;
+	if (!projectPoints(0, pointCount, m_thePointsAndTheirCellCodes, fillIndexesAtMaxLevel, &nprogress, projectedCount))
 	{
-		const CCVector3* P = m_theAssociatedCloud->getPoint(i);
-
-		//does the point falls in the 'accepted points' box?
-		//(potentially different from the octree box - see DgmOctree::build)
-		if (	(P->x >= m_pointsMin[0]) && (P->x <= m_pointsMax[0])
-			&&	(P->y >= m_pointsMin[1]) && (P->y <= m_pointsMax[1])
-			&&	(P->z >= m_pointsMin[2]) && (P->z <= m_pointsMax[2]) )
-		{
-			//compute the position of the cell that includes this point
-			Tuple3i cellPos;
-			getTheCellPosWhichIncludesThePoint(P, cellPos);
-
-			//clipping X
-			if (cellPos.x < 0)
-				cellPos.x = 0;
-			else if (cellPos.x >= MAX_OCTREE_LENGTH)
-				cellPos.x = MAX_OCTREE_LENGTH-1;
-			//clipping Y
-			if (cellPos.y < 0)
-				cellPos.y = 0;
-			else if (cellPos.y >= MAX_OCTREE_LENGTH)
-				cellPos.y = MAX_OCTREE_LENGTH-1;
-			//clipping Z
-			if (cellPos.z < 0)
-				cellPos.z = 0;
-			else if (cellPos.z >= MAX_OCTREE_LENGTH)
-				cellPos.z = MAX_OCTREE_LENGTH-1;
-
-			it->theIndex = i;
-			it->theCode = GenerateTruncatedCellCode(cellPos, MAX_OCTREE_LEVEL);
-
-			if (m_numberOfProjectedPoints)
-			{
-				if (fillIndexesAtMaxLevel[0] > cellPos.x)
-					fillIndexesAtMaxLevel[0] = cellPos.x;
-				else if (fillIndexesAtMaxLevel[3] < cellPos.x)
-					fillIndexesAtMaxLevel[3] = cellPos.x;
-
-				if (fillIndexesAtMaxLevel[1] > cellPos.y)
-					fillIndexesAtMaxLevel[1] = cellPos.y;
-				else if (fillIndexesAtMaxLevel[4] < cellPos.y)
-					fillIndexesAtMaxLevel[4] = cellPos.y;
-
-				if (fillIndexesAtMaxLevel[2] > cellPos.z)
-					fillIndexesAtMaxLevel[2] = cellPos.z;
-				else if (fillIndexesAtMaxLevel[5] < cellPos.z)
-					fillIndexesAtMaxLevel[5] = cellPos.z;
-			}
-			else
-			{
-				fillIndexesAtMaxLevel[0] = fillIndexesAtMaxLevel[3] = cellPos.x;
-				fillIndexesAtMaxLevel[1] = fillIndexesAtMaxLevel[4] = cellPos.y;
-				fillIndexesAtMaxLevel[2] = fillIndexesAtMaxLevel[5] = cellPos.z;
-			}
-
-			++it;
-			++m_numberOfProjectedPoints;
-		}
-
-		if (!nprogress.oneStep())
+		//process cancelled by the user
+		m_thePointsAndTheirCellCodes.resize(0);
+		m_numberOfProjectedPoints = 0;
+		if (progressCb)
 		{
-			m_thePointsAndTheirCellCodes.resize(0);
-			m_numberOfProjectedPoints = 0;
-			if (progressCb)
-			{
-				progressCb->stop();
-			}
-			return 0;
+			progressCb->stop();
 		}
+		return 0;
 	}
+	m_numberOfProjectedPoints = projectedCount;
 
 	//we deduce the lower levels 'fill indexes' from the highest level
-	{
-		for (int k = MAX_OCTREE_LEVEL - 1; k >= 0; k--)
-		{
-			int* fillIndexes = m_fillIndexes + (k*6);
-			for (int dim=0; dim<6; ++dim)
-			{
-				fillIndexes[dim] = (fillIndexes[dim+6] >> 1);
-			}
-		}
-	}
+	updateFillIndexes();
 
 	if (m_numberOfProjectedPoints < pointCount)
 		m_thePointsAndTheirCellCodes.resize(m_numberOfProjectedPoints); //smaller --> should always be ok
@@ -375,7 +381,7 @@ int DgmOctree::genericBuild(GenericProgressCallback* progressCb)
 	}
 
 	//we sort the 'cells' by ascending code order
-	ParallelSort(m_thePointsAndTheirCellCodes.begin(), m_thePointsAndTheirCellCodes.end(), IndexAndCode::codeComp);
+	SortCellCodes(m_thePointsAndTheirCellCodes);
 
 	//update the pre-computed 'number of cells per level of subdivision' array
 	updateCellCountTable();
@@ -388,14 +394,14 @@ int DgmOctree::genericBuild(GenericProgressCallback* progressCb)
 			char buffer[256];
 			if (m_numberOfProjectedPoints == pointCount)
 			{
-				sprintf(buffer, "[Octree::build] Octree successfully built... %u points (ok)!", m_numberOfProjectedPoints);
+				sprintf(buffer, "[Octree::build] Octree successfully built... %llu points (ok)!", static_cast<unsigned long long>(m_numberOfProjectedPoints));
 			}
 			else
 			{
 				if (m_numberOfProjectedPoints == 0)
 					sprintf(buffer, "[Octree::build] Warning : no point projected in the Octree!");
 				else
-					sprintf(buffer, "[Octree::build] Warning: some points have been filtered out (%u/%u)", pointCount - m_numberOfProjectedPoints, pointCount);
+					sprintf(buffer, "[Octree::build] Warning: some points have been filtered out (%llu/%llu)", static_cast<unsigned long long>(pointCount - m_numberOfProjectedPoints), static_cast<unsigned long long>(pointCount));
 			}
 			progressCb->setInfo(buffer);
 		}
@@ -405,9 +411,372 @@ int DgmOctree::genericBuild(GenericProgressCallback* progressCb)
 		progressCb->stop();
 	}
 
-	m_nearestPow2 = (1 << static_cast<int>( log(static_cast<double>(m_numberOfProjectedPoints-1)) / LOG_NAT_2 ));
+	m_nearestPow2 = (static_cast<PointIndexType>(1) << static_cast<int>( log(static_cast<double>(m_numberOfProjectedPoints-1)) / LOG_NAT_2 ));
    
-	return static_cast<int>(m_numberOfProjectedPoints);
+	return ProjectedCountToInt(m_numberOfProjectedPoints);
+}
+
+bool DgmOctree::projectPoints(	PointIndexType firstPointIndex,
+								PointIndexType lastPointIndex,
+								cellsContainer& codes,
+								int fillIndexes[6],
+								NormalizedProgress* nprogress,
+								PointIndexType& projectedCount) const
+{
+	assert(firstPointIndex <= lastPointIndex && codes.size() >= lastPointIndex - firstPointIndex);
+
+	//we process the points by chunks (each chunk writes its codes in its own part of the output container)
+	std::vector<IndexChunk> chunks = SplitInChunks(lastPointIndex - firstPointIndex, 1 << 16);
+	std::vector<PointIndexType> projectedCounts(chunks.size(), 0);
+	std::vector<Tuple3i> minCellPos(chunks.size()), maxCellPos(chunks.size());
+	std::atomic<bool> cancelled(false);
+
+	//progress is notified by blocks of points
+	static const unsigned PROGRESS_BLOCK_SIZE = 4096;
+
+	ForEachChunk(chunks, [&](const IndexChunk& chunk)
+	{
+		PointIndexType count = 0;
+		Tuple3i& minPos = minCellPos[chunk.index];
+		Tuple3i& maxPos = maxCellPos[chunk.index];
+
+		for (PointIndexType i = chunk.first; i < chunk.last; ++i)
+		{
+			const CCVector3* P = m_theAssociatedCloud->getPointPersistentPtr(firstPointIndex + i);
+
+			//does the point falls in the 'accepted points' box?
+			//(potentially different from the octree box - see DgmOctree::build)
+			if (	(P->x >= m_pointsMin[0]) && (P->x <= m_pointsMax[0])
+				&&	(P->y >= m_pointsMin[1]) && (P->y <= m_pointsMax[1])
+				&&	(P->z >= m_pointsMin[2]) && (P->z <= m_pointsMax[2]) )
+			{
+				//compute the position of the cell that includes this point
+				Tuple3i cellPos;
+				getTheCellPosWhichIncludesThePoint(P, cellPos);
+
+				//clipping
+				for (unsigned char dim = 0; dim < 3; ++dim)
+				{
+					if (cellPos.u[dim] < 0)
+						cellPos.u[dim] = 0;
+					else if (cellPos.u[dim] >= MAX_OCTREE_LENGTH)
+						cellPos.u[dim] = MAX_OCTREE_LENGTH - 1;
+				}
+
+				IndexAndCode& ic = codes[chunk.first + count];
+				ic.theIndex = firstPointIndex + i;
+				ic.theCode = GenerateTruncatedCellCode(cellPos, MAX_OCTREE_LEVEL);
+
+				if (count)
+				{
+					for (unsigned char dim = 0; dim < 3; ++dim)
+					{
+						if (minPos.u[dim] > cellPos.u[dim])
+							minPos.u[dim] = cellPos.u[dim];
+						else if (maxPos.u[dim] < cellPos.u[dim])
+							maxPos.u[dim] = cellPos.u[dim];
+					}
+				}
+				else
+				{
+					minPos = maxPos = cellPos;
+				}
+
+				++count;
+			}
+
+			if (nprogress && ((i - chunk.first + 1) % PROGRESS_BLOCK_SIZE) == 0)
+			{
+				if (cancelled || !nprogress->steps(PROGRESS_BLOCK_SIZE))
+				{
+					cancelled = true;
+					break;
+				}
+			}
+		}
+
+		projectedCounts[chunk.index] = count;
+	});
+
+	if (cancelled)
+	{
+		return false;
+	}
+
+	//merge the chunks results (the projected points must be contiguous)
+	projectedCount = 0;
+	for (const IndexChunk& chunk : chunks)
+	{
+		PointIndexType count = projectedCounts[chunk.index];
+		if (count == 0)
+		{
+			continue;
+		}
+
+		if (projectedCount != chunk.first)
+		{
+			std::copy(codes.begin() + chunk.first, codes.begin() + (chunk.first + count), codes.begin() + projectedCount);
+		}
+
+		const Tuple3i& minPos = minCellPos[chunk.index];
+		const Tuple3i& maxPos = maxCellPos[chunk.index];
+		for (unsigned char dim = 0; dim < 3; ++dim)
+		{
+			if (projectedCount == 0 || fillIndexes[dim] > minPos.u[dim])
+				fillIndexes[dim] = minPos.u[dim];
+			if (projectedCount == 0 || fillIndexes[3 + dim] < maxPos.u[dim])
+				fillIndexes[3 + dim] = maxPos.u[dim];
+		}
+
+		projectedCount += count;
+	}
+
+	return true;
+}
+
+//! Number of bits of each radix sort digit
+static const unsigned RADIX_BITS = 11;
+//! Number of buckets of each radix sort pass
+static const unsigned RADIX_BUCKETS = (1 << RADIX_BITS);
+
+void DgmOctree::SortCellCodes(cellsContainer& codes)
+{
+	const PointIndexType count = static_cast<PointIndexType>(codes.size());
+	if (count < 2)
+	{
+		return;
+	}
+
+	std::vector<IndexChunk> chunks = SplitInChunks(count, 1 << 16);
+	if (chunks.size() < 2)
+	{
+		//no multi-threading support, or not enough elements
+		ParallelSort(codes.begin(), codes.end(), IndexAndCode::codeComp);
+		return;
+	}
+
+	//LSD radix sort: we need a temporary buffer and one histogram per chunk
+	cellsContainer buffer;
+	std::vector<PointIndexType> histograms;
+	try
+	{
+		buffer.resize(count);
+		histograms.resize(chunks.size() * RADIX_BUCKETS);
+	}
+	catch (const std::bad_alloc&)
+	{
+		//not enough memory: we use the standard sort
+		ParallelSort(codes.begin(), codes.end(), IndexAndCode::codeComp);
+		return;
+	}
+
+	//only the significant bits have to be sorted
+	CellCode maxCode = 0;
+	for (const IndexAndCode& ic : codes)
+	{
+		maxCode |= ic.theCode;
+	}
+	unsigned significantBits = 0;
+	while (significantBits < 8 * sizeof(CellCode) && (maxCode >> significantBits) != 0)
+	{
+		++significantBits;
+	}
+
+	cellsContainer* source = &codes;
+	cellsContainer* dest = &buffer;
+	for (unsigned shift = 0; shift < significantBits; shift += RADIX_BITS)
+	{
+		//per-chunk histograms
+		ForEachChunk(chunks, [&](const IndexChunk& chunk)
+		{
+			PointIndexType* histogram = histograms.data() + chunk.index * RADIX_BUCKETS;
+			std::fill(histogram, histogram + RADIX_BUCKETS, 0);
+			for (PointIndexType i = chunk.first; i < chunk.last; ++i)
+			{
+				++histogram[((*source)[i].theCode >> shift) & (RADIX_BUCKETS - 1)];
+			}
+		});
+
+		//histograms --> output offsets (bucket-major, then chunk order, so that the sort is stable)
+		PointIndexType offset = 0;
+		bool singleBucket = false;
+		for (unsigned b = 0; b < RADIX_BUCKETS; ++b)
+		{
+			PointIndexType bucketStart = offset;
+			for (std::size_t c = 0; c < chunks.size(); ++c)
+			{
+				PointIndexType& h = histograms[c * RADIX_BUCKETS + b];
+				PointIndexType population = h;
+				h = offset;
+				offset += population;
+			}
+			if (offset - bucketStart == count)
+			{
+				//all elements have the same digit: nothing to do for this pass
+				singleBucket = true;
+				break;
+			}
+		}
+		if (singleBucket)
+		{
+			continue;
+		}
+
+		//scatter
+		ForEachChunk(chunks, [&](const IndexChunk& chunk)
+		{
+			PointIndexType* offsets = histograms.data() + chunk.index * RADIX_BUCKETS;
+			for (PointIndexType i = chunk.first; i < chunk.last; ++i)
+			{
+				const IndexAndCode& ic = (*source)[i];
+				(*dest)[offsets[(ic.theCode >> shift) & (RADIX_BUCKETS - 1)]++] = ic;
+			}
+		});
+
+		std::swap(source, dest);
+	}
+
+	if (source != &codes)
+	{
+		codes.swap(buffer);
+	}
+}
+
+void DgmOctree::updateFillIndexes()
+{
+	for (int k = MAX_OCTREE_LEVEL - 1; k >= 0; k--)
+	{
+		int* fillIndexes = m_fillIndexes + (k * 6);
+		for (int dim = 0; dim < 6; ++dim)
+		{
+			fillIndexes[dim] = (fillIndexes[dim + 6] >> 1);
+		}
+	}
+}
+
+int DgmOctree::appendPoints(PointIndexType firstPointIndex, GenericProgressCallback* progressCb/*=nullptr*/)
+{
+	if (m_thePointsAndTheirCellCodes.empty())
+	{
+		//nothing to update
+		return build(progressCb);
+	}
+
+	PointIndexType pointCount = (m_theAssociatedCloud ? m_theAssociatedCloud->size() : 0);
+	if (firstPointIndex > pointCount)
+	{
+		assert(false);
+		return -1;
+	}
+	else if (firstPointIndex == pointCount)
+	{
+		//no new point
+		return ProjectedCountToInt(m_numberOfProjectedPoints);
+	}
+
+	//the new points must fall inside the octree
+	//(with user-defined boxes, the points outside of the 'accepted points' box are simply ignored, as in DgmOctree::build)
+	CCVector3 pointsMin = m_pointsMin;
+	CCVector3 pointsMax = m_pointsMax;
+	for (PointIndexType i = firstPointIndex; i < pointCount && !m_userDefinedBoxes; ++i)
+	{
+		const CCVector3* P = m_theAssociatedCloud->getPoint(i);
+		for (unsigned char dim = 0; dim < 3; ++dim)
+		{
+			if (P->u[dim] < m_dimMin.u[dim] || P->u[dim] > m_dimMax.u[dim])
+			{
+				//we have to rebuild the whole structure
+				return build(progressCb);
+			}
+			if (pointsMin.u[dim] > P->u[dim])
+				pointsMin.u[dim] = P->u[dim];
+			else if (pointsMax.u[dim] < P->u[dim])
+				pointsMax.u[dim] = P->u[dim];
+		}
+	}
+	m_pointsMin = pointsMin;
+	m_pointsMax = pointsMax;
+
+	PointIndexType newPointCount = pointCount - firstPointIndex;
+	PointIndexType previousCount = static_cast<PointIndexType>(m_thePointsAndTheirCellCodes.size());
+
+	//progress notification (optional)
+	if (progressCb)
+	{
+		if (progressCb->textCanBeEdited())
+		{
+			progressCb->setMethodTitle("Update Octree");
+			char infosBuffer[256];
+			sprintf(infosBuffer, "Projecting %llu new points", static_cast<unsigned long long>(newPointCount));
+			progressCb->setInfo(infosBuffer);
+		}
+		progressCb->update(0);
+		progressCb->start();
+	}
+	NormalizedProgress nprogress(progressCb, newPointCount, 80);
+
+	//compute and sort the codes of the new points on their own
+	int fillIndexes[6];
+	PointIndexType projectedCount = 0;
+	bool success = false;
+	cellsContainer newCodes;
+	try
+	{
+		newCodes.resize(newPointCount);
+		success = projectPoints(firstPointIndex, pointCount, newCodes, fillIndexes, &nprogress, projectedCount);
+		if (success && projectedCount > 0)
+		{
+			newCodes.resize(projectedCount);
+			SortCellCodes(newCodes);
+
+			//then merge them with the existing ones
+			m_thePointsAndTheirCellCodes.resize(previousCount + newCodes.size());
+		}
+	}
+	catch (const std::bad_alloc&)
+	{
+		//not enough memory
+		success = false;
+	}
+
+	if (progressCb)
+	{
+		progressCb->stop();
+	}
+
+	if (!success)
+	{
+		//process cancelled or not enough memory (the octree is left as is... but it's not in sync with the cloud anymore!)
+		clear();
+		return -1;
+	}
+	else if (projectedCount == 0)
+	{
+		return ProjectedCountToInt(m_numberOfProjectedPoints);
+	}
+
+	std::copy(newCodes.begin(), newCodes.end(), m_thePointsAndTheirCellCodes.begin() + previousCount);
+	newCodes.clear();
+	newCodes.shrink_to_fit();
+	std::inplace_merge(	m_thePointsAndTheirCellCodes.begin(),
+						m_thePointsAndTheirCellCodes.begin() + previousCount,
+						m_thePointsAndTheirCellCodes.end(),
+						IndexAndCode::codeComp);
+
+	//update the 'fill indexes'
+	int* fillIndexesAtMaxLevel = m_fillIndexes + (MAX_OCTREE_LEVEL * 6);
+	for (unsigned char dim = 0; dim < 3; ++dim)
+	{
+		fillIndexesAtMaxLevel[dim] = std::min(fillIndexesAtMaxLevel[dim], fillIndexes[dim]);
+		fillIndexesAtMaxLevel[3 + dim] = std::max(fillIndexesAtMaxLevel[3 + dim], fillIndexes[3 + dim]);
+	}
+	updateFillIndexes();
+
+	m_numberOfProjectedPoints = static_cast<PointIndexType>(m_thePointsAndTheirCellCodes.size());
+	updateCellCountTable();
+	m_nearestPow2 = (static_cast<PointIndexType>(1) << static_cast<int>(log(static_cast<double>(m_numberOfProjectedPoints - 1)) / LOG_NAT_2));
+
+	return ProjectedCountToInt(m_numberOfProjectedPoints);
 }
 
 void DgmOctree::updateMinAndMaxTables()
@@ -438,10 +807,14 @@ void DgmOctree::updateCellSizeTable()
 void DgmOctree::updateCellCountTable()
 {
 	//level 0 is just the octree bounding-box
-	for (unsigned char i=0; i<=MAX_OCTREE_LEVEL; ++i)
+	//(each level is independent: they can be processed in parallel)
+	std::vector<IndexChunk> levels(MAX_OCTREE_LEVEL + 1);
+	for (unsigned char i = 0; i <= MAX_OCTREE_LEVEL; ++i)
 	{
-		computeCellsStatistics(i);
+		levels[i].first = levels[i].index = i;
+		levels[i].last = i + 1;
 	}
+	ForEachChunk(levels, [this](const IndexChunk& level) { computeCellsStatistics(static_cast<unsigned char>(level.first)); });
 }
 
 void DgmOctree::computeCellsStatistics(unsigned char level)
@@ -463,7 +836,7 @@ void DgmOctree::computeCellsStatistics(unsigned char level)
 	if (level == 0)
 	{
 		m_cellCount[level] = 1;
-		m_maxCellPopulation[level] = static_cast<unsigned>(m_thePointsAndTheirCellCodes.size());
+		m_maxCellPopulation[level] = static_cast<PointIndexType>(m_thePointsAndTheirCellCodes.size());
 		m_averageCellPopulation[level] = static_cast<double>(m_thePointsAndTheirCellCodes.size());
 		m_stdDevCellPopulation[level] = 0.0;
 		return;
@@ -478,8 +851,8 @@ void DgmOctree::computeCellsStatistics(unsigned char level)
 	//we init scan with first element
 	CellCode predCode = (p->theCode >> bitDec);
 	unsigned counter = 0;
-	unsigned cellCounter = 0;
-	unsigned maxCellPop = 0;
+	PointIndexType cellCounter = 0;
+	PointIndexType maxCellPop = 0;
 	double sum = 0.0, sum2 = 0.0;
 
 	for (; p != m_thePointsAndTheirCellCodes.end(); ++p)
@@ -572,7 +945,7 @@ bool DgmOctree::getPointsInCell(CellCode cellCode,
 		cellCode >>= bitDec;
 	}
 
-	unsigned cellIndex = getCellIndex(cellCode, bitDec);
+	PointIndexType cellIndex = getCellIndex(cellCode, bitDec);
 	//check that cell exists!
 	if (cellIndex < m_numberOfProjectedPoints)
 	{
@@ -586,16 +959,16 @@ bool DgmOctree::getPointsInCell(CellCode cellCode,
 	return true;
 }
 
-unsigned DgmOctree::getCellIndex(CellCode truncatedCellCode, unsigned char bitDec) const
+PointIndexType DgmOctree::getCellIndex(CellCode truncatedCellCode, unsigned char bitDec) const
 {
 	//inspired from the algorithm proposed by MATT PULVER (see http://eigenjoy.com/2011/01/21/worlds-fastest-binary-search/)
 	//DGM:	it's not faster, but the code is simpler ;)
-	unsigned i = 0;
-	unsigned b = m_nearestPow2;
+	PointIndexType i = 0;
+	PointIndexType b = m_nearestPow2;
    
 	for ( ; b ; b >>= 1 )
 	{
-		unsigned j = i | b;
+		PointIndexType j = i | b;
 		if ( j < m_numberOfProjectedPoints)
 		{
 			CellCode middleCode = (m_thePointsAndTheirCellCodes[j].theCode >> bitDec);
@@ -627,7 +1000,7 @@ static double s_binarySearchCount = 0.0;
 #endif
 
 #ifdef ADAPTATIVE_BINARY_SEARCH
-unsigned DgmOctree::getCellIndex(CellCode truncatedCellCode, unsigned char bitDec, unsigned begin, unsigned end) const
+PointIndexType DgmOctree::getCellIndex(CellCode truncatedCellCode, unsigned char bitDec, PointIndexType begin, PointIndexType end) const
 {
 	assert(truncatedCellCode != INVALID_CELL_CODE);
 	assert(end >= begin);
@@ -653,7 +1026,7 @@ unsigned DgmOctree::getCellIndex(CellCode truncatedCellCode, unsigned char bitDe
 	while (true)
 	{
 		float centralPoint = 0.5f + 0.75f*(static_cast<float>(truncatedCellCode-beginCode)/(-0.5f)); //0.75 = speed coef (empirical)
-		unsigned middle = begin + static_cast<unsigned>(centralPoint*float(end-begin));
+		PointIndexType middle = begin + static_cast<PointIndexType>(centralPoint*float(end-begin));
 		CellCode middleCode = (m_thePointsAndTheirCellCodes[middle].theCode >> bitDec);
 
 		if (middleCode < truncatedCellCode)
@@ -694,7 +1067,7 @@ unsigned DgmOctree::getCellIndex(CellCode truncatedCellCode, unsigned char bitDe
 
 #else
 
-unsigned DgmOctree::getCellIndex(CellCode truncatedCellCode, unsigned char bitDec, unsigned begin, unsigned end) const
+PointIndexType DgmOctree::getCellIndex(CellCode truncatedCellCode, unsigned char bitDec, PointIndexType begin, PointIndexType end) const
 {
 	assert(truncatedCellCode != INVALID_CELL_CODE);
 	assert(end >= begin && end < m_numberOfProjectedPoints);
@@ -705,12 +1078,12 @@ unsigned DgmOctree::getCellIndex(CellCode truncatedCellCode, unsigned char bitDe
 
 	//inspired from the algorithm proposed by MATT PULVER (see http://eigenjoy.com/2011/01/21/worlds-fastest-binary-search/)
 	//DGM:	it's not faster, but the code is simpler ;)
-	unsigned i = 0;
-	unsigned count = end-begin+1;
-	unsigned b = (1 << static_cast<int>( log(static_cast<double>(count-1)) / LOG_NAT_2 ));
+	PointIndexType i = 0;
+	PointIndexType count = end-begin+1;
+	PointIndexType b = (static_cast<PointIndexType>(1) << static_cast<int>( log(static_cast<double>(count-1)) / LOG_NAT_2 ));
 	for ( ; b ; b >>= 1 )
 	{
-		unsigned j = i | b;
+		PointIndexType j = i | b;
 		if ( j < count)
 		{
 			CellCode middleCode = (m_thePointsAndTheirCellCodes[begin+j].theCode >> bitDec);
@@ -887,7 +1260,7 @@ void DgmOctree::getNeighborCellsAround(	const Tuple3i& cellPos,
 				{
 					CellCode c2 = c1 | (GenerateCellCodeForDim(cellPos.z + k) << 2);
 
-					unsigned index = getCellIndex(c2, bitDec);
+					PointIndexType index = getCellIndex(c2, bitDec);
 					if (index < m_numberOfProjectedPoints)
 					{
 						neighborCellsIndexes.push_back(index);
@@ -901,7 +1274,7 @@ void DgmOctree::getNeighborCellsAround(	const Tuple3i& cellPos,
 				{
 					CellCode c2 = c1 | (GenerateCellCodeForDim(cellPos.z - neighbourhoodLength) << 2);
 
-					unsigned index = getCellIndex(c2, bitDec);
+					PointIndexType index = getCellIndex(c2, bitDec);
 					if (index < m_numberOfProjectedPoints)
 					{
 						neighborCellsIndexes.push_back(index);
@@ -912,7 +1285,7 @@ void DgmOctree::getNeighborCellsAround(	const Tuple3i& cellPos,
 				{
 					CellCode c2 = c1 + (GenerateCellCodeForDim(cellPos.z + kMax) << 2);
 
-					unsigned index = getCellIndex(c2, bitDec);
+					PointIndexType index = getCellIndex(c2, bitDec);
 					if (index < m_numberOfProjectedPoints)
 					{
 						neighborCellsIndexes.push_back(index);
@@ -960,7 +1333,7 @@ void DgmOctree::getPointsInNeighbourCellsAround(NearestNeighboursSearchStruct &n
 				{
 					CellCode c2 = c1 | (GenerateCellCodeForDim(nNSS.cellPos.z + k) << 2);
 
-					unsigned index = getCellIndex(c2, bitDec);
+					PointIndexType index = getCellIndex(c2, bitDec);
 					if (index < m_numberOfProjectedPoints)
 					{
 						//we increase 'pointsInNeighbourCells' capacity with average cell size
@@ -990,7 +1363,7 @@ void DgmOctree::getPointsInNeighbourCellsAround(NearestNeighboursSearchStruct &n
 				{
 					CellCode c2 = c1 | (GenerateCellCodeForDim(nNSS.cellPos.z - neighbourhoodLength) << 2);
 
-					unsigned index = getCellIndex(c2, bitDec);
+					PointIndexType index = getCellIndex(c2, bitDec);
 					if (index < m_numberOfProjectedPoints)
 					{
 						//we increase 'nNSS.pointsInNeighbourhood' capacity with average cell size
@@ -1017,7 +1390,7 @@ void DgmOctree::getPointsInNeighbourCellsAround(NearestNeighboursSearchStruct &n
 				{
 					CellCode c2 = c1 | (GenerateCellCodeForDim(nNSS.cellPos.z + neighbourhoodLength) << 2);
 
-					unsigned index = getCellIndex(c2, bitDec);
+					PointIndexType index = getCellIndex(c2, bitDec);
 					if (index < m_numberOfProjectedPoints)
 					{
 						//we increase 'nNSS.pointsInNeighbourhood' capacity with average cell size
@@ -1359,7 +1732,7 @@ double DgmOctree::findTheNearestNeighborStartingFromCell(NearestNeighboursSearch
 
 		//check for existence of an 'including' cell
 		CellCode truncatedCellCode = GenerateTruncatedCellCode(nNSS.cellPos, nNSS.level);
-		unsigned index = (truncatedCellCode == INVALID_CELL_CODE ? m_numberOfProjectedPoints : getCellIndex(truncatedCellCode,bitDec));
+		PointIndexType index = (truncatedCellCode == INVALID_CELL_CODE ? m_numberOfProjectedPoints : getCellIndex(truncatedCellCode,bitDec));
 
 		visitedCellDistance = 1;
 
@@ -1451,7 +1824,7 @@ double DgmOctree::findTheNearestNeighborStartingFromCell(NearestNeighboursSearch
 		for (q = nNSS.minimalCellsSetToVisit.begin() + alreadyProcessedCells; q != nNSS.minimalCellsSetToVisit.end(); ++q)
 		{
 			//current cell index (== index of its first point)
-			unsigned m = *q;
+			PointIndexType m = *q;
 
 			//we scan the whole cell to see if it contains a closer point
 			cellsContainer::const_iterator p = m_thePointsAndTheirCellCodes.begin() + m;
@@ -1526,9 +1899,13 @@ unsigned DgmOctree::findNearestNeighborsStartingFromCell(	NearestNeighboursSearc
 		//visitedCellDistance == 0 means that no cell has ever been processed! No point should be inside 'pointsInNeighbourhood'
 		assert(nNSS.pointsInNeighbourhood.empty());
 
-		//check for existence of 'including' cell
-		CellCode truncatedCellCode = GenerateTruncatedCellCode(nNSS.cellPos, nNSS.level);
-		unsigned index = (truncatedCellCode == INVALID_CELL_CODE ? m_numberOfProjectedPoints : getCellIndex(truncatedCellCode,bitDec));
+		//check for existence of 'including' cell (the query point may lie outside of the octree)
+		const int cellCount = OCTREE_LENGTH(nNSS.level);
+		const bool inBounds =	(	nNSS.cellPos.x >= 0 && nNSS.cellPos.x < cellCount
+								 &&	nNSS.cellPos.y >= 0 && nNSS.cellPos.y < cellCount
+								 &&	nNSS.cellPos.z >= 0 && nNSS.cellPos.z < cellCount );
+		CellCode truncatedCellCode = (inBounds ? GenerateTruncatedCellCode(nNSS.cellPos, nNSS.level) : INVALID_CELL_CODE);
+		PointIndexType index = (truncatedCellCode == INVALID_CELL_CODE ? m_numberOfProjectedPoints : getCellIndex(truncatedCellCode,bitDec));
 
 		visitedCellDistance = 1;
 
@@ -1730,7 +2107,7 @@ int DgmOctree::getPointsInSphericalNeighbourhood(	const CCVector3& sphereCenter,
 				{
 					//2nd test: does this cell exists?
 					CellCode truncatedCellCode = GenerateTruncatedCellCode(cellPos, level);
-					unsigned cellIndex = getCellIndex(truncatedCellCode,bitDec);
+					PointIndexType cellIndex = getCellIndex(truncatedCellCode,bitDec);
 
 					//if yes get the corresponding points
 					if (cellIndex < m_numberOfProjectedPoints)
@@ -1900,7 +2277,7 @@ std::size_t DgmOctree::getPointsInBoxNeighbourhood(BoxNeighbourhood& params) con
 				//test if this cell exists
 				Tuple3i cellPos(i, j, k);
 				CellCode truncatedCellCode = GenerateTruncatedCellCode(cellPos, params.level);
-				unsigned cellIndex = getCellIndex(truncatedCellCode,bitDec);
+				PointIndexType cellIndex = getCellIndex(truncatedCellCode,bitDec);
 
 				//if yes, we can test the corresponding points
 				if (cellIndex < m_numberOfProjectedPoints)
@@ -2020,7 +2397,7 @@ std::size_t DgmOctree::getPointsInCylindricalNeighbourhood(CylindricalNeighbourh
 				{
 					//2nd test: does this cell exists?
 					CellCode truncatedCellCode = GenerateTruncatedCellCode(cellPos, params.level);
-					unsigned cellIndex = getCellIndex(truncatedCellCode,bitDec);
+					PointIndexType cellIndex = getCellIndex(truncatedCellCode,bitDec);
 
 					//if yes get the corresponding points
 					if (cellIndex < m_numberOfProjectedPoints)
@@ -2178,7 +2555,7 @@ std::size_t DgmOctree::getPointsInCylindricalNeighbourhoodProgressive(Progressiv
 					{
 						//2nd test: does this cell exists?
 						CellCode truncatedCellCode = GenerateTruncatedCellCode(cellPos, params.level);
-						unsigned cellIndex = getCellIndex(truncatedCellCode,bitDec);
+						PointIndexType cellIndex = getCellIndex(truncatedCellCode,bitDec);
 
 						//if yes get the corresponding points
 						if (cellIndex < m_numberOfProjectedPoints)
@@ -2398,38 +2775,450 @@ int DgmOctree::findNeighborsInASphereStartingFromCell(NearestNeighboursSpherical
 	return numberOfEligiblePoints;
 }
 
-unsigned char DgmOctree::findBestLevelForAGivenNeighbourhoodSizeExtraction(PointCoordinateType radius) const
+void DgmOctree::sortQueriesByCellCode(const CCVector3* queryPoints, PointIndexType queryCount, cellsContainer& sortedQueries) const
 {
-	static const PointCoordinateType c_neighbourhoodSizeExtractionFactor = static_cast<PointCoordinateType>(2.5);
-	PointCoordinateType aim = std::max<PointCoordinateType>(0, radius / c_neighbourhoodSizeExtractionFactor);
-	
-	int level = 1;
-	PointCoordinateType minValue = getCellSize(1) - aim;
-	minValue *= minValue;
-	for (int i = 2; i <= MAX_OCTREE_LEVEL; ++i)
+	sortedQueries.resize(queryCount);
+
+	std::vector<IndexChunk> chunks = SplitInChunks(queryCount, 1 << 14);
+	ForEachChunk(chunks, [&](const IndexChunk& chunk)
 	{
-		//we need two points per cell ideally
-		if (m_averageCellPopulation[i] < 1.5)
-			break;
+		for (PointIndexType i = chunk.first; i < chunk.last; ++i)
+		{
+			Tuple3i cellPos;
+			getTheCellPosWhichIncludesThePoint(queryPoints + i, cellPos);
 
-		//The level with cell size as near as possible to the aim
-		PointCoordinateType cellSizeDelta = getCellSize(i) - aim;
-		cellSizeDelta *= cellSizeDelta;
+			//clipping (query points may lie outside of the octree)
+			for (unsigned char dim = 0; dim < 3; ++dim)
+			{
+				if (cellPos.u[dim] < 0)
+					cellPos.u[dim] = 0;
+				else if (cellPos.u[dim] >= MAX_OCTREE_LENGTH)
+					cellPos.u[dim] = MAX_OCTREE_LENGTH - 1;
+			}
 
-		if (cellSizeDelta < minValue)
-		{
-			level = i;
-			minValue = cellSizeDelta;
+			sortedQueries[i].theIndex = i;
+			sortedQueries[i].theCode = GenerateTruncatedCellCode(cellPos, MAX_OCTREE_LEVEL);
 		}
-	}
+	});
 
-	return static_cast<unsigned char>(level);
+	SortCellCodes(sortedQueries);
 }
 
-unsigned char DgmOctree::findBestLevelForComparisonWithOctree(const DgmOctree* theOtherOctree) const
+//! Splits a set of sorted queries in chunks (chunks boundaries are aligned on the cells boundaries)
+static std::vector<IndexChunk> SplitSortedQueries(const DgmOctree::cellsContainer& sortedQueries, unsigned char level, bool multiThread)
 {
-	unsigned ptsA = getNumberOfProjectedPoints();
-	unsigned ptsB = theOtherOctree->getNumberOfProjectedPoints();
+	const PointIndexType queryCount = static_cast<PointIndexType>(sortedQueries.size());
+	std::vector<IndexChunk> chunks;
+	if (!multiThread)
+	{
+		IndexChunk chunk;
+		chunk.first = 0;
+		chunk.last = queryCount;
+		chunk.index = 0;
+		chunks.push_back(chunk);
+		return chunks;
+	}
+
+	chunks = SplitInChunks(queryCount, 256);
+
+	//queries lying in the same cell should be processed by the same chunk
+	const unsigned char bitDec = DgmOctree::GET_BIT_SHIFT(level);
+	for (std::size_t i = 1; i < chunks.size(); ++i)
+	{
+		PointIndexType boundary = std::max(chunks[i].first, chunks[i - 1].first);
+		while (boundary < queryCount && (sortedQueries[boundary].theCode >> bitDec) == (sortedQueries[boundary - 1].theCode >> bitDec))
+		{
+			++boundary;
+		}
+		chunks[i - 1].last = chunks[i].first = boundary;
+	}
+
+	return chunks;
+}
+
+bool DgmOctree::findNearestNeighborsBatch(	const CCVector3* queryPoints,
+											PointIndexType queryCount,
+											unsigned maxNumberOfNeighbors,
+											unsigned char level,
+											BatchNeighbourhoods& result,
+											double maxSearchDist/*=0*/,
+											bool multiThread/*=true*/,
+											GenericProgressCallback* progressCb/*=nullptr*/) const
+{
+	result.clear();
+
+	if ((!queryPoints && queryCount != 0) || maxNumberOfNeighbors == 0 || level > MAX_OCTREE_LEVEL)
+	{
+		return false;
+	}
+
+	cellsContainer sortedQueries;
+	try
+	{
+		result.offsets.resize(static_cast<std::size_t>(queryCount) + 1, 0);
+		if (queryCount == 0 || m_numberOfProjectedPoints == 0)
+		{
+			//nothing to do
+			return true;
+		}
+
+		//we reserve 'maxNumberOfNeighbors' slots per query (the buffers are compacted afterwards)
+		const std::size_t slotCount = static_cast<std::size_t>(queryCount) * maxNumberOfNeighbors;
+		result.indexes.resize(slotCount);
+		result.squareDistances.resize(slotCount);
+
+		//queries lying in the same cell will share the same neighbour cells visits
+		sortQueriesByCellCode(queryPoints, queryCount, sortedQueries);
+	}
+	catch (const std::bad_alloc&)
+	{
+		//not enough memory
+		result.clear();
+		return false;
+	}
+
+	if (progressCb)
+	{
+		if (progressCb->textCanBeEdited())
+		{
+			progressCb->setMethodTitle("Nearest neighbours search");
+			char infosBuffer[256];
+			snprintf(infosBuffer, 256, "Queries: %llu\nNeighbours: %u", static_cast<unsigned long long>(queryCount), maxNumberOfNeighbors);
+			progressCb->setInfo(infosBuffer);
+		}
+		progressCb->update(0);
+		progressCb->start();
+	}
+	NormalizedProgress nprogress(progressCb, static_cast<unsigned>(queryCount));
+
+	//progress is notified by blocks of queries
+	static const unsigned PROGRESS_BLOCK_SIZE = 1024;
+
+	std::vector<IndexChunk> chunks = SplitSortedQueries(sortedQueries, level, multiThread);
+	std::atomic<bool> cancelled(false);
+	std::atomic<bool> error(false);
+
+	ForEachChunk(chunks, [&](const IndexChunk& chunk)
+	{
+		try
+		{
+			NearestNeighboursSearchStruct nNSS;
+			nNSS.level = level;
+			nNSS.minNumberOfNeighbors = maxNumberOfNeighbors;
+			nNSS.maxSearchSquareDistd = (maxSearchDist > 0 ? maxSearchDist * maxSearchDist : 0);
+			bool cellIsSet = false;
+
+			for (PointIndexType i = chunk.first; i < chunk.last; ++i)
+			{
+				const PointIndexType queryIndex = sortedQueries[i].theIndex;
+				nNSS.queryPoint = queryPoints[queryIndex];
+
+				Tuple3i cellPos;
+				getTheCellPosWhichIncludesThePoint(&nNSS.queryPoint, cellPos, level);
+
+				//if the cell changes, the neighbourhood gathered so far can't be re-used
+				if (!cellIsSet || cellPos.x != nNSS.cellPos.x || cellPos.y != nNSS.cellPos.y || cellPos.z != nNSS.cellPos.z)
+				{
+					nNSS.cellPos = cellPos;
+					computeCellCenter(nNSS.cellPos, level, nNSS.cellCenter);
+					nNSS.pointsInNeighbourhood.resize(0);
+					//(the search will directly jump to the nearest octree cells if the query point lies outside of the octree)
+					nNSS.alreadyVisitedNeighbourhoodSize = 0;
+					cellIsSet = true;
+				}
+
+				//the search may return more neighbours than requested
+				unsigned neighbourCount = std::min(findNearestNeighborsStartingFromCell(nNSS), maxNumberOfNeighbors);
+				//as well as neighbours farther than the maximum search distance
+				if (nNSS.maxSearchSquareDistd > 0)
+				{
+					while (neighbourCount != 0 && nNSS.pointsInNeighbourhood[neighbourCount - 1].squareDistd > nNSS.maxSearchSquareDistd)
+					{
+						--neighbourCount;
+					}
+				}
+
+				const std::size_t firstSlot = static_cast<std::size_t>(queryIndex) * maxNumberOfNeighbors;
+				for (unsigned j = 0; j < neighbourCount; ++j)
+				{
+					const PointDescriptor& neighbour = nNSS.pointsInNeighbourhood[j];
+					result.indexes[firstSlot + j] = neighbour.pointIndex;
+					result.squareDistances[firstSlot + j] = neighbour.squareDistd;
+				}
+				//we temporarily store the neighbours count
+				result.offsets[queryIndex + 1] = neighbourCount;
+
+				if (progressCb && ((i - chunk.first + 1) % PROGRESS_BLOCK_SIZE) == 0)
+				{
+					if (cancelled || !nprogress.steps(PROGRESS_BLOCK_SIZE))
+					{
+						cancelled = true;
+						break;
+					}
+				}
+			}
+		}
+		catch (const std::bad_alloc&)
+		{
+			//not enough memory
+			error = true;
+		}
+	});
+
+	if (progressCb)
+	{
+		progressCb->stop();
+	}
+
+	if (cancelled || error)
+	{
+		result.clear();
+		return false;
+	}
+
+	//compaction (as offsets[i] <= i * maxNumberOfNeighbors, moving the neighbours backward is safe)
+	std::size_t neighbourCount = 0;
+	for (PointIndexType i = 0; i < queryCount; ++i)
+	{
+		const std::size_t count = result.offsets[i + 1];
+		const std::size_t firstSlot = static_cast<std::size_t>(i) * maxNumberOfNeighbors;
+		if (firstSlot != neighbourCount)
+		{
+			std::copy(result.indexes.begin() + firstSlot, result.indexes.begin() + (firstSlot + count), result.indexes.begin() + neighbourCount);
+			std::copy(result.squareDistances.begin() + firstSlot, result.squareDistances.begin() + (firstSlot + count), result.squareDistances.begin() + neighbourCount);
+		}
+		neighbourCount += count;
+		result.offsets[i + 1] = neighbourCount;
+	}
+	result.indexes.resize(neighbourCount);
+	result.squareDistances.resize(neighbourCount);
+
+	return true;
+}
+
+bool DgmOctree::findNeighborsInASphereBatch(const CCVector3* queryPoints,
+											PointIndexType queryCount,
+											double radius,
+											unsigned char level,
+											BatchNeighbourhoods& result,
+											bool sortValues/*=true*/,
+											bool multiThread/*=true*/,
+											GenericProgressCallback* progressCb/*=nullptr*/) const
+{
+	result.clear();
+
+	if ((!queryPoints && queryCount != 0) || radius < 0 || level > MAX_OCTREE_LEVEL)
+	{
+		return false;
+	}
+
+	cellsContainer sortedQueries;
+	//start of the neighbours of each (sorted) query in its chunk buffers
+	std::vector<std::size_t> localOffsets;
+	try
+	{
+		result.offsets.resize(static_cast<std::size_t>(queryCount) + 1, 0);
+		if (queryCount == 0 || m_numberOfProjectedPoints == 0)
+		{
+			//nothing to do
+			return true;
+		}
+
+		localOffsets.resize(queryCount);
+
+		//queries lying in the same cell will share the same neighbour cells visits
+		sortQueriesByCellCode(queryPoints, queryCount, sortedQueries);
+	}
+	catch (const std::bad_alloc&)
+	{
+		//not enough memory
+		result.clear();
+		return false;
+	}
+
+	if (progressCb)
+	{
+		if (progressCb->textCanBeEdited())
+		{
+			progressCb->setMethodTitle("Spherical neighbourhoods search");
+			char infosBuffer[256];
+			snprintf(infosBuffer, 256, "Queries: %llu\nRadius: %f", static_cast<unsigned long long>(queryCount), radius);
+			progressCb->setInfo(infosBuffer);
+		}
+		progressCb->update(0);
+		progressCb->start();
+	}
+	NormalizedProgress nprogress(progressCb, static_cast<unsigned>(queryCount));
+
+	//progress is notified by blocks of queries
+	static const unsigned PROGRESS_BLOCK_SIZE = 1024;
+
+	std::vector<IndexChunk> chunks = SplitSortedQueries(sortedQueries, level, multiThread);
+	//each chunk stores its neighbours in its own buffers (we don't know their number in advance)
+	std::vector<NeighboursSet> chunkNeighbours(chunks.size());
+	std::atomic<bool> cancelled(false);
+	std::atomic<bool> error(false);
+
+	const PointCoordinateType& cs = getCellSize(level);
+
+	ForEachChunk(chunks, [&](const IndexChunk& chunk)
+	{
+		try
+		{
+			NeighboursSet& neighbours = chunkNeighbours[chunk.index];
+
+			NearestNeighboursSphericalSearchStruct nNSS;
+			nNSS.level = level;
+			nNSS.prepare(static_cast<PointCoordinateType>(radius), cs);
+			bool cellIsSet = false;
+
+			for (PointIndexType i = chunk.first; i < chunk.last; ++i)
+			{
+				const PointIndexType queryIndex = sortedQueries[i].theIndex;
+				const CCVector3& Q = queryPoints[queryIndex];
+				const std::size_t firstNeighbour = neighbours.size();
+				localOffsets[i] = firstNeighbour;
+
+				Tuple3i cellPos;
+				bool inBounds = false;
+				getTheCellPosWhichIncludesThePoint(&Q, cellPos, level, inBounds);
+
+				if (inBounds)
+				{
+					//if the cell changes, the neighbourhood gathered so far can't be re-used
+					if (!cellIsSet || cellPos.x != nNSS.cellPos.x || cellPos.y != nNSS.cellPos.y || cellPos.z != nNSS.cellPos.z)
+					{
+						nNSS.cellPos = cellPos;
+						computeCellCenter(nNSS.cellPos, level, nNSS.cellCenter);
+						nNSS.pointsInNeighbourhood.resize(0);
+						nNSS.alreadyVisitedNeighbourhoodSize = 0;
+#ifdef TEST_CELLS_FOR_SPHERICAL_NN
+						nNSS.pointsInSphericalNeighbourhood.resize(0);
+						nNSS.cellsInNeighbourhood.resize(0);
+						nNSS.ready = false;
+#endif
+						cellIsSet = true;
+					}
+
+					nNSS.queryPoint = Q;
+					int neighbourCount = findNeighborsInASphereStartingFromCell(nNSS, radius, sortValues);
+					neighbours.insert(neighbours.end(), nNSS.pointsInNeighbourhood.begin(), nNSS.pointsInNeighbourhood.begin() + neighbourCount);
+				}
+				else
+				{
+					//the query point lies outside of the octree (the cell based search can't be used)
+					getPointsInSphericalNeighbourhood(Q, static_cast<PointCoordinateType>(radius), neighbours, level);
+					if (sortValues)
+					{
+						std::sort(neighbours.begin() + firstNeighbour, neighbours.end(), PointDescriptor::distComp);
+					}
+				}
+
+				//we temporarily store the neighbours count
+				result.offsets[queryIndex + 1] = neighbours.size() - firstNeighbour;
+
+				if (progressCb && ((i - chunk.first + 1) % PROGRESS_BLOCK_SIZE) == 0)
+				{
+					if (cancelled || !nprogress.steps(PROGRESS_BLOCK_SIZE))
+					{
+						cancelled = true;
+						break;
+					}
+				}
+			}
+		}
+		catch (const std::bad_alloc&)
+		{
+			//not enough memory
+			error = true;
+		}
+	});
+
+	if (progressCb)
+	{
+		progressCb->stop();
+	}
+
+	if (cancelled || error)
+	{
+		result.clear();
+		return false;
+	}
+
+	//compute the offsets
+	std::size_t neighbourCount = 0;
+	for (PointIndexType i = 0; i < queryCount; ++i)
+	{
+		neighbourCount += result.offsets[i + 1];
+		result.offsets[i + 1] = neighbourCount;
+	}
+
+	try
+	{
+		result.indexes.resize(neighbourCount);
+		result.squareDistances.resize(neighbourCount);
+	}
+	catch (const std::bad_alloc&)
+	{
+		//not enough memory
+		result.clear();
+		return false;
+	}
+
+	//eventually we copy the neighbours in the output buffers
+	ForEachChunk(chunks, [&](const IndexChunk& chunk)
+	{
+		NeighboursSet& neighbours = chunkNeighbours[chunk.index];
+		for (PointIndexType i = chunk.first; i < chunk.last; ++i)
+		{
+			const PointIndexType queryIndex = sortedQueries[i].theIndex;
+			const std::size_t count = result.neighbourCount(queryIndex);
+			NeighboursSet::const_iterator p = neighbours.begin() + localOffsets[i];
+			for (std::size_t j = result.offsets[queryIndex]; j < result.offsets[queryIndex] + count; ++j, ++p)
+			{
+				result.indexes[j] = p->pointIndex;
+				result.squareDistances[j] = p->squareDistd;
+			}
+		}
+		//release memory asap
+		NeighboursSet().swap(neighbours);
+	});
+
+	return true;
+}
+
+unsigned char DgmOctree::findBestLevelForAGivenNeighbourhoodSizeExtraction(PointCoordinateType radius) const
+{
+	static const PointCoordinateType c_neighbourhoodSizeExtractionFactor = static_cast<PointCoordinateType>(2.5);
+	PointCoordinateType aim = std::max<PointCoordinateType>(0, radius / c_neighbourhoodSizeExtractionFactor);
+	
+	int level = 1;
+	PointCoordinateType minValue = getCellSize(1) - aim;
+	minValue *= minValue;
+	for (int i = 2; i <= MAX_OCTREE_LEVEL; ++i)
+	{
+		//we need two points per cell ideally
+		if (m_averageCellPopulation[i] < 1.5)
+			break;
+
+		//The level with cell size as near as possible to the aim
+		PointCoordinateType cellSizeDelta = getCellSize(i) - aim;
+		cellSizeDelta *= cellSizeDelta;
+
+		if (cellSizeDelta < minValue)
+		{
+			level = i;
+			minValue = cellSizeDelta;
+		}
+	}
+
+	return static_cast<unsigned char>(level);
+}
+
+unsigned char DgmOctree::findBestLevelForComparisonWithOctree(const DgmOctree* theOtherOctree) const
+{
+	PointIndexType ptsA = getNumberOfProjectedPoints();
+	PointIndexType ptsB = theOtherOctree->getNumberOfProjectedPoints();
 
 	int maxOctreeLevel = MAX_OCTREE_LEVEL;
 	if (std::min(ptsA,ptsB) < 16)
@@ -2607,7 +3396,7 @@ bool DgmOctree::getCellIndexes(unsigned char level, cellIndexesContainer& vec) c
 }
 
 bool DgmOctree::getPointsInCellByCellIndex(	ReferenceCloud* cloud,
-											unsigned cellIndex,
+											PointIndexType cellIndex,
 											unsigned char level,
 											bool clearOutputCloud/* = true*/) const
 {
@@ -3200,6 +3989,132 @@ int DgmOctree::extractCCs(const cellCodesContainer& cellCodes, unsigned char lev
 
 /*** Octree-based cloud traversal mechanism ***/
 
+//! Set of points of an octree cell
+/** Zero-copy view on a range of the (sorted) octree structure: the indexes
+	of the points are read directly from the DgmOctree::cellsContainer.
+	As soon as the set is modified, the indexes are copied and it behaves
+	as a standard ReferenceCloud.
+**/
+class OctreeCellReferenceCloud : public ReferenceCloud
+{
+public:
+
+	//! Default constructor
+	explicit OctreeCellReferenceCloud(GenericIndexedCloudPersist* associatedCloud)
+		: ReferenceCloud(associatedCloud)
+		, m_codes(nullptr)
+		, m_count(0)
+	{}
+
+	//! Makes the set point to a range of the octree structure
+	inline void setRange(const DgmOctree::IndexAndCode* codes, PointIndexType count)
+	{
+		m_theIndexes.clear();
+		m_codes = codes;
+		m_count = count;
+		m_globalIterator = 0;
+		invalidateBoundingBox();
+	}
+
+	//**** inherited form GenericCloud ****//
+	inline PointIndexType size() const override { return m_codes ? m_count : ReferenceCloud::size(); }
+	void forEach(genericPointAction action) override { detach(); ReferenceCloud::forEach(action); }
+	void getBoundingBox(CCVector3& bbMin, CCVector3& bbMax) override
+	{
+		if (!m_codes)
+		{
+			ReferenceCloud::getBoundingBox(bbMin, bbMax);
+			return;
+		}
+		if (!m_bbox.isValid())
+		{
+			m_bbox.clear();
+			ForEachPoint(this, [this](PointIndexType, const CCVector3& P) { m_bbox.add(P); });
+		}
+		bbMin = m_bbox.minCorner();
+		bbMax = m_bbox.maxCorner();
+	}
+	inline const CCVector3* getNextPoint() override { return (m_globalIterator < size() ? m_theAssociatedCloud->getPoint(getPointGlobalIndex(m_globalIterator++)) : nullptr); }
+	bool getPointsSpan(PointsSpan& span) const override
+	{
+		if (!m_codes)
+		{
+			return ReferenceCloud::getPointsSpan(span);
+		}
+
+		//the indexes are read directly in the octree structure (hence the stride)
+		static_assert(sizeof(DgmOctree::IndexAndCode) % sizeof(PointIndexType) == 0, "Unexpected IndexAndCode layout");
+		PointsSpan parentSpan;
+		if (!m_theAssociatedCloud->getPointsSpan(parentSpan) || parentSpan.indexes)
+		{
+			return false;
+		}
+		span = PointsSpan(parentSpan.points, m_count, &m_codes[0].theIndex, sizeof(DgmOctree::IndexAndCode) / sizeof(PointIndexType));
+		return true;
+	}
+	inline void setPointScalarValue(PointIndexType pointIndex, ScalarType value) override { assert(pointIndex < size()); m_theAssociatedCloud->setPointScalarValue(getPointGlobalIndex(pointIndex), value); }
+	inline ScalarType getPointScalarValue(PointIndexType pointIndex) const override { assert(pointIndex < size()); return m_theAssociatedCloud->getPointScalarValue(getPointGlobalIndex(pointIndex)); }
+
+	//**** inherited form GenericIndexedCloud ****//
+	inline const CCVector3* getPoint(PointIndexType index) override { assert(index < size()); return m_theAssociatedCloud->getPoint(getPointGlobalIndex(index)); }
+	inline void getPoint(PointIndexType index, CCVector3& P) const override { assert(index < size()); m_theAssociatedCloud->getPoint(getPointGlobalIndex(index), P); }
+	inline bool normalsAvailable() const override { return m_theAssociatedCloud && m_theAssociatedCloud->normalsAvailable(); }
+	inline const CCVector3* getNormal(PointIndexType index) const override { assert(index < size()); return m_theAssociatedCloud->getNormal(getPointGlobalIndex(index)); }
+
+	//**** inherited form GenericIndexedCloudPersist ****//
+	inline const CCVector3* getPointPersistentPtr(PointIndexType index) override { assert(index < size()); return m_theAssociatedCloud->getPointPersistentPtr(getPointGlobalIndex(index)); }
+
+	//**** inherited form ReferenceCloud ****//
+	inline PointIndexType getPointGlobalIndex(PointIndexType localIndex) const override { return m_codes ? m_codes[localIndex].theIndex : m_theIndexes[localIndex]; }
+	const CCVector3* getCurrentPointCoordinates() const override { assert(m_globalIterator < size()); return m_theAssociatedCloud->getPointPersistentPtr(getPointGlobalIndex(m_globalIterator)); }
+	inline PointIndexType getCurrentPointGlobalIndex() const override { assert(m_globalIterator < size()); return getPointGlobalIndex(m_globalIterator); }
+	inline ScalarType getCurrentPointScalarValue() const override { assert(m_globalIterator < size()); return m_theAssociatedCloud->getPointScalarValue(getPointGlobalIndex(m_globalIterator)); }
+	inline void setCurrentPointScalarValue(ScalarType value) override { assert(m_globalIterator < size()); m_theAssociatedCloud->setPointScalarValue(getPointGlobalIndex(m_globalIterator), value); }
+	inline PointIndexType capacity() const override { return m_codes ? m_count : ReferenceCloud::capacity(); }
+
+	//modifiers: the indexes must be copied first
+	void clear(bool releaseMemory = false) override { m_codes = nullptr; m_count = 0; ReferenceCloud::clear(releaseMemory); }
+	bool addPointIndex(PointIndexType globalIndex) override { return detach() && ReferenceCloud::addPointIndex(globalIndex); }
+	bool addPointIndex(PointIndexType firstIndex, PointIndexType lastIndex) override { return detach() && ReferenceCloud::addPointIndex(firstIndex, lastIndex); }
+	void setPointIndex(PointIndexType localIndex, PointIndexType globalIndex) override { if (detach()) ReferenceCloud::setPointIndex(localIndex, globalIndex); }
+	bool reserve(PointIndexType n) override { return detach() && ReferenceCloud::reserve(n); }
+	bool resize(PointIndexType n) override { return detach() && ReferenceCloud::resize(n); }
+	inline void swap(PointIndexType i, PointIndexType j) override { if (detach()) ReferenceCloud::swap(i, j); }
+	void removePointGlobalIndex(PointIndexType localIndex) override { if (detach()) ReferenceCloud::removePointGlobalIndex(localIndex); }
+	void setAssociatedCloud(GenericIndexedCloudPersist* cloud) override { if (detach()) ReferenceCloud::setAssociatedCloud(cloud); }
+	bool add(const ReferenceCloud& cloud) override { return detach() && ReferenceCloud::add(cloud); }
+
+protected:
+
+	//! Copies the indexes of the viewed range (if any)
+	bool detach()
+	{
+		if (m_codes)
+		{
+			try
+			{
+				m_theIndexes.resize(m_count);
+			}
+			catch (const std::bad_alloc&)
+			{
+				return false;
+			}
+			for (PointIndexType i = 0; i < m_count; ++i)
+			{
+				m_theIndexes[i] = m_codes[i].theIndex;
+			}
+			m_codes = nullptr;
+			m_count = 0;
+		}
+		return true;
+	}
+
+	//! Viewed range of the octree structure (if any)
+	const DgmOctree::IndexAndCode* m_codes;
+	//! Number of elements in the viewed range
+	PointIndexType m_count;
+};
+
 DgmOctree::octreeCell::octreeCell(const DgmOctree* _parentOctree)
 	: parentOctree(_parentOctree)
 	, truncatedCode(0)
@@ -3209,7 +4124,7 @@ DgmOctree::octreeCell::octreeCell(const DgmOctree* _parentOctree)
 {
 	if (parentOctree && parentOctree->m_theAssociatedCloud)
 	{
-		points = new ReferenceCloud(parentOctree->m_theAssociatedCloud);
+		points = new OctreeCellReferenceCloud(parentOctree->m_theAssociatedCloud);
 	}
 	else
 	{
@@ -3238,74 +4153,310 @@ DgmOctree::octreeCell::~octreeCell()
 
 #include <QtCore>
 #include <QApplication>
-#include <QtConcurrentMap>
 #include <QThreadPool>
+#include <QRunnable>
+
+//system
+#include <memory>
 
 /*** FOR THE MULTI THREADING WRAPPER ***/
 struct octreeCellDesc
 {
 	DgmOctree::CellCode truncatedCode;
-	unsigned i1, i2;
+	PointIndexType i1, i2;
 	unsigned char level;
 };
 
-static DgmOctree* s_octree_MT = nullptr;
-static DgmOctree::octreeCellFunc s_func_MT = nullptr;
-static void** s_userParams_MT = nullptr;
-static GenericProgressCallback* s_progressCb_MT = nullptr;
-static NormalizedProgress* s_normProgressCb_MT = nullptr;
-static bool s_cellFunc_MT_success = true;
+//! Batch of consecutive cells (scheduling unit)
+struct octreeCellBatch
+{
+	//! First cell (index in the cell descriptors vector)
+	std::size_t firstCell;
+	//! Last cell (excluded)
+	std::size_t lastCell;
+};
 
-void LaunchOctreeCellFunc_MT(const octreeCellDesc& desc)
+//! Number of batches per thread (for load balancing)
+static const unsigned BATCHES_PER_THREAD = 32;
+
+//! Execution context of a multi-threaded octree traversal
+/** One instance is created for each call to executeFunctionForAllCellsAtLevel
+	or executeFunctionForAllCellsStartingAtLevel. As all the state of a traversal
+	lives here (and not in static variables) several traversals can run at the
+	same time, on the same octree or on different ones.
+
+	The cells are first grouped in batches of similar cost (the cost of a cell
+	being estimated by its population): small cells are grouped together so as
+	to amortize the scheduling overhead, while heavy cells get their own batch.
+
+	Scheduling is then based on work stealing: each worker starts with a contiguous
+	range of batches (so as to preserve the spatial coherence of its memory accesses)
+	and, once it is exhausted, steals the second half of the range of another worker.
+	The workers run on a private thread pool: the global Qt thread pool is left
+	untouched.
+**/
+class OctreeCellFuncContext_MT
 {
-	//skip cell if process is aborted/has failed
-	if (!s_cellFunc_MT_success)
+public:
+
+	//! Default constructor
+	OctreeCellFuncContext_MT(	const DgmOctree* octree,
+								const std::vector<octreeCellDesc>& cells,
+								DgmOctree::octreeCellFunc func,
+								void** userParams,
+								GenericProgressCallback* progressCb,
+								NormalizedProgress* normProgressCb,
+								double averageCellPopulation)
+		: m_octree(octree)
+		, m_cells(cells)
+		, m_func(func)
+		, m_userParams(userParams)
+		, m_progressCb(progressCb)
+		, m_normProgressCb(normProgressCb)
+		, m_averageCellPopulation(averageCellPopulation)
+		, m_success(true)
+		, m_workerCount(0)
+	{}
+
+	//! Applies the cell function to all cells
+	/** \param maxThreadCount max number of threads (the calling thread included)
+		\return success
+	**/
+	bool run(int maxThreadCount)
 	{
-		return;
+		if (m_cells.empty())
+		{
+			return true;
+		}
+
+		unsigned threadCount = static_cast<unsigned>(std::max(1, maxThreadCount));
+
+		//target population of a batch: enough batches per thread for a good load
+		//balancing, but not less than an average cell
+		PointIndexType pointCount = m_cells.back().i2 + 1;
+		PointIndexType targetPopulation = pointCount / (threadCount * BATCHES_PER_THREAD);
+		targetPopulation = std::max(targetPopulation, static_cast<PointIndexType>(ceil(m_averageCellPopulation)));
+		if (!buildBatches(std::max<PointIndexType>(targetPopulation, 1)))
+		{
+			return false;
+		}
+
+		m_workerCount = std::min(threadCount, static_cast<unsigned>(m_batches.size()));
+
+		//initial distribution: one contiguous range of batches per worker
+		m_ranges.reset(new std::atomic<unsigned long long>[m_workerCount]);
+		const std::size_t batchCount = m_batches.size();
+		for (unsigned i = 0; i < m_workerCount; ++i)
+		{
+			unsigned first = static_cast<unsigned>((batchCount * i) / m_workerCount);
+			unsigned last = static_cast<unsigned>((batchCount * (i + 1)) / m_workerCount);
+			m_ranges[i].store(PackRange(first, last));
+		}
+
+		//the calling thread is worker #0, the others run on a private pool
+		QThreadPool pool;
+		pool.setMaxThreadCount(static_cast<int>(m_workerCount) - 1);
+		for (unsigned i = 1; i < m_workerCount; ++i)
+		{
+			pool.start(new Worker(*this, i));
+		}
+		work(0);
+		pool.waitForDone();
+
+		return m_success;
 	}
 
-	const DgmOctree::cellsContainer& pointsAndCodes = s_octree_MT->pointsAndTheirCellCodes();
+protected:
 
-	//cell descriptor
-	DgmOctree::octreeCell cell(s_octree_MT);
-	cell.level = desc.level;
-	cell.index = desc.i1;
-	cell.truncatedCode = desc.truncatedCode;
-	if (cell.points->reserve(desc.i2 - desc.i1 + 1))
+	//! Worker (QRunnable wrapper)
+	class Worker : public QRunnable
 	{
-		for (unsigned i = desc.i1; i <= desc.i2; ++i)
+	public:
+		Worker(OctreeCellFuncContext_MT& context, unsigned index) : m_context(context), m_index(index) {}
+		void run() override { m_context.work(m_index); }
+	protected:
+		OctreeCellFuncContext_MT& m_context;
+		unsigned m_index;
+	};
+
+	//! Groups the cells in batches
+	/** Consecutive cells are grouped until the batch population reaches
+		the target population. A cell that is more populated than the target
+		population is never grouped with others.
+		\param targetPopulation target batch population
+		\return success
+	**/
+	bool buildBatches(PointIndexType targetPopulation)
+	{
+		m_batches.clear();
+		try
+		{
+			m_batches.reserve(std::min<std::size_t>(m_cells.size(), (m_cells.back().i2 + 1) / targetPopulation + 1));
+
+			octreeCellBatch batch;
+			batch.firstCell = 0;
+			PointIndexType batchPopulation = 0;
+			for (std::size_t i = 0; i < m_cells.size(); ++i)
+			{
+				PointIndexType cellPopulation = m_cells[i].i2 - m_cells[i].i1 + 1;
+				if (cellPopulation >= targetPopulation && batchPopulation != 0)
+				{
+					//heavy cell: we close the current batch first
+					batch.lastCell = i;
+					m_batches.push_back(batch);
+					batch.firstCell = i;
+					batchPopulation = 0;
+				}
+
+				batchPopulation += cellPopulation;
+				if (batchPopulation >= targetPopulation)
+				{
+					batch.lastCell = i + 1;
+					m_batches.push_back(batch);
+					batch.firstCell = i + 1;
+					batchPopulation = 0;
+				}
+			}
+			//last (incomplete) batch
+			if (batchPopulation != 0)
+			{
+				batch.lastCell = m_cells.size();
+				m_batches.push_back(batch);
+			}
+		}
+		catch (const std::bad_alloc&)
 		{
-			cell.points->addPointIndex(pointsAndCodes[i].theIndex);
+			//not enough memory
+			return false;
 		}
 
-		s_cellFunc_MT_success &= (*s_func_MT)(cell, s_userParams_MT, s_normProgressCb_MT);
+		return true;
 	}
-	else
+
+	//! Packs a [first ; last[ range of batches in a single (atomic) value
+	static inline unsigned long long PackRange(unsigned first, unsigned last) { return (static_cast<unsigned long long>(first) << 32) | last; }
+	//! Range start
+	static inline unsigned RangeFirst(unsigned long long range) { return static_cast<unsigned>(range >> 32); }
+	//! Range end (excluded)
+	static inline unsigned RangeLast(unsigned long long range) { return static_cast<unsigned>(range & 0xFFFFFFFF); }
+
+	//! Pops the next batch of a worker's own range
+	bool popFront(unsigned workerIndex, unsigned& batchIndex)
 	{
-		s_cellFunc_MT_success = false;
+		std::atomic<unsigned long long>& range = m_ranges[workerIndex];
+		unsigned long long current = range.load();
+		while (RangeFirst(current) < RangeLast(current))
+		{
+			if (range.compare_exchange_weak(current, PackRange(RangeFirst(current) + 1, RangeLast(current))))
+			{
+				batchIndex = RangeFirst(current);
+				return true;
+			}
+		}
+		return false;
 	}
 
-	if (!s_cellFunc_MT_success)
+	//! Steals the second half of the range of another worker
+	/** The stolen range becomes the new range of the thief.
+		\return false if there's nothing left to steal
+	**/
+	bool steal(unsigned thiefIndex)
 	{
-		//TODO: display a message to make clear that the cancel order has been acknowledged!
-		if (s_progressCb_MT)
+		for (unsigned j = 1; j < m_workerCount; ++j)
 		{
-			if (s_progressCb_MT->textCanBeEdited())
+			std::atomic<unsigned long long>& victim = m_ranges[(thiefIndex + j) % m_workerCount];
+			unsigned long long current = victim.load();
+			while (RangeFirst(current) < RangeLast(current))
 			{
-				s_progressCb_MT->setInfo("Cancelling...");
+				unsigned first = RangeFirst(current);
+				unsigned last = RangeLast(current);
+				unsigned middle = first + (last - first) / 2;
+				if (victim.compare_exchange_weak(current, PackRange(first, middle)))
+				{
+					m_ranges[thiefIndex].store(PackRange(middle, last));
+					return true;
+				}
 			}
 		}
+		return false;
+	}
 
-		//if (s_normProgressCb_MT)
-		//{
-		//	if (!s_normProgressCb_MT->oneStep())
-		//	{
-		//		s_cellFunc_MT_success = false;
-		//		return;
-		//	}
-		//}
+	//! Worker loop
+	void work(unsigned workerIndex)
+	{
+		//each worker reuses the same cell structure for all its cells
+		DgmOctree::octreeCell cell(m_octree);
+		OctreeCellReferenceCloud* cellPoints = static_cast<OctreeCellReferenceCloud*>(cell.points);
+
+		const DgmOctree::cellsContainer& pointsAndCodes = m_octree->pointsAndTheirCellCodes();
+
+		unsigned batchIndex = 0;
+		while (m_success)
+		{
+			if (!popFront(workerIndex, batchIndex))
+			{
+				if (!steal(workerIndex))
+				{
+					//nothing left
+					break;
+				}
+				continue;
+			}
+
+			const octreeCellBatch& batch = m_batches[batchIndex];
+			for (std::size_t i = batch.firstCell; i < batch.lastCell && m_success; ++i)
+			{
+				const octreeCellDesc& desc = m_cells[i];
+				cell.level = desc.level;
+				cell.index = desc.i1;
+				cell.truncatedCode = desc.truncatedCode;
+				//zero-copy: the cell points directly to the octree structure
+				cellPoints->setRange(&pointsAndCodes[desc.i1], desc.i2 - desc.i1 + 1);
+
+				if (!(*m_func)(cell, m_userParams, m_normProgressCb))
+				{
+					cancel();
+				}
+			}
+		}
+	}
+
+	//! Stops the process (on error or user request)
+	void cancel()
+	{
+		if (m_success.exchange(false))
+		{
+			//TODO: display a message to make clear that the cancel order has been acknowledged!
+			if (m_progressCb && m_progressCb->textCanBeEdited())
+			{
+				m_progressCb->setInfo("Cancelling...");
+			}
+		}
 	}
-}
+
+	//! Octree
+	const DgmOctree* m_octree;
+	//! Cells to process
+	const std::vector<octreeCellDesc>& m_cells;
+	//! Batches of cells
+	std::vector<octreeCellBatch> m_batches;
+	//! Function to apply
+	DgmOctree::octreeCellFunc m_func;
+	//! Function parameters
+	void** m_userParams;
+	//! Progress callback
+	GenericProgressCallback* m_progressCb;
+	//! Normalized progress callback (passed to the cell function)
+	NormalizedProgress* m_normProgressCb;
+	//! Average cell population (cost model)
+	double m_averageCellPopulation;
+	//! Whether the process should go on
+	std::atomic<bool> m_success;
+	//! Number of workers
+	unsigned m_workerCount;
+	//! Remaining range of batches of each worker
+	std::unique_ptr<std::atomic<unsigned long long>[]> m_ranges;
+};
 
 #endif
 
@@ -3322,7 +4473,7 @@ unsigned DgmOctree::executeFunctionForAllCellsAtLevel(	unsigned char level,
 
 #ifdef ENABLE_MT_OCTREE
 
-	//cells that will be processed by QtConcurrent::map
+	//cells that will be processed in parallel
 	const unsigned cellsNumber = getCellNumber(level);
 	std::vector<octreeCellDesc> cells;
 
@@ -3343,15 +4494,12 @@ unsigned DgmOctree::executeFunctionForAllCellsAtLevel(	unsigned char level,
 	if (!multiThread)
 #endif
 	{
-		//we get the maximum cell population for this level
-		unsigned maxCellPopulation = m_maxCellPopulation[level];
-
 		//cell descriptor (initialize it with first cell/point)
 		octreeCell cell(this);
-		if (!cell.points->reserve(maxCellPopulation)) //not enough memory
-			return 0;
 		cell.level = level;
 		cell.index = 0;
+		//the cell points directly to the octree structure (zero-copy)
+		OctreeCellReferenceCloud* cellPoints = static_cast<OctreeCellReferenceCloud*>(cell.points);
 
 		//binary shift for cell code truncation
 		unsigned char bitDec = GET_BIT_SHIFT(level);
@@ -3361,7 +4509,6 @@ unsigned DgmOctree::executeFunctionForAllCellsAtLevel(	unsigned char level,
 
 		//init with first cell
 		cell.truncatedCode = (p->theCode >> bitDec);
-		cell.points->addPointIndex(p->theIndex); //can't fail (see above)
 		++p;
 
 		//number of cells for this level
@@ -3377,7 +4524,7 @@ unsigned DgmOctree::executeFunctionForAllCellsAtLevel(	unsigned char level,
 					progressCb->setMethodTitle(functionTitle);
 				}
 				char buffer[512];
-				sprintf(buffer, "Octree level %i\nCells: %u\nMean population: %3.2f (+/-%3.2f)\nMax population: %u", level, cellCount, m_averageCellPopulation[level], m_stdDevCellPopulation[level], m_maxCellPopulation[level]);
+				sprintf(buffer, "Octree level %i\nCells: %u\nMean population: %3.2f (+/-%3.2f)\nMax population: %llu", level, cellCount, m_averageCellPopulation[level], m_stdDevCellPopulation[level], static_cast<unsigned long long>(m_maxCellPopulation[level]));
 				progressCb->setInfo(buffer);
 			}
 			progressCb->update(0);
@@ -3402,14 +4549,15 @@ unsigned DgmOctree::executeFunctionForAllCellsAtLevel(	unsigned char level,
 			if (nextCode != cell.truncatedCode)
 			{
 				//if not, we call the user function on the previous cell
+				unsigned cellEnd = static_cast<unsigned>(p - m_thePointsAndTheirCellCodes.begin());
+				cellPoints->setRange(&m_thePointsAndTheirCellCodes[cell.index], cellEnd - cell.index);
 				result = (*func)(cell, additionalParameters, &nprogress);
 
 				if (!result)
 					break;
 
 				//and we start a new cell
-				cell.index += cell.points->size();
-				cell.points->clear();
+				cell.index = cellEnd;
 				cell.truncatedCode = nextCode;
 
 				//if (!nprogress.oneStep())
@@ -3419,13 +4567,14 @@ unsigned DgmOctree::executeFunctionForAllCellsAtLevel(	unsigned char level,
 				//	break;
 				//}
 			}
-
-			cell.points->addPointIndex(p->theIndex); //can't fail (see above)
 		}
 
 		//don't forget last cell!
 		if (result)
+		{
+			cellPoints->setRange(&m_thePointsAndTheirCellCodes[cell.index], static_cast<PointIndexType>(m_thePointsAndTheirCellCodes.size()) - cell.index);
 			result = (*func)(cell, additionalParameters, &nprogress);
+		}
 
 #ifdef COMPUTE_NN_SEARCH_STATISTICS
 		FILE* fp=fopen("octree_log.txt","at");
@@ -3481,19 +4630,8 @@ unsigned DgmOctree::executeFunctionForAllCellsAtLevel(	unsigned char level,
 		//don't forget the last cell!
 		cells.push_back(cellDesc);
 
-		//static wrap
-		s_octree_MT = this;
-		s_func_MT = func;
-		s_userParams_MT = additionalParameters;
-		s_cellFunc_MT_success = true;
-		s_progressCb_MT = progressCb;
-		if (s_normProgressCb_MT)
-		{
-			delete s_normProgressCb_MT;
-			s_normProgressCb_MT = 0;
-		}
-
 		//progress notification
+		std::unique_ptr<NormalizedProgress> nProgress;
 		if (progressCb)
 		{
 			if (progressCb->textCanBeEdited())
@@ -3503,11 +4641,11 @@ unsigned DgmOctree::executeFunctionForAllCellsAtLevel(	unsigned char level,
 					progressCb->setMethodTitle(functionTitle);
 				}
 				char buffer[512];
-				sprintf(buffer, "Octree level %i\nCells: %i\nAverage population: %3.2f (+/-%3.2f)\nMax population: %u", level, static_cast<int>(cells.size()), m_averageCellPopulation[level], m_stdDevCellPopulation[level], m_maxCellPopulation[level]);
+				sprintf(buffer, "Octree level %i\nCells: %i\nAverage population: %3.2f (+/-%3.2f)\nMax population: %llu", level, static_cast<int>(cells.size()), m_averageCellPopulation[level], m_stdDevCellPopulation[level], static_cast<unsigned long long>(m_maxCellPopulation[level]));
 				progressCb->setInfo(buffer);
 			}
 			progressCb->update(0);
-			s_normProgressCb_MT = new NormalizedProgress(progressCb,m_theAssociatedCloud->size());
+			nProgress.reset(new NormalizedProgress(progressCb, m_theAssociatedCloud->size()));
 			progressCb->start();
 		}
 
@@ -3522,8 +4660,8 @@ unsigned DgmOctree::executeFunctionForAllCellsAtLevel(	unsigned char level,
 		{
 			maxThreadCount = QThread::idealThreadCount();
 		}
-		QThreadPool::globalInstance()->setMaxThreadCount(maxThreadCount);
-		QtConcurrent::blockingMap(cells, LaunchOctreeCellFunc_MT);
+		OctreeCellFuncContext_MT context(this, cells, func, additionalParameters, progressCb, nProgress.get(), m_averageCellPopulation[level]);
+		bool success = context.run(maxThreadCount);
 
 #ifdef COMPUTE_NN_SEARCH_STATISTICS
 		FILE* fp = fopen("octree_log.txt", "at");
@@ -3540,21 +4678,13 @@ unsigned DgmOctree::executeFunctionForAllCellsAtLevel(	unsigned char level,
 		}
 #endif
 
-		s_octree_MT = nullptr;
-		s_func_MT = nullptr;
-		s_userParams_MT = nullptr;
-
 		if (progressCb)
 		{
 			progressCb->stop();
-			if (s_normProgressCb_MT)
-				delete s_normProgressCb_MT;
-			s_normProgressCb_MT = nullptr;
-			s_progressCb_MT = nullptr;
 		}
 
 		//if something went wrong, we clear everything and return 0!
-		if (!s_cellFunc_MT_success)
+		if (!success)
 			cells.clear();
 
 		return static_cast<unsigned>(cells.size());
@@ -3583,7 +4713,7 @@ unsigned DgmOctree::executeFunctionForAllCellsStartingAtLevel(unsigned char star
 
 #ifdef ENABLE_MT_OCTREE
 
-	//cells that will be processed by QtConcurrent::map
+	//cells that will be processed in parallel
 	std::vector<octreeCellDesc> cells;
 	if (multiThread)
 	{
@@ -3602,15 +4732,12 @@ unsigned DgmOctree::executeFunctionForAllCellsStartingAtLevel(unsigned char star
 	if (!multiThread)
 #endif
 	{
-		//we get the maximum cell population for this level
-		unsigned maxCellPopulation = m_maxCellPopulation[startingLevel];
-
 		//cell descriptor
 		octreeCell cell(this);
-		if (!cell.points->reserve(maxCellPopulation)) //not enough memory
-			return 0;
 		cell.level = startingLevel;
 		cell.index = 0;
+		//the cell points directly to the octree structure (zero-copy)
+		OctreeCellReferenceCloud* cellPoints = static_cast<OctreeCellReferenceCloud*>(cell.points);
 
 		//progress notification
 		if (progressCb)
@@ -3622,12 +4749,12 @@ unsigned DgmOctree::executeFunctionForAllCellsStartingAtLevel(unsigned char star
 					progressCb->setMethodTitle(functionTitle);
 				}
 				char buffer[1024];
-				sprintf(buffer, "Octree levels %i - %i\nCells: %i - %i\nAverage population: %3.2f (+/-%3.2f) - %3.2f (+/-%3.2f)\nMax population: %u - %u",
+				sprintf(buffer, "Octree levels %i - %i\nCells: %i - %i\nAverage population: %3.2f (+/-%3.2f) - %3.2f (+/-%3.2f)\nMax population: %llu - %llu",
 					startingLevel, MAX_OCTREE_LEVEL,
 					getCellNumber(startingLevel), getCellNumber(MAX_OCTREE_LEVEL),
 					m_averageCellPopulation[startingLevel], m_stdDevCellPopulation[startingLevel],
 					m_averageCellPopulation[MAX_OCTREE_LEVEL], m_stdDevCellPopulation[MAX_OCTREE_LEVEL],
-					m_maxCellPopulation[startingLevel], m_maxCellPopulation[MAX_OCTREE_LEVEL]);
+					static_cast<unsigned long long>(m_maxCellPopulation[startingLevel]), static_cast<unsigned long long>(m_maxCellPopulation[MAX_OCTREE_LEVEL]));
 				progressCb->setInfo(buffer);
 			}
 			progressCb->update(0);
@@ -3657,7 +4784,7 @@ unsigned DgmOctree::executeFunctionForAllCellsStartingAtLevel(unsigned char star
 			//new cell
 			cell.truncatedCode = (startingElement->theCode >> currentBitDec);
 			//we can already 'add' (virtually) the first point to the current cell description struct
-			unsigned elements = 1;
+			PointIndexType elements = 1;
 
 			//progress notification
 #ifndef ENABLE_DOWN_TOP_TRAVERSAL
@@ -3801,18 +4928,8 @@ unsigned DgmOctree::executeFunctionForAllCellsStartingAtLevel(unsigned char star
 			}
 
 			//we can now really 'add' the points to the cell descriptor
-			cell.points->clear();
-			//DGM: already done earlier
-			/*if (!cell.points->reserve(elements)) //not enough memory
-			{
-			result=false;
-			break;
-			}
-			*/
-			for (unsigned i = 0; i < elements; ++i)
-			{
-				cell.points->addPointIndex((startingElement++)->theIndex);
-			}
+			cellPoints->setRange(&(*startingElement), elements);
+			startingElement += elements;
 
 			//call user method on current cell
 			result = (*func)(cell, additionalParameters,
@@ -3882,7 +4999,7 @@ unsigned DgmOctree::executeFunctionForAllCellsStartingAtLevel(unsigned char star
 			//new cell
 			cellDesc.truncatedCode = (startingElement->theCode >> currentBitDec);
 			//we can already 'add' (virtually) the first point to the current cell description struct
-			unsigned elements = 1;
+			PointIndexType elements = 1;
 
 			//let's test the following points
 			for (cellsContainer::const_iterator p = startingElement+1; p != m_thePointsAndTheirCellCodes.end(); ++p)
@@ -4006,7 +5123,7 @@ unsigned DgmOctree::executeFunctionForAllCellsStartingAtLevel(unsigned char star
 			cellDesc.i2 = cellDesc.i1 + (elements-1);
 			cells.push_back(cellDesc);
 			popSum += static_cast<unsigned long long>(elements);
-			popSum2 += static_cast<unsigned long long>(elements*elements);
+			popSum2 += static_cast<unsigned long long>(elements) * elements;
 			if (maxPop < elements)
 				maxPop = elements;
 
@@ -4030,16 +5147,8 @@ unsigned DgmOctree::executeFunctionForAllCellsStartingAtLevel(unsigned char star
 		double mean = static_cast<double>(popSum) / cells.size();
 		double stddev = sqrt(static_cast<double>(popSum2 - popSum*popSum)) / cells.size();
 
-		//static wrap
-		s_octree_MT = this;
-		s_func_MT = func;
-		s_userParams_MT = additionalParameters;
-		s_cellFunc_MT_success = true;
-		if (s_normProgressCb_MT)
-			delete s_normProgressCb_MT;
-		s_normProgressCb_MT = nullptr;
-
 		//progress notification
+		std::unique_ptr<NormalizedProgress> nProgress;
 		if (progressCb)
 		{
 			if (progressCb->textCanBeEdited())
@@ -4052,11 +5161,7 @@ unsigned DgmOctree::executeFunctionForAllCellsStartingAtLevel(unsigned char star
 				sprintf(buffer, "Octree levels %i - %i\nCells: %i\nAverage population: %3.2f (+/-%3.2f)\nMax population: %llu", startingLevel, MAX_OCTREE_LEVEL, static_cast<int>(cells.size()), mean, stddev, maxPop);
 				progressCb->setInfo(buffer);
 			}
-			if (s_normProgressCb_MT)
-			{
-				delete s_normProgressCb_MT;
-			}
-			s_normProgressCb_MT = new NormalizedProgress(progressCb,static_cast<unsigned>(cells.size()));
+			nProgress.reset(new NormalizedProgress(progressCb, static_cast<unsigned>(cells.size())));
 			progressCb->update(0);
 			progressCb->start();
 		}
@@ -4072,8 +5177,8 @@ unsigned DgmOctree::executeFunctionForAllCellsStartingAtLevel(unsigned char star
 		{
 			maxThreadCount = QThread::idealThreadCount();
 		}
-		QThreadPool::globalInstance()->setMaxThreadCount(maxThreadCount);
-		QtConcurrent::blockingMap(cells, LaunchOctreeCellFunc_MT);
+		OctreeCellFuncContext_MT context(this, cells, func, additionalParameters, progressCb, nProgress.get(), mean);
+		bool success = context.run(maxThreadCount);
 
 #ifdef COMPUTE_NN_SEARCH_STATISTICS
 		FILE* fp=fopen("octree_log.txt","at");
@@ -4090,20 +5195,13 @@ unsigned DgmOctree::executeFunctionForAllCellsStartingAtLevel(unsigned char star
 		}
 #endif
 
-		s_octree_MT = nullptr;
-		s_func_MT = nullptr;
-		s_userParams_MT = nullptr;
-
 		if (progressCb)
 		{
 			progressCb->stop();
-			if (s_normProgressCb_MT)
-				delete s_normProgressCb_MT;
-			s_normProgressCb_MT = nullptr;
 		}
 
 		//if something went wrong, we clear everything and return 0!
-		if (!s_cellFunc_MT_success)
+		if (!success)
 			cells.resize(0);
 
 		return static_cast<unsigned>(cells.size());
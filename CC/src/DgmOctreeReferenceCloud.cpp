@@ -20,11 +20,11 @@
 
 using namespace CCLib;
 
-DgmOctreeReferenceCloud::DgmOctreeReferenceCloud(DgmOctree::NeighboursSet* associatedSet, unsigned size/*=0*/)
+DgmOctreeReferenceCloud::DgmOctreeReferenceCloud(DgmOctree::NeighboursSet* associatedSet, PointIndexType size/*=0*/)
 	: m_globalIterator(0)
 	, m_validBB(false)
 	, m_set(associatedSet)
-	, m_size(size == 0 && associatedSet ? static_cast<unsigned>(m_set->size()) : size)
+	, m_size(size == 0 && associatedSet ? static_cast<PointIndexType>(m_set->size()) : size)
 {
 	assert(associatedSet);
 }
@@ -32,7 +32,7 @@ DgmOctreeReferenceCloud::DgmOctreeReferenceCloud(DgmOctree::NeighboursSet* assoc
 void DgmOctreeReferenceCloud::computeBB()
 {
 	//empty cloud?!
-	unsigned count = size();
+	PointIndexType count = size();
 	if (count)
 	{
 		m_bbMin = m_bbMax = CCVector3(0,0,0);
@@ -42,7 +42,7 @@ void DgmOctreeReferenceCloud::computeBB()
 	//initialize BBox with first point
 	m_bbMin = m_bbMax = *m_set->at(0).point;
 
-	for (unsigned i=1; i<count; ++i)
+	for (PointIndexType i=1; i<count; ++i)
 	{
 		const CCVector3& P = *m_set->at(i).point;
 		//X boundaries
@@ -78,8 +78,8 @@ void DgmOctreeReferenceCloud::getBoundingBox(CCVector3& bbMin, CCVector3& bbMax)
 
 void DgmOctreeReferenceCloud::forEach(genericPointAction action)
 {
-	unsigned count = size();
-	for (unsigned i=0; i<count; ++i)
+	PointIndexType count = size();
+	for (PointIndexType i=0; i<count; ++i)
 	{
 		//we must change from double container to 'ScalarType' one!
 		ScalarType sqDist = static_cast<ScalarType>(m_set->at(i).squareDistd);
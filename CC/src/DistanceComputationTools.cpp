@@ -23,6 +23,7 @@
 #include <FastMarchingForPropagation.h>
 #include <LocalModel.h>
 #include <PointCloud.h>
+#include <PointsSpan.h>
 #include <ReferenceCloud.h>
 #include <SaitoSquaredDistanceTransform.h>
 #include <ScalarField.h>
@@ -267,8 +268,8 @@ DistanceComputationTools::SOReturnCode
 {
 	assert(comparedCloud && referenceCloud);
 
-	unsigned nA = comparedCloud->size();
-	unsigned nB = referenceCloud->size();
+	PointIndexType nA = comparedCloud->size();
+	PointIndexType nB = referenceCloud->size();
 
 	if (nA == 0 || nB == 0)
 		return EMPTY_CLOUD;
@@ -428,8 +429,8 @@ bool DistanceComputationTools::computeCellHausdorffDistance(const DgmOctree::oct
 	referenceOctree->computeCellCenter(nNSS.cellPos, cell.level, nNSS.cellCenter);
 
 	//for each point of the current cell (compared octree) we look for its nearest neighbour in the reference cloud
-	unsigned pointCount = cell.points->size();
-	for (unsigned i = 0; i < pointCount; i++)
+	PointIndexType pointCount = cell.points->size();
+	for (PointIndexType i = 0; i < pointCount; i++)
 	{
 		cell.points->getPoint(i, nNSS.queryPoint);
 
@@ -451,7 +452,7 @@ bool DistanceComputationTools::computeCellHausdorffDistance(const DgmOctree::oct
 					CCVector3 P;
 					referenceCloud->getPoint(nNSS.theNearestPointIndex, P);
 					
-					unsigned index = cell.points->getPointGlobalIndex(i);
+					PointIndexType index = cell.points->getPointGlobalIndex(i);
 					if (params->splitDistances[0])
 						params->splitDistances[0]->setValue(index, static_cast<ScalarType>(nNSS.queryPoint.x - P.x));
 					if (params->splitDistances[1])
@@ -525,8 +526,8 @@ bool DistanceComputationTools::computeCellHausdorffDistanceWithLocalModel(	const
 	std::vector<const LocalModel*> models;
 
 	//for each point of the current cell (compared octree) we look for its nearest neighbour in the reference cloud
-	unsigned pointCount = cell.points->size();
-	for (unsigned i = 0; i < pointCount; ++i)
+	PointIndexType pointCount = cell.points->size();
+	for (PointIndexType i = 0; i < pointCount; ++i)
 	{
 		//distance of the current point
 		ScalarType distPt = NAN_VALUE;
@@ -665,7 +666,7 @@ bool DistanceComputationTools::computeCellHausdorffDistanceWithLocalModel(	const
 
 					if (computeSplitDistances)
 					{
-						unsigned index = cell.points->getPointGlobalIndex(i);
+						PointIndexType index = cell.points->getPointGlobalIndex(i);
 						if (params->splitDistances[0])
 							params->splitDistances[0]->setValue(index, static_cast<ScalarType>(nNSS.queryPoint.x - nearestPoint.x));
 						if (params->splitDistances[1])
@@ -970,7 +971,7 @@ int DistanceComputationTools::intersectMeshWithOctree(	OctreeAndMeshIntersection
 
 //! Method used by computeCloud2MeshDistanceWithOctree
 void ComparePointsAndTriangles(	ReferenceCloud& Yk,
-								unsigned& remainingPoints,
+								PointIndexType& remainingPoints,
 								CCLib::GenericIndexedMesh* mesh,
 								std::vector<unsigned>& trianglesToTest,
 								std::size_t& trianglesToTestCount,
@@ -1112,7 +1113,7 @@ void cloudMeshDistCellFunc_MT(const DgmOctree::IndexAndCode& desc)
 	s_octree_MT->getPointsInCellByCellIndex(&Yk, desc.theIndex, s_params_MT.octreeLevel);
 
 	//min distance array
-	unsigned remainingPoints = Yk.size();
+	PointIndexType remainingPoints = Yk.size();
 
 	std::vector<ScalarType> minDists;
 	try
@@ -1155,7 +1156,7 @@ void cloudMeshDistCellFunc_MT(const DgmOctree::IndexAndCode& desc)
 			maxDistance = s_params_MT.maxSearchDist*s_params_MT.maxSearchDist;
 		}
 
-		for (unsigned j = 0; j < remainingPoints; ++j)
+		for (PointIndexType j = 0; j < remainingPoints; ++j)
 			Yk.setPointScalarValue(j, maxDistance);
 	}
 
@@ -1196,7 +1197,7 @@ void cloudMeshDistCellFunc_MT(const DgmOctree::IndexAndCode& desc)
 	//for each point, we pre-compute its distance to the nearest cell border
 	//(will be handy later)
 	Yk.placeIteratorAtBeginning();
-	for (unsigned j = 0; j<remainingPoints; ++j)
+	for (PointIndexType j = 0; j<remainingPoints; ++j)
 	{
 		//coordinates of the current point
 		const CCVector3 *tempPt = Yk.getCurrentPointCoordinates();
@@ -1427,8 +1428,8 @@ int DistanceComputationTools::computeCloud2MeshDistanceWithOctree(	OctreeAndMesh
 					maxRadius = params.maxSearchDist;
 				}
 
-				unsigned count = Yk.size();
-				for (unsigned j = 0; j < count; ++j)
+				PointIndexType count = Yk.size();
+				for (PointIndexType j = 0; j < count; ++j)
 				{
 					Yk.setPointScalarValue(j, maxRadius);
 				}
@@ -1511,7 +1512,7 @@ int DistanceComputationTools::computeCloud2MeshDistanceWithOctree(	OctreeAndMesh
 			startPos -= intersection->minFillIndexes;
 
 			//minDists.clear(); //not necessary 
-			unsigned remainingPoints = Yk.size();
+			PointIndexType remainingPoints = Yk.size();
 			if (minDists.size() < remainingPoints)
 			{
 				try
@@ -1527,7 +1528,7 @@ int DistanceComputationTools::computeCloud2MeshDistanceWithOctree(	OctreeAndMesh
 
 			//for each point, we pre-compute its distance to the nearest cell border
 			//(will be handy later)
-			for (unsigned j = 0; j < remainingPoints; ++j)
+			for (PointIndexType j = 0; j < remainingPoints; ++j)
 			{
 				const CCVector3 *tempPt = Yk.getPointPersistentPtr(j);
 				minDists[j] = static_cast<ScalarType>(DgmOctree::ComputeMinDistanceToCellBorder(*tempPt, cellLength, cellCenter));
@@ -1547,7 +1548,7 @@ int DistanceComputationTools::computeCloud2MeshDistanceWithOctree(	OctreeAndMesh
 					maxDistance = params.maxSearchDist*params.maxSearchDist;
 				}
 				
-				for (unsigned j = 0; j < remainingPoints; ++j)
+				for (PointIndexType j = 0; j < remainingPoints; ++j)
 					Yk.setPointScalarValue(j, maxDistance);
 			}
 
@@ -2157,7 +2158,7 @@ ScalarType DistanceComputationTools::computeCloud2PlaneDistanceRMS(	GenericCloud
     assert(cloud && planeEquation);
 
 	//point count
-	unsigned count = cloud->size();
+	PointIndexType count = cloud->size();
 	if (count == 0)
 		return 0;
 
@@ -2171,14 +2172,13 @@ ScalarType DistanceComputationTools::computeCloud2PlaneDistanceRMS(	GenericCloud
 	double dSumSq = 0.0;
 
 	//compute deviations
-	cloud->placeIteratorAtBeginning();
-	for (unsigned i=0; i<count; ++i)
+	const CCVector3 N(planeEquation);
+	ForEachPoint(cloud, [&](PointIndexType, const CCVector3& P)
 	{
-		const CCVector3* P = cloud->getNextPoint();
-		double d = static_cast<double>(CCVector3::vdot(P->u,planeEquation) - planeEquation[3])/*/norm*/; //norm == 1.0
+		double d = static_cast<double>(P.dot(N) - planeEquation[3])/*/norm*/; //norm == 1.0
 		
 		dSumSq += d*d;
-	}
+	});
 
 	return static_cast<ScalarType>( sqrt(dSumSq/count) );
 }
@@ -2191,7 +2191,7 @@ ScalarType DistanceComputationTools::ComputeCloud2PlaneRobustMax(	GenericCloud*
 	assert(percent < 1.0f);
 
 	//point count
-	unsigned count = cloud->size();
+	PointIndexType count = cloud->size();
 	if (count == 0)
 		return 0;
 
@@ -2208,12 +2208,11 @@ ScalarType DistanceComputationTools::ComputeCloud2PlaneRobustMax(	GenericCloud*
 	tail.resize(tailSize);
 
 	//compute deviations
-	cloud->placeIteratorAtBeginning();
+	const CCVector3 N(planeEquation);
 	std::size_t pos = 0;
-	for (unsigned i=0; i<count; ++i)
+	ForEachPoint(cloud, [&](PointIndexType, const CCVector3& P)
 	{
-		const CCVector3* P = cloud->getNextPoint();
-		PointCoordinateType d = std::abs(CCVector3::vdot(P->u,planeEquation) - planeEquation[3])/*/norm*/; //norm == 1.0
+		PointCoordinateType d = std::abs(P.dot(N) - planeEquation[3])/*/norm*/; //norm == 1.0
 
 		if (pos < tailSize)
 		{
@@ -2236,7 +2235,7 @@ ScalarType DistanceComputationTools::ComputeCloud2PlaneRobustMax(	GenericCloud*
 			if (maxPos != maxIndex)
 				std::swap(tail[maxIndex],tail[maxPos]);
 		}
-	}
+	});
 
 	return static_cast<ScalarType>(tail.back());
 }
@@ -2247,7 +2246,7 @@ ScalarType DistanceComputationTools::ComputeCloud2PlaneMaxDistance(	GenericCloud
 	assert(cloud && planeEquation);
 
 	//point count
-	unsigned count = cloud->size();
+	PointIndexType count = cloud->size();
 	if (count == 0)
 		return 0;
 
@@ -2261,13 +2260,12 @@ ScalarType DistanceComputationTools::ComputeCloud2PlaneMaxDistance(	GenericCloud
 	//we search the max distance
 	PointCoordinateType maxDist = 0;
 	
-	cloud->placeIteratorAtBeginning();
-	for (unsigned i=0; i<count; ++i)
+	const CCVector3 N(planeEquation);
+	ForEachPoint(cloud, [&](PointIndexType, const CCVector3& P)
 	{
-		const CCVector3* P = cloud->getNextPoint();
-		PointCoordinateType d = std::abs(CCVector3::vdot(P->u,planeEquation) - planeEquation[3])/*/norm*/; //norm == 1.0
+		PointCoordinateType d = std::abs(P.dot(N) - planeEquation[3])/*/norm*/; //norm == 1.0
 		maxDist = std::max(d,maxDist);
-	}
+	});
 
 	return static_cast<ScalarType>(maxDist);
 }
@@ -2301,7 +2299,7 @@ bool DistanceComputationTools::computeGeodesicDistances(GenericIndexedCloudPersi
 {
 	assert(cloud);
 
-	unsigned n = cloud->size();
+	PointIndexType n = cloud->size();
 	if (n == 0 || seedPointIndex >= n)
 		return false;
 
@@ -2344,7 +2342,7 @@ int DistanceComputationTools::diff(	GenericIndexedCloudPersist* comparedCloud,
 	if (!comparedCloud || !referenceCloud)
 		return -1;
 
-	unsigned nA = comparedCloud->size();
+	PointIndexType nA = comparedCloud->size();
 	if (nA == 0)
 		return -2;
 
@@ -2359,7 +2357,7 @@ int DistanceComputationTools::diff(	GenericIndexedCloudPersist* comparedCloud,
 	if (result < 0)
 		return -3;
 
-	for (unsigned i=0; i<nA; ++i)
+	for (PointIndexType i=0; i<nA; ++i)
 	{
 		ScalarType dA = comparedCloud->getPointScalarValue(i);
 		ScalarType dB = A_in_B.getPointScalarValue(i);
@@ -2466,7 +2464,7 @@ int DistanceComputationTools::computeApproxCloud2CloudDistance(	GenericIndexedCl
 
 		while (!theIndexes.empty())
 		{
-			unsigned theIndex = theIndexes.back();
+			PointIndexType theIndex = theIndexes.back();
 			theIndexes.pop_back();
 
 			Tuple3i cellPos;
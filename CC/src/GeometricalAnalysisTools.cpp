@@ -22,6 +22,7 @@
 #include <DgmOctreeReferenceCloud.h>
 #include <DistanceComputationTools.h>
 #include <GenericProgressCallback.h>
+#include <PointsSpan.h>
 #include <ReferenceCloud.h>
 #include <ScalarField.h>
 #include <ScalarFieldTools.h>
@@ -35,6 +36,30 @@ using namespace CCLib;
 //volume of a unit sphere
 static double s_UnitSphereVolume = 4.0 * M_PI / 3.0;
 
+//! Characteristics sharing the same radius (see GeometricalAnalysisTools::ComputeCharacteristics)
+struct RadiusCharacteristics
+{
+	//! Neighbouring sphere radius
+	PointCoordinateType radius;
+	//! Squared radius
+	double squareRadius;
+	//! Indexes of the corresponding characteristics
+	std::vector<size_t> descIndexes;
+};
+
+//! Parameters shared by all the cells (see GeometricalAnalysisTools::ComputeGeomCharacteristicsAtLevel)
+struct CharacteristicsContext
+{
+	//! Characteristics to compute
+	const std::vector<GeometricalAnalysisTools::CharacteristicDesc>* descs = nullptr;
+	//! Characteristics grouped by radius (sorted by decreasing radius)
+	std::vector<RadiusCharacteristics> radii;
+	//! Dimensional coefficients (for the LocalDensity characteristics)
+	std::vector<double> densityCoefs;
+	//! Whether the neighbours should be sorted by distance (only needed with several radii)
+	bool sortNeighbours = false;
+};
+
 GeometricalAnalysisTools::ErrorCode GeometricalAnalysisTools::ComputeCharactersitic(
 	GeomCharacteristic c,
 	int subOption,
@@ -49,50 +74,151 @@ GeometricalAnalysisTools::ErrorCode GeometricalAnalysisTools::ComputeCharactersi
 		return InvalidInput;
 	}
 
-	unsigned numberOfPoints = cloud->size();
+	if (c == ApproxLocalDensity)
+	{
+		if (subOption == 0)
+			return InvalidInput;
+		//special case (can't be handled in the same way as the other characteristics)
+		return ComputeLocalDensityApprox(cloud, static_cast<Density>(subOption), progressCb, inputOctree);
+	}
+
+	std::vector<CharacteristicDesc> characteristics;
+	try
+	{
+		//the values will be stored in the cloud 'current' scalar field
+		characteristics.emplace_back(c, subOption, kernelRadius);
+	}
+	catch (const std::bad_alloc&)
+	{
+		return NotEnoughMemory;
+	}
+
+	return ComputeCharacteristics(characteristics, cloud, progressCb, inputOctree);
+}
+
+GeometricalAnalysisTools::ErrorCode GeometricalAnalysisTools::ComputeCharacteristics(
+	const std::vector<CharacteristicDesc>& characteristics,
+	GenericIndexedCloudPersist* cloud,
+	GenericProgressCallback* progressCb/*=nullptr*/,
+	DgmOctree* inputOctree/*=nullptr*/)
+{
+	if (!cloud || characteristics.empty())
+	{
+		//invalid input
+		return InvalidInput;
+	}
+
+	PointIndexType numberOfPoints = cloud->size();
+
+	CharacteristicsContext context;
+	context.descs = &characteristics;
 
 	std::string label;
-	switch (c)
+	bool useCloudSF = false;
+	try
 	{
-		case Feature:
-			if (subOption == 0)
-				return InvalidInput;
-			if (numberOfPoints < 4)
-				return NotEnoughPoints;
-			label = "Feature computation";
-			break;
-		case Curvature:
-			if (subOption == 0)
-				return InvalidInput;
-			if (numberOfPoints < 5)
-				return NotEnoughPoints;
-			label = "Curvature computation";
-			break;
-		case LocalDensity:
-			if (subOption == 0)
-				return InvalidInput;
-			if (numberOfPoints < 3)
-				return NotEnoughPoints;
-			label = "Density computation";
-			break;
-		case ApproxLocalDensity:
-			if (subOption == 0)
+		context.densityCoefs.resize(characteristics.size(), 1.0);
+
+		for (size_t i = 0; i < characteristics.size(); ++i)
+		{
+			const CharacteristicDesc& desc = characteristics[i];
+			if (desc.radius <= 0)
 				return InvalidInput;
-			//special case (can't be handled in the same way as the other characteristics)
-			return ComputeLocalDensityApprox(cloud, static_cast<Density>(subOption), progressCb, inputOctree);
-		case Roughness:
-			if (numberOfPoints < 4)
-				return NotEnoughPoints;
-			label = "Roughness computation";
-			break;
-		case MomentOrder1:
-			if (numberOfPoints < 4)
+
+			if (desc.sf)
+			{
+				if (desc.sf->currentSize() < numberOfPoints)
+					return InvalidInput;
+			}
+			else
+			{
+				//only one characteristic can be stored in the cloud 'current' scalar field
+				if (useCloudSF)
+					return InvalidInput;
+				useCloudSF = true;
+			}
+
+			unsigned minPointCount = 0;
+			switch (desc.charac)
+			{
+			case Feature:
+				if (desc.subOption == 0)
+					return InvalidInput;
+				minPointCount = 4;
+				label = "Feature computation";
+				break;
+			case Curvature:
+				if (desc.subOption == 0)
+					return InvalidInput;
+				minPointCount = 5;
+				label = "Curvature computation";
+				break;
+			case LocalDensity:
+				if (desc.subOption == 0)
+					return InvalidInput;
+				minPointCount = 3;
+				label = "Density computation";
+				//compute the right dimensional coef based on the expected output
+				switch (static_cast<Density>(desc.subOption))
+				{
+				case DENSITY_KNN:
+					context.densityCoefs[i] = 1.0;
+					break;
+				case DENSITY_2D:
+					context.densityCoefs[i] = M_PI * pow(desc.radius, 2.0);
+					break;
+				case DENSITY_3D:
+					context.densityCoefs[i] = s_UnitSphereVolume * pow(desc.radius, 3.0);
+					break;
+				default:
+					assert(false);
+					return InvalidInput;
+				}
+				break;
+			case Roughness:
+				minPointCount = 4;
+				label = "Roughness computation";
+				break;
+			case MomentOrder1:
+				minPointCount = 4;
+				label = "1st order moment computation";
+				break;
+			case ApproxLocalDensity: //can't be handled in the same way as the other characteristics (see ComputeLocalDensityApprox)
+			default:
+				return UnhandledCharacteristic;
+			}
+
+			if (numberOfPoints < minPointCount)
 				return NotEnoughPoints;
-			label = "1st order moment computation";
-			break;
-		default:
-			assert(false);
-			return UnhandledCharacteristic;
+
+			//group the characteristics by radius
+			std::vector<RadiusCharacteristics>::iterator it = context.radii.begin();
+			while (it != context.radii.end() && it->radius != desc.radius)
+				++it;
+			if (it == context.radii.end())
+			{
+				RadiusCharacteristics rc;
+				rc.radius = desc.radius;
+				rc.squareRadius = static_cast<double>(desc.radius) * desc.radius;
+				context.radii.push_back(rc);
+				it = context.radii.end() - 1;
+			}
+			it->descIndexes.push_back(i);
+		}
+	}
+	catch (const std::bad_alloc&)
+	{
+		return NotEnoughMemory;
+	}
+
+	//the largest neighbourhood is extracted first
+	std::sort(context.radii.begin(), context.radii.end(), [](const RadiusCharacteristics& a, const RadiusCharacteristics& b) { return a.radius > b.radius; });
+	//the smaller ones are then deduced from the sorted neighbours
+	context.sortNeighbours = (context.radii.size() > 1);
+
+	if (characteristics.size() > 1)
+	{
+		label = "Geometric features computation";
 	}
 
 	DgmOctree* octree = inputOctree;
@@ -107,24 +233,22 @@ GeometricalAnalysisTools::ErrorCode GeometricalAnalysisTools::ComputeCharactersi
 		}
 	}
 
-	//enable a scalar field for storing the characteristic values
-	cloud->enableScalarField();
+	if (useCloudSF)
+	{
+		//enable a scalar field for storing the characteristic values
+		cloud->enableScalarField();
+	}
 
-	//find the best octree leve to perform the computation
-	unsigned char level = octree->findBestLevelForAGivenNeighbourhoodSizeExtraction(kernelRadius);
+	//find the best octree level to perform the computation
+	unsigned char level = octree->findBestLevelForAGivenNeighbourhoodSizeExtraction(context.radii.front().radius);
 
 	//parameters
-	void* additionalParameters[] =
-	{
-		static_cast<void*>(&c),
-		static_cast<void*>(&subOption),
-		static_cast<void*>(&kernelRadius)
-	};
+	void* additionalParameters[] = { static_cast<void*>(&context) };
 
 	ErrorCode result = NoError;
 
 	if (octree->executeFunctionForAllCellsAtLevel(	level,
-													&ComputeGeomCharacteristicAtLevel,
+													&ComputeGeomCharacteristicsAtLevel,
 													additionalParameters,
 													true,
 													progressCb,
@@ -133,67 +257,37 @@ GeometricalAnalysisTools::ErrorCode GeometricalAnalysisTools::ComputeCharactersi
 		//something went wrong
 		result = ProcessFailed;
 	}
-	
+
 	if (octree && !inputOctree)
 	{
 		delete octree;
 		octree = nullptr;
 	}
 
-	//we need to finish the work for the Density computation
-	if (	result == NoError
-		&&	c == LocalDensity
-		&&	subOption != DENSITY_KNN //no need to do anything for the 'KNN' mode)
-		)
-	{
-		//compute the right dimensional coef based on the expected output
-		double dimensionalCoef = 1.0;
-		switch (static_cast<Density>(subOption))
-		{
-		case DENSITY_KNN:
-			assert(false);
-			dimensionalCoef = 1.0;
-			break;
-		case DENSITY_2D:
-			dimensionalCoef = M_PI * pow(kernelRadius, 2.0);
-			break;
-		case DENSITY_3D:
-			dimensionalCoef = s_UnitSphereVolume * pow(kernelRadius, 3.0);
-			break;
-		default:
-			assert(false);
-			result = InvalidInput;
-			break;
-		}
-
-		for (unsigned i = 0; i < numberOfPoints; ++i)
-		{
-			ScalarType s = cloud->getPointScalarValue(i);
-			s = static_cast<ScalarType>(dimensionalCoef * s);
-			cloud->setPointScalarValue(i, s);
-		}
-	}
-
 	return result;
 }
 
-bool GeometricalAnalysisTools::ComputeGeomCharacteristicAtLevel(const DgmOctree::octreeCell& cell,
-																void** additionalParameters,
-																NormalizedProgress* nProgress/*=0*/)
+//"PER-CELL" METHOD: GEOMETRIC CHARACTERISTICS
+//ADDITIONAL PARAMETERS (1):
+// [0] -> (CharacteristicsContext*) characteristics (grouped by decreasing radius)
+bool GeometricalAnalysisTools::ComputeGeomCharacteristicsAtLevel(	const DgmOctree::octreeCell& cell,
+																	void** additionalParameters,
+																	NormalizedProgress* nProgress/*=0*/)
 {
 	//parameters
-	GeomCharacteristic c       = *static_cast<GeomCharacteristic*>(additionalParameters[0]);
-	int subOption              = *static_cast<Neighbourhood::CurvatureType*>(additionalParameters[1]);
-	PointCoordinateType radius = *static_cast<PointCoordinateType*>(additionalParameters[2]);
+	const CharacteristicsContext& context = *static_cast<CharacteristicsContext*>(additionalParameters[0]);
+	const std::vector<CharacteristicDesc>& descs = *context.descs;
+	assert(!context.radii.empty());
+	const PointCoordinateType maxRadius = context.radii.front().radius;
 
 	//structure for nearest neighbors search
 	DgmOctree::NearestNeighboursSphericalSearchStruct nNSS;
 	nNSS.level = cell.level;
-	nNSS.prepare(radius, cell.parentOctree->getCellSize(nNSS.level));
+	nNSS.prepare(maxRadius, cell.parentOctree->getCellSize(nNSS.level));
 	cell.parentOctree->getCellPos(cell.truncatedCode, cell.level, nNSS.cellPos, true);
 	cell.parentOctree->computeCellCenter(nNSS.cellPos, cell.level, nNSS.cellCenter);
 
-	unsigned n = cell.points->size(); //number of points in the current cell
+	PointIndexType n = cell.points->size(); //number of points in the current cell
 
 	//we already know some of the neighbours: the points in the current cell!
 	{
@@ -208,7 +302,7 @@ bool GeometricalAnalysisTools::ComputeGeomCharacteristicAtLevel(const DgmOctree:
 		}
 
 		DgmOctree::NeighboursSet::iterator it = nNSS.pointsInNeighbourhood.begin();
-		for (unsigned i = 0; i < n; ++i, ++it)
+		for (PointIndexType i = 0; i < n; ++i, ++it)
 		{
 			it->point = cell.points->getPointPersistentPtr(i);
 			it->pointIndex = cell.points->getPointGlobalIndex(i);
@@ -216,86 +310,106 @@ bool GeometricalAnalysisTools::ComputeGeomCharacteristicAtLevel(const DgmOctree:
 	}
 	nNSS.alreadyVisitedNeighbourhoodSize = 1;
 
+	GenericIndexedCloudPersist* cloud = cell.points->getAssociatedCloud();
+
 	//for each point in the cell
-	for (unsigned i = 0; i < n; ++i)
+	for (PointIndexType i = 0; i < n; ++i)
 	{
 		cell.points->getPoint(i, nNSS.queryPoint);
+		const PointIndexType globalIndex = cell.points->getPointGlobalIndex(i);
 
-		//look for neighbors in a sphere
+		//look for neighbors in the largest sphere
 		//warning: there may be more points at the end of nNSS.pointsInNeighbourhood than the actual nearest neighbors (neighborCount)!
-		unsigned neighborCount = cell.parentOctree->findNeighborsInASphereStartingFromCell(nNSS, radius, false);
-
-		ScalarType value = NAN_VALUE;
+		unsigned neighborCount = cell.parentOctree->findNeighborsInASphereStartingFromCell(nNSS, maxRadius, context.sortNeighbours);
 
-		switch (c)
+		for (const RadiusCharacteristics& rc : context.radii)
 		{
-		case Feature:
-			if (neighborCount > 3)
+			if (context.sortNeighbours)
 			{
-				DgmOctreeReferenceCloud neighboursCloud(&nNSS.pointsInNeighbourhood, neighborCount);
-				Neighbourhood Z(&neighboursCloud);
-				value = static_cast<ScalarType>(Z.computeFeature(static_cast<Neighbourhood::GeomFeature>(subOption)));
+				//the neighbours are sorted by increasing distance: the smaller neighbourhoods are prefixes of the larger ones
+				neighborCount = static_cast<unsigned>(std::upper_bound(	nNSS.pointsInNeighbourhood.begin(),
+																			nNSS.pointsInNeighbourhood.begin() + neighborCount,
+																			rc.squareRadius,
+																			[](double d2, const DgmOctree::PointDescriptor& p) { return d2 < p.squareDistd; })
+														- nNSS.pointsInNeighbourhood.begin());
 			}
-			break;
 
-		case Curvature:
-			if (neighborCount > 5)
-			{
-				DgmOctreeReferenceCloud neighboursCloud(&nNSS.pointsInNeighbourhood, neighborCount);
-				Neighbourhood Z(&neighboursCloud);
-				value = Z.computeCurvature(nNSS.queryPoint, static_cast<Neighbourhood::CurvatureType>(subOption));
-			}
-			break;
+			//the covariance matrix and its eigen values are shared by all the characteristics at this radius
+			DgmOctreeReferenceCloud neighboursCloud(&nNSS.pointsInNeighbourhood, neighborCount);
+			Neighbourhood Z(&neighboursCloud);
 
-		case LocalDensity:
+			for (size_t descIndex : rc.descIndexes)
 			{
-				value = static_cast<ScalarType>(neighborCount);
-			}
-			break;
+				const CharacteristicDesc& desc = descs[descIndex];
+				ScalarType value = NAN_VALUE;
 
-		case Roughness:
-			if (neighborCount > 3)
-			{
-				//find the query point in the nearest neighbors set and place it at the end
-				const unsigned globalIndex = cell.points->getPointGlobalIndex(i);
-				unsigned localIndex = 0;
-				while (localIndex < neighborCount && nNSS.pointsInNeighbourhood[localIndex].pointIndex != globalIndex)
-				{
-					++localIndex;
-				}
-				//the query point should be in the nearest neighbors set!
-				assert(localIndex < neighborCount);
-				if (localIndex + 1 < neighborCount) //no need to swap with another point if it's already at the end!
+				switch (desc.charac)
 				{
-					std::swap(nNSS.pointsInNeighbourhood[localIndex], nNSS.pointsInNeighbourhood[neighborCount - 1]);
-				}
+				case Feature:
+					if (neighborCount > 3)
+					{
+						value = static_cast<ScalarType>(Z.computeFeature(static_cast<Neighbourhood::GeomFeature>(desc.subOption)));
+					}
+					break;
 
-				DgmOctreeReferenceCloud neighboursCloud(&nNSS.pointsInNeighbourhood, neighborCount - 1); //we don't take the query point into account!
-				Neighbourhood Z(&neighboursCloud);
-				value = Z.computeRoughness(nNSS.queryPoint);
+				case Curvature:
+					if (neighborCount > 5)
+					{
+						value = Z.computeCurvature(nNSS.queryPoint, static_cast<Neighbourhood::CurvatureType>(desc.subOption));
+					}
+					break;
 
-				//swap the points back to their original position (DGM: not necessary in this case)
-				//if (localIndex+1 < neighborCount)
-				//{
-				//	std::swap(nNSS.pointsInNeighbourhood[localIndex],nNSS.pointsInNeighbourhood[neighborCount-1]);
-				//}
-			}
-			break;
+				case LocalDensity:
+					{
+						value = static_cast<ScalarType>(neighborCount / context.densityCoefs[descIndex]);
+					}
+					break;
 
-		case MomentOrder1:
-			{
-				DgmOctreeReferenceCloud neighboursCloud(&nNSS.pointsInNeighbourhood, neighborCount);
-				Neighbourhood Z(&neighboursCloud);
-				value = Z.computeMomentOrder1(nNSS.queryPoint);
-			}		
-			break;
+				case Roughness:
+					if (neighborCount > 3)
+					{
+						//find the query point in the nearest neighbors set and place it at the end
+						unsigned localIndex = 0;
+						while (localIndex < neighborCount && nNSS.pointsInNeighbourhood[localIndex].pointIndex != globalIndex)
+						{
+							++localIndex;
+						}
+						//the query point should be in the nearest neighbors set!
+						assert(localIndex < neighborCount);
+						if (localIndex + 1 < neighborCount) //no need to swap with another point if it's already at the end!
+						{
+							std::swap(nNSS.pointsInNeighbourhood[localIndex], nNSS.pointsInNeighbourhood[neighborCount - 1]);
+						}
+
+						DgmOctreeReferenceCloud roughnessCloud(&nNSS.pointsInNeighbourhood, neighborCount - 1); //we don't take the query point into account!
+						Neighbourhood R(&roughnessCloud);
+						value = R.computeRoughness(nNSS.queryPoint);
+
+						//swap the points back to their original position (the smaller neighbourhoods rely on the sorted neighbours)
+						if (localIndex + 1 < neighborCount)
+						{
+							std::swap(nNSS.pointsInNeighbourhood[localIndex], nNSS.pointsInNeighbourhood[neighborCount - 1]);
+						}
+					}
+					break;
 
-		default:
-			assert(false);
-			return false;
-		}
+				case MomentOrder1:
+					{
+						value = Z.computeMomentOrder1(nNSS.queryPoint);
+					}
+					break;
 
-		cell.points->setPointScalarValue(i, value);
+				default:
+					assert(false);
+					return false;
+				}
+
+				if (desc.sf)
+					desc.sf->setValue(globalIndex, value);
+				else
+					cloud->setPointScalarValue(globalIndex, value);
+			}
+		}
 
 		if (nProgress && !nProgress->oneStep())
 		{
@@ -306,7 +420,6 @@ bool GeometricalAnalysisTools::ComputeGeomCharacteristicAtLevel(const DgmOctree:
 	return true;
 }
 
-
 GeometricalAnalysisTools::ErrorCode GeometricalAnalysisTools::FlagDuplicatePoints(
 	GenericIndexedCloudPersist* cloud,
 	double minDistanceBetweenPoints/*=1.0e-12*/,
@@ -316,7 +429,7 @@ GeometricalAnalysisTools::ErrorCode GeometricalAnalysisTools::FlagDuplicatePoint
 	if (!cloud)
 		return InvalidInput;
 
-	unsigned numberOfPoints = cloud->size();
+	PointIndexType numberOfPoints = cloud->size();
 	if (numberOfPoints <= 1)
 		return NotEnoughPoints;
 
@@ -379,10 +492,10 @@ bool GeometricalAnalysisTools::FlagDuplicatePointsInACellAtLevel(	const DgmOctre
 	cell.parentOctree->getCellPos(cell.truncatedCode, cell.level, nNSS.cellPos, true);
 	cell.parentOctree->computeCellCenter(nNSS.cellPos, cell.level, nNSS.cellCenter);
 
-	unsigned n = cell.points->size(); //number of points in the current cell
+	PointIndexType n = cell.points->size(); //number of points in the current cell
 
 	//for each point in the cell
-	for (unsigned i = 0; i < n; ++i)
+	for (PointIndexType i = 0; i < n; ++i)
 	{
 		//don't process points already flagged as 'duplicate'
 		if (cell.points->getPointScalarValue(i) == 0)
@@ -394,7 +507,7 @@ bool GeometricalAnalysisTools::FlagDuplicatePointsInACellAtLevel(	const DgmOctre
 			unsigned neighborCount = cell.parentOctree->findNeighborsInASphereStartingFromCell(nNSS, minDistBetweenPoints, false);
 			if (neighborCount > 1) //the point itself lies in the neighborhood
 			{
-				unsigned iIndex = cell.points->getPointGlobalIndex(i);
+				PointIndexType iIndex = cell.points->getPointGlobalIndex(i);
 				for (unsigned j = 0; j < neighborCount; ++j)
 				{
 					if (nNSS.pointsInNeighbourhood[j].pointIndex != iIndex)
@@ -424,7 +537,7 @@ GeometricalAnalysisTools::ErrorCode GeometricalAnalysisTools::ComputeLocalDensit
 	if (!cloud)
 		return InvalidInput;
 
-	unsigned numberOfPoints = cloud->size();
+	PointIndexType numberOfPoints = cloud->size();
 	if (numberOfPoints < 3)
 		return NotEnoughPoints;
 
@@ -485,8 +598,8 @@ bool GeometricalAnalysisTools::ComputeApproxPointsDensityInACellAtLevel(const Dg
 	cell.parentOctree->getCellPos(cell.truncatedCode, cell.level, nNSS.cellPos, true);
 	cell.parentOctree->computeCellCenter(nNSS.cellPos, cell.level, nNSS.cellCenter);
 
-	unsigned n = cell.points->size();
-	for (unsigned i = 0; i < n; ++i)
+	PointIndexType n = cell.points->size();
+	for (PointIndexType i = 0; i < n; ++i)
 	{
 		cell.points->getPoint(i, nNSS.queryPoint);
 
@@ -545,18 +658,16 @@ CCVector3 GeometricalAnalysisTools::ComputeGravityCenter(GenericCloud* cloud)
 {
 	assert(cloud);
 
-	unsigned count = cloud->size();
+	PointIndexType count = cloud->size();
 	if (count == 0)
 		return CCVector3();
 
 	CCVector3d sum(0, 0, 0);
 
-	cloud->placeIteratorAtBeginning();
-	const CCVector3 *P = nullptr;
-	while ((P = cloud->getNextPoint()))
+	ForEachPoint(cloud, [&sum](PointIndexType, const CCVector3& P)
 	{
-		sum += CCVector3d::fromArray(P->u);
-	}
+		sum += CCVector3d::fromArray(P.u);
+	});
 
 	sum /= static_cast<double>(count);
 	return CCVector3::fromArray(sum.u);
@@ -566,23 +677,21 @@ CCVector3 GeometricalAnalysisTools::ComputeWeightedGravityCenter(GenericCloud* c
 {
 	assert(cloud && weights);
 
-	unsigned count = cloud->size();
+	PointIndexType count = cloud->size();
 	if (count == 0 || !weights || weights->currentSize() < count)
 		return CCVector3();
 
 	CCVector3d sum(0, 0, 0);
 
-	cloud->placeIteratorAtBeginning();
 	double wSum = 0;
-	for (unsigned i = 0; i < count; ++i)
+	ForEachPoint(cloud, [&](PointIndexType i, const CCVector3& P)
 	{
-		const CCVector3* P = cloud->getNextPoint();
 		ScalarType w = weights->getValue(i);
 		if (!ScalarField::ValidValue(w))
-			continue;
-		sum += CCVector3d::fromArray(P->u) * std::abs(w);
+			return;
+		sum += CCVector3d::fromArray(P.u) * std::abs(w);
 		wSum += w;
-	}
+	});
 
 	if (wSum != 0)
 		sum /= wSum;
@@ -593,7 +702,7 @@ CCVector3 GeometricalAnalysisTools::ComputeWeightedGravityCenter(GenericCloud* c
 CCLib::SquareMatrixd GeometricalAnalysisTools::ComputeCovarianceMatrix(GenericCloud* cloud, const PointCoordinateType* _gravityCenter)
 {
 	assert(cloud);
-	unsigned n = (cloud ? cloud->size() : 0);
+	PointIndexType n = (cloud ? cloud->size() : 0);
 	if (n==0)
 		return CCLib::SquareMatrixd();
 
@@ -611,23 +720,20 @@ CCLib::SquareMatrixd GeometricalAnalysisTools::ComputeCovarianceMatrix(GenericCl
 	double mXZ = 0;
 	double mYZ = 0;
 
-	cloud->placeIteratorAtBeginning();
-	for (unsigned i = 0; i < n; ++i)
+	ForEachPoint(cloud, [&](PointIndexType, const CCVector3& Q)
 	{
-		const CCVector3* Q = cloud->getNextPoint();
-
-		CCVector3 P = *Q - G;
+		CCVector3 P = Q - G;
 		mXX += static_cast<double>(P.x*P.x);
 		mYY += static_cast<double>(P.y*P.y);
 		mZZ += static_cast<double>(P.z*P.z);
 		mXY += static_cast<double>(P.x*P.y);
 		mXZ += static_cast<double>(P.x*P.z);
 		mYZ += static_cast<double>(P.y*P.z);
-	}
+	});
 
 	covMat.m_values[0][0] = mXX / static_cast<double>(n);
-	covMat.m_values[0][0] = mYY / static_cast<double>(n);
-	covMat.m_values[0][0] = mZZ / static_cast<double>(n);
+	covMat.m_values[1][1] = mYY / static_cast<double>(n);
+	covMat.m_values[2][2] = mZZ / static_cast<double>(n);
 	covMat.m_values[1][0] = covMat.m_values[0][1] = mXY / static_cast<double>(n);
 	covMat.m_values[2][0] = covMat.m_values[0][2] = mXZ / static_cast<double>(n);
 	covMat.m_values[2][1] = covMat.m_values[1][2] = mYZ / static_cast<double>(n);
@@ -649,15 +755,17 @@ CCLib::SquareMatrixd GeometricalAnalysisTools::ComputeCrossCovarianceMatrix(Gene
 	double* l2 = covMat.row(1);
 	double* l3 = covMat.row(2);
 
-	P->placeIteratorAtBeginning();
+	//the model points are read in the same order as the data points
+	PointsSpan spanQ;
+	const bool directQ = Q->getPointsSpan(spanQ);
 	Q->placeIteratorAtBeginning();
 
 	//sums
-	unsigned count = P->size();
-	for (unsigned i = 0; i < count; i++)
+	PointIndexType count = P->size();
+	ForEachPoint(P, [&](PointIndexType i, const CCVector3& Pi)
 	{
-		CCVector3 Pt = *P->getNextPoint() - Gp;
-		CCVector3 Qt = *Q->getNextPoint() - Gq;
+		CCVector3 Pt = Pi - Gp;
+		CCVector3 Qt = (directQ ? spanQ[i] : *Q->getNextPoint()) - Gq;
 
 		l1[0] += Pt.x * Qt.x;
 		l1[1] += Pt.x * Qt.y;
@@ -668,7 +776,7 @@ CCLib::SquareMatrixd GeometricalAnalysisTools::ComputeCrossCovarianceMatrix(Gene
 		l3[0] += Pt.z * Qt.x;
 		l3[1] += Pt.z * Qt.y;
 		l3[2] += Pt.z * Qt.z;
-	}
+	});
 
 	covMat.scale(1.0/static_cast<double>(count));
 
@@ -692,16 +800,17 @@ CCLib::SquareMatrixd GeometricalAnalysisTools::ComputeWeightedCrossCovarianceMat
 	double* r2 = covMat.row(1);
 	double* r3 = covMat.row(2);
 
-	P->placeIteratorAtBeginning();
+	//the model points are read in the same order as the data points
+	PointsSpan spanQ;
+	const bool directQ = Q->getPointsSpan(spanQ);
 	Q->placeIteratorAtBeginning();
 
 	//sums
-	unsigned count = P->size();
 	double wSum = 0.0; //we will normalize by the sum
-	for (unsigned i = 0; i<count; i++)
+	ForEachPoint(P, [&](PointIndexType i, const CCVector3& Pi)
 	{
-		CCVector3d Pt = CCVector3d::fromArray((*P->getNextPoint() - Gp).u);
-		CCVector3 Qt = *Q->getNextPoint() - Gq;
+		CCVector3d Pt = CCVector3d::fromArray((Pi - Gp).u);
+		CCVector3 Qt = (directQ ? spanQ[i] : *Q->getNextPoint()) - Gq;
 
 		//Weighting scheme for cross-covariance is inspired from
 		//https://en.wikipedia.org/wiki/Weighted_arithmetic_mean#Weighted_sample_covariance
@@ -710,7 +819,7 @@ CCLib::SquareMatrixd GeometricalAnalysisTools::ComputeWeightedCrossCovarianceMat
 		{
 			ScalarType w = coupleWeights->getValue(i);
 			if (!ScalarField::ValidValue(w))
-				continue;
+				return;
 			wi = std::abs(w);
 		}
 
@@ -730,7 +839,7 @@ CCLib::SquareMatrixd GeometricalAnalysisTools::ComputeWeightedCrossCovarianceMat
 		r3[0] += Pt.z * Qt.x;
 		r3[1] += Pt.z * Qt.y;
 		r3[2] += Pt.z * Qt.z;
-	}
+	});
 
 	if (wSum != 0.0)
 		covMat.scale(1.0 / wSum);
@@ -751,12 +860,12 @@ bool GeometricalAnalysisTools::RefineSphereLS(	GenericIndexedCloudPersist* cloud
 
 	CCVector3d c = CCVector3d::fromArray(center.u);
 
-	unsigned count = cloud->size();
+	PointIndexType count = cloud->size();
 
 	//compute barycenter
 	CCVector3d G(0, 0, 0);
 	{
-		for (unsigned i = 0; i < count; ++i)
+		for (PointIndexType i = 0; i < count; ++i)
 		{
 			const CCVector3* P = cloud->getPoint(i);
 			G += CCVector3d::fromArray(P->u);
@@ -771,7 +880,7 @@ bool GeometricalAnalysisTools::RefineSphereLS(	GenericIndexedCloudPersist* cloud
 		double meanNorm = 0.0;
 		CCVector3d derivatives(0, 0, 0);
 		unsigned realCount = 0;
-		for (unsigned i = 0; i < count; ++i)
+		for (PointIndexType i = 0; i < count; ++i)
 		{
 			const CCVector3* Pi = cloud->getPoint(i);
 			CCVector3d Di = CCVector3d::fromArray(Pi->u) - c;
@@ -815,7 +924,7 @@ GeometricalAnalysisTools::ErrorCode GeometricalAnalysisTools::DetectSphereRobust
 	if (!cloud)
 		return InvalidInput;
 
-	unsigned n = cloud->size();
+	PointIndexType n = cloud->size();
 	if (n < 4)
 		return NotEnoughPoints;
 
@@ -898,7 +1007,7 @@ GeometricalAnalysisTools::ErrorCode GeometricalAnalysisTools::DetectSphereRobust
 			continue;
 
 		//compute residuals
-		for (unsigned i = 0; i < n; ++i)
+		for (PointIndexType i = 0; i < n; ++i)
 		{
 			PointCoordinateType error = (*cloud->getPoint(i) - thisCenter).norm() - thisRadius;
 			values[i] = error*error;
@@ -40,7 +40,7 @@ KDTree::~KDTree()
 
 bool KDTree::buildFromCloud(GenericIndexedCloud *cloud, GenericProgressCallback *progressCb)
 {
-    unsigned cloudsize = cloud->size();
+    PointIndexType cloudsize = cloud->size();
 
     m_indexes.resize(0);
     m_cellCount = 0;
@@ -61,7 +61,7 @@ bool KDTree::buildFromCloud(GenericIndexedCloud *cloud, GenericProgressCallback
 
 	m_associatedCloud = cloud;
 
-	for (unsigned i=0; i<cloudsize; i++)
+	for (PointIndexType i=0; i<cloudsize; i++)
         m_indexes[i] = i;
 
     if (progressCb)
@@ -40,8 +40,8 @@ ReferenceCloud* ManualSegmentationTools::segment(GenericIndexedCloudPersist* aCl
 	ReferenceCloud* Y = new ReferenceCloud(aCloud);
 
 	//we check for each point if it falls inside the polyline
-	unsigned count = aCloud->size();
-	for (unsigned i = 0; i < count; ++i)
+	PointIndexType count = aCloud->size();
+	for (PointIndexType i = 0; i < count; ++i)
 	{
 		CCVector3 P;
 		aCloud->getPoint(i, P);
@@ -73,7 +73,7 @@ ReferenceCloud* ManualSegmentationTools::segment(GenericIndexedCloudPersist* aCl
 bool ManualSegmentationTools::isPointInsidePoly(const CCVector2& P, const GenericIndexedCloud* polyVertices)
 {
 	//number of vertices
-	unsigned vertCount = (polyVertices ? polyVertices->size() : 0);
+	PointIndexType vertCount = (polyVertices ? polyVertices->size() : 0);
 	if (vertCount<2)
 		return false;
 
@@ -172,8 +172,8 @@ GenericIndexedMesh* ManualSegmentationTools::segmentMesh(GenericIndexedMesh* the
 		return nullptr;
 
 	//by default we try a fast process (but with a higher memory consumption)
-	unsigned numberOfPoints = pointIndexes->getAssociatedCloud()->size();
-	unsigned numberOfIndexes = pointIndexes->size();
+	PointIndexType numberOfPoints = pointIndexes->getAssociatedCloud()->size();
+	PointIndexType numberOfIndexes = pointIndexes->size();
 
 	//we determine for each point if it is used in the output mesh or not
 	//(and we compute its new index by the way: 0 means that the point is not used, otherwise its index will be newPointIndexes-1)
@@ -188,7 +188,7 @@ GenericIndexedMesh* ManualSegmentationTools::segmentMesh(GenericIndexedMesh* the
 			return nullptr; //not enough memory
 		}
 
-		for (unsigned i = 0; i < numberOfIndexes; ++i)
+		for (PointIndexType i = 0; i < numberOfIndexes; ++i)
 		{
 			assert(pointIndexes->getPointGlobalIndex(i) < numberOfPoints);
 			newPointIndexes[pointIndexes->getPointGlobalIndex(i)] = i + 1;
@@ -199,7 +199,7 @@ GenericIndexedMesh* ManualSegmentationTools::segmentMesh(GenericIndexedMesh* the
 	if (!pointsWillBeInside)
 	{
 		unsigned newIndex = 0;
-		for (unsigned i = 0; i < numberOfPoints; ++i)
+		for (PointIndexType i = 0; i < numberOfPoints; ++i)
 			newPointIndexes[i] = (newPointIndexes[i] == 0 ? ++newIndex : 0);
 	}
 
@@ -216,7 +216,7 @@ GenericIndexedMesh* ManualSegmentationTools::segmentMesh(GenericIndexedMesh* the
 			{
 				progressCb->setMethodTitle("Extract mesh");
 				char buffer[256];
-				sprintf(buffer, "New vertex number: %u", numberOfIndexes);
+				sprintf(buffer, "New vertex number: %llu", static_cast<unsigned long long>(numberOfIndexes));
 				progressCb->setInfo(buffer);
 			}
 			progressCb->update(0);
@@ -307,7 +307,7 @@ bool AddVertex(CCVector3d& P, PointCloud* vertices, unsigned& index)
 {
 	assert(vertices);
 	//add vertex to the 'vertices' set
-	unsigned vertCount = vertices->size();
+	PointIndexType vertCount = vertices->size();
 	if (vertCount == vertices->capacity()
 		&& !vertices->reserve(vertCount + c_defaultArrayGrowth))
 	{
@@ -401,8 +401,8 @@ bool MergeOldTriangles(	GenericIndexedMesh* origMesh,
 	assert(origMesh && origVertices && newMesh && newVertices);
 	
 	unsigned importedTriCount = static_cast<unsigned>(preservedTriangleIndexes.size());
- 	unsigned origVertCount = origVertices->size();
-	unsigned newVertCount = newVertices->size();
+ 	PointIndexType origVertCount = origVertices->size();
+	PointIndexType newVertCount = newVertices->size();
 	unsigned newTriCount = newMesh->size();
 
 	try
@@ -440,7 +440,7 @@ bool MergeOldTriangles(	GenericIndexedMesh* origMesh,
 		//count the number of used vertices
 		unsigned importedVertCount = 0;
 		{
-			for (unsigned i = 0; i < origVertCount; ++i)
+			for (PointIndexType i = 0; i < origVertCount; ++i)
 				if (newIndexMap[i])
 					++importedVertCount;
 		}
@@ -462,7 +462,7 @@ bool MergeOldTriangles(	GenericIndexedMesh* origMesh,
 		{
 			//update the destination indexes by the way
 			unsigned lastVertIndex = newVertCount;
-			for (unsigned i = 0; i < origVertCount; ++i)
+			for (PointIndexType i = 0; i < origVertCount; ++i)
 			{
 				if (newIndexMap[i])
 				{
@@ -528,8 +528,8 @@ bool ImportSourceVertices(GenericIndexedCloudPersist* srcVertices,
 {
 	assert(srcVertices && newMesh && newVertices);
 
-	unsigned srcVertCount = srcVertices->size();
-	unsigned newVertCount = newVertices->size();
+	PointIndexType srcVertCount = srcVertices->size();
+	PointIndexType newVertCount = newVertices->size();
 	unsigned newTriCount = newMesh->size();
 
 	try
@@ -552,7 +552,7 @@ bool ImportSourceVertices(GenericIndexedCloudPersist* srcVertices,
 		//count the number of used vertices
 		unsigned importedVertCount = 0;
 		{
-			for (unsigned i = 0; i < srcVertCount; ++i)
+			for (PointIndexType i = 0; i < srcVertCount; ++i)
 				if (newIndexMap[i])
 					++importedVertCount;
 		}
@@ -574,7 +574,7 @@ bool ImportSourceVertices(GenericIndexedCloudPersist* srcVertices,
 		{
 			//update the destination indexes by the way
 			unsigned lastVertIndex = newVertCount;
-			for (unsigned i = 0; i < srcVertCount; ++i)
+			for (PointIndexType i = 0; i < srcVertCount; ++i)
 			{
 				if (newIndexMap[i])
 				{
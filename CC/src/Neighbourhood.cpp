@@ -23,6 +23,7 @@
 #include <Delaunay2dMesh.h>
 #include <DistanceComputationTools.h>
 #include <PointCloud.h>
+#include <PointsSpan.h>
 #include <SimpleMesh.h>
 
 //System
@@ -126,6 +127,42 @@ const CCVector3* Neighbourhood::getLSPlaneNormal()
 	return ((m_structuresValidity & FLAG_LS_PLANE) ? m_lsPlaneVectors + 2 : nullptr);
 }
 
+const double* Neighbourhood::getEigenValues()
+{
+	if (!(m_structuresValidity & FLAG_EIGEN))
+		computeEigenValuesAndVectors();
+	return ((m_structuresValidity & FLAG_EIGEN) ? m_eigValues : nullptr);
+}
+
+const CCVector3d* Neighbourhood::getEigenVectors()
+{
+	if (!(m_structuresValidity & FLAG_EIGEN))
+		computeEigenValuesAndVectors();
+	return ((m_structuresValidity & FLAG_EIGEN) ? m_eigVectors : nullptr);
+}
+
+bool Neighbourhood::computeEigenValuesAndVectors()
+{
+	//invalidate previous decomposition (if any)
+	m_structuresValidity &= (~FLAG_EIGEN);
+
+	if (!m_associatedCloud || m_associatedCloud->size() < 3)
+	{
+		//not enough points
+		return false;
+	}
+
+	//eigen values are sorted in decreasing order
+	if (!computeCovarianceMatrix3x3().computeEigenValuesAndVectors(m_eigValues, m_eigVectors))
+	{
+		//failed to compute the eigen values
+		return false;
+	}
+
+	m_structuresValidity |= FLAG_EIGEN;
+	return true;
+}
+
 const PointCoordinateType* Neighbourhood::getQuadric(Tuple3ub* dims/*=0*/)
 {
 	if (!(m_structuresValidity & FLAG_QUADRIC))
@@ -147,19 +184,18 @@ void Neighbourhood::computeGravityCenter()
 	m_structuresValidity &= (~FLAG_GRAVITY_CENTER);
 
 	assert(m_associatedCloud);
-	unsigned count = (m_associatedCloud ? m_associatedCloud->size() : 0);
+	PointIndexType count = (m_associatedCloud ? m_associatedCloud->size() : 0);
 	if (!count)
 		return;
 
 	//sum
 	CCVector3d Psum(0,0,0);
-	for (unsigned i=0; i<count; ++i)
+	ForEachPoint(m_associatedCloud, [&Psum](PointIndexType, const CCVector3& P)
 	{
-		const CCVector3* P = m_associatedCloud->getPoint(i);
-		Psum.x += P->x;
-		Psum.y += P->y;
-		Psum.z += P->z;
-	}
+		Psum.x += P.x;
+		Psum.y += P.y;
+		Psum.z += P.z;
+	});
 
 	setGravityCenter( {
 						  static_cast<PointCoordinateType>(Psum.x / count),
@@ -171,10 +207,20 @@ void Neighbourhood::computeGravityCenter()
 CCLib::SquareMatrixd Neighbourhood::computeCovarianceMatrix()
 {
 	assert(m_associatedCloud);
-	unsigned count = (m_associatedCloud ? m_associatedCloud->size() : 0);
+	PointIndexType count = (m_associatedCloud ? m_associatedCloud->size() : 0);
 	if (!count)
 		return CCLib::SquareMatrixd();
 
+	return computeCovarianceMatrix3x3().toSquareMatrix();
+}
+
+CCLib::SymmetricMatrix3d Neighbourhood::computeCovarianceMatrix3x3()
+{
+	assert(m_associatedCloud);
+	PointIndexType count = (m_associatedCloud ? m_associatedCloud->size() : 0);
+	if (!count)
+		return CCLib::SymmetricMatrix3d();
+
 	//we get centroid
 	const CCVector3* G = getGravityCenter();
 	assert(G);
@@ -187,9 +233,10 @@ CCLib::SquareMatrixd Neighbourhood::computeCovarianceMatrix()
 	double mXZ = 0.0;
 	double mYZ = 0.0;
 
-	for (unsigned i = 0; i < count; ++i)
+	const CCVector3 C = *G;
+	ForEachPoint(m_associatedCloud, [&](PointIndexType, const CCVector3& Q)
 	{
-		const CCVector3 P = *m_associatedCloud->getPoint(i) - *G;
+		const CCVector3 P = Q - C;
 
 		mXX += static_cast<double>(P.x)*P.x;
 		mYY += static_cast<double>(P.y)*P.y;
@@ -197,24 +244,17 @@ CCLib::SquareMatrixd Neighbourhood::computeCovarianceMatrix()
 		mXY += static_cast<double>(P.x)*P.y;
 		mXZ += static_cast<double>(P.x)*P.z;
 		mYZ += static_cast<double>(P.y)*P.z;
-	}
-
-	//symmetry
-	CCLib::SquareMatrixd covMat(3);
-	covMat.m_values[0][0] = mXX/count;
-	covMat.m_values[1][1] = mYY/count;
-	covMat.m_values[2][2] = mZZ/count;
-	covMat.m_values[1][0] = covMat.m_values[0][1] = mXY/count;
-	covMat.m_values[2][0] = covMat.m_values[0][2] = mXZ/count;
-	covMat.m_values[2][1] = covMat.m_values[1][2] = mYZ/count;
+	});
 
-	return covMat;
+	return CCLib::SymmetricMatrix3d(mXX/count, mXY/count, mXZ/count,
+									mYY/count, mYZ/count,
+									mZZ/count);
 }
 
 PointCoordinateType Neighbourhood::computeLargestRadius()
 {
 	assert(m_associatedCloud);
-	unsigned pointCount = (m_associatedCloud ? m_associatedCloud->size() : 0);
+	PointIndexType pointCount = (m_associatedCloud ? m_associatedCloud->size() : 0);
 	if (pointCount < 2)
 		return 0;
 
@@ -227,13 +267,13 @@ PointCoordinateType Neighbourhood::computeLargestRadius()
 	}
 
 	double maxSquareDist = 0;
-	for (unsigned i=0; i<pointCount; ++i)
+	const CCVector3 C = *G;
+	ForEachPoint(m_associatedCloud, [&](PointIndexType, const CCVector3& P)
 	{
-		const CCVector3* P = m_associatedCloud->getPoint(i);
-		const double d2 = (*P-*G).norm2();
+		const double d2 = (P - C).norm2();
 		if (d2 > maxSquareDist)
 			maxSquareDist = d2;
-	}
+	});
 
 	return static_cast<PointCoordinateType>(sqrt(maxSquareDist));
 }
@@ -244,7 +284,7 @@ bool Neighbourhood::computeLeastSquareBestFittingPlane()
 	m_structuresValidity &= (~FLAG_LS_PLANE);
 
 	assert(m_associatedCloud);
-	unsigned pointCount = (m_associatedCloud ? m_associatedCloud->size() : 0);
+	PointIndexType pointCount = (m_associatedCloud ? m_associatedCloud->size() : 0);
 
 	//we need at least 3 points to compute a plane
 	assert(CC_LOCAL_MODEL_MIN_SIZE[LS] >= 3);
@@ -257,10 +297,8 @@ bool Neighbourhood::computeLeastSquareBestFittingPlane()
 	CCVector3 G(0, 0, 0);
 	if (pointCount > 3)
 	{
-		CCLib::SquareMatrixd covMat = computeCovarianceMatrix();
-
 #ifdef USE_EIGEN
-		Eigen::Matrix3d A = ToEigen(covMat);
+		Eigen::Matrix3d A = ToEigen(computeCovarianceMatrix());
 		Eigen::SelfAdjointEigenSolver<Eigen::Matrix3d> es;
 		es.compute(A);
 
@@ -273,30 +311,18 @@ bool Neighbourhood::computeLeastSquareBestFittingPlane()
 		m_lsPlaneVectors[0] = CCVector3::fromArray(eVec.col(2).data()); //biggest eigenvalue
 #else
 		//we determine plane normal by computing the smallest eigen value of M = 1/n * S[(p-µ)*(p-µ)']
-		CCLib::SquareMatrixd eigVectors;
-		std::vector<double> eigValues;
-		if (!Jacobi<double>::ComputeEigenValuesAndVectors(covMat, eigVectors, eigValues, true))
+		const CCVector3d* eigVectors = getEigenVectors();
+		if (!eigVectors)
 		{
 			//failed to compute the eigen values!
 			return false;
 		}
 
-		//get normal
-		{
-			CCVector3d vec(0, 0, 1);
-			double minEigValue = 0;
-			//the smallest eigen vector corresponds to the "least square best fitting plane" normal
-			Jacobi<double>::GetMinEigenValueAndVector(eigVectors, eigValues, minEigValue, vec.u);
-			m_lsPlaneVectors[2] = CCVector3::fromArray(vec.u);
-		}
-
+		//eigen values (and vectors) are sorted in decreasing order
+		//the smallest eigen vector corresponds to the "least square best fitting plane" normal
+		m_lsPlaneVectors[2] = CCVector3::fromArray(eigVectors[2].u);
 		//get also X (Y will be deduced by cross product, see below
-		{
-			CCVector3d vec;
-			double maxEigValue = 0;
-			Jacobi<double>::GetMaxEigenValueAndVector(eigVectors, eigValues, maxEigValue, vec.u);
-			m_lsPlaneVectors[0] = CCVector3::fromArray(vec.u);
-		}
+		m_lsPlaneVectors[0] = CCVector3::fromArray(eigVectors[0].u);
 #endif
 		//get the centroid (should already be up-to-date - see computeCovarianceMatrix)
 		G = *getGravityCenter();
@@ -357,7 +383,7 @@ bool Neighbourhood::computeQuadric()
 	if (!m_associatedCloud)
 		return false;
 
-	unsigned count = m_associatedCloud->size();
+	PointIndexType count = m_associatedCloud->size();
 	
 	assert(CC_LOCAL_MODEL_MIN_SIZE[QUADRIC] >= 5);
 	if (count < CC_LOCAL_MODEL_MIN_SIZE[QUADRIC])
@@ -412,7 +438,7 @@ bool Neighbourhood::computeQuadric()
 	{
 		float* _A = A.data();
 		float* _b = b.data();
-		for (unsigned i = 0; i < count; ++i)
+		for (PointIndexType i = 0; i < count; ++i)
 		{
 			CCVector3 P = *m_associatedCloud->getPoint(i) - *G;
 
@@ -459,7 +485,7 @@ bool Neighbourhood::computeQuadric()
 				double tmp = 0;
 				float* _Ai = &(A[i]);
 				float* _Aj = &(A[j]);
-				for (unsigned k = 0; k < count; ++k, _Ai += 6, _Aj += 6)
+				for (PointIndexType k = 0; k < count; ++k, _Ai += 6, _Aj += 6)
 				{
 					//tmp += A[(6*k)+i] * A[(6*k)+j];
 					tmp += static_cast<double>(*_Ai) * static_cast<double>(*_Aj);
@@ -471,7 +497,7 @@ bool Neighbourhood::computeQuadric()
 			{
 				double tmp = 0;
 				float* _Ai = &(A[i]);
-				for (unsigned k = 0; k<count; ++k, _Ai += 6)
+				for (PointIndexType k = 0; k<count; ++k, _Ai += 6)
 				{
 					//tmp += A[(6*k)+i]*b[k];
 					tmp += static_cast<double>(*_Ai) * static_cast<double>(b[k]);
@@ -596,7 +622,7 @@ bool Neighbourhood::compute3DQuadric(double quadricEquation[10])
 	//we look for the eigen vector associated to the minimum eigen value of a matrix A
 	//where A=transpose(D)*D, and D=[xi^2 yi^2 zi^2 xiyi yizi xizi xi yi zi 1] (i=1..N)
 
-	unsigned count = m_associatedCloud->size();
+	PointIndexType count = m_associatedCloud->size();
 
 	//we compute M = [x2 y2 z2 xy yz xz x y z 1] for all points
 	std::vector<PointCoordinateType> M;
@@ -611,7 +637,7 @@ bool Neighbourhood::compute3DQuadric(double quadricEquation[10])
 		}
 
 		PointCoordinateType* _M = M.data();
-		for (unsigned i = 0; i < count; ++i)
+		for (PointIndexType i = 0; i < count; ++i)
 		{
 			const CCVector3 P = *m_associatedCloud->getPoint(i) - *G;
 
@@ -637,7 +663,7 @@ bool Neighbourhood::compute3DQuadric(double quadricEquation[10])
 		{
 			double sum = 0;
 			const PointCoordinateType* _M = M.data();
-			for (unsigned i = 0; i < count; ++i, _M += 10)
+			for (PointIndexType i = 0; i < count; ++i, _M += 10)
 				sum += static_cast<double>(_M[l] * _M[c]);
 
 			D.m_values[l][c] = sum;
@@ -715,7 +741,7 @@ GenericIndexedMesh* Neighbourhood::triangulateOnPlane(	bool duplicateVertices/*=
 		if (duplicateVertices)
 		{
 			PointCloud* cloud = new PointCloud();
-			const unsigned count = m_associatedCloud->size();
+			const PointIndexType count = m_associatedCloud->size();
 			if (!cloud->reserve(count))
 			{
 				if (errorStr)
@@ -724,7 +750,7 @@ GenericIndexedMesh* Neighbourhood::triangulateOnPlane(	bool duplicateVertices/*=
 				delete cloud;
 				return nullptr;
 			}
-			for (unsigned i=0; i<count; ++i)
+			for (PointIndexType i=0; i<count; ++i)
 				cloud->addPoint(*m_associatedCloud->getPoint(i));
 			dm->linkMeshWith(cloud,true);
 		}
@@ -843,26 +869,22 @@ ScalarType Neighbourhood::computeMomentOrder1(const CCVector3& P)
 		return NAN_VALUE;
 	}
 
-	SquareMatrixd eigVectors;
-	std::vector<double> eigValues;
-	if (!Jacobi<double>::ComputeEigenValuesAndVectors(computeCovarianceMatrix(), eigVectors, eigValues, true))
+	const CCVector3d* eigVectors = getEigenVectors();
+	if (!eigVectors)
 	{
 		//failed to compute the eigen values
 		return NAN_VALUE;
 	}
 
-	Jacobi<double>::SortEigenValuesAndVectors(eigVectors, eigValues); //sort the eigenvectors in decreasing order of their associated eigenvalues
-
 	double m1 = 0.0, m2 = 0.0;
-	CCVector3d e2;
-	Jacobi<double>::GetEigenVector(eigVectors, 1, e2.u);
+	const CCVector3d& e2 = eigVectors[1];
 
-	for (unsigned i = 0; i < m_associatedCloud->size(); ++i)
+	ForEachPoint(m_associatedCloud, [&](PointIndexType, const CCVector3& Q)
 	{
-		double dotProd = CCVector3d::fromArray((*m_associatedCloud->getPoint(i) - P).u).dot(e2);
+		double dotProd = CCVector3d::fromArray((Q - P).u).dot(e2);
 		m1 += dotProd;
 		m2 += dotProd * dotProd;
-	}
+	});
 
 	//see "Contour detection in unstructured 3D point clouds", Hackel et al 2016
 	return (m2 < std::numeric_limits<double>::epsilon() ? NAN_VALUE : static_cast<ScalarType>((m1 * m1) / m2));
@@ -876,17 +898,15 @@ double Neighbourhood::computeFeature(GeomFeature feature)
 		return std::numeric_limits<double>::quiet_NaN();
 	}
 	
-	SquareMatrixd eigVectors;
-	std::vector<double> eigValues;
-	if (!Jacobi<double>::ComputeEigenValuesAndVectors(computeCovarianceMatrix(), eigVectors, eigValues, true))
+	//the eigen values and vectors are shared by all the features (see getEigenValues)
+	const double* eigValues = getEigenValues();
+	if (!eigValues)
 	{
 		//failed to compute the eigen values
 		return std::numeric_limits<double>::quiet_NaN();
 	}
 
-	Jacobi<double>::SortEigenValuesAndVectors(eigVectors, eigValues); //sort the eigenvectors in decreasing order of their associated eigenvalues
-
-	//shortcuts
+	//shortcuts (eigen values are sorted in decreasing order)
 	const double& l1 = eigValues[0];
 	const double& l2 = eigValues[1];
 	const double& l3 = eigValues[2];
@@ -944,8 +964,7 @@ double Neighbourhood::computeFeature(GeomFeature feature)
 	case Verticality:
 		{
 			CCVector3d Z(0, 0, 1);
-			CCVector3d e3(Z);
-			Jacobi<double>::GetEigenVector(eigVectors, 2, e3.u);
+			const CCVector3d& e3 = m_eigVectors[2];
 
 			value = 1.0 - std::abs(Z.dot(e3));
 		}
@@ -1037,7 +1056,7 @@ ScalarType Neighbourhood::computeCurvature(const CCVector3& P, CurvatureType cTy
 	case NORMAL_CHANGE_RATE:
 		{
 			assert(m_associatedCloud);
-			unsigned pointCount = (m_associatedCloud ? m_associatedCloud->size() : 0);
+			PointIndexType pointCount = (m_associatedCloud ? m_associatedCloud->size() : 0);
 
 			//we need at least 4 points
 			if (pointCount < 4)
@@ -1047,10 +1066,9 @@ ScalarType Neighbourhood::computeCurvature(const CCVector3& P, CurvatureType cTy
 			}
 
 			//we determine plane normal by computing the smallest eigen value of M = 1/n * S[(p-µ)*(p-µ)']
-			CCLib::SquareMatrixd covMat = computeCovarianceMatrix();
 			CCVector3d e(0, 0, 0);
 #ifdef USE_EIGEN
-			Eigen::Matrix3d A = ToEigen(covMat);
+			Eigen::Matrix3d A = ToEigen(computeCovarianceMatrix());
 			Eigen::SelfAdjointEigenSolver<Eigen::Matrix3d> es;
 			es.compute(A);
 
@@ -1060,9 +1078,8 @@ ScalarType Neighbourhood::computeCurvature(const CCVector3& P, CurvatureType cTy
 			//compute curvature as the rate of change of the surface
 			e = CCVector3d::fromArray(eVal.data());
 #else
-			CCLib::SquareMatrixd eigVectors;
-			std::vector<double> eigValues;
-			if (!Jacobi<double>::ComputeEigenValuesAndVectors(covMat, eigVectors, eigValues, true))
+			const double* eigValues = getEigenValues();
+			if (!eigValues)
 			{
 				//failure
 				return NAN_VALUE;
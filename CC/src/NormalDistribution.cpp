@@ -104,8 +104,8 @@ bool NormalDistribution::computeParameters(const GenericCloud* cloud)
 	double mean = 0.0, stddev2 = 0.0;
 	unsigned counter = 0;
 
-	unsigned n = cloud->size();
-	for (unsigned i = 0; i < n; ++i)
+	PointIndexType n = cloud->size();
+	for (PointIndexType i = 0; i < n; ++i)
 	{
 		ScalarType v = cloud->getPointScalarValue(i);
 		if (ScalarField::ValidValue(v))
@@ -192,7 +192,7 @@ double NormalDistribution::computeChi2Dist(const GenericCloud* cloud, unsigned n
 {
 	assert(cloud);
 
-	unsigned n = cloud->size();
+	PointIndexType n = cloud->size();
 
 	//we must refine the real number of elements
 	unsigned numberOfElements = ScalarFieldTools::countScalarFieldValidValues(cloud);
@@ -219,7 +219,7 @@ double NormalDistribution::computeChi2Dist(const GenericCloud* cloud, unsigned n
 	memset(_histo, 0, numberOfClasses*sizeof(int));
 
 	//histogram computation
-	for (unsigned i = 0; i < n; ++i)
+	for (PointIndexType i = 0; i < n; ++i)
 	{
 		ScalarType V = cloud->getPointScalarValue(i);
 		if (ScalarField::ValidValue(V))
@@ -44,7 +44,7 @@ PointCloud* PointProjectionTools::developCloudOnCylinder(	GenericCloud* cloud,
 	unsigned char dim1 = (dim > 0 ? dim-1 : 2);
 	unsigned char dim2 = (dim < 2 ? dim+1 : 0);
 
-	unsigned count = cloud->size();
+	PointIndexType count = cloud->size();
 
 	PointCloud* newCloud = new PointCloud();
 	if (!newCloud->reserve(count)) //not enough memory
@@ -67,7 +67,7 @@ PointCloud* PointProjectionTools::developCloudOnCylinder(	GenericCloud* cloud,
 		{
 			progressCb->setMethodTitle("Develop");
 			char buffer[256];
-			sprintf(buffer, "Number of points = %u", count);
+			sprintf(buffer, "Number of points = %llu", static_cast<unsigned long long>(count));
 			progressCb->setInfo(buffer);
 		}
 		progressCb->update(0);
@@ -105,7 +105,7 @@ PointCloud* PointProjectionTools::developCloudOnCone(GenericCloud* cloud, unsign
 	if (!cloud)
 		return nullptr;
 
-	unsigned count = cloud->size();
+	PointIndexType count = cloud->size();
 
 	PointCloud* outCloud = new PointCloud();
 	if (!outCloud->reserve(count)) //not enough memory
@@ -128,14 +128,14 @@ PointCloud* PointProjectionTools::developCloudOnCone(GenericCloud* cloud, unsign
 		{
 			progressCb->setMethodTitle("DevelopOnCone");
 			char buffer[256];
-			sprintf(buffer, "Number of points = %u", count);
+			sprintf(buffer, "Number of points = %llu", static_cast<unsigned long long>(count));
 			progressCb->setInfo(buffer);
 		}
 		progressCb->update(0);
 		progressCb->start();
 	}
 
-	for (unsigned i=0; i<count; i++)
+	for (PointIndexType i=0; i<count; i++)
 	{
 		const CCVector3 *Q = cloud->getNextPoint();
 		CCVector3 P = *Q-center;
@@ -183,7 +183,7 @@ PointCloud* PointProjectionTools::applyTransformation(GenericCloud* cloud, Trans
 {
 	assert(cloud);
 
-	unsigned count = cloud->size();
+	PointIndexType count = cloud->size();
 
 	PointCloud* transformedCloud = new PointCloud();
 	if (!transformedCloud->reserve(count))
@@ -196,7 +196,7 @@ PointCloud* PointProjectionTools::applyTransformation(GenericCloud* cloud, Trans
 		{
 			progressCb->setMethodTitle("ApplyTransformation");
 			char buffer[256];
-			sprintf(buffer, "Number of points = %u", count);
+			sprintf(buffer, "Number of points = %llu", static_cast<unsigned long long>(count));
 			progressCb->setInfo(buffer);
 		}
 		progressCb->update(0);
@@ -273,7 +273,7 @@ GenericIndexedMesh* PointProjectionTools::computeTriangulation(	GenericIndexedCl
 			const unsigned char X = Z == 2 ? 0 : Z+1;
 			const unsigned char Y = X == 2 ? 0 : X+1;
 
-			unsigned count = cloud->size();
+			PointIndexType count = cloud->size();
 			std::vector<CCVector2> the2DPoints;
 			try
 			{
@@ -287,7 +287,7 @@ GenericIndexedMesh* PointProjectionTools::computeTriangulation(	GenericIndexedCl
 			}
 
 			cloud->placeIteratorAtBeginning();
-			for (unsigned i=0; i<count; ++i)
+			for (PointIndexType i=0; i<count; ++i)
 			{
 				const CCVector3* P = cloud->getPoint(i);
 				the2DPoints[i].x = P->u[X];
@@ -17,6 +17,7 @@
 //##########################################################################
 
 #include "ReferenceCloud.h"
+#include "PointsSpan.h"
 
 //system
 #include <algorithm>
@@ -32,8 +33,14 @@ ReferenceCloud::ReferenceCloud(GenericIndexedCloudPersist* associatedCloud)
 ReferenceCloud::ReferenceCloud(const ReferenceCloud& refCloud)
 	: m_globalIterator(0)
 	, m_theAssociatedCloud(refCloud.m_theAssociatedCloud)
-	, m_theIndexes(refCloud.m_theIndexes) //we don't catch any exception so that the caller of the constructor can do it!
 {
+	//we don't catch any exception so that the caller of the constructor can do it!
+	//we use the (virtual) accessors as 'refCloud' may not store its indexes (e.g. octree cells)
+	m_theIndexes.resize(refCloud.size());
+	for (PointIndexType i = 0; i < refCloud.size(); ++i)
+	{
+		m_theIndexes[i] = refCloud.getPointGlobalIndex(i);
+	}
 }
 
 void ReferenceCloud::clear(bool releaseMemory/*=false*/)
@@ -51,17 +58,27 @@ void ReferenceCloud::getBoundingBox(CCVector3& bbMin, CCVector3& bbMax)
 	if (!m_bbox.isValid())
 	{
 		m_bbox.clear();
-		for (unsigned index : m_theIndexes)
-		{
-			m_bbox.add(*m_theAssociatedCloud->getPoint(index));
-		}
+		ForEachPoint(this, [this](PointIndexType, const CCVector3& P) { m_bbox.add(P); });
 	}
 
 	bbMin = m_bbox.minCorner();
 	bbMax = m_bbox.maxCorner();
 }
 
-bool ReferenceCloud::reserve(unsigned n)
+bool ReferenceCloud::getPointsSpan(PointsSpan& span) const
+{
+	//we only handle a single level of indirection
+	PointsSpan parentSpan;
+	if (!m_theAssociatedCloud || !m_theAssociatedCloud->getPointsSpan(parentSpan) || parentSpan.indexes)
+	{
+		return false;
+	}
+
+	span = PointsSpan(parentSpan.points, size(), m_theIndexes.data());
+	return true;
+}
+
+bool ReferenceCloud::reserve(PointIndexType n)
 {
 	try
 	{
@@ -75,7 +92,7 @@ bool ReferenceCloud::reserve(unsigned n)
 	return true;
 }
 
-bool ReferenceCloud::resize(unsigned n)
+bool ReferenceCloud::resize(PointIndexType n)
 {
 	try
 	{
@@ -96,7 +113,7 @@ const CCVector3* ReferenceCloud::getCurrentPointCoordinates() const
 	return m_theAssociatedCloud->getPointPersistentPtr(m_theIndexes[m_globalIterator]);
 }
 
-bool ReferenceCloud::addPointIndex(unsigned globalIndex)
+bool ReferenceCloud::addPointIndex(PointIndexType globalIndex)
 {
 	try
 	{
@@ -111,7 +128,7 @@ bool ReferenceCloud::addPointIndex(unsigned globalIndex)
 	return true;
 }
 
-bool ReferenceCloud::addPointIndex(unsigned firstIndex, unsigned lastIndex)
+bool ReferenceCloud::addPointIndex(PointIndexType firstIndex, PointIndexType lastIndex)
 {
 	if (firstIndex >= lastIndex)
 	{
@@ -119,8 +136,8 @@ bool ReferenceCloud::addPointIndex(unsigned firstIndex, unsigned lastIndex)
 		return false;
 	}
 
-	unsigned range = lastIndex - firstIndex; //lastIndex is excluded
-    unsigned pos = size();
+	PointIndexType range = lastIndex - firstIndex; //lastIndex is excluded
+    PointIndexType pos = size();
 
 	if (size() < pos + range)
 	{
@@ -134,7 +151,7 @@ bool ReferenceCloud::addPointIndex(unsigned firstIndex, unsigned lastIndex)
 		}
 	}
 	
-	for (unsigned i = 0; i < range; ++i, ++firstIndex)
+	for (PointIndexType i = 0; i < range; ++i, ++firstIndex)
 	{
 		m_theIndexes[pos++] = firstIndex;
 	}
@@ -144,7 +161,7 @@ bool ReferenceCloud::addPointIndex(unsigned firstIndex, unsigned lastIndex)
 	return true;
 }
 
-void ReferenceCloud::setPointIndex(unsigned localIndex, unsigned globalIndex)
+void ReferenceCloud::setPointIndex(PointIndexType localIndex, PointIndexType globalIndex)
 {
 	assert(localIndex < size());
 	m_theIndexes[localIndex] = globalIndex;
@@ -155,10 +172,10 @@ void ReferenceCloud::forEach(genericPointAction action)
 {
 	assert(m_theAssociatedCloud);
 
-	unsigned count = size();
-	for (unsigned i = 0; i < count; ++i)
+	PointIndexType count = size();
+	for (PointIndexType i = 0; i < count; ++i)
 	{
-		const unsigned& index = m_theIndexes[i];
+		const PointIndexType& index = m_theIndexes[i];
 		ScalarType d = m_theAssociatedCloud->getPointScalarValue(index);
 		ScalarType d2 = d;
 		action(*m_theAssociatedCloud->getPointPersistentPtr(index), d2);
@@ -167,11 +184,11 @@ void ReferenceCloud::forEach(genericPointAction action)
 	}
 }
 
-void ReferenceCloud::removePointGlobalIndex(unsigned localIndex)
+void ReferenceCloud::removePointGlobalIndex(PointIndexType localIndex)
 {
 	assert(localIndex < size());
 
-	unsigned lastIndex = size() - 1;
+	PointIndexType lastIndex = size() - 1;
 	//swap the value to be removed with the last one
 	m_theIndexes[localIndex] = m_theIndexes[lastIndex];
 	m_theIndexes.resize(lastIndex);
@@ -190,7 +207,8 @@ bool ReferenceCloud::add(const ReferenceCloud& cloud)
 		return false;
 	}
 
-	std::size_t newCount = cloud.m_theIndexes.size();
+	//we use the (virtual) accessors as 'cloud' may not store its indexes (e.g. octree cells)
+	std::size_t newCount = cloud.size();
 	if (newCount == 0)
 		return true;
 
@@ -206,9 +224,9 @@ bool ReferenceCloud::add(const ReferenceCloud& cloud)
 	}
 
 	//copy new indexes (warning: no duplicate check!)
-	for (unsigned i = 0; i < newCount; ++i)
+	for (PointIndexType i = 0; i < newCount; ++i)
 	{
-		m_theIndexes[count + i] = cloud.m_theIndexes[i];
+		m_theIndexes[count + i] = cloud.getPointGlobalIndex(i);
 	}
 
 	invalidateBoundingBox();
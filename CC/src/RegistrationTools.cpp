@@ -20,6 +20,7 @@
 
 //local
 #include <CloudSamplingTools.h>
+#include <DgmOctree.h>
 #include <DistanceComputationTools.h>
 #include <Garbage.h>
 #include <GenericProgressCallback.h>
@@ -34,7 +35,9 @@
 #include <ScalarFieldTools.h>
 
 //system
+#include <chrono>
 #include <ctime>
+#include <memory>
 
 using namespace CCLib;
 
@@ -161,9 +164,20 @@ ICPRegistrationTools::RESULT_TYPE ICPRegistrationTools::Register(	GenericIndexed
 	}
 
 
+	//the point-to-plane metric requires the model normals
+	if (params.errorMetric == POINT_TO_PLANE && (inputModelMesh || !inputModelCloud->normalsAvailable()))
+	{
+		return ICP_ERROR_INVALID_INPUT;
+	}
+
 	//hopefully the user will understand it's not possible ;)
 	finalRMS = -1.0;
 
+	if (params.iterationStats)
+	{
+		params.iterationStats->clear();
+	}
+
 	Garbage<GenericIndexedCloudPersist> cloudGarbage;
 	Garbage<ScalarField> sfGarbage;
 
@@ -189,12 +203,12 @@ ICPRegistrationTools::RESULT_TYPE ICPRegistrationTools::Register(	GenericIndexed
 				data.weights = new ScalarField("ResampledDataWeights");
 				sfGarbage.add(data.weights);
 				
-				unsigned destCount = data.cloud->size();
+				PointIndexType destCount = data.cloud->size();
 				if (data.weights->resizeSafe(destCount))
 				{
-					for (unsigned i = 0; i < destCount; ++i)
+					for (PointIndexType i = 0; i < destCount; ++i)
 					{
-						unsigned pointIndex = data.cloud->getPointGlobalIndex(i);
+						PointIndexType pointIndex = data.cloud->getPointGlobalIndex(i);
 						data.weights->setValue(i, params.dataWeights->getValue(pointIndex));
 					}
 					data.weights->computeMinAndMax();
@@ -268,12 +282,12 @@ ICPRegistrationTools::RESULT_TYPE ICPRegistrationTools::Register(	GenericIndexed
 				model.weights = new ScalarField("ResampledModelWeights");
 				sfGarbage.add(model.weights);
 
-				unsigned destCount = subModelCloud->size();
+				PointIndexType destCount = subModelCloud->size();
 				if (model.weights->resizeSafe(destCount))
 				{
-					for (unsigned i = 0; i < destCount; ++i)
+					for (PointIndexType i = 0; i < destCount; ++i)
 					{
-						unsigned pointIndex = subModelCloud->getPointGlobalIndex(i);
+						PointIndexType pointIndex = subModelCloud->getPointGlobalIndex(i);
 						model.weights->setValue(i, params.modelWeights->getValue(pointIndex));
 					}
 					model.weights->computeMinAndMax();
@@ -326,6 +340,75 @@ ICPRegistrationTools::RESULT_TYPE ICPRegistrationTools::Register(	GenericIndexed
 		cloudGarbage.add(data.CPSetRef);
 	}
 
+	//model search structure (computed only once as the model doesn't move)
+	std::unique_ptr<DgmOctree> modelOctree;
+	unsigned char modelOctreeLevel = 0;
+	if (!inputModelMesh)
+	{
+		modelOctree.reset(new DgmOctree(model.cloud));
+		if (modelOctree->build(progressCb) <= 0)
+		{
+			//an error occurred during the octree computation: probably there's not enough memory
+			return ICP_ERROR_NOT_ENOUGH_MEMORY;
+		}
+		modelOctreeLevel = modelOctree->findBestLevelForAGivenPopulationPerCell(4);
+	}
+
+	//closest points (model) of the data points, searched in parallel on the model octree
+	//(the distances are stored as the data cloud scalar values)
+	std::vector<CCVector3> queryPoints;
+	DgmOctree::BatchNeighbourhoods closestPoints;
+	auto computeClosestPoints = [&](DataCloud& d, GenericProgressCallback* cb) -> bool
+	{
+		assert(modelOctree && d.CPSetRef);
+		PointIndexType count = d.cloud->size();
+		try
+		{
+			queryPoints.resize(count);
+		}
+		catch (const std::bad_alloc&)
+		{
+			//not enough memory
+			return false;
+		}
+		//the data cloud may have been replaced by its transformed version
+		if (!d.cloud->enableScalarField())
+		{
+			//not enough memory
+			return false;
+		}
+		for (PointIndexType i = 0; i < count; ++i)
+		{
+			d.cloud->getPoint(i, queryPoints[i]);
+		}
+
+		if (!modelOctree->findNearestNeighborsBatch(queryPoints.data(), count, 1, modelOctreeLevel, closestPoints, 0, params.maxThreadCount != 1, cb))
+		{
+			return false;
+		}
+
+		d.CPSetRef->clear();
+		if (!d.CPSetRef->reserve(count))
+		{
+			//not enough memory
+			return false;
+		}
+		for (PointIndexType i = 0; i < count; ++i)
+		{
+			if (closestPoints.neighbourCount(i) == 0)
+			{
+				//shouldn't happen (unbounded search)
+				assert(false);
+				return false;
+			}
+			std::size_t pos = closestPoints.offsets[i];
+			d.CPSetRef->addPointIndex(closestPoints.indexes[pos]);
+			d.cloud->setPointScalarValue(i, static_cast<ScalarType>(sqrt(closestPoints.squareDistances[pos])));
+		}
+
+		return true;
+	};
+
 	//per-point couple weights
 	ScalarField* coupleWeights = nullptr;
 	if (model.weights || data.weights)
@@ -336,6 +419,7 @@ ICPRegistrationTools::RESULT_TYPE ICPRegistrationTools::Register(	GenericIndexed
 
 	//we compute the initial distance between the two clouds (and the CPSet by the way)
 	//data.cloud->forEach(ScalarFieldTools::SetScalarValueToNaN); //DGM: done automatically in computeCloud2CloudDistance now
+	auto startTime = std::chrono::steady_clock::now();
 	if (inputModelMesh)
 	{
 		assert(data.CPSetPlain);
@@ -351,11 +435,7 @@ ICPRegistrationTools::RESULT_TYPE ICPRegistrationTools::Register(	GenericIndexed
 	}
 	else if (inputModelCloud)
 	{
-		assert(data.CPSetRef);
-		DistanceComputationTools::Cloud2CloudDistanceComputationParams c2cDistParams;
-		c2cDistParams.CPSet = data.CPSetRef;
-		c2cDistParams.maxThreadCount = params.maxThreadCount;
-		if (DistanceComputationTools::computeCloud2CloudDistance(data.cloud, model.cloud, c2cDistParams, progressCb) < 0)
+		if (!computeClosestPoints(data, progressCb))
 		{
 			//an error occurred during distances computation...
 			return ICP_ERROR_DIST_COMPUTATION;
@@ -365,6 +445,7 @@ ICPRegistrationTools::RESULT_TYPE ICPRegistrationTools::Register(	GenericIndexed
 	{
 		assert(false);
 	}
+	double closestPointsTime_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
 
 	FILE* fTraceFile = nullptr;
 #ifdef CC_DEBUG
@@ -418,7 +499,7 @@ ICPRegistrationTools::RESULT_TYPE ICPRegistrationTools::Register(	GenericIndexed
 					sfGarbage.add(filteredData.weights);
 				}
 
-				unsigned pointCount = data.cloud->size();
+				PointIndexType pointCount = data.cloud->size();
 				if (	!filteredData.cloud->reserve(pointCount)
 					||	(filteredData.CPSetRef && !filteredData.CPSetRef->reserve(pointCount))
 					||	(filteredData.CPSetPlain && !filteredData.CPSetPlain->reserve(pointCount))
@@ -430,7 +511,7 @@ ICPRegistrationTools::RESULT_TYPE ICPRegistrationTools::Register(	GenericIndexed
 				}
 
 				//we keep only the points with "not too high" distances
-				for (unsigned i=0; i<pointCount; ++i)
+				for (PointIndexType i=0; i<pointCount; ++i)
 				{
 					if (data.cloud->getPointScalarValue(i) <= maxDistance)
 					{
@@ -469,11 +550,11 @@ ICPRegistrationTools::RESULT_TYPE ICPRegistrationTools::Register(	GenericIndexed
 
 		//shall we ignore/remove some points based on their distance?
 		DataCloud trueData;
-		unsigned pointCount = data.cloud->size();
+		PointIndexType pointCount = data.cloud->size();
 		if (maxOverlapCount != 0 && pointCount > maxOverlapCount)
 		{
 			assert(overlapDistances.size() >= pointCount);
-			for (unsigned i=0; i<pointCount; ++i)
+			for (PointIndexType i=0; i<pointCount; ++i)
 			{
 				overlapDistances[i] = data.cloud->getPointScalarValue(i);
 				assert(overlapDistances[i] == overlapDistances[i]);
@@ -514,7 +595,7 @@ ICPRegistrationTools::RESULT_TYPE ICPRegistrationTools::Register(	GenericIndexed
 			}
 
 			//we keep only the points with "not too high" distances
-			for (unsigned i=0; i<pointCount; ++i)
+			for (PointIndexType i=0; i<pointCount; ++i)
 			{
 				if (data.cloud->getPointScalarValue(i) <= maxOverlapDist)
 				{
@@ -547,7 +628,7 @@ ICPRegistrationTools::RESULT_TYPE ICPRegistrationTools::Register(	GenericIndexed
 		if (coupleWeights)
 		{
 			assert(model.weights || data.weights);
-			unsigned count = data.cloud->size();
+			PointIndexType count = data.cloud->size();
 			assert(!model.weights || (data.CPSetRef && data.CPSetRef->size() == count));
 
 			if (coupleWeights->currentSize() != count && !coupleWeights->resizeSafe(count))
@@ -556,7 +637,7 @@ ICPRegistrationTools::RESULT_TYPE ICPRegistrationTools::Register(	GenericIndexed
 				result = ICP_ERROR_NOT_ENOUGH_MEMORY;
 				break;
 			}
-			for (unsigned i = 0; i<count; ++i)
+			for (PointIndexType i = 0; i<count; ++i)
 			{
 				ScalarType wd = (data.weights ? data.weights->getValue(i) : static_cast<ScalarType>(1.0));
 				ScalarType wm = (model.weights ? model.weights->getValue(data.CPSetRef->getPointGlobalIndex(i)) : static_cast<ScalarType>(1.0)); //model weights are only support with a reference cloud!
@@ -577,6 +658,21 @@ ICPRegistrationTools::RESULT_TYPE ICPRegistrationTools::Register(	GenericIndexed
 				ScalarType V = data.cloud->getPointScalarValue(i);
 				if (ScalarField::ValidValue(V))
 				{
+					if (params.errorMetric == POINT_TO_PLANE)
+					{
+						//distance to the tangent plane of the closest point
+						//(or point-to-point distance if this point has no normal)
+						assert(data.CPSetRef);
+						const CCVector3* N = data.CPSetRef->getNormal(i);
+						if (N)
+						{
+							CCVector3 P, Q;
+							data.cloud->getPoint(i, P);
+							data.CPSetRef->getPoint(i, Q);
+							V = static_cast<ScalarType>(std::abs((P - Q).dot(*N)));
+						}
+					}
+
 					double wi = 1.0;
 					if (coupleWeights)
 					{
@@ -600,6 +696,23 @@ ICPRegistrationTools::RESULT_TYPE ICPRegistrationTools::Register(	GenericIndexed
 			if (fTraceFile)
 				fprintf(fTraceFile, "%u; %f; %u;\n", iteration, rms, data.cloud->size());
 #endif
+
+			if (params.iterationStats)
+			{
+				IterationStats stats;
+				stats.iteration = iteration;
+				stats.rms = rms;
+				stats.pointCount = data.cloud->size();
+				stats.closestPointsTime_ms = closestPointsTime_ms;
+				try
+				{
+					params.iterationStats->push_back(stats);
+				}
+				catch (const std::bad_alloc&)
+				{
+					//not enough memory: we simply stop collecting statistics
+				}
+			}
 			if (iteration == 0)
 			{
 				//progress notification
@@ -702,15 +815,32 @@ ICPRegistrationTools::RESULT_TYPE ICPRegistrationTools::Register(	GenericIndexed
 
 		//single iteration of the registration procedure
 		currentTrans = ScaledTransformation();
-		if (!RegistrationTools::RegistrationProcedure(	data.cloud,
-														data.CPSetRef ? static_cast<CCLib::GenericCloud*>(data.CPSetRef) : static_cast<CCLib::GenericCloud*>(data.CPSetPlain),
-														currentTrans,
-														params.adjustScale,
-														coupleWeights))
+		startTime = std::chrono::steady_clock::now();
+		bool registrationSuccess = false;
+		if (params.errorMetric == POINT_TO_PLANE)
+		{
+			registrationSuccess = RegistrationTools::PointToPlaneRegistrationProcedure(	data.cloud,
+																						data.CPSetRef,
+																						currentTrans,
+																						coupleWeights);
+		}
+		else
+		{
+			registrationSuccess = RegistrationTools::RegistrationProcedure(	data.cloud,
+																			data.CPSetRef ? static_cast<CCLib::GenericCloud*>(data.CPSetRef) : static_cast<CCLib::GenericCloud*>(data.CPSetPlain),
+																			currentTrans,
+																			params.adjustScale,
+																			coupleWeights);
+		}
+		if (!registrationSuccess)
 		{
 			result = ICP_ERROR_REGISTRATION_STEP;
 			break;
 		}
+		if (params.iterationStats && !params.iterationStats->empty())
+		{
+			params.iterationStats->back().registrationTime_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+		}
 
 		//restore original data sets (if any were stored)
 		if (trueData.cloud)
@@ -770,6 +900,7 @@ ICPRegistrationTools::RESULT_TYPE ICPRegistrationTools::Register(	GenericIndexed
 		}
 
 		//compute (new) distances to model
+		startTime = std::chrono::steady_clock::now();
 		if (inputModelMesh)
 		{
 			DistanceComputationTools::Cloud2MeshDistanceComputationParams c2mDistParams;
@@ -785,10 +916,7 @@ ICPRegistrationTools::RESULT_TYPE ICPRegistrationTools::Register(	GenericIndexed
 		}
 		else if (inputDataCloud)
 		{
-			DistanceComputationTools::Cloud2CloudDistanceComputationParams c2cDistParams;
-			c2cDistParams.CPSet = data.CPSetRef;
-			c2cDistParams.maxThreadCount = params.maxThreadCount;
-			if (DistanceComputationTools::computeCloud2CloudDistance(data.cloud, model.cloud, c2cDistParams) < 0)
+			if (!computeClosestPoints(data, nullptr))
 			{
 				//an error occurred during distances computation...
 				result = ICP_ERROR_REGISTRATION_STEP;
@@ -799,6 +927,7 @@ ICPRegistrationTools::RESULT_TYPE ICPRegistrationTools::Register(	GenericIndexed
 		{
 			assert(false);
 		}
+		closestPointsTime_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
 	}
 
 	//end of tracefile
@@ -837,9 +966,9 @@ double HornRegistrationTools::ComputeRMS(GenericCloud* lCloud,
 
 	rCloud->placeIteratorAtBeginning();
 	lCloud->placeIteratorAtBeginning();
-	unsigned count = rCloud->size();
+	PointIndexType count = rCloud->size();
 			
-	for (unsigned i=0; i<count; i++)
+	for (PointIndexType i=0; i<count; i++)
 	{
 		const CCVector3* Ri = rCloud->getNextPoint();
 		const CCVector3* Li = lCloud->getNextPoint();
@@ -1090,9 +1219,9 @@ bool RegistrationTools::RegistrationProcedure(	GenericCloud* P, //data
 			X->placeIteratorAtBeginning();
 			P->placeIteratorAtBeginning();
 
-			unsigned count = X->size();
+			PointIndexType count = X->size();
 			assert(P->size() == count);
-			for (unsigned i=0; i<count; ++i)
+			for (PointIndexType i=0; i<count; ++i)
 			{
 				//'a' refers to the data 'A' (moving) = P
 				//'b' refers to the model 'B' (not moving) = X
@@ -1115,6 +1244,136 @@ bool RegistrationTools::RegistrationProcedure(	GenericCloud* P, //data
 	return true;
 }
 
+bool RegistrationTools::PointToPlaneRegistrationProcedure(	GenericIndexedCloud* P, //data
+															GenericIndexedCloud* X, //model
+															ScaledTransformation& trans,
+															ScalarField* coupleWeights/*=0*/)
+{
+	//resulting transformation (R is invalid on initialization, T is (0,0,0) and s==1)
+	trans.R.invalidate();
+	trans.T = CCVector3(0, 0, 0);
+	trans.s = PC_ONE;
+
+	if (P == nullptr || X == nullptr || P->size() != X->size() || P->size() < 6 || !X->normalsAvailable())
+		return false;
+
+	PointIndexType count = P->size();
+
+	//the rotation is linearized around the (weighted) gravity center of P (for a better numerical stability)
+	CCVector3d Gp(0, 0, 0);
+	double wSum = 0;
+	for (PointIndexType i = 0; i < count; ++i)
+	{
+		double wi = 1.0;
+		if (coupleWeights)
+		{
+			ScalarType w = coupleWeights->getValue(i);
+			if (!ScalarField::ValidValue(w))
+				continue;
+			wi = std::abs(w);
+		}
+		CCVector3 Pi;
+		P->getPoint(i, Pi);
+		Gp += CCVector3d::fromArray(Pi.u) * wi;
+		wSum += wi;
+	}
+	if (wSum < ZERO_TOLERANCE)
+		return false;
+	Gp /= wSum;
+
+	//for each couple, the residual (R.(Pi-Gp) + Gp + t - Xi).Ni is approximated by
+	//(Pi-Xi).Ni + w.((Pi-Gp) x Ni) + t.Ni (where w is the rotation vector)
+	//--> we solve the 6x6 normal equations (A^t.A).x = A^t.b with x = (w,t)
+	//If a model point has no normal, the couple contributes its point-to-point residual
+	//instead (i.e. the three residuals along the X, Y and Z axes).
+	static const CCVector3d Axes[3] = { CCVector3d(1, 0, 0), CCVector3d(0, 1, 0), CCVector3d(0, 0, 1) };
+	double AtA[6][6] = { {0} };
+	double Atb[6] = { 0 };
+	for (PointIndexType i = 0; i < count; ++i)
+	{
+		double wi = 1.0;
+		if (coupleWeights)
+		{
+			ScalarType w = coupleWeights->getValue(i);
+			if (!ScalarField::ValidValue(w))
+				continue;
+			wi = std::abs(w);
+		}
+
+		CCVector3 Pi, Xi;
+		P->getPoint(i, Pi);
+		X->getPoint(i, Xi);
+		const CCVector3* N = X->getNormal(i);
+		CCVector3d Ni = (N ? CCVector3d::fromArray(N->u) : CCVector3d(0, 0, 0));
+
+		CCVector3d p = CCVector3d::fromArray(Pi.u) - Gp;
+		CCVector3d x = CCVector3d::fromArray(Xi.u) - Gp;
+
+		const CCVector3d* directions = (N ? &Ni : Axes);
+		const unsigned directionCount = (N ? 1 : 3);
+		for (unsigned d = 0; d < directionCount; ++d)
+		{
+			const CCVector3d& n = directions[d];
+			CCVector3d c = p.cross(n);
+
+			double a[6] = { c.x, c.y, c.z, n.x, n.y, n.z };
+			double b = (x - p).dot(n);
+
+			for (unsigned r = 0; r < 6; ++r)
+			{
+				for (unsigned k = r; k < 6; ++k)
+				{
+					AtA[r][k] += wi * a[r] * a[k];
+				}
+				Atb[r] += wi * a[r] * b;
+			}
+		}
+	}
+
+	SquareMatrixd M(6);
+	for (unsigned r = 0; r < 6; ++r)
+	{
+		for (unsigned k = r; k < 6; ++k)
+		{
+			M.m_values[r][k] = M.m_values[k][r] = AtA[r][k];
+		}
+	}
+
+	SquareMatrixd invM = M.inv();
+	if (!invM.isValid())
+	{
+		//degenerate configuration (e.g. all the normals are parallel)
+		return false;
+	}
+
+	double solution[6];
+	invM.apply(Atb, solution);
+
+	//rotation (from the rotation vector)
+	CCVector3d w(solution[0], solution[1], solution[2]);
+	double angle_rad = w.norm();
+	if (angle_rad < ZERO_TOLERANCE)
+	{
+		trans.R = SquareMatrix(3);
+		trans.R.toIdentity();
+	}
+	else
+	{
+		w /= angle_rad;
+		double sin_a = sin(angle_rad / 2);
+		double q[4] = { cos(angle_rad / 2), w.x * sin_a, w.y * sin_a, w.z * sin_a };
+		trans.R.initFromQuaternion(q);
+	}
+
+	//translation: X = R.(P-Gp) + Gp + t = R.P + (Gp - R.Gp + t)
+	CCVector3 Gpf = CCVector3::fromArray(Gp.u);
+	trans.T = Gpf - trans.R * Gpf + CCVector3(	static_cast<PointCoordinateType>(solution[3]),
+												static_cast<PointCoordinateType>(solution[4]),
+												static_cast<PointCoordinateType>(solution[5]));
+
+	return true;
+}
+
 bool FPCSRegistrationTools::RegisterClouds(	GenericIndexedCloud* modelCloud,
 											GenericIndexedCloud* dataCloud,
 											ScaledTransformation& transform,
@@ -1180,7 +1439,7 @@ bool FPCSRegistrationTools::RegisterClouds(	GenericIndexedCloud* modelCloud,
 
 		//Search for all the congruent bases in the second cloud
 		std::vector<Base> candidates;
-		unsigned count = dataCloud->size();
+		PointIndexType count = dataCloud->size();
 		candidates.reserve(count);
 		if (candidates.capacity() < count) //not enough memory
 		{
@@ -1277,8 +1536,8 @@ bool FPCSRegistrationTools::RegisterClouds(	GenericIndexedCloud* modelCloud,
 
 	unsigned score = 0;
 
-	unsigned count = dataCloud->size();
-	for (unsigned i=0; i<count; ++i)
+	PointIndexType count = dataCloud->size();
+	for (PointIndexType i=0; i<count; ++i)
 	{
 		dataCloud->getPoint(i,Q);
 		//Apply rigid transform to each point
@@ -139,7 +139,7 @@ bool ScalarFieldTools::computeMeanGradientOnPatch(	const DgmOctree::octreeCell&
 	ScalarField* theGradientNorms	= reinterpret_cast<ScalarField*>(additionalParameters[2]);
 
 	//number of points inside the current cell
-	unsigned n = cell.points->size();
+	PointIndexType n = cell.points->size();
 
 	//spherical neighborhood extraction structure
 	DgmOctree::NearestNeighboursSphericalSearchStruct nNSS;
@@ -159,7 +159,7 @@ bool ScalarFieldTools::computeMeanGradientOnPatch(	const DgmOctree::octreeCell&
 			return false;
 		}
 		DgmOctree::NeighboursSet::iterator it = nNSS.pointsInNeighbourhood.begin();
-		for (unsigned j = 0; j < n; ++j, ++it)
+		for (PointIndexType j = 0; j < n; ++j, ++it)
 		{
 			it->point = cell.points->getPointPersistentPtr(j);
 			it->pointIndex = cell.points->getPointGlobalIndex(j);
@@ -169,7 +169,7 @@ bool ScalarFieldTools::computeMeanGradientOnPatch(	const DgmOctree::octreeCell&
 
 	const GenericIndexedCloudPersist* cloud = cell.points->getAssociatedCloud();
 
-	for (unsigned i = 0; i < n; ++i)
+	for (PointIndexType i = 0; i < n; ++i)
 	{
 		ScalarType gN = NAN_VALUE;
 		ScalarType v1 = cell.points->getPointScalarValue(i);
@@ -248,7 +248,7 @@ bool ScalarFieldTools::applyScalarFieldGaussianFilter(PointCoordinateType sigma,
 	if (!theCloud)
         return false;
 
-	unsigned n = theCloud->size();
+	PointIndexType n = theCloud->size();
 	if (n==0)
         return false;
 
@@ -323,7 +323,7 @@ bool ScalarFieldTools::computeCellGaussianFilter(	const DgmOctree::octreeCell& c
     PointCoordinateType sigmaSF2 = 2*sigmaSF*sigmaSF;
 
 	//number of points inside the current cell
-	unsigned n = cell.points->size();
+	PointIndexType n = cell.points->size();
 
 	//structures pour la recherche de voisinages SPECIFIQUES
 	DgmOctree::NearestNeighboursSphericalSearchStruct nNSS;
@@ -344,7 +344,7 @@ bool ScalarFieldTools::computeCellGaussianFilter(	const DgmOctree::octreeCell& c
 	
 	DgmOctree::NeighboursSet::iterator it = nNSS.pointsInNeighbourhood.begin();
 	{
-		for (unsigned i=0; i<n; ++i,++it)
+		for (PointIndexType i=0; i<n; ++i,++it)
 		{
 			it->point = cell.points->getPointPersistentPtr(i);
 			it->pointIndex = cell.points->getPointGlobalIndex(i);
@@ -357,7 +357,7 @@ bool ScalarFieldTools::computeCellGaussianFilter(	const DgmOctree::octreeCell& c
     //Pure Gaussian Filtering
     if (sigmaSF == -1)
     {
-        for (unsigned i=0; i<n; ++i) //for each point in cell
+        for (PointIndexType i=0; i<n; ++i) //for each point in cell
         {
             //we get the points inside a spherical neighbourhood (radius: '3*sigma')
             cell.points->getPoint(i,nNSS.queryPoint);
@@ -391,7 +391,7 @@ bool ScalarFieldTools::computeCellGaussianFilter(	const DgmOctree::octreeCell& c
     //Bilateral Filtering using the second sigma parameters on values (when given)
     else
     {
-        for (unsigned i=0;i<n;++i) //for each point in cell
+        for (PointIndexType i=0;i<n;++i) //for each point in cell
         {
             ScalarType queryValue = cell.points->getPointScalarValue(i); //scalar of the query point
 
@@ -432,11 +432,11 @@ void ScalarFieldTools::multiplyScalarFields(GenericIndexedCloud* firstCloud, Gen
 	if (!firstCloud || !secondCloud)
 		return;
 
-	unsigned n1 = firstCloud->size();
+	PointIndexType n1 = firstCloud->size();
 	if (n1 != secondCloud->size() || n1 == 0)
 		return;
 
-	for (unsigned i = 0; i < n1; ++i)
+	for (PointIndexType i = 0; i < n1; ++i)
 	{
 		ScalarType V1 = firstCloud->getPointScalarValue(i);
 		ScalarType V2 = secondCloud->getPointScalarValue(i);
@@ -451,13 +451,13 @@ void ScalarFieldTools::computeScalarFieldExtremas(const GenericCloud* theCloud,
 
 	minV = maxV = NAN_VALUE;
 
-	unsigned numberOfPoints = theCloud ? theCloud->size() : 0;
+	PointIndexType numberOfPoints = theCloud ? theCloud->size() : 0;
 	if (numberOfPoints == 0)
 		return;
 
 	bool firstValidValue = true;
 
-	for (unsigned i = 0; i < numberOfPoints; ++i)
+	for (PointIndexType i = 0; i < numberOfPoints; ++i)
 	{
 		ScalarType V = theCloud->getPointScalarValue(i);
 		if (ScalarField::ValidValue(V))
@@ -486,8 +486,8 @@ unsigned ScalarFieldTools::countScalarFieldValidValues(const GenericCloud* theCl
 
 	if (theCloud)
 	{
-		unsigned n = theCloud->size();
-		for (unsigned i = 0; i < n; ++i)
+		PointIndexType n = theCloud->size();
+		for (PointIndexType i = 0; i < n; ++i)
 		{
 			ScalarType V = theCloud->getPointScalarValue(i);
 			if (ScalarField::ValidValue(V))
@@ -509,7 +509,7 @@ void ScalarFieldTools::computeScalarFieldHistogram(const GenericCloud* theCloud,
 		assert(false);
 		return;
 	}
-	unsigned pointCount = theCloud->size();
+	PointIndexType pointCount = theCloud->size();
 
 	//specific case: 1 class?!
 	if (numberOfClasses == 1)
@@ -546,7 +546,7 @@ void ScalarFieldTools::computeScalarFieldHistogram(const GenericCloud* theCloud,
 	//histogram computation
 	{
 		int iNumberOfClasses = static_cast<int>(numberOfClasses);
-		for (unsigned i = 0; i < pointCount; ++i)
+		for (PointIndexType i = 0; i < pointCount; ++i)
 		{
 			ScalarType V = theCloud->getPointScalarValue(i);
 			if (ScalarField::ValidValue(V))
@@ -573,7 +573,7 @@ bool ScalarFieldTools::computeKmeans(	const GenericCloud* theCloud,
 		return false;
 	}
 
-	unsigned n = theCloud->size();
+	PointIndexType n = theCloud->size();
 	if (n == 0)
 		return false;
 
@@ -630,7 +630,7 @@ bool ScalarFieldTools::computeKmeans(	const GenericCloud* theCloud,
 		meansHaveMoved = false;
 		++iteration;
 		{
-			for (unsigned i=0; i<n; ++i)
+			for (PointIndexType i=0; i<n; ++i)
 			{
 				unsigned char minK = 0;
 
@@ -661,7 +661,7 @@ bool ScalarFieldTools::computeKmeans(	const GenericCloud* theCloud,
 		std::fill(theKSums.begin(), theKSums.end(), static_cast<ScalarType>(0));
 		std::fill(theKNums.begin(), theKNums.end(), static_cast<unsigned>(0));
 		{
-			for (unsigned i = 0; i < n; ++i)
+			for (PointIndexType i = 0; i < n; ++i)
 			{
 				if (minDistsToMean[i] >= 0) //must be a valid value!
 				{
@@ -62,7 +62,7 @@ double StatisticalTestingTools::computeAdaptativeChi2Dist(	const GenericDistribu
 															double* npis/*=0*/)
 {
     assert(distrib && cloud);
-	unsigned n = cloud->size();
+	PointIndexType n = cloud->size();
 
 	if (n==0 || !distrib->isValid())
 		return -1.0;
@@ -72,7 +72,7 @@ double StatisticalTestingTools::computeAdaptativeChi2Dist(	const GenericDistribu
 	unsigned numberOfValidValues = 0;
 	{
 		bool firstValidValue = true;
-		for (unsigned i = 0; i < n; ++i)
+		for (PointIndexType i = 0; i < n; ++i)
 		{
 			ScalarType V = cloud->getPointScalarValue(i);
 			if (ScalarField::ValidValue(V))
@@ -127,7 +127,7 @@ double StatisticalTestingTools::computeAdaptativeChi2Dist(	const GenericDistribu
 	unsigned histoAfter = 0;
 	if (dV > ZERO_TOLERANCE)
 	{
-		for (unsigned i = 0; i < n; ++i)
+		for (PointIndexType i = 0; i < n; ++i)
 		{
 			ScalarType V = cloud->getPointScalarValue(i);
 			if (ScalarField::ValidValue(V))
@@ -400,7 +400,7 @@ bool StatisticalTestingTools::computeLocalChi2DistAtLevel(	const DgmOctree::octr
 	ScalarType* histoMax				= reinterpret_cast<ScalarType*>(additionalParameters[5]);
 
 	//number of points in the current cell
-	unsigned n = cell.points->size();
+	PointIndexType n = cell.points->size();
 
 	DgmOctree::NearestNeighboursSearchStruct nNSS;
 	nNSS.level												= cell.level;
@@ -420,7 +420,7 @@ bool StatisticalTestingTools::computeLocalChi2DistAtLevel(	const DgmOctree::octr
 		}
 
 		DgmOctree::NeighboursSet::iterator it = nNSS.pointsInNeighbourhood.begin();
-		for (unsigned j=0;j<n;++j,++it)
+		for (PointIndexType j=0;j<n;++j,++it)
 		{
 			it->point = cell.points->getPointPersistentPtr(j);
 			it->pointIndex = cell.points->getPointGlobalIndex(j);
@@ -435,7 +435,7 @@ bool StatisticalTestingTools::computeLocalChi2DistAtLevel(	const DgmOctree::octr
 		return false;
 	}
 
-	for (unsigned i = 0; i < n; ++i)
+	for (PointIndexType i = 0; i < n; ++i)
 	{
 		cell.points->getPoint(i, nNSS.queryPoint);
 		ScalarType D = cell.points->getPointScalarValue(i);
@@ -97,7 +97,7 @@ TrueKdTree::BaseNode* TrueKdTree::split(ReferenceCloud* subset)
 {
 	assert(subset); //subset will always be taken care of by this method
 	
-	unsigned count = subset->size();
+	PointIndexType count = subset->size();
 
 	const PointCoordinateType* planeEquation = Neighbourhood(subset).getLSPlane();
 	if (!planeEquation)
@@ -145,7 +145,7 @@ TrueKdTree::BaseNode* TrueKdTree::split(ReferenceCloud* subset)
 
 	//find the median by sorting the points coordinates
 	assert(s_sortedCoordsForSplit.size() >= static_cast<std::size_t>(count));
-	for (unsigned i = 0; i < count; ++i)
+	for (PointIndexType i = 0; i < count; ++i)
 	{
 		const CCVector3* P = subset->getPoint(i);
 		s_sortedCoordsForSplit[i] = P->u[splitDim];
@@ -200,7 +200,7 @@ TrueKdTree::BaseNode* TrueKdTree::split(ReferenceCloud* subset)
 	}
 
 	//fill subsets
-	for (unsigned i = 0; i < count; ++i)
+	for (PointIndexType i = 0; i < count; ++i)
 	{
 		const CCVector3* P = subset->getPoint(i);
 		if (P->u[splitDim] < splitCoord)
@@ -272,7 +272,7 @@ bool TrueKdTree::build(	double maxError,
 	if (m_root)
 		return false;
 
-	unsigned count = m_associatedCloud->size();
+	PointIndexType count = m_associatedCloud->size();
 	if (count == 0) //no point, no node!
 	{
 		return false;
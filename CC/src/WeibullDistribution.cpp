@@ -400,8 +400,8 @@ double WeibullDistribution::computeChi2Dist(const GenericCloud* cloud, unsigned
 	memset(histo, 0, numberOfClasses * sizeof(int));
 
 	//compute the histogram
-	unsigned n = cloud->size();
-	for (unsigned i = 0; i < n; ++i)
+	PointIndexType n = cloud->size();
+	for (PointIndexType i = 0; i < n; ++i)
 	{
 		ScalarType V = cloud->getPointScalarValue(i);
 		if (ScalarField::ValidValue(V))
@@ -0,0 +1,270 @@
+#include "TestMeshDisplay.h"
+
+//qCC_db
+#include "ccGenericGLDisplay.h"
+#include "ccGLDrawContext.h"
+#include "ccMesh.h"
+#include "ccPointCloud.h"
+#include "ccScalarField.h"
+
+//Qt
+#include <QImage>
+#include <QOffscreenSurface>
+#include <QOpenGLContext>
+#include <QOpenGLFramebufferObject>
+#include <QOpenGLFunctions_2_1>
+
+//system
+#include <cmath>
+
+//! Offscreen 'display' (the mesh VBOs need an associated display)
+class OffscreenDisplay : public ccGenericGLDisplay
+{
+public:
+	QSize getScreenSize() const override { return QSize(); }
+	void redraw(bool, bool) override {}
+	void toBeRefreshed() override {}
+	void refresh(bool) override {}
+	void invalidateViewport() override {}
+	void deprecate3DLayer() override {}
+	QFont getTextDisplayFont() const override { return QFont(); }
+	QFont getLabelDisplayFont() const override { return QFont(); }
+	void displayText(QString, int, int, unsigned char, float, const unsigned char*, const QFont*) override {}
+	void display3DLabel(const QString&, const CCVector3&, const unsigned char*, const QFont&) override {}
+	void getGLCameraParameters(ccGLCameraParameters&) override {}
+	QPointF toCenteredGLCoordinates(int x, int y) const override { return QPointF(x, y); }
+	QPointF toCornerGLCoordinates(int x, int y) const override { return QPointF(x, y); }
+	const ccViewportParameters& getViewportParameters() const override { return m_viewport; }
+	void setupProjectiveViewport(const ccGLMatrixd&, float, float, bool, bool) override {}
+
+protected:
+	ccViewportParameters m_viewport;
+};
+
+static OffscreenDisplay s_display;
+
+//! Framebuffer size
+static const int FRAME_SIZE = 512;
+
+//! Creates a (wavy) grid mesh with n x n vertices, colors and a scalar field
+/** The vertices are the (hidden) child of the mesh.
+**/
+static ccMesh* GridMesh(unsigned n)
+{
+	ccPointCloud* vertices = new ccPointCloud("vertices");
+	if (!vertices->reserve(n * n) || !vertices->reserveTheRGBTable())
+	{
+		delete vertices;
+		return nullptr;
+	}
+
+	for (unsigned j = 0; j < n; ++j)
+	{
+		for (unsigned i = 0; i < n; ++i)
+		{
+			PointCoordinateType x = static_cast<PointCoordinateType>(i) / (n - 1);
+			PointCoordinateType y = static_cast<PointCoordinateType>(j) / (n - 1);
+			vertices->addPoint(CCVector3(x, y, static_cast<PointCoordinateType>(0.1 * std::sin(20 * x) * std::cos(15 * y))));
+			vertices->addRGBColor(static_cast<ColorCompType>(255 * x), static_cast<ColorCompType>(255 * y), 128);
+		}
+	}
+
+	int sfIdx = vertices->addScalarField("height");
+	if (sfIdx < 0)
+	{
+		delete vertices;
+		return nullptr;
+	}
+	CCLib::ScalarField* sf = vertices->getScalarField(sfIdx);
+	for (unsigned i = 0; i < vertices->size(); ++i)
+	{
+		sf->setValue(i, static_cast<ScalarType>(vertices->getPoint(i)->z));
+	}
+	sf->computeMinAndMax();
+	vertices->setCurrentDisplayedScalarField(sfIdx);
+	vertices->setVisible(false);
+
+	ccMesh* mesh = new ccMesh(vertices);
+	mesh->addChild(vertices);
+	if (!mesh->reserve(2 * (n - 1) * (n - 1)))
+	{
+		delete mesh;
+		return nullptr;
+	}
+	for (unsigned j = 0; j + 1 < n; ++j)
+	{
+		for (unsigned i = 0; i + 1 < n; ++i)
+		{
+			unsigned k = j * n + i;
+			mesh->addTriangle(k, k + 1, k + n);
+			mesh->addTriangle(k + 1, k + n + 1, k + n);
+		}
+	}
+	mesh->setDisplay_recursive(&s_display);
+
+	return mesh;
+}
+
+//! Renders a mesh in the (current) framebuffer
+static QImage Render(QOpenGLContext* context, QOpenGLFramebufferObject* fbo, ccMesh* mesh, bool useVBOs)
+{
+	QOpenGLFunctions_2_1* glFunc = context->versionFunctions<QOpenGLFunctions_2_1>();
+
+	fbo->bind();
+	glFunc->glViewport(0, 0, FRAME_SIZE, FRAME_SIZE);
+	glFunc->glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+	glFunc->glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+	glFunc->glEnable(GL_DEPTH_TEST);
+	glFunc->glMatrixMode(GL_PROJECTION);
+	glFunc->glLoadIdentity();
+	glFunc->glOrtho(-0.1, 1.1, -0.1, 1.1, -1.0, 1.0);
+	glFunc->glMatrixMode(GL_MODELVIEW);
+	glFunc->glLoadIdentity();
+
+	CC_DRAW_CONTEXT drawContext;
+	drawContext.drawingFlags = CC_DRAW_3D | CC_DRAW_FOREGROUND;
+	drawContext.qGLContext = context;
+	drawContext.display = &s_display;
+	drawContext.glW = FRAME_SIZE;
+	drawContext.glH = FRAME_SIZE;
+	drawContext.useVBOs = useVBOs;
+	mesh->draw(drawContext);
+
+	glFunc->glFinish();
+	fbo->release();
+
+	return fbo->toImage();
+}
+
+void TestMeshDisplay::initTestCase()
+{
+	QSurfaceFormat format;
+	format.setVersion(2, 1);
+	format.setProfile(QSurfaceFormat::CompatibilityProfile);
+	format.setDepthBufferSize(24);
+
+	m_surface = new QOffscreenSurface();
+	m_surface->setFormat(format);
+	m_surface->create();
+
+	m_context = new QOpenGLContext();
+	m_context->setFormat(format);
+	if (!m_context->create() || !m_context->makeCurrent(m_surface))
+	{
+		QSKIP("No OpenGL context available");
+	}
+
+	QOpenGLFunctions_2_1* glFunc = m_context->versionFunctions<QOpenGLFunctions_2_1>();
+	if (!glFunc || !glFunc->initializeOpenGLFunctions())
+	{
+		QSKIP("OpenGL 2.1 functions not available");
+	}
+
+	m_fbo = new QOpenGLFramebufferObject(FRAME_SIZE, FRAME_SIZE, QOpenGLFramebufferObject::Depth);
+	QVERIFY(m_fbo->isValid());
+}
+
+void TestMeshDisplay::cleanupTestCase()
+{
+	delete m_fbo;
+	m_fbo = nullptr;
+	if (m_context)
+	{
+		m_context->doneCurrent();
+	}
+	delete m_context;
+	m_context = nullptr;
+	delete m_surface;
+	m_surface = nullptr;
+}
+
+void TestMeshDisplay::sameImage_data() const
+{
+	QTest::addColumn<bool>("colors");
+	QTest::addColumn<bool>("sf");
+	QTest::addColumn<bool>("wired");
+
+	QTest::newRow("default color") << false << false << false;
+	QTest::newRow("colors") << true << false << false;
+	QTest::newRow("scalar field") << false << true << false;
+	QTest::newRow("wireframe") << true << false << true;
+}
+
+void TestMeshDisplay::sameImage()
+{
+	QFETCH(bool, colors);
+	QFETCH(bool, sf);
+	QFETCH(bool, wired);
+
+	QScopedPointer<ccMesh> mesh(GridMesh(200));
+	QVERIFY(mesh);
+	mesh->showColors(colors);
+	mesh->showSF(sf);
+	mesh->showWired(wired);
+
+	QImage legacyImage = Render(m_context, m_fbo, mesh.data(), false);
+	QImage vboImage = Render(m_context, m_fbo, mesh.data(), true);
+	QVERIFY(legacyImage == vboImage);
+
+	//second frame (the VBOs are already up to date)
+	vboImage = Render(m_context, m_fbo, mesh.data(), true);
+	QVERIFY(legacyImage == vboImage);
+
+	//changing the displayed colors must update the VBOs
+	mesh->showColors(!colors);
+	legacyImage = Render(m_context, m_fbo, mesh.data(), false);
+	vboImage = Render(m_context, m_fbo, mesh.data(), true);
+	QVERIFY(legacyImage == vboImage);
+}
+
+void TestMeshDisplay::trianglesUpdate()
+{
+	QScopedPointer<ccMesh> mesh(GridMesh(200));
+	QVERIFY(mesh);
+	mesh->showColors(true);
+
+	QImage before = Render(m_context, m_fbo, mesh.data(), true);
+
+	//degenerate one triangle out of two (through the non-const accessor)
+	for (unsigned i = 0; i < mesh->size(); i += 2)
+	{
+		CCLib::VerticesIndexes* tri = mesh->getTriangleVertIndexes(i);
+		tri->i2 = tri->i1;
+	}
+	mesh->trianglesHaveChanged();
+
+	QImage legacyImage = Render(m_context, m_fbo, mesh.data(), false);
+	QImage vboImage = Render(m_context, m_fbo, mesh.data(), true);
+	QVERIFY(legacyImage == vboImage);
+	QVERIFY(before != vboImage);
+}
+
+void TestMeshDisplay::benchmarkFrame_data() const
+{
+	QTest::addColumn<bool>("useVBOs");
+
+	QTest::newRow("legacy") << false;
+	QTest::newRow("VBOs") << true;
+}
+
+void TestMeshDisplay::benchmarkFrame()
+{
+	QFETCH(bool, useVBOs);
+
+	QScopedPointer<ccMesh> mesh(GridMesh(1000));
+	if (!mesh)
+	{
+		QSKIP("Not enough memory");
+	}
+	mesh->showColors(true);
+
+	//first frame (VBOs upload)
+	Render(m_context, m_fbo, mesh.data(), useVBOs);
+
+	QBENCHMARK
+	{
+		Render(m_context, m_fbo, mesh.data(), useVBOs);
+	}
+}
+
+QTEST_MAIN(TestMeshDisplay)
@@ -0,0 +1,46 @@
+#ifndef CC_TEST_MESH_DISPLAY_HEADER
+#define CC_TEST_MESH_DISPLAY_HEADER
+
+#include <QObject>
+#include <QtTest/QtTest>
+
+class QOffscreenSurface;
+class QOpenGLContext;
+class QOpenGLFramebufferObject;
+
+/*
+ * Mesh display tests (VBO-based vs. legacy display)
+ *
+ * The meshes are rendered in an offscreen framebuffer. On a headless machine, run
+ * with the 'offscreen' Qt platform and a software OpenGL implementation, e.g.:
+ *   QT_QPA_PLATFORM=offscreen LIBGL_ALWAYS_SOFTWARE=1 ./TestMeshDisplay
+ * (the test case is skipped if no OpenGL 2.1 context can be created)
+ */
+class TestMeshDisplay : public QObject
+{
+Q_OBJECT
+private slots:
+	void initTestCase();
+	void cleanupTestCase();
+
+	/* The VBO-based display must give the same image as the legacy display */
+	void sameImage_data() const;
+	void sameImage();
+
+	/* The index buffers must be updated after a call to ccMesh::trianglesHaveChanged */
+	void trianglesUpdate();
+
+	/*
+	 * Benchmark: frame time for a 1000 x 1000 vertices grid (~2M triangles)
+	 */
+	void benchmarkFrame_data() const;
+	void benchmarkFrame();
+
+private:
+	QOffscreenSurface* m_surface = nullptr;
+	QOpenGLContext* m_context = nullptr;
+	QOpenGLFramebufferObject* m_fbo = nullptr;
+};
+
+
+#endif //CC_TEST_MESH_DISPLAY_HEADER
@@ -0,0 +1,203 @@
+#include "TestPointCloudTransformation.h"
+
+//qCC_db
+#include "ccNormalVectors.h"
+#include "ccPointCloud.h"
+
+//system
+#include <limits>
+#include <random>
+#include <type_traits>
+
+//! Returns a rigid transformation (rotation around a tilted axis + translation)
+static ccGLMatrix TestTransformation()
+{
+	ccGLMatrix trans;
+	trans.initFromParameters(0.7f, CCVector3f(1, 2, 3), CCVector3f(12, -3, 5));
+	return trans;
+}
+
+//! Creates a random cloud (with a fixed seed) and optionally random normals
+static ccPointCloud* RandomCloud(unsigned count, bool withNormals, unsigned seed)
+{
+	ccPointCloud* cloud = new ccPointCloud("test");
+	if (!cloud->reserve(count) || (withNormals && !cloud->reserveTheNormsTable()))
+	{
+		delete cloud;
+		return nullptr;
+	}
+
+	std::mt19937 gen(seed);
+	std::uniform_real_distribution<PointCoordinateType> dist(-100, 100);
+	for (unsigned i = 0; i < count; ++i)
+	{
+		cloud->addPoint(CCVector3(dist(gen), dist(gen), dist(gen)));
+		if (withNormals)
+		{
+			CCVector3 N(dist(gen), dist(gen), dist(gen));
+			N.normalize();
+			cloud->addNorm(N);
+		}
+	}
+	return cloud;
+}
+
+//! Checks that the normals have been recoded as if they were rotated one by one
+static void CheckNormals(unsigned count)
+{
+	QScopedPointer<ccPointCloud> cloud(RandomCloud(count, true, 2));
+	QVERIFY(!cloud.isNull());
+
+	std::vector<CompressedNormType> expected(count);
+	ccGLMatrix trans = TestTransformation();
+	for (unsigned i = 0; i < count; ++i)
+	{
+		CCVector3 N = cloud->getPointNormal(i);
+		trans.applyRotation(N);
+		expected[i] = ccNormalVectors::GetNormIndex(N.u);
+	}
+
+	cloud->applyRigidTransformation(trans);
+
+	for (unsigned i = 0; i < count; ++i)
+	{
+		QCOMPARE(cloud->getPointNormalIndex(i), expected[i]);
+	}
+}
+
+void TestPointCloudTransformation::transformPoints() const
+{
+	//several chunks + a few points that can't be vectorized
+	static const unsigned PointCount = 300007;
+	QScopedPointer<ccPointCloud> cloud(RandomCloud(PointCount, false, 1));
+	QVERIFY(!cloud.isNull());
+
+	std::vector<CCVector3> expected(PointCount);
+	ccGLMatrix trans = TestTransformation();
+	for (unsigned i = 0; i < PointCount; ++i)
+	{
+		expected[i] = *cloud->getPoint(i);
+		trans.apply(expected[i]);
+	}
+
+	cloud->applyRigidTransformation(trans);
+
+	for (unsigned i = 0; i < PointCount; ++i)
+	{
+		const CCVector3& P = *cloud->getPoint(i);
+		QVERIFY((P - expected[i]).norm() <= 1.0e-4 * (1 + expected[i].norm()));
+	}
+}
+
+void TestPointCloudTransformation::transformNormalsDirectly() const
+{
+	CheckNormals(100000);
+}
+
+void TestPointCloudTransformation::transformNormalsWithTable() const
+{
+	CheckNormals(ccNormalVectors::GetNumberOfVectors() + 1);
+}
+
+void TestPointCloudTransformation::transformGrids() const
+{
+	QScopedPointer<ccPointCloud> cloud(RandomCloud(10, false, 3));
+	QVERIFY(!cloud.isNull());
+
+	ccPointCloud::Grid::Shared grid(new ccPointCloud::Grid);
+	grid->sensorPosition.setTranslation(CCVector3d(1, 2, 3));
+	QVERIFY(cloud->addGrid(grid));
+
+	ccGLMatrix trans = TestTransformation();
+	CCVector3d expected(1, 2, 3);
+	ccGLMatrixd(trans.data()).apply(expected);
+
+	cloud->applyRigidTransformation(trans);
+
+	QVERIFY((grid->sensorPosition.getTranslationAsVec3D() - expected).norm() < 1.0e-4);
+}
+
+void TestPointCloudTransformation::transformBeyond32Bits() const
+{
+	//the per-point containers and loops follow the index type
+	static_assert(std::is_same<decltype(std::declval<const NormsIndexesTableType&>().currentSize()), PointIndexType>::value, "Per-point arrays must be sized with PointIndexType");
+	static_assert(std::is_same<decltype(std::declval<const ccPointCloud&>().size()), PointIndexType>::value, "Clouds must be sized with PointIndexType");
+
+#ifndef CC_CORE_LIB_USES_64BIT_INDEXES
+	QSKIP("32 bits indexes");
+#else
+	const PointIndexType pointCount = static_cast<PointIndexType>(std::numeric_limits<unsigned>::max()) + 8;
+
+	unsigned long long maxPointCount = 10000000;
+	QByteArray maxPointCountStr = qgetenv("CC_BENCHMARK_MAX_POINTS");
+	if (!maxPointCountStr.isEmpty())
+	{
+		maxPointCount = maxPointCountStr.toULongLong();
+	}
+	if (pointCount > maxPointCount)
+	{
+		QSKIP("Cloud too big (see CC_BENCHMARK_MAX_POINTS)");
+	}
+
+	//we don't need random points here
+	ccPointCloud cloud("beyond32Bits");
+	if (!cloud.reserve(pointCount) || !cloud.resize(pointCount - 1))
+	{
+		QSKIP("Not enough memory");
+	}
+	//the points past 2^32 would be skipped by 32 bits loops
+	cloud.addPoint(CCVector3(1, 2, 3));
+	const PointIndexType lastIndex = pointCount - 1;
+	const PointIndexType wrappedIndex = lastIndex - (static_cast<PointIndexType>(1) << 32);
+
+	const CCVector3 T(10, 20, 30);
+	cloud.translate(T);
+	QVERIFY((*cloud.getPoint(lastIndex) - CCVector3(11, 22, 33)).norm() < 1.0e-4);
+	QVERIFY((*cloud.getPoint(wrappedIndex) - T).norm() < 1.0e-4);
+
+	ccGLMatrix trans = TestTransformation();
+	CCVector3 expected(11, 22, 33);
+	trans.apply(expected);
+	cloud.applyRigidTransformation(trans);
+	QVERIFY((*cloud.getPoint(lastIndex) - expected).norm() <= 1.0e-4 * (1 + expected.norm()));
+#endif
+}
+
+void TestPointCloudTransformation::benchmarkTransformation_data() const
+{
+	QTest::addColumn<unsigned>("pointCount");
+	QTest::newRow("10M") << 10000000u;
+	QTest::newRow("100M") << 100000000u;
+	QTest::newRow("1B") << 1000000000u;
+}
+
+void TestPointCloudTransformation::benchmarkTransformation() const
+{
+	QFETCH(unsigned, pointCount);
+
+	unsigned maxPointCount = 10000000;
+	QByteArray maxPointCountStr = qgetenv("CC_BENCHMARK_MAX_POINTS");
+	if (!maxPointCountStr.isEmpty())
+	{
+		maxPointCount = maxPointCountStr.toUInt();
+	}
+	if (pointCount > maxPointCount)
+	{
+		QSKIP("Cloud too big (see CC_BENCHMARK_MAX_POINTS)");
+	}
+
+	//we don't need random points here
+	ccPointCloud cloud("benchmark");
+	if (!cloud.resize(pointCount) || !cloud.resizeTheNormsTable())
+	{
+		QSKIP("Not enough memory");
+	}
+
+	ccGLMatrix trans = TestTransformation();
+	QBENCHMARK
+	{
+		cloud.applyRigidTransformation(trans);
+	}
+}
+
+QTEST_MAIN(TestPointCloudTransformation)
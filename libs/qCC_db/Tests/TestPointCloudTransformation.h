@@ -0,0 +1,36 @@
+#ifndef CC_TEST_POINT_CLOUD_TRANSFORMATION_HEADER
+#define CC_TEST_POINT_CLOUD_TRANSFORMATION_HEADER
+
+#include <QObject>
+#include <QtTest/QtTest>
+
+class TestPointCloudTransformation : public QObject
+{
+Q_OBJECT
+private slots:
+	/* The (vectorized and multi-threaded) transformation must give the same result as ccGLMatrix::apply */
+	void transformPoints() const;
+
+	/* Normals are recoded one by one for small clouds */
+	void transformNormalsDirectly() const;
+
+	/* Normals are recoded through a look-up table for big clouds */
+	void transformNormalsWithTable() const;
+
+	void transformGrids() const;
+
+	/* The per-point loops must handle more than 2^32 points with 64 bits indexes
+	 * (skipped unless CC_BENCHMARK_MAX_POINTS allows it - it requires ~50 GB of memory)
+	 */
+	void transformBeyond32Bits() const;
+
+	/*
+	 * Benchmark: 10M, 100M and 1B points
+	 * (clouds bigger than CC_BENCHMARK_MAX_POINTS - 10M by default - are skipped)
+	 */
+	void benchmarkTransformation_data() const;
+	void benchmarkTransformation() const;
+};
+
+
+#endif //CC_TEST_POINT_CLOUD_TRANSFORMATION_HEADER
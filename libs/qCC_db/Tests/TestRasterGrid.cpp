@@ -0,0 +1,233 @@
+#include "TestRasterGrid.h"
+
+//qCC_db
+#include "ccPointCloud.h"
+#include "ccRasterGrid.h"
+#include "ccScalarField.h"
+
+//system
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numeric>
+#include <random>
+
+//! Creates a random cloud (with a fixed seed) with a scalar field (and some NaN values)
+/** The heights are quantized so that several points of a cell share the same height.
+**/
+static ccPointCloud* RandomCloud(unsigned count, unsigned seed)
+{
+	ccPointCloud* cloud = new ccPointCloud("test");
+	if (!cloud->reserve(count))
+	{
+		delete cloud;
+		return nullptr;
+	}
+
+	std::mt19937 gen(seed);
+	std::uniform_real_distribution<PointCoordinateType> dist(-1, 101);
+	for (unsigned i = 0; i < count; ++i)
+	{
+		cloud->addPoint(CCVector3(dist(gen), dist(gen), std::floor(dist(gen)) / 10));
+	}
+
+	int sfIdx = cloud->addScalarField("values");
+	if (sfIdx < 0)
+	{
+		delete cloud;
+		return nullptr;
+	}
+	CCLib::ScalarField* sf = cloud->getScalarField(sfIdx);
+	for (unsigned i = 0; i < count; ++i)
+	{
+		sf->setValue(i, i % 13 == 0 ? std::numeric_limits<ScalarType>::quiet_NaN() : static_cast<ScalarType>(dist(gen)));
+	}
+	sf->computeMinAndMax();
+
+	return cloud;
+}
+
+//! Returns a percentile of a set of values (linear interpolation between the closest ranks)
+/** The 50th percentile is the median (average of the two middle values for an even count).
+**/
+static double Percentile(std::vector<double> values, double percentile)
+{
+	if (values.empty())
+	{
+		return std::numeric_limits<double>::quiet_NaN();
+	}
+	std::sort(values.begin(), values.end());
+	double rank = percentile / 100.0 * (values.size() - 1);
+	size_t lowerRank = static_cast<size_t>(rank);
+	if (lowerRank + 1 >= values.size())
+	{
+		return values.back();
+	}
+	return values[lowerRank] + (rank - lowerRank) * (values[lowerRank + 1] - values[lowerRank]);
+}
+
+static bool SameValue(double a, double b)
+{
+	return (std::isnan(a) && std::isnan(b)) || std::abs(a - b) <= 1.0e-6 * std::max(1.0, std::abs(b));
+}
+
+void TestRasterGrid::fillWith_data() const
+{
+	QTest::addColumn<int>("projection");
+	QTest::addColumn<int>("sfProjection");
+	QTest::addColumn<unsigned>("pointCount");
+	QTest::addColumn<double>("percentile");
+
+	QTest::newRow("minimum") << static_cast<int>(ccRasterGrid::PROJ_MINIMUM_VALUE) << static_cast<int>(ccRasterGrid::PROJ_MINIMUM_VALUE) << 200000u << 50.0;
+	QTest::newRow("average") << static_cast<int>(ccRasterGrid::PROJ_AVERAGE_VALUE) << static_cast<int>(ccRasterGrid::PROJ_AVERAGE_VALUE) << 200000u << 50.0;
+	QTest::newRow("maximum") << static_cast<int>(ccRasterGrid::PROJ_MAXIMUM_VALUE) << static_cast<int>(ccRasterGrid::PROJ_MAXIMUM_VALUE) << 200000u << 50.0;
+	QTest::newRow("median") << static_cast<int>(ccRasterGrid::PROJ_MEDIAN_VALUE) << static_cast<int>(ccRasterGrid::PROJ_MEDIAN_VALUE) << 200000u << 50.0;
+	QTest::newRow("percentile") << static_cast<int>(ccRasterGrid::PROJ_PERCENTILE_VALUE) << static_cast<int>(ccRasterGrid::PROJ_PERCENTILE_VALUE) << 200000u << 90.0;
+	QTest::newRow("median height, percentile SF") << static_cast<int>(ccRasterGrid::PROJ_MEDIAN_VALUE) << static_cast<int>(ccRasterGrid::PROJ_PERCENTILE_VALUE) << 200000u << 5.0;
+	QTest::newRow("maximum (several batches)") << static_cast<int>(ccRasterGrid::PROJ_MAXIMUM_VALUE) << static_cast<int>(ccRasterGrid::PROJ_AVERAGE_VALUE) << 17000000u << 50.0;
+	QTest::newRow("percentile (several batches and bands)") << static_cast<int>(ccRasterGrid::PROJ_PERCENTILE_VALUE) << static_cast<int>(ccRasterGrid::PROJ_MEDIAN_VALUE) << 17000000u << 75.0;
+}
+
+void TestRasterGrid::fillWith() const
+{
+	QFETCH(int, projection);
+	QFETCH(int, sfProjection);
+	QFETCH(unsigned, pointCount);
+	QFETCH(double, percentile);
+
+	QScopedPointer<ccPointCloud> cloud(RandomCloud(pointCount, 1));
+	if (cloud.isNull())
+	{
+		QSKIP("Not enough memory");
+	}
+	CCLib::ScalarField* sf = cloud->getScalarField(0);
+
+	ccRasterGrid grid;
+	const unsigned width = 97;
+	const unsigned height = 103;
+	QVERIFY(grid.init(width, height, 1.0, CCVector3d(0, 0, 0)));
+	QVERIFY(grid.fillWith(cloud.data(), 2, static_cast<ccRasterGrid::ProjectionType>(projection), false, static_cast<ccRasterGrid::ProjectionType>(sfProjection), nullptr, percentile));
+	QCOMPARE(grid.scalarFields.size(), static_cast<size_t>(1));
+
+	//sequential computation of the per-cell statistics
+	std::vector< std::vector<double> > heights(width * height);
+	std::vector< std::vector<double> > values(width * height);
+	std::vector<unsigned> lowestPoints(width * height, 0);
+	std::vector<unsigned> highestPoints(width * height, 0);
+	for (unsigned n = 0; n < cloud->size(); ++n)
+	{
+		const CCVector3* P = cloud->getPoint(n);
+		int i = static_cast<int>(P->x + 0.5);
+		int j = static_cast<int>(P->y + 0.5);
+		if (i < 0 || j < 0 || i >= static_cast<int>(width) || j >= static_cast<int>(height))
+		{
+			continue;
+		}
+		unsigned pos = j * width + i;
+		if (heights[pos].empty() || P->z < cloud->getPoint(lowestPoints[pos])->z)
+			lowestPoints[pos] = n;
+		if (heights[pos].empty() || P->z > cloud->getPoint(highestPoints[pos])->z)
+			highestPoints[pos] = n;
+		heights[pos].push_back(P->z);
+		if (ccScalarField::ValidValue(sf->getValue(n)))
+			values[pos].push_back(sf->getValue(n));
+	}
+
+	unsigned nonEmptyCellCount = 0;
+	for (unsigned j = 0; j < height; ++j)
+	{
+		for (unsigned i = 0; i < width; ++i)
+		{
+			const ccRasterCell& cell = grid.rows[j][i];
+			const unsigned pos = j * width + i;
+			const std::vector<double>& h = heights[pos];
+			QCOMPARE(cell.nbPoints, static_cast<unsigned>(h.size()));
+			if (h.empty())
+			{
+				QVERIFY(std::isnan(cell.h));
+				QVERIFY(std::isnan(grid.scalarFields[0][pos]));
+				continue;
+			}
+			++nonEmptyCellCount;
+
+			double sum = 0;
+			double sum2 = 0;
+			for (double z : h)
+			{
+				sum += z;
+				sum2 += z * z;
+			}
+			double avg = sum / h.size();
+			QVERIFY(SameValue(cell.minHeight, *std::min_element(h.begin(), h.end())));
+			QVERIFY(SameValue(cell.maxHeight, *std::max_element(h.begin(), h.end())));
+			QVERIFY(SameValue(cell.avgHeight, avg));
+			QVERIFY(std::abs(cell.stdDevHeight - std::sqrt(std::abs(sum2 / h.size() - avg * avg))) < 1.0e-3);
+
+			const std::vector<double>& v = values[pos];
+			double expectedSF = std::numeric_limits<double>::quiet_NaN();
+			switch (sfProjection)
+			{
+			case ccRasterGrid::PROJ_MINIMUM_VALUE:
+				if (!v.empty())
+					expectedSF = *std::min_element(v.begin(), v.end());
+				break;
+			case ccRasterGrid::PROJ_AVERAGE_VALUE:
+				//(the sum is divided by the total number of points)
+				if (!v.empty())
+					expectedSF = (h.size() > 1 ? std::accumulate(v.begin(), v.end(), 0.0) / h.size() : v.front());
+				break;
+			case ccRasterGrid::PROJ_MAXIMUM_VALUE:
+				if (!v.empty())
+					expectedSF = *std::max_element(v.begin(), v.end());
+				break;
+			case ccRasterGrid::PROJ_MEDIAN_VALUE:
+				expectedSF = Percentile(v, 50.0);
+				break;
+			case ccRasterGrid::PROJ_PERCENTILE_VALUE:
+				expectedSF = Percentile(v, percentile);
+				break;
+			}
+			QVERIFY(SameValue(grid.scalarFields[0][pos], expectedSF));
+
+			switch (projection)
+			{
+			case ccRasterGrid::PROJ_MINIMUM_VALUE:
+				QCOMPARE(cell.h, static_cast<double>(cell.minHeight));
+				QCOMPARE(cell.pointIndex, lowestPoints[pos]);
+				break;
+			case ccRasterGrid::PROJ_AVERAGE_VALUE:
+				QCOMPARE(cell.h, cell.avgHeight);
+				break;
+			case ccRasterGrid::PROJ_MAXIMUM_VALUE:
+				QCOMPARE(cell.h, static_cast<double>(cell.maxHeight));
+				QCOMPARE(cell.pointIndex, highestPoints[pos]);
+				break;
+			case ccRasterGrid::PROJ_MEDIAN_VALUE:
+				QVERIFY(SameValue(cell.h, Percentile(h, 50.0)));
+				break;
+			case ccRasterGrid::PROJ_PERCENTILE_VALUE:
+				QVERIFY(SameValue(cell.h, Percentile(h, percentile)));
+				break;
+			}
+		}
+	}
+	QCOMPARE(grid.nonEmptyCellCount, nonEmptyCellCount);
+}
+
+void TestRasterGrid::benchmarkFillWith() const
+{
+	QScopedPointer<ccPointCloud> cloud(RandomCloud(5000000, 2));
+	if (cloud.isNull())
+	{
+		QSKIP("Not enough memory");
+	}
+
+	QBENCHMARK
+	{
+		ccRasterGrid grid;
+		QVERIFY(grid.init(1000, 1000, 0.1, CCVector3d(0, 0, 0)));
+		QVERIFY(grid.fillWith(cloud.data(), 2, ccRasterGrid::PROJ_AVERAGE_VALUE, false, ccRasterGrid::PROJ_AVERAGE_VALUE));
+	}
+}
+
+QTEST_MAIN(TestRasterGrid)
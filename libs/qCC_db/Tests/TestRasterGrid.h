@@ -0,0 +1,23 @@
+#ifndef CC_TEST_RASTER_GRID_HEADER
+#define CC_TEST_RASTER_GRID_HEADER
+
+#include <QObject>
+#include <QtTest/QtTest>
+
+class TestRasterGrid : public QObject
+{
+Q_OBJECT
+private slots:
+	/* The (parallel) grid filling must give the same per-cell statistics as a sequential process
+	 * (including the median and percentile values, computed by bands of rows) */
+	void fillWith_data() const;
+	void fillWith() const;
+
+	/*
+	 * Benchmark: 5M points in a 1000 x 1000 grid
+	 */
+	void benchmarkFillWith() const;
+};
+
+
+#endif //CC_TEST_RASTER_GRID_HEADER
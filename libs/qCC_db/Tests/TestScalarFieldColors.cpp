@@ -0,0 +1,268 @@
+#include "TestScalarFieldColors.h"
+
+//qCC_db
+#include "ccScalarField.h"
+
+//system
+#include <limits>
+#include <random>
+
+//! Scalar field 'holder' (the scalar fields can't be deleted directly)
+class ScalarFieldHolder
+{
+public:
+	explicit ScalarFieldHolder(ccScalarField* sf) : m_sf(sf) { m_sf->link(); }
+	~ScalarFieldHolder() { m_sf->release(); }
+	ccScalarField* operator->() const { return m_sf; }
+	ccScalarField* get() const { return m_sf; }
+
+protected:
+	ccScalarField* m_sf;
+};
+
+//! Creates a random scalar field (with a fixed seed) with some NaN values
+static ccScalarField* RandomScalarField(unsigned count, unsigned seed)
+{
+	ccScalarField* sf = new ccScalarField("test");
+	if (!sf->reserveSafe(count))
+	{
+		sf->release();
+		return nullptr;
+	}
+
+	std::mt19937 gen(seed);
+	std::uniform_real_distribution<ScalarType> dist(-100, 100);
+	for (unsigned i = 0; i < count; ++i)
+	{
+		sf->addElement(i % 97 == 0 ? std::numeric_limits<ScalarType>::quiet_NaN() : dist(gen));
+	}
+	sf->computeMinAndMax();
+
+	return sf;
+}
+
+//! Returns the color of a value as given by ccScalarField::getColor
+static ccColor::Rgb ReferenceColor(const ccScalarField* sf, ScalarType value)
+{
+	const ccColor::Rgb* col = sf->getColor(value);
+	return col ? *col : ccColor::lightGrey;
+}
+
+static bool SameColor(const ccColor::Rgb& a, const ccColor::Rgb& b)
+{
+	return a.r == b.r && a.g == b.g && a.b == b.b;
+}
+
+void TestScalarFieldColors::convertToColors_data() const
+{
+	QTest::addColumn<bool>("symmetrical");
+	QTest::addColumn<bool>("logScale");
+	QTest::addColumn<bool>("nanInGrey");
+	QTest::addColumn<unsigned>("steps");
+
+	QTest::newRow("linear") << false << false << true << 256u;
+	QTest::newRow("linear (hidden values)") << false << false << false << 256u;
+	QTest::newRow("linear (few steps)") << false << false << true << 7u;
+	QTest::newRow("linear (max steps)") << false << false << true << 1024u;
+	QTest::newRow("symmetrical") << true << false << true << 256u;
+	QTest::newRow("log") << false << true << true << 256u;
+}
+
+void TestScalarFieldColors::convertToColors() const
+{
+	QFETCH(bool, symmetrical);
+	QFETCH(bool, logScale);
+	QFETCH(bool, nanInGrey);
+	QFETCH(unsigned, steps);
+
+	ccScalarField* rawSF = RandomScalarField(100000, 1);
+	QVERIFY(rawSF);
+	ScalarFieldHolder sf(rawSF);
+
+	sf->setSymmetricalScale(symmetrical);
+	sf->setLogScale(logScale);
+	sf->showNaNValuesInGrey(nanInGrey);
+	sf->setColorRampSteps(steps);
+	sf->setMinDisplayed(-80);
+	sf->setMaxDisplayed(90);
+	if (!logScale)
+	{
+		//values on the saturation boundaries are part of the test set
+		sf->setSaturationStart(symmetrical ? 10 : -50);
+		sf->setSaturationStop(symmetrical ? 60 : 70);
+		sf->setValue(1, symmetrical ? 10 : -50);
+		sf->setValue(2, symmetrical ? 60 : 70);
+		sf->setValue(3, -80);
+		sf->setValue(4, 90);
+	}
+
+	std::vector<ccColor::Rgb> colors(sf->size());
+	QCOMPARE(sf->convertToColors(sf->data(), sf->size(), colors.data()), static_cast<size_t>(sf->size()));
+
+	for (unsigned i = 0; i < sf->size(); ++i)
+	{
+		QVERIFY(SameColor(colors[i], ReferenceColor(sf.get(), sf->getValue(i))));
+	}
+}
+
+void TestScalarFieldColors::convertToColorsWithStep() const
+{
+	ccScalarField* rawSF = RandomScalarField(10001, 2);
+	QVERIFY(rawSF);
+	ScalarFieldHolder sf(rawSF);
+
+	const unsigned step = 7;
+	std::vector<ccColor::Rgb> colors(sf->size());
+	size_t count = sf->convertToColors(sf->data(), sf->size(), colors.data(), step);
+	QCOMPARE(count, static_cast<size_t>((sf->size() + step - 1) / step));
+
+	for (size_t i = 0; i < count; ++i)
+	{
+		QVERIFY(SameColor(colors[i], ReferenceColor(sf.get(), sf->getValue(i * step))));
+	}
+}
+
+void TestScalarFieldColors::haveSameColors() const
+{
+	ccScalarField* rawSF = RandomScalarField(1000, 3);
+	QVERIFY(rawSF);
+	ScalarFieldHolder sf(rawSF);
+
+	std::mt19937 gen(4);
+	std::uniform_real_distribution<ScalarType> dist(-100, 100);
+	unsigned sameCount = 0;
+
+	for (unsigned t = 0; t < 200; ++t)
+	{
+		ccScalarField::ColorMapping before = sf->getColorMapping();
+		//reference colors of a regular sampling of [-100 ; 100]
+		std::vector<ccColor::Rgb> referenceColors;
+		for (int v = -1000; v <= 1000; ++v)
+		{
+			referenceColors.push_back(ReferenceColor(sf.get(), static_cast<ScalarType>(v) / 10));
+		}
+
+		//modify the saturation or the displayed range
+		ScalarType a = dist(gen);
+		ScalarType b = dist(gen);
+		if (a > b)
+			std::swap(a, b);
+		switch (t % 3)
+		{
+		case 0:
+			sf->setSaturationStart(a);
+			sf->setSaturationStop(b);
+			break;
+		case 1:
+			sf->setMinDisplayed(a);
+			sf->setMaxDisplayed(b);
+			break;
+		default:
+			sf->setSaturationStart(a);
+			break;
+		}
+
+		//test random intervals
+		for (unsigned k = 0; k < 50; ++k)
+		{
+			int minVal = static_cast<int>(dist(gen) * 10);
+			int maxVal = static_cast<int>(dist(gen) * 10);
+			if (minVal > maxVal)
+				std::swap(minVal, maxVal);
+
+			if (sf->haveSameColors(before, static_cast<ScalarType>(minVal) / 10, static_cast<ScalarType>(maxVal) / 10))
+			{
+				++sameCount;
+				for (int v = minVal; v <= maxVal; ++v)
+				{
+					QVERIFY(SameColor(referenceColors[v + 1000], ReferenceColor(sf.get(), static_cast<ScalarType>(v) / 10)));
+				}
+			}
+		}
+	}
+
+	//the test would be pointless otherwise
+	QVERIFY(sameCount != 0);
+
+	//a change of scale affects all the colors
+	ccScalarField::ColorMapping before = sf->getColorMapping();
+	sf->setColorRampSteps(sf->getColorRampSteps() / 2);
+	QVERIFY(!sf->haveSameColors(before, 0, 0));
+}
+
+void TestScalarFieldColors::valuesModificationStamps() const
+{
+	ccScalarField::ModificationStamp previousStamp = 0;
+	for (unsigned i = 0; i < 100; ++i)
+	{
+		//the memory of the previous scalar field is likely to be reused
+		ScalarFieldHolder sf(RandomScalarField(10, i));
+		QVERIFY(sf.get());
+
+		ccScalarField::ModificationStamp stamp = sf->getValuesModificationStamp();
+		QVERIFY(stamp > previousStamp);
+
+		//each update of the values gives a new stamp
+		sf->computeMinAndMax();
+		QVERIFY(sf->getValuesModificationStamp() > stamp);
+
+		previousStamp = sf->getValuesModificationStamp();
+	}
+}
+
+void TestScalarFieldColors::modificationStamps() const
+{
+	ccScalarField::ModificationStamp previousStamp = 0;
+	for (unsigned i = 0; i < 100; ++i)
+	{
+		//the memory of the previous scalar field is likely to be reused
+		ScalarFieldHolder sf(RandomScalarField(10, i));
+		QVERIFY(sf.get());
+
+		ccScalarField::ModificationStamp stamp = sf->getModificationStamp();
+		QVERIFY(stamp > previousStamp);
+
+		//each change of the display parameters gives a new stamp
+		sf->setColorRampSteps(sf->getColorRampSteps() / 2);
+		QVERIFY(sf->getModificationStamp() > stamp);
+
+		previousStamp = sf->getModificationStamp();
+	}
+}
+
+void TestScalarFieldColors::benchmarkConversion_data() const
+{
+	QTest::addColumn<bool>("lookupTable");
+	QTest::newRow("getColor") << false;
+	QTest::newRow("convertToColors") << true;
+}
+
+void TestScalarFieldColors::benchmarkConversion() const
+{
+	QFETCH(bool, lookupTable);
+
+	ccScalarField* rawSF = RandomScalarField(10000000, 5);
+	if (!rawSF)
+	{
+		QSKIP("Not enough memory");
+	}
+	ScalarFieldHolder sf(rawSF);
+	std::vector<ccColor::Rgb> colors(sf->size());
+
+	QBENCHMARK
+	{
+		if (lookupTable)
+		{
+			sf->convertToColors(sf->data(), sf->size(), colors.data());
+		}
+		else
+		{
+			for (unsigned i = 0; i < sf->size(); ++i)
+			{
+				colors[i] = ReferenceColor(sf.get(), sf->getValue(i));
+			}
+		}
+	}
+}
+
+QTEST_MAIN(TestScalarFieldColors)
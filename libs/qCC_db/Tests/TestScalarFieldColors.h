@@ -0,0 +1,33 @@
+#ifndef CC_TEST_SCALAR_FIELD_COLORS_HEADER
+#define CC_TEST_SCALAR_FIELD_COLORS_HEADER
+
+#include <QObject>
+#include <QtTest/QtTest>
+
+class TestScalarFieldColors : public QObject
+{
+Q_OBJECT
+private slots:
+	/* The (lookup table based) conversion must give the same colors as ccScalarField::getColor */
+	void convertToColors_data() const;
+	void convertToColors() const;
+
+	void convertToColorsWithStep() const;
+
+	/* When haveSameColors returns true, the values of the interval must keep the same colors */
+	void haveSameColors() const;
+
+	/* A (new) scalar field never gets the stamp of another one, even at the same address */
+	void valuesModificationStamps() const;
+
+	void modificationStamps() const;
+
+	/*
+	 * Benchmark: 10M values (both methods)
+	 */
+	void benchmarkConversion_data() const;
+	void benchmarkConversion() const;
+};
+
+
+#endif //CC_TEST_SCALAR_FIELD_COLORS_HEADER
@@ -127,7 +127,7 @@ public:
 	inline void setValue(size_t index, const Type& value) { this->at(index) = value; }
 	inline void addElement(const Type& value) { this->emplace_back(value); }
 	inline void fill(const Type& value) { if (this->empty()) this->resize(this->capacity(), value); else std::fill(this->begin(), this->end(), value); }
-	inline unsigned currentSize() const { return static_cast<unsigned>(this->size()); }
+	inline PointIndexType currentSize() const { return static_cast<PointIndexType>(this->size()); }
 	inline void clear(bool releaseMemory = false) { if (releaseMemory) this->resize(0); else this->std::vector<Type>::clear(); }
 	inline void swap(size_t i1, size_t i2) { std::swap(this->at(i1), this->at(i2)); }
 
@@ -50,6 +50,7 @@ ccColorScale::ccColorScale(const QString& name, const QString& uuid/*=QString()*
 	: m_name(name)
 	, m_uuid(uuid)
 	, m_updated(false)
+	, m_updateCount(0)
 	, m_relative(true)
 	, m_locked(false)
 	, m_absoluteMinValue(0.0)
@@ -118,6 +119,7 @@ void ccColorScale::sort()
 void ccColorScale::update()
 {
 	m_updated = false;
+	++m_updateCount;
 
 	if (m_steps.size() >= static_cast<int>(MIN_STEPS))
 	{
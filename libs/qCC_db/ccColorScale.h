@@ -195,6 +195,11 @@ public:
 	**/
 	void update();
 
+	//! Returns the number of updates of the internal representation so far
+	/** Can be used to know whether a copy of the scale colors is up to date.
+	**/
+	inline unsigned getUpdateCount() const { return m_updateCount; }
+
 	//! Returns relative position of a given value (wrt to scale absolute min and max)
 	/** Warning: only valid with absolute scales! Use 'getColorByRelativePos' otherwise.
 	**/
@@ -292,6 +297,9 @@ protected:
 	//! Internal representation validity
 	bool m_updated;
 
+	//! Number of updates of the internal representation
+	unsigned m_updateCount;
+
 	//! Whether scale is relative or not
 	bool m_relative;
 
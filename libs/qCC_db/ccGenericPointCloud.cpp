@@ -16,7 +16,8 @@
 //##########################################################################
 
 #ifdef USE_TBB
-#include <tbb/parallel_for.h>
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_reduce.h>
 #endif
 
 #include "ccGenericPointCloud.h"
@@ -298,7 +299,6 @@ bool ccGenericPointCloud::pointPicking(	const CCVector2d& clickPos,
 										bool autoComputeOctree/*=false*/)
 {
 	//can we use the octree to accelerate the point picking process?
-	if (pickWidth == pickHeight)
 	{
 		ccOctree::Shared octree = getOctree();
 		if (!octree && autoComputeOctree)
@@ -330,7 +330,7 @@ bool ccGenericPointCloud::pointPicking(	const CCVector2d& clickPos,
 			}
 #endif
 			ccOctree::PointDescriptor point;
-			if (octree->pointPicking(clickPos, camera, point, pickWidth))
+			if (octree->pointPicking(clickPos, camera, point, pickWidth, pickHeight))
 			{
 #ifdef QT_DEBUG
 				if (sf)
@@ -394,46 +394,66 @@ bool ccGenericPointCloud::pointPicking(	const CCVector2d& clickPos,
 			}
 		}
 
-#ifdef USE_TBB
-		tbb::parallel_for( 0, static_cast<int>(size()), [&](int i)
-#else
-		for (int i = 0; i < static_cast<int>(size()); ++i)
-#endif
+		//nearest point (index, square distance)
+		typedef std::pair<int, double> NearestPoint;
+
+		//tests a range of points
+		auto pickInRange = [&](int first, int last, NearestPoint nearest) -> NearestPoint
 		{
-			//we shouldn't test points that are actually hidden!
-			if (	(!visTable || visTable->at(i) == POINT_VISIBLE)
-				&&	(!activeSF || activeSF->getColor(activeSF->getValue(i)))
-				)
+			for (int i = first; i < last; ++i)
 			{
-				const CCVector3* P = getPoint(i);
-
-				CCVector3d Q2D;
-				if (noGLTrans)
+				//we shouldn't test points that are actually hidden!
+				if (	(visTable && visTable->at(i) != POINT_VISIBLE)
+					||	(activeSF && !activeSF->getColor(activeSF->getValue(i)))
+					)
 				{
-					camera.project(*P, Q2D);
+					continue;
 				}
-				else
+
+				CCVector3 P = *getPoint(i);
+				if (!noGLTrans)
 				{
-					CCVector3 P3D = *P;
-					trans.apply(P3D);
-					camera.project(P3D, Q2D);
+					trans.apply(P);
 				}
 
+				CCVector3d Q2D;
+				camera.project(P, Q2D);
+
 				if (	fabs(Q2D.x - clickPos.x) <= pickWidth
 					&&	fabs(Q2D.y - clickPos.y) <= pickHeight)
 				{
-					const double squareDist = CCVector3d(X.x - P->x, X.y - P->y, X.z - P->z).norm2d();
-					if (nearestPointIndex < 0 || squareDist < nearestSquareDist)
+					const double squareDist = CCVector3d(X.x - P.x, X.y - P.y, X.z - P.z).norm2d();
+					if (nearest.first < 0 || squareDist < nearest.second)
 					{
-						nearestSquareDist = squareDist;
-						nearestPointIndex = i;
+						nearest = NearestPoint(i, squareDist);
 					}
 				}
 			}
-		}
+			return nearest;
+		};
+
 #ifdef USE_TBB
-		);
+		//each task keeps its own nearest point (they are merged afterwards)
+		NearestPoint nearest = tbb::parallel_reduce(	tbb::blocked_range<int>(0, static_cast<int>(size())),
+														NearestPoint(-1, -1.0),
+														[&](const tbb::blocked_range<int>& range, NearestPoint current)
+														{
+															return pickInRange(range.begin(), range.end(), current);
+														},
+														[](const NearestPoint& a, const NearestPoint& b)
+														{
+															if (a.first < 0)
+																return b;
+															if (b.first < 0 || a.second < b.second || (a.second == b.second && a.first < b.first))
+																return a;
+															return b;
+														});
+#else
+		NearestPoint nearest = pickInRange(0, static_cast<int>(size()), NearestPoint(-1, -1.0));
 #endif
+
+		nearestPointIndex = nearest.first;
+		nearestSquareDist = nearest.second;
 	}
 	
 	return (nearestPointIndex >= 0);
@@ -134,28 +134,28 @@ public:
 		It may even be 0 if the value shouldn't be displayed.
 		WARNING: scalar field must be enabled! (see ccDrawableObject::hasDisplayedScalarField)
 	**/
-	virtual const ccColor::Rgb* getPointScalarValueColor(unsigned pointIndex) const = 0;
+	virtual const ccColor::Rgb* getPointScalarValueColor(PointIndexType pointIndex) const = 0;
 
 	//! Returns scalar value associated to a given point
 	/** The returned value is taken from the current displayed scalar field
 		WARNING: scalar field must be enabled! (see ccDrawableObject::hasDisplayedScalarField)
 	**/
-	virtual ScalarType getPointDisplayedDistance(unsigned pointIndex) const = 0;
+	virtual ScalarType getPointDisplayedDistance(PointIndexType pointIndex) const = 0;
 
 	//! Returns color corresponding to a given point
 	/** WARNING: color array must be enabled! (see ccDrawableObject::hasColors)
 	**/
-	virtual const ccColor::Rgb& getPointColor(unsigned pointIndex) const = 0;
+	virtual const ccColor::Rgb& getPointColor(PointIndexType pointIndex) const = 0;
 
 	//! Returns compressed normal corresponding to a given point
 	/** WARNING: normals array must be enabled! (see ccDrawableObject::hasNormals)
 	**/
-	virtual const CompressedNormType& getPointNormalIndex(unsigned pointIndex) const = 0;
+	virtual const CompressedNormType& getPointNormalIndex(PointIndexType pointIndex) const = 0;
 
 	//! Returns normal corresponding to a given point
 	/** WARNING: normals array must be enabled! (see ccDrawableObject::hasNormals)
 	**/
-	virtual const CCVector3& getPointNormal(unsigned pointIndex) const = 0;
+	virtual const CCVector3& getPointNormal(PointIndexType pointIndex) const = 0;
 
 
 	/***************************************************
@@ -254,7 +254,7 @@ public:
 	void importParametersFrom(const ccGenericPointCloud* cloud);
 
 	//! Point picking (brute force or octree-driven)
-	/** \warning the octree-driven method only works if pickWidth == pickHeight
+	/** The octree-driven method is used if the octree is available (see ccOctree::pointPicking).
 	**/
 	bool pointPicking(	const CCVector2d& clickPos,
 						const ccGLCameraParameters& camera,
@@ -40,11 +40,16 @@
 #include <ReferenceCloud.h>
 #include <Neighbourhood.h>
 #include <Delaunay2dMesh.h>
+#include <PointsSpan.h>
+
+//Qt
+#include <QGLBuffer>
 
 //System
 #include <string.h>
 #include <assert.h>
 #include <cmath> //for std::modf
+#include <limits>
 
 static CCVector3 s_blankNorm(0, 0, 0);
 
@@ -107,6 +112,7 @@ ccMesh::ccMesh(CCLib::GenericIndexedMesh* giMesh, ccGenericPointCloud* giVertice
 
 ccMesh::~ccMesh()
 {
+	releaseVBOs();
 	clearTriNormals();
 	setMaterialSet(nullptr);
 	setTexCoordinatesTable(nullptr);
@@ -1570,6 +1576,7 @@ const ccGLMatrix& ccMesh::getGLTransformationHistory() const
 void ccMesh::addTriangle(unsigned i1, unsigned i2, unsigned i3)
 {
 	m_triVertIndexes->emplace_back(CCLib::VerticesIndexes(i1, i2, i3));
+	trianglesHaveChanged();
 }
 
 bool ccMesh::reserve(size_t n)
@@ -1623,6 +1630,7 @@ void ccMesh::swapTriangles(unsigned index1, unsigned index2)
 	assert(std::max(index1, index2) < size());
 
 	m_triVertIndexes->swap(index1, index2);
+	trianglesHaveChanged();
 	if (m_triMtlIndexes)
 		m_triMtlIndexes->swap(index1, index2);
 	if (m_texCoordIndexes)
@@ -1663,6 +1671,397 @@ unsigned ccMesh::getUniqueIDForDisplay() const
 	}
 }
 
+void ccMesh::notifyGeometryUpdate()
+{
+	ccGenericMesh::notifyGeometryUpdate();
+
+	releaseVBOs();
+}
+
+void ccMesh::removeFromDisplay(const ccGenericGLDisplay* win)
+{
+	if (win == m_currentDisplay)
+	{
+		releaseVBOs();
+	}
+
+	//call parent's method
+	ccGenericMesh::removeFromDisplay(win);
+}
+
+//! Creates (if necessary) and allocates a GL buffer
+/** The buffer is left bound to the active context in case of success.
+	\param buffer buffer (created if null)
+	\param type buffer type
+	\param sizeBytes buffer size (in bytes)
+	\param reallocated set to true if the buffer has been (re)allocated (i.e. its content has been lost)
+	\return success
+**/
+static bool InitGLBuffer(QGLBuffer*& buffer, QGLBuffer::Type type, int sizeBytes, bool& reallocated)
+{
+	if (!buffer)
+	{
+		buffer = new QGLBuffer(type);
+	}
+
+	if (!buffer->isCreated())
+	{
+		if (!buffer->create())
+		{
+			//no message as it will probably happen on a lot on (old) graphic cards
+			return false;
+		}
+
+		buffer->setUsagePattern(QGLBuffer::DynamicDraw);
+	}
+
+	if (!buffer->bind())
+	{
+		ccLog::Warning("[ccMesh::updateVBOs] Failed to bind VBO to active context!");
+		return false;
+	}
+
+	if (buffer->size() != sizeBytes)
+	{
+		buffer->allocate(sizeBytes);
+		reallocated = true;
+
+		if (buffer->size() != sizeBytes)
+		{
+			ccLog::Warning("[ccMesh::updateVBOs] Not enough (GPU) memory!");
+			buffer->release();
+			return false;
+		}
+	}
+
+	return true;
+}
+
+bool ccMesh::updateVBOs(const CC_DRAW_CONTEXT& context, const glDrawParams& glParams)
+{
+	if (m_vboManager.state == vboSet::FAILED)
+	{
+		return false;
+	}
+
+	if (!m_currentDisplay)
+	{
+		ccLog::Warning(QString("[ccMesh::updateVBOs] Need an associated GL context! (mesh '%1')").arg(getName()));
+		assert(false);
+		return false;
+	}
+
+	//the vertices must be stored in a (real) point cloud
+	if (!m_associatedCloud || !m_associatedCloud->isA(CC_TYPES::POINT_CLOUD))
+	{
+		return false;
+	}
+	ccPointCloud* cloud = static_cast<ccPointCloud*>(m_associatedCloud);
+	const ccPointCloud::DisplayDataVersion& cloudVersion = cloud->displayDataVersion();
+
+	const unsigned vertCount = cloud->size();
+	if (vertCount == 0)
+	{
+		return false;
+	}
+
+	//the triangles are sent 'as is' to the GPU
+	static_assert(sizeof(CCLib::VerticesIndexes) == 3 * sizeof(GLuint), "Vertices indexes can't be used as an index buffer");
+
+	bool withColors = (glParams.showSF || glParams.showColors);
+	bool withNormals = glParams.showNorms;
+	ccScalarField* sf = (glParams.showSF ? cloud->getCurrentDisplayedScalarField() : nullptr);
+	if (	(glParams.showSF && !sf)
+		||	(glParams.showColors && !cloud->rgbColors())
+		||	(glParams.showNorms && !cloud->normals()) )
+	{
+		assert(false);
+		return false;
+	}
+
+	const size_t chunkCount = ccChunk::Count(m_triVertIndexes->size());
+
+	if (m_vboManager.state == vboSet::INITIALIZED)
+	{
+		//let's check if something has changed
+		if (m_vboManager.pointsVersion != cloudVersion.points)
+		{
+			m_vboManager.updateFlags |= vboSet::UPDATE_VERTICES;
+		}
+
+		if (	withColors
+			&&	(		!m_vboManager.hasColors
+					||	m_vboManager.colorIsSF != glParams.showSF
+					||	(glParams.showSF && (m_vboManager.sourceSF != sf || m_vboManager.sourceSFModificationStamp != sf->getModificationStamp()))
+					||	(glParams.showColors && m_vboManager.colorsVersion != cloudVersion.colors) ) )
+		{
+			m_vboManager.updateFlags |= vboSet::UPDATE_COLORS;
+		}
+
+		if (withNormals && (!m_vboManager.hasNormals || m_vboManager.normalsVersion != cloudVersion.normals))
+		{
+			m_vboManager.updateFlags |= vboSet::UPDATE_NORMALS;
+		}
+
+		if (m_vboManager.triangles.size() != chunkCount)
+		{
+			m_vboManager.updateFlags |= vboSet::UPDATE_TRIANGLES;
+		}
+
+		//nothing to do?
+		if (m_vboManager.updateFlags == 0)
+		{
+			return true;
+		}
+	}
+	else
+	{
+		m_vboManager.updateFlags = vboSet::UPDATE_ALL;
+	}
+
+	//vertices buffer layout: coordinates, then colors and normals (if any)
+	//(we keep the current layout if possible, so as to avoid reallocating
+	//the buffer each time the display mode changes, e.g. in picking mode)
+	bool hasColors = withColors;
+	bool hasNormals = withNormals;
+	if (	m_vboManager.vertices
+		&&	m_vboManager.vertexCount == vertCount
+		&&	(!withColors || m_vboManager.hasColors)
+		&&	(!withNormals || m_vboManager.hasNormals) )
+	{
+		hasColors = m_vboManager.hasColors;
+		hasNormals = m_vboManager.hasNormals;
+	}
+
+	qint64 totalSizeBytes = static_cast<qint64>(vertCount) * sizeof(CCVector3);
+	int rgbShift = 0;
+	int normalShift = 0;
+	if (hasColors)
+	{
+		rgbShift = static_cast<int>(totalSizeBytes);
+		totalSizeBytes += static_cast<qint64>(vertCount) * sizeof(ccColor::Rgb);
+	}
+	if (hasNormals)
+	{
+		normalShift = static_cast<int>(totalSizeBytes);
+		totalSizeBytes += static_cast<qint64>(vertCount) * sizeof(CCVector3);
+	}
+	if (totalSizeBytes > std::numeric_limits<int>::max())
+	{
+		ccLog::Warning(QString("[ccMesh::updateVBOs] Too many vertices to be loaded in a VBO (mesh '%1')").arg(getName()));
+		releaseVBOs();
+		m_vboManager.state = vboSet::FAILED;
+		return false;
+	}
+
+	if (	m_vboManager.vertexCount != vertCount
+		||	hasColors != m_vboManager.hasColors
+		||	hasNormals != m_vboManager.hasNormals )
+	{
+		//the whole vertices buffer has to be updated (with the displayed features only)
+		m_vboManager.updateFlags |= (vboSet::UPDATE_VERTICES | vboSet::UPDATE_COLORS | vboSet::UPDATE_NORMALS);
+	}
+
+	//allocate per-chunk triangles buffers if necessary
+	if (m_vboManager.triangles.size() != chunkCount)
+	{
+		//properly remove the elements that are not needed anymore!
+		for (size_t k = chunkCount; k < m_vboManager.triangles.size(); ++k)
+		{
+			if (m_vboManager.triangles[k])
+			{
+				m_vboManager.triangles[k]->destroy();
+				delete m_vboManager.triangles[k];
+				m_vboManager.triangles[k] = nullptr;
+			}
+		}
+
+		try
+		{
+			m_vboManager.triangles.resize(chunkCount, nullptr);
+		}
+		catch (const std::bad_alloc&)
+		{
+			ccLog::Warning(QString("[ccMesh::updateVBOs] Not enough memory! (mesh '%1')").arg(getName()));
+			releaseVBOs();
+			m_vboManager.state = vboSet::FAILED;
+			return false;
+		}
+	}
+
+	int totalSizeBytesBefore = m_vboManager.totalMemSizeBytes;
+	m_vboManager.totalMemSizeBytes = 0;
+	bool success = true;
+
+	//the context should be already active as this method should only be called from 'drawMeOnly'
+	QOpenGLFunctions_2_1* glFunc = context.glFunctions<QOpenGLFunctions_2_1>();
+	assert(glFunc != nullptr);
+
+	//vertices
+	{
+		bool reallocated = false;
+		success = InitGLBuffer(m_vboManager.vertices, QGLBuffer::VertexBuffer, static_cast<int>(totalSizeBytes), reallocated);
+		if (success)
+		{
+			if (reallocated)
+			{
+				//if the buffer is reallocated, then all its content has been cleared!
+				m_vboManager.updateFlags |= (vboSet::UPDATE_VERTICES | vboSet::UPDATE_COLORS | vboSet::UPDATE_NORMALS);
+			}
+
+			m_vboManager.vertexCount = vertCount;
+			m_vboManager.rgbShift = rgbShift;
+			m_vboManager.normalShift = normalShift;
+			m_vboManager.hasColors = hasColors;
+			m_vboManager.hasNormals = hasNormals;
+
+			const size_t vertChunkCount = ccChunk::Count(vertCount);
+
+			//load points
+			if (m_vboManager.updateFlags & vboSet::UPDATE_VERTICES)
+			{
+				//the cloud points are stored contiguously
+				CCLib::PointsSpan span;
+				if (cloud->getPointsSpan(span) && !span.indexes)
+				{
+					m_vboManager.vertices->write(0, span.points, static_cast<int>(vertCount * sizeof(CCVector3)));
+					m_vboManager.pointsVersion = cloudVersion.points;
+				}
+				else
+				{
+					assert(false);
+					success = false;
+				}
+			}
+
+			//load colors
+			if (success && withColors && (m_vboManager.updateFlags & vboSet::UPDATE_COLORS))
+			{
+				for (size_t i = 0; i < vertChunkCount; ++i)
+				{
+					const size_t chunkSize = ccChunk::Size(i, vertCount);
+					const int chunkShift = rgbShift + static_cast<int>(ccChunk::StartPos(i) * sizeof(ccColor::Rgb));
+					if (glParams.showSF)
+					{
+						//we need to convert the scalar values to colors into a temporary buffer
+						sf->convertToColors(ccChunk::Start(*sf, i), chunkSize, GetColorsBuffer());
+						m_vboManager.vertices->write(chunkShift, GetColorsBuffer(), static_cast<int>(chunkSize * sizeof(ccColor::Rgb)));
+					}
+					else
+					{
+						m_vboManager.vertices->write(chunkShift, ccChunk::Start(*cloud->rgbColors(), i), static_cast<int>(chunkSize * sizeof(ccColor::Rgb)));
+					}
+				}
+
+				m_vboManager.colorIsSF = glParams.showSF;
+				m_vboManager.sourceSF = sf;
+				m_vboManager.sourceSFModificationStamp = (sf ? sf->getModificationStamp() : 0);
+				m_vboManager.colorsVersion = cloudVersion.colors;
+			}
+
+			//load normals
+			if (success && withNormals && (m_vboManager.updateFlags & vboSet::UPDATE_NORMALS))
+			{
+				//we must decode the normals first!
+				const NormsIndexesTableType* normals = cloud->normals();
+				for (size_t i = 0; i < vertChunkCount; ++i)
+				{
+					const size_t chunkSize = ccChunk::Size(i, vertCount);
+					const CompressedNormType* _normIndexes = ccChunk::Start(*normals, i);
+					CCVector3* _normals = GetNormalsBuffer();
+					for (size_t j = 0; j < chunkSize; ++j)
+					{
+						*_normals++ = ccNormalVectors::GetNormal(*_normIndexes++);
+					}
+					m_vboManager.vertices->write(normalShift + static_cast<int>(ccChunk::StartPos(i) * sizeof(CCVector3)), GetNormalsBuffer(), static_cast<int>(chunkSize * sizeof(CCVector3)));
+				}
+
+				m_vboManager.normalsVersion = cloudVersion.normals;
+			}
+
+			m_vboManager.vertices->release();
+			m_vboManager.totalMemSizeBytes += static_cast<int>(totalSizeBytes);
+		}
+	}
+
+	//triangles
+	for (size_t k = 0; success && k < chunkCount; ++k)
+	{
+		const size_t chunkSize = ccChunk::Size(k, *m_triVertIndexes);
+		const int chunkSizeBytes = static_cast<int>(chunkSize * sizeof(CCLib::VerticesIndexes));
+
+		bool reallocated = false;
+		success = InitGLBuffer(m_vboManager.triangles[k], QGLBuffer::IndexBuffer, chunkSizeBytes, reallocated);
+		if (success)
+		{
+			if (reallocated || (m_vboManager.updateFlags & vboSet::UPDATE_TRIANGLES))
+			{
+				m_vboManager.triangles[k]->write(0, ccChunk::Start(*m_triVertIndexes, k), chunkSizeBytes);
+			}
+			m_vboManager.triangles[k]->release();
+			m_vboManager.totalMemSizeBytes += chunkSizeBytes;
+		}
+	}
+
+	//if an error is detected
+	if (success && glFunc->glGetError() != GL_NO_ERROR)
+	{
+		success = false;
+	}
+
+	if (!success)
+	{
+		ccLog::Warning(QString("[ccMesh::updateVBOs] Failed to initialize VBOs (not enough memory?) (mesh '%1')").arg(getName()));
+		releaseVBOs();
+		m_vboManager.state = vboSet::FAILED;
+		return false;
+	}
+
+#ifdef _DEBUG
+	if (m_vboManager.totalMemSizeBytes != totalSizeBytesBefore)
+		ccLog::Print(QString("[VBO] VBO(s) (re)initialized for mesh '%1' (%2 Mb)")
+			.arg(getName())
+			.arg(static_cast<double>(m_vboManager.totalMemSizeBytes) / (1 << 20), 0, 'f', 2));
+#else
+	Q_UNUSED(totalSizeBytesBefore);
+#endif
+
+	m_vboManager.state = vboSet::INITIALIZED;
+	m_vboManager.updateFlags = 0;
+
+	return true;
+}
+
+void ccMesh::releaseVBOs()
+{
+	//'destroy' all buffers (they may have been created even if the VBOs are not initialized yet)
+	if (m_vboManager.vertices)
+	{
+		m_vboManager.vertices->destroy();
+		delete m_vboManager.vertices;
+		m_vboManager.vertices = nullptr;
+	}
+	for (size_t k = 0; k < m_vboManager.triangles.size(); ++k)
+	{
+		if (m_vboManager.triangles[k])
+		{
+			m_vboManager.triangles[k]->destroy();
+			delete m_vboManager.triangles[k];
+			m_vboManager.triangles[k] = nullptr;
+		}
+	}
+
+	m_vboManager.triangles.resize(0);
+	m_vboManager.vertexCount = 0;
+	m_vboManager.hasColors = false;
+	m_vboManager.hasNormals = false;
+	m_vboManager.colorIsSF = false;
+	m_vboManager.sourceSF = nullptr;
+	m_vboManager.totalMemSizeBytes = 0;
+	m_vboManager.updateFlags = 0;
+	m_vboManager.state = vboSet::NEW;
+}
+
 void ccMesh::drawMeOnly(CC_DRAW_CONTEXT& context)
 {
 	if (!m_associatedCloud)
@@ -1821,116 +2220,174 @@ void ccMesh::drawMeOnly(CC_DRAW_CONTEXT& context)
 			//the GL type depends on the PointCoordinateType 'size' (float or double)
 			GLenum GL_COORD_TYPE = sizeof(PointCoordinateType) == 4 ? GL_FLOAT : GL_DOUBLE;
 
-			glFunc->glEnableClientState(GL_VERTEX_ARRAY);
-			glFunc->glVertexPointer(3, GL_COORD_TYPE, 0, GetVertexBuffer());
-
-			if (glParams.showNorms)
-			{
-				glFunc->glEnableClientState(GL_NORMAL_ARRAY);
-				glFunc->glNormalPointer(GL_COORD_TYPE, 0, GetNormalsBuffer());
-			}
-			if (glParams.showSF || glParams.showColors)
-			{
-				glFunc->glEnableClientState(GL_COLOR_ARRAY);
-				glFunc->glColorPointer(3, GL_UNSIGNED_BYTE, 0, GetColorsBuffer());
-			}
+			//VBOs (the per-triangle normals can't be stored per vertex)
+			bool useVBOs = (context.useVBOs && !showTriNormals && updateVBOs(context, glParams));
 
-			//we can scan and process each chunk separately in an optimized way
-			size_t chunkCount = ccChunk::Count(m_triVertIndexes->size());
-			for (size_t k = 0; k < chunkCount; ++k)
+			if (useVBOs)
 			{
-				const size_t chunkSize = ccChunk::Size(k, m_triVertIndexes->size());
-				const CCLib::VerticesIndexes* _vertIndexesChunkOrigin = ccChunk::Start(*m_triVertIndexes, k);
+				//L.O.D.: we only display a subset of the vertices
+				GLsizei vertStep = 1;
+				if (lodEnabled)
+				{
+					vertStep = static_cast<GLsizei>(ceil(static_cast<double>(m_vboManager.vertexCount) / context.minLODTriangleCount));
+				}
+				const GLbyte* vboStart = nullptr;
 
-				//vertices
+				m_vboManager.vertices->bind();
+				glFunc->glEnableClientState(GL_VERTEX_ARRAY);
+				glFunc->glVertexPointer(3, GL_COORD_TYPE, vertStep * static_cast<GLsizei>(sizeof(CCVector3)), vboStart);
+				if (glParams.showNorms)
 				{
-					const CCLib::VerticesIndexes* _vertIndexes = _vertIndexesChunkOrigin;
-					CCVector3* _vertices = GetVertexBuffer();
-					for (n = 0; n < chunkSize; n += decimStep, _vertIndexes += decimStep)
-					{
-						assert(_vertIndexes->i1 < m_associatedCloud->size());
-						assert(_vertIndexes->i2 < m_associatedCloud->size());
-						assert(_vertIndexes->i3 < m_associatedCloud->size());
-						*_vertices++ = *m_associatedCloud->getPoint(_vertIndexes->i1);
-						*_vertices++ = *m_associatedCloud->getPoint(_vertIndexes->i2);
-						*_vertices++ = *m_associatedCloud->getPoint(_vertIndexes->i3);
-					}
+					glFunc->glEnableClientState(GL_NORMAL_ARRAY);
+					glFunc->glNormalPointer(GL_COORD_TYPE, vertStep * static_cast<GLsizei>(sizeof(CCVector3)), vboStart + m_vboManager.normalShift);
+				}
+				if (glParams.showSF || glParams.showColors)
+				{
+					glFunc->glEnableClientState(GL_COLOR_ARRAY);
+					glFunc->glColorPointer(3, GL_UNSIGNED_BYTE, vertStep * static_cast<GLsizei>(sizeof(ccColor::Rgb)), vboStart + m_vboManager.rgbShift);
 				}
+				m_vboManager.vertices->release();
 
-				//scalar field
-				if (glParams.showSF)
+				if (lodEnabled)
 				{
-					const CCLib::VerticesIndexes* _vertIndexes = _vertIndexesChunkOrigin;
-					ccColor::Rgb* _rgbColors = GetColorsBuffer();
-					assert(colorScale);
+					glFunc->glDrawArrays(GL_POINTS, 0, static_cast<GLsizei>(m_vboManager.vertexCount / vertStep));
+				}
+				else
+				{
+					if (showWired)
+					{
+						glFunc->glPushAttrib(GL_POLYGON_BIT);
+						glFunc->glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
+					}
 
-					for (n = 0; n < chunkSize; n += decimStep, _vertIndexes += decimStep)
+					//one index buffer per chunk of triangles
+					for (size_t k = 0; k < m_vboManager.triangles.size(); ++k)
 					{
-						assert(_vertIndexes->i1 < currentDisplayedScalarField->size());
-						assert(_vertIndexes->i2 < currentDisplayedScalarField->size());
-						assert(_vertIndexes->i3 < currentDisplayedScalarField->size());
-						*_rgbColors++ = *currentDisplayedScalarField->getValueColor(_vertIndexes->i1);
-						*_rgbColors++ = *currentDisplayedScalarField->getValueColor(_vertIndexes->i2);
-						*_rgbColors++ = *currentDisplayedScalarField->getValueColor(_vertIndexes->i3);
+						const size_t chunkSize = ccChunk::Size(k, m_triVertIndexes->size());
+						m_vboManager.triangles[k]->bind();
+						glFunc->glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(chunkSize * 3), GL_UNSIGNED_INT, nullptr);
+						m_vboManager.triangles[k]->release();
 					}
-				}
-				//colors
-				else if (glParams.showColors)
-				{
-					const CCLib::VerticesIndexes* _vertIndexes = _vertIndexesChunkOrigin;
-					ccColor::Rgb* _rgbColors = GetColorsBuffer();
-					for (n = 0; n < chunkSize; n += decimStep, _vertIndexes += decimStep)
+
+					if (showWired)
 					{
-						assert(_vertIndexes->i1 < rgbColorsTable->size());
-						assert(_vertIndexes->i2 < rgbColorsTable->size());
-						assert(_vertIndexes->i3 < rgbColorsTable->size());
-						*(_rgbColors)++ = rgbColorsTable->at(_vertIndexes->i1);
-						*(_rgbColors)++ = rgbColorsTable->at(_vertIndexes->i2);
-						*(_rgbColors)++ = rgbColorsTable->at(_vertIndexes->i3);
+						glFunc->glPopAttrib();
 					}
 				}
+			}
+			else
+			{
+				glFunc->glEnableClientState(GL_VERTEX_ARRAY);
+				glFunc->glVertexPointer(3, GL_COORD_TYPE, 0, GetVertexBuffer());
 
-				//normals
 				if (glParams.showNorms)
 				{
-					CCVector3* _normals = GetNormalsBuffer();
-					if (showTriNormals)
+					glFunc->glEnableClientState(GL_NORMAL_ARRAY);
+					glFunc->glNormalPointer(GL_COORD_TYPE, 0, GetNormalsBuffer());
+				}
+				if (glParams.showSF || glParams.showColors)
+				{
+					glFunc->glEnableClientState(GL_COLOR_ARRAY);
+					glFunc->glColorPointer(3, GL_UNSIGNED_BYTE, 0, GetColorsBuffer());
+				}
+
+				//we can scan and process each chunk separately in an optimized way
+				size_t chunkCount = ccChunk::Count(m_triVertIndexes->size());
+				for (size_t k = 0; k < chunkCount; ++k)
+				{
+					const size_t chunkSize = ccChunk::Size(k, m_triVertIndexes->size());
+					const CCLib::VerticesIndexes* _vertIndexesChunkOrigin = ccChunk::Start(*m_triVertIndexes, k);
+
+					//vertices
 					{
-						assert(m_triNormalIndexes);
-						const Tuple3i* _triNormalIndexes = ccChunk::Start(*m_triNormalIndexes, k);
-						for (n = 0; n < chunkSize; n += decimStep, _triNormalIndexes += decimStep)
+						const CCLib::VerticesIndexes* _vertIndexes = _vertIndexesChunkOrigin;
+						CCVector3* _vertices = GetVertexBuffer();
+						for (n = 0; n < chunkSize; n += decimStep, _vertIndexes += decimStep)
 						{
-							assert(_triNormalIndexes->u[0] < static_cast<int>(m_triNormals->size()));
-							assert(_triNormalIndexes->u[1] < static_cast<int>(m_triNormals->size()));
-							assert(_triNormalIndexes->u[2] < static_cast<int>(m_triNormals->size()));
+							assert(_vertIndexes->i1 < m_associatedCloud->size());
+							assert(_vertIndexes->i2 < m_associatedCloud->size());
+							assert(_vertIndexes->i3 < m_associatedCloud->size());
+							*_vertices++ = *m_associatedCloud->getPoint(_vertIndexes->i1);
+							*_vertices++ = *m_associatedCloud->getPoint(_vertIndexes->i2);
+							*_vertices++ = *m_associatedCloud->getPoint(_vertIndexes->i3);
+						}
+					}
+
+					//scalar field
+					if (glParams.showSF)
+					{
+						const CCLib::VerticesIndexes* _vertIndexes = _vertIndexesChunkOrigin;
+						ccColor::Rgb* _rgbColors = GetColorsBuffer();
+						assert(colorScale);
 
-							*_normals++ = (_triNormalIndexes->u[0] >= 0 ? compressedNormals->getNormal(m_triNormals->at(_triNormalIndexes->u[0])) : s_blankNorm);
-							*_normals++ = (_triNormalIndexes->u[1] >= 0 ? compressedNormals->getNormal(m_triNormals->at(_triNormalIndexes->u[1])) : s_blankNorm);
-							*_normals++ = (_triNormalIndexes->u[2] >= 0 ? compressedNormals->getNormal(m_triNormals->at(_triNormalIndexes->u[2])) : s_blankNorm);
+						for (n = 0; n < chunkSize; n += decimStep, _vertIndexes += decimStep)
+						{
+							assert(_vertIndexes->i1 < currentDisplayedScalarField->size());
+							assert(_vertIndexes->i2 < currentDisplayedScalarField->size());
+							assert(_vertIndexes->i3 < currentDisplayedScalarField->size());
+							*_rgbColors++ = *currentDisplayedScalarField->getValueColor(_vertIndexes->i1);
+							*_rgbColors++ = *currentDisplayedScalarField->getValueColor(_vertIndexes->i2);
+							*_rgbColors++ = *currentDisplayedScalarField->getValueColor(_vertIndexes->i3);
 						}
 					}
-					else
+					//colors
+					else if (glParams.showColors)
 					{
 						const CCLib::VerticesIndexes* _vertIndexes = _vertIndexesChunkOrigin;
+						ccColor::Rgb* _rgbColors = GetColorsBuffer();
 						for (n = 0; n < chunkSize; n += decimStep, _vertIndexes += decimStep)
 						{
-							assert(_vertIndexes->i1 < normalsIndexesTable->size());
-							assert(_vertIndexes->i2 < normalsIndexesTable->size());
-							assert(_vertIndexes->i3 < normalsIndexesTable->size());
-							*_normals++ = compressedNormals->getNormal(normalsIndexesTable->at(_vertIndexes->i1));
-							*_normals++ = compressedNormals->getNormal(normalsIndexesTable->at(_vertIndexes->i2));
-							*_normals++ = compressedNormals->getNormal(normalsIndexesTable->at(_vertIndexes->i3));
+							assert(_vertIndexes->i1 < rgbColorsTable->size());
+							assert(_vertIndexes->i2 < rgbColorsTable->size());
+							assert(_vertIndexes->i3 < rgbColorsTable->size());
+							*(_rgbColors)++ = rgbColorsTable->at(_vertIndexes->i1);
+							*(_rgbColors)++ = rgbColorsTable->at(_vertIndexes->i2);
+							*(_rgbColors)++ = rgbColorsTable->at(_vertIndexes->i3);
 						}
 					}
-				}
 
-				if (!showWired)
-				{
-					glFunc->glDrawArrays(lodEnabled ? GL_POINTS : GL_TRIANGLES, 0, (static_cast<int>(chunkSize) / decimStep) * 3);
-				}
-				else
-				{
-					glFunc->glDrawElements(GL_LINES, (static_cast<int>(chunkSize) / decimStep) * 6, GL_UNSIGNED_INT, GetWireVertexIndexes());
+					//normals
+					if (glParams.showNorms)
+					{
+						CCVector3* _normals = GetNormalsBuffer();
+						if (showTriNormals)
+						{
+							assert(m_triNormalIndexes);
+							const Tuple3i* _triNormalIndexes = ccChunk::Start(*m_triNormalIndexes, k);
+							for (n = 0; n < chunkSize; n += decimStep, _triNormalIndexes += decimStep)
+							{
+								assert(_triNormalIndexes->u[0] < static_cast<int>(m_triNormals->size()));
+								assert(_triNormalIndexes->u[1] < static_cast<int>(m_triNormals->size()));
+								assert(_triNormalIndexes->u[2] < static_cast<int>(m_triNormals->size()));
+
+								*_normals++ = (_triNormalIndexes->u[0] >= 0 ? compressedNormals->getNormal(m_triNormals->at(_triNormalIndexes->u[0])) : s_blankNorm);
+								*_normals++ = (_triNormalIndexes->u[1] >= 0 ? compressedNormals->getNormal(m_triNormals->at(_triNormalIndexes->u[1])) : s_blankNorm);
+								*_normals++ = (_triNormalIndexes->u[2] >= 0 ? compressedNormals->getNormal(m_triNormals->at(_triNormalIndexes->u[2])) : s_blankNorm);
+							}
+						}
+						else
+						{
+							const CCLib::VerticesIndexes* _vertIndexes = _vertIndexesChunkOrigin;
+							for (n = 0; n < chunkSize; n += decimStep, _vertIndexes += decimStep)
+							{
+								assert(_vertIndexes->i1 < normalsIndexesTable->size());
+								assert(_vertIndexes->i2 < normalsIndexesTable->size());
+								assert(_vertIndexes->i3 < normalsIndexesTable->size());
+								*_normals++ = compressedNormals->getNormal(normalsIndexesTable->at(_vertIndexes->i1));
+								*_normals++ = compressedNormals->getNormal(normalsIndexesTable->at(_vertIndexes->i2));
+								*_normals++ = compressedNormals->getNormal(normalsIndexesTable->at(_vertIndexes->i3));
+							}
+						}
+					}
+
+					if (!showWired)
+					{
+						glFunc->glDrawArrays(lodEnabled ? GL_POINTS : GL_TRIANGLES, 0, (static_cast<int>(chunkSize) / decimStep) * 3);
+					}
+					else
+					{
+						glFunc->glDrawElements(GL_LINES, (static_cast<int>(chunkSize) / decimStep) * 6, GL_UNSIGNED_INT, GetWireVertexIndexes());
+					}
 				}
 			}
 
@@ -2581,6 +3038,7 @@ void ccMesh::shiftTriangleIndexes(unsigned shift)
 		ti.i2 += shift;
 		ti.i3 += shift;
 	}
+	trianglesHaveChanged();
 }
 
 /*********************************************************/
@@ -24,9 +24,11 @@
 
 //Local
 #include "ccGenericMesh.h"
+#include "ccScalarField.h"
 
 class ccProgressDialog;
 class ccPolyline;
+class QGLBuffer;
 
 //! Triangular mesh
 class QCC_DB_LIB_API ccMesh : public ccGenericMesh
@@ -107,6 +109,9 @@ public:
 	void placeIteratorAtBeginning() override;
 	CCLib::GenericTriangle* _getNextTriangle() override; //temporary
 	CCLib::GenericTriangle* _getTriangle(unsigned triangleIndex) override; //temporary
+	//warning: the (non const) vertices indexes accessors don't invalidate the display
+	//(they are mostly used for reading, sometimes in parallel): after a modification of
+	//the indexes, the caller must call trianglesHaveChanged (or notifyGeometryUpdate)
 	CCLib::VerticesIndexes* getNextTriangleVertIndexes() override;
 	CCLib::VerticesIndexes* getTriangleVertIndexes(unsigned triangleIndex) override;
 	void getTriangleVertices(unsigned triangleIndex, CCVector3& A, CCVector3& B, CCVector3& C) const override;
@@ -378,6 +383,86 @@ public:
 	//! Transforms the mesh per-triangle normals
 	void transformTriNormals(const ccGLMatrix& trans);
 
+	//! Notify a modification of the triangles (vertices indexes)
+	/** Only invalidates the triangles VBOs (see notifyGeometryUpdate for a complete update).
+		Must be called after the indexes have been modified through getTriangleVertIndexes.
+	**/
+	inline void trianglesHaveChanged() { m_vboManager.updateFlags |= vboSet::UPDATE_TRIANGLES; }
+
+	//inherited from ccHObject
+	void notifyGeometryUpdate() override;
+	void removeFromDisplay(const ccGenericGLDisplay* win) override; //for proper VBO release
+
+protected: // VBO
+
+	//! Init/updates VBOs
+	/** The vertices (coordinates, colors and normals) are stored in a single VBO
+		and the triangles (vertices indexes) in one index buffer per chunk.
+		\return whether the VBOs can be used for display or not
+	**/
+	bool updateVBOs(const CC_DRAW_CONTEXT& context, const glDrawParams& glParams);
+
+	//! Release VBOs
+	void releaseVBOs();
+
+	//! VBO set
+	struct vboSet
+	{
+		//! States of the VBO(s)
+		enum STATES { NEW, INITIALIZED, FAILED };
+
+		//! Update flags
+		enum UPDATE_FLAGS {
+			UPDATE_VERTICES = 1,
+			UPDATE_COLORS = 2,
+			UPDATE_NORMALS = 4,
+			UPDATE_TRIANGLES = 8,
+			UPDATE_ALL = UPDATE_VERTICES | UPDATE_COLORS | UPDATE_NORMALS | UPDATE_TRIANGLES
+		};
+
+		vboSet()
+			: vertices(nullptr)
+			, vertexCount(0)
+			, rgbShift(0)
+			, normalShift(0)
+			, hasColors(false)
+			, colorIsSF(false)
+			, sourceSF(nullptr)
+			, sourceSFModificationStamp(0)
+			, hasNormals(false)
+			, pointsVersion(0)
+			, colorsVersion(0)
+			, normalsVersion(0)
+			, totalMemSizeBytes(0)
+			, updateFlags(0)
+			, state(NEW)
+		{}
+
+		//! Vertices buffer (coordinates, then colors and normals if any)
+		QGLBuffer* vertices;
+		//! Triangles buffers (one per chunk of triangles)
+		std::vector<QGLBuffer*> triangles;
+		//! Number of vertices in the vertices buffer
+		unsigned vertexCount;
+		int rgbShift;
+		int normalShift;
+		bool hasColors;
+		bool colorIsSF;
+		ccScalarField* sourceSF;
+		ccScalarField::ModificationStamp sourceSFModificationStamp;
+		bool hasNormals;
+		//! Versions of the vertices data when the buffers were last updated (see ccPointCloud::displayDataVersion)
+		unsigned pointsVersion, colorsVersion, normalsVersion;
+		int totalMemSizeBytes;
+		int updateFlags;
+
+		//! Current state
+		STATES state;
+	};
+
+	//! Set of VBOs attached to this mesh
+	vboSet m_vboManager;
+
 protected:
 
 	//inherited from ccHObject
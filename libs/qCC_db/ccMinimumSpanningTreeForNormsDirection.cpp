@@ -22,12 +22,20 @@
 
 //local
 #include "ccLog.h"
+#include "ccNormalCompressor.h"
 #include "ccPointCloud.h"
 #include "ccScalarField.h"
 #include "ccProgressDialog.h"
 #include "ccOctree.h"
 
+//Qt
+#include <QThread>
+#include <QtConcurrentMap>
+
 //system
+#include <algorithm>
+#include <atomic>
+#include <limits>
 #include <set>
 #include <map>
 #include <vector>
@@ -75,6 +83,7 @@ protected:
 	float m_weight;
 };
 
+#ifdef WITH_GRAPH
 //! Generic graph structure
 class Graph
 {
@@ -150,13 +159,7 @@ protected:
 };
 
 static bool ResolveNormalsWithMST(	ccPointCloud* cloud,
-#ifdef WITH_GRAPH
 									const Graph& graph,
-#else
-									ccOctree::Shared& octree,
-									unsigned char level,
-									unsigned kNN,
-#endif
 									ccProgressDialog* progressCb = 0)
 {
 	assert(cloud && cloud->hasNormals());
@@ -180,11 +183,7 @@ static bool ResolveNormalsWithMST(	ccPointCloud* cloud,
 	std::priority_queue<Edge> priorityQueue;
 	std::vector<bool> visited;
 	unsigned visitedCount = 0;
-#ifdef WITH_GRAPH
 	unsigned vertexCount = graph.vertexCount();
-#else
-	unsigned vertexCount = cloud->size();
-#endif
 
 	//instantiate the 'visited' table
 	try
@@ -197,20 +196,10 @@ static bool ResolveNormalsWithMST(	ccPointCloud* cloud,
 		{
 			progressCb->update(0);
 			progressCb->setMethodTitle(QObject::tr("Orient normals (MST)"));
-#ifdef WITH_GRAPH
 			progressCb->setInfo(QObject::tr("Compute Minimum spanning tree\nPoints: %1\nEdges: %2").arg(vertexCount).arg(graph.edgeCount()));
-#else
-			progressCb->setInfo(QObject::tr("Compute Minimum spanning tree\nPoints: %1").arg(vertexCount));
-#endif
 			progressCb->start();
 		}
 
-#ifndef WITH_GRAPH
-		CCLib::DgmOctree::NearestNeighboursSearchStruct nNSS;
-		nNSS.level = level;
-		nNSS.minNumberOfNeighbors = kNN + 1; //+1 because we'll get the query point itself!
-#endif
-
 		//while unvisited vertices remain...
 		unsigned firstUnvisitedIndex = 0;
 		size_t patchCount = 0;
@@ -228,50 +217,11 @@ static bool ResolveNormalsWithMST(	ccPointCloud* cloud,
 				visited[firstUnvisitedIndex] = true;
 				++visitedCount;
 				//add its neighbors to the priority queue
-#ifdef WITH_GRAPH
 				const Graph::IndexSet& neighbors = graph.getVertexNeighbors(firstUnvisitedIndex);
 				for (Graph::IndexSet::const_iterator it = neighbors.begin(); it != neighbors.end(); ++it)
 				{
 					priorityQueue.push(Edge(firstUnvisitedIndex, *it, graph.weight(firstUnvisitedIndex, *it)));
 				}
-#else
-				const CCVector3* P = cloud->getPoint(firstUnvisitedIndex);
-				nNSS.queryPoint = *P;
-				octree->getTheCellPosWhichIncludesThePoint(P, nNSS.cellPos, level);
-				octree->computeCellCenter(nNSS.cellPos, level, nNSS.cellCenter);
-				nNSS.pointsInNeighbourhood.clear();
-				nNSS.alreadyVisitedNeighbourhoodSize = 0;
-
-				//look for neighbors in a sphere
-				unsigned neighborCount = octree->findNearestNeighborsStartingFromCell(nNSS, false);
-				neighborCount = std::min(neighborCount, kNN + 1);
-
-				//current point index
-				const CCVector3& N1 = cloud->getPointNormal(firstUnvisitedIndex);
-				for (unsigned j = 0; j < neighborCount; ++j)
-				{
-					//current neighbor index
-					unsigned neighborIndex = nNSS.pointsInNeighbourhood[j].pointIndex;
-					if (	firstUnvisitedIndex != neighborIndex
-						&&	!visited[neighborIndex])
-					{
-						const CCVector3& N2 = cloud->getPointNormal(neighborIndex);
-						//dot product
-						float weight = std::max(0.0f, 1.0f - static_cast<float>(fabs(N1.dot(N2))));
-
-						//distance
-						//float weight = sqrt(nNSS.pointsInNeighbourhood[j].squareDistd);
-
-						//mutual dot product
-						//const CCVector3* P2 = cloud->getPoint(static_cast<unsigned>(neighborIndex));
-						//CCVector3 uAB = *P2 - *P1;
-						//uAB.normalize();
-						//float weight = (fabs(CCVector3::vdot(uAB.u, N1) + fabs(CCVector3::vdot(uAB.u, N2)))) / 2;
-
-						priorityQueue.push(Edge(firstUnvisitedIndex, neighborIndex, weight));
-					}
-				}
-#endif
 
 				if (progressCb && !nProgress.oneStep())
 				{
@@ -325,47 +275,9 @@ static bool ResolveNormalsWithMST(	ccPointCloud* cloud,
 					visited[v] = true;
 					++visitedCount;
 					//add its neighbors to the priority queue
-#ifdef WITH_GRAPH
 					const Graph::IndexSet& neighbors = graph.getVertexNeighbors(v);
 					for (Graph::IndexSet::const_iterator it = neighbors.begin(); it != neighbors.end(); ++it)
 						priorityQueue.push(Edge(v, *it, graph.weight(v,*it)));
-#else
-					const CCVector3* P = cloud->getPoint(v);
-					nNSS.queryPoint = *P;
-					octree->getTheCellPosWhichIncludesThePoint(P, nNSS.cellPos, level);
-					octree->computeCellCenter(nNSS.cellPos, level, nNSS.cellCenter);
-					nNSS.pointsInNeighbourhood.clear();
-					nNSS.alreadyVisitedNeighbourhoodSize = 0;
-
-					//look for neighbors in a sphere
-					unsigned neighborCount = octree->findNearestNeighborsStartingFromCell(nNSS, false);
-					neighborCount = std::min(neighborCount, kNN + 1);
-					//current point index
-					const CCVector3& N1 = cloud->getPointNormal(v);
-					for (unsigned j = 0; j < neighborCount; ++j)
-					{
-						//current neighbor index
-						unsigned neighborIndex = nNSS.pointsInNeighbourhood[j].pointIndex;
-						if (	v != neighborIndex
-							&&	!visited[neighborIndex])
-						{
-							const CCVector3& N2 = cloud->getPointNormal(neighborIndex);
-							//dot product
-							float weight = std::max(0.0f, 1.0f - static_cast<float>(fabs(N1.dot(N2))));
-
-							//distance
-							//float weight = sqrt(nNSS.pointsInNeighbourhood[j].squareDistd);
-
-							//mutual dot product
-							//const CCVector3* P2 = cloud->getPoint(static_cast<unsigned>(neighborIndex));
-							//CCVector3 uAB = *P2 - *P1;
-							//uAB.normalize();
-							//float weight = (fabs(CCVector3::vdot(uAB.u, N1) + fabs(CCVector3::vdot(uAB.u, N2)))) / 2;
-
-							priorityQueue.push(Edge(v, neighborIndex, weight));
-						}
-					}
-#endif
 				}
 
 	#ifdef COLOR_PATCHES
@@ -486,6 +398,519 @@ static bool ComputeMSTGraphAtLevel(	const CCLib::DgmOctree::octreeCell& cell,
 	return true;
 }
 
+#endif //WITH_GRAPH
+
+//! Block of consecutive octree cells whose normals are oriented by a single task
+struct OrientationBlock
+{
+	//! First position in the octree 'points and cell codes' array
+	unsigned first;
+	//! Last position (excluded)
+	unsigned last;
+	//! Number of patches (connected components of the block kNN graph)
+	unsigned patchCount;
+	//! Index of the first patch of the block (global numbering)
+	unsigned firstPatch;
+	//! Number of normals inverted by the block spanning tree
+	unsigned inversionCount;
+	//! kNN graph edges between different patches (global point indexes)
+	std::vector< std::pair<unsigned, unsigned> > patchEdges;
+};
+
+//! Link between two patches (sum of the dot products of the normals along the kNN edges between them)
+struct PatchLink
+{
+	unsigned patch1;
+	unsigned patch2;
+	double vote;
+
+	//! Sorting by patches
+	inline bool operator < (const PatchLink& other) const
+	{
+		return patch1 < other.patch1 || (patch1 == other.patch1 && patch2 < other.patch2);
+	}
+};
+
+//! Applies a function to each block (in parallel if there are several blocks)
+template <class Func> static void ForEachBlock(std::vector<OrientationBlock>& blocks, Func func)
+{
+	if (blocks.size() > 1)
+	{
+		QtConcurrent::blockingMap(blocks, func);
+		return;
+	}
+	for (OrientationBlock& block : blocks)
+	{
+		func(block);
+	}
+}
+
+//! Splits the octree points in blocks of consecutive cells (at a given level)
+/** As the points are sorted by cell codes, each block is spatially coherent.
+	A cell is never split between two blocks.
+**/
+static std::vector<OrientationBlock> SplitInBlocks(const CCLib::DgmOctree::cellsContainer& codes, unsigned char level, unsigned minBlockSize)
+{
+	std::vector<OrientationBlock> blocks;
+
+	const unsigned count = static_cast<unsigned>(codes.size());
+	const unsigned char bitDec = CCLib::DgmOctree::GET_BIT_SHIFT(level);
+	unsigned first = 0;
+	while (first < count)
+	{
+		unsigned last = std::min(count, first + minBlockSize);
+		while (last < count && (codes[last].theCode >> bitDec) == (codes[last - 1].theCode >> bitDec))
+		{
+			++last;
+		}
+
+		OrientationBlock block;
+		block.first = first;
+		block.last = last;
+		block.patchCount = 0;
+		block.firstPatch = 0;
+		block.inversionCount = 0;
+		blocks.push_back(block);
+
+		first = last;
+	}
+
+	return blocks;
+}
+
+//! Returns the root of a patch and the orientation of the patch relatively to this root
+/** \param parents patches parents (union-find structure)
+	\param flips orientation of each patch relatively to its parent (1 = opposite)
+	\param patch patch index
+	\param[out] flipToRoot orientation of the patch relatively to the root
+	\return root patch index
+**/
+static unsigned FindRootPatch(std::vector<unsigned>& parents, std::vector<unsigned char>& flips, unsigned patch, unsigned char& flipToRoot)
+{
+	unsigned root = patch;
+	flipToRoot = 0;
+	while (parents[root] != root)
+	{
+		flipToRoot ^= flips[root];
+		root = parents[root];
+	}
+
+	//path compression
+	unsigned char flip = flipToRoot;
+	while (patch != root)
+	{
+		unsigned next = parents[patch];
+		unsigned char nextFlip = flip ^ flips[patch];
+		parents[patch] = root;
+		flips[patch] = flip;
+		patch = next;
+		flip = nextFlip;
+	}
+
+	return root;
+}
+
+//! Resolves the normals orientation block by block, then stitches the blocks patches together
+/** The octree points are split in blocks of consecutive cells. For each block (in parallel):
+	- the kNN graph restricted to the block is built (compact CSR arrays)
+	- a Minimum Spanning Tree is computed on this graph (Prim's algorithm) and the normals
+	are oriented along it. Each connected component of the graph is a patch.
+	The patches are then linked by the kNN edges that cross the blocks borders or that join
+	two patches of the same block (each edge votes for the relative orientation of the two
+	patches). A maximum spanning tree of the patches graph (weighted by the votes confidence)
+	gives the patches to flip.
+	The memory footprint is bounded by the blocks size (and by the number of edges between patches).
+**/
+static bool ResolveNormalsByBlocks(	ccPointCloud* cloud,
+									const ccOctree::Shared& octree,
+									unsigned char level,
+									unsigned kNN,
+									ccProgressDialog* progressCb = 0)
+{
+	assert(cloud && cloud->hasNormals() && octree);
+
+	NormsIndexesTableType* normals = cloud->normals();
+	const CCLib::DgmOctree::cellsContainer& codes = octree->pointsAndTheirCellCodes();
+	const unsigned pointCount = static_cast<unsigned>(codes.size());
+	if (pointCount == 0)
+	{
+		return true;
+	}
+
+	static const unsigned NoPatch = std::numeric_limits<unsigned>::max();
+	//min and max number of points per block (the blocks are bigger than the octree cells anyway)
+	static const unsigned MinBlockSize = (1 << 14);
+	static const unsigned MaxBlockSize = (1 << 18);
+	//progress is notified by blocks of points
+	static const unsigned ProgressStep = 1024;
+
+	//a few blocks per thread for a better load balancing
+	unsigned blockSize = pointCount / static_cast<unsigned>(std::max(1, 4 * QThread::idealThreadCount()));
+	blockSize = std::max(MinBlockSize, std::min(MaxBlockSize, blockSize));
+
+	std::vector<OrientationBlock> blocks;
+	std::vector<unsigned> positions; //position of each point in the octree 'points and cell codes' array
+	std::vector<unsigned> patches; //patch of each point
+	try
+	{
+		blocks = SplitInBlocks(codes, level, blockSize);
+		positions.resize(cloud->size()); //only the projected points will be queried
+		patches.resize(cloud->size(), NoPatch);
+	}
+	catch (const std::bad_alloc&)
+	{
+		//not enough memory
+		return false;
+	}
+
+	for (unsigned i = 0; i < pointCount; ++i)
+	{
+		positions[codes[i].theIndex] = i;
+	}
+
+	//progress notification
+	CCLib::NormalizedProgress nProgress(progressCb, pointCount);
+	if (progressCb)
+	{
+		progressCb->update(0);
+		progressCb->setMethodTitle(QObject::tr("Orient normals (MST)"));
+		progressCb->setInfo(QObject::tr("Compute Minimum spanning trees\nPoints: %1\nBlocks: %2").arg(pointCount).arg(blocks.size()));
+		progressCb->start();
+	}
+
+	std::atomic<bool> cancelled(false);
+	std::atomic<bool> error(false);
+
+	//orient the normals inside each block
+	ForEachBlock(blocks, [&](OrientationBlock& block)
+	{
+		if (cancelled || error)
+		{
+			return;
+		}
+
+		try
+		{
+			const unsigned count = block.last - block.first;
+
+			//block kNN graph (the neighbours of the ith point are neighbours[neighbourStart[i]] ... neighbours[neighbourStart[i+1]-1])
+			std::vector<unsigned> neighbourStart(count + 1, 0);
+			std::vector<unsigned> neighbours;
+			std::vector<float> weights;
+			neighbours.reserve(static_cast<size_t>(count) * kNN);
+			weights.reserve(static_cast<size_t>(count) * kNN);
+
+			CCLib::DgmOctree::NearestNeighboursSearchStruct nNSS;
+			nNSS.level = level;
+			nNSS.minNumberOfNeighbors = kNN + 1; //+1 because we'll get the query point itself!
+			bool cellIsSet = false;
+
+			for (unsigned i = 0; i < count; ++i)
+			{
+				const unsigned index = codes[block.first + i].theIndex;
+				const CCVector3* P = cloud->getPoint(index);
+				nNSS.queryPoint = *P;
+
+				Tuple3i cellPos;
+				octree->getTheCellPosWhichIncludesThePoint(P, cellPos, level);
+				//consecutive points generally lie in the same cell: the neighbourhood gathered so far can be re-used
+				if (!cellIsSet || cellPos.x != nNSS.cellPos.x || cellPos.y != nNSS.cellPos.y || cellPos.z != nNSS.cellPos.z)
+				{
+					nNSS.cellPos = cellPos;
+					octree->computeCellCenter(nNSS.cellPos, level, nNSS.cellCenter);
+					nNSS.pointsInNeighbourhood.resize(0);
+					nNSS.alreadyVisitedNeighbourhoodSize = 0;
+					cellIsSet = true;
+				}
+
+				//look for neighbors in a sphere
+				unsigned neighborCount = octree->findNearestNeighborsStartingFromCell(nNSS, false);
+				neighborCount = std::min(neighborCount, kNN + 1);
+
+				const CCVector3& N1 = cloud->getPointNormal(index);
+				for (unsigned j = 0; j < neighborCount; ++j)
+				{
+					unsigned neighborIndex = nNSS.pointsInNeighbourhood[j].pointIndex;
+					if (neighborIndex == index)
+					{
+						continue;
+					}
+
+					unsigned position = positions[neighborIndex];
+					if (position >= block.first && position < block.last)
+					{
+						const CCVector3& N2 = cloud->getPointNormal(neighborIndex);
+						//dot product
+						neighbours.push_back(position - block.first);
+						weights.push_back(std::max(0.0f, 1.0f - static_cast<float>(fabs(N1.dot(N2)))));
+					}
+					else
+					{
+						//will be used to stitch the patches
+						block.patchEdges.push_back(std::make_pair(index, neighborIndex));
+					}
+				}
+				neighbourStart[i + 1] = static_cast<unsigned>(neighbours.size());
+
+				if (progressCb && ((i + 1) % ProgressStep) == 0)
+				{
+					if (cancelled || !nProgress.steps(ProgressStep))
+					{
+						cancelled = true;
+						return;
+					}
+				}
+			}
+
+			//Prim's algorithm (only this task modifies the normals of the block points)
+			std::vector<unsigned> blockPatches(count, NoPatch);
+			std::priority_queue<Edge> priorityQueue;
+
+			for (unsigned seed = 0; seed < count; ++seed)
+			{
+				if (blockPatches[seed] != NoPatch)
+				{
+					continue;
+				}
+
+				unsigned v = seed;
+				blockPatches[v] = block.patchCount;
+				while (true)
+				{
+					//add the neighbors of the new vertex to the priority queue
+					for (unsigned k = neighbourStart[v]; k < neighbourStart[v + 1]; ++k)
+					{
+						if (blockPatches[neighbours[k]] == NoPatch)
+						{
+							priorityQueue.push(Edge(v, neighbours[k], weights[k]));
+						}
+					}
+
+					//process next edge (with the lowest 'weight')
+					unsigned u = 0;
+					do
+					{
+						if (priorityQueue.empty())
+						{
+							break;
+						}
+						Edge element = priorityQueue.top();
+						priorityQueue.pop();
+
+						//we should change the vertex that has not been visited yet
+						if (blockPatches[element.v1()] == NoPatch)
+						{
+							v = element.v1();
+							u = element.v2();
+						}
+						else if (blockPatches[element.v2()] == NoPatch)
+						{
+							v = element.v2();
+							u = element.v1();
+						}
+					}
+					while (blockPatches[v] != NoPatch);
+
+					if (blockPatches[v] != NoPatch)
+					{
+						//the patch is complete
+						break;
+					}
+
+					//shall the normal be inverted?
+					const unsigned indexU = codes[block.first + u].theIndex;
+					const unsigned indexV = codes[block.first + v].theIndex;
+					if (cloud->getPointNormal(indexU).dot(cloud->getPointNormal(indexV)) < 0)
+					{
+						ccNormalCompressor::InvertNormal(normals->at(indexV));
+						++block.inversionCount;
+					}
+					blockPatches[v] = block.patchCount;
+				}
+
+				//new patch
+				++block.patchCount;
+			}
+
+			for (unsigned i = 0; i < count; ++i)
+			{
+				const unsigned index = codes[block.first + i].theIndex;
+				patches[index] = blockPatches[i];
+
+				//the kNN graph is not symmetric: some patches of the block may be linked by one-way edges
+				for (unsigned k = neighbourStart[i]; k < neighbourStart[i + 1]; ++k)
+				{
+					if (blockPatches[neighbours[k]] != blockPatches[i])
+					{
+						block.patchEdges.push_back(std::make_pair(index, codes[block.first + neighbours[k]].theIndex));
+					}
+				}
+			}
+		}
+		catch (const std::bad_alloc&)
+		{
+			//not enough memory
+			error = true;
+		}
+	});
+
+	if (progressCb)
+	{
+		progressCb->stop();
+	}
+
+	//the normals may have been modified (even if the process failed)
+	cloud->normalsHaveChanged();
+
+	if (error || cancelled)
+	{
+		return false;
+	}
+
+	//release the memory we don't need anymore
+	positions = std::vector<unsigned>();
+
+	//global patches numbering
+	unsigned patchCount = 0;
+	unsigned inversionCount = 0;
+	for (OrientationBlock& block : blocks)
+	{
+		block.firstPatch = patchCount;
+		patchCount += block.patchCount;
+		inversionCount += block.inversionCount;
+	}
+	ForEachBlock(blocks, [&](OrientationBlock& block)
+	{
+		for (unsigned i = block.first; i < block.last; ++i)
+		{
+			patches[codes[i].theIndex] += block.firstPatch;
+		}
+	});
+
+	//links between the patches of the different blocks
+	std::vector<PatchLink> links;
+	try
+	{
+		size_t patchEdgeCount = 0;
+		for (const OrientationBlock& block : blocks)
+		{
+			patchEdgeCount += block.patchEdges.size();
+		}
+		links.reserve(patchEdgeCount);
+
+		for (OrientationBlock& block : blocks)
+		{
+			for (const std::pair<unsigned, unsigned>& edge : block.patchEdges)
+			{
+				PatchLink link;
+				link.patch1 = std::min(patches[edge.first], patches[edge.second]);
+				link.patch2 = std::max(patches[edge.first], patches[edge.second]);
+				link.vote = cloud->getPointNormal(edge.first).dot(cloud->getPointNormal(edge.second));
+				links.push_back(link);
+			}
+			block.patchEdges = std::vector< std::pair<unsigned, unsigned> >();
+		}
+	}
+	catch (const std::bad_alloc&)
+	{
+		//not enough memory
+		return false;
+	}
+
+	//merge the links between the same patches
+	std::sort(links.begin(), links.end());
+	size_t linkCount = 0;
+	for (size_t i = 0; i < links.size(); ++i)
+	{
+		if (linkCount != 0 && links[linkCount - 1].patch1 == links[i].patch1 && links[linkCount - 1].patch2 == links[i].patch2)
+		{
+			links[linkCount - 1].vote += links[i].vote;
+		}
+		else
+		{
+			links[linkCount++] = links[i];
+		}
+	}
+	links.resize(linkCount);
+
+	//the most confident links first
+	std::sort(links.begin(), links.end(), [](const PatchLink& a, const PatchLink& b)
+	{
+		double absA = std::abs(a.vote);
+		double absB = std::abs(b.vote);
+		return absA > absB || (absA == absB && a < b);
+	});
+
+	//maximum spanning tree of the patches (Kruskal's algorithm)
+	std::vector<unsigned> parents;
+	std::vector<unsigned char> flips;
+	try
+	{
+		parents.resize(patchCount);
+		flips.resize(patchCount, 0);
+	}
+	catch (const std::bad_alloc&)
+	{
+		//not enough memory
+		return false;
+	}
+	for (unsigned i = 0; i < patchCount; ++i)
+	{
+		parents[i] = i;
+	}
+
+	unsigned stitchCount = 0;
+	for (const PatchLink& link : links)
+	{
+		unsigned char flip1 = 0;
+		unsigned char flip2 = 0;
+		unsigned root1 = FindRootPatch(parents, flips, link.patch1, flip1);
+		unsigned root2 = FindRootPatch(parents, flips, link.patch2, flip2);
+		if (root1 != root2)
+		{
+			//the two patches should have opposite orientations if the vote is negative
+			parents[root2] = root1;
+			flips[root2] = flip1 ^ flip2 ^ (link.vote < 0 ? 1 : 0);
+			++stitchCount;
+		}
+	}
+
+	//orientation of each patch relatively to the root of its tree
+	unsigned flippedPatchCount = 0;
+	for (unsigned i = 0; i < patchCount; ++i)
+	{
+		unsigned char flip = 0;
+		FindRootPatch(parents, flips, i, flip);
+		flips[i] = flip;
+		flippedPatchCount += flip;
+	}
+
+	if (flippedPatchCount != 0)
+	{
+		ForEachBlock(blocks, [&](OrientationBlock& block)
+		{
+			for (unsigned i = block.first; i < block.last; ++i)
+			{
+				unsigned index = codes[i].theIndex;
+				if (flips[patches[index]])
+				{
+					ccNormalCompressor::InvertNormal(normals->at(index));
+				}
+			}
+		});
+		cloud->normalsHaveChanged();
+	}
+
+	ccLog::Print(QString("[ResolveNormalsWithMST] Blocks = %1 / Patches = %2 (%3 after stitching) / Inversions: %4 / Flipped patches: %5")
+		.arg(blocks.size())
+		.arg(patchCount)
+		.arg(patchCount - stitchCount)
+		.arg(inversionCount)
+		.arg(flippedPatchCount));
+
+	return true;
+}
+
 bool ccMinimumSpanningTreeForNormsDirection::OrientNormals(	ccPointCloud* cloud,
 															unsigned kNN/*=6*/,
 															ccProgressDialog* progressDlg/*=0*/)
@@ -549,7 +974,7 @@ bool ccMinimumSpanningTreeForNormsDirection::OrientNormals(	ccPointCloud* cloud,
 			}
 		}
 #else
-		if (!ResolveNormalsWithMST(cloud, octree, level, kNN, progressDlg))
+		if (!ResolveNormalsByBlocks(cloud, octree, level, kNN, progressDlg))
 		{
 			//something went wrong
 			ccLog::Warning(QString("Failed to resolve normals orientation with Minimum Spanning Tree on cloud '%1'").arg(cloud->getName()));
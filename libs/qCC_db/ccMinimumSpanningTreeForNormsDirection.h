@@ -29,6 +29,9 @@ class ccMinimumSpanningTreeForNormsDirection
 public:
 
 	//! Main entry point
+	/** The cloud is processed by blocks of octree cells (in parallel). The patches
+		of each block are then stitched together along the blocks borders.
+	**/
 	static bool OrientNormals(	ccPointCloud* cloud,
 								unsigned kNN = 6,
 								ccProgressDialog* progressDlg = 0);
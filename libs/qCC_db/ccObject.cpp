@@ -59,8 +59,10 @@
 	v4.6 - 11/03/2016 - Null normal vector code added
 	v4.7 - 12/22/2016 - Return index added to ccWaveform
 	v4.8 - 10/19/2018 - The CC_CAMERA_BIT and CC_QUADRIC_BIT were wrongly defined
+	v4.9 - 10/17/2026 - 64 bits element count for the arrays with more than 4 billion elements (64 bits point indexes)
+	v5.0 - 10/17/2026 - The LOD structure of clouds sorted in the LOD order is saved with the cloud
 **/
-const unsigned c_currentDBVersion = 48; //4.8
+const unsigned c_currentDBVersion = 50; //5.0
 
 //! Default unique ID generator (using the system persistent settings as we did previously proved to be not reliable)
 static ccUniqueIDGenerator::Shared s_uniqueIDGenerator(new ccUniqueIDGenerator);
@@ -29,7 +29,13 @@
 
 //CCLib
 #include <ScalarFieldTools.h>
-#include <RayAndBox.h>
+
+//Qt
+#include <QtConcurrentMap>
+
+//system
+#include <algorithm>
+#include <limits>
 
 #ifdef QT_DEBUG
 //#define DEBUG_PICKING_MECHANISM
@@ -97,6 +103,24 @@ void ccOctree::clear()
 	DgmOctree::clear();
 }
 
+int ccOctree::appendPoints(PointIndexType firstPointIndex, CCLib::GenericProgressCallback* progressCb/*=nullptr*/)
+{
+	//warn the others that the octree organization is going to change
+	emit updated();
+
+	int result = DgmOctree::appendPoints(firstPointIndex, progressCb);
+
+	m_glListIsDeprecated = true;
+	if (m_frustumIntersector)
+	{
+		//will be rebuilt on demand
+		delete m_frustumIntersector;
+		m_frustumIntersector = nullptr;
+	}
+
+	return result;
+}
+
 ccBBox ccOctree::getSquareBB() const
 {
 	return ccBBox(m_dimMin, m_dimMax);
@@ -511,10 +535,197 @@ bool ccOctree::intersectWithFrustum(ccCameraSensor* sensor, std::vector<unsigned
 	return true;
 }
 
+//! Result of the projection of a cell (box) in a 2D region
+enum ProjectedBoxPosition { BOX_OUTSIDE, BOX_INTERSECTS, BOX_INSIDE };
+
+//! Projects a 3D box on screen and compares it with a 2D region
+/** \param mvp projection x modelview matrix
+	\param viewport camera viewport
+	\param boxMin box min corner
+	\param boxMax box max corner
+	\param trans optional transformation to apply to the box corners
+	\param regionMin 2D region min corner
+	\param regionMax 2D region max corner
+**/
+static ProjectedBoxPosition ProjectBoxInRegion(	const ccGLMatrixd& mvp,
+												const int viewport[4],
+												const CCVector3& boxMin,
+												const CCVector3& boxMax,
+												const ccGLMatrix* trans,
+												const CCVector2d& regionMin,
+												const CCVector2d& regionMax)
+{
+	CCVector2d projMin(0, 0), projMax(0, 0);
+	unsigned behindCount = 0;
+	for (unsigned i = 0; i < 8; ++i)
+	{
+		CCVector3 C(	(i & 1) ? boxMax.x : boxMin.x,
+						(i & 2) ? boxMax.y : boxMin.y,
+						(i & 4) ? boxMax.z : boxMin.z );
+		if (trans)
+		{
+			trans->apply(C);
+		}
+
+		Tuple4Tpl<double> Pp = mvp * Tuple4Tpl<double>(C.x, C.y, C.z, 1.0);
+		if (Pp.w <= std::numeric_limits<double>::epsilon())
+		{
+			//this corner lies behind the camera
+			++behindCount;
+			continue;
+		}
+
+		//window coordinates (see ccGL::Project)
+		CCVector2d P2D(	(1.0 + Pp.x / Pp.w) / 2 * viewport[2] + viewport[0],
+						(1.0 + Pp.y / Pp.w) / 2 * viewport[3] + viewport[1] );
+		if (i == behindCount)
+		{
+			projMin = projMax = P2D;
+		}
+		else
+		{
+			projMin.x = std::min(projMin.x, P2D.x);
+			projMin.y = std::min(projMin.y, P2D.y);
+			projMax.x = std::max(projMax.x, P2D.x);
+			projMax.y = std::max(projMax.y, P2D.y);
+		}
+	}
+
+	if (behindCount == 8)
+	{
+		//the whole box is behind the camera
+		return BOX_OUTSIDE;
+	}
+	else if (behindCount != 0)
+	{
+		//the projection of the box is unbounded
+		return BOX_INTERSECTS;
+	}
+
+	if (	projMax.x < regionMin.x || projMin.x > regionMax.x
+		||	projMax.y < regionMin.y || projMin.y > regionMax.y )
+	{
+		return BOX_OUTSIDE;
+	}
+
+	if (	projMin.x >= regionMin.x && projMax.x <= regionMax.x
+		&&	projMin.y >= regionMin.y && projMax.y <= regionMax.y )
+	{
+		return BOX_INSIDE;
+	}
+
+	return BOX_INTERSECTS;
+}
+
+bool ccOctree::getCellsInScreenRegion(	const ccGLCameraParameters& camera,
+										const CCVector2d& regionMin,
+										const CCVector2d& regionMax,
+										CellsRanges& ranges,
+										const ccGLMatrix* trans/*=nullptr*/,
+										unsigned char maxLevel/*=0*/) const
+{
+	ranges.clear();
+
+	if (m_numberOfProjectedPoints == 0)
+	{
+		//nothing to do
+		return true;
+	}
+
+	if (maxLevel == 0 || maxLevel > MAX_OCTREE_LEVEL)
+	{
+		//no need to go too deep
+		maxLevel = findBestLevelForAGivenPopulationPerCell(10);
+	}
+
+	const ccGLMatrixd mvp = camera.projectionMat * camera.modelViewMat;
+
+	//cells to process (depth-first, so that the output ranges are sorted)
+	struct CellToProcess
+	{
+		unsigned char level;
+		PointIndexType first;
+		PointIndexType last;
+	};
+
+	try
+	{
+		std::vector<CellToProcess> cellsToProcess;
+		cellsToProcess.push_back({ 0, 0, m_numberOfProjectedPoints });
+
+		std::vector<CellToProcess> children;
+		while (!cellsToProcess.empty())
+		{
+			const CellToProcess cell = cellsToProcess.back();
+			cellsToProcess.pop_back();
+
+			//cell bounding-box
+			Tuple3i cellPos(0, 0, 0);
+			if (cell.level != 0)
+			{
+				getCellPos(m_thePointsAndTheirCellCodes[cell.first].theCode, cell.level, cellPos, false);
+			}
+			const PointCoordinateType& cs = getCellSize(cell.level);
+			CCVector3 cellMin(	m_dimMin.x + cs * cellPos.x,
+								m_dimMin.y + cs * cellPos.y,
+								m_dimMin.z + cs * cellPos.z );
+			CCVector3 cellMax = cellMin + CCVector3(cs, cs, cs);
+
+			ProjectedBoxPosition position = ProjectBoxInRegion(mvp, camera.viewport, cellMin, cellMax, trans, regionMin, regionMax);
+			if (position == BOX_OUTSIDE)
+			{
+				//skip the whole cell
+				continue;
+			}
+
+			if (position == BOX_INSIDE || cell.level >= maxLevel)
+			{
+				bool fullyInside = (position == BOX_INSIDE);
+				//merge with the previous range if possible
+				if (!ranges.empty() && ranges.back().last == cell.first && ranges.back().fullyInside == fullyInside)
+				{
+					ranges.back().last = cell.last;
+				}
+				else
+				{
+					ranges.push_back({ cell.first, cell.last, fullyInside });
+				}
+				continue;
+			}
+
+			//otherwise we look at its children (at most 8)
+			const unsigned char childLevel = cell.level + 1;
+			const unsigned char bitDec = GET_BIT_SHIFT(childLevel);
+			children.clear();
+			for (PointIndexType first = cell.first; first < cell.last; )
+			{
+				CellCode childCode = (m_thePointsAndTheirCellCodes[first].theCode >> bitDec);
+				cellsContainer::const_iterator lastIt = std::upper_bound(	m_thePointsAndTheirCellCodes.begin() + first,
+																			m_thePointsAndTheirCellCodes.begin() + cell.last,
+																			childCode,
+																			[bitDec](CellCode code, const IndexAndCode& item) { return code < (item.theCode >> bitDec); });
+				PointIndexType last = static_cast<PointIndexType>(lastIt - m_thePointsAndTheirCellCodes.begin());
+				children.push_back({ childLevel, first, last });
+				first = last;
+			}
+			cellsToProcess.insert(cellsToProcess.end(), children.rbegin(), children.rend());
+		}
+	}
+	catch (const std::bad_alloc&)
+	{
+		//not enough memory
+		ranges.clear();
+		return false;
+	}
+
+	return true;
+}
+
 bool ccOctree::pointPicking(const CCVector2d& clickPos,
 							const ccGLCameraParameters& camera,
 							PointDescriptor& output,
-							double pickWidth_pix/*=3.0*/) const
+							double pickWidth_pix/*=3.0*/,
+							double pickHeight_pix/*=3.0*/) const
 {
 	output.point = 0;
 	output.squareDistd = -1.0;
@@ -541,69 +752,27 @@ bool ccOctree::pointPicking(const CCVector2d& clickPos,
 	ccGLMatrix trans;
 	bool hasGLTrans = m_theAssociatedCloudAsGPC->getAbsoluteGLTransformation(trans);
 
-	//compute 3D picking 'ray'
-	CCVector3 rayAxis, rayOrigin;
+	//we only test the points lying in the cells that may be projected in the picking area
+	CellsRanges ranges;
+	if (!getCellsInScreenRegion(camera,
+								CCVector2d(clickPos.x - pickWidth_pix, clickPos.y - pickHeight_pix),
+								CCVector2d(clickPos.x + pickWidth_pix, clickPos.y + pickHeight_pix),
+								ranges,
+								hasGLTrans ? &trans : nullptr))
 	{
-		CCVector3d clickPosd2(clickPos.x, clickPos.y, 1.0);
-		CCVector3d Y(0, 0, 0);
-		if (!camera.unproject(clickPosd2, Y))
-		{
-			return false;
-		}
-
-		rayAxis = CCVector3::fromArray((Y-X).u);
-		rayOrigin = CCVector3::fromArray(X.u);
-
-		if (hasGLTrans)
-		{
-			ccGLMatrix iTrans = trans.inverse();
-			iTrans.applyRotation(rayAxis);
-			iTrans.apply(rayOrigin);
-		}
-
-		rayAxis.normalize(); //normalize afterwards as the local transformation may have a scale != 1
-	}
-
-	CCVector3 margin(0, 0, 0);
-	double maxFOV_rad = 0;
-	if (camera.perspective)
-	{
-		maxFOV_rad = 0.002 * pickWidth_pix; //empirical conversion from pixels to FOV angle (in radians)
-	}
-	else
-	{
-		double maxRadius = pickWidth_pix * camera.pixelSize / 2;
-		margin = CCVector3(1, 1, 1) * static_cast<PointCoordinateType>(maxRadius);
+		return false;
 	}
 
-	//first test with the total bounding box
-	Ray<PointCoordinateType> ray(rayAxis, rayOrigin);
-	if (!AABB<PointCoordinateType>(m_dimMin - margin, m_dimMax + margin).intersects(ray))
+	if (ranges.empty())
 	{
 		//no intersection
 		return true; //DGM: false would mean that an error occurred! (output.point == 0 means that nothing has been found)
 	}
 
-	//no need to go too deep
-	const unsigned char maxLevel = findBestLevelForAGivenPopulationPerCell(10);
-
-	//starting level of subdivision
-	unsigned char level = 1;
-	//binary shift for cell code truncation at current level
-	unsigned char currentBitDec = GET_BIT_SHIFT(level);
-	//current cell code
-	CellCode currentCellCode = INVALID_CELL_CODE;
-	CellCode currentCellTruncatedCode = INVALID_CELL_CODE;
-	//whether the current cell should be skipped or not
-	bool skipThisCell = false;
-
 #ifdef DEBUG_PICKING_MECHANISM
 	m_theAssociatedCloud->enableScalarField();
 #endif
 
-	//ray with origin expressed in the local coordinate system!
-	Ray<PointCoordinateType> rayLocal(rayAxis, rayOrigin - m_dimMin);
-
 	//visibility table (if any)
 	const ccGenericPointCloud::VisibilityTableType* visTable = m_theAssociatedCloudAsGPC->isVisibilityTableInstantiated() ? &m_theAssociatedCloudAsGPC->getTheVisibilityArray() : 0;
 
@@ -623,82 +792,55 @@ bool ccOctree::pointPicking(const CCVector2d& clickPos,
 		}
 	}
 
-	//let's sweep through the octree
-	for (cellsContainer::const_iterator it = m_thePointsAndTheirCellCodes.begin(); it != m_thePointsAndTheirCellCodes.end(); ++it)
+	//the ranges are grouped in tasks (processed in parallel)
+	struct PickingTask
 	{
-		CellCode truncatedCode = (it->theCode >> currentBitDec);
-		
-		//new cell?
-		if (truncatedCode != currentCellTruncatedCode)
+		std::size_t firstRange;
+		std::size_t lastRange;
+		//nearest point found by this task
+		PointDescriptor nearest;
+	};
+	std::vector<PickingTask> tasks;
+	{
+		static const unsigned MIN_POINTS_PER_TASK = (1 << 14);
+		PointIndexType taskPointCount = 0;
+		for (std::size_t i = 0; i < ranges.size(); ++i)
 		{
-			//look for the biggest 'parent' cell that englobes this cell and the previous one (if any)
-			while (level > 1)
+			if (tasks.empty() || taskPointCount >= MIN_POINTS_PER_TASK)
 			{
-				unsigned char bitDec = GET_BIT_SHIFT(level-1);
-				if ((it->theCode >> bitDec) == (currentCellCode >> bitDec))
-				{
-					//same parent cell, we can stop here
-					break;
-				}
-				--level;
+				PickingTask task;
+				task.firstRange = task.lastRange = i;
+				tasks.push_back(task);
+				taskPointCount = 0;
 			}
+			tasks.back().lastRange = i + 1;
+			taskPointCount += ranges[i].last - ranges[i].first;
+		}
+	}
 
-			currentCellCode = it->theCode;
-
-			//now try to go deeper with the new cell
-			while (level < maxLevel)
+	auto pickInTask = [&](PickingTask& task)
+	{
+		PointDescriptor& nearest = task.nearest;
+		for (std::size_t r = task.firstRange; r < task.lastRange; ++r)
+		{
+			for (PointIndexType i = ranges[r].first; i < ranges[r].last; ++i)
 			{
-				Tuple3i cellPos;
-				getCellPos(it->theCode, level, cellPos, false);
-
-				//first test with the total bounding box
-				PointCoordinateType halfCellSize = getCellSize(level) / 2;
-				CCVector3 cellCenter(	(2* cellPos.x + 1) * halfCellSize,
-										(2* cellPos.y + 1) * halfCellSize,
-										(2* cellPos.z + 1) * halfCellSize);
+				const PointIndexType pointIndex = m_thePointsAndTheirCellCodes[i].theIndex;
 
-				CCVector3 halfCell = CCVector3(halfCellSize, halfCellSize, halfCellSize);
-
-				if (camera.perspective)
-				{
-					double radialSqDist, sqDistToOrigin;
-					rayLocal.squareDistances(cellCenter, radialSqDist, sqDistToOrigin);
-
-					double dx = sqrt(sqDistToOrigin);
-					double dy = std::max<double>(0, sqrt(radialSqDist) - SQRT_3 * halfCellSize);
-					double fov_rad = atan2(dy, dx);
+#ifdef DEBUG_PICKING_MECHANISM
+				m_theAssociatedCloud->setPointScalarValue(pointIndex, r);
+#endif
 
-					skipThisCell = (fov_rad > maxFOV_rad);
-				}
-				else
+				//we shouldn't test points that are actually hidden!
+				if (	(visTable && visTable->at(pointIndex) != POINT_VISIBLE)
+					||	(activeSF && !activeSF->getColor(activeSF->getValue(pointIndex)))
+					)
 				{
-					skipThisCell = !AABB<PointCoordinateType>(	cellCenter - halfCell - margin,
-																cellCenter + halfCell + margin).intersects(rayLocal);
+					continue;
 				}
 
-				if (skipThisCell)
-					break;
-				else
-					++level;
-			}
-			
-			currentBitDec = GET_BIT_SHIFT(level);
-			currentCellTruncatedCode = (currentCellCode >> currentBitDec);
-		}
-
-#ifdef DEBUG_PICKING_MECHANISM
-		m_theAssociatedCloud->setPointScalarValue(it->theIndex, level);
-#endif
-
-		if (!skipThisCell)
-		{
-			//we shouldn't test points that are actually hidden!
-			if (	(!visTable || visTable->at(it->theIndex) == POINT_VISIBLE)
-				&&	(!activeSF || activeSF->getColor(activeSF->getValue(it->theIndex)))
-				)
-			{
 				//test the point
-				const CCVector3* P = m_theAssociatedCloud->getPoint(it->theIndex);
+				const CCVector3* P = m_theAssociatedCloud->getPointPersistentPtr(pointIndex);
 				CCVector3 Q = *P;
 				if (hasGLTrans)
 				{
@@ -709,18 +851,38 @@ bool ccOctree::pointPicking(const CCVector2d& clickPos,
 				camera.project(Q, Q2D);
 
 				if (	fabs(Q2D.x - clickPos.x) <= pickWidth_pix
-					&&	fabs(Q2D.y - clickPos.y) <= pickWidth_pix )
+					&&	fabs(Q2D.y - clickPos.y) <= pickHeight_pix )
 				{
 					double squareDist = CCVector3d(X.x - Q.x, X.y - Q.y, X.z - Q.z).norm2d();
-					if (!output.point || squareDist < output.squareDistd)
+					if (!nearest.point || squareDist < nearest.squareDistd)
 					{
-						output.point = P;
-						output.pointIndex = it->theIndex;
-						output.squareDistd = squareDist;
+						nearest.point = P;
+						nearest.pointIndex = pointIndex;
+						nearest.squareDistd = squareDist;
 					}
 				}
 			}
 		}
+	};
+
+#ifndef DEBUG_PICKING_MECHANISM
+	if (tasks.size() > 1)
+	{
+		QtConcurrent::blockingMap(tasks, pickInTask);
+	}
+	else
+#endif
+	{
+		std::for_each(tasks.begin(), tasks.end(), pickInTask);
+	}
+
+	//eventually we keep the nearest point (ties are resolved by the point order in the octree)
+	for (const PickingTask& task : tasks)
+	{
+		if (task.nearest.point && (!output.point || task.nearest.squareDistd < output.squareDistd))
+		{
+			output = task.nearest;
+		}
 	}
 
 	return true;
@@ -75,6 +75,7 @@ public: //GENERAL METHODS
 
 	//inherited from DgmOctree
 	virtual void clear() override;
+	virtual int appendPoints(PointIndexType firstPointIndex, CCLib::GenericProgressCallback* progressCb = nullptr) override;
 
 public: //RENDERING
 	
@@ -102,10 +103,55 @@ public: //RENDERING
 								std::vector<unsigned>& inCameraFrustum);
 
 	//! Octree-driven point picking algorithm
+	/** Only the points lying in the cells that may be projected in the picking
+		area are tested (see ccOctree::getCellsInScreenRegion). They are tested
+		in parallel.
+		\param clickPos clicked position (in pixels)
+		\param camera camera parameters
+		\param output nearest picked point (output.point is null if no point has been picked)
+		\param pickWidth_pix picking area half width (in pixels)
+		\param pickHeight_pix picking area half height (in pixels)
+		\return false if an error occurred
+	**/
 	bool pointPicking(	const CCVector2d& clickPos,
 						const ccGLCameraParameters& camera,
 						PointDescriptor& output,
-						double pickWidth_pix = 3.0) const;
+						double pickWidth_pix = 3.0,
+						double pickHeight_pix = 3.0) const;
+
+	//! Range of points (in the octree 'points and codes' container) lying in one or several consecutive cells
+	struct CellsRange
+	{
+		//! First point (index in the octree 'points and codes' container)
+		PointIndexType first;
+		//! Last point (excluded)
+		PointIndexType last;
+		//! Whether the projection of these cells is fully inside the 2D region
+		bool fullyInside;
+	};
+
+	//! Set of ranges of points
+	typedef std::vector<CellsRange> CellsRanges;
+
+	//! Returns the cells whose projection (on screen) may intersect a 2D region
+	/** Used to accelerate point picking and interactive selection (rectangle,
+		polyline, etc.). The cells are projected (8 corners) and only the cells
+		whose projection intersects the region are sub-divided further (the other
+		ones are skipped as a whole).
+		\param camera camera parameters
+		\param regionMin 2D region min corner (in pixels)
+		\param regionMax 2D region max corner (in pixels)
+		\param[out] ranges ranges of points lying in the (potentially) intersected cells (sorted)
+		\param trans optional transformation to apply to the points before projecting them
+		\param maxLevel deepest subdivision level (0 = automatic)
+		\return false if not enough memory
+	**/
+	bool getCellsInScreenRegion(const ccGLCameraParameters& camera,
+								const CCVector2d& regionMin,
+								const CCVector2d& regionMax,
+								CellsRanges& ranges,
+								const ccGLMatrix* trans = nullptr,
+								unsigned char maxLevel = 0) const;
 
 public: //HELPERS
 	
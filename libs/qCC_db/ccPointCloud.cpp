@@ -51,13 +51,202 @@
 #include <QCoreApplication>
 #include <QElapsedTimer>
 #include <QSharedPointer>
+#include <QtConcurrentMap>
 
 //system
 #include <cassert>
+#include <limits>
 #include <queue>
 
+//SIMD
+#if defined(__AVX__)
+#include <immintrin.h>
+#define CC_TRANSFORM_USE_AVX
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define CC_TRANSFORM_USE_SSE
+#endif
+
 static const char s_deviationSFName[] = "Deviation";
 
+//! Rigid transformation kernels (see ccPointCloud::applyRigidTransformation)
+namespace RigidTransformation
+{
+	//! Number of elements processed by each (parallel) task
+	static const unsigned ChunkSize = (1 << 16);
+
+	//! Calls a function on all the chunks of [0 ; count[ (in parallel if there are several chunks)
+	/** The function receives the chunk boundaries: func(first, last)
+	**/
+	template <class Function> static void ForEachChunk(PointIndexType count, const Function& func)
+	{
+		if (count <= ChunkSize)
+		{
+			func(0, count);
+			return;
+		}
+
+		std::vector< std::pair<PointIndexType, PointIndexType> > chunks;
+		try
+		{
+			chunks.reserve((count + ChunkSize - 1) / ChunkSize);
+		}
+		catch (const std::bad_alloc&)
+		{
+			//not enough memory: we process everything at once
+			func(0, count);
+			return;
+		}
+		for (PointIndexType first = 0; first < count; first += ChunkSize)
+		{
+			chunks.emplace_back(first, std::min<PointIndexType>(first + ChunkSize, count));
+		}
+
+		QtConcurrent::blockingMap(chunks, [&func](const std::pair<PointIndexType, PointIndexType>& chunk) { func(chunk.first, chunk.second); });
+	}
+
+	//! Applies a rigid transformation to a set of points (scalar version)
+	static void TransformPoints(const ccGLMatrix& trans, CCVector3* points, PointIndexType count)
+	{
+		for (PointIndexType i = 0; i < count; ++i)
+		{
+			trans.apply(points[i]);
+		}
+	}
+
+#if defined(CC_TRANSFORM_USE_SSE) || defined(CC_TRANSFORM_USE_AVX)
+	static_assert(sizeof(CCVector3f) == 3 * sizeof(float), "Unexpected CCVector3f layout");
+#endif
+
+#ifdef CC_TRANSFORM_USE_SSE
+	//! Applies a rigid transformation to 4 consecutive points (SSE version)
+	/** The points are transposed (x0y0z0x1 y1z1x2y2 z2x3y3z3 --> xxxx yyyy zzzz)
+		so that the 4 points are transformed at once.
+	**/
+	static inline void TransformPoints4_SSE(const __m128 M[12], float* p)
+	{
+		__m128 m03 = _mm_loadu_ps(p);
+		__m128 m14 = _mm_loadu_ps(p + 4);
+		__m128 m25 = _mm_loadu_ps(p + 8);
+
+		__m128 xy = _mm_shuffle_ps(m14, m25, _MM_SHUFFLE(2, 1, 3, 2));
+		__m128 yz = _mm_shuffle_ps(m03, m14, _MM_SHUFFLE(1, 0, 2, 1));
+		__m128 x = _mm_shuffle_ps(m03, xy, _MM_SHUFFLE(2, 0, 3, 0));
+		__m128 y = _mm_shuffle_ps(yz, xy, _MM_SHUFFLE(3, 1, 2, 0));
+		__m128 z = _mm_shuffle_ps(yz, m25, _MM_SHUFFLE(3, 0, 3, 1));
+
+		__m128 tx = _mm_add_ps(_mm_add_ps(_mm_mul_ps(M[0], x), _mm_mul_ps(M[3], y)), _mm_add_ps(_mm_mul_ps(M[6], z), M[9]));
+		__m128 ty = _mm_add_ps(_mm_add_ps(_mm_mul_ps(M[1], x), _mm_mul_ps(M[4], y)), _mm_add_ps(_mm_mul_ps(M[7], z), M[10]));
+		__m128 tz = _mm_add_ps(_mm_add_ps(_mm_mul_ps(M[2], x), _mm_mul_ps(M[5], y)), _mm_add_ps(_mm_mul_ps(M[8], z), M[11]));
+
+		__m128 rxy = _mm_shuffle_ps(tx, ty, _MM_SHUFFLE(2, 0, 2, 0));
+		__m128 ryz = _mm_shuffle_ps(ty, tz, _MM_SHUFFLE(3, 1, 3, 1));
+		__m128 rzx = _mm_shuffle_ps(tz, tx, _MM_SHUFFLE(3, 1, 2, 0));
+
+		_mm_storeu_ps(p, _mm_shuffle_ps(rxy, rzx, _MM_SHUFFLE(2, 0, 2, 0)));
+		_mm_storeu_ps(p + 4, _mm_shuffle_ps(ryz, rxy, _MM_SHUFFLE(3, 1, 2, 0)));
+		_mm_storeu_ps(p + 8, _mm_shuffle_ps(rzx, ryz, _MM_SHUFFLE(3, 1, 3, 1)));
+	}
+#endif
+
+#ifdef CC_TRANSFORM_USE_AVX
+	//! Applies a rigid transformation to 8 consecutive points (AVX version)
+	/** Same as TransformPoints4_SSE, on both 128 bits lanes at once.
+	**/
+	static inline void TransformPoints8_AVX(const __m256 M[12], float* p)
+	{
+		__m256 m03 = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(p)), _mm_loadu_ps(p + 12), 1);
+		__m256 m14 = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(p + 4)), _mm_loadu_ps(p + 16), 1);
+		__m256 m25 = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(p + 8)), _mm_loadu_ps(p + 20), 1);
+
+		__m256 xy = _mm256_shuffle_ps(m14, m25, _MM_SHUFFLE(2, 1, 3, 2));
+		__m256 yz = _mm256_shuffle_ps(m03, m14, _MM_SHUFFLE(1, 0, 2, 1));
+		__m256 x = _mm256_shuffle_ps(m03, xy, _MM_SHUFFLE(2, 0, 3, 0));
+		__m256 y = _mm256_shuffle_ps(yz, xy, _MM_SHUFFLE(3, 1, 2, 0));
+		__m256 z = _mm256_shuffle_ps(yz, m25, _MM_SHUFFLE(3, 0, 3, 1));
+
+		__m256 tx = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(M[0], x), _mm256_mul_ps(M[3], y)), _mm256_add_ps(_mm256_mul_ps(M[6], z), M[9]));
+		__m256 ty = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(M[1], x), _mm256_mul_ps(M[4], y)), _mm256_add_ps(_mm256_mul_ps(M[7], z), M[10]));
+		__m256 tz = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(M[2], x), _mm256_mul_ps(M[5], y)), _mm256_add_ps(_mm256_mul_ps(M[8], z), M[11]));
+
+		__m256 rxy = _mm256_shuffle_ps(tx, ty, _MM_SHUFFLE(2, 0, 2, 0));
+		__m256 ryz = _mm256_shuffle_ps(ty, tz, _MM_SHUFFLE(3, 1, 3, 1));
+		__m256 rzx = _mm256_shuffle_ps(tz, tx, _MM_SHUFFLE(3, 1, 2, 0));
+
+		__m256 r03 = _mm256_shuffle_ps(rxy, rzx, _MM_SHUFFLE(2, 0, 2, 0));
+		__m256 r14 = _mm256_shuffle_ps(ryz, rxy, _MM_SHUFFLE(3, 1, 2, 0));
+		__m256 r25 = _mm256_shuffle_ps(rzx, ryz, _MM_SHUFFLE(3, 1, 3, 1));
+
+		_mm_storeu_ps(p, _mm256_castps256_ps128(r03));
+		_mm_storeu_ps(p + 4, _mm256_castps256_ps128(r14));
+		_mm_storeu_ps(p + 8, _mm256_castps256_ps128(r25));
+		_mm_storeu_ps(p + 12, _mm256_extractf128_ps(r03, 1));
+		_mm_storeu_ps(p + 16, _mm256_extractf128_ps(r14, 1));
+		_mm_storeu_ps(p + 20, _mm256_extractf128_ps(r25, 1));
+	}
+#endif
+
+	//! Applies a rigid transformation to a set of points (vectorized when possible)
+	template <typename T> static void TransformPointsVectorized(const ccGLMatrix& trans, Vector3Tpl<T>* points, PointIndexType count)
+	{
+		//generic version (double precision coordinates)
+		TransformPoints(trans, points, count);
+	}
+
+	template <> void TransformPointsVectorized<float>(const ccGLMatrix& trans, CCVector3f* points, PointIndexType count)
+	{
+		PointIndexType i = 0;
+		const float* mat = trans.data();
+		//matrix coefficients (column major): X' = m0.x + m4.y + m8.z + m12, etc.
+		const float coefs[12] = {	mat[0], mat[1], mat[2],
+									mat[4], mat[5], mat[6],
+									mat[8], mat[9], mat[10],
+									mat[12], mat[13], mat[14] };
+
+#if defined(CC_TRANSFORM_USE_AVX)
+		{
+			__m256 M[12];
+			for (unsigned k = 0; k < 12; ++k)
+				M[k] = _mm256_set1_ps(coefs[k]);
+
+			for (; i + 8 <= count; i += 8)
+			{
+				TransformPoints8_AVX(M, points[i].u);
+			}
+		}
+#endif
+#if defined(CC_TRANSFORM_USE_SSE)
+		{
+			__m128 M[12];
+			for (unsigned k = 0; k < 12; ++k)
+				M[k] = _mm_set1_ps(coefs[k]);
+
+			for (; i + 4 <= count; i += 4)
+			{
+				TransformPoints4_SSE(M, points[i].u);
+			}
+		}
+#endif
+		(void)coefs;
+
+		//remaining points
+		TransformPoints(trans, points + i, count - i);
+	}
+
+	//! Recodes compressed normals by decoding/rotating/encoding them one by one
+	static void RecodeNormals(const ccGLMatrix& trans, CompressedNormType* normals, PointIndexType count)
+	{
+		const ccNormalVectors* normalVectors = ccNormalVectors::GetUniqueInstance();
+		for (PointIndexType i = 0; i < count; ++i)
+		{
+			CCVector3 N(normalVectors->getNormal(normals[i]));
+			trans.applyRotation(N);
+			normals[i] = ccNormalVectors::GetNormIndex(N.u);
+		}
+	}
+}
+
 ccPointCloud::ccPointCloud(QString name) throw()
 	: CCLib::PointCloudTpl<ccGenericPointCloud>()
 	, m_rgbColors(nullptr)
@@ -77,7 +266,7 @@ ccPointCloud* ccPointCloud::From(CCLib::GenericCloud* cloud, const ccGenericPoin
 {
 	ccPointCloud* pc = new ccPointCloud("Cloud");
 
-	unsigned n = cloud->size();
+	PointIndexType n = cloud->size();
 	if (n == 0)
 	{
 		ccLog::Warning("[ccPointCloud::From] Input cloud is empty!");
@@ -94,7 +283,7 @@ ccPointCloud* ccPointCloud::From(CCLib::GenericCloud* cloud, const ccGenericPoin
 		{
 			//import points
 			cloud->placeIteratorAtBeginning();
-			for (unsigned i = 0; i < n; i++)
+			for (PointIndexType i = 0; i < n; i++)
 			{
 				pc->addPoint(*cloud->getNextPoint());
 			}
@@ -113,7 +302,7 @@ ccPointCloud* ccPointCloud::From(const CCLib::GenericIndexedCloud* cloud, const
 {
 	ccPointCloud* pc = new ccPointCloud("Cloud");
 
-	unsigned n = cloud->size();
+	PointIndexType n = cloud->size();
 	if (n == 0)
 	{
 		ccLog::Warning("[ccPointCloud::From] Input cloud is empty!");
@@ -129,7 +318,7 @@ ccPointCloud* ccPointCloud::From(const CCLib::GenericIndexedCloud* cloud, const
 		else
 		{
 			//import points
-			for (unsigned i = 0; i < n; i++)
+			for (PointIndexType i = 0; i < n; i++)
 			{
 				CCVector3 P;
 				cloud->getPoint(i, P);
@@ -201,7 +390,7 @@ ccPointCloud* ccPointCloud::partialClone(const CCLib::ReferenceCloud* selection,
 	result->importParametersFrom(this);
 
 	//from now on we will need some points to proceed ;)
-	unsigned n = selection->size();
+	PointIndexType n = selection->size();
 	if (n)
 	{
 		if (!result->reserveThePointsTable(n))
@@ -213,7 +402,7 @@ ccPointCloud* ccPointCloud::partialClone(const CCLib::ReferenceCloud* selection,
 
 		//import points
 		{
-			for (unsigned i = 0; i < n; i++)
+			for (PointIndexType i = 0; i < n; i++)
 			{
 				result->addPoint(*getPointPersistentPtr(selection->getPointGlobalIndex(i)));
 			}
@@ -224,7 +413,7 @@ ccPointCloud* ccPointCloud::partialClone(const CCLib::ReferenceCloud* selection,
 		{
 			if (result->reserveTheRGBTable())
 			{
-				for (unsigned i = 0; i < n; i++)
+				for (PointIndexType i = 0; i < n; i++)
 				{
 					result->addRGBColor(getPointColor(selection->getPointGlobalIndex(i)));
 				}
@@ -243,7 +432,7 @@ ccPointCloud* ccPointCloud::partialClone(const CCLib::ReferenceCloud* selection,
 		{
 			if (result->reserveTheNormsTable())
 			{
-				for (unsigned i = 0; i < n; i++)
+				for (PointIndexType i = 0; i < n; i++)
 				{
 					result->addNormIndex(getPointNormalIndex(selection->getPointGlobalIndex(i)));
 				}
@@ -264,7 +453,7 @@ ccPointCloud* ccPointCloud::partialClone(const CCLib::ReferenceCloud* selection,
 			{
 				try
 				{
-					for (unsigned i = 0; i < n; i++)
+					for (PointIndexType i = 0; i < n; i++)
 					{
 						const ccWaveform& w = m_fwfWaveforms[selection->getPointGlobalIndex(i)];
 						if (!result->fwfDescriptors().contains(w.descriptorID()))
@@ -314,7 +503,7 @@ ccPointCloud* ccPointCloud::partialClone(const CCLib::ReferenceCloud* selection,
 							currentScalarField->setGlobalShift(sf->getGlobalShift());
 
 							//we copy data to new SF
-							for (unsigned i = 0; i < n; i++)
+							for (PointIndexType i = 0; i < n; i++)
 								currentScalarField->setValue(i, sf->getValue(selection->getPointGlobalIndex(i)));
 
 							currentScalarField->computeMinAndMax();
@@ -358,9 +547,9 @@ ccPointCloud* ccPointCloud::partialClone(const CCLib::ReferenceCloud* selection,
 				//we need a map between old and new indexes
 				std::vector<int> newIndexMap(size(), -1);
 				{
-					for (unsigned i = 0; i < n; i++)
+					for (PointIndexType i = 0; i < n; i++)
 					{
-						newIndexMap[selection->getPointGlobalIndex(i)] = i;
+						newIndexMap[selection->getPointGlobalIndex(i)] = static_cast<int>(i);
 					}
 				}
 
@@ -511,11 +700,11 @@ const ccPointCloud& ccPointCloud::operator +=(ccPointCloud* addedCloud)
 	return append(addedCloud, size());
 }
 
-const ccPointCloud& ccPointCloud::append(ccPointCloud* addedCloud, unsigned pointCountBefore, bool ignoreChildren/*=false*/)
+const ccPointCloud& ccPointCloud::append(ccPointCloud* addedCloud, PointIndexType pointCountBefore, bool ignoreChildren/*=false*/)
 {
 	assert(addedCloud);
 
-	unsigned addedPoints = addedCloud->size();
+	PointIndexType addedPoints = addedCloud->size();
 
 	if (!reserve(pointCountBefore + addedPoints))
 	{
@@ -530,13 +719,19 @@ const ccPointCloud& ccPointCloud::append(ccPointCloud* addedCloud, unsigned poin
 	if (size() == pointCountBefore) //in some cases points have already been copied! (ok it's tricky)
 	{
 		//we remove structures that are not compatible with fusion process
-		deleteOctree();
 		unallocateVisibilityArray();
 
-		for (unsigned i = 0; i < addedPoints; i++)
+		for (PointIndexType i = 0; i < addedPoints; i++)
 		{
 			addPoint(*addedCloud->getPoint(i));
 		}
+
+		//the octree (if any) is updated incrementally
+		ccOctree::Shared octree = getOctree();
+		if (octree && octree->appendPoints(pointCountBefore) <= 0)
+		{
+			deleteOctree();
+		}
 	}
 
 	//deprecate internal structures
@@ -552,7 +747,7 @@ const ccPointCloud& ccPointCloud::append(ccPointCloud* addedCloud, unsigned poin
 		if (!addedCloud->hasColors())
 		{
 			//we set a white color to new points
-			for (unsigned i = 0; i < addedPoints; i++)
+			for (PointIndexType i = 0; i < addedPoints; i++)
 			{
 				addRGBColor(ccColor::white);
 			}
@@ -565,7 +760,7 @@ const ccPointCloud& ccPointCloud::append(ccPointCloud* addedCloud, unsigned poin
 				//we try to reserve a new array
 				if (reserveTheRGBTable())
 				{
-					for (unsigned i = 0; i < pointCountBefore; i++)
+					for (PointIndexType i = 0; i < pointCountBefore; i++)
 					{
 						addRGBColor(ccColor::white);
 					}
@@ -580,7 +775,7 @@ const ccPointCloud& ccPointCloud::append(ccPointCloud* addedCloud, unsigned poin
 			//we import colors (if necessary)
 			if (hasColors() && m_rgbColors->currentSize() == pointCountBefore)
 			{
-				for (unsigned i = 0; i < addedPoints; i++)
+				for (PointIndexType i = 0; i < addedPoints; i++)
 				{
 					addRGBColor(addedCloud->m_rgbColors->getValue(i));
 				}
@@ -598,7 +793,7 @@ const ccPointCloud& ccPointCloud::append(ccPointCloud* addedCloud, unsigned poin
 		if (!addedCloud->hasNormals())
 		{
 			//we associate imported points with '0' normals
-			for (unsigned i = 0; i < addedPoints; i++)
+			for (PointIndexType i = 0; i < addedPoints; i++)
 			{
 				addNormIndex(0);
 			}
@@ -611,7 +806,7 @@ const ccPointCloud& ccPointCloud::append(ccPointCloud* addedCloud, unsigned poin
 				//we try to reserve a new array
 				if (reserveTheNormsTable())
 				{
-					for (unsigned i = 0; i < pointCountBefore; i++)
+					for (PointIndexType i = 0; i < pointCountBefore; i++)
 					{
 						addNormIndex(0);
 					}
@@ -626,7 +821,7 @@ const ccPointCloud& ccPointCloud::append(ccPointCloud* addedCloud, unsigned poin
 			//we import normals (if necessary)
 			if (hasNormals() && m_normals->currentSize() == pointCountBefore)
 			{
-				for (unsigned i = 0; i < addedPoints; i++)
+				for (PointIndexType i = 0; i < addedPoints; i++)
 				{
 					addNormIndex(addedCloud->m_normals->getValue(i));
 				}
@@ -641,7 +836,7 @@ const ccPointCloud& ccPointCloud::append(ccPointCloud* addedCloud, unsigned poin
 		if (!addedCloud->hasFWF())
 		{
 			//we associate imported points with empty waveform
-			for (unsigned i = 0; i < addedPoints; i++)
+			for (PointIndexType i = 0; i < addedPoints; i++)
 			{
 				m_fwfWaveforms.emplace_back(0);
 			}
@@ -656,7 +851,7 @@ const ccPointCloud& ccPointCloud::append(ccPointCloud* addedCloud, unsigned poin
 				//we try to reserve a new array
 				if (reserveTheFWFTable())
 				{
-					for (unsigned i = 0; i < pointCountBefore; i++)
+					for (PointIndexType i = 0; i < pointCountBefore; i++)
 					{
 						m_fwfWaveforms.emplace_back(0);
 					}
@@ -757,7 +952,7 @@ const ccPointCloud& ccPointCloud::append(ccPointCloud* addedCloud, unsigned poin
 				//and now import waveforms
 				if (success && m_fwfWaveforms.size() == pointCountBefore)
 				{
-					for (unsigned i = 0; i < addedPoints; i++)
+					for (PointIndexType i = 0; i < addedPoints; i++)
 					{
 						ccWaveform w = addedCloud->waveforms()[i];
 						if (descriptorIDMap.contains(w.descriptorID())) //the waveform can be imported :)
@@ -808,7 +1003,7 @@ const ccPointCloud& ccPointCloud::append(ccPointCloud* addedCloud, unsigned poin
 					if (sameSF->currentSize() == pointCountBefore)
 					{
 						double shift = sf->getGlobalShift() - sameSF->getGlobalShift();
-						for (unsigned i = 0; i < addedPoints; i++)
+						for (PointIndexType i = 0; i < addedPoints; i++)
 						{
 							sameSF->addElement(static_cast<ScalarType>(shift + sf->getValue(i))); //FIXME: we could have accuracy issues here
 						}
@@ -827,7 +1022,7 @@ const ccPointCloud& ccPointCloud::append(ccPointCloud* addedCloud, unsigned poin
 					if (newSF->resizeSafe(pointCountBefore + addedPoints, true, NAN_VALUE))
 					{
 						//we copy the new values
-						for (unsigned i = 0; i < addedPoints; i++)
+						for (PointIndexType i = 0; i < addedPoints; i++)
 						{
 							newSF->setValue(pointCountBefore + i, sf->getValue(i));
 						}
@@ -861,7 +1056,7 @@ const ccPointCloud& ccPointCloud::append(ccPointCloud* addedCloud, unsigned poin
 				{
 					//we fill the end with NaN (as there is no equivalent in the added cloud)
 					ScalarType NaN = sf->NaN();
-					for (unsigned i = 0; i < addedPoints; i++)
+					for (PointIndexType i = 0; i < addedPoints; i++)
 					{
 						sf->addElement(NaN);
 					}
@@ -1088,7 +1283,7 @@ void ccPointCloud::unallocateColors()
 	enableTempColor(false);
 }
 
-bool ccPointCloud::reserveThePointsTable(unsigned newNumberOfPoints)
+bool ccPointCloud::reserveThePointsTable(PointIndexType newNumberOfPoints)
 {
 	try
 	{
@@ -1323,7 +1518,7 @@ bool ccPointCloud::hasFWF() const
 			&&	!m_fwfWaveforms.empty();
 }
 
-ccWaveformProxy ccPointCloud::waveformProxy(unsigned index) const
+ccWaveformProxy ccPointCloud::waveformProxy(PointIndexType index) const
 {
 	static const ccWaveform invalidW;
 	static const WaveformDescriptor invalidD;
@@ -1373,7 +1568,7 @@ bool ccPointCloud::resizeTheFWFTable()
 	return m_fwfWaveforms.capacity() >= m_points.capacity();
 }
 
-bool ccPointCloud::reserve(unsigned newNumberOfPoints)
+bool ccPointCloud::reserve(PointIndexType newNumberOfPoints)
 {
 	//reserve works only to enlarge the cloud
 	if (newNumberOfPoints < size())
@@ -1398,7 +1593,7 @@ bool ccPointCloud::reserve(unsigned newNumberOfPoints)
 		&&	( !hasFWF()     || m_fwfWaveforms.capacity() >= newNumberOfPoints );
 }
 
-bool ccPointCloud::resize(unsigned newNumberOfPoints)
+bool ccPointCloud::resize(PointIndexType newNumberOfPoints)
 {
 	//can't reduce the size if the cloud if it is locked!
 	if (newNumberOfPoints < size() && isLocked())
@@ -1423,8 +1618,8 @@ bool ccPointCloud::resize(unsigned newNumberOfPoints)
 
 	//double check
 	return	                   m_points.size()            == newNumberOfPoints
-		&&	( !hasColors()  || m_rgbColors->currentSize() == newNumberOfPoints )
-		&&	( !hasNormals() || m_normals->currentSize()   == newNumberOfPoints )
+		&&	( !hasColors()  || m_rgbColors->size()        == newNumberOfPoints )
+		&&	( !hasNormals() || m_normals->size()          == newNumberOfPoints )
 		&&	( !hasFWF()     || m_fwfWaveforms.size()      == newNumberOfPoints );
 }
 
@@ -1438,7 +1633,7 @@ bool ccPointCloud::sfColorScaleShown() const
 	return m_sfColorScaleDisplayed;
 }
 
-const ccColor::Rgb* ccPointCloud::getPointScalarValueColor(unsigned pointIndex) const
+const ccColor::Rgb* ccPointCloud::getPointScalarValueColor(PointIndexType pointIndex) const
 {
 	assert(m_currentDisplayedScalarField && m_currentDisplayedScalarField->getColorScale());
 
@@ -1452,7 +1647,7 @@ const ccColor::Rgb* ccPointCloud::geScalarValueColor(ScalarType d) const
 	return m_currentDisplayedScalarField->getColor(d);
 }
 
-ScalarType ccPointCloud::getPointDisplayedDistance(unsigned pointIndex) const
+ScalarType ccPointCloud::getPointDisplayedDistance(PointIndexType pointIndex) const
 {
 	assert(m_currentDisplayedScalarField);
 	assert(pointIndex<m_currentDisplayedScalarField->currentSize());
@@ -1460,7 +1655,7 @@ ScalarType ccPointCloud::getPointDisplayedDistance(unsigned pointIndex) const
 	return m_currentDisplayedScalarField->getValue(pointIndex);
 }
 
-const ccColor::Rgb& ccPointCloud::getPointColor(unsigned pointIndex) const
+const ccColor::Rgb& ccPointCloud::getPointColor(PointIndexType pointIndex) const
 {
 	assert(hasColors());
 	assert(m_rgbColors && pointIndex < m_rgbColors->currentSize());
@@ -1468,21 +1663,21 @@ const ccColor::Rgb& ccPointCloud::getPointColor(unsigned pointIndex) const
 	return m_rgbColors->at(pointIndex);
 }
 
-const CompressedNormType& ccPointCloud::getPointNormalIndex(unsigned pointIndex) const
+const CompressedNormType& ccPointCloud::getPointNormalIndex(PointIndexType pointIndex) const
 {
 	assert(m_normals && pointIndex < m_normals->currentSize());
 
 	return m_normals->getValue(pointIndex);
 }
 
-const CCVector3& ccPointCloud::getPointNormal(unsigned pointIndex) const
+const CCVector3& ccPointCloud::getPointNormal(PointIndexType pointIndex) const
 {
 	assert(m_normals && pointIndex < m_normals->currentSize());
 
 	return ccNormalVectors::GetNormal(m_normals->getValue(pointIndex));
 }
 
-void ccPointCloud::setPointColor(unsigned pointIndex, const ccColor::Rgb& col)
+void ccPointCloud::setPointColor(PointIndexType pointIndex, const ccColor::Rgb& col)
 {
 	assert(m_rgbColors && pointIndex < m_rgbColors->currentSize());
 
@@ -1492,7 +1687,7 @@ void ccPointCloud::setPointColor(unsigned pointIndex, const ccColor::Rgb& col)
 	colorsHaveChanged();
 }
 
-void ccPointCloud::setPointNormalIndex(unsigned pointIndex, CompressedNormType norm)
+void ccPointCloud::setPointNormalIndex(PointIndexType pointIndex, CompressedNormType norm)
 {
 	assert(m_normals && pointIndex < m_normals->currentSize());
 
@@ -1502,7 +1697,7 @@ void ccPointCloud::setPointNormalIndex(unsigned pointIndex, CompressedNormType n
 	normalsHaveChanged();
 }
 
-void ccPointCloud::setPointNormal(unsigned pointIndex, const CCVector3& N)
+void ccPointCloud::setPointNormal(PointIndexType pointIndex, const CCVector3& N)
 {
 	setPointNormalIndex(pointIndex, ccNormalVectors::GetNormIndex(N));
 }
@@ -1554,7 +1749,7 @@ void ccPointCloud::addNormIndex(CompressedNormType index)
 	m_normals->addElement(index);
 }
 
-void ccPointCloud::addNormAtIndex(const PointCoordinateType* N, unsigned index)
+void ccPointCloud::addNormAtIndex(const PointCoordinateType* N, PointIndexType index)
 {
 	assert(m_normals && m_normals->isAllocated());
 	//we get the real normal vector corresponding to current index
@@ -1589,8 +1784,8 @@ bool ccPointCloud::convertNormalToRGB()
 	}
 	assert(m_normals && m_rgbColors);
 
-	unsigned count = size();
-	for (unsigned i = 0; i < count; ++i)
+	PointIndexType count = size();
+	for (PointIndexType i = 0; i < count; ++i)
 	{
 		const ccColor::Rgb& rgb = normalHSV[m_normals->getValue(i)];
 		m_rgbColors->setValue(i, rgb);
@@ -1610,8 +1805,8 @@ bool ccPointCloud::convertRGBToGreyScale()
 	}
 	assert(m_rgbColors);
 
-	unsigned count = size();
-	for (unsigned i = 0; i < count; ++i)
+	PointIndexType count = size();
+	for (PointIndexType i = 0; i < count; ++i)
 	{
 		ccColor::Rgb& rgb = m_rgbColors->at(i);
 		//conversion from RGB to grey scale (see https://en.wikipedia.org/wiki/Luma_%28video%29)
@@ -1640,8 +1835,8 @@ bool ccPointCloud::convertNormalToDipDirSFs(ccScalarField* dipSF, ccScalarField*
 		return false;
 	}
 
-	unsigned count = size();
-	for (unsigned i = 0; i < count; ++i)
+	PointIndexType count = size();
+	for (PointIndexType i = 0; i < count; ++i)
 	{
 		CCVector3 N(this->getPointNormal(i));
 		PointCoordinateType dip, dipDir;
@@ -1685,7 +1880,7 @@ bool ccPointCloud::colorize(float r, float g, float b)
 	if (hasColors())
 	{
 		assert(m_rgbColors);
-		for (unsigned i = 0; i < m_rgbColors->currentSize(); i++)
+		for (PointIndexType i = 0; i < m_rgbColors->currentSize(); i++)
 		{
 			ccColor::Rgb& p = m_rgbColors->at(i);
 			{
@@ -1731,8 +1926,8 @@ bool ccPointCloud::setRGBColorByBanding(unsigned char dim, double freq)
 
 	float bands = (2.0 * M_PI) / freq;
 
-	unsigned count = size();
-	for (unsigned i = 0; i < count; i++)
+	PointIndexType count = size();
+	for (PointIndexType i = 0; i < count; i++)
 	{
 		const CCVector3* P = getPoint(i);
 
@@ -1774,8 +1969,8 @@ bool ccPointCloud::setRGBColorByHeight(unsigned char heightDim, ccColorScale::Sh
 		return setRGBColor(col);
 	}
 
-	unsigned count = size();
-	for (unsigned i = 0; i < count; i++)
+	PointIndexType count = size();
+	for (PointIndexType i = 0; i < count; i++)
 	{
 		const CCVector3* Q = getPoint(i);
 		double realtivePos = (Q->u[heightDim] - minHeight) / height;
@@ -1836,36 +2031,60 @@ void ccPointCloud::applyRigidTransformation(const ccGLMatrix& trans)
 	//transparent call
 	ccGenericPointCloud::applyGLTransformation(trans);
 
-	unsigned count = size();
-	for (unsigned i = 0; i < count; i++)
+	//the points are transformed by chunks (in parallel, and with SIMD instructions if available)
+	PointIndexType count = size();
+	if (count != 0)
 	{
-		trans.apply(*point(i));
+		CCVector3* points = &m_points.front();
+		RigidTransformation::ForEachChunk(count, [&](PointIndexType first, PointIndexType last)
+		{
+			RigidTransformation::TransformPointsVectorized(trans, points + first, last - first);
+		});
 	}
 
 	//we must also take care of the normals!
 	if (hasNormals())
 	{
 		bool recoded = false;
+		CompressedNormType* normals = m_normals->data();
+		PointIndexType normalCount = static_cast<PointIndexType>(m_normals->size());
 
 		//if there is more points than the size of the compressed normals array,
 		//we recompress the array instead of recompressing each normal
-		if (count > ccNormalVectors::GetNumberOfVectors())
+		//(both cost roughly one compression per element, but the table lookup
+		//doesn't depend on the number of points)
+		unsigned tableSize = ccNormalVectors::GetNumberOfVectors();
+		if (normalCount > tableSize)
 		{
-			NormsIndexesTableType newNorms;
-			if (newNorms.reserveSafe(ccNormalVectors::GetNumberOfVectors()))
+			std::vector<CompressedNormType> newNorms;
+			try
 			{
-				for (unsigned i = 0; i < ccNormalVectors::GetNumberOfVectors(); i++)
+				newNorms.resize(tableSize);
+			}
+			catch (const std::bad_alloc&)
+			{
+				//not enough memory: we'll recode each normal
+			}
+
+			if (!newNorms.empty())
+			{
+				CompressedNormType* table = newNorms.data();
+				RigidTransformation::ForEachChunk(tableSize, [&](PointIndexType first, PointIndexType last)
 				{
-					CCVector3 new_n(ccNormalVectors::GetNormal(i));
-					trans.applyRotation(new_n);
-					CompressedNormType newNormIndex = ccNormalVectors::GetNormIndex(new_n.u);
-					newNorms.emplace_back(newNormIndex);
-				}
+					for (PointIndexType i = first; i < last; ++i)
+					{
+						table[i] = static_cast<CompressedNormType>(i);
+					}
+					RigidTransformation::RecodeNormals(trans, table + first, last - first);
+				});
 
-				for (unsigned j = 0; j < count; j++)
+				RigidTransformation::ForEachChunk(normalCount, [&](PointIndexType first, PointIndexType last)
 				{
-					m_normals->setValue(j, newNorms[m_normals->at(j)]);
-				}
+					for (PointIndexType i = first; i < last; ++i)
+					{
+						normals[i] = table[normals[i]];
+					}
+				});
 				recoded = true;
 			}
 		}
@@ -1875,13 +2094,10 @@ void ccPointCloud::applyRigidTransformation(const ccGLMatrix& trans)
 		//array), we recompress each normal ...
 		if (!recoded)
 		{
-			//on recode direct chaque normale
-			for (CompressedNormType& _theNormIndex : *m_normals)
+			RigidTransformation::ForEachChunk(normalCount, [&](PointIndexType first, PointIndexType last)
 			{
-				CCVector3 new_n(ccNormalVectors::GetNormal(_theNormIndex));
-				trans.applyRotation(new_n);
-				_theNormIndex = ccNormalVectors::GetNormIndex(new_n.u);
-			}
+				RigidTransformation::RecodeNormals(trans, normals + first, last - first);
+			});
 		}
 	}
 
@@ -1901,12 +2117,19 @@ void ccPointCloud::applyRigidTransformation(const ccGLMatrix& trans)
 	}
 
 	//and the waveform!
-	for (ccWaveform& w : m_fwfWaveforms)
+	if (!m_fwfWaveforms.empty())
 	{
-		if (w.descriptorID() != 0)
+		ccWaveform* waveforms = m_fwfWaveforms.data();
+		RigidTransformation::ForEachChunk(static_cast<PointIndexType>(m_fwfWaveforms.size()), [&](PointIndexType first, PointIndexType last)
 		{
-			w.applyRigidTransformation(trans);
-		}
+			for (PointIndexType i = first; i < last; ++i)
+			{
+				if (waveforms[i].descriptorID() != 0)
+				{
+					waveforms[i].applyRigidTransformation(trans);
+				}
+			}
+		});
 	}
 
 	//the octree is invalidated by rotation...
@@ -1921,9 +2144,9 @@ void ccPointCloud::translate(const CCVector3& T)
 	if (fabs(T.x) + fabs(T.y) + fabs(T.z) < ZERO_TOLERANCE)
 		return;
 
-	unsigned count = size();
+	PointIndexType count = size();
 	{
-		for (unsigned i = 0; i < count; i++)
+		for (PointIndexType i = 0; i < count; i++)
 			*point(i) += T;
 	}
 
@@ -1959,8 +2182,8 @@ void ccPointCloud::scale(PointCoordinateType fx, PointCoordinateType fy, PointCo
 {
 	//transform the points
 	{
-		unsigned count = size();
-		for (unsigned i = 0; i < count; i++)
+		PointIndexType count = size();
+		for (PointIndexType i = 0; i < count; i++)
 		{
 			CCVector3* P = point(i);
 			P->x = (P->x - center.x) * fx + center.x;
@@ -2087,7 +2310,7 @@ void ccPointCloud::invertNormals()
 	normalsHaveChanged();
 }
 
-void ccPointCloud::swapPoints(unsigned firstIndex, unsigned secondIndex)
+void ccPointCloud::swapPoints(PointIndexType firstIndex, PointIndexType secondIndex)
 {
 	assert(!isLocked());
 	assert(firstIndex < size() && secondIndex < size());
@@ -2204,6 +2427,8 @@ static PointCoordinateType s_pointBuffer [MAX_POINT_COUNT_PER_LOD_RENDER_PASS *
 static PointCoordinateType s_normalBuffer[MAX_POINT_COUNT_PER_LOD_RENDER_PASS * 3];
 static ColorCompType       s_rgbBuffer3ub[MAX_POINT_COUNT_PER_LOD_RENDER_PASS * 3];
 static float               s_rgbBuffer3f [MAX_POINT_COUNT_PER_LOD_RENDER_PASS * 3];
+//the RGB buffer is also used as a ccColor::Rgb array (see ccScalarField::convertToColors)
+static_assert(sizeof(ccColor::Rgb) == 3 * sizeof(ColorCompType), "Unexpected RGB color size");
 
 void ccPointCloud::glChunkNormalPointer(const CC_DRAW_CONTEXT& context, size_t chunkIndex, unsigned decimStep, bool useVBOs)
 {
@@ -2339,18 +2564,9 @@ void ccPointCloud::glChunkSFPointer(const CC_DRAW_CONTEXT& context, size_t chunk
 	else if (m_currentDisplayedScalarField)
 	{
 		//we must convert the scalar values to RGB colors in a dedicated static array
-		ScalarType* _sf = ccChunk::Start(*m_currentDisplayedScalarField, chunkIndex);
-		ColorCompType* _sfColors = s_rgbBuffer3ub;
+		const ScalarType* _sf = ccChunk::Start(*m_currentDisplayedScalarField, chunkIndex);
 		size_t chunkSize = ccChunk::Size(chunkIndex, m_currentDisplayedScalarField->size());
-		for (size_t j = 0; j < chunkSize; j += decimStep, _sf += decimStep)
-		{
-			//convert the scalar value to a RGB color
-			const ccColor::Rgb* col = m_currentDisplayedScalarField->getColor(*_sf);
-			assert(col);
-			*_sfColors++ = col->r;
-			*_sfColors++ = col->g;
-			*_sfColors++ = col->b;
-		}
+		m_currentDisplayedScalarField->convertToColors(_sf, chunkSize, reinterpret_cast<ccColor::Rgb*>(s_rgbBuffer3ub), decimStep);
 		glFunc->glColorPointer(3, GL_UNSIGNED_BYTE, 0, s_rgbBuffer3ub);
 	}
 }
@@ -2454,6 +2670,89 @@ template <class QOpenGLFunctions> void glLODChunkSFPointer(	ccScalarField* sf,
 	glFunc->glColorPointer(3, GL_UNSIGNED_BYTE, 0, s_rgbBuffer3ub);
 }
 
+//! Calls a function on each piece of a set of ranges of points, split by chunks (LoD display of sorted clouds)
+/** \param ranges ranges of contiguous points
+	\param newChunkFunc function called as newChunkFunc(chunkIndex) each time the chunk changes
+	\param drawFunc function called as drawFunc(chunkIndex, firstIndexInChunk, count) on each piece of range
+**/
+template <class NewChunkFunction, class DrawFunction> static void ForEachRangeInChunks(const LODRangeSet& ranges, NewChunkFunction&& newChunkFunc, DrawFunction&& drawFunc)
+{
+	size_t currentChunkIndex = 0;
+	bool noChunkYet = true;
+	for (const LODLevelDesc& range : ranges)
+	{
+		unsigned startIndex = range.startIndex;
+		unsigned remaining = range.count;
+		while (remaining != 0)
+		{
+			size_t chunkIndex = (startIndex >> ccChunk::SIZE_POWER);
+			unsigned firstIndexInChunk = startIndex - static_cast<unsigned>(ccChunk::StartPos(chunkIndex));
+			unsigned count = std::min(remaining, static_cast<unsigned>(ccChunk::SIZE) - firstIndexInChunk);
+			if (noChunkYet || chunkIndex != currentChunkIndex)
+			{
+				newChunkFunc(chunkIndex);
+				currentChunkIndex = chunkIndex;
+				noChunkYet = false;
+			}
+			drawFunc(chunkIndex, firstIndexInChunk, count);
+			startIndex += count;
+			remaining -= count;
+		}
+	}
+}
+
+//! Decodes the normals of a piece of chunk (at the same position in the static buffer)
+static void DecodeChunkNormals(NormsIndexesTableType* normals, size_t chunkIndex, unsigned firstIndexInChunk, unsigned count)
+{
+	assert(normals);
+	
+	//compressed normals set
+	const ccNormalVectors* compressedNormals = ccNormalVectors::GetUniqueInstance();
+	assert(compressedNormals);
+
+	const CompressedNormType* _normalsIndexes = ccChunk::Start(*normals, chunkIndex) + firstIndexInChunk;
+	PointCoordinateType* _normals = s_normalBuffer + 3 * firstIndexInChunk;
+	for (unsigned j = 0; j < count; ++j, ++_normalsIndexes)
+	{
+		const CCVector3& N = compressedNormals->getNormal(*_normalsIndexes);
+		*(_normals)++ = N.x;
+		*(_normals)++ = N.y;
+		*(_normals)++ = N.z;
+	}
+}
+
+//! Converts the scalar values of a piece of chunk to RGB colors (at the same position in the static buffer)
+static void ConvertChunkSFColors(ccScalarField* sf, size_t chunkIndex, unsigned firstIndexInChunk, unsigned count)
+{
+	assert(sf);
+	assert(sizeof(ColorCompType) == 1);
+
+	const ScalarType* _sf = ccChunk::Start(*sf, chunkIndex) + firstIndexInChunk;
+	sf->convertToColors(_sf, count, reinterpret_cast<ccColor::Rgb*>(s_rgbBuffer3ub) + firstIndexInChunk);
+}
+
+//! Converts the scalar values of a piece of chunk to color ramp shader inputs (at the same position in the static buffer)
+static void ConvertChunkSFRampValues(ccScalarField* sf, size_t chunkIndex, unsigned firstIndexInChunk, unsigned count)
+{
+	assert(sf);
+
+	const ccScalarField::Range& sfDisplayRange = sf->displayRange();
+	const ccScalarField::Range& sfSaturationRange = sf->saturationRange();
+	bool symScale = sf->symmetricalScale();
+
+	const ScalarType* _sf = ccChunk::Start(*sf, chunkIndex) + firstIndexInChunk;
+	float* _sfColors = s_rgbBuffer3f + 3 * firstIndexInChunk;
+	for (unsigned j = 0; j < count; ++j, ++_sf, _sfColors += 3)
+	{
+		//normalized sf value
+		_sfColors[0] = symScale ? GetSymmetricalNormalizedValue(*_sf, sfSaturationRange) : GetNormalizedValue(*_sf, sfDisplayRange);
+		//flag: whether point is grayed out or not (NaN values are also rejected!)
+		_sfColors[1] = sfDisplayRange.isInRange(*_sf) ? 1.0f : 0.0f;
+		//reference value (to get the true lighting value)
+		_sfColors[2] = 1.0f;
+	}
+}
+
 //description of the (sub)set of points to display
 struct DisplayDesc : LODLevelDesc
 {
@@ -2463,6 +2762,7 @@ struct DisplayDesc : LODLevelDesc
 		, endIndex(0)
 		, decimStep(1)
 		, indexMap(nullptr)
+		, rangeMap(nullptr)
 	{}
 
 	//! Constructor from a start index and a count value
@@ -2471,6 +2771,7 @@ struct DisplayDesc : LODLevelDesc
 		, endIndex(startIndex+count)
 		, decimStep(1)
 		, indexMap(nullptr)
+		, rangeMap(nullptr)
 	{}
 
 	//! Set operator
@@ -2490,6 +2791,9 @@ struct DisplayDesc : LODLevelDesc
 
 	//! Map of indexes (to invert the natural order)
 	LODIndexSet* indexMap;
+
+	//! Map of ranges of points (when the points are sorted in the LoD order)
+	LODRangeSet* rangeMap;
 };
 
 void ccPointCloud::drawMeOnly(CC_DRAW_CONTEXT& context)
@@ -2594,16 +2898,38 @@ void ccPointCloud::drawMeOnly(CC_DRAW_CONTEXT& context)
 							unsigned remainingPointsAtThisLevel = 0;
 							toDisplay.startIndex = 0;
 							toDisplay.count = MAX_POINT_COUNT_PER_LOD_RENDER_PASS;
-							toDisplay.indexMap = &m_lod->getIndexMap(context.currentLODLevel, toDisplay.count, remainingPointsAtThisLevel);
-							if (toDisplay.count == 0)
+
+							//if the points are sorted in the LoD order, we can draw them directly by ranges
+							//(except if we have to test each point visibility)
+							bool useRanges = (		m_lod->hasOrderedLayout()
+												&&	!isVisibilityTableInstantiated()
+												&&	!(glParams.showSF && m_currentDisplayedScalarField->mayHaveHiddenValues()) );
+							if (useRanges)
 							{
-								//nothing to draw at this level
-								toDisplay.indexMap = nullptr;
+								toDisplay.rangeMap = &m_lod->getRangeMap(context.currentLODLevel, toDisplay.count, remainingPointsAtThisLevel);
+								if (toDisplay.count == 0)
+								{
+									//nothing to draw at this level
+									toDisplay.rangeMap = nullptr;
+								}
+								else
+								{
+									toDisplay.endIndex = toDisplay.startIndex + toDisplay.count;
+								}
 							}
 							else
 							{
-								assert(toDisplay.count == toDisplay.indexMap->size());
-								toDisplay.endIndex = toDisplay.startIndex + toDisplay.count;
+								toDisplay.indexMap = &m_lod->getIndexMap(context.currentLODLevel, toDisplay.count, remainingPointsAtThisLevel);
+								if (toDisplay.count == 0)
+								{
+									//nothing to draw at this level
+									toDisplay.indexMap = nullptr;
+								}
+								else
+								{
+									assert(toDisplay.count == toDisplay.indexMap->size());
+									toDisplay.endIndex = toDisplay.startIndex + toDisplay.count;
+								}
 							}
 
 							//could we draw more points at the next level?
@@ -2613,7 +2939,7 @@ void ccPointCloud::drawMeOnly(CC_DRAW_CONTEXT& context)
 					}
 				}
 
-				if (!toDisplay.indexMap && !skipLoD)
+				if (!toDisplay.indexMap && !toDisplay.rangeMap && !skipLoD)
 				{
 					//if we don't have a LoD map, we can only display points at level 0!
 					if (context.currentLODLevel != 0)
@@ -2747,7 +3073,7 @@ void ccPointCloud::drawMeOnly(CC_DRAW_CONTEXT& context)
 
 				//whether VBOs are available (for faster display) or not
 				bool useVBOs = false;
-				if (!hiddenPoints && context.useVBOs && !toDisplay.indexMap) //VBOs are not compatible with LoD
+				if (!hiddenPoints && context.useVBOs && !toDisplay.indexMap) //VBOs are not compatible with LoD (except with ranges)
 				{
 					//can't use VBOs if some points are hidden
 					useVBOs = updateVBOs(context, glParams);
@@ -2903,6 +3229,44 @@ void ccPointCloud::drawMeOnly(CC_DRAW_CONTEXT& context)
 							s = e;
 						}
 					}
+					else if (toDisplay.rangeMap) //LoD display (sorted points)
+					{
+						ForEachRangeInChunks(*toDisplay.rangeMap,
+							[&](size_t k)
+							{
+								//points
+								glChunkVertexPointer(context, k, 1, useVBOs);
+								//normals
+								if (glParams.showNorms)
+								{
+									if (useVBOs)
+										glChunkNormalPointer(context, k, 1, true);
+									else
+										glFunc->glNormalPointer(GL_COORD_TYPE, 0, s_normalBuffer);
+								}
+								//SF colors
+								if (colorRampShader)
+									glFunc->glColorPointer(3, GL_FLOAT, 0, s_rgbBuffer3f);
+								else if (useVBOs)
+									glChunkSFPointer(context, k, 1, true);
+								else
+									glFunc->glColorPointer(3, GL_UNSIGNED_BYTE, 0, s_rgbBuffer3ub);
+							},
+							[&](size_t k, unsigned firstIndexInChunk, unsigned count)
+							{
+								if (!useVBOs)
+								{
+									//we only convert the values of the displayed points
+									if (glParams.showNorms)
+										DecodeChunkNormals(m_normals, k, firstIndexInChunk, count);
+									if (colorRampShader)
+										ConvertChunkSFRampValues(m_currentDisplayedScalarField, k, firstIndexInChunk, count);
+									else
+										ConvertChunkSFColors(m_currentDisplayedScalarField, k, firstIndexInChunk, count);
+								}
+								glFunc->glDrawArrays(GL_POINTS, static_cast<GLint>(firstIndexInChunk), static_cast<GLsizei>(count));
+							});
+					}
 					else
 					{
 						size_t chunkCount = ccChunk::Count(m_points);
@@ -3076,7 +3440,7 @@ void ccPointCloud::drawMeOnly(CC_DRAW_CONTEXT& context)
 			}
 			else //no visibility table enabled, no scalar field
 			{
-				bool useVBOs = context.useVBOs && !toDisplay.indexMap ? updateVBOs(context, glParams) : false; //VBOs are not compatible with LoD
+				bool useVBOs = context.useVBOs && !toDisplay.indexMap ? updateVBOs(context, glParams) : false; //VBOs are not compatible with LoD (except with ranges)
 
 				size_t chunkCount = ccChunk::Count(m_points);
 
@@ -3107,6 +3471,35 @@ void ccPointCloud::drawMeOnly(CC_DRAW_CONTEXT& context)
 						s = e;
 					}
 				}
+				else if (toDisplay.rangeMap) //LoD display (sorted points)
+				{
+					ForEachRangeInChunks(*toDisplay.rangeMap,
+						[&](size_t k)
+						{
+							//points
+							glChunkVertexPointer(context, k, 1, useVBOs);
+							//normals
+							if (glParams.showNorms)
+							{
+								if (useVBOs)
+									glChunkNormalPointer(context, k, 1, true);
+								else
+									glFunc->glNormalPointer(GL_COORD_TYPE, 0, s_normalBuffer);
+							}
+							//colors
+							if (glParams.showColors)
+								glChunkColorPointer(context, k, 1, useVBOs);
+						},
+						[&](size_t k, unsigned firstIndexInChunk, unsigned count)
+						{
+							if (glParams.showNorms && !useVBOs)
+							{
+								//we only decode the normals of the displayed points
+								DecodeChunkNormals(m_normals, k, firstIndexInChunk, count);
+							}
+							glFunc->glDrawArrays(GL_POINTS, static_cast<GLint>(firstIndexInChunk), static_cast<GLsizei>(count));
+						});
+				}
 				else
 				{
 					for (size_t k = 0; k < chunkCount; ++k)
@@ -3218,8 +3611,8 @@ void ccPointCloud::hidePointsByScalarValue(ScalarType minVal, ScalarType maxVal)
 	}
 
 	//we use the visibility table to tag the points to filter out
-	unsigned count = size();
-	for (unsigned i = 0; i < count; ++i)
+	PointIndexType count = size();
+	for (PointIndexType i = 0; i < count; ++i)
 	{
 		const ScalarType& val = sf->getValue(i);
 		if (val < minVal || val > maxVal || val != val) //handle NaN values!
@@ -3284,19 +3677,19 @@ ccGenericPointCloud* ccPointCloud::createNewCloudFromVisibilitySelection(bool re
 		deleteOctree();
 		clearLOD();
 
-		unsigned count = size();
+		PointIndexType count = size();
 
 		//we have to take care of scan grids first
 		{
 			//we need a map between old and new indexes
 			std::vector<int> newIndexMap(size(), -1);
 			{
-				unsigned newIndex = 0;
-				for (unsigned i = 0; i < count; ++i)
+				PointIndexType newIndex = 0;
+				for (PointIndexType i = 0; i < count; ++i)
 				{
 					if (m_pointsVisibility[i] != POINT_VISIBLE)
 					{
-						newIndexMap[i] = newIndex++;
+						newIndexMap[i] = static_cast<int>(newIndex++);
 					}
 				}
 			}
@@ -3316,8 +3709,8 @@ ccGenericPointCloud* ccPointCloud::createNewCloudFromVisibilitySelection(bool re
 		}
 
 		//we remove all visible points
-		unsigned lastPoint = 0;
-		for (unsigned i = 0; i < count; ++i)
+		PointIndexType lastPoint = 0;
+		for (PointIndexType i = 0; i < count; ++i)
 		{
 			if (m_pointsVisibility[i] != POINT_VISIBLE)
 			{
@@ -3394,7 +3787,7 @@ bool ccPointCloud::setRGBColorWithCurrentScalarField(bool mixWithExistingColor/*
 		return false;
 	}
 
-	unsigned count = size();
+	PointIndexType count = size();
 
 	if (!mixWithExistingColor || !hasColors())
 	{
@@ -3402,7 +3795,7 @@ bool ccPointCloud::setRGBColorWithCurrentScalarField(bool mixWithExistingColor/*
 			if (!resizeTheRGBTable(false))
 				return false;
 
-		for (unsigned i = 0; i < count; i++)
+		for (PointIndexType i = 0; i < count; i++)
 		{
 			const ccColor::Rgb* col = getPointScalarValueColor(i);
 			m_rgbColors->setValue(i, col ? *col : ccColor::black);
@@ -3410,7 +3803,7 @@ bool ccPointCloud::setRGBColorWithCurrentScalarField(bool mixWithExistingColor/*
 	}
 	else
 	{
-		for (unsigned i = 0; i < count; i++)
+		for (PointIndexType i = 0; i < count; i++)
 		{
 			const ccColor::Rgb* col = getPointScalarValueColor(i);
 			if (col)
@@ -3514,11 +3907,11 @@ if (!resizeTheRGBTable(false))
 }
 
 //import colors
-unsigned CPSetSize = CPSet->size();
+PointIndexType CPSetSize = CPSet->size();
 assert(CPSetSize == size());
-for (unsigned i = 0; i < CPSetSize; ++i)
+for (PointIndexType i = 0; i < CPSetSize; ++i)
 {
-	unsigned index = CPSet->getPointGlobalIndex(i);
+	PointIndexType index = CPSet->getPointGlobalIndex(i);
 	setPointColor(i, otherCloud->getPointColor(index));
 }
 
@@ -3553,9 +3946,9 @@ ccPointCloud* ccPointCloud::unrollOnCylinder(PointCoordinateType radius,
 	dim.x = (dim.z < 2 ? dim.z + 1 : 0);
 	dim.y = (dim.x < 2 ? dim.x + 1 : 0);
 
-	unsigned numberOfPoints = size();
+	PointIndexType numberOfPoints = size();
 
-	CCLib::NormalizedProgress nprogress(progressCb, numberOfPoints);
+	CCLib::NormalizedProgress nprogress(progressCb, static_cast<unsigned>(numberOfPoints));
 	if (progressCb)
 	{
 		if (progressCb->textCanBeEdited())
@@ -3576,7 +3969,7 @@ ccPointCloud* ccPointCloud::unrollOnCylinder(PointCoordinateType radius,
 	std::vector<CCVector3> unrolledPoints;
 	{
 		//compute an estimate of the final point count
-		unsigned newSize = static_cast<unsigned>(std::ceil((stopAngle_deg - startAngle_deg) / 360.0 * size()));
+		PointIndexType newSize = static_cast<PointIndexType>(std::ceil((stopAngle_deg - startAngle_deg) / 360.0 * size()));
 		if (!duplicatedPoints.reserve(newSize))
 		{
 			ccLog::Error("Not enough memory");
@@ -3626,7 +4019,7 @@ ccPointCloud* ccPointCloud::unrollOnCylinder(PointCoordinateType radius,
 	double startAngle_rad = startAngle_deg * CC_DEG_TO_RAD;
 	double stopAngle_rad = stopAngle_deg * CC_DEG_TO_RAD;
 
-	for (unsigned i = 0; i < numberOfPoints; i++)
+	for (PointIndexType i = 0; i < numberOfPoints; i++)
 	{
 		const CCVector3* Pin = getPoint(i);
 		
@@ -3680,7 +4073,7 @@ ccPointCloud* ccPointCloud::unrollOnCylinder(PointCoordinateType radius,
 			//do we need to reserve more memory?
 			if (duplicatedPoints.size() == duplicatedPoints.capacity())
 			{
-				unsigned newSize = duplicatedPoints.size() + (1 << 20);
+				PointIndexType newSize = duplicatedPoints.size() + (1 << 20);
 				if (!duplicatedPoints.reserve(newSize))
 				{
 					ccLog::Error("Not enough memory");
@@ -3742,12 +4135,12 @@ ccPointCloud* ccPointCloud::unrollOnCylinder(PointCoordinateType radius,
 		}
 
 		//update the coordinates, the normals and the deviation SF
-		for (unsigned i = 0; i < duplicatedPoints.size(); ++i)
+		for (PointIndexType i = 0; i < duplicatedPoints.size(); ++i)
 		{
 			CCVector3* P = clone->point(i);
 			*P = unrolledPoints[i];
 
-			unsigned globalIndex = duplicatedPoints.getPointGlobalIndex(i);
+			PointIndexType globalIndex = duplicatedPoints.getPointGlobalIndex(i);
 			if (withNormals)
 			{
 				clone->setPointNormal(i, unrolledNormals[globalIndex]);
@@ -3819,9 +4212,9 @@ ccPointCloud* ccPointCloud::unrollOnCone(	double coneAngle_deg,
 	dim.x = (dim.z < 2 ? dim.z + 1 : 0);
 	dim.y = (dim.x < 2 ? dim.x + 1 : 0);
 
-	unsigned numberOfPoints = size();
+	PointIndexType numberOfPoints = size();
 
-	CCLib::NormalizedProgress nprogress(progressCb, numberOfPoints);
+	CCLib::NormalizedProgress nprogress(progressCb, static_cast<unsigned>(numberOfPoints));
 	if (progressCb)
 	{
 		if (progressCb->textCanBeEdited())
@@ -3862,7 +4255,7 @@ ccPointCloud* ccPointCloud::unrollOnCone(	double coneAngle_deg,
 	PointCoordinateType alpha_rad = coneAngle_deg * CC_DEG_TO_RAD;
 	PointCoordinateType sin_alpha = static_cast<PointCoordinateType>( sin(alpha_rad) );
 
-	for (unsigned i = 0; i < numberOfPoints; i++)
+	for (PointIndexType i = 0; i < numberOfPoints; i++)
 	{
 		const CCVector3* Pin = getPoint(i);
 
@@ -4264,6 +4657,19 @@ bool ccPointCloud::toFile_MeOnly(QFile& out) const
 		}
 	}
 
+	//LOD structure (dataVersion >= 50)
+	//only saved if the points are sorted in the LOD order (see sortPointsForLOD)
+	//and if the structure fits in the file format (otherwise it's skipped)
+	bool withLOD = (m_lod && m_lod->canBeSaved());
+	if (out.write((const char*)&withLOD, sizeof(bool)) < 0)
+	{
+		return WriteError();
+	}
+	if (withLOD && !m_lod->toFile(out))
+	{
+		return false;
+	}
+
 	return true;
 }
 
@@ -4297,7 +4703,7 @@ bool ccPointCloud::fromFile_MeOnly(QFile& in, short dataVersion, int flags)
 		//test: look for NaN values
 		{
 			unsigned nanPointsCount = 0;
-			for (unsigned i = 0; i < size(); ++i)
+			for (PointIndexType i = 0; i < size(); ++i)
 			{
 				if (	point(i)->x != point(i)->x
 					||	point(i)->y != point(i)->y
@@ -4581,6 +4987,38 @@ bool ccPointCloud::fromFile_MeOnly(QFile& in, short dataVersion, int flags)
 		}
 	}
 
+	//LOD structure (dataVersion >= 50)
+	if (dataVersion >= 50)
+	{
+		bool withLOD = false;
+		if (in.read((char*)&withLOD, sizeof(bool)) < 0)
+		{
+			return ReadError();
+		}
+		if (withLOD)
+		{
+			if (!m_lod)
+			{
+				m_lod = new ccPointCloudLOD;
+			}
+			else
+			{
+				m_lod->clear();
+			}
+
+			if (!m_lod->fromFile(in, dataVersion))
+			{
+				return false;
+			}
+
+			if (m_lod->root().pointCount != size())
+			{
+				ccLog::Warning(QString("[BIN] LOD structure of cloud '%1' is inconsistent (it will be recomputed)").arg(getName()));
+				clearLOD();
+			}
+		}
+	}
+
 	//notifyGeometryUpdate(); //FIXME: we can't call it now as the dependent 'pointers' are not valid yet!
 
 	//We should update the VBOs (just in case)
@@ -4605,7 +5043,7 @@ CCLib::ReferenceCloud* ccPointCloud::crop(const ccBBox& box, bool inside/*=true*
 		return nullptr;
 	}
 
-	unsigned count = size();
+	PointIndexType count = size();
 	if (count == 0)
 	{
 		ccLog::Warning("[ccPointCloud::crop] Cloud is empty!");
@@ -4620,7 +5058,7 @@ CCLib::ReferenceCloud* ccPointCloud::crop(const ccBBox& box, bool inside/*=true*
 		return nullptr;
 	}
 
-	for (unsigned i = 0; i < count; ++i)
+	for (PointIndexType i = 0; i < count; ++i)
 	{
 		const CCVector3* P = point(i);
 		bool pointIsInside = box.contains(*P);
@@ -4656,7 +5094,7 @@ CCLib::ReferenceCloud* ccPointCloud::crop2D(const ccPolyline* poly, unsigned cha
 		return nullptr;
 	}
 
-	unsigned count = size();
+	PointIndexType count = size();
 	if (count == 0)
 	{
 		ccLog::Warning("[ccPointCloud::crop] Cloud is empty!");
@@ -4674,7 +5112,7 @@ CCLib::ReferenceCloud* ccPointCloud::crop2D(const ccPolyline* poly, unsigned cha
 	unsigned char X = ((orthoDim+1) % 3);
 	unsigned char Y = ((X+1) % 3);
 
-	for (unsigned i=0; i<count; ++i)
+	for (PointIndexType i=0; i<count; ++i)
 	{
 		const CCVector3* P = point(i);
 
@@ -4738,6 +5176,49 @@ static bool CatchGLErrors(GLenum err, const char* context)
 //DGM: normals are so slow that it's a waste of memory and time to load them in VBOs!
 #define DONT_LOAD_NORMALS_IN_VBOS
 
+//! Converts the scalar values of a chunk to colors and returns the bounds of the converted values
+static void ConvertVBOChunkSFColors(const ccScalarField* sf, size_t chunkIndex, ccColor::Rgb* colors, ScalarType& minVal, ScalarType& maxVal)
+{
+	assert(sf && colors);
+
+	const ScalarType* _sf = ccChunk::Start(*sf, chunkIndex);
+	const size_t chunkSize = ccChunk::Size(chunkIndex, sf->size());
+	sf->convertToColors(_sf, chunkSize, colors);
+
+	//NaN values are ignored (all comparisons fail)
+	minVal = std::numeric_limits<ScalarType>::max();
+	maxVal = -std::numeric_limits<ScalarType>::max();
+	for (size_t j = 0; j < chunkSize; ++j)
+	{
+		const ScalarType val = _sf[j];
+		if (val < minVal)
+			minVal = val;
+		if (val > maxVal)
+			maxVal = val;
+	}
+}
+
+//! Conversion of the SF values of a chunk to colors (see ccPointCloud::updateVBOs)
+struct SFColorsJob
+{
+	SFColorsJob(QGLBuffer* _vbo, size_t _chunkIndex, ccColor::Rgb* _colors, ScalarType* _sfMin, ScalarType* _sfMax)
+		: vbo(_vbo)
+		, chunkIndex(_chunkIndex)
+		, colors(_colors)
+		, sfMin(_sfMin)
+		, sfMax(_sfMax)
+	{}
+
+	//! Mapped VBO
+	QGLBuffer* vbo;
+	size_t chunkIndex;
+	//! Output colors (in the mapped VBO memory)
+	ccColor::Rgb* colors;
+	//! Output bounds of the converted values
+	ScalarType* sfMin;
+	ScalarType* sfMax;
+};
+
 bool ccPointCloud::updateVBOs(const CC_DRAW_CONTEXT& context, const glDrawParams& glParams)
 {
 	if (isColorOverriden())
@@ -4833,6 +5314,15 @@ bool ccPointCloud::updateVBOs(const CC_DRAW_CONTEXT& context, const glDrawParams
 		assert(!glParams.showNorms	|| (m_normals && m_normals->chunksCount() >= chunksCount));
 #endif
 
+		//if only the color mapping of the displayed SF has changed (e.g. its saturation
+		//is being modified), we only update the chunks whose colors are actually affected
+		const bool sfMappingUpdateOnly = (	glParams.showSF
+										&&	m_vboManager.state == vboSet::INITIALIZED
+										&&	m_vboManager.hasColors
+										&&	m_vboManager.colorIsSF
+										&&	m_vboManager.sourceSF == m_currentDisplayedScalarField
+										&&	m_vboManager.sourceSFValuesStamp == m_currentDisplayedScalarField->getValuesModificationStamp() );
+
 		m_vboManager.hasColors  = glParams.showSF || glParams.showColors;
 		m_vboManager.colorIsSF  = glParams.showSF;
 		m_vboManager.sourceSF   = glParams.showSF ? m_currentDisplayedScalarField : nullptr;
@@ -4842,6 +5332,22 @@ bool ccPointCloud::updateVBOs(const CC_DRAW_CONTEXT& context, const glDrawParams
 		m_vboManager.hasNormals  = false;
 #endif
 
+		//SF colors conversion jobs (processed in parallel once all the chunks are mapped)
+		std::vector<SFColorsJob> sfColorsJobs;
+		bool convertInMappedVBOs = false;
+		if (glParams.showSF && (m_vboManager.updateFlags & vboSet::UPDATE_COLORS))
+		{
+			try
+			{
+				sfColorsJobs.reserve(chunksCount);
+				convertInMappedVBOs = true;
+			}
+			catch (const std::bad_alloc&)
+			{
+				//not a big deal (the conversion will simply be done sequentially)
+			}
+		}
+
 		//process each chunk
 		for (size_t i = 0; i < chunksCount; ++i)
 		{
@@ -4881,30 +5387,15 @@ bool ccPointCloud::updateVBOs(const CC_DRAW_CONTEXT& context, const glDrawParams
 					m_vboManager.vbos[i]->write(0, ccChunk::Start(m_points, i), sizeof(PointCoordinateType)*chunkSize * 3);
 				}
 				//load colors
+				bool updateSFColors = false;
 				if (chunkUpdateFlags & vboSet::UPDATE_COLORS)
 				{
 					if (glParams.showSF)
 					{
-						//copy SF colors in static array
-						{
-							assert(m_vboManager.sourceSF);
-							ColorCompType* _sfColors = s_rgbBuffer3ub;
-							ScalarType* _sf = ccChunk::Start(*m_vboManager.sourceSF, i);
-							for (int j = 0; j < chunkSize; j++, _sf++)
-							{
-								//we need to convert scalar value to color into a temporary structure
-								const ccColor::Rgb* col = m_vboManager.sourceSF->getColor(*_sf);
-								if (!col)
-									col = &ccColor::lightGrey;
-								*_sfColors++ = col->r;
-								*_sfColors++ = col->g;
-								*_sfColors++ = col->b;
-							}
-						}
-						//then send them in VRAM
-						m_vboManager.vbos[i]->write(m_vboManager.vbos[i]->rgbShift, s_rgbBuffer3ub, sizeof(ColorCompType)*chunkSize * 3);
-						//upadte 'modification' flag for current displayed SF
-						m_vboManager.sourceSF->setModificationFlag(false);
+						assert(m_vboManager.sourceSF);
+						updateSFColors = (	reallocated
+										||	!sfMappingUpdateOnly
+										||	!m_vboManager.sourceSF->haveSameColors(m_vboManager.sourceSFMapping, m_vboManager.vbos[i]->sfMin, m_vboManager.vbos[i]->sfMax) );
 					}
 					else if (glParams.showColors)
 					{
@@ -4928,6 +5419,23 @@ bool ccPointCloud::updateVBOs(const CC_DRAW_CONTEXT& context, const glDrawParams
 					m_vboManager.vbos[i]->write(m_vboManager.vbos[i]->normalShift, s_normalBuffer, sizeof(PointCoordinateType)*chunkSize * 3);
 				}
 #endif
+				//SF colors: we'll convert the scalar values directly in the VBO memory (see below)
+				GLbyte* mappedData = nullptr;
+				if (updateSFColors)
+				{
+					if (convertInMappedVBOs)
+					{
+						mappedData = static_cast<GLbyte*>(m_vboManager.vbos[i]->map(QGLBuffer::WriteOnly));
+					}
+					if (!mappedData)
+					{
+						//we use a temporary buffer instead
+						ccColor::Rgb* _sfColors = reinterpret_cast<ccColor::Rgb*>(s_rgbBuffer3ub);
+						ConvertVBOChunkSFColors(m_vboManager.sourceSF, i, _sfColors, m_vboManager.vbos[i]->sfMin, m_vboManager.vbos[i]->sfMax);
+						m_vboManager.vbos[i]->write(m_vboManager.vbos[i]->rgbShift, s_rgbBuffer3ub, sizeof(ColorCompType)*chunkSize * 3);
+					}
+				}
+
 				m_vboManager.vbos[i]->release();
 
 				//if an error is detected
@@ -4941,6 +5449,12 @@ bool ccPointCloud::updateVBOs(const CC_DRAW_CONTEXT& context, const glDrawParams
 				{
 					m_vboManager.totalMemSizeBytes += vboSizeBytes;
 					pointsInVBOs += chunkSize;
+
+					if (mappedData)
+					{
+						VBO* vbo = m_vboManager.vbos[i];
+						sfColorsJobs.emplace_back(vbo, i, reinterpret_cast<ccColor::Rgb*>(mappedData + vbo->rgbShift), &vbo->sfMin, &vbo->sfMax);
+					}
 				}
 			}
 
@@ -4965,6 +5479,45 @@ bool ccPointCloud::updateVBOs(const CC_DRAW_CONTEXT& context, const glDrawParams
 				}
 			}
 		}
+
+		//convert the scalar values to colors (directly in the mapped VBOs)
+		if (!sfColorsJobs.empty())
+		{
+			ccScalarField* sf = m_vboManager.sourceSF;
+			//the lookup table must be up to date before the conversion is done concurrently
+			sf->updateColorLookupTable();
+
+			QtConcurrent::blockingMap(sfColorsJobs, [sf](SFColorsJob& job)
+			{
+				ConvertVBOChunkSFColors(sf, job.chunkIndex, job.colors, *job.sfMin, *job.sfMax);
+			});
+
+			bool unmapped = true;
+			for (SFColorsJob& job : sfColorsJobs)
+			{
+				job.vbo->bind();
+				unmapped &= job.vbo->unmap();
+				job.vbo->release();
+			}
+
+			if (!unmapped)
+			{
+				//the content of the VBOs is undefined
+				ccLog::Warning(QString("[ccPointCloud::updateVBOs] Failed to update the VBOs (cloud '%1')").arg(getName()));
+				releaseVBOs();
+				m_vboManager.state = vboSet::FAILED;
+				return false;
+			}
+		}
+
+		if (glParams.showSF && (m_vboManager.updateFlags & vboSet::UPDATE_COLORS))
+		{
+			//the chunks colors are now up to date with the current color mapping
+			m_vboManager.sourceSFMapping = m_vboManager.sourceSF->getColorMapping();
+			m_vboManager.sourceSFValuesStamp = m_vboManager.sourceSF->getValuesModificationStamp();
+			//update 'modification' flag for current displayed SF
+			m_vboManager.sourceSF->setModificationFlag(false);
+		}
 	}
 
 	//Display vbo(s) status
@@ -5050,6 +5603,11 @@ int ccPointCloud::VBO::init(int count, bool withColors, bool withNormals, bool*
 
 void ccPointCloud::releaseVBOs()
 {
+	//the data displayed by the dependent entities (e.g. meshes) is not up to date anymore
+	++m_displayDataVersion.points;
+	++m_displayDataVersion.colors;
+	++m_displayDataVersion.normals;
+
 	if (m_vboManager.state == vboSet::NEW)
 		return;
 
@@ -5094,7 +5652,7 @@ void ccPointCloud::removeFromDisplay(const ccGenericGLDisplay* win)
 bool ccPointCloud::computeNormalsWithGrids(	double minTriangleAngle_deg/*=1.0*/,
 											ccProgressDialog* pDlg/*=0*/)
 {
-	unsigned pointCount = size();
+	PointIndexType pointCount = size();
 	if (pointCount < 3)
 	{
 		ccLog::Warning(QString("[computeNormalsWithGrids] Cloud '%1' has not enough points").arg(getName()));
@@ -5305,7 +5863,7 @@ bool ccPointCloud::computeNormalsWithGrids(	double minTriangleAngle_deg/*=1.0*/,
 
 	//for each vertex
 	{
-		for (unsigned i = 0; i < pointCount; i++)
+		for (PointIndexType i = 0; i < pointCount; i++)
 		{
 			CCVector3& N = theNorms[i];
 			//normalize the 'mean' normal
@@ -5325,7 +5883,7 @@ bool ccPointCloud::computeNormalsWithGrids(	double minTriangleAngle_deg/*=1.0*/,
 
 bool ccPointCloud::orientNormalsWithGrids(ccProgressDialog* pDlg/*=0*/)
 {
-	unsigned pointCount = size();
+	PointIndexType pointCount = size();
 	if (pointCount == 0)
 	{
 		ccLog::Warning(QString("[orientNormalsWithGrids] Cloud '%1' is empty").arg(getName()));
@@ -5380,7 +5938,7 @@ bool ccPointCloud::orientNormalsWithGrids(ccProgressDialog* pDlg/*=0*/)
 			{
 				if (*_indexGrid >= 0)
 				{
-					unsigned pointIndex = static_cast<unsigned>(*_indexGrid);
+					PointIndexType pointIndex = static_cast<PointIndexType>(*_indexGrid);
 					assert(pointIndex <= pointCount);
 					const CCVector3* P = getPoint(pointIndex);
 					//CCVector3 PinSensorCS = toSensorCS * (*P);
@@ -5424,7 +5982,7 @@ bool ccPointCloud::orientNormalsWithGrids(ccProgressDialog* pDlg/*=0*/)
 bool ccPointCloud::orientNormalsTowardViewPoint( CCVector3 & VP, ccProgressDialog* pDlg)
 {
 	int progressIndex = 0;
-	for (unsigned pointIndex = 0; pointIndex < m_points.capacity(); ++pointIndex)
+	for (PointIndexType pointIndex = 0; pointIndex < m_points.capacity(); ++pointIndex)
 	{
 		const CCVector3* P = getPoint(pointIndex);
 		CCVector3 N = getPointNormal(pointIndex);
@@ -5503,7 +6061,7 @@ bool ccPointCloud::computeNormalsWithOctree(CC_LOCAL_MODEL_TYPES model,
 
 	//compress the normals
 	{
-		for (unsigned j = 0; j < normsIndexes->currentSize(); j++)
+		for (PointIndexType j = 0; j < normsIndexes->currentSize(); j++)
 		{
 			setPointNormalIndex(j, normsIndexes->getValue(j));
 		}
@@ -5589,6 +6147,244 @@ void ccPointCloud::clearLOD()
 	}
 }
 
+//! Applies a permutation to an array (newData[i] = data[permutation[i]]) by following its cycles
+template <class T> static void ApplyPermutation(std::vector<T>& data, const std::vector<PointIndexType>& permutation, std::vector<bool>& visited)
+{
+	assert(data.size() == permutation.size());
+	visited.assign(permutation.size(), false);
+
+	for (size_t start = 0; start < permutation.size(); ++start)
+	{
+		if (visited[start])
+			continue;
+
+		T startValue = data[start];
+		size_t current = start;
+		while (true)
+		{
+			visited[current] = true;
+			size_t source = permutation[current];
+			if (source == start)
+			{
+				data[current] = startValue;
+				break;
+			}
+			data[current] = data[source];
+			current = source;
+		}
+	}
+}
+
+bool ccPointCloud::isReferencedBy(const ccHObject* entity) const
+{
+	if (!entity || entity == this)
+	{
+		return false;
+	}
+
+	if (entity->isKindOf(CC_TYPES::MESH))
+	{
+		return static_cast<const ccGenericMesh*>(entity)->getAssociatedCloud() == this;
+	}
+	else if (entity->isA(CC_TYPES::POLY_LINE))
+	{
+		return static_cast<const ccPolyline*>(entity)->getAssociatedCloud() == static_cast<const CCLib::GenericIndexedCloudPersist*>(this);
+	}
+	else if (entity->isA(CC_TYPES::LABEL_2D))
+	{
+		const cc2DLabel* label = static_cast<const cc2DLabel*>(entity);
+		for (unsigned i = 0; i < label->size(); ++i)
+		{
+			if (label->getPoint(i).cloud == this)
+			{
+				return true;
+			}
+		}
+	}
+
+	return false;
+}
+
+bool ccPointCloud::sortPointsForLOD(ccProgressDialog* pDlg/*=nullptr*/)
+{
+	if (isLocked())
+	{
+		ccLog::Warning("[sortPointsForLOD] Cloud is locked");
+		return false;
+	}
+
+	//the points indexes will change: no entity should refer to them
+	{
+		ccHObject::Container relatedEntities;
+		filterChildren(relatedEntities, true);
+		if (m_parent)
+		{
+			relatedEntities.push_back(m_parent);
+		}
+		for (const auto& dependency : m_dependencies)
+		{
+			relatedEntities.push_back(dependency.first);
+		}
+
+		for (ccHObject* entity : relatedEntities)
+		{
+			if (isReferencedBy(entity))
+			{
+				ccLog::Warning(QString("[sortPointsForLOD] Cloud '%1' is referenced by entity '%2' (its points can't be re-ordered)").arg(getName(), entity->getName()));
+				return false;
+			}
+		}
+	}
+
+	PointIndexType pointCount = size();
+	if (pointCount == 0)
+	{
+		return true;
+	}
+
+	//we need an octree
+	ccOctree::Shared octree = getOctree();
+	if (!octree)
+	{
+		octree = computeOctree(pDlg);
+		if (!octree)
+		{
+			ccLog::Warning(QString("[sortPointsForLOD] Could not compute octree on cloud '%1'").arg(getName()));
+			return false;
+		}
+	}
+
+	const ccOctree::cellsContainer& cellCodes = octree->pointsAndTheirCellCodes();
+	if (cellCodes.size() != pointCount)
+	{
+		//some points have not been projected in the octree
+		ccLog::Warning(QString("[sortPointsForLOD] The octree of cloud '%1' doesn't contain all its points").arg(getName()));
+		return false;
+	}
+
+	//the new ith point is the point with index 'permutation[i]'
+	std::vector<PointIndexType> permutation;
+	std::vector<bool> visited;
+	std::vector<PointIndexType> newIndexes; //inverse permutation (for the grids)
+	try
+	{
+		permutation.resize(pointCount);
+		visited.resize(pointCount);
+		if (gridCount() != 0)
+		{
+			newIndexes.resize(pointCount);
+		}
+	}
+	catch (const std::bad_alloc&)
+	{
+		ccLog::Warning("[sortPointsForLOD] Not enough memory");
+		return false;
+	}
+
+	bool alreadySorted = true;
+	for (PointIndexType i = 0; i < pointCount; ++i)
+	{
+		permutation[i] = cellCodes[i].theIndex;
+		if (permutation[i] != i)
+		{
+			alreadySorted = false;
+		}
+	}
+	if (alreadySorted)
+	{
+		//nothing to do
+		return true;
+	}
+
+	//the LOD structure (and its thread) must be stopped before modifying the cloud
+	clearLOD();
+
+	if (pDlg)
+	{
+		pDlg->setMethodTitle(QObject::tr("Sort points"));
+		pDlg->setInfo(QObject::tr("Points: %L1").arg(pointCount));
+		pDlg->start();
+		QCoreApplication::processEvents();
+	}
+
+	//points
+	ApplyPermutation(m_points, permutation, visited);
+	//colors
+	if (hasColors())
+	{
+		ApplyPermutation<ccColor::Rgb>(*m_rgbColors, permutation, visited);
+	}
+	//normals
+	if (hasNormals())
+	{
+		ApplyPermutation<CompressedNormType>(*m_normals, permutation, visited);
+	}
+	//scalar fields
+	for (unsigned i = 0; i < getNumberOfScalarFields(); ++i)
+	{
+		CCLib::ScalarField* sf = getScalarField(static_cast<int>(i));
+		if (sf->currentSize() == pointCount)
+		{
+			ApplyPermutation<ScalarType>(*sf, permutation, visited);
+		}
+	}
+	//waveforms
+	if (m_fwfWaveforms.size() == pointCount)
+	{
+		ApplyPermutation(m_fwfWaveforms, permutation, visited);
+	}
+	//visibility
+	if (m_pointsVisibility.size() == pointCount)
+	{
+		ApplyPermutation(m_pointsVisibility, permutation, visited);
+	}
+
+	//grids
+	if (!newIndexes.empty())
+	{
+		for (PointIndexType i = 0; i < pointCount; ++i)
+		{
+			newIndexes[permutation[i]] = i;
+		}
+
+		for (size_t i = 0; i < gridCount(); ++i)
+		{
+			Grid::Shared& g = grid(i);
+			bool firstValidIndex = true;
+			for (int& index : g->indexes)
+			{
+				if (index < 0)
+					continue;
+
+				index = static_cast<int>(newIndexes[index]);
+				if (firstValidIndex)
+				{
+					g->minValidIndex = g->maxValidIndex = static_cast<unsigned>(index);
+					firstValidIndex = false;
+				}
+				else
+				{
+					g->minValidIndex = std::min(static_cast<unsigned>(index), g->minValidIndex);
+					g->maxValidIndex = std::max(static_cast<unsigned>(index), g->maxValidIndex);
+				}
+			}
+		}
+	}
+
+	//the octree is not valid anymore (the LOD structure will compute a new one)
+	deleteOctree();
+
+	if (pDlg)
+	{
+		pDlg->stop();
+	}
+
+	//we must update the VBOs
+	releaseVBOs();
+
+	return true;
+}
+
 void ccPointCloud::clearFWFData()
 {
 	m_fwfWaveforms.resize(0);
@@ -5616,7 +6412,7 @@ bool ccPointCloud::computeFWFAmplitude(double& minVal, double& maxVal, ccProgres
 
 	//for all waveforms
 	bool firstTest = true;
-	for (unsigned i = 0; i < size(); ++i)
+	for (PointIndexType i = 0; i < size(); ++i)
 	{
 		if (pDlg && !nProgress.oneStep())
 		{
@@ -5678,7 +6474,7 @@ bool ccPointCloud::enhanceRGBWithIntensitySF(int sfIdx, bool useCustomIntensityR
 		return false;
 	}
 
-	for (unsigned i = 0; i < size(); ++i)
+	for (PointIndexType i = 0; i < size(); ++i)
 	{
 		ccColor::Rgb& col = m_rgbColors->at(i);
 
@@ -5860,7 +6656,7 @@ bool ccPointCloud::exportCoordToSF(bool exportDims[3])
 
 	const QString defaultSFName[3] = { "Coord. X", "Coord. Y", "Coord. Z" };
 
-	unsigned ptsCount = size();
+	PointIndexType ptsCount = size();
 
 	//test each dimension
 	for (unsigned d = 0; d < 3; ++d)
@@ -5888,7 +6684,7 @@ bool ccPointCloud::exportCoordToSF(bool exportDims[3])
 			return false;
 		}
 
-		for (unsigned k = 0; k < ptsCount; ++k)
+		for (PointIndexType k = 0; k < ptsCount; ++k)
 		{
 			ScalarType s = static_cast<ScalarType>(getPoint(k)->u[d]);
 			sf->setValue(k, s);
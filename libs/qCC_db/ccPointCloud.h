@@ -29,12 +29,12 @@
 //Local
 #include "ccColorScale.h"
 #include "ccNormalVectors.h"
+#include "ccScalarField.h"
 #include "ccWaveform.h"
 
 //Qt
 #include <QGLBuffer>
 
-class ccScalarField;
 class ccPolyline;
 class ccMesh;
 class QGLBuffer;
@@ -47,9 +47,11 @@ class ccPointCloudLOD;
 
 //! Max number of points per cloud (point cloud will be chunked above this limit)
 #if defined(CC_ENV_32)
-const unsigned CC_MAX_NUMBER_OF_POINTS_PER_CLOUD =  128000000;
+const PointIndexType CC_MAX_NUMBER_OF_POINTS_PER_CLOUD =  128000000;
+#elif defined(CC_CORE_LIB_USES_64BIT_INDEXES)
+const PointIndexType CC_MAX_NUMBER_OF_POINTS_PER_CLOUD = 1000000000000; //1e12 points: we'll run out of memory first
 #else //CC_ENV_64 (but maybe CC_ENV_128 one day ;)
-const unsigned CC_MAX_NUMBER_OF_POINTS_PER_CLOUD = 2000000000; //we must keep it below MAX_INT to avoid probable issues ;)
+const PointIndexType CC_MAX_NUMBER_OF_POINTS_PER_CLOUD = 2000000000; //we must keep it below MAX_INT to avoid probable issues ;)
 #endif
 
 //! A 3D cloud and its associated features (color, normals, scalar fields, etc.)
@@ -160,11 +162,27 @@ public: //features deletion/clearing
 	void unallocateNorms();
 
 	//! Notify a modification of color / scalar field display parameters or contents
-	inline void colorsHaveChanged() { m_vboManager.updateFlags |= vboSet::UPDATE_COLORS; }
+	inline void colorsHaveChanged() { m_vboManager.updateFlags |= vboSet::UPDATE_COLORS; ++m_displayDataVersion.colors; }
 	//! Notify a modification of normals display parameters or contents
-	inline void normalsHaveChanged() { m_vboManager.updateFlags |= vboSet::UPDATE_NORMALS; }
+	inline void normalsHaveChanged() { m_vboManager.updateFlags |= vboSet::UPDATE_NORMALS; ++m_displayDataVersion.normals; }
 	//! Notify a modification of points display parameters or contents
-	inline void pointsHaveChanged() { m_vboManager.updateFlags |= vboSet::UPDATE_POINTS; }
+	inline void pointsHaveChanged() { m_vboManager.updateFlags |= vboSet::UPDATE_POINTS; ++m_displayDataVersion.points; }
+
+	//! Modification counters of the displayed data
+	/** They are incremented each time the VBOs of the cloud have to be updated
+		(or are released). Used by the meshes to update their own VBOs.
+	**/
+	struct DisplayDataVersion
+	{
+		DisplayDataVersion() : points(0), colors(0), normals(0) {}
+
+		unsigned points;
+		unsigned colors;
+		unsigned normals;
+	};
+
+	//! Returns the modification counters of the displayed data
+	inline const DisplayDataVersion& displayDataVersion() const { return m_displayDataVersion; }
 
 public: //features allocation/resize
 
@@ -176,7 +194,7 @@ public: //features allocation/resize
 		\param _numberOfPoints number of points to reserve the memory for
 		\return true if ok, false if there's not enough memory
 	**/
-	bool reserveThePointsTable(unsigned _numberOfPoints);
+	bool reserveThePointsTable(PointIndexType _numberOfPoints);
 
 	//! Reserves memory to store the RGB colors
 	/** Before adding colors to the cloud (with addRGBColor())
@@ -225,7 +243,7 @@ public: //features allocation/resize
 		population. Only the already allocated features will be re-reserved.
 		\return true if ok, false if there's not enough memory
 	**/
-	bool reserve(unsigned numberOfPoints) override;
+	bool reserve(PointIndexType numberOfPoints) override;
 
 	//! Resizes all the active features arrays
 	/** This method is meant to be called after having increased the cloud
@@ -233,7 +251,7 @@ public: //features allocation/resize
 		reserved size). Otherwise, it fills all new elements with blank values.
 		\return true if ok, false if there's not enough memory
 	**/
-	bool resize(unsigned numberOfPoints) override;
+	bool resize(PointIndexType numberOfPoints) override;
 
 	//! Removes unused capacity
 	inline void shrinkToFit() { if (size() < capacity()) resize(size()); }
@@ -385,7 +403,7 @@ public: //waveform (e.g. from airborne scanners)
 	bool hasFWF() const;
 
 	//! Returns a proxy on a given waveform
-	ccWaveformProxy waveformProxy(unsigned index) const;
+	ccWaveformProxy waveformProxy(PointIndexType index) const;
 
 	//! Waveform descriptors set
 	using FWFDescriptorSet = QMap<uint8_t, WaveformDescriptor>;
@@ -450,13 +468,17 @@ public: //other methods
 	//inherited from CCLib::GenericCloud
 	unsigned char testVisibility(const CCVector3& P) const override;
 
+	//inherited from CCLib::GenericIndexedCloud
+	bool normalsAvailable() const override { return hasNormals(); }
+	const CCVector3* getNormal(PointIndexType index) const override { return &getPointNormal(index); }
+
 	//inherited from ccGenericPointCloud
 	const ccColor::Rgb* geScalarValueColor(ScalarType d) const override;
-	const ccColor::Rgb* getPointScalarValueColor(unsigned pointIndex) const override;
-	ScalarType getPointDisplayedDistance(unsigned pointIndex) const override;
-	const ccColor::Rgb& getPointColor(unsigned pointIndex) const override;
-	const CompressedNormType& getPointNormalIndex(unsigned pointIndex) const override;
-	const CCVector3& getPointNormal(unsigned pointIndex) const override;
+	const ccColor::Rgb* getPointScalarValueColor(PointIndexType pointIndex) const override;
+	ScalarType getPointDisplayedDistance(PointIndexType pointIndex) const override;
+	const ccColor::Rgb& getPointColor(PointIndexType pointIndex) const override;
+	const CompressedNormType& getPointNormalIndex(PointIndexType pointIndex) const override;
+	const CCVector3& getPointNormal(PointIndexType pointIndex) const override;
 	CCLib::ReferenceCloud* crop(const ccBBox& box, bool inside = true) override;
 	void scale(PointCoordinateType fx, PointCoordinateType fy, PointCoordinateType fz, CCVector3 center = CCVector3(0,0,0)) override;
 	/** \warning if removeSelectedPoints is true, any attached octree will be deleted. **/
@@ -489,18 +511,18 @@ public: //other methods
 	//! Sets a particular point color
 	/** WARNING: colors must be enabled.
 	**/
-	void setPointColor(unsigned pointIndex, const ccColor::Rgb& col);
+	void setPointColor(PointIndexType pointIndex, const ccColor::Rgb& col);
 
 	//! Sets a particular point compressed normal
 	/** WARNING: normals must be enabled.
 	**/
-	void setPointNormalIndex(unsigned pointIndex, CompressedNormType norm);
+	void setPointNormalIndex(PointIndexType pointIndex, CompressedNormType norm);
 
 	//! Sets a particular point normal (shortcut)
 	/** WARNING: normals must be enabled.
 		Normal is automatically compressed before storage.
 	**/
-	void setPointNormal(unsigned pointIndex, const CCVector3& N);
+	void setPointNormal(PointIndexType pointIndex, const CCVector3& N);
 
 	//! Pushes a compressed normal vector
 	/** \param index compressed normal vector
@@ -517,7 +539,7 @@ public: //other methods
 		\param N normal vector to add (size: 3)
 		\param index normal index to modify
 	**/
-	void addNormAtIndex(const PointCoordinateType* N, unsigned index);
+	void addNormAtIndex(const PointCoordinateType* N, PointIndexType index);
 
 	//! Sets the (compressed) normals table
 	void setNormsTable(NormsIndexesTableType* norms);
@@ -700,7 +722,7 @@ public: //other methods
 		\param ignoreChildren whether to copy input cloud's children or not
 		\return the resulting point cloud
 	**/
-	const ccPointCloud& append(ccPointCloud* cloud, unsigned pointCountBefore, bool ignoreChildren = false);
+	const ccPointCloud& append(ccPointCloud* cloud, PointIndexType pointCountBefore, bool ignoreChildren = false);
 
 	//! Enhances the RGB colors with the current scalar field (assuming it's intensities)
 	bool enhanceRGBWithIntensitySF(int sfIdx, bool useCustomIntensityRange = false, double minI = 0.0, double maxI = 1.0);
@@ -720,7 +742,7 @@ protected:
 	//inherited from PointCloud
 	/** \warning Doesn't handle scan grids!
 	**/
-	void swapPoints(unsigned firstIndex, unsigned secondIndex) override;
+	void swapPoints(PointIndexType firstIndex, PointIndexType secondIndex) override;
 
 	//! Colors
 	ColorsTableType* m_rgbColors;
@@ -757,6 +779,8 @@ protected: // VBO
 	public:
 		int rgbShift;
 		int normalShift;
+		//! Bounds of the scalar values converted to colors (NaN values excluded)
+		ScalarType sfMin, sfMax;
 
 		//! Inits the VBO
 		/** \return the number of allocated bytes (or -1 if an error occurred)
@@ -767,6 +791,8 @@ protected: // VBO
 			: QGLBuffer(QGLBuffer::VertexBuffer)
 			, rgbShift(0)
 			, normalShift(0)
+			, sfMin(0)
+			, sfMax(0)
 		{}
 	};
 
@@ -788,6 +814,7 @@ protected: // VBO
 			: hasColors(false)
 			, colorIsSF(false)
 			, sourceSF(nullptr)
+			, sourceSFValuesStamp(0)
 			, hasNormals(false)
 			, totalMemSizeBytes(0)
 			, updateFlags(0)
@@ -798,6 +825,10 @@ protected: // VBO
 		bool hasColors;
 		bool colorIsSF;
 		ccScalarField* sourceSF;
+		//! Color mapping of the source SF when its values were converted to colors
+		ccScalarField::ColorMapping sourceSFMapping;
+		//! Values stamp of the source SF when its values were converted to colors
+		ccScalarField::ModificationStamp sourceSFValuesStamp;
 		bool hasNormals;
 		int totalMemSizeBytes;
 		int updateFlags;
@@ -809,6 +840,9 @@ protected: // VBO
 	//! Set of VBOs attached to this cloud
 	vboSet m_vboManager;
 
+	//! Modification counters of the displayed data
+	DisplayDataVersion m_displayDataVersion;
+
 	//per-block data transfer to the GPU (VBO or standard mode)
 	void glChunkVertexPointer(const CC_DRAW_CONTEXT& context, size_t chunkIndex, unsigned decimStep, bool useVBOs);
 	void glChunkColorPointer (const CC_DRAW_CONTEXT& context, size_t chunkIndex, unsigned decimStep, bool useVBOs);
@@ -825,6 +859,28 @@ public: //Level of Detail (LOD)
 	//! Clears the LOD structure
 	void clearLOD();
 
+	//! Sorts the points in the octree (LOD) order
+	/** All the per-point attributes (colors, normals, scalar fields, waveforms,
+		visibility) are permuted accordingly and the grids are updated. The points
+		of each octree cell are then contiguous so that the LOD structure can draw
+		them directly by ranges (and it can be saved in BIN files).
+		\warning The points indexes are changed (the octree and the LOD structure
+		are reset). Therefore the process is refused if a mesh, a polyline or a
+		label related to this cloud (parent, children or dependencies) refers to
+		its points (see isReferencedBy). The caller should check the other
+		entities of the DB tree.
+		\param pDlg progress dialog (optional)
+		\return success
+	**/
+	bool sortPointsForLOD(ccProgressDialog* pDlg = nullptr);
+
+	//! Returns whether an entity refers to the points of this cloud by their indexes
+	/** I.e. a mesh (vertices), a polyline (vertices) or a 2D label (picked points).
+		\param entity entity to test
+		\return whether the entity uses the points indexes of this cloud
+	**/
+	bool isReferencedBy(const ccHObject* entity) const;
+
 protected: //Level of Detail (LOD)
 
 	//! L.O.D. structure
@@ -19,10 +19,50 @@
 
 //Local
 #include "ccPointCloud.h"
+#include "ccSerializableObject.h"
 
 //Qt
 #include <QThread>
 #include <QElapsedTimer>
+#include <QFile>
+
+//system
+#include <cstring>
+#include <limits>
+
+//! Checks whether the points of a cloud are stored in the octree order
+/** I.e. whether the points of each cell form a contiguous range of the cloud
+	(the order of the points sharing the same cell code doesn't matter).
+**/
+static bool PointsAreInOctreeOrder(const ccOctree& octree, unsigned pointCount)
+{
+	const ccOctree::cellsContainer& cellCodes = octree.pointsAndTheirCellCodes();
+	if (cellCodes.size() != pointCount)
+	{
+		//some points have not been projected
+		return false;
+	}
+
+	//as the indexes are a permutation, each point must simply belong to the range of its own code
+	for (size_t runStart = 0; runStart < cellCodes.size(); )
+	{
+		size_t runEnd = runStart + 1;
+		while (runEnd < cellCodes.size() && cellCodes[runEnd].theCode == cellCodes[runStart].theCode)
+		{
+			++runEnd;
+		}
+		for (size_t i = runStart; i < runEnd; ++i)
+		{
+			if (cellCodes[i].theIndex < runStart || cellCodes[i].theIndex >= runEnd)
+			{
+				return false;
+			}
+		}
+		runStart = runEnd;
+	}
+
+	return true;
+}
 
 //! Thread for background computation
 class ccPointCloudLODThread : public QThread
@@ -216,6 +256,12 @@ protected:
 		//make sure we deprecate the LOD structure when this octree is modified!
 		QObject::connect(m_octree.data(), &ccOctree::updated, this, [&](){ m_cloud.clearLOD(); });
 
+		//if the points are stored in the octree order, the cells will be displayed by ranges
+		bool orderedLayout = PointsAreInOctreeOrder(*m_octree, pointCount);
+		m_lod.lock();
+		m_lod.m_orderedLayout = orderedLayout;
+		m_lod.unlock();
+
 		m_maxLevel = static_cast<uint8_t>(std::max<size_t>(1, m_lod.m_levels.size())) - 1;
 		assert(m_maxLevel <= CCLib::DgmOctree::MAX_OCTREE_LEVEL);
 
@@ -353,11 +399,12 @@ protected:
 
 		m_lod.setState(ccPointCloudLOD::INITIALIZED);
 
-		ccLog::Print(QString("[LoD] Acceleration structure ready for cloud '%1' (max level: %2 / mem. = %3 Mb / duration: %4 s.)")
+		ccLog::Print(QString("[LoD] Acceleration structure ready for cloud '%1' (max level: %2 / mem. = %3 Mb / duration: %4 s.%5)")
 			.arg(m_cloud.getName())
 			.arg(m_maxLevel)
 			.arg(m_lod.memory() / static_cast<double>(1 << 20), 0, 'f', 2)
-			.arg(timer.elapsed() / 1000.0, 0, 'f', 1));
+			.arg(timer.elapsed() / 1000.0, 0, 'f', 1)
+			.arg(m_lod.m_orderedLayout ? " / ordered layout" : ""));
 	}
 
 	ccPointCloud& m_cloud;
@@ -370,6 +417,9 @@ protected:
 ccPointCloudLOD::ccPointCloudLOD()
 	: m_indexMap(0)
 	, m_lastIndexMap(0)
+	, m_fillRanges(false)
+	, m_passCount(0)
+	, m_orderedLayout(false)
 	, m_octree(0)
 	, m_thread(0)
 	, m_state(NOT_INITIALIZED)
@@ -431,6 +481,7 @@ void ccPointCloudLOD::clearData()
 	m_levels.resize(1);
 	m_levels.front().data.resize(1);
 	m_levels.front().data.front() = Node();
+	m_orderedLayout = false;
 }
 
 bool ccPointCloudLOD::initInternal(ccOctree::Shared octree)
@@ -531,6 +582,8 @@ void ccPointCloudLOD::clear()
 	}
 
 	m_levels.clear();
+	m_rangeMap.clear();
+	m_orderedLayout = false;
 	m_state = NOT_INITIALIZED;
 
 	m_mutex.unlock();
@@ -701,7 +754,7 @@ uint32_t ccPointCloudLOD::flagVisibility(const Frustum& frustum, ccClipPlaneSet*
 
 uint32_t ccPointCloudLOD::addNPointsToIndexMap(Node& node, uint32_t count)
 {
-	if (m_indexMap.capacity() == 0)
+	if ((m_fillRanges ? m_rangeMap.capacity() : m_indexMap.capacity()) == 0)
 	{
 		assert(false);
 		return 0;
@@ -759,14 +812,41 @@ uint32_t ccPointCloudLOD::addNPointsToIndexMap(Node& node, uint32_t count)
 		uint32_t iStop = std::min(node.displayedPointCount + count, node.pointCount);
 
 		displayedCount = iStop - node.displayedPointCount;
-		assert(m_indexMap.size() + displayedCount <= m_indexMap.capacity());
 
-		const ccOctree::cellsContainer& cellCodes = m_octree->pointsAndTheirCellCodes();
-		for (uint32_t i = node.displayedPointCount; i < iStop; ++i)
+		if (m_fillRanges)
+		{
+			//the points of the cell are contiguous (ordered layout)
+			assert(m_orderedLayout);
+			unsigned firstIndex = node.firstCodeIndex + node.displayedPointCount;
+			if (!m_rangeMap.empty() && m_rangeMap.back().startIndex + m_rangeMap.back().count == firstIndex)
+			{
+				m_rangeMap.back().count += displayedCount;
+			}
+			else if (displayedCount != 0)
+			{
+				assert(m_rangeMap.size() < m_rangeMap.capacity());
+				m_rangeMap.emplace_back(firstIndex, displayedCount);
+			}
+		}
+		else if (m_orderedLayout)
+		{
+			assert(m_indexMap.size() + displayedCount <= m_indexMap.capacity());
+			for (uint32_t i = node.displayedPointCount; i < iStop; ++i)
+			{
+				m_indexMap.push_back(node.firstCodeIndex + i);
+			}
+		}
+		else
 		{
-			unsigned pointIndex = cellCodes[node.firstCodeIndex + i].theIndex;
-			m_indexMap.push_back(pointIndex);
+			assert(m_indexMap.size() + displayedCount <= m_indexMap.capacity());
+			const ccOctree::cellsContainer& cellCodes = m_octree->pointsAndTheirCellCodes();
+			for (uint32_t i = node.displayedPointCount; i < iStop; ++i)
+			{
+				unsigned pointIndex = cellCodes[node.firstCodeIndex + i].theIndex;
+				m_indexMap.push_back(pointIndex);
+			}
 		}
+		m_passCount += displayedCount;
 	}
 
 	node.displayedPointCount += displayedCount;
@@ -774,40 +854,56 @@ uint32_t ccPointCloudLOD::addNPointsToIndexMap(Node& node, uint32_t count)
 	return displayedCount;
 }
 
-LODIndexSet& ccPointCloudLOD::getIndexMap(unsigned char level, unsigned& maxCount, unsigned& remainingPointsAtThisLevel)
+bool ccPointCloudLOD::fillMap(unsigned char level, unsigned& maxCount, unsigned& remainingPointsAtThisLevel, bool ranges)
 {
 	remainingPointsAtThisLevel = 0;
-	m_lastIndexMap.clear();
 
-	if (!m_octree || level >= m_levels.size())
+	if ((!m_octree && !m_orderedLayout) || level >= m_levels.size() || (ranges && !m_orderedLayout))
 	{
 		assert(false);
 		maxCount = 0;
-		return m_lastIndexMap; //empty
+		return false;
 	}
 
 	if (m_state != INITIALIZED)
 	{
 		maxCount = 0;
-		return m_lastIndexMap; //empty
+		return false;
 	}
 
 	if (m_currentState.displayedPoints >= m_currentState.visiblePoints)
 	{
 		//assert(false);
 		maxCount = 0;
-		return m_lastIndexMap; //empty
+		return false;
 	}
 
+	m_fillRanges = ranges;
+	m_passCount = 0;
 	m_indexMap.clear();
+	m_rangeMap.clear();
 	try
 	{
-		m_indexMap.reserve(maxCount);
+		if (ranges)
+		{
+			//each cell adds at most one range per pass
+			size_t nodeCount = 0;
+			for (const Level& l : m_levels)
+			{
+				nodeCount += l.data.size();
+			}
+			m_rangeMap.reserve(nodeCount);
+		}
+		else
+		{
+			m_indexMap.reserve(maxCount);
+		}
 	}
 	catch (const std::bad_alloc&)
 	{
 		//not enough memory
-		return m_lastIndexMap; //empty
+		maxCount = 0;
+		return false;
 	}
 
 	Level& l = m_levels[level];
@@ -845,10 +941,10 @@ LODIndexSet& ccPointCloudLOD::getIndexMap(unsigned char level, unsigned& maxCoun
 				double ratio = static_cast<double>(nodeRemainingCount) / m_currentState.unfinishedPoints;
 				nodeMaxCount = static_cast<uint32_t>(ceil(ratio * maxCount));
 				//safety check
-				if (m_indexMap.size() + nodeMaxCount >= maxCount)
+				if (m_passCount + nodeMaxCount >= maxCount)
 				{
-					assert(maxCount >= m_indexMap.size());
-					nodeMaxCount = maxCount - static_cast<uint32_t>(m_indexMap.size());
+					assert(maxCount >= m_passCount);
+					nodeMaxCount = maxCount - m_passCount;
 
 					earlyStop = true;
 					earlyStopIndex = i;
@@ -861,7 +957,7 @@ LODIndexSet& ccPointCloudLOD::getIndexMap(unsigned char level, unsigned& maxCoun
 			assert(nodeDisplayCount <= nodeMaxCount);
 			
 			thisPassDisplayCount += nodeDisplayCount;
-			assert(thisPassDisplayCount == m_indexMap.size());
+			assert(thisPassDisplayCount == m_passCount);
 			remainingPointsAtThisLevel += (node.pointCount - node.displayedPointCount);
 		}
 	}
@@ -903,10 +999,10 @@ LODIndexSet& ccPointCloudLOD::getIndexMap(unsigned char level, unsigned& maxCoun
 				double ratio = static_cast<double>(nodeRemainingCount) / totalRemainingCount;
 				nodeMaxCount = static_cast<uint32_t>(ceil(ratio * mapFreeSize));
 				//safety check
-				if (m_indexMap.size() + nodeMaxCount >= maxCount)
+				if (m_passCount + nodeMaxCount >= maxCount)
 				{
-					assert(maxCount >= m_indexMap.size());
-					nodeMaxCount = maxCount - static_cast<uint32_t>(m_indexMap.size());
+					assert(maxCount >= m_passCount);
+					nodeMaxCount = maxCount - m_passCount;
 
 					earlyStop = true;
 					earlyStopIndex = i;
@@ -919,7 +1015,7 @@ LODIndexSet& ccPointCloudLOD::getIndexMap(unsigned char level, unsigned& maxCoun
 			assert(nodeDisplayCount <= nodeMaxCount);
 
 			thisPassDisplayCount += nodeDisplayCount;
-			assert(thisPassDisplayCount == m_indexMap.size());
+			assert(thisPassDisplayCount == m_passCount);
 
 			if (node.childCount == 0)
 			{
@@ -928,8 +1024,8 @@ LODIndexSet& ccPointCloudLOD::getIndexMap(unsigned char level, unsigned& maxCoun
 		}
 	}
 
-	maxCount = static_cast<unsigned>(m_indexMap.size());
-	m_currentState.displayedPoints += static_cast<uint32_t>(m_indexMap.size());
+	maxCount = m_passCount;
+	m_currentState.displayedPoints += m_passCount;
 
 	if (earlyStop)
 	{
@@ -961,8 +1057,195 @@ LODIndexSet& ccPointCloudLOD::getIndexMap(unsigned char level, unsigned& maxCoun
 		m_currentState.unfinishedPoints = 0;
 	}
 	
+	return true;
+}
+
+LODIndexSet& ccPointCloudLOD::getIndexMap(unsigned char level, unsigned& maxCount, unsigned& remainingPointsAtThisLevel)
+{
+	m_lastIndexMap.clear();
+
+	if (!fillMap(level, maxCount, remainingPointsAtThisLevel, false))
+	{
+		return m_lastIndexMap; //empty
+	}
+
 	m_lastIndexMap = m_indexMap;
 	return m_indexMap;
 }
 
+LODRangeSet& ccPointCloudLOD::getRangeMap(unsigned char level, unsigned& maxCount, unsigned& remainingPointsAtThisLevel)
+{
+	if (!fillMap(level, maxCount, remainingPointsAtThisLevel, true))
+	{
+		m_rangeMap.clear();
+	}
+
+	return m_rangeMap;
+}
+
+//! Size of a serialized node (see ccPointCloudLOD::toFile)
+static const size_t c_nodeRecordSize = 4 /*pointCount*/ + 4 /*radius*/ + 12 /*center*/ + 32 /*childIndexes*/ + 4 /*firstCodeIndex*/ + 1 /*level*/ + 1 /*childCount*/;
+
+bool ccPointCloudLOD::canBeSaved()
+{
+	QMutexLocker locker(&m_mutex);
+
+	if (m_state != INITIALIZED || !m_orderedLayout || m_levels.empty() || m_levels.size() > 255)
+	{
+		return false;
+	}
+
+	//the number of nodes per level is stored on 32 bits
+	for (const Level& l : m_levels)
+	{
+		if (l.data.size() > std::numeric_limits<uint32_t>::max())
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+bool ccPointCloudLOD::toFile(QFile& out) const
+{
+	if (m_state != INITIALIZED || !m_orderedLayout || m_levels.empty() || m_levels.size() > 255)
+	{
+		//only the LoD of sorted clouds can be saved
+		assert(false);
+		return false;
+	}
+
+	//number of levels
+	uint8_t levelCount = static_cast<uint8_t>(m_levels.size());
+	if (out.write((const char*)&levelCount, 1) < 0)
+		return ccSerializableObject::WriteError();
+
+	std::vector<char> buffer;
+	for (const Level& l : m_levels)
+	{
+		//number of nodes
+		uint32_t nodeCount = static_cast<uint32_t>(l.data.size());
+		if (out.write((const char*)&nodeCount, 4) < 0)
+			return ccSerializableObject::WriteError();
+
+		//the nodes (the display state is not saved)
+		try
+		{
+			buffer.resize(static_cast<size_t>(nodeCount) * c_nodeRecordSize);
+		}
+		catch (const std::bad_alloc&)
+		{
+			return ccSerializableObject::MemoryError();
+		}
+		char* record = buffer.data();
+		for (const Node& n : l.data)
+		{
+			memcpy(record,      &n.pointCount, 4);
+			memcpy(record +  4, &n.radius, 4);
+			memcpy(record +  8, n.center.u, 12);
+			memcpy(record + 20, n.childIndexes.data(), 32);
+			memcpy(record + 52, &n.firstCodeIndex, 4);
+			record[56] = static_cast<char>(n.level);
+			record[57] = static_cast<char>(n.childCount);
+			record += c_nodeRecordSize;
+		}
+		if (!buffer.empty() && out.write(buffer.data(), buffer.size()) < 0)
+			return ccSerializableObject::WriteError();
+	}
+
+	return true;
+}
+
+bool ccPointCloudLOD::fromFile(QFile& in, short dataVersion)
+{
+	assert(dataVersion >= 50);
+	if (m_thread && m_thread->isRunning())
+	{
+		assert(false);
+		return false;
+	}
+
+	//number of levels
+	uint8_t levelCount = 0;
+	if (in.read((char*)&levelCount, 1) < 0)
+		return ccSerializableObject::ReadError();
+	if (levelCount == 0)
+		return ccSerializableObject::CorruptError();
+
+	std::vector<Level> levels;
+	std::vector<char> buffer;
+	try
+	{
+		levels.resize(levelCount);
+		for (uint8_t level = 0; level < levelCount; ++level)
+		{
+			//number of nodes
+			uint32_t nodeCount = 0;
+			if (in.read((char*)&nodeCount, 4) < 0)
+				return ccSerializableObject::ReadError();
+			if (level == 0 && nodeCount != 1) //single root node
+				return ccSerializableObject::CorruptError();
+
+			buffer.resize(static_cast<size_t>(nodeCount) * c_nodeRecordSize);
+			if (!buffer.empty() && in.read(buffer.data(), buffer.size()) < static_cast<qint64>(buffer.size()))
+				return ccSerializableObject::ReadError();
+
+			std::vector<Node>& nodes = levels[level].data;
+			nodes.resize(nodeCount, Node(level));
+			const char* record = buffer.data();
+			for (Node& n : nodes)
+			{
+				memcpy(&n.pointCount, record, 4);
+				memcpy(&n.radius, record + 4, 4);
+				memcpy(n.center.u, record + 8, 12);
+				memcpy(n.childIndexes.data(), record + 20, 32);
+				memcpy(&n.firstCodeIndex, record + 52, 4);
+				n.childCount = static_cast<uint8_t>(record[57]);
+				if (static_cast<uint8_t>(record[56]) != level)
+					return ccSerializableObject::CorruptError();
+				record += c_nodeRecordSize;
+			}
+		}
+	}
+	catch (const std::bad_alloc&)
+	{
+		return ccSerializableObject::MemoryError();
+	}
+
+	//consistency check (we don't want to read outside of the cloud when displaying it!)
+	const uint32_t totalPointCount = levels.front().data.front().pointCount;
+	for (size_t level = 0; level < levels.size(); ++level)
+	{
+		size_t nextLevelNodeCount = (level + 1 < levels.size() ? levels[level + 1].data.size() : 0);
+		for (const Node& n : levels[level].data)
+		{
+			if (n.firstCodeIndex > totalPointCount || n.pointCount > totalPointCount - n.firstCodeIndex)
+				return ccSerializableObject::CorruptError();
+
+			uint8_t childCount = 0;
+			for (int32_t childIndex : n.childIndexes)
+			{
+				if (childIndex < 0)
+					continue;
+				if (static_cast<size_t>(childIndex) >= nextLevelNodeCount)
+					return ccSerializableObject::CorruptError();
+				++childCount;
+			}
+			if (childCount != n.childCount)
+				return ccSerializableObject::CorruptError();
+		}
+	}
+
+	QMutexLocker locker(&m_mutex);
+
+	m_levels.swap(levels);
+	m_octree.clear();
+	m_orderedLayout = true;
+	m_state = INITIALIZED;
+	m_currentState = RenderParams();
+
+	return true;
+}
+
 #include "ccPointCloudLOD.moc"
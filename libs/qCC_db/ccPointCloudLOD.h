@@ -32,6 +32,7 @@
 
 class ccPointCloud;
 class ccPointCloudLODThread;
+class QFile;
 
 //! Level descriptor
 struct LODLevelDesc
@@ -49,6 +50,9 @@ struct LODLevelDesc
 //! L.O.D. indexes set
 typedef std::vector<unsigned> LODIndexSet;
 
+//! L.O.D. set of contiguous ranges of points (see ccPointCloudLOD::getRangeMap)
+typedef std::vector<LODLevelDesc> LODRangeSet;
+
 //! L.O.D. (Level of Detail) structure
 class ccPointCloudLOD
 {
@@ -90,6 +94,13 @@ public:
 	//! Returns whether the structure is broken or not
 	inline bool isBroken() { return getState() == BROKEN; }
 
+	//! Returns whether the points of the cloud are stored in the octree order
+	/** In this case, the points of each cell form a contiguous range of the
+		cloud, and they can be displayed with getRangeMap instead of getIndexMap
+		(see ccPointCloud::sortPointsForLOD).
+	**/
+	inline bool hasOrderedLayout() { QMutexLocker locker(&m_mutex); return m_state == INITIALIZED && m_orderedLayout; }
+
 	//! Returns the maximum accessible level
 	inline unsigned char maxLevel() { QMutexLocker locker(&m_mutex); return (m_state == INITIALIZED ? static_cast<unsigned char>(std::max<size_t>(1, m_levels.size()))-1 : 0); }
 
@@ -157,6 +168,16 @@ public:
 	//! Builds an index map with the remaining visible points
 	LODIndexSet& getIndexMap(unsigned char level, unsigned& maxCount, unsigned& remainingPointsAtThisLevel);
 
+	//! Builds a map of contiguous ranges of points with the remaining visible points
+	/** Same as getIndexMap, but the points are designated by ranges of indexes
+		that can be drawn directly (no copy). Only for clouds with an ordered layout.
+		\param level current level
+		\param maxCount max number of points (input) / number of points in the map (output)
+		\param remainingPointsAtThisLevel number of points remaining at this level
+		\return the ranges of points
+	**/
+	LODRangeSet& getRangeMap(unsigned char level, unsigned& maxCount, unsigned& remainingPointsAtThisLevel);
+
 	//! Returns the last index map
 	inline const LODIndexSet& getLasIndexMap() const { return m_lastIndexMap; }
 
@@ -166,6 +187,22 @@ public:
 	//! Returns the memory used by the structure (in bytes)
 	size_t memory() const;
 
+	//! Returns whether the cells hierarchy can be saved (see toFile)
+	/** Only the LoD of clouds with an ordered layout can be saved, and the
+		file format stores the number of levels on 8 bits.
+	**/
+	bool canBeSaved();
+
+	//! Saves the cells hierarchy to a file (ordered layout only)
+	/** \warning Check canBeSaved first.
+	**/
+	bool toFile(QFile& out) const;
+
+	//! Restores the cells hierarchy from a file
+	/** The structure is then directly initialized (no need for an octree).
+	**/
+	bool fromFile(QFile& in, short dataVersion);
+
 protected: //methods
 
 	friend ccPointCloudLODThread;
@@ -201,6 +238,11 @@ protected: //methods
 	//! Adds a given number of points to the active index map (should be dispatched among the children cells)
 	uint32_t addNPointsToIndexMap(Node& node, uint32_t count);
 
+	//! Fills the index map or the range map with the remaining visible points
+	/** \return false if there's nothing to display
+	**/
+	bool fillMap(unsigned char level, unsigned& maxCount, unsigned& remainingPointsAtThisLevel, bool ranges);
+
 protected: //members
 
 	struct Level
@@ -245,6 +287,18 @@ protected: //members
 	//! Last index map (pointer on)
 	LODIndexSet m_lastIndexMap;
 
+	//! Range map (ordered layout only)
+	LODRangeSet m_rangeMap;
+
+	//! Whether the current pass fills the range map or the index map
+	bool m_fillRanges;
+
+	//! Number of points added to the map during the current pass
+	uint32_t m_passCount;
+
+	//! Whether the points of the cloud are stored in the octree order
+	bool m_orderedLayout;
+
 	//! Associated octree
 	ccOctree::Shared m_octree;
 
@@ -19,6 +19,7 @@
 
 //CCLib
 #include <Delaunay2dMesh.h>
+#include <PointsSpan.h>
 
 //qCC_db
 #include "ccGenericPointCloud.h"
@@ -29,8 +30,12 @@
 //Qt
 #include <QCoreApplication>
 #include <QMap>
+#include <QThread>
+#include <QtConcurrentMap>
 
 //System
+#include <algorithm>
+#include <atomic>
 #include <cassert>
 
 //default field names
@@ -154,12 +159,78 @@ bool ccRasterGrid::init(unsigned w,
 	return true;
 }
 
+//! Range of points (or rows) processed by a single task when filling the grid
+struct FillTask
+{
+	//! First index
+	unsigned first;
+	//! Last index (excluded)
+	unsigned last;
+	//! Task index
+	unsigned index;
+};
+
+//! Splits [0 ; count[ in tasks (at least 'minTaskSize' wide, except the last one)
+static std::vector<FillTask> SplitInTasks(unsigned count, unsigned minTaskSize)
+{
+	//a few tasks per thread for a better load balancing
+	unsigned taskCount = static_cast<unsigned>(std::max(1, 4 * QThread::idealThreadCount()));
+	taskCount = std::max(1u, std::min(taskCount, count / std::max(1u, minTaskSize)));
+
+	std::vector<FillTask> tasks(taskCount);
+	for (unsigned i = 0; i < taskCount; ++i)
+	{
+		tasks[i].first = static_cast<unsigned>((static_cast<unsigned long long>(count) * i) / taskCount);
+		tasks[i].last = static_cast<unsigned>((static_cast<unsigned long long>(count) * (i + 1)) / taskCount);
+		tasks[i].index = i;
+	}
+	return tasks;
+}
+
+//! Applies a function to each task (in parallel if there are several tasks)
+template <class Func> static void ForEachTask(std::vector<FillTask>& tasks, Func func)
+{
+	if (tasks.size() > 1)
+	{
+		QtConcurrent::blockingMap(tasks, func);
+		return;
+	}
+	for (FillTask& task : tasks)
+	{
+		func(task);
+	}
+}
+
+//! Returns a percentile of a (non empty) set of values
+/** The value is linearly interpolated between the two closest ranks (so that the
+	50th percentile is the median, i.e. the average of the two middle values for
+	an even number of values).
+	\warning The values are reordered
+**/
+static double ComputePercentile(std::vector<double>& values, double percentile)
+{
+	assert(!values.empty());
+	double rank = std::max(0.0, std::min(percentile, 100.0)) / 100.0 * (values.size() - 1);
+	size_t lowerRank = std::min(static_cast<size_t>(rank), values.size() - 1);
+	std::vector<double>::iterator lower = values.begin() + lowerRank;
+	std::nth_element(values.begin(), lower, values.end());
+	double value = *lower;
+	double weight = rank - lowerRank;
+	if (weight > 0 && lower + 1 != values.end())
+	{
+		//the next value is the smallest value after the lower one
+		value += weight * (*std::min_element(lower + 1, values.end()) - value);
+	}
+	return value;
+}
+
 bool ccRasterGrid::fillWith(	ccGenericPointCloud* cloud,
 								unsigned char Z,
 								ProjectionType projectionType,
 								bool interpolateEmptyCells,
 								ProjectionType sfInterpolation/*=INVALID_PROJECTION_TYPE*/,
-								ccProgressDialog* progressDialog/*=0*/)
+								ccProgressDialog* progressDialog/*=0*/,
+								double percentile/*=50.0*/)
 {
 	if (!cloud)
 	{
@@ -183,6 +254,7 @@ bool ccRasterGrid::fillWith(	ccGenericPointCloud* cloud,
 
 	//do we need to interpolate scalar fields?
 	bool interpolateSF = (sfInterpolation != INVALID_PROJECTION_TYPE);
+	std::vector<CCLib::ScalarField*> sourceSFs;
 	if (interpolateSF)
 	{
 		if (pc && pc->hasScalarFields())
@@ -191,15 +263,18 @@ bool ccRasterGrid::fillWith(	ccGenericPointCloud* cloud,
 			try
 			{
 				scalarFields.resize(sfCount);
+				sourceSFs.resize(sfCount);
 				for (unsigned i = 0; i < sfCount; ++i)
 				{
 					scalarFields[i].resize(gridTotalSize, std::numeric_limits<SF::value_type>::quiet_NaN());
+					sourceSFs[i] = pc->getScalarField(i);
 				}
 			}
 			catch (const std::bad_alloc&)
 			{
 				//not enough memory
 				scalarFields.resize(0);
+				sourceSFs.resize(0);
 				ccLog::Warning("[Rasterize] Failed to allocate memory for scalar fields!");
 			}
 		}
@@ -230,198 +305,295 @@ bool ccRasterGrid::fillWith(	ccGenericPointCloud* cloud,
 	//we always handle the colors (if any)
 	hasColors = cloud->hasColors();
 
-	for (unsigned n = 0; n<pointCount; ++n)
+	//direct access to the points (if possible)
+	CCLib::PointsSpan span;
+	const bool hasSpan = cloud->getPointsSpan(span);
+	auto getPoint = [&](unsigned n) -> CCVector3
 	{
-		//for each point
-		const CCVector3* P = cloud->getPoint(n);
-
-		//project it inside the grid
-		CCVector3d relativePos = CCVector3d::fromArray(P->u) - minCorner;
-		int i = static_cast<int>((relativePos.u[X] / gridStep + 0.5));
-		int j = static_cast<int>((relativePos.u[Y] / gridStep + 0.5));
-
-		//we skip points that fall outside of the grid!
-		if (	i < 0 || i >= static_cast<int>(width)
-			||	j < 0 || j >= static_cast<int>(height) )
+		if (hasSpan)
 		{
-			if (!nProgress.oneStep())
-			{
-				//process cancelled by the user
-				return false;
-			}
-			continue;
+			return span[n];
 		}
-		assert(i >= 0 && j >= 0);
+		CCVector3 P;
+		cloud->getPoint(n, P);
+		return P;
+	};
+
+	//the median and percentile values require all the points of each cell at once (they are computed afterwards)
+	const bool percentileHeight = (projectionType == PROJ_MEDIAN_VALUE || projectionType == PROJ_PERCENTILE_VALUE);
+	const bool percentileSF = (interpolateSF && (sfInterpolation == PROJ_MEDIAN_VALUE || sfInterpolation == PROJ_PERCENTILE_VALUE));
+	const double heightPercentile = (projectionType == PROJ_PERCENTILE_VALUE ? percentile : 50.0);
+	const double sfPercentile = (sfInterpolation == PROJ_PERCENTILE_VALUE ? percentile : 50.0);
+	//the 'average', 'median' and 'percentile' projections use the mean color and the point the closest to the cell center
+	const bool averageColors = (projectionType == PROJ_AVERAGE_VALUE || percentileHeight);
+
+	//The points are processed by batches (to bound the memory consumption). For each batch:
+	// - the cell index of each point is computed, and the points are sorted by row (counting sort, in parallel)
+	// - each row is then updated by a single thread (in parallel, without any lock, and in the
+	//   original order of the points, so that the result is the same as with a sequential process)
+	static const unsigned MaxBatchSize = (1 << 24);
+	const unsigned batchSize = std::min(pointCount, MaxBatchSize);
+	const unsigned invalidCellIndex = gridTotalSize;
+
+	std::vector<unsigned> cellIndexes; //cell index of each point of the current batch
+	std::vector<unsigned> sortedPoints; //(relative) indexes of the batch points, sorted by row
+	std::vector<unsigned> rowStart; //position of the first point of each row in 'sortedPoints'
+	std::vector<unsigned> rowOffsets; //per-task and per-row offsets in 'sortedPoints'
+	std::vector<FillTask> pointTasks = SplitInTasks(batchSize, 1 << 16);
+	std::vector<FillTask> rowTasks = SplitInTasks(height, 1);
+	try
+	{
+		cellIndexes.resize(batchSize);
+		sortedPoints.resize(batchSize);
+		rowStart.resize(static_cast<size_t>(height) + 1);
+		rowOffsets.resize(pointTasks.size() * height);
+	}
+	catch (const std::bad_alloc&)
+	{
+		//not enough memory
+		ccLog::Warning("[Rasterize] Not enough memory!");
+		return false;
+	}
 
-		//update the cell statistics
-		ccRasterCell& aCell = rows[j][i];
-		if (aCell.nbPoints)
+	std::atomic<bool> cancelled(false);
+	std::atomic<bool> error(false);
+
+	//computes the cell index of each point of a batch (and optionally counts the points per row, per task, in 'rowOffsets')
+	auto computeCellIndexes = [&](unsigned batchFirst, std::vector<FillTask>& tasks, bool countRows)
+	{
+		ForEachTask(tasks, [&](const FillTask& task)
 		{
-			if (P->u[Z] < aCell.minHeight)
+			unsigned* rowCounts = countRows ? rowOffsets.data() + static_cast<size_t>(task.index) * height : nullptr;
+			for (unsigned k = task.first; k < task.last; ++k)
 			{
-				aCell.minHeight = P->u[Z];
-				if (projectionType == PROJ_MINIMUM_VALUE)
+				//project the point inside the grid
+				CCVector3d relativePos = CCVector3d::fromArray(getPoint(batchFirst + k).u) - minCorner;
+				int i = static_cast<int>((relativePos.u[X] / gridStep + 0.5));
+				int j = static_cast<int>((relativePos.u[Y] / gridStep + 0.5));
+
+				//we skip points that fall outside of the grid!
+				if (	i < 0 || i >= static_cast<int>(width)
+					||	j < 0 || j >= static_cast<int>(height) )
 				{
-					//we keep track of the lowest point
-					aCell.pointIndex = n;
-
-					if (hasColors)
-					{
-						assert(cloud->hasColors());
-						const ccColor::Rgb& col = cloud->getPointColor(n);
-						aCell.color = CCVector3d(col.r, col.g, col.b);
-					}
+					cellIndexes[k] = invalidCellIndex;
+					continue;
 				}
-			}
-			else if (P->u[Z] > aCell.maxHeight)
-			{
-				aCell.maxHeight = P->u[Z];
-				if (projectionType == PROJ_MAXIMUM_VALUE)
-				{
-					//we keep track of the highest point
-					aCell.pointIndex = n;
 
-					if (hasColors)
-					{
-						assert(cloud->hasColors());
-						const ccColor::Rgb& col = cloud->getPointColor(n);
-						aCell.color = CCVector3d(col.r, col.g, col.b);
-					}
+				cellIndexes[k] = static_cast<unsigned>(j) * width + static_cast<unsigned>(i);
+				if (rowCounts)
+				{
+					++rowCounts[j];
 				}
 			}
+		});
+	};
 
-			if (projectionType == PROJ_AVERAGE_VALUE)
-			{
-				//we keep track of the point which is the closest to the cell center (in 2D)
-				CCVector2d C((i + 0.5) * gridStep, (j + 0.5) * gridStep);
-				const CCVector3* Q = cloud->getPoint(aCell.pointIndex); //former closest point
-				CCVector3d relativePosQ = CCVector3d::fromArray(Q->u) - minCorner;
-
-				double distToP = (C - CCVector2d(relativePos .u[X], relativePos .u[Y])).norm2();
-				double distToQ = (C - CCVector2d(relativePosQ.u[X], relativePosQ.u[Y])).norm2();
-				if (distToP < distToQ)
-				{
-					aCell.pointIndex = n;
-				}
+	for (unsigned batchFirst = 0; batchFirst < pointCount; batchFirst += batchSize)
+	{
+		const unsigned batchCount = std::min(batchSize, pointCount - batchFirst);
+		if (batchCount != batchSize)
+		{
+			//last batch
+			pointTasks = SplitInTasks(batchCount, 1 << 16);
+		}
+
+		//compute the cell index of each point and count the points per row
+		std::fill(rowOffsets.begin(), rowOffsets.end(), 0);
+		computeCellIndexes(batchFirst, pointTasks, true);
 
-				if (hasColors)
+		//convert the counts to offsets (rows first, then tasks, so that the sort is stable)
+		{
+			unsigned offset = 0;
+			for (unsigned j = 0; j < height; ++j)
+			{
+				rowStart[j] = offset;
+				for (size_t t = 0; t < pointTasks.size(); ++t)
 				{
-					assert(cloud->hasColors());
-					const ccColor::Rgb& col = cloud->getPointColor(n);
-					aCell.color += CCVector3d(col.r, col.g, col.b);
+					unsigned& rowOffset = rowOffsets[t * height + j];
+					unsigned rowCount = rowOffset;
+					rowOffset = offset;
+					offset += rowCount;
 				}
-
 			}
+			rowStart[height] = offset;
 		}
-		else
-		{
-			aCell.minHeight = aCell.maxHeight = P->u[Z];
-			aCell.pointIndex = n;
 
-			if (hasColors)
+		//sort the points by row
+		ForEachTask(pointTasks, [&](const FillTask& task)
+		{
+			unsigned* rowOffset = rowOffsets.data() + static_cast<size_t>(task.index) * height;
+			for (unsigned k = task.first; k < task.last; ++k)
 			{
-				assert(cloud->hasColors());
-				const ccColor::Rgb& col = cloud->getPointColor(n);
-				aCell.color = CCVector3d(col.r, col.g, col.b);
+				unsigned cellIndex = cellIndexes[k];
+				if (cellIndex != invalidCellIndex)
+				{
+					sortedPoints[rowOffset[cellIndex / width]++] = k;
+				}
 			}
-		}
-		
-		//sum the points heights
-		double Pz = P->u[Z];
-		aCell.avgHeight += Pz;
-		aCell.stdDevHeight += Pz * Pz;
+		});
 
-		//scalar fields
-		if (interpolateSF)
+		//update the cells statistics (row by row)
+		ForEachTask(rowTasks, [&](const FillTask& task)
 		{
-			assert(pc);
-
-			//absolute position of the cell (e.g. in the 2D SF grid(s))
-			int pos = j * static_cast<int>(width)+i;
-			assert(pos < static_cast<int>(gridTotalSize));
-
-			for (size_t k = 0; k < scalarFields.size(); ++k)
+			for (unsigned j = task.first; j < task.last && !cancelled; ++j)
 			{
-				assert(!scalarFields[k].empty());
-
-				CCLib::ScalarField* sf = pc->getScalarField(static_cast<unsigned>(k));
-				assert(sf && pos < scalarFields[k].size());
-
-				ScalarType sfValue = sf->getValue(n);
+				Row& row = rows[j];
 
-				if (ccScalarField::ValidValue(sfValue))
+				for (unsigned p = rowStart[j]; p < rowStart[j + 1]; ++p)
 				{
-					SF::value_type formerValue = scalarFields[k][pos];
-					if (aCell.nbPoints && std::isfinite(formerValue))
+					const unsigned k = sortedPoints[p];
+					const unsigned n = batchFirst + k;
+					const unsigned i = cellIndexes[k] - j * width;
+					const CCVector3 P = getPoint(n);
+					CCVector3d relativePos = CCVector3d::fromArray(P.u) - minCorner;
+
+					//update the cell statistics
+					ccRasterCell& aCell = row[i];
+					if (aCell.nbPoints)
 					{
-						switch (sfInterpolation)
+						if (P.u[Z] < aCell.minHeight)
 						{
-						case PROJ_MINIMUM_VALUE:
-							// keep the minimum value
-							scalarFields[k][pos] = std::min<SF::value_type>(formerValue, sfValue);
-							break;
-						case PROJ_AVERAGE_VALUE:
-							//we sum all values (we will divide them later)
-							scalarFields[k][pos] += sfValue;
-							break;
-						case PROJ_MAXIMUM_VALUE:
-							// keep the maximum value
-							scalarFields[k][pos] = std::max<SF::value_type>(formerValue, sfValue);
-							break;
-						default:
-							assert(false);
-							break;
+							aCell.minHeight = P.u[Z];
+							if (projectionType == PROJ_MINIMUM_VALUE)
+							{
+								//we keep track of the lowest point
+								aCell.pointIndex = n;
+
+								if (hasColors)
+								{
+									const ccColor::Rgb& col = cloud->getPointColor(n);
+									aCell.color = CCVector3d(col.r, col.g, col.b);
+								}
+							}
+						}
+						else if (P.u[Z] > aCell.maxHeight)
+						{
+							aCell.maxHeight = P.u[Z];
+							if (projectionType == PROJ_MAXIMUM_VALUE)
+							{
+								//we keep track of the highest point
+								aCell.pointIndex = n;
+
+								if (hasColors)
+								{
+									const ccColor::Rgb& col = cloud->getPointColor(n);
+									aCell.color = CCVector3d(col.r, col.g, col.b);
+								}
+							}
+						}
+
+						if (averageColors)
+						{
+							//we keep track of the point which is the closest to the cell center (in 2D)
+							CCVector2d C((i + 0.5) * gridStep, (j + 0.5) * gridStep);
+							CCVector3d relativePosQ = CCVector3d::fromArray(getPoint(aCell.pointIndex).u) - minCorner; //former closest point
+
+							double distToP = (C - CCVector2d(relativePos .u[X], relativePos .u[Y])).norm2();
+							double distToQ = (C - CCVector2d(relativePosQ.u[X], relativePosQ.u[Y])).norm2();
+							if (distToP < distToQ)
+							{
+								aCell.pointIndex = n;
+							}
+
+							if (hasColors)
+							{
+								const ccColor::Rgb& col = cloud->getPointColor(n);
+								aCell.color += CCVector3d(col.r, col.g, col.b);
+							}
 						}
 					}
 					else
 					{
-						//for the first (valid) point, we simply have to store its SF value (in any case)
-						scalarFields[k][pos] = sfValue;
-					}
-				}
-			}
-		}
+						aCell.minHeight = aCell.maxHeight = P.u[Z];
+						aCell.pointIndex = n;
 
-		//update the number of points in the cell
-		++aCell.nbPoints;
-
-		if (!nProgress.oneStep())
-		{
-			//process cancelled by user
-			return false;
-		}
-	}
+						if (hasColors)
+						{
+							const ccColor::Rgb& col = cloud->getPointColor(n);
+							aCell.color = CCVector3d(col.r, col.g, col.b);
+						}
+					}
 
-	//update SF grids for 'average' cases
-	if (sfInterpolation == PROJ_AVERAGE_VALUE)
-	{
-		for (auto &scalarField : scalarFields)
-		{
-			assert(!scalarField.empty());
+					//sum the points heights
+					double Pz = P.u[Z];
+					aCell.avgHeight += Pz;
+					aCell.stdDevHeight += Pz * Pz;
 
-			double* _gridSF = scalarField.data();
-			for (unsigned j = 0; j < height; ++j)
-			{
-				Row& row = rows[j];
-				for (unsigned i = 0; i < width; ++i, ++_gridSF)
-				{
-					if (row[i].nbPoints > 1)
+					//scalar fields (the median and percentile values are computed afterwards)
+					if (interpolateSF && !percentileSF)
 					{
-						if (std::isfinite(*_gridSF)) //valid SF value
+						//absolute position of the cell (e.g. in the 2D SF grid(s))
+						unsigned pos = j * width + i;
+						assert(pos < gridTotalSize);
+
+						for (size_t sfIndex = 0; sfIndex < scalarFields.size(); ++sfIndex)
 						{
-							*_gridSF /= row[i].nbPoints;
+							assert(pos < scalarFields[sfIndex].size());
+
+							ScalarType sfValue = sourceSFs[sfIndex]->getValue(n);
+
+							if (ccScalarField::ValidValue(sfValue))
+							{
+								SF::value_type& cellValue = scalarFields[sfIndex][pos];
+								if (aCell.nbPoints && std::isfinite(cellValue))
+								{
+									switch (sfInterpolation)
+									{
+									case PROJ_MINIMUM_VALUE:
+										// keep the minimum value
+										cellValue = std::min<SF::value_type>(cellValue, sfValue);
+										break;
+									case PROJ_AVERAGE_VALUE:
+										//we sum all values (we will divide them later)
+										cellValue += sfValue;
+										break;
+									case PROJ_MAXIMUM_VALUE:
+										// keep the maximum value
+										cellValue = std::max<SF::value_type>(cellValue, sfValue);
+										break;
+									default:
+										assert(false);
+										break;
+									}
+								}
+								else
+								{
+									//for the first (valid) point, we simply have to store its SF value (in any case)
+									cellValue = sfValue;
+								}
+							}
 						}
 					}
+
+					//update the number of points in the cell
+					++aCell.nbPoints;
+				}
+
+				unsigned rowPointCount = rowStart[j + 1] - rowStart[j];
+				if (rowPointCount && !nProgress.steps(rowPointCount))
+				{
+					//process cancelled by the user
+					cancelled = true;
 				}
 			}
+		});
+
+		if (cancelled)
+		{
+			return false;
 		}
 	}
 
 	//update the main grid (average height and std.dev. computation + current 'height' value)
+	//and the SF grids (average values)
+	std::vector<unsigned> nonEmptyCellCounts(rowTasks.size(), 0);
+	std::vector<unsigned> rowPointCounts(height, 0);
+	ForEachTask(rowTasks, [&](const FillTask& task)
 	{
-		for (unsigned j = 0; j < height; ++j)
+		for (unsigned j = task.first; j < task.last; ++j)
 		{
 			Row& row = rows[j];
+
 			for (unsigned i = 0; i < width; ++i)
 			{
 				ccRasterCell& cell = row[i];
@@ -429,7 +601,7 @@ bool ccRasterGrid::fillWith(	ccGenericPointCloud* cloud,
 				{
 					cell.avgHeight /= cell.nbPoints;
 					cell.stdDevHeight = sqrt(fabs(cell.stdDevHeight / cell.nbPoints - cell.avgHeight*cell.avgHeight));
-					if (hasColors && projectionType == PROJ_AVERAGE_VALUE)
+					if (hasColors && averageColors)
 					{
 						cell.color /= cell.nbPoints;
 					}
@@ -439,36 +611,196 @@ bool ccRasterGrid::fillWith(	ccGenericPointCloud* cloud,
 					cell.stdDevHeight = 0;
 				}
 
-				if (cell.nbPoints != 0)
+				if (cell.nbPoints == 0)
+				{
+					continue;
+				}
+				++nonEmptyCellCounts[task.index];
+				rowPointCounts[j] += cell.nbPoints;
+
+				//set the right 'height' value
+				switch (projectionType)
 				{
-					//set the right 'height' value
-					switch (projectionType)
+				case PROJ_MINIMUM_VALUE:
+					cell.h = cell.minHeight;
+					break;
+				case PROJ_AVERAGE_VALUE:
+					cell.h = cell.avgHeight;
+					break;
+				case PROJ_MAXIMUM_VALUE:
+					cell.h = cell.maxHeight;
+					break;
+				case PROJ_MEDIAN_VALUE:
+				case PROJ_PERCENTILE_VALUE:
+					//computed afterwards
+					break;
+				default:
+					assert(false);
+					break;
+				}
+
+				//update SF grids for the 'average' case
+				if (sfInterpolation == PROJ_AVERAGE_VALUE && cell.nbPoints > 1)
+				{
+					unsigned pos = j * width + i;
+					for (size_t sfIndex = 0; sfIndex < scalarFields.size(); ++sfIndex)
 					{
-					case PROJ_MINIMUM_VALUE:
-						cell.h = cell.minHeight;
-						break;
-					case PROJ_AVERAGE_VALUE:
-						cell.h = cell.avgHeight;
-						break;
-					case PROJ_MAXIMUM_VALUE:
-						cell.h = cell.maxHeight;
-						break;
-					default:
-						assert(false);
-						break;
+						SF::value_type& cellValue = scalarFields[sfIndex][pos];
+						if (std::isfinite(cellValue))
+						{
+							cellValue /= cell.nbPoints;
+						}
+					}
+				}
+			}
+		}
+	});
+
+	//median and percentile values: the points are binned again, cell by cell, by bands of rows
+	//holding at most 'MaxBatchSize' points (a single row may hold more points though), so that
+	//the memory consumption stays bounded. The cloud is read once more per band (unless it fits
+	//in a single batch).
+	if (percentileHeight || percentileSF)
+	{
+		std::vector<unsigned> cellEnd; //start position of each cell of the band in 'bandPoints' (end position once the points are binned)
+		std::vector<unsigned> bandPoints; //indexes of the band points, sorted by cell
+
+		for (unsigned bandFirstRow = 0; bandFirstRow < height; )
+		{
+			//determine the rows of the band
+			unsigned bandPointCount = rowPointCounts[bandFirstRow];
+			unsigned bandLastRow = bandFirstRow + 1; //excluded
+			for (; bandLastRow < height && bandPointCount + rowPointCounts[bandLastRow] <= MaxBatchSize; ++bandLastRow)
+			{
+				bandPointCount += rowPointCounts[bandLastRow];
+			}
+			const unsigned bandFirstCell = bandFirstRow * width;
+			const unsigned bandCellCount = (bandLastRow - bandFirstRow) * width;
+
+			try
+			{
+				cellEnd.resize(bandCellCount);
+				bandPoints.resize(bandPointCount);
+			}
+			catch (const std::bad_alloc&)
+			{
+				//not enough memory
+				ccLog::Warning("[Rasterize] Not enough memory!");
+				return false;
+			}
+
+			//start position of each cell
+			{
+				unsigned offset = 0;
+				for (unsigned c = 0; c < bandCellCount; ++c)
+				{
+					cellEnd[c] = offset;
+					offset += rows[bandFirstRow + c / width][c % width].nbPoints;
+				}
+				assert(offset == bandPointCount);
+			}
+
+			//bin the points of the band (batch by batch)
+			if (bandPointCount != 0)
+			{
+				pointTasks = SplitInTasks(batchSize, 1 << 16);
+				for (unsigned batchFirst = 0; batchFirst < pointCount; batchFirst += batchSize)
+				{
+					const unsigned batchCount = std::min(batchSize, pointCount - batchFirst);
+					if (batchCount != batchSize)
+					{
+						//last batch
+						pointTasks = SplitInTasks(batchCount, 1 << 16);
+					}
+
+					if (batchSize != pointCount)
+					{
+						computeCellIndexes(batchFirst, pointTasks, false);
+					}
+					//else the cell indexes of the (single) batch are still valid
+
+					for (unsigned k = 0; k < batchCount; ++k)
+					{
+						unsigned c = cellIndexes[k] - bandFirstCell; //(wraps around for the cells before the band)
+						if (cellIndexes[k] != invalidCellIndex && c < bandCellCount)
+						{
+							bandPoints[cellEnd[c]++] = batchFirst + k;
+						}
 					}
 				}
 			}
+
+			//compute the median / percentile values of each cell (row by row)
+			std::vector<FillTask> bandRowTasks = SplitInTasks(bandLastRow - bandFirstRow, 1);
+			ForEachTask(bandRowTasks, [&](const FillTask& task)
+			{
+				try
+				{
+					std::vector<double> values;
+					for (unsigned j = bandFirstRow + task.first; j < bandFirstRow + task.last; ++j)
+					{
+						Row& row = rows[j];
+						for (unsigned i = 0; i < width; ++i)
+						{
+							ccRasterCell& cell = row[i];
+							if (cell.nbPoints == 0)
+							{
+								continue;
+							}
+							const unsigned last = cellEnd[(j - bandFirstRow) * width + i];
+							const unsigned first = last - cell.nbPoints;
+
+							if (percentileHeight)
+							{
+								values.resize(0);
+								for (unsigned p = first; p < last; ++p)
+								{
+									values.push_back(getPoint(bandPoints[p]).u[Z]);
+								}
+								cell.h = ComputePercentile(values, heightPercentile);
+							}
+
+							for (size_t sfIndex = 0; sfIndex < scalarFields.size() && percentileSF; ++sfIndex)
+							{
+								values.resize(0);
+								for (unsigned p = first; p < last; ++p)
+								{
+									ScalarType sfValue = sourceSFs[sfIndex]->getValue(bandPoints[p]);
+									if (ccScalarField::ValidValue(sfValue))
+									{
+										values.push_back(sfValue);
+									}
+								}
+								if (!values.empty())
+								{
+									scalarFields[sfIndex][j * width + i] = ComputePercentile(values, sfPercentile);
+								}
+							}
+						}
+					}
+				}
+				catch (const std::bad_alloc&)
+				{
+					//not enough memory
+					error = true;
+				}
+			});
+
+			if (error)
+			{
+				ccLog::Warning("[Rasterize] Not enough memory!");
+				return false;
+			}
+
+			bandFirstRow = bandLastRow;
 		}
 	}
 
 	//compute the number of non empty cells
 	nonEmptyCellCount = 0;
+	for (unsigned count : nonEmptyCellCounts)
 	{
-		for (unsigned i = 0; i < height; ++i)
-			for (unsigned j = 0; j < width; ++j)
-				if (rows[i][j].nbPoints)
-					++nonEmptyCellCount;
+		nonEmptyCellCount += count;
 	}
 
 	//specific case: interpolate the empty cells
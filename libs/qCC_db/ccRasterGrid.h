@@ -119,19 +119,27 @@ struct QCC_DB_LIB_API ccRasterGrid
 	enum ProjectionType {	PROJ_MINIMUM_VALUE			= 0,
 							PROJ_AVERAGE_VALUE			= 1,
 							PROJ_MAXIMUM_VALUE			= 2,
+							PROJ_MEDIAN_VALUE			= 3,
+							PROJ_PERCENTILE_VALUE		= 4,
 							INVALID_PROJECTION_TYPE		= 255,
 	};
 
 	//! Fills the grid with a point cloud
 	/** Since version 2.8, we now use the "PixelIsArea" convention by default (as GDAL)
 	This means that the height is computed at the center of the grid cell.
+	The points are binned in parallel (by batches of points, and row by row) and
+	all the per-cell statistics are computed at once. The result doesn't depend on
+	the number of threads. The 'median' and 'percentile' values are computed afterwards,
+	by bands of rows (the cloud is read once more per band of at most 16M points).
+	\param percentile percentile (between 0 and 100) for the PROJ_PERCENTILE_VALUE projection (heights and scalar fields)
 	**/
 	bool fillWith(	ccGenericPointCloud* cloud,
 					unsigned char projectionDimension,
 					ProjectionType projectionType,
 					bool interpolateEmptyCells,
 					ProjectionType sfInterpolation = INVALID_PROJECTION_TYPE,
-					ccProgressDialog* progressDialog = nullptr);
+					ccProgressDialog* progressDialog = nullptr,
+					double percentile = 50.0);
 
 	//! Option for handling empty cells
 	enum EmptyCellFillOption {	LEAVE_EMPTY				= 0,
@@ -25,12 +25,21 @@
 
 //system
 #include <algorithm>
+#include <atomic>
 
 using namespace CCLib;
 
 //! Default number of classes for associated histogram
 const unsigned MAX_HISTOGRAM_SIZE = 512;
 
+//! Last modification stamp (shared by all the scalar fields, see ccScalarField::ModificationStamp)
+static std::atomic<ccScalarField::ModificationStamp> s_lastModificationStamp(0);
+
+ccScalarField::ModificationStamp ccScalarField::NewModificationStamp()
+{
+	return ++s_lastModificationStamp;
+}
+
 ccScalarField::ccScalarField(const char* name/*=0*/)
 	: ScalarField(name)
 	, m_showNaNValuesInGrey(true)
@@ -40,6 +49,8 @@ ccScalarField::ccScalarField(const char* name/*=0*/)
 	, m_colorScale(nullptr)
 	, m_colorRampSteps(0)
 	, m_modified(true)
+	, m_modificationStamp(NewModificationStamp())
+	, m_valuesModificationStamp(NewModificationStamp())
 	, m_globalShift(0)
 {
 	setColorRampSteps(ccColorScale::DEFAULT_STEPS);
@@ -59,6 +70,8 @@ ccScalarField::ccScalarField(const ccScalarField& sf)
 	, m_colorRampSteps(sf.m_colorRampSteps)
 	, m_histogram(sf.m_histogram)
 	, m_modified(sf.m_modified)
+	, m_modificationStamp(NewModificationStamp())
+	, m_valuesModificationStamp(NewModificationStamp())
 	, m_globalShift(sf.m_globalShift)
 {
 	computeMinAndMax();
@@ -116,6 +129,189 @@ ScalarType ccScalarField::normalize(ScalarType d) const
 	return static_cast<ScalarType>(-1);
 }
 
+ccScalarField::ColorMapping ccScalarField::getColorMapping() const
+{
+	const Range& satRange = saturationRange();
+
+	ColorMapping mapping;
+	mapping.displayStart = m_displayRange.start();
+	mapping.displayStop = m_displayRange.stop();
+	mapping.saturationStart = satRange.start();
+	mapping.saturationStop = satRange.stop();
+	mapping.logScale = m_logScale;
+	mapping.symmetricalScale = m_symmetricalScale;
+	mapping.nanValuesInGrey = m_showNaNValuesInGrey;
+	mapping.steps = m_colorRampSteps;
+	mapping.scale = m_colorScale.data();
+	mapping.scaleUpdateCount = (m_colorScale ? m_colorScale->getUpdateCount() : 0);
+
+	return mapping;
+}
+
+bool ccScalarField::haveSameColors(const ColorMapping& mapping, ScalarType minVal, ScalarType maxVal) const
+{
+	if (minVal > maxVal)
+	{
+		//only NaN values (always displayed the same way)
+		return mapping.nanValuesInGrey == m_showNaNValuesInGrey;
+	}
+
+	const ColorMapping current = getColorMapping();
+	if (	current.logScale != mapping.logScale
+		||	current.symmetricalScale != mapping.symmetricalScale
+		||	current.nanValuesInGrey != mapping.nanValuesInGrey
+		||	current.steps != mapping.steps
+		||	current.scale != mapping.scale
+		||	current.scaleUpdateCount != mapping.scaleUpdateCount)
+	{
+		return false;
+	}
+
+	const bool sameSaturation = (current.saturationStart == mapping.saturationStart && current.saturationStop == mapping.saturationStop);
+	if (	sameSaturation
+		&&	current.displayStart == mapping.displayStart
+		&&	current.displayStop == mapping.displayStop)
+	{
+		return true;
+	}
+
+	//values outside of both displayed ranges
+	if (	maxVal < std::min(current.displayStart, mapping.displayStart)
+		||	minVal > std::max(current.displayStop, mapping.displayStop))
+	{
+		return true;
+	}
+
+	//values inside both displayed ranges
+	if (	minVal >= std::max(current.displayStart, mapping.displayStart)
+		&&	maxVal <= std::min(current.displayStop, mapping.displayStop))
+	{
+		if (sameSaturation)
+		{
+			return true;
+		}
+
+		//values saturated with both mappings (linear scale only)
+		if (	!current.logScale
+			&&	!current.symmetricalScale
+			&&	(		maxVal <= std::min(current.saturationStart, mapping.saturationStart)
+					||	minVal >= std::max(current.saturationStop, mapping.saturationStop)))
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void ccScalarField::updateColorLookupTable() const
+{
+	const ccColorScale* scale = m_colorScale.data();
+	const unsigned scaleUpdateCount = (scale ? scale->getUpdateCount() : 0);
+
+	if (	m_colorLookupTable.size() == m_colorRampSteps + 1
+		&&	m_colorLookupTableMapping.steps == m_colorRampSteps
+		&&	m_colorLookupTableMapping.scale == scale
+		&&	m_colorLookupTableMapping.scaleUpdateCount == scaleUpdateCount)
+	{
+		//nothing to do
+		return;
+	}
+
+	try
+	{
+		m_colorLookupTable.resize(m_colorRampSteps + 1);
+	}
+	catch (const std::bad_alloc&)
+	{
+		//not enough memory (convertToColors will fall back to getColor)
+		m_colorLookupTable.clear();
+		return;
+	}
+
+	//same quantization as ccColorScale::getColorByRelativePos
+	for (unsigned i = 0; i < m_colorRampSteps; ++i)
+	{
+		m_colorLookupTable[i] = (scale ? scale->getColorByIndex((i * (ccColorScale::MAX_STEPS - 1)) / m_colorRampSteps) : ccColor::lightGrey);
+	}
+	//values without color
+	m_colorLookupTable[m_colorRampSteps] = ccColor::lightGrey;
+
+	m_colorLookupTableMapping.steps = m_colorRampSteps;
+	m_colorLookupTableMapping.scale = scale;
+	m_colorLookupTableMapping.scaleUpdateCount = scaleUpdateCount;
+}
+
+size_t ccScalarField::convertToColors(const ScalarType* values, size_t count, ccColor::Rgb* colors, unsigned step/*=1*/) const
+{
+	assert(values && colors && step != 0);
+	const size_t outputCount = (count + step - 1) / step;
+
+	updateColorLookupTable();
+	if (m_colorLookupTable.empty())
+	{
+		//slow path
+		for (size_t i = 0; i < outputCount; ++i, values += step)
+		{
+			const ccColor::Rgb* col = getColor(*values);
+			colors[i] = (col ? *col : ccColor::lightGrey);
+		}
+		return outputCount;
+	}
+
+	const ccColor::Rgb* lut = m_colorLookupTable.data();
+	const unsigned steps = m_colorRampSteps;
+	const double quantizationFactor = static_cast<double>(steps) * 65535.0;
+	const ScalarType displayStart = m_displayRange.start();
+	const ScalarType displayStop = m_displayRange.stop();
+
+	//we compute the color indexes of a block of values first (this loop
+	//can be vectorized by the compiler) and then we fetch the colors
+	static const size_t BlockSize = 1024;
+	unsigned indexes[BlockSize];
+
+	for (size_t blockStart = 0; blockStart < outputCount; blockStart += BlockSize)
+	{
+		const size_t blockSize = std::min(BlockSize, outputCount - blockStart);
+		const ScalarType* _values = values + blockStart * step;
+
+		if (!m_logScale && !m_symmetricalScale)
+		{
+			//most probable path first! (same computation as 'normalize')
+			const ScalarType satStart = m_saturationRange.start();
+			const ScalarType satStop = m_saturationRange.stop();
+			const ScalarType satRange = m_saturationRange.range();
+			for (size_t i = 0; i < blockSize; ++i, _values += step)
+			{
+				const ScalarType val = *_values;
+				const bool inRange = (val >= displayStart && val <= displayStop); //NaN values are also rejected
+				const ScalarType d = (inRange ? val : satStart);
+				ScalarType relativePos = (d - satStart) / satRange;
+				relativePos = (d >= satStop ? static_cast<ScalarType>(1) : relativePos);
+				relativePos = (d <= satStart ? 0 : relativePos);
+				const unsigned index = static_cast<unsigned>(relativePos * quantizationFactor) >> 16;
+				indexes[i] = (inRange ? index : steps);
+			}
+		}
+		else
+		{
+			for (size_t i = 0; i < blockSize; ++i, _values += step)
+			{
+				const ScalarType relativePos = normalize(*_values);
+				indexes[i] = (relativePos >= 0 ? static_cast<unsigned>(relativePos * quantizationFactor) >> 16 : steps);
+			}
+		}
+
+		ccColor::Rgb* _colors = colors + blockStart;
+		for (size_t i = 0; i < blockSize; ++i)
+		{
+			_colors[i] = lut[indexes[i]];
+		}
+	}
+
+	return outputCount;
+}
+
 void ccScalarField::setColorScale(ccColorScale::Shared scale)
 {
 	if (m_colorScale != scale)
@@ -131,7 +327,7 @@ void ccScalarField::setColorScale(ccColorScale::Shared scale)
 		if (isAbsolute || wasAbsolute != isAbsolute)
 			updateSaturationBounds();
 
-		m_modified = true;
+		setModified();
 	}
 }
 
@@ -142,7 +338,7 @@ void ccScalarField::setSymmetricalScale(bool state)
 		m_symmetricalScale = state;
 		updateSaturationBounds();
 
-		m_modified = true;
+		setModified();
 	}
 }
 
@@ -156,13 +352,14 @@ void ccScalarField::setLogScale(bool state)
 			ccLog::Warning("[ccScalarField] Scalar field contains negative values! Log scale will only consider absolute values...");
 		}
 
-		m_modified = true;
+		setModified();
 	}
 }
 
 void ccScalarField::computeMinAndMax()
 {
 	ScalarField::computeMinAndMax();
+	m_valuesModificationStamp = NewModificationStamp();
 
 	m_displayRange.setBounds(m_minVal, m_maxVal);
 
@@ -214,7 +411,7 @@ void ccScalarField::computeMinAndMax()
 		}
 	}
 
-	m_modified = true;
+	setModified();
 
 	updateSaturationBounds();
 }
@@ -263,19 +460,19 @@ void ccScalarField::updateSaturationBounds()
 		}
 	}
 
-	m_modified = true;
+	setModified();
 }
 
 void ccScalarField::setMinDisplayed(ScalarType val)
 {
 	m_displayRange.setStart(val);
-	m_modified = true;
+	setModified();
 }
 	
 void ccScalarField::setMaxDisplayed(ScalarType val)
 {
 	m_displayRange.setStop(val);
-	m_modified = true;
+	setModified();
 }
 
 void ccScalarField::setSaturationStart(ScalarType val)
@@ -288,7 +485,7 @@ void ccScalarField::setSaturationStart(ScalarType val)
 	{
 		m_saturationRange.setStart(val);
 	}
-	m_modified = true;
+	setModified();
 }
 
 void ccScalarField::setSaturationStop(ScalarType val)
@@ -301,7 +498,7 @@ void ccScalarField::setSaturationStop(ScalarType val)
 	{
 		m_saturationRange.setStop(val);
 	}
-	m_modified = true;
+	setModified();
 }
 
 void ccScalarField::setColorRampSteps(unsigned steps)
@@ -313,7 +510,7 @@ void ccScalarField::setColorRampSteps(unsigned steps)
 	else
 		m_colorRampSteps = steps;
 
-	m_modified = true;
+	setModified();
 }
 
 bool ccScalarField::toFile(QFile& out) const
@@ -611,7 +808,7 @@ bool ccScalarField::fromFile(QFile& in, short dataVersion, int flags)
 	m_logSaturationRange.setStart((ScalarType)minLogSaturation);
 	m_logSaturationRange.setStop((ScalarType)maxLogSaturation);
 
-	m_modified = true;
+	setModified();
 
 	return true;
 }
@@ -629,13 +826,13 @@ bool ccScalarField::mayHaveHiddenValues() const
 void ccScalarField::showNaNValuesInGrey(bool state)
 {
 	m_showNaNValuesInGrey = state;
-	m_modified = true;
+	setModified();
 }
 
 void ccScalarField::alwaysShowZero(bool state)
 {
 	m_alwaysShowZero = state;
-	m_modified = true;
+	setModified();
 }
 
 void ccScalarField::importParametersFrom(const ccScalarField* sf)
@@ -24,6 +24,9 @@
 //qCC_db
 #include "ccColorScale.h"
 
+//System
+#include <cstdint>
+
 //! A scalar field associated to display-related parameters
 /** Extends the CCLib::ScalarField object.
 **/
@@ -31,6 +34,14 @@ class ccScalarField : public CCLib::ScalarField, public ccSerializableObject
 {
 public:
 
+	//! Modification stamp
+	/** The stamps are unique among all the scalar fields of the process: a
+		consumer that stores a scalar field pointer along with one of its
+		stamps can't be fooled by another scalar field created at the same
+		address afterwards.
+	**/
+	typedef std::uint64_t ModificationStamp;
+
 	//! Default constructor
 	/** \param name scalar field name
 	**/
@@ -139,6 +150,62 @@ public:
 	//! Shortcut to getColor
 	inline const ccColor::Rgb* getValueColor(unsigned index) const { return getColor(getValue(index)); }
 
+	//! Converts a set of scalar values to colors (wrt to the current display parameters)
+	/** Gives the same colors as getColor, but much faster: the color scale is sampled
+		once in a lookup table (see updateColorLookupTable) and the most common mapping
+		(linear, non symmetrical) is processed without branching.
+		The values without color (NaN or out of the displayed range values, if they are
+		hidden) are converted to light grey.
+		\warning Can be called concurrently as long as the lookup table is up to date
+		\param values scalar values
+		\param count number of values
+		\param colors output colors (at least (count + step - 1) / step elements)
+		\param step step between two consecutive values to convert (decimation)
+		\return the number of converted values
+	**/
+	QCC_DB_LIB_API size_t convertToColors(const ScalarType* values, size_t count, ccColor::Rgb* colors, unsigned step = 1) const;
+
+	//! Updates the color lookup table used by convertToColors (if necessary)
+	QCC_DB_LIB_API void updateColorLookupTable() const;
+
+	//! Color mapping parameters (i.e. everything that defines the color of a given value)
+	struct ColorMapping
+	{
+		ColorMapping()
+			: displayStart(0), displayStop(0)
+			, saturationStart(0), saturationStop(0)
+			, logScale(false), symmetricalScale(false), nanValuesInGrey(true)
+			, steps(0), scale(nullptr), scaleUpdateCount(0)
+		{}
+
+		ScalarType displayStart, displayStop;
+		ScalarType saturationStart, saturationStop;
+		bool logScale, symmetricalScale, nanValuesInGrey;
+		unsigned steps;
+		const ccColorScale* scale;
+		unsigned scaleUpdateCount;
+	};
+
+	//! Returns the current color mapping parameters
+	QCC_DB_LIB_API ColorMapping getColorMapping() const;
+
+	//! Returns whether the values of a given interval have the same colors with the current and another color mapping
+	/** The test is conservative (i.e. it may return false even if the colors are actually the same).
+		Can be used to only update the colors of the points that are affected by a modification
+		of the display parameters (e.g. when the saturation is modified).
+		\param mapping other color mapping
+		\param minVal interval lower bound
+		\param maxVal interval upper bound (an empty interval, i.e. minVal > maxVal, only contains NaN values)
+		\return whether the colors are the same
+	**/
+	QCC_DB_LIB_API bool haveSameColors(const ColorMapping& mapping, ScalarType minVal, ScalarType maxVal) const;
+
+	//! Returns the stamp of the last modification of the values
+	/** The values are considered as modified each time computeMinAndMax is called.
+		See ModificationStamp.
+	**/
+	inline ModificationStamp getValuesModificationStamp() const { return m_valuesModificationStamp; }
+
 	//! Sets whether NaN/out of displayed range values should be displayed in grey or hidden
 	QCC_DB_LIB_API void showNaNValuesInGrey(bool state);
 
@@ -202,6 +269,12 @@ public:
 	inline void setModificationFlag(bool state) { m_modified = state; }
 	//! Returns modification flag state
 	inline bool getModificationFlag() const { return m_modified; }
+	//! Returns the stamp of the last modification
+	/** Contrary to the modification flag, the stamp is never reset (it can
+		be used by several consumers to know whether they are up to date).
+		See ModificationStamp.
+	**/
+	inline ModificationStamp getModificationStamp() const { return m_modificationStamp; }
 
 	//! Imports the parameters from another scalar field
 	QCC_DB_LIB_API void importParametersFrom(const ccScalarField* sf);
@@ -276,6 +349,25 @@ protected: //members
 	**/
 	bool m_modified;
 
+	//! Modification stamp (see getModificationStamp)
+	ModificationStamp m_modificationStamp;
+
+	//! Returns a new (unique) modification stamp
+	QCC_DB_LIB_API static ModificationStamp NewModificationStamp();
+
+	//! Turns the modification flag on and updates the modification stamp
+	inline void setModified() { m_modified = true; m_modificationStamp = NewModificationStamp(); }
+
+	//! Values modification stamp (see getValuesModificationStamp)
+	ModificationStamp m_valuesModificationStamp;
+
+	//! Color lookup table (see convertToColors)
+	/** Contains one color per color ramp step, plus the color of the values without color.
+	**/
+	mutable std::vector<ccColor::Rgb> m_colorLookupTable;
+	//! Color mapping used to build the color lookup table
+	mutable ColorMapping m_colorLookupTableMapping;
+
 	//! Global shift
 	double m_globalShift;
 };
@@ -28,6 +28,8 @@
 //System
 #include <cassert>
 #include <cstdint>
+#include <limits>
+#include <vector>
 
 //Qt
 #include <QDataStream>
@@ -96,6 +98,12 @@ class ccSerializationHelper
 {
 public:
 
+	//! Marker of a 64 bits element count in an array header (dataVersion >= 49)
+	/** Only written for arrays with more than 4 billion elements (i.e. with 64 bits indexes).
+		The actual count is stored as a 64 bits integer right after this marker.
+	**/
+	static const ::uint32_t ElementCount64BitsMarker = 0xFFFFFFFF;
+
 	//! Reads one or several 'PointCoordinateType' values from a QDataStream either in float or double format depending on the 'flag' value
 	static void CoordsFromDataStream(QDataStream& stream, int flags, PointCoordinateType* out, unsigned count = 1)
 	{
@@ -162,9 +170,21 @@ public:
 			return ccSerializableObject::WriteError();
 
 		//element count = array size (dataVersion>=20)
-		::uint32_t elementCount = static_cast<::uint32_t>(data.size());
-		if (out.write((const char*)&elementCount, 4) < 0)
-			return ccSerializableObject::WriteError();
+		::uint64_t elementCount = static_cast<::uint64_t>(data.size());
+		if (elementCount < ElementCount64BitsMarker)
+		{
+			::uint32_t elementCount32 = static_cast<::uint32_t>(elementCount);
+			if (out.write((const char*)&elementCount32, 4) < 0)
+				return ccSerializableObject::WriteError();
+		}
+		else
+		{
+			//64 bits element count (dataVersion>=49)
+			const ::uint32_t marker = ElementCount64BitsMarker;
+			if (	out.write((const char*)&marker, 4) < 0
+				||	out.write((const char*)&elementCount, 8) < 0)
+				return ccSerializableObject::WriteError();
+		}
 
 		//array data (dataVersion>=20)
 		{
@@ -194,7 +214,7 @@ public:
 	template <class Type, int N, class ComponentType> static bool GenericArrayFromFile(std::vector<Type>& data, QFile& in, short dataVersion)
 	{
 		::uint8_t componentCount = 0;
-		::uint32_t elementCount = 0;
+		::uint64_t elementCount = 0;
 		if (!ReadArrayHeader(in, dataVersion, componentCount, elementCount))
 		{
 			return false;
@@ -248,7 +268,7 @@ public:
 	template <class Type, int N, class ComponentType, class FileComponentType> static bool GenericArrayFromTypedFile(std::vector<Type>& data, QFile& in, short dataVersion)
 	{
 		::uint8_t componentCount = 0;
-		::uint32_t elementCount = 0;
+		::uint64_t elementCount = 0;
 		if (!ReadArrayHeader(in, dataVersion, componentCount, elementCount))
 		{
 			return false;
@@ -276,7 +296,7 @@ public:
 			FileComponentType dummyArray[N] = { 0 };
 
 			ComponentType* _data = (ComponentType*)data.data();
-			for (unsigned i = 0; i < elementCount; ++i)
+			for (::uint64_t i = 0; i < elementCount; ++i)
 			{
 				if (in.read((char*)dummyArray, sizeof(FileComponentType) * N) >= 0)
 				{
@@ -300,7 +320,7 @@ protected:
 	static bool ReadArrayHeader(QFile& in,
 								short dataVersion,
 								::uint8_t &componentCount,
-								::uint32_t &elementCount)
+								::uint64_t &elementCount)
 	{
 		assert(in.isOpen() && (in.openMode() & QIODevice::ReadOnly));
 
@@ -312,8 +332,24 @@ protected:
 			return ccSerializableObject::ReadError();
 
 		//element count = array size (dataVersion>=20)
-		if (in.read((char*)&elementCount, 4) < 0)
+		::uint32_t elementCount32 = 0;
+		if (in.read((char*)&elementCount32, 4) < 0)
 			return ccSerializableObject::ReadError();
+		elementCount = elementCount32;
+
+		//64 bits element count (dataVersion>=49)
+		if (dataVersion >= 49 && elementCount32 == ElementCount64BitsMarker)
+		{
+			if (in.read((char*)&elementCount, 8) < 0)
+				return ccSerializableObject::ReadError();
+		}
+
+		//the entities can't hold more elements than the number of points a cloud can hold
+		if (elementCount > std::numeric_limits<PointIndexType>::max())
+		{
+			ccLog::Warning("[BIN] Array too big for this version (64 bits point indexes are required)");
+			return ccSerializableObject::MemoryError();
+		}
 
 		return true;
 	}
@@ -18,10 +18,12 @@
 #include "AsciiFilter.h"
 
 //Qt
+#include <QByteArray>
 #include <QFile>
 #include <QFileInfo>
 #include <QSharedPointer>
 #include <QTextStream>
+#include <QtConcurrentMap>
 
 //CClib
 #include <ScalarField.h>
@@ -37,7 +39,9 @@
 
 //System
 #include <cassert>
+#include <cmath>
 #include <cstring>
+#include <limits>
 
 //Qt
 #include <QScopedPointer>
@@ -710,6 +714,312 @@ cloudAttributesDescriptor prepareCloud(	const AsciiOpenDlg::Sequence &openSequen
 	return cloudDesc;
 }
 
+//! Fast ASCII (block) parser
+/** The file is read by big blocks (split at line boundaries). The lines of each block
+	are then parsed in parallel, directly from the bytes (i.e. without creating QString
+	instances), and the results are merged in the cloud(s) in the original order.
+**/
+namespace AsciiBlockParser
+{
+	//! How a column should be converted
+	enum ColumnType : unsigned char
+	{
+		IGNORED_COLUMN,
+		COORD_COLUMN,	//!< double (the line is corrupted if the conversion fails)
+		DOUBLE_COLUMN,	//!< same as QString::toDouble (0 if the conversion fails)
+		FLOAT_COLUMN,	//!< same as QString::toFloat (0 if the conversion fails)
+		INT_COLUMN,		//!< same as QString::toInt (0 if the conversion fails)
+		LABEL_COLUMN,	//!< raw text
+	};
+
+	//! Parsed line
+	struct Line
+	{
+		enum Status : unsigned char
+		{
+			EMPTY,
+			COMMENT,
+			MISSING_PARTS,
+			CORRUPTED,
+			VALID
+		};
+
+		//! Line start (relative to the block start)
+		size_t begin;
+		//! Line end (relative to the block start, without the end-of-line characters)
+		size_t end;
+		//! Label start and end (relative to the block start)
+		size_t labelBegin, labelEnd;
+		//! Number of parts (only exact if the status is MISSING_PARTS)
+		int partCount;
+		//! Status
+		Status status;
+	};
+
+	static inline bool IsSpace(char c)
+	{
+		//same as QChar::isSpace for ASCII characters
+		return (c == ' ' || (c >= '\t' && c <= '\r'));
+	}
+
+	//! Converts a string to a double
+	/** Same behavior as QString::toDouble (i.e. C locale, leading and trailing spaces are ignored).
+		Numbers with up to 15 significant digits (and a reasonable exponent) are converted directly
+		(and exactly), otherwise we fall back to Qt.
+	**/
+	static bool ToDouble(const char* begin, const char* end, double& value)
+	{
+		static const double s_powersOf10[] = {	1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+												1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+
+		while (begin != end && IsSpace(*begin))
+			++begin;
+		while (end != begin && IsSpace(*(end - 1)))
+			--end;
+
+		const char* p = begin;
+		bool negative = false;
+		if (p != end && (*p == '-' || *p == '+'))
+		{
+			negative = (*p == '-');
+			++p;
+		}
+
+		uint64_t mantissa = 0;
+		int significantDigits = 0;
+		int exponent = 0;
+		bool hasDigits = false;
+
+		//integer part
+		for (; p != end && *p >= '0' && *p <= '9'; ++p)
+		{
+			hasDigits = true;
+			if (mantissa != 0 || *p != '0')
+			{
+				if (++significantDigits > 15)
+					break;
+				mantissa = mantissa * 10 + static_cast<unsigned>(*p - '0');
+			}
+		}
+		//decimal part
+		if (significantDigits <= 15 && p != end && *p == '.')
+		{
+			for (++p; p != end && *p >= '0' && *p <= '9'; ++p)
+			{
+				hasDigits = true;
+				if (mantissa != 0 || *p != '0')
+				{
+					if (++significantDigits > 15)
+						break;
+					mantissa = mantissa * 10 + static_cast<unsigned>(*p - '0');
+				}
+				--exponent;
+			}
+		}
+		//exponent
+		if (significantDigits <= 15 && hasDigits && p != end && (*p == 'e' || *p == 'E'))
+		{
+			++p;
+			bool negativeExp = false;
+			if (p != end && (*p == '-' || *p == '+'))
+			{
+				negativeExp = (*p == '-');
+				++p;
+			}
+			if (p == end || *p < '0' || *p > '9')
+			{
+				hasDigits = false; //malformed exponent
+			}
+			int exp = 0;
+			for (; p != end && *p >= '0' && *p <= '9'; ++p)
+			{
+				if (exp < 10000)
+					exp = exp * 10 + (*p - '0');
+			}
+			exponent += (negativeExp ? -exp : exp);
+		}
+
+		if (significantDigits <= 15 && hasDigits && p == end && exponent >= -22 && exponent <= 22)
+		{
+			//both the mantissa and the power of 10 are exact: the result is correctly rounded
+			value = static_cast<double>(mantissa);
+			if (exponent > 0)
+				value *= s_powersOf10[exponent];
+			else if (exponent < 0)
+				value /= s_powersOf10[-exponent];
+			if (negative)
+				value = -value;
+			return true;
+		}
+
+		//fall back to Qt (long numbers, 'nan', 'inf', invalid strings, etc.)
+		bool ok = false;
+		value = QByteArray(begin, static_cast<int>(end - begin)).toDouble(&ok);
+		return ok;
+	}
+
+	//! Converts a string to a float (same behavior as QString::toFloat)
+	static float ToFloat(const char* begin, const char* end)
+	{
+		double value = 0;
+		if (!ToDouble(begin, end, value) || std::abs(value) > std::numeric_limits<float>::max())
+			return 0;
+		return static_cast<float>(value);
+	}
+
+	//! Converts a string to an int (same behavior as QString::toInt)
+	static int ToInt(const char* begin, const char* end)
+	{
+		while (begin != end && IsSpace(*begin))
+			++begin;
+		while (end != begin && IsSpace(*(end - 1)))
+			--end;
+
+		bool negative = false;
+		if (begin != end && (*begin == '-' || *begin == '+'))
+		{
+			negative = (*begin == '-');
+			++begin;
+		}
+		if (begin == end)
+			return 0;
+
+		int64_t value = 0;
+		for (; begin != end; ++begin)
+		{
+			if (*begin < '0' || *begin > '9')
+				return 0;
+			value = value * 10 + (*begin - '0');
+			if (value > static_cast<int64_t>(std::numeric_limits<int>::max()) + 1)
+				return 0;
+		}
+		if (negative)
+			value = -value;
+		if (value > std::numeric_limits<int>::max())
+			return 0;
+		return static_cast<int>(value);
+	}
+
+	//! Parses one line
+	/** \param data block data
+		\param line line to parse (begin and end must be set)
+		\param separator column separator
+		\param columnTypes conversion type of each column (the last one is the max. part index)
+		\param values output values (one per column)
+	**/
+	static void ParseLine(	const char* data,
+							Line& line,
+							char separator,
+							const std::vector<ColumnType>& columnTypes,
+							double* values)
+	{
+		const char* begin = data + line.begin;
+		const char* end = data + line.end;
+		line.partCount = 0;
+		line.labelBegin = line.labelEnd = line.begin;
+
+		if (begin == end)
+		{
+			line.status = Line::EMPTY;
+			return;
+		}
+		if (end - begin >= 2 && begin[0] == '/' && begin[1] == '/')
+		{
+			line.status = Line::COMMENT;
+			return;
+		}
+
+		bool corrupted = false;
+		const int columnCount = static_cast<int>(columnTypes.size());
+		const char* p = begin;
+		while (p != end && line.partCount < columnCount)
+		{
+			//skip the empty parts
+			if (*p == separator)
+			{
+				++p;
+				continue;
+			}
+			const char* partEnd = static_cast<const char*>(memchr(p, separator, end - p));
+			if (!partEnd)
+				partEnd = end;
+
+			double& value = values[line.partCount];
+			switch (columnTypes[line.partCount])
+			{
+			case COORD_COLUMN:
+				if (!corrupted && !ToDouble(p, partEnd, value))
+					corrupted = true;
+				break;
+			case DOUBLE_COLUMN:
+				if (!ToDouble(p, partEnd, value))
+					value = 0;
+				break;
+			case FLOAT_COLUMN:
+				value = ToFloat(p, partEnd);
+				break;
+			case INT_COLUMN:
+				value = ToInt(p, partEnd);
+				break;
+			case LABEL_COLUMN:
+				line.labelBegin = static_cast<size_t>(p - data);
+				line.labelEnd = static_cast<size_t>(partEnd - data);
+				break;
+			default:
+				break;
+			}
+
+			++line.partCount;
+			p = partEnd;
+		}
+
+		if (line.partCount < columnCount)
+			line.status = Line::MISSING_PARTS;
+		else if (corrupted)
+			line.status = Line::CORRUPTED;
+		else
+			line.status = Line::VALID;
+	}
+
+	//! Splits a block in lines (same rules as QTextStream::readLine)
+	/** \param data block data
+		\param size block size
+		\param lines output lines
+		\return the number of bytes consumed (i.e. up to the last end-of-line character if lastBlock is false)
+	**/
+	static size_t SplitLines(const char* data, size_t size, bool lastBlock, std::vector<Line>& lines)
+	{
+		lines.clear();
+		size_t pos = 0;
+		while (pos < size)
+		{
+			const char* eol = static_cast<const char*>(memchr(data + pos, '\n', size - pos));
+			if (!eol && !lastBlock)
+			{
+				//incomplete line
+				break;
+			}
+			size_t lineEnd = (eol ? static_cast<size_t>(eol - data) : size);
+			size_t next = (eol ? lineEnd + 1 : size);
+			if (lineEnd > pos && data[lineEnd - 1] == '\r')
+			{
+				--lineEnd;
+			}
+
+			Line line;
+			line.begin = pos;
+			line.end = lineEnd;
+			line.partCount = 0;
+			line.status = Line::EMPTY;
+			line.labelBegin = line.labelEnd = pos;
+			lines.push_back(line);
+
+			pos = next;
+		}
+		return pos;
+	}
+}
+
 CC_FILE_ERROR AsciiFilter::loadCloudFromFormatedAsciiFile(	const QString& filename,
 															ccHObject& container,
 															const AsciiOpenDlg::Sequence& openSequence,
@@ -722,7 +1032,7 @@ CC_FILE_ERROR AsciiFilter::loadCloudFromFormatedAsciiFile(	const QString& filena
 															bool showLabelsIn2D/*=false*/)
 {
 	//we may have to "slice" clouds when opening them if they are too big!
-	maxCloudSize = std::min(maxCloudSize, CC_MAX_NUMBER_OF_POINTS_PER_CLOUD);
+	maxCloudSize = static_cast<unsigned>(std::min<PointIndexType>(maxCloudSize, CC_MAX_NUMBER_OF_POINTS_PER_CLOUD));
 	unsigned cloudChunkSize = std::min(maxCloudSize, approximateNumberOfLines);
 	unsigned cloudChunkPos = 0;
 	unsigned chunkRank = 1;
@@ -736,7 +1046,7 @@ CC_FILE_ERROR AsciiFilter::loadCloudFromFormatedAsciiFile(	const QString& filena
 		return CC_FERR_NOT_ENOUGH_MEMORY;
 	}
 
-	//we re-open the file (ASCII mode)
+	//we re-open the file
 	QFile file(filename);
 	if (!file.open(QFile::ReadOnly))
 	{
@@ -744,22 +1054,67 @@ CC_FILE_ERROR AsciiFilter::loadCloudFromFormatedAsciiFile(	const QString& filena
 		clearStructure(cloudDesc);
 		return CC_FERR_READING;
 	}
-	QTextStream stream(&file);
 
-	//we skip lines as defined on input
+	//byte order mark (if any)
+	QScopedPointer<QTextStream> utf16Stream(nullptr);
 	{
-		for (unsigned i = 0; i < skipLines;)
+		char bom[3] = { 0, 0, 0 };
+		qint64 bomSize = file.peek(bom, 3);
+		if (bomSize >= 2 && ((bom[0] == '\xFF' && bom[1] == '\xFE') || (bom[0] == '\xFE' && bom[1] == '\xFF')))
 		{
-			QString currentLine = stream.readLine();
-			if (currentLine.isEmpty())
-			{
-				//empty lines are ignored
-				continue;
-			}
-			++i;
+			//UTF-16 files are decoded by QTextStream (line by line, as before) and parsed as UTF-8
+			utf16Stream.reset(new QTextStream(&file));
+		}
+		else if (bomSize == 3 && bom[0] == '\xEF' && bom[1] == '\xBB' && bom[2] == '\xBF')
+		{
+			//skip the UTF-8 BOM
+			file.seek(3);
 		}
 	}
 
+	//conversion type of each column
+	std::vector<AsciiBlockParser::ColumnType> columnTypes;
+	try
+	{
+		columnTypes.resize(static_cast<size_t>(maxPartIndex + 1), AsciiBlockParser::IGNORED_COLUMN);
+	}
+	catch (const std::bad_alloc&)
+	{
+		clearStructure(cloudDesc);
+		return CC_FERR_NOT_ENOUGH_MEMORY;
+	}
+	{
+		if (cloudDesc.xCoordIndex >= 0)
+			columnTypes[cloudDesc.xCoordIndex] = AsciiBlockParser::COORD_COLUMN;
+		if (cloudDesc.yCoordIndex >= 0)
+			columnTypes[cloudDesc.yCoordIndex] = AsciiBlockParser::COORD_COLUMN;
+		if (cloudDesc.zCoordIndex >= 0)
+			columnTypes[cloudDesc.zCoordIndex] = AsciiBlockParser::COORD_COLUMN;
+		if (cloudDesc.xNormIndex >= 0)
+			columnTypes[cloudDesc.xNormIndex] = AsciiBlockParser::DOUBLE_COLUMN;
+		if (cloudDesc.yNormIndex >= 0)
+			columnTypes[cloudDesc.yNormIndex] = AsciiBlockParser::DOUBLE_COLUMN;
+		if (cloudDesc.zNormIndex >= 0)
+			columnTypes[cloudDesc.zNormIndex] = AsciiBlockParser::DOUBLE_COLUMN;
+		if (cloudDesc.redIndex >= 0)
+			columnTypes[cloudDesc.redIndex] = AsciiBlockParser::FLOAT_COLUMN;
+		if (cloudDesc.greenIndex >= 0)
+			columnTypes[cloudDesc.greenIndex] = AsciiBlockParser::FLOAT_COLUMN;
+		if (cloudDesc.blueIndex >= 0)
+			columnTypes[cloudDesc.blueIndex] = AsciiBlockParser::FLOAT_COLUMN;
+		if (cloudDesc.iRgbaIndex >= 0)
+			columnTypes[cloudDesc.iRgbaIndex] = AsciiBlockParser::INT_COLUMN;
+		if (cloudDesc.fRgbaIndex >= 0)
+			columnTypes[cloudDesc.fRgbaIndex] = AsciiBlockParser::FLOAT_COLUMN;
+		if (cloudDesc.greyIndex >= 0)
+			columnTypes[cloudDesc.greyIndex] = AsciiBlockParser::INT_COLUMN;
+		if (cloudDesc.labelIndex >= 0)
+			columnTypes[cloudDesc.labelIndex] = AsciiBlockParser::LABEL_COLUMN;
+		for (int sfIndex : cloudDesc.scalarIndexes)
+			columnTypes[sfIndex] = AsciiBlockParser::DOUBLE_COLUMN;
+	}
+	const size_t columnCount = columnTypes.size();
+
 	//progress indicator
 	QScopedPointer<ccProgressDialog> pDlg(nullptr);
 	if (parameters.parentWidget)
@@ -779,7 +1134,32 @@ CC_FILE_ERROR AsciiFilter::loadCloudFromFormatedAsciiFile(	const QString& filena
 	ccColor::Rgb col;
 	bool preserveCoordinateShift = true;
 
+	//file blocks
+	static const qint64 BlockSize = (1 << 24); //16 Mb
+	std::vector<char> block;
+	size_t blockDataSize = 0;
+	qint64 blockPos = 0; //position of the block in the file
+	bool endOfFile = false;
+	std::vector<AsciiBlockParser::Line> lines;
+	std::vector<double> values;
+
+	//parsing tasks (ranges of lines)
+	struct LineRange
+	{
+		size_t first, last;
+	};
+	std::vector<LineRange> lineRanges;
+	static const size_t LinesPerTask = 4096;
+	auto parseLines = [&](const LineRange& range)
+	{
+		for (size_t i = range.first; i < range.last; ++i)
+		{
+			AsciiBlockParser::ParseLine(block.data(), lines[i], separator, columnTypes, values.data() + i * columnCount);
+		}
+	};
+
 	//other useful variables
+	unsigned skippedLines = 0;
 	unsigned linesRead = 0;
 	unsigned pointsRead = 0;
 
@@ -787,250 +1167,324 @@ CC_FILE_ERROR AsciiFilter::loadCloudFromFormatedAsciiFile(	const QString& filena
 
 	//main process
 	unsigned nextLimit = /*cloudChunkPos+*/cloudChunkSize;
-	while (true)
+	bool stop = false;
+	while (!stop)
 	{
-		//read next line
-		QString currentLine = stream.readLine();
-		if (currentLine.isNull())
+		//read next block (after the incomplete line left by the previous one)
+		if (!endOfFile)
 		{
-			//end of file
-			break;
-		}
-		++linesRead;
-
-		if (currentLine.isEmpty() || currentLine.startsWith("//"))
-		{
-			//empty lines and comments are ignored
-			continue;
-		}
-
-		//if we have reached the max. number of points per cloud
-		if (pointsRead == nextLimit)
-		{
-			ccLog::PrintDebug("[ASCII] Point %i -> end of chunk (%i points)",pointsRead,cloudChunkSize);
-
-			//we re-evaluate the average line size
+			try
 			{
-				double averageLineSize = static_cast<double>(file.pos()) / (pointsRead + skipLines);
-				double newNbOfLinesApproximation = std::max(1.0, static_cast<double>(fileSize) / averageLineSize - static_cast<double>(skipLines));
-
-				//if approximation is smaller than actual one, we add 2% by default
-				if (newNbOfLinesApproximation <= pointsRead)
-				{
-					newNbOfLinesApproximation = std::max(static_cast<double>(cloudChunkPos + cloudChunkSize) + 1.0, static_cast<double>(pointsRead)* 1.02);
-				}
-				approximateNumberOfLines = static_cast<unsigned>(ceil(newNbOfLinesApproximation));
-				ccLog::PrintDebug("[ASCII] New approximate nb of lines: %i", approximateNumberOfLines);
+				block.resize(blockDataSize + BlockSize);
 			}
-
-			//we try to resize actual clouds
-			if (cloudChunkSize < maxCloudSize || approximateNumberOfLines - cloudChunkPos <= maxCloudSize)
+			catch (const std::bad_alloc&)
 			{
-				ccLog::PrintDebug("[ASCII] We choose to enlarge existing clouds");
-
-				cloudChunkSize = std::min(maxCloudSize, approximateNumberOfLines - cloudChunkPos);
-				if (!cloudDesc.cloud->reserve(cloudChunkSize))
-				{
-					ccLog::Error("Not enough memory! Process stopped ...");
-					result = CC_FERR_NOT_ENOUGH_MEMORY;
-					break;
-				}
+				ccLog::Error("Not enough memory! Process stopped ...");
+				result = CC_FERR_NOT_ENOUGH_MEMORY;
+				break;
 			}
-			else //otherwise we have to create new clouds
+			if (utf16Stream)
 			{
-				ccLog::PrintDebug("[ASCII] We choose to instantiate new clouds");
-
-				//we store (and resize) actual cloud
-				if (!cloudDesc.cloud->resize(cloudChunkSize))
-					ccLog::Warning("Memory reallocation failed ... some memory may have been wasted ...");
-				if (!cloudDesc.scalarFields.empty())
+				QByteArray decodedLines;
+				while (decodedLines.size() < BlockSize && !utf16Stream->atEnd())
 				{
-					for (unsigned k = 0; k < cloudDesc.scalarFields.size(); ++k)
-						cloudDesc.scalarFields[k]->computeMinAndMax();
-					cloudDesc.cloud->setCurrentDisplayedScalarField(0);
-					cloudDesc.cloud->showSF(true);
+					decodedLines += utf16Stream->readLine().toUtf8();
+					decodedLines += '\n';
 				}
-				//we add this cloud to the output container
-				container.addChild(cloudDesc.cloud);
-				cloudDesc.reset();
-
-				//and create new one
-				cloudChunkPos = pointsRead;
-				cloudChunkSize = std::min(maxCloudSize, approximateNumberOfLines - cloudChunkPos);
-				cloudDesc = prepareCloud(openSequence, cloudChunkSize, maxPartIndex, separator, ++chunkRank);
-				if (!cloudDesc.cloud)
+				try
+				{
+					block.resize(blockDataSize + static_cast<size_t>(decodedLines.size()));
+				}
+				catch (const std::bad_alloc&)
 				{
 					ccLog::Error("Not enough memory! Process stopped ...");
+					result = CC_FERR_NOT_ENOUGH_MEMORY;
 					break;
 				}
-				if (preserveCoordinateShift)
+				memcpy(block.data() + blockDataSize, decodedLines.constData(), static_cast<size_t>(decodedLines.size()));
+				blockDataSize += static_cast<size_t>(decodedLines.size());
+				endOfFile = utf16Stream->atEnd();
+			}
+			else
+			{
+				qint64 readBytes = file.read(block.data() + blockDataSize, BlockSize);
+				if (readBytes < 0)
 				{
-					cloudDesc.cloud->setGlobalShift(Pshift);
+					result = CC_FERR_READING;
+					break;
 				}
+				blockDataSize += static_cast<size_t>(readBytes);
+				endOfFile = (readBytes == 0 || file.atEnd());
 			}
+		}
 
-			//we update the progress info
-			if (pDlg)
+		//split the block in lines and parse them (in parallel)
+		size_t consumedBytes = 0;
+		try
+		{
+			consumedBytes = AsciiBlockParser::SplitLines(block.data(), blockDataSize, endOfFile, lines);
+			values.resize(lines.size() * columnCount);
+			lineRanges.clear();
+			for (size_t i = 0; i < lines.size(); i += LinesPerTask)
 			{
-				nprogress.scale(approximateNumberOfLines, 100, true);
-				pDlg->setInfo(QObject::tr("Approximate number of points: %1").arg(approximateNumberOfLines));
+				LineRange range;
+				range.first = i;
+				range.last = std::min(i + LinesPerTask, lines.size());
+				lineRanges.push_back(range);
 			}
-
-			nextLimit = cloudChunkPos+cloudChunkSize;
 		}
+		catch (const std::bad_alloc&)
+		{
+			ccLog::Error("Not enough memory! Process stopped ...");
+			result = CC_FERR_NOT_ENOUGH_MEMORY;
+			break;
+		}
+		QtConcurrent::blockingMap(lineRanges, parseLines);
 
-		//we split current line
-		QStringList parts = currentLine.split(separator, QString::SkipEmptyParts);
-
-		int nParts = parts.size();
-		if (nParts > maxPartIndex) //fake loop for easy break
+		//merge the results (in order)
+		for (size_t lineIndex = 0; lineIndex < lines.size(); ++lineIndex)
 		{
-			//read the point coordinates
-			bool lineIsCorrupted = true;
-			for (int step = 0; step < 1; ++step) //fake loop for easy break
+			const AsciiBlockParser::Line& line = lines[lineIndex];
+
+			//we skip lines as defined on input
+			if (skippedLines < skipLines)
 			{
-				bool ok = true;
-				if (cloudDesc.xCoordIndex >= 0)
+				//empty lines are ignored
+				if (line.status != AsciiBlockParser::Line::EMPTY)
+				{
+					++skippedLines;
+				}
+				continue;
+			}
+
+			++linesRead;
+
+			if (line.status == AsciiBlockParser::Line::EMPTY || line.status == AsciiBlockParser::Line::COMMENT)
+			{
+				//empty lines and comments are ignored
+				continue;
+			}
+
+			//if we have reached the max. number of points per cloud
+			if (pointsRead == nextLimit)
+			{
+				ccLog::PrintDebug("[ASCII] Point %i -> end of chunk (%i points)",pointsRead,cloudChunkSize);
+
+				//we re-evaluate the average line size
 				{
-					P.x = parts[cloudDesc.xCoordIndex].toDouble(&ok);
-					if (!ok)
+					double averageLineSize = static_cast<double>(blockPos + line.begin) / (pointsRead + skipLines);
+					double newNbOfLinesApproximation = std::max(1.0, static_cast<double>(fileSize) / averageLineSize - static_cast<double>(skipLines));
+
+					//if approximation is smaller than actual one, we add 2% by default
+					if (newNbOfLinesApproximation <= pointsRead)
 					{
-						break;
+						newNbOfLinesApproximation = std::max(static_cast<double>(cloudChunkPos + cloudChunkSize) + 1.0, static_cast<double>(pointsRead)* 1.02);
 					}
+					approximateNumberOfLines = static_cast<unsigned>(ceil(newNbOfLinesApproximation));
+					ccLog::PrintDebug("[ASCII] New approximate nb of lines: %i", approximateNumberOfLines);
 				}
-				if (cloudDesc.yCoordIndex >= 0)
+
+				//we try to resize actual clouds
+				if (cloudChunkSize < maxCloudSize || approximateNumberOfLines - cloudChunkPos <= maxCloudSize)
 				{
-					P.y = parts[cloudDesc.yCoordIndex].toDouble(&ok);
-					if (!ok)
+					ccLog::PrintDebug("[ASCII] We choose to enlarge existing clouds");
+
+					cloudChunkSize = std::min(maxCloudSize, approximateNumberOfLines - cloudChunkPos);
+					if (!cloudDesc.cloud->reserve(cloudChunkSize))
 					{
+						ccLog::Error("Not enough memory! Process stopped ...");
+						result = CC_FERR_NOT_ENOUGH_MEMORY;
+						stop = true;
 						break;
 					}
 				}
-				if (cloudDesc.zCoordIndex >= 0)
+				else //otherwise we have to create new clouds
 				{
-					P.z = parts[cloudDesc.zCoordIndex].toDouble(&ok);
-					if (!ok)
+					ccLog::PrintDebug("[ASCII] We choose to instantiate new clouds");
+
+					//we store (and resize) actual cloud
+					if (!cloudDesc.cloud->resize(cloudChunkSize))
+						ccLog::Warning("Memory reallocation failed ... some memory may have been wasted ...");
+					if (!cloudDesc.scalarFields.empty())
+					{
+						for (unsigned k = 0; k < cloudDesc.scalarFields.size(); ++k)
+							cloudDesc.scalarFields[k]->computeMinAndMax();
+						cloudDesc.cloud->setCurrentDisplayedScalarField(0);
+						cloudDesc.cloud->showSF(true);
+					}
+					//we add this cloud to the output container
+					container.addChild(cloudDesc.cloud);
+					cloudDesc.reset();
+
+					//and create new one
+					cloudChunkPos = pointsRead;
+					cloudChunkSize = std::min(maxCloudSize, approximateNumberOfLines - cloudChunkPos);
+					cloudDesc = prepareCloud(openSequence, cloudChunkSize, maxPartIndex, separator, ++chunkRank);
+					if (!cloudDesc.cloud)
 					{
+						ccLog::Error("Not enough memory! Process stopped ...");
+						stop = true;
 						break;
 					}
+					if (preserveCoordinateShift)
+					{
+						cloudDesc.cloud->setGlobalShift(Pshift);
+					}
 				}
 
-				lineIsCorrupted = false;
+				//we update the progress info
+				if (pDlg)
+				{
+					nprogress.scale(approximateNumberOfLines, 100, true);
+					pDlg->setInfo(QObject::tr("Approximate number of points: %1").arg(approximateNumberOfLines));
+				}
+
+				nextLimit = cloudChunkPos+cloudChunkSize;
 			}
 
-			if (lineIsCorrupted)
+			//parsed values
+			const double* parts = values.data() + lineIndex * columnCount;
+
+			if (line.status == AsciiBlockParser::Line::CORRUPTED)
 			{
 				ccLog::Warning("[AsciiFilter::Load] Line %i is corrupted (non numerical value found)", linesRead);
 				continue;
 			}
-
-			//first point: check for 'big' coordinates
-			if (pointsRead == 0)
+			else if (line.status == AsciiBlockParser::Line::VALID)
 			{
-				if (HandleGlobalShift(P, Pshift, preserveCoordinateShift, parameters))
+				//read the point coordinates
+				if (cloudDesc.xCoordIndex >= 0)
+					P.x = parts[cloudDesc.xCoordIndex];
+				if (cloudDesc.yCoordIndex >= 0)
+					P.y = parts[cloudDesc.yCoordIndex];
+				if (cloudDesc.zCoordIndex >= 0)
+					P.z = parts[cloudDesc.zCoordIndex];
+
+				//first point: check for 'big' coordinates
+				if (pointsRead == 0)
 				{
-					if (preserveCoordinateShift)
+					if (HandleGlobalShift(P, Pshift, preserveCoordinateShift, parameters))
 					{
-						cloudDesc.cloud->setGlobalShift(Pshift);
+						if (preserveCoordinateShift)
+						{
+							cloudDesc.cloud->setGlobalShift(Pshift);
+						}
+						ccLog::Warning("[ASCIIFilter::loadFile] Cloud has been recentered! Translation: (%.2f ; %.2f ; %.2f)", Pshift.x, Pshift.y, Pshift.z);
 					}
-					ccLog::Warning("[ASCIIFilter::loadFile] Cloud has been recentered! Translation: (%.2f ; %.2f ; %.2f)", Pshift.x, Pshift.y, Pshift.z);
 				}
-			}
-
-			//add point
-			cloudDesc.cloud->addPoint(CCVector3::fromArray((P + Pshift).u));
-
-			//Normal vector
-			if (cloudDesc.hasNorms)
-			{
-				if (cloudDesc.xNormIndex >= 0)
-					N.x = static_cast<PointCoordinateType>(parts[cloudDesc.xNormIndex].toDouble());
-				if (cloudDesc.yNormIndex >= 0)
-					N.y = static_cast<PointCoordinateType>(parts[cloudDesc.yNormIndex].toDouble());
-				if (cloudDesc.zNormIndex >= 0)
-					N.z = static_cast<PointCoordinateType>(parts[cloudDesc.zNormIndex].toDouble());
-				cloudDesc.cloud->addNorm(N);
-			}
 
-			//Colors
-			if (cloudDesc.hasRGBColors)
-			{
-				if (cloudDesc.iRgbaIndex >= 0)
-				{
-					const uint32_t rgb = parts[cloudDesc.iRgbaIndex].toInt();
-					col.r = ((rgb >> 16) & 0x0000ff);
-					col.g = ((rgb >>  8) & 0x0000ff);
-					col.b = ((rgb      ) & 0x0000ff);
+				//add point
+				cloudDesc.cloud->addPoint(CCVector3::fromArray((P + Pshift).u));
 
-				}
-				else if (cloudDesc.fRgbaIndex >= 0)
+				//Normal vector
+				if (cloudDesc.hasNorms)
 				{
-					const float rgbf = parts[cloudDesc.fRgbaIndex].toFloat();
-					const uint32_t rgb = *(reinterpret_cast<const uint32_t *>(&rgbf));
-					col.r = ((rgb >> 16) & 0x0000ff);
-					col.g = ((rgb >>  8) & 0x0000ff);
-					col.b = ((rgb      ) & 0x0000ff);
+					if (cloudDesc.xNormIndex >= 0)
+						N.x = static_cast<PointCoordinateType>(parts[cloudDesc.xNormIndex]);
+					if (cloudDesc.yNormIndex >= 0)
+						N.y = static_cast<PointCoordinateType>(parts[cloudDesc.yNormIndex]);
+					if (cloudDesc.zNormIndex >= 0)
+						N.z = static_cast<PointCoordinateType>(parts[cloudDesc.zNormIndex]);
+					cloudDesc.cloud->addNorm(N);
 				}
-				else
+
+				//Colors
+				if (cloudDesc.hasRGBColors)
 				{
-					if (cloudDesc.redIndex >= 0)
+					if (cloudDesc.iRgbaIndex >= 0)
 					{
-						float multiplier = cloudDesc.hasFloatRGBColors[0] ? static_cast<float>(ccColor::MAX) : 1.0f;
-						col.r = static_cast<ColorCompType>(parts[cloudDesc.redIndex].toFloat() * multiplier);
+						const uint32_t rgb = static_cast<int>(parts[cloudDesc.iRgbaIndex]);
+						col.r = ((rgb >> 16) & 0x0000ff);
+						col.g = ((rgb >>  8) & 0x0000ff);
+						col.b = ((rgb      ) & 0x0000ff);
+
 					}
-					if (cloudDesc.greenIndex >= 0)
+					else if (cloudDesc.fRgbaIndex >= 0)
 					{
-						float multiplier = cloudDesc.hasFloatRGBColors[1] ? static_cast<float>(ccColor::MAX) : 1.0f;
-						col.g = static_cast<ColorCompType>(parts[cloudDesc.greenIndex].toFloat() * multiplier);
+						const float rgbf = static_cast<float>(parts[cloudDesc.fRgbaIndex]);
+						const uint32_t rgb = *(reinterpret_cast<const uint32_t *>(&rgbf));
+						col.r = ((rgb >> 16) & 0x0000ff);
+						col.g = ((rgb >>  8) & 0x0000ff);
+						col.b = ((rgb      ) & 0x0000ff);
 					}
-					if (cloudDesc.blueIndex >= 0)
+					else
 					{
-						float multiplier = cloudDesc.hasFloatRGBColors[2] ? static_cast<float>(ccColor::MAX) : 1.0f;
-						col.b = static_cast<ColorCompType>(parts[cloudDesc.blueIndex].toFloat() * multiplier);
+						if (cloudDesc.redIndex >= 0)
+						{
+							float multiplier = cloudDesc.hasFloatRGBColors[0] ? static_cast<float>(ccColor::MAX) : 1.0f;
+							col.r = static_cast<ColorCompType>(static_cast<float>(parts[cloudDesc.redIndex]) * multiplier);
+						}
+						if (cloudDesc.greenIndex >= 0)
+						{
+							float multiplier = cloudDesc.hasFloatRGBColors[1] ? static_cast<float>(ccColor::MAX) : 1.0f;
+							col.g = static_cast<ColorCompType>(static_cast<float>(parts[cloudDesc.greenIndex]) * multiplier);
+						}
+						if (cloudDesc.blueIndex >= 0)
+						{
+							float multiplier = cloudDesc.hasFloatRGBColors[2] ? static_cast<float>(ccColor::MAX) : 1.0f;
+							col.b = static_cast<ColorCompType>(static_cast<float>(parts[cloudDesc.blueIndex]) * multiplier);
+						}
 					}
+					cloudDesc.cloud->addRGBColor(col);
+				}
+				else if (cloudDesc.greyIndex >= 0)
+				{
+					col.r = col.r = col.b = static_cast<ColorCompType>(static_cast<int>(parts[cloudDesc.greyIndex]));
+					cloudDesc.cloud->addRGBColor(col);
 				}
-				cloudDesc.cloud->addRGBColor(col);
-			}
-			else if (cloudDesc.greyIndex >= 0)
-			{
-				col.r = col.r = col.b = static_cast<ColorCompType>(parts[cloudDesc.greyIndex].toInt());
-				cloudDesc.cloud->addRGBColor(col);
-			}
 
-			//Scalar distance
-			if (!cloudDesc.scalarIndexes.empty())
-			{
-				for (size_t j = 0; j < cloudDesc.scalarIndexes.size(); ++j)
+				//Scalar distance
+				if (!cloudDesc.scalarIndexes.empty())
+				{
+					for (size_t j = 0; j < cloudDesc.scalarIndexes.size(); ++j)
+					{
+						D = static_cast<ScalarType>(parts[cloudDesc.scalarIndexes[j]]);
+						cloudDesc.scalarFields[j]->emplace_back(D);
+					}
+				}
+
+				//Label
+				if (cloudDesc.labelIndex >= 0)
 				{
-					D = static_cast<ScalarType>(parts[cloudDesc.scalarIndexes[j]].toDouble());
-					cloudDesc.scalarFields[j]->emplace_back(D);
+					cc2DLabel* label = new cc2DLabel();
+					label->addPoint(cloudDesc.cloud, cloudDesc.cloud->size() - 1);
+					const char* labelName = block.data() + line.labelBegin;
+					int labelNameSize = static_cast<int>(line.labelEnd - line.labelBegin);
+					label->setName(utf16Stream ? QString::fromUtf8(labelName, labelNameSize) : QString::fromLocal8Bit(labelName, labelNameSize));
+					label->setDisplayedIn2D(showLabelsIn2D);
+					label->displayPointLegend(!showLabelsIn2D);
+					label->setVisible(true);
+					cloudDesc.cloud->addChild(label);
 				}
-			}
 
-			//Label
-			if (cloudDesc.labelIndex >= 0)
+				++pointsRead;
+			}
+			else
 			{
-				cc2DLabel* label = new cc2DLabel();
-				label->addPoint(cloudDesc.cloud, cloudDesc.cloud->size() - 1);
-				label->setName(parts[cloudDesc.labelIndex]);
-				label->setDisplayedIn2D(showLabelsIn2D);
-				label->displayPointLegend(!showLabelsIn2D);
-				label->setVisible(true);
-				cloudDesc.cloud->addChild(label);
+				ccLog::Warning("[AsciiFilter::Load] Line %i is corrupted (found %i part(s) on %i expected)!", linesRead, line.partCount, maxPartIndex + 1);
 			}
 
-			++pointsRead;
+			if (pDlg && !nprogress.oneStep())
+			{
+				//cancel requested
+				result = CC_FERR_CANCELED_BY_USER;
+				stop = true;
+				break;
+			}
 		}
-		else
+
+		if (endOfFile)
 		{
-			ccLog::Warning("[AsciiFilter::Load] Line %i is corrupted (found %i part(s) on %i expected)!", linesRead, nParts, maxPartIndex + 1);
+			//all the lines have been processed
+			break;
 		}
 
-		if (pDlg && !nprogress.oneStep())
+		//move the incomplete line at the beginning of the block
+		if (consumedBytes != 0)
 		{
-			//cancel requested
-			result = CC_FERR_CANCELED_BY_USER;
-			break;
+			memmove(block.data(), block.data() + consumedBytes, blockDataSize - consumedBytes);
+			blockDataSize -= consumedBytes;
+			blockPos += static_cast<qint64>(consumedBytes);
 		}
 	}
 
@@ -1164,8 +1164,8 @@ CC_FILE_ERROR BinFilter::LoadFileV1(QFile& in, ccHObject& container, unsigned nb
 		if (!loadedCloud)
 			return CC_FERR_NOT_ENOUGH_MEMORY;
 
-		unsigned fileChunkPos = 0;
-		unsigned fileChunkSize = std::min(nbOfPoints,CC_MAX_NUMBER_OF_POINTS_PER_CLOUD);
+		PointIndexType fileChunkPos = 0;
+		PointIndexType fileChunkSize = std::min<PointIndexType>(nbOfPoints,CC_MAX_NUMBER_OF_POINTS_PER_CLOUD);
 
 		loadedCloud->reserveThePointsTable(fileChunkSize);
 		if (header.colors)
@@ -1181,7 +1181,7 @@ CC_FILE_ERROR BinFilter::LoadFileV1(QFile& in, ccHObject& container, unsigned nb
 		if (header.scalarField)
 			loadedCloud->enableScalarField();
 
-		unsigned lineRead = 0;
+		PointIndexType lineRead = 0;
 		int parts = 0;
 
 		const ScalarType FORMER_HIDDEN_POINTS = static_cast<ScalarType>(-1.0);
@@ -1198,7 +1198,7 @@ CC_FILE_ERROR BinFilter::LoadFileV1(QFile& in, ccHObject& container, unsigned nb
 
 				container.addChild(loadedCloud);
 				fileChunkPos = lineRead;
-				fileChunkSize = std::min(nbOfPoints - lineRead, CC_MAX_NUMBER_OF_POINTS_PER_CLOUD);
+				fileChunkSize = std::min<PointIndexType>(nbOfPoints - lineRead, CC_MAX_NUMBER_OF_POINTS_PER_CLOUD);
 				char partName[64];
 				++parts;
 				sprintf(partName, "%s.part_%i", cloudName, parts);
@@ -145,7 +145,7 @@ static bool SaveScan(ccPointCloud* cloud, e57::StructureNode& scanNode, e57::Ima
 		return false;
 	}
 
-	unsigned pointCount = cloud->size();
+	PointIndexType pointCount = cloud->size();
 	if (pointCount == 0)
 	{
 		ccLog::Error(QString("[E57Filter::SaveScan] Cloud '%1' is empty!").arg(cloud->getName()));
@@ -329,7 +329,7 @@ static bool SaveScan(ccPointCloud* cloud, e57::StructureNode& scanNode, e57::Ima
 	e57::StructureNode proto = e57::StructureNode(imf);
 
 	//prepare temporary structures
-	const unsigned chunkSize = std::min<unsigned>(pointCount,(1 << 20)); //we save the file in several steps to limit the memory consumption
+	const unsigned chunkSize = static_cast<unsigned>(std::min<PointIndexType>(pointCount,(1 << 20))); //we save the file in several steps to limit the memory consumption
 	TempArrays arrays;
 	std::vector<e57::SourceDestBuffer> dbufs;
 
@@ -454,11 +454,11 @@ static bool SaveScan(ccPointCloud* cloud, e57::StructureNode& scanNode, e57::Ima
 		QApplication::processEvents();
 	}
 
-	unsigned index = 0;
-	unsigned remainingPointCount = pointCount;
+	PointIndexType index = 0;
+	PointIndexType remainingPointCount = pointCount;
 	while (remainingPointCount != 0)
 	{
-		unsigned thisChunkSize = std::min(remainingPointCount,chunkSize);
+		unsigned thisChunkSize = static_cast<unsigned>(std::min<PointIndexType>(remainingPointCount,chunkSize));
 
 		//load arrays
 		for (unsigned i=0; i<thisChunkSize; ++i, ++index)
@@ -1473,11 +1473,18 @@ static ccHObject* LoadScan(const e57::Node& node, QString& guidStr, ccProgressDi
 	}
 
 	//prepare temporary structures
-	const unsigned chunkSize = std::min<unsigned>(pointCount,(1 << 20)); //we load the file in several steps to limit the memory consumption
+	const unsigned chunkSize = static_cast<unsigned>(std::min<int64_t>(pointCount,(1 << 20))); //we load the file in several steps to limit the memory consumption
 	TempArrays arrays;
 	std::vector<e57::SourceDestBuffer> dbufs;
 
-	if (!cloud->reserve(static_cast<unsigned>(pointCount)))
+	if (static_cast<uint64_t>(pointCount) > std::numeric_limits<PointIndexType>::max())
+	{
+		ccLog::Error(QString("[E57] Too many points in scan '%1' (64 bits point indexes are required)").arg(scanNode.elementName().c_str()));
+		delete cloud;
+		return nullptr;
+	}
+
+	if (!cloud->reserve(static_cast<PointIndexType>(pointCount)))
 	{
 		ccLog::Error("[E57] Not enough memory!");
 		delete cloud;
@@ -1576,7 +1583,7 @@ static ccHObject* LoadScan(const e57::Node& node, QString& guidStr, ccProgressDi
 	if (header.pointFields.intensityField)
 	{
 		intensitySF = new ccScalarField(CC_E57_INTENSITY_FIELD_NAME);
-		if (!intensitySF->resizeSafe(static_cast<unsigned>(pointCount)))
+		if (!intensitySF->resizeSafe(static_cast<PointIndexType>(pointCount)))
 		{
 			ccLog::Error("[E57] Not enough memory!");
 			intensitySF->release();
@@ -1651,7 +1658,7 @@ static ccHObject* LoadScan(const e57::Node& node, QString& guidStr, ccProgressDi
 	{
 		//we store the point return index as a scalar field
 		returnIndexSF = new ccScalarField(CC_E57_RETURN_INDEX_FIELD_NAME);
-		if (!returnIndexSF->resizeSafe(static_cast<unsigned>(pointCount)))
+		if (!returnIndexSF->resizeSafe(static_cast<PointIndexType>(pointCount)))
 		{
 			ccLog::Error("[E57] Not enough memory!");
 			delete cloud;
@@ -1761,7 +1768,7 @@ static ccHObject* LoadScan(const e57::Node& node, QString& guidStr, ccProgressDi
 				{
 					//ScalarType intensity = (ScalarType)((arrays.intData[i] - intOffset)/intRange); //Normalize intensity to 0 - 1.
 					const ScalarType intensity = static_cast<ScalarType>(arrays.intData[i]);
-					intensitySF->setValue(static_cast<unsigned>(realCount),intensity);
+					intensitySF->setValue(static_cast<PointIndexType>(realCount),intensity);
 
 					//track max intensity (for proper visualization)
 					if (s_absoluteScanIndex != 0 || realCount != 0)
@@ -1778,7 +1785,7 @@ static ccHObject* LoadScan(const e57::Node& node, QString& guidStr, ccProgressDi
 				}
 				else
 				{
-					intensitySF->flagValueAsInvalid(static_cast<unsigned>(realCount));
+					intensitySF->flagValueAsInvalid(static_cast<PointIndexType>(realCount));
 				}
 			}
 
@@ -1800,7 +1807,7 @@ static ccHObject* LoadScan(const e57::Node& node, QString& guidStr, ccProgressDi
 			{
 				assert(returnIndexSF);
 				const ScalarType s = static_cast<ScalarType>(arrays.scanIndexData[i]);
-				returnIndexSF->setValue(static_cast<unsigned>(realCount),s);
+				returnIndexSF->setValue(static_cast<PointIndexType>(realCount),s);
 			}
 
 			realCount++;
@@ -1825,7 +1832,7 @@ static ccHObject* LoadScan(const e57::Node& node, QString& guidStr, ccProgressDi
 	else if (realCount < pointCount)
 	{
 		ccLog::Warning(QString("[E57] We read fewer points than expected for scan '%1' (%2/%3)").arg(scanNode.elementName().c_str()).arg(realCount).arg(pointCount));
-		cloud->resize(static_cast<unsigned>(realCount));
+		cloud->resize(static_cast<PointIndexType>(realCount));
 	}
 
 	//Scalar fields
@@ -37,7 +37,10 @@
 #include <QFileInfo>
 #include <QSharedPointer>
 #include <QInputDialog>
+#include <QCoreApplication>
+#include <QFile>
 #include <QFuture>
+#include <QThread>
 #include <QtConcurrent>
 
 //pdal
@@ -52,6 +55,8 @@
 #include <pdal/io/LasVLR.hpp>
 #include <pdal/io/BufferReader.hpp>
 #include <pdal/Filter.hpp>
+#include <pdal/Reader.hpp>
+#include <pdal/Streamable.hpp>
 #include <pdal/filters/StreamCallbackFilter.hpp>
 Q_DECLARE_METATYPE(pdal::SpatialReference)
 
@@ -64,6 +69,7 @@ using namespace pdal;
 //System
 #include <string.h>
 #include <bitset>
+#include <limits>
 
 static const char s_LAS_SRS_Key[] = "LAS.spatialReference.nosave"; //DGM: added the '.nosave' suffix because this custom type can't be streamed properly
 
@@ -520,7 +526,121 @@ CC_FILE_ERROR LASFilter::saveToFile(ccHObject* entity, const QString& filename,
 
 QSharedPointer<LASOpenDlg> s_lasOpenDlg(nullptr);
 
+//! Progress notification for a number of points that may exceed the NormalizedProgress range (32 bits)
+class LasProgress
+{
+public:
+
+	LasProgress(CCLib::GenericProgressCallback* callback, uint64_t pointCount)
+		: m_blockSize(pointCount / std::numeric_limits<unsigned>::max() + 1)
+		, m_pointCount(0)
+		, m_progress(callback, static_cast<unsigned>(std::max<uint64_t>(pointCount / m_blockSize, 1)))
+	{}
+
+	//! Increments the number of processed points
+	inline bool oneStep()
+	{
+		return (++m_pointCount % m_blockSize != 0 || m_progress.oneStep());
+	}
+
+protected:
+
+	//! Number of points per progress step
+	uint64_t m_blockSize;
+	//! Number of processed points
+	uint64_t m_pointCount;
+	//! Progress
+	CCLib::NormalizedProgress m_progress;
+};
+
+//! Streamable PDAL reader returning the (packed) points of a tile stored in a temporary file by Tiler
+class TileReader : public Reader, public Streamable
+{
+public:
+
+	TileReader(const QString& filename, const DimTypeList& dimTypes, const StringList& dimNames)
+		: m_file(filename)
+		, m_sourceDimTypes(dimTypes)
+		, m_dimNames(dimNames)
+		, m_pointSize(0)
+	{
+		assert(dimTypes.size() == dimNames.size());
+		for (const DimType& dimType : dimTypes)
+		{
+			m_pointSize += Dimension::size(dimType.m_type);
+		}
+	}
+
+	std::string getName() const override { return "readers.cc_tile"; }
+
+private:
+
+	void addDimensions(PointLayoutPtr layout) override
+	{
+		for (size_t i = 0; i < m_dimNames.size(); ++i)
+		{
+			layout->registerOrAssignDim(m_dimNames[i], m_sourceDimTypes[i].m_type);
+		}
+	}
+
+	void ready(PointTableRef table) override
+	{
+		//the dimension ids may differ from the ones of the source table, but the packing order must be the same
+		PointLayoutPtr layout = table.layout();
+		m_dimTypes.clear();
+		for (size_t i = 0; i < m_dimNames.size(); ++i)
+		{
+			m_dimTypes.emplace_back(layout->findDim(m_dimNames[i]), m_sourceDimTypes[i].m_type);
+		}
+		m_buffer.resize(m_pointSize);
+
+		if (!m_file.open(QFile::ReadOnly))
+		{
+			throwError("Failed to open temporary tile file '" + m_file.fileName().toStdString() + "'");
+		}
+	}
+
+	bool processOne(PointRef& point) override
+	{
+		if (m_file.read(m_buffer.data(), m_pointSize) != static_cast<qint64>(m_pointSize))
+		{
+			return false;
+		}
+		point.setPackedData(m_dimTypes, m_buffer.data());
+		return true;
+	}
+
+	point_count_t read(PointViewPtr view, point_count_t count) override
+	{
+		point_count_t readCount = 0;
+		for (PointId idx = view->size(); readCount < count; ++idx, ++readCount)
+		{
+			PointRef point(view->point(idx));
+			if (!processOne(point))
+				break;
+		}
+		return readCount;
+	}
+
+	void done(PointTableRef) override
+	{
+		m_file.close();
+	}
+
+	QFile m_file;
+	DimTypeList m_sourceDimTypes;
+	StringList m_dimNames;
+	DimTypeList m_dimTypes;
+	size_t m_pointSize;
+	std::vector<char> m_buffer;
+};
+
 //! Class describing the current tiling process
+/** Points are streamed (by chunks) from the input file, packed and dispatched in per-tile
+	buffers that are flushed to temporary files as soon as they get too big. The memory
+	footprint is therefore bounded whatever the input file size. Each tile is then written
+	(in parallel) to its final LAS/LAZ file.
+**/
 class Tiler
 {
 public:
@@ -530,20 +650,33 @@ public:
 		, X(0)
 		, Y(1)
 		, Z(2)
+		, pointSize(0)
+		, flushSize(0)
 	{}
 
-	~Tiler() = default;
-
-	inline size_t tileCount() const { return tilePointViews.size(); }
+	~Tiler()
+	{
+		//remove any remaining temporary file
+		for (const Tile& tile : tiles)
+		{
+			if (tile.pointCount != 0)
+			{
+				QFile::remove(tile.tempFileName);
+			}
+		}
+	}
 
-	bool init(unsigned int width,
-		unsigned int height,
-		unsigned int Zdim,
-		const QString &absoluteBaseFilename,
-		const CCVector3d& bbMin,
-		const CCVector3d& bbMax,
-		const PointTableRef table,
-		const LasHeader& header)
+	inline size_t tileCount() const { return tiles.size(); }
+
+	bool init(	unsigned int width,
+				unsigned int height,
+				unsigned int Zdim,
+				const QString &absoluteBaseFilename,
+				const CCVector3d& bbMin,
+				const CCVector3d& bbMax,
+				const PointLayoutPtr layout,
+				const LasHeader& header,
+				size_t maxMemory)
 	{
 		//init tiling dimensions
 		assert(Zdim < 3);
@@ -557,10 +690,29 @@ public:
 		tileDiag.u[Y] /= height;
 		unsigned int count = width * height;
 
+		//packed point layout
+		dimTypes = layout->dimTypes();
+		dimNames.clear();
+		for (const DimType& dimType : dimTypes)
+		{
+			dimNames.push_back(layout->dimName(dimType.m_id));
+		}
+		pointSize = layout->pointSize();
+
+		//each tile buffer gets an equal share of the memory budget (so that the
+		//buffers never exceed it, whatever the number of tiles)
+		static const size_t MaxFlushSize = (1 << 23); //8 Mb
+		flushSize = std::min(maxMemory / count, MaxFlushSize);
+		flushSize = (flushSize / pointSize) * pointSize;
+		if (flushSize == 0)
+		{
+			ccLog::Warning(QString("[LAS] Too many tiles (%1) for the memory budget (%2 bytes)").arg(count).arg(maxMemory));
+			return false;
+		}
+
 		try
 		{
-			tilePointViews.resize(count);
-			fileNames.resize(count);
+			tiles.resize(count);
 		}
 		catch (const std::bad_alloc&)
 		{
@@ -570,6 +722,7 @@ public:
 
 		w = width;
 		h = height;
+		lasHeader = header;
 
 		//File extension
 		QString ext = (header.compressed() ? "laz" : "las");
@@ -578,68 +731,248 @@ public:
 		{
 			for (unsigned int j = 0; j < height; ++j)
 			{
-				unsigned int ii = index(i, j);
-				QString filename = absoluteBaseFilename + QString("_%1_%2.%3").arg(QString::number(i), QString::number(j), ext);
-
-				fileNames[ii] = filename;
-				tilePointViews[ii] = std::make_shared<PointView>(table);
+				Tile& tile = tiles[index(i, j)];
+				tile.fileName = absoluteBaseFilename + QString("_%1_%2.%3").arg(QString::number(i), QString::number(j), ext);
+				tile.tempFileName = tile.fileName + ".tmp";
+				tile.partFileName = tile.fileName + ".part";
+				QFile::remove(tile.tempFileName); //in case a previous process was interrupted
+				QFile::remove(tile.partFileName);
 			}
 		}
 
 		return true;
 	}
 
-	void addPoint(const PointViewPtr &buffer, unsigned int pointIndex)
+	bool addPoint(PointRef& point)
 	{
 		//determine the right tile
-		CCVector3d Prel = CCVector3d(	buffer->getFieldAs<double>(Id::X, pointIndex),
-										buffer->getFieldAs<double>(Id::Y, pointIndex),
-										buffer->getFieldAs<double>(Id::Z, pointIndex));
+		CCVector3d Prel = CCVector3d(	point.getFieldAs<double>(Id::X),
+										point.getFieldAs<double>(Id::Y),
+										point.getFieldAs<double>(Id::Z));
 		Prel -= bbMinCorner;
 		int ii = static_cast<int>(floor(Prel.u[X] / tileDiag.u[X]));
 		int ji = static_cast<int>(floor(Prel.u[Y] / tileDiag.u[Y]));
 		unsigned int i = std::min(static_cast<unsigned int>(std::max(ii, 0)), w - 1);
 		unsigned int j = std::min(static_cast<unsigned int>(std::max(ji, 0)), h - 1);
-		PointViewPtr outputView = tilePointViews[index(i, j)];
-		outputView->appendPoint(*buffer, pointIndex);
+		Tile& tile = tiles[index(i, j)];
+
+		size_t pos = tile.buffer.size();
+		try
+		{
+			if (tile.buffer.capacity() == 0)
+			{
+				tile.buffer.reserve(flushSize);
+			}
+			tile.buffer.resize(pos + pointSize);
+		}
+		catch (const std::bad_alloc&)
+		{
+			//not enough memory
+			return false;
+		}
+		point.getPackedData(dimTypes, tile.buffer.data() + pos);
+		++tile.pointCount;
+
+		return (tile.buffer.size() < flushSize || flush(tile));
 	}
 
-	void writeAll()
+	//! Flushes all the remaining buffers to the temporary files
+	bool flushAll()
 	{
-		for (unsigned int i = 0; i < tilePointViews.size(); ++i)
+		for (Tile& tile : tiles)
+		{
+			if (!flush(tile))
+			{
+				return false;
+			}
+			//we won't need the buffer anymore
+			tile.buffer.shrink_to_fit();
+		}
+		return true;
+	}
+
+	//! Writes all the (non empty) tiles in parallel
+	/** The tiles are written to temporary ('.part') files, and only renamed to
+		their final names once all of them have been written successfully: no
+		(partial) tile is left on disk in case of cancel or failure.
+		\param progressCb optional progress callback (should only be updated by the calling thread)
+		\return error code
+	**/
+	CC_FILE_ERROR writeAll(CCLib::GenericProgressCallback* progressCb = nullptr)
+	{
+		std::vector<unsigned> tileIndexes;
+		for (unsigned i = 0; i < tiles.size(); ++i)
+		{
+			if (tiles[i].pointCount != 0)
+			{
+				tileIndexes.push_back(i);
+			}
+		}
+
+		if (tileIndexes.empty())
+		{
+			return CC_FERR_NO_ERROR;
+		}
+
+		Options writerOptions;
+		writerOptions.add("scale_x", lasHeader.scaleX());
+		writerOptions.add("scale_y", lasHeader.scaleY());
+		writerOptions.add("scale_z", lasHeader.scaleZ());
+		writerOptions.add("offset_x", lasHeader.offsetX());
+		writerOptions.add("offset_y", lasHeader.offsetY());
+		writerOptions.add("offset_z", lasHeader.offsetZ());
+		writerOptions.add("dataformat_id", static_cast<int>(lasHeader.pointFormat()));
+		writerOptions.add("minor_version", static_cast<int>(lasHeader.versionMinor()));
+		writerOptions.add("extra_dims", "all");
+		if (lasHeader.compressed())
+		{
+			writerOptions.add("compression", "laszip");
+		}
+		if (!lasHeader.srs().empty())
+		{
+			writerOptions.add("a_srs", lasHeader.srs().getWKT());
+		}
+
+		QAtomicInt processedTiles(0);
+		QAtomicInt failedTiles(0);
+		QAtomicInt canceled(0);
+
+		auto writeTile = [&](unsigned tileIndex)
 		{
-			LasWriter writer;
-			Options writerOptions;
-			PointTable table;
-			BufferReader bufferReader;
-
-			writerOptions.add("filename", fileNames[i].toLocal8Bit().toStdString());
-			if (tilePointViews[i]->empty())
-				continue;
+			if (canceled.load())
+			{
+				return;
+			}
+
+			const Tile& tile = tiles[tileIndex];
 			try
 			{
-				bufferReader.addView(tilePointViews[i]);
-				writer.setInput(bufferReader);
-				writer.setOptions(writerOptions);
+				FixedPointTable table(10000);
+				TileReader tileReader(tile.tempFileName, dimTypes, dimNames);
+				LasWriter writer;
+				Options options = writerOptions;
+				options.add("filename", tile.partFileName.toLocal8Bit().toStdString());
+				writer.setInput(tileReader);
+				writer.setOptions(options);
 				writer.prepare(table);
 				writer.execute(table);
 			}
-			catch (const pdal_error& e)
+			catch (const std::exception& e)
+			{
+				ccLog::Warning(QString("[LAS] Failed to write tile '%1': %2").arg(tile.fileName, e.what()));
+				failedTiles.ref();
+			}
+
+			QFile::remove(tile.tempFileName);
+			processedTiles.ref();
+		};
+
+		QFuture<void> future = QtConcurrent::map(tileIndexes, writeTile);
+
+		//we can only update the progress bar from this thread
+		if (progressCb)
+		{
+			while (!future.isFinished())
+			{
+				if (progressCb->isCancelRequested())
+				{
+					canceled = 1;
+				}
+				progressCb->update((100.0f * processedTiles.load()) / tileIndexes.size());
+				QCoreApplication::processEvents();
+				QThread::msleep(50);
+			}
+		}
+		future.waitForFinished();
+
+		CC_FILE_ERROR result = CC_FERR_NO_ERROR;
+		if (canceled.load())
+		{
+			result = CC_FERR_CANCELED_BY_USER;
+		}
+		else if (failedTiles.load() != 0)
+		{
+			result = CC_FERR_THIRD_PARTY_LIB_FAILURE;
+		}
+
+		//move the tiles to their final location (all or nothing)
+		size_t renamedCount = 0;
+		if (result == CC_FERR_NO_ERROR)
+		{
+			for (; renamedCount < tileIndexes.size(); ++renamedCount)
+			{
+				const Tile& tile = tiles[tileIndexes[renamedCount]];
+				QFile::remove(tile.fileName); //QFile::rename doesn't overwrite existing files
+				if (!QFile::rename(tile.partFileName, tile.fileName))
+				{
+					ccLog::Warning(QString("[LAS] Failed to rename '%1' as '%2'").arg(tile.partFileName, tile.fileName));
+					result = CC_FERR_WRITING;
+					break;
+				}
+			}
+		}
+
+		if (result != CC_FERR_NO_ERROR)
+		{
+			//remove the partial output
+			for (size_t i = 0; i < tileIndexes.size(); ++i)
 			{
-				ccLog::Error(QString("PDAL exception '%1'").arg(e.what()));
+				const Tile& tile = tiles[tileIndexes[i]];
+				QFile::remove(i < renamedCount ? tile.fileName : tile.partFileName);
 			}
 		}
+
+		return result;
 	}
 
 protected:
 
+	//! Tile
+	struct Tile
+	{
+		Tile() : pointCount(0) {}
+
+		QString fileName;
+		QString tempFileName;
+		QString partFileName;
+		std::vector<char> buffer;
+		point_count_t pointCount;
+	};
+
+	bool flush(Tile& tile)
+	{
+		if (tile.buffer.empty())
+		{
+			return true;
+		}
+
+		QFile file(tile.tempFileName);
+		if (!file.open(QFile::WriteOnly | QFile::Append))
+		{
+			ccLog::Warning(QString("[LAS] Failed to open temporary file '%1'").arg(tile.tempFileName));
+			return false;
+		}
+		qint64 byteCount = static_cast<qint64>(tile.buffer.size());
+		if (file.write(tile.buffer.data(), byteCount) != byteCount)
+		{
+			ccLog::Warning(QString("[LAS] Failed to write temporary file '%1' (disk full?)").arg(tile.tempFileName));
+			return false;
+		}
+		tile.buffer.clear(); //we keep the capacity
+		return true;
+	}
+
 	inline unsigned int index(unsigned int i, unsigned int j) const { return i + j * w; }
 
 	unsigned int w, h;
 	unsigned int X, Y, Z;
 	CCVector3d bbMinCorner, tileDiag;
-	std::vector<PointViewPtr> tilePointViews;
-	std::vector<QString> fileNames;
+	DimTypeList dimTypes;
+	StringList dimNames;
+	size_t pointSize;
+	size_t flushSize;
+	LasHeader lasHeader;
+	std::vector<Tile> tiles;
 };
 
 
@@ -649,13 +982,13 @@ struct LasCloudChunk
 
 	ccPointCloud* loadedCloud;
 	std::vector< LasField::Shared > lasFields;
-	unsigned int size;
+	PointIndexType size;
 
 	ccPointCloud* getLoadedCloud() const { return loadedCloud; }
 
 	bool hasColors() const { return loadedCloud->hasColors(); }
 
-	bool reserveSize(unsigned int nbPoints)
+	bool reserveSize(PointIndexType nbPoints)
 	{
 		size = nbPoints;
 		loadedCloud = new ccPointCloud();
@@ -889,6 +1222,141 @@ std::vector<ExtraDim> readExtraBytesVlr(LasHeader &header)
 	return extraDims;
 }
 
+CC_FILE_ERROR LASFilter::TileFile(const QString& filename, const TilingParameters& params, CCLib::GenericProgressCallback* progressCb)
+{
+	if (params.width == 0 || params.height == 0 || params.vertDim > 2 || static_cast<uint64_t>(params.width) * params.height > std::numeric_limits<unsigned>::max())
+	{
+		return CC_FERR_BAD_ARGUMENT;
+	}
+
+	//the points are streamed by chunks (the memory footprint doesn't depend on the file size)
+	static const point_count_t TilingChunkSize = 100000;
+	FixedPointTable table(TilingChunkSize);
+	LasReader lasReader;
+	LasHeader lasHeader;
+
+	try
+	{
+		Options las_opts;
+		las_opts.add("filename", filename.toLocal8Bit().toStdString());
+		lasReader.setOptions(las_opts);
+		lasReader.prepare(table);
+		lasHeader = lasReader.header();
+
+		//we want to forward all the extra dimensions to the tiles
+		std::vector<ExtraDim> extraDims = readExtraBytesVlr(lasHeader);
+		if (!extraDims.empty())
+		{
+			std::string extraDimsArg;
+			for (const ExtraDim& dim : extraDims)
+			{
+				extraDimsArg += dim.m_name + "=" + interpretationName(dim.m_dimType.m_type) + ",";
+			}
+
+			Options las_opts2;
+			las_opts2.add("extra_dims", extraDimsArg);
+			lasReader.addOptions(las_opts2);
+			lasReader.prepare(table);
+		}
+	}
+	catch (const std::exception& e)
+	{
+		ccLog::Error(QString("PDAL exception '%1'").arg(e.what()));
+		return CC_FERR_THIRD_PARTY_LIB_EXCEPTION;
+	}
+	catch (...)
+	{
+		return CC_FERR_THIRD_PARTY_LIB_FAILURE;
+	}
+
+	const uint64_t nbOfPoints = lasHeader.pointCount();
+	if (nbOfPoints == 0)
+	{
+		//strange file ;)
+		return CC_FERR_NO_LOAD;
+	}
+
+	CCVector3d bbMin(lasHeader.minX(), lasHeader.minY(), lasHeader.minZ());
+	CCVector3d bbMax(lasHeader.maxX(), lasHeader.maxY(), lasHeader.maxZ());
+
+	Tiler tiler;
+	if (!tiler.init(params.width, params.height, params.vertDim, params.outputBaseName, bbMin, bbMax, table.layout(), lasHeader, params.maxMemory))
+	{
+		return CC_FERR_NOT_ENOUGH_MEMORY;
+	}
+
+	if (progressCb)
+	{
+		progressCb->setMethodTitle(qPrintable(QObject::tr("Tiling points")));
+		progressCb->setInfo(qPrintable(QObject::tr("Points: %L1").arg(nbOfPoints)));
+		progressCb->update(0);
+		progressCb->start();
+	}
+	LasProgress nProgress(progressCb, nbOfPoints);
+
+	//first pass: dispatch the points in the (temporary) tile files
+	CC_FILE_ERROR callbackError = CC_FERR_NO_ERROR;
+	auto tileOne = [&](PointRef& point)
+	{
+		if (callbackError != CC_FERR_NO_ERROR)
+		{
+			//skip the remaining points
+			return false;
+		}
+		if (progressCb && progressCb->isCancelRequested())
+		{
+			callbackError = CC_FERR_CANCELED_BY_USER;
+			return false;
+		}
+		if (!tiler.addPoint(point))
+		{
+			callbackError = CC_FERR_WRITING;
+			return false;
+		}
+		nProgress.oneStep();
+		return true;
+	};
+
+	try
+	{
+		StreamCallbackFilter f;
+		f.setInput(lasReader);
+		f.setCallback(tileOne);
+		f.prepare(table);
+		f.execute(table);
+	}
+	catch (const std::exception& e)
+	{
+		ccLog::Error(QString("PDAL exception '%1'").arg(e.what()));
+		return CC_FERR_THIRD_PARTY_LIB_EXCEPTION;
+	}
+
+	if (callbackError != CC_FERR_NO_ERROR)
+	{
+		return callbackError;
+	}
+	if (!tiler.flushAll())
+	{
+		return CC_FERR_WRITING;
+	}
+
+	//second pass: write the tiles (in parallel)
+	if (progressCb)
+	{
+		progressCb->setMethodTitle(qPrintable(QObject::tr("Writing tiles")));
+		progressCb->setInfo(qPrintable(QObject::tr("Tiles: %1").arg(tiler.tileCount())));
+		progressCb->update(0);
+	}
+	CC_FILE_ERROR result = tiler.writeAll(progressCb);
+
+	if (progressCb)
+	{
+		progressCb->stop();
+	}
+
+	return result;
+}
+
 CC_FILE_ERROR LASFilter::loadFile(const QString& filename, ccHObject& container, LoadParameters& parameters)
 {
 	Options las_opts;
@@ -932,7 +1400,7 @@ CC_FILE_ERROR LASFilter::loadFile(const QString& filename, ccHObject& container,
 	CCVector3d lasScale = CCVector3d(lasHeader.scaleX(), lasHeader.scaleY(), lasHeader.scaleZ());
 	CCVector3d lasShift = -CCVector3d(lasHeader.offsetX(), lasHeader.offsetY(), lasHeader.offsetZ());
 
-	auto nbOfPoints = static_cast<unsigned int>(lasHeader.pointCount());
+	const uint64_t nbOfPoints = lasHeader.pointCount();
 	if (nbOfPoints == 0)
 	{
 		//strange file ;)
@@ -1024,117 +1492,45 @@ CC_FILE_ERROR LASFilter::loadFile(const QString& filename, ccHObject& container,
 
 		if (tiling)
 		{
-			Tiler tiler;
-			PointTable table;
-			PointViewSet pointViewSet;
+			TilingParameters tilingParams;
 
 			// tiling (vertical) dimension
-			unsigned int vertDim = 2;
 			switch (s_lasOpenDlg->tileDimComboBox->currentIndex())
 			{
 			case 0: //XY
-				vertDim = 2;
+				tilingParams.vertDim = 2;
 				break;
 			case 1: //XZ
-				vertDim = 1;
+				tilingParams.vertDim = 1;
 				break;
 			case 2: //YZ
-				vertDim = 0;
+				tilingParams.vertDim = 0;
 				break;
 			default:
 				assert(false);
 				break;
 			}
 
-			auto w = static_cast<unsigned int>(s_lasOpenDlg->wTileSpinBox->value());
-			auto h = static_cast<unsigned int>(s_lasOpenDlg->hTileSpinBox->value());
-
-			QString outputBaseName = s_lasOpenDlg->outputPathLineEdit->text() + "/" + QFileInfo(filename).baseName();
-			if (!tiler.init(w, h, vertDim, outputBaseName, bbMin, bbMax, table, lasHeader))
-			{
-				return CC_FERR_NOT_ENOUGH_MEMORY;
-			}
-
-			auto prepareAndExecute = [&lasReader, &table]() -> PointViewSet {
-				lasReader.prepare(table);
-				lasReader.prepare(table);
-				return lasReader.execute(table);
-			};
-
-			if (parameters.parentWidget)
-			{
-				pDlg.reset(new ccProgressDialog(false, parameters.parentWidget));
-				pDlg->setMethodTitle(QObject::tr("LAS file"));
-				pDlg->setInfo(QObject::tr("Please wait... reading in progress"));
-				pDlg->setRange(0, 0);
-				pDlg->setModal(true);
-				pDlg->start();
-			}
-
-			QFutureWatcher<PointViewSet> reader;
-			QObject::connect(&reader, SIGNAL(finished()), pDlg.data(), SLOT(reset()));
-			reader.setFuture(QtConcurrent::run(prepareAndExecute));
+			tilingParams.width = static_cast<unsigned int>(s_lasOpenDlg->wTileSpinBox->value());
+			tilingParams.height = static_cast<unsigned int>(s_lasOpenDlg->hTileSpinBox->value());
+			tilingParams.outputBaseName = s_lasOpenDlg->outputPathLineEdit->text() + "/" + QFileInfo(filename).baseName();
 
-			if (pDlg)
-			{
-				pDlg->exec();
-			}
-			reader.waitForFinished();
-
-			PointViewSet viewSet = reader.result();
-			PointViewPtr pointView = *viewSet.begin();
-
-			if (parameters.parentWidget && pDlg)
-			{
-				pDlg.reset(new ccProgressDialog(true, parameters.parentWidget)); //cancel available
-				pDlg->setMethodTitle(QObject::tr("Tiling points"));
-				pDlg->setInfo(QObject::tr("Points: %L1").arg(nbOfPoints));
-				pDlg->start();
-			}
-			CCLib::NormalizedProgress nProgress(pDlg.data(), nbOfPoints);
-
-			for (PointId idx = 0; idx < pointView->size(); ++idx)
-			{
-				if (pDlg->isCancelRequested())
-					return CC_FERR_CANCELED_BY_USER;
-				tiler.addPoint(pointView, idx);
-				nProgress.oneStep();
-			}
-
-			// Now the tiler will actually write the points
-			if (parameters.parentWidget)
-			{
-				pDlg.reset(new ccProgressDialog(false, parameters.parentWidget));
-				pDlg->setMethodTitle(QObject::tr("LAS file"));
-				pDlg->setInfo(QObject::tr("Please wait... writing in progress"));
-				pDlg->setRange(0, 0);
-				pDlg->setModal(true);
-				pDlg->start();
-			}
-
-			QFutureWatcher<void> writer;
-			QObject::connect(&writer, SIGNAL(finished()), pDlg.data(), SLOT(reset()));
-			writer.setFuture(QtConcurrent::run([&tiler]() {tiler.writeAll(); }));
-
-			pDlg->exec();
-			writer.waitForFinished();
-
-			return CC_FERR_NO_ERROR;
+			return TileFile(filename, tilingParams, pDlg.data());
 		}
 
-		CCLib::NormalizedProgress nProgress(pDlg.data(), nbOfPoints);
+		LasProgress nProgress(pDlg.data(), nbOfPoints);
 		ccPointCloud* loadedCloud = nullptr;
 		std::vector< LasField::Shared > fieldsToLoad;
 		CCVector3d Pshift(0, 0, 0);
 		bool preserveCoordinateShift = true;
 
-		unsigned int fileChunkSize = 0;
-		unsigned int nbPointsRead = 0;
+		PointIndexType fileChunkSize = 0;
+		uint64_t nbPointsRead = 0;
 
 		StreamCallbackFilter f;
 		f.setInput(lasReader);
 
-		unsigned int nbOfChunks = (nbOfPoints / CC_MAX_NUMBER_OF_POINTS_PER_CLOUD) + 1;
+		size_t nbOfChunks = static_cast<size_t>(nbOfPoints / CC_MAX_NUMBER_OF_POINTS_PER_CLOUD) + 1;
 		std::vector<LasCloudChunk> chunks(nbOfChunks, LasCloudChunk());
 
 		CC_FILE_ERROR callbackError = CC_FERR_NO_ERROR;
@@ -1151,8 +1547,8 @@ CC_FILE_ERROR LASFilter::loadFile(const QString& filename, ccHObject& container,
 			if (pointChunk.getLoadedCloud() == nullptr)
 			{
 				// create a new cloud
-				unsigned int pointsToRead = nbOfPoints - nbPointsRead;
-				fileChunkSize = std::min(pointsToRead, CC_MAX_NUMBER_OF_POINTS_PER_CLOUD);
+				uint64_t pointsToRead = nbOfPoints - nbPointsRead;
+				fileChunkSize = static_cast<PointIndexType>(std::min<uint64_t>(pointsToRead, CC_MAX_NUMBER_OF_POINTS_PER_CLOUD));
 				if (!pointChunk.reserveSize(fileChunkSize))
 				{
 					ccLog::Warning("[LAS] Not enough memory!");
@@ -1240,7 +1636,7 @@ CC_FILE_ERROR LASFilter::loadFile(const QString& filename, ccHObject& container,
 						if (loadedCloud->reserveTheRGBTable())
 						{
 							// we must set the color (black) of all previously skipped points
-							for (unsigned int i = 0; i < loadedCloud->size() - 1; ++i)
+							for (PointIndexType i = 0; i < loadedCloud->size() - 1; ++i)
 							{
 								loadedCloud->addRGBColor(ccColor::black);
 							}
@@ -1270,7 +1666,7 @@ CC_FILE_ERROR LASFilter::loadFile(const QString& filename, ccHObject& container,
 							ccLog::Print("[LAS] Color components are coded on 16 bits");
 							colorCompBitShift = 8;
 							//we fix all the previously read colors
-							for (unsigned int i = 0; i < loadedCloud->size() - 1; ++i)
+							for (PointIndexType i = 0; i < loadedCloud->size() - 1; ++i)
 							{
 								loadedCloud->setPointColor(i, ccColor::black); //255 >> 8 = 0!
 							}
@@ -1350,7 +1746,7 @@ CC_FILE_ERROR LASFilter::loadFile(const QString& filename, ccHObject& container,
 							}
 
 							auto defaultValue = static_cast<ScalarType>(field->defaultValue);
-							for (unsigned i = 1; i < loadedCloud->size(); ++i)
+							for (PointIndexType i = 1; i < loadedCloud->size(); ++i)
 							{
 								field->sf->emplace_back(defaultValue);
 							}
@@ -22,6 +22,11 @@
 
 #ifdef CC_LAS_SUPPORT
 
+namespace CCLib
+{
+	class GenericProgressCallback;
+}
+
 //! ASPRS LAS point cloud file I/O filter
 class QCC_IO_LIB_API LASFilter : public FileIOFilter
 {
@@ -41,6 +46,41 @@ public:
 	virtual bool canLoadExtension(const QString& upperCaseExt) const override;
 	virtual bool canSave(CC_CLASS_ENUM type, bool& multiple, bool& exclusive) const override;
 
+	//! Tiling parameters
+	struct TilingParameters
+	{
+		TilingParameters()
+			: width(1)
+			, height(1)
+			, vertDim(2)
+			, maxMemory(256 << 20)
+		{}
+
+		//! Number of tiles along the first horizontal dimension
+		unsigned width;
+		//! Number of tiles along the second horizontal dimension
+		unsigned height;
+		//! 'Vertical' dimension (2 = XY tiles, 1 = XZ tiles, 0 = YZ tiles)
+		unsigned char vertDim;
+		//! Absolute base filename of the tiles (they will be saved as 'outputBaseName_i_j.las/laz')
+		QString outputBaseName;
+		//! Maximum amount of memory used to buffer the points (in bytes)
+		/** It's shared by all the tiles (each tile must be able to buffer at least one point).
+		**/
+		size_t maxMemory;
+	};
+
+	//! Splits a LAS/LAZ file in tiles without loading it in memory
+	/** The input file is streamed by chunks and the points are dispatched in per-tile
+		temporary files. The tiles are then written in parallel (with the same point format,
+		scale, offset and compression as the input file). Empty tiles are not written.
+		\param filename input LAS/LAZ file
+		\param params tiling parameters
+		\param progressCb optional progress callback
+		\return error code
+	**/
+	static CC_FILE_ERROR TileFile(const QString& filename, const TilingParameters& params, CCLib::GenericProgressCallback* progressCb = nullptr);
+
 };
 
 #endif //CC_LAS_SUPPORT
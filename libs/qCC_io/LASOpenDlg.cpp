@@ -170,7 +170,7 @@ void LASOpenDlg::clearEVLRs()
 }
 
 void LASOpenDlg::setInfos(	QString filename,
-							unsigned pointCount,
+							uint64_t pointCount,
 							const CCVector3d& bbMin,
 							const CCVector3d& bbMax)
 {
@@ -178,7 +178,7 @@ void LASOpenDlg::setInfos(	QString filename,
 	outputPathLineEdit->setText(QFileInfo(filename).absolutePath());
 
 	//number of points
-	pointCountLineEdit->setText(QLocale().toString(pointCount));
+	pointCountLineEdit->setText(QLocale().toString(static_cast<qulonglong>(pointCount)));
 
 	//bounding-box
 	bbTextEdit->setText(QString("X = [%1 ; %2]\nY = [%3 ; %4]\nZ = [%5 ; %6]")
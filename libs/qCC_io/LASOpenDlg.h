@@ -52,7 +52,7 @@ public:
 
 	//! Sets the information about the file
 	void setInfos(	QString filename,
-					unsigned pointCount,
+					uint64_t pointCount,
 					const CCVector3d& bbMin,
 					const CCVector3d& bbMax);
 
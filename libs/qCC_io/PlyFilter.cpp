@@ -1813,6 +1813,7 @@ CC_FILE_ERROR PlyFilter::loadFile(const QString& filename, const QString& inputT
 					--tri->i2;
 					--tri->i3;
 				}
+				mesh->trianglesHaveChanged();
 			}
 			else //file is definitely corrupted!
 			{
@@ -0,0 +1,268 @@
+#include "TestAsciiFilter.h"
+
+#include "AsciiFilter.h"
+#include "cc2DLabel.h"
+#include "ccHObject.h"
+#include "ccPointCloud.h"
+#include "ccScalarField.h"
+
+#include <QElapsedTimer>
+#include <QTemporaryDir>
+
+static bool WriteFile(const QString& filename, const QByteArray& content)
+{
+	QFile file(filename);
+	if (!file.open(QFile::WriteOnly))
+		return false;
+	return file.write(content) == content.size();
+}
+
+static CC_FILE_ERROR LoadFile(	const QString& filename,
+								ccHObject& container,
+								const AsciiOpenDlg::Sequence& sequence,
+								char separator = ' ',
+								unsigned maxCloudSize = CC_MAX_NUMBER_OF_POINTS_PER_CLOUD,
+								unsigned skipLines = 0)
+{
+	QFileInfo fileInfo(filename);
+	FileIOFilter::LoadParameters params;
+	params.alwaysDisplayLoadDialog = false;
+	params.shiftHandlingMode = ccGlobalShiftManager::NO_DIALOG;
+
+	AsciiFilter filter;
+	return filter.loadCloudFromFormatedAsciiFile(	filename,
+													container,
+													sequence,
+													separator,
+													100, //approximate number of lines
+													fileInfo.size(),
+													maxCloudSize,
+													skipLines,
+													params);
+}
+
+//! Compares two vectors
+static inline bool SameVectors(const CCVector3& u, const CCVector3& v)
+{
+	return (u.x == v.x && u.y == v.y && u.z == v.z);
+}
+
+static AsciiOpenDlg::Sequence XYZSequence()
+{
+	AsciiOpenDlg::Sequence sequence;
+	sequence.emplace_back(ASCII_OPEN_DLG_X, "X");
+	sequence.emplace_back(ASCII_OPEN_DLG_Y, "Y");
+	sequence.emplace_back(ASCII_OPEN_DLG_Z, "Z");
+	return sequence;
+}
+
+void TestAsciiFilter::readCloudWithScalarField() const
+{
+	QTemporaryDir dir;
+	QVERIFY(dir.isValid());
+	QString filename = dir.filePath("cloud.xyz");
+	QVERIFY(WriteFile(filename, "1.5 2 3 0.25\n-4 5.125 6e-1 7\n7 8 9 1.5E+2\n"));
+
+	AsciiOpenDlg::Sequence sequence = XYZSequence();
+	sequence.emplace_back(ASCII_OPEN_DLG_Scalar, "Intensity");
+
+	ccHObject container;
+	QCOMPARE(LoadFile(filename, container, sequence), CC_FERR_NO_ERROR);
+	QCOMPARE(container.getChildrenNumber(), 1u);
+
+	ccPointCloud* cloud = static_cast<ccPointCloud*>(container.getChild(0));
+	QCOMPARE(cloud->size(), 3u);
+	QCOMPARE(cloud->getPoint(0)->x, static_cast<PointCoordinateType>(1.5));
+	QCOMPARE(cloud->getPoint(1)->y, static_cast<PointCoordinateType>(5.125));
+	QCOMPARE(cloud->getPoint(1)->z, static_cast<PointCoordinateType>(0.6));
+	QCOMPARE(cloud->getPoint(2)->z, static_cast<PointCoordinateType>(9));
+
+	QCOMPARE(cloud->getNumberOfScalarFields(), 1u);
+	CCLib::ScalarField* sf = cloud->getScalarField(0);
+	QCOMPARE(QString(sf->getName()), QString("Intensity"));
+	QCOMPARE(sf->getValue(0), static_cast<ScalarType>(0.25));
+	QCOMPARE(sf->getValue(1), static_cast<ScalarType>(7));
+	QCOMPARE(sf->getValue(2), static_cast<ScalarType>(150));
+}
+
+void TestAsciiFilter::readMalformedLines() const
+{
+	QTemporaryDir dir;
+	QVERIFY(dir.isValid());
+	QString filename = dir.filePath("malformed.csv");
+	QVERIFY(WriteFile(filename,	"X,Y,Z\r\n"
+								"\r\n"
+								"// comment\r\n"
+								"1,2,3\r\n"
+								",,4,,5,,6,\r\n"
+								"a,b,c\r\n"
+								"7,8\r\n"
+								"\r\n"
+								"  9 , 10 , 11  "));
+
+	ccHObject container;
+	QCOMPARE(LoadFile(filename, container, XYZSequence(), ',', CC_MAX_NUMBER_OF_POINTS_PER_CLOUD, 1), CC_FERR_NO_ERROR);
+	QCOMPARE(container.getChildrenNumber(), 1u);
+
+	ccPointCloud* cloud = static_cast<ccPointCloud*>(container.getChild(0));
+	QCOMPARE(cloud->size(), 3u);
+	QVERIFY(SameVectors(*cloud->getPoint(0), CCVector3(1, 2, 3)));
+	QVERIFY(SameVectors(*cloud->getPoint(1), CCVector3(4, 5, 6)));
+	QVERIFY(SameVectors(*cloud->getPoint(2), CCVector3(9, 10, 11)));
+}
+
+void TestAsciiFilter::readFileWithBOM_data() const
+{
+	QTest::addColumn<QByteArray>("content");
+
+	const QByteArray text("1 2 3\n4 5 6\r\n7 8 9");
+
+	//UTF-8
+	QTest::newRow("UTF-8") << QByteArray("\xEF\xBB\xBF") + text;
+
+	//UTF-16 (little and big endian)
+	QByteArray utf16LE("\xFF\xFE", 2);
+	QByteArray utf16BE("\xFE\xFF", 2);
+	for (char c : text)
+	{
+		utf16LE.append(c).append('\0');
+		utf16BE.append('\0').append(c);
+	}
+	QTest::newRow("UTF-16LE") << utf16LE;
+	QTest::newRow("UTF-16BE") << utf16BE;
+}
+
+void TestAsciiFilter::readFileWithBOM() const
+{
+	QFETCH(QByteArray, content);
+
+	QTemporaryDir dir;
+	QVERIFY(dir.isValid());
+	QString filename = dir.filePath("bom.txt");
+	QVERIFY(WriteFile(filename, content));
+
+	ccHObject container;
+	QCOMPARE(LoadFile(filename, container, XYZSequence()), CC_FERR_NO_ERROR);
+	QCOMPARE(container.getChildrenNumber(), 1u);
+
+	ccPointCloud* cloud = static_cast<ccPointCloud*>(container.getChild(0));
+	QCOMPARE(cloud->size(), 3u);
+	QVERIFY(SameVectors(*cloud->getPoint(0), CCVector3(1, 2, 3)));
+	QVERIFY(SameVectors(*cloud->getPoint(1), CCVector3(4, 5, 6)));
+	QVERIFY(SameVectors(*cloud->getPoint(2), CCVector3(7, 8, 9)));
+}
+
+void TestAsciiFilter::readCloudInChunks() const
+{
+	QTemporaryDir dir;
+	QVERIFY(dir.isValid());
+	QString filename = dir.filePath("chunks.txt");
+
+	static const unsigned PointCount = 2500;
+	QByteArray content;
+	for (unsigned i = 0; i < PointCount; ++i)
+	{
+		content += QByteArray::number(i) + " 0 " + QByteArray::number(i % 7) + "\n";
+	}
+	QVERIFY(WriteFile(filename, content));
+
+	ccHObject container;
+	QCOMPARE(LoadFile(filename, container, XYZSequence(), ' ', 1000), CC_FERR_NO_ERROR);
+	QCOMPARE(container.getChildrenNumber(), 3u);
+
+	unsigned expectedIndex = 0;
+	for (unsigned c = 0; c < container.getChildrenNumber(); ++c)
+	{
+		ccPointCloud* cloud = static_cast<ccPointCloud*>(container.getChild(c));
+		QCOMPARE(cloud->size(), c < 2 ? 1000u : 500u);
+		for (unsigned i = 0; i < cloud->size(); ++i, ++expectedIndex)
+		{
+			QCOMPARE(cloud->getPoint(i)->x, static_cast<PointCoordinateType>(expectedIndex));
+			QCOMPARE(cloud->getPoint(i)->z, static_cast<PointCoordinateType>(expectedIndex % 7));
+		}
+	}
+	QCOMPARE(expectedIndex, PointCount);
+}
+
+void TestAsciiFilter::readLabelsColorsAndNormals() const
+{
+	QTemporaryDir dir;
+	QVERIFY(dir.isValid());
+	QString filename = dir.filePath("labels.txt");
+	QVERIFY(WriteFile(filename,	"first 0 0 0 255 128 0 0 0 1\n"
+								"second 1 1 1 0 64 255 1 0 0\n"));
+
+	AsciiOpenDlg::Sequence sequence;
+	sequence.emplace_back(ASCII_OPEN_DLG_Label, "Label");
+	sequence.emplace_back(ASCII_OPEN_DLG_X, "X");
+	sequence.emplace_back(ASCII_OPEN_DLG_Y, "Y");
+	sequence.emplace_back(ASCII_OPEN_DLG_Z, "Z");
+	sequence.emplace_back(ASCII_OPEN_DLG_R, "R");
+	sequence.emplace_back(ASCII_OPEN_DLG_G, "G");
+	sequence.emplace_back(ASCII_OPEN_DLG_B, "B");
+	sequence.emplace_back(ASCII_OPEN_DLG_NX, "Nx");
+	sequence.emplace_back(ASCII_OPEN_DLG_NY, "Ny");
+	sequence.emplace_back(ASCII_OPEN_DLG_NZ, "Nz");
+
+	ccHObject container;
+	QCOMPARE(LoadFile(filename, container, sequence), CC_FERR_NO_ERROR);
+	QCOMPARE(container.getChildrenNumber(), 1u);
+
+	ccPointCloud* cloud = static_cast<ccPointCloud*>(container.getChild(0));
+	QCOMPARE(cloud->size(), 2u);
+	QVERIFY(cloud->hasColors());
+	QVERIFY(cloud->hasNormals());
+	QCOMPARE(cloud->getPointColor(0).r, static_cast<ColorCompType>(255));
+	QCOMPARE(cloud->getPointColor(1).g, static_cast<ColorCompType>(64));
+	QVERIFY(SameVectors(cloud->getPointNormal(0), CCVector3(0, 0, 1)));
+	QVERIFY(SameVectors(cloud->getPointNormal(1), CCVector3(1, 0, 0)));
+
+	QCOMPARE(cloud->getChildrenNumber(), 2u);
+	QCOMPARE(cloud->getChild(0)->getName(), QString("first"));
+	QCOMPARE(cloud->getChild(1)->getName(), QString("second"));
+}
+
+void TestAsciiFilter::benchmarkLoad() const
+{
+	QTemporaryDir dir;
+	QVERIFY(dir.isValid());
+	QString filename = dir.filePath("benchmark.txt");
+
+	//1M points with coordinates, intensity and one scalar field (~45 Mb)
+	static const unsigned PointCount = 1000000;
+	{
+		QFile file(filename);
+		QVERIFY(file.open(QFile::WriteOnly));
+		char line[128];
+		for (unsigned i = 0; i < PointCount; ++i)
+		{
+			int n = snprintf(line, sizeof(line), "%.3f %.3f %.3f %u %.6f\n", (i % 1000) * 1.001, (i / 1000) * 0.999, (i % 97) * 0.125, i % 256, (i % 10007) / 10007.0);
+			file.write(line, n);
+		}
+	}
+	double megaBytes = QFileInfo(filename).size() / (1024.0 * 1024.0);
+
+	AsciiOpenDlg::Sequence sequence = XYZSequence();
+	sequence.emplace_back(ASCII_OPEN_DLG_Scalar, "Intensity");
+	sequence.emplace_back(ASCII_OPEN_DLG_Scalar, "Value");
+
+	QElapsedTimer timer;
+	qint64 totalTime_ms = 0;
+	int runCount = 0;
+	QBENCHMARK
+	{
+		ccHObject container;
+		timer.start();
+		QCOMPARE(LoadFile(filename, container, sequence), CC_FERR_NO_ERROR);
+		totalTime_ms += timer.elapsed();
+		++runCount;
+		QCOMPARE(static_cast<ccPointCloud*>(container.getChild(0))->size(), PointCount);
+	}
+
+	if (totalTime_ms > 0)
+	{
+		qInfo("ASCII loading throughput: %.1f MB/s", (megaBytes * runCount * 1000.0) / totalTime_ms);
+	}
+}
+
+QTEST_MAIN(TestAsciiFilter)
@@ -0,0 +1,32 @@
+#ifndef CC_TEST_ASCII_FILTER_HEADER
+#define CC_TEST_ASCII_FILTER_HEADER
+
+#include <QObject>
+#include <QtTest/QtTest>
+
+class TestAsciiFilter : public QObject
+{
+Q_OBJECT
+private slots:
+	/* Reading tests */
+	void readCloudWithScalarField() const;
+
+	/* Comments, empty lines, CRLF line endings, corrupted lines and skipped lines */
+	void readMalformedLines() const;
+
+	/* Files starting with a UTF-8 or UTF-16 byte order mark */
+	void readFileWithBOM_data() const;
+	void readFileWithBOM() const;
+
+	/* The file must be split in several clouds (in order) if it's bigger than the max. cloud size */
+	void readCloudInChunks() const;
+
+	/* Labels, colors and normals */
+	void readLabelsColorsAndNormals() const;
+
+	/* Benchmark: loading throughput (MB/s) */
+	void benchmarkLoad() const;
+};
+
+
+#endif //CC_TEST_ASCII_FILTER_HEADER
@@ -0,0 +1,141 @@
+#include "TestBinFilter.h"
+
+#include "BinFilter.h"
+#include "ccChunk.h"
+#include "ccHObjectCaster.h"
+#include "ccPointCloud.h"
+#include "ccScalarField.h"
+
+#include <QTemporaryDir>
+
+#include <cstring>
+
+//! Creates a cloud with colors, normals and a scalar field
+static ccPointCloud* CreateCloud(unsigned pointCount, const QString& name)
+{
+	ccPointCloud* cloud = new ccPointCloud(name);
+	if (	!cloud->reserve(pointCount)
+		||	!cloud->reserveTheRGBTable()
+		||	!cloud->reserveTheNormsTable())
+	{
+		delete cloud;
+		return nullptr;
+	}
+
+	for (unsigned i = 0; i < pointCount; ++i)
+	{
+		cloud->addPoint(CCVector3(static_cast<PointCoordinateType>(i), static_cast<PointCoordinateType>(i % 97), static_cast<PointCoordinateType>(i % 13) / 2));
+		cloud->addRGBColor(static_cast<ColorCompType>(i % 256), static_cast<ColorCompType>((i / 256) % 256), static_cast<ColorCompType>(i % 7));
+		CCVector3 N(static_cast<PointCoordinateType>(i % 3), static_cast<PointCoordinateType>(i % 5), 1);
+		N.normalize();
+		cloud->addNorm(N);
+	}
+
+	int sfIdx = cloud->addScalarField("values");
+	if (sfIdx < 0)
+	{
+		delete cloud;
+		return nullptr;
+	}
+	CCLib::ScalarField* sf = cloud->getScalarField(sfIdx);
+	for (unsigned i = 0; i < pointCount; ++i)
+	{
+		sf->setValue(i, static_cast<ScalarType>(i) / 3);
+	}
+	sf->computeMinAndMax();
+	cloud->setCurrentDisplayedScalarField(sfIdx);
+
+	return cloud;
+}
+
+//! Compares two vectors
+static inline bool SameVectors(const CCVector3& u, const CCVector3& v)
+{
+	return (u.x == v.x && u.y == v.y && u.z == v.z);
+}
+
+//! Compares two clouds
+static bool SameClouds(const ccPointCloud* cloud1, const ccPointCloud* cloud2)
+{
+	if (	cloud1->size() != cloud2->size()
+		||	cloud1->getName() != cloud2->getName()
+		||	!cloud2->hasColors()
+		||	!cloud2->hasNormals()
+		||	cloud2->getNumberOfScalarFields() != 1)
+	{
+		return false;
+	}
+
+	const CCLib::ScalarField* sf1 = cloud1->getScalarField(0);
+	const CCLib::ScalarField* sf2 = cloud2->getScalarField(0);
+	for (unsigned i = 0; i < cloud1->size(); ++i)
+	{
+		if (	!SameVectors(*cloud1->getPoint(i), *cloud2->getPoint(i))
+			||	cloud1->getPointColor(i) != cloud2->getPointColor(i)
+			||	!SameVectors(cloud1->getPointNormal(i), cloud2->getPointNormal(i))
+			||	sf1->getValue(i) != sf2->getValue(i))
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+void TestBinFilter::roundTrip_data() const
+{
+	QTest::addColumn<unsigned>("pointCount");
+
+	QTest::newRow("small arrays") << 1000u;
+	QTest::newRow("one chunk") << static_cast<unsigned>(ccChunk::SIZE);
+	QTest::newRow("several chunks") << static_cast<unsigned>(3 * ccChunk::SIZE + 17);
+}
+
+void TestBinFilter::roundTrip() const
+{
+	QFETCH(unsigned, pointCount);
+
+	QScopedPointer<ccPointCloud> cloud(CreateCloud(pointCount, "cloud"));
+	QVERIFY(cloud);
+	ccPointCloud* child = CreateCloud(100, "child");
+	QVERIFY(child);
+	cloud->addChild(child);
+
+	QTemporaryDir dir;
+	QVERIFY(dir.isValid());
+	QString filename = dir.filePath("roundTrip.bin");
+
+	BinFilter filter;
+	FileIOFilter::SaveParameters saveParams;
+	saveParams.alwaysDisplaySaveDialog = false;
+	QCOMPARE(filter.saveToFile(cloud.data(), filename, saveParams), CC_FERR_NO_ERROR);
+
+	//check the header
+	{
+		QFile file(filename);
+		QVERIFY(file.open(QFile::ReadOnly));
+		QByteArray content = file.readAll();
+		QVERIFY(content.size() > 8);
+		QVERIFY(content.startsWith("CCB"));
+		quint32 binVersion = 0;
+		memcpy(&binVersion, content.constData() + 4, 4);
+		QVERIFY(binVersion >= 20);
+	}
+
+	ccHObject container;
+	FileIOFilter::LoadParameters loadParams;
+	loadParams.alwaysDisplayLoadDialog = false;
+	QCOMPARE(filter.loadFile(filename, container, loadParams), CC_FERR_NO_ERROR);
+	QCOMPARE(container.getChildrenNumber(), 1u);
+
+	ccPointCloud* loadedCloud = ccHObjectCaster::ToPointCloud(container.getChild(0));
+	QVERIFY(loadedCloud);
+	QVERIFY(SameClouds(cloud.data(), loadedCloud));
+
+	QCOMPARE(loadedCloud->getChildrenNumber(), 1u);
+	ccPointCloud* loadedChild = ccHObjectCaster::ToPointCloud(loadedCloud->getChild(0));
+	QVERIFY(loadedChild);
+	QVERIFY(SameClouds(child, loadedChild));
+}
+
+QTEST_MAIN(TestBinFilter)
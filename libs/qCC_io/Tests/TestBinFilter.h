@@ -0,0 +1,17 @@
+#ifndef CC_TEST_BIN_FILTER_HEADER
+#define CC_TEST_BIN_FILTER_HEADER
+
+#include <QObject>
+#include <QtTest/QtTest>
+
+class TestBinFilter : public QObject
+{
+Q_OBJECT
+private slots:
+	/* Save/load round-trip of a cloud (points, colors, normals, scalar field and a child cloud) in the current BIN version */
+	void roundTrip_data() const;
+	void roundTrip() const;
+};
+
+
+#endif //CC_TEST_BIN_FILTER_HEADER
@@ -0,0 +1,207 @@
+#include "TestLASFilter.h"
+
+#include "LASFilter.h"
+
+#include <GenericProgressCallback.h>
+
+#include <QDir>
+#include <QTemporaryDir>
+
+#include <pdal/PointTable.hpp>
+#include <pdal/PointView.hpp>
+#include <pdal/Options.hpp>
+#include <pdal/io/BufferReader.hpp>
+#include <pdal/io/LasReader.hpp>
+#include <pdal/io/LasWriter.hpp>
+
+using namespace pdal;
+
+static const unsigned TEST_POINT_COUNT = 100000;
+
+//! Writes a LAS file with points regularly spread in [0 ; 100] x [0 ; 50] x [0 ; 10]
+/** The intensity of each point is its index (modulo 65536).
+**/
+static bool WriteLASFile(const QString& filename)
+{
+	try
+	{
+		PointTable table;
+		table.layout()->registerDim(Dimension::Id::X);
+		table.layout()->registerDim(Dimension::Id::Y);
+		table.layout()->registerDim(Dimension::Id::Z);
+		table.layout()->registerDim(Dimension::Id::Intensity);
+
+		PointViewPtr view(new PointView(table));
+		for (PointId i = 0; i < TEST_POINT_COUNT; ++i)
+		{
+			view->setField(Dimension::Id::X, i, (i % 1000) / 10.0);
+			view->setField(Dimension::Id::Y, i, (i / 1000) / 2.0);
+			view->setField(Dimension::Id::Z, i, (i % 101) / 10.0);
+			view->setField(Dimension::Id::Intensity, i, static_cast<uint16_t>(i % 65536));
+		}
+
+		BufferReader reader;
+		reader.addView(view);
+
+		Options options;
+		options.add("filename", filename.toStdString());
+		options.add("scale_x", 0.01);
+		options.add("scale_y", 0.01);
+		options.add("scale_z", 0.01);
+		LasWriter writer;
+		writer.setInput(reader);
+		writer.setOptions(options);
+		writer.prepare(table);
+		writer.execute(table);
+	}
+	catch (const std::exception&)
+	{
+		return false;
+	}
+
+	return true;
+}
+
+//! Reads a LAS file
+static PointViewPtr ReadLASFile(const QString& filename, PointTable& table)
+{
+	Options options;
+	options.add("filename", filename.toStdString());
+	LasReader reader;
+	reader.setOptions(options);
+	reader.prepare(table);
+	PointViewSet views = reader.execute(table);
+	return (views.empty() ? PointViewPtr() : *views.begin());
+}
+
+//! Progress callback requesting the cancellation as soon as the tiles are being written
+class CancelWhenWritingTiles : public CCLib::GenericProgressCallback
+{
+public:
+	CancelWhenWritingTiles() : m_writing(false) {}
+
+	void update(float) override {}
+	void setMethodTitle(const char* methodTitle) override { m_writing = (QString(methodTitle) == "Writing tiles"); }
+	void setInfo(const char*) override {}
+	void start() override {}
+	void stop() override {}
+	bool isCancelRequested() override { return m_writing; }
+
+protected:
+	bool m_writing;
+};
+
+void TestLASFilter::tileFile_data() const
+{
+	QTest::addColumn<unsigned>("width");
+	QTest::addColumn<unsigned>("height");
+	QTest::addColumn<qulonglong>("maxMemory");
+
+	QTest::newRow("1 x 1") << 1u << 1u << qulonglong(256 << 20);
+	QTest::newRow("4 x 2") << 4u << 2u << qulonglong(256 << 20);
+	QTest::newRow("4 x 2 (small budget)") << 4u << 2u << qulonglong(4096);
+	QTest::newRow("100 x 100 (small budget)") << 100u << 100u << qulonglong(4 << 20);
+}
+
+void TestLASFilter::tileFile() const
+{
+	QFETCH(unsigned, width);
+	QFETCH(unsigned, height);
+	QFETCH(qulonglong, maxMemory);
+
+	QTemporaryDir dir;
+	QVERIFY(dir.isValid());
+	QString inputFilename = dir.filePath("input.las");
+	QVERIFY(WriteLASFile(inputFilename));
+
+	LASFilter::TilingParameters params;
+	params.width = width;
+	params.height = height;
+	params.vertDim = 2;
+	params.outputBaseName = dir.filePath("tile");
+	params.maxMemory = static_cast<size_t>(maxMemory);
+	QCOMPARE(LASFilter::TileFile(inputFilename, params), CC_FERR_NO_ERROR);
+
+	//the input file bounding-box
+	const double minX = 0.0, maxX = 99.9;
+	const double minY = 0.0, maxY = 49.5;
+	const double tileW = (maxX - minX) / width;
+	const double tileH = (maxY - minY) / height;
+	const double epsilon = 0.01; //LAS scale
+
+	point_count_t totalCount = 0;
+	uint64_t intensitySum = 0;
+	for (unsigned i = 0; i < width; ++i)
+	{
+		for (unsigned j = 0; j < height; ++j)
+		{
+			QString tileFilename = QString("%1_%2_%3.las").arg(params.outputBaseName).arg(i).arg(j);
+			QVERIFY(!QFile::exists(tileFilename + ".tmp"));
+			QVERIFY(!QFile::exists(tileFilename + ".part"));
+			if (!QFile::exists(tileFilename))
+			{
+				//empty tile
+				continue;
+			}
+
+			PointTable table;
+			PointViewPtr view = ReadLASFile(tileFilename, table);
+			QVERIFY(view);
+			for (PointId k = 0; k < view->size(); ++k)
+			{
+				double x = view->getFieldAs<double>(Dimension::Id::X, k);
+				double y = view->getFieldAs<double>(Dimension::Id::Y, k);
+				QVERIFY(x >= minX + i * tileW - epsilon && x <= minX + (i + 1) * tileW + epsilon);
+				QVERIFY(y >= minY + j * tileH - epsilon && y <= minY + (j + 1) * tileH + epsilon);
+				intensitySum += view->getFieldAs<uint16_t>(Dimension::Id::Intensity, k);
+			}
+			totalCount += view->size();
+		}
+	}
+
+	uint64_t expectedIntensitySum = 0;
+	for (unsigned i = 0; i < TEST_POINT_COUNT; ++i)
+	{
+		expectedIntensitySum += (i % 65536);
+	}
+
+	QCOMPARE(totalCount, static_cast<point_count_t>(TEST_POINT_COUNT));
+	QCOMPARE(intensitySum, expectedIntensitySum);
+}
+
+void TestLASFilter::tileFileTooManyTiles() const
+{
+	QTemporaryDir dir;
+	QVERIFY(dir.isValid());
+	QString inputFilename = dir.filePath("input.las");
+	QVERIFY(WriteLASFile(inputFilename));
+
+	LASFilter::TilingParameters params;
+	params.width = 100;
+	params.height = 100;
+	params.outputBaseName = dir.filePath("tile");
+	params.maxMemory = 10000; //less than one point per tile
+	QVERIFY(LASFilter::TileFile(inputFilename, params) != CC_FERR_NO_ERROR);
+}
+
+void TestLASFilter::tileFileCanceled() const
+{
+	QTemporaryDir dir;
+	QVERIFY(dir.isValid());
+	QString inputFilename = dir.filePath("input.las");
+	QVERIFY(WriteLASFile(inputFilename));
+
+	LASFilter::TilingParameters params;
+	params.width = 100;
+	params.height = 100;
+	params.vertDim = 2;
+	params.outputBaseName = dir.filePath("tile");
+	params.maxMemory = (4 << 20);
+	CancelWhenWritingTiles progressCb;
+	QCOMPARE(LASFilter::TileFile(inputFilename, params, &progressCb), CC_FERR_CANCELED_BY_USER);
+
+	//no tile (complete, partial or temporary) must be left on disk
+	QCOMPARE(QDir(dir.path()).entryList(QDir::Files), QStringList() << "input.las");
+}
+
+QTEST_MAIN(TestLASFilter)
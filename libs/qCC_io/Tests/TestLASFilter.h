@@ -0,0 +1,23 @@
+#ifndef CC_TEST_LAS_FILTER_HEADER
+#define CC_TEST_LAS_FILTER_HEADER
+
+#include <QObject>
+#include <QtTest/QtTest>
+
+class TestLASFilter : public QObject
+{
+Q_OBJECT
+private slots:
+	/* Tiling: each point must be written once, in the right tile (with a memory budget that forces many flushes) */
+	void tileFile_data() const;
+	void tileFile() const;
+
+	/* Tiling must fail if the memory budget can't hold one point per tile */
+	void tileFileTooManyTiles() const;
+
+	/* A canceled tiling must not leave any (partial) tile on disk */
+	void tileFileCanceled() const;
+};
+
+
+#endif //CC_TEST_LAS_FILTER_HEADER
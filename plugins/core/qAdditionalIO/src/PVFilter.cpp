@@ -188,7 +188,7 @@ CC_FILE_ERROR PVFilter::loadFile(const QString& filename, ccHObject& container,
 				container.addChild(loadedCloud);
 			}
 			fileChunkPos = pointsRead;
-			fileChunkSize = std::min<unsigned>(numberOfPoints - pointsRead, CC_MAX_NUMBER_OF_POINTS_PER_CLOUD);
+			fileChunkSize = static_cast<unsigned>(std::min<PointIndexType>(numberOfPoints - pointsRead, CC_MAX_NUMBER_OF_POINTS_PER_CLOUD));
 			loadedCloud = new ccPointCloud(QString("unnamed - Cloud #%1").arg(++chunkIndex));
 			if (!loadedCloud || !loadedCloud->reserveThePointsTable(fileChunkSize) || !loadedCloud->enableScalarField())
 			{
@@ -57,6 +57,7 @@
 
 //CSF
 #include <CSF.h>
+#include "qCSFCommands.h"
 
 qCSF::qCSF(QObject* parent)
 	: QObject( parent )
@@ -85,6 +86,16 @@ QList<QAction *> qCSF::getActions()
 	return QList<QAction *>{ m_action };
 }
 
+void qCSF::registerCommands(ccCommandLineInterface* cmd)
+{
+	if (!cmd)
+	{
+		assert(false);
+		return;
+	}
+	cmd->registerCommand(ccCommandLineInterface::Command::Shared(new CommandCSF));
+}
+
 void qCSF::doAction()
 {
 	//m_app should have already been initialized by CC when plugin is loaded!
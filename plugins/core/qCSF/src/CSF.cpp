@@ -36,18 +36,103 @@
 //CC (for debug)
 #include <ccMainAppInterface.h>
 
+//CCLib
+#include <GenericProgressCallback.h>
+
 //Qt
 #include <QProgressDialog>
 #include <QCoreApplication>
 #include <QElapsedTimer>
+#include <QThread>
+#include <QThreadPool>
+#include <QtConcurrentMap>
 
 //system
+#include <algorithm>
+#include <atomic>
 #include <cmath>
 #include <iomanip>
 #include <fstream>
 #include <sstream>
 #include <iostream>
 
+//constants
+static const double cloth_y_height = 0.05; //origin cloth height
+static const int clothbuffer = 2; //set the cloth buffer (grid margin size)
+static const double gravity = 0.2;
+
+//! Creates the cloth above a given cloud
+static Cloth CreateCloth(const wl::PointCloud& cloud, const CSF::Parameters& params)
+{
+	//compute the terrain (cloud) bounding-box
+	wl::Point bbMin, bbMax;
+	cloud.computeBoundingBox(bbMin, bbMax);
+
+	//computing the number of cloth node
+	Vec3 origin_pos(	bbMin.x - clothbuffer * params.cloth_resolution,
+						bbMax.y + cloth_y_height,
+						bbMin.z - clothbuffer * params.cloth_resolution);
+
+	int width_num = static_cast<int>(floor((bbMax.x - bbMin.x) / params.cloth_resolution)) + 2 * clothbuffer;
+	int height_num = static_cast<int>(floor((bbMax.z - bbMin.z) / params.cloth_resolution)) + 2 * clothbuffer;
+
+	return Cloth(	origin_pos,
+					width_num,
+					height_num,
+					params.cloth_resolution,
+					params.cloth_resolution,
+					0.3,
+					9999,
+					params.rigidness,
+					params.time_step);
+}
+
+//! Applies the whole CSF process to a cloud (without any GUI)
+/** \param cloud input cloud
+	\param params CSF parameters
+	\param multiThreaded whether the cloth simulation can use several threads
+	\param groundIndexes output ground points indexes
+	\param offGroundIndexes output off-ground points indexes
+	\return success
+**/
+static bool FilterCloud(const wl::PointCloud& cloud,
+						const CSF::Parameters& params,
+						bool multiThreaded,
+						std::vector<int>& groundIndexes,
+						std::vector<int>& offGroundIndexes)
+{
+	Cloth cloth = CreateCloth(cloud, params);
+	cloth.setMultiThreaded(multiThreaded);
+
+	if (!Rasterization::RasterTerrain(cloth, cloud, cloth.getHeightvals(), params.k_nearest_points))
+	{
+		return false;
+	}
+
+	double time_step2 = params.time_step * params.time_step;
+	cloth.addForce(Vec3(0, -gravity, 0) * time_step2);
+	for (int i = 0; i < params.iterations; i++)
+	{
+		double maxDiff = cloth.timeStep();
+		cloth.terrainCollision();
+
+		if (maxDiff != 0 && maxDiff < params.class_threshold / 100)
+		{
+			//early stop
+			break;
+		}
+	}
+
+	//slope processing
+	if (params.bSloopSmooth)
+	{
+		cloth.movableFilter();
+	}
+
+	//classification of the points
+	return Cloud2CloudDist::Compute(cloth, cloud, params.class_threshold, groundIndexes, offGroundIndexes);
+}
+
 CSF::CSF(wl::PointCloud& cloud)
 	: point_cloud(cloud)
 {
@@ -109,38 +194,13 @@ bool CSF::do_filtering(	std::vector<int>& groundIndexes,
 						ccMainAppInterface* app/*=0*/,
 						QWidget* parent/*=0*/)
 {
-	//constants
-	static const double cloth_y_height = 0.05; //origin cloth height
-	static const int clothbuffer = 2; //set the cloth buffer (grid margin size)
-	static const double gravity = 0.2;
-
 	try
 	{
 		QElapsedTimer timer;
 		timer.start();
 
-		//compute the terrain (cloud) bounding-box
-		wl::Point bbMin, bbMax;
-		point_cloud.computeBoundingBox(bbMin, bbMax);
-
-		//computing the number of cloth node
-		Vec3 origin_pos(	bbMin.x - clothbuffer * params.cloth_resolution,
-							bbMax.y + cloth_y_height,
-							bbMin.z - clothbuffer * params.cloth_resolution);
-	
-		int width_num = static_cast<int>(floor((bbMax.x - bbMin.x) / params.cloth_resolution)) + 2 * clothbuffer;
-		int height_num = static_cast<int>(floor((bbMax.z - bbMin.z) / params.cloth_resolution)) + 2 * clothbuffer;
-		
 		//Cloth object
-		Cloth cloth(origin_pos, 
-					width_num,
-					height_num,
-					params.cloth_resolution,
-					params.cloth_resolution,
-					0.3,
-					9999,
-					params.rigidness,
-					params.time_step);
+		Cloth cloth = CreateCloth(point_cloud, params);
 		if (app)
 		{
 			app->dispToConsole(QString("[CSF] Cloth creation: %1 ms").arg(timer.restart()));
@@ -242,6 +302,238 @@ bool CSF::do_filtering(	std::vector<int>& groundIndexes,
 	}
 }
 
+bool CSF::do_filtering_tiled(	std::vector<int>& groundIndexes,
+								std::vector<int>& offGroundIndexes,
+								double tileSize,
+								double tileOverlap,
+								int maxThreadCount/*=0*/,
+								ccMainAppInterface* app/*=0*/,
+								CCLib::GenericProgressCallback* progressCb/*=0*/)
+{
+	if (point_cloud.empty())
+	{
+		return false;
+	}
+
+	try
+	{
+		QElapsedTimer timer;
+		timer.start();
+
+		//compute the terrain (cloud) bounding-box
+		wl::Point bbMin, bbMax;
+		point_cloud.computeBoundingBox(bbMin, bbMax);
+
+		//tiles grid (in the horizontal plane, i.e. X and Z)
+		int tileCountX = 1;
+		int tileCountZ = 1;
+		int overlapTileCount = 0; //number of neighbor tiles (in each direction) that may overlap a tile
+		if (tileSize > 0)
+		{
+			tileCountX = std::max(1, static_cast<int>(ceil((bbMax.x - bbMin.x) / tileSize)));
+			tileCountZ = std::max(1, static_cast<int>(ceil((bbMax.z - bbMin.z) / tileSize)));
+			tileOverlap = std::max(0.0, tileOverlap);
+			overlapTileCount = static_cast<int>(ceil(tileOverlap / tileSize));
+		}
+		else
+		{
+			tileOverlap = 0;
+		}
+		int tileCount = tileCountX * tileCountZ;
+
+		//sort the points by tile (counting sort)
+		unsigned pointCount = static_cast<unsigned>(point_cloud.size());
+		std::vector<unsigned> tileStart(tileCount + 1, 0);
+		std::vector<unsigned> sortedIndexes(pointCount);
+		{
+			std::vector<int> pointTile(pointCount, 0);
+			if (tileCount > 1)
+			{
+				for (unsigned i = 0; i < pointCount; ++i)
+				{
+					const wl::Point& P = point_cloud[i];
+					int tx = std::min(static_cast<int>((P.x - bbMin.x) / tileSize), tileCountX - 1);
+					int tz = std::min(static_cast<int>((P.z - bbMin.z) / tileSize), tileCountZ - 1);
+					pointTile[i] = tz * tileCountX + tx;
+				}
+			}
+			for (unsigned i = 0; i < pointCount; ++i)
+			{
+				++tileStart[pointTile[i] + 1];
+			}
+			for (int t = 0; t < tileCount; ++t)
+			{
+				tileStart[t + 1] += tileStart[t];
+			}
+			std::vector<unsigned> fillIndex(tileStart.begin(), tileStart.end() - 1);
+			for (unsigned i = 0; i < pointCount; ++i)
+			{
+				sortedIndexes[fillIndex[pointTile[i]]++] = i;
+			}
+		}
+
+		//non-empty tiles
+		std::vector<int> tiles;
+		for (int t = 0; t < tileCount; ++t)
+		{
+			if (tileStart[t + 1] > tileStart[t])
+			{
+				tiles.push_back(t);
+			}
+		}
+
+		bool useParallelStrategy = (tiles.size() > 1);
+#ifdef _DEBUG
+		useParallelStrategy = false;
+#endif
+
+		//ground flag for each point (each point is classified by a single tile)
+		std::vector<unsigned char> isGround(pointCount, 0);
+
+		CCLib::NormalizedProgress nProgress(progressCb, static_cast<unsigned>(tiles.size()));
+		if (progressCb)
+		{
+			if (progressCb->textCanBeEdited())
+			{
+				progressCb->setMethodTitle("CSF");
+				progressCb->setInfo(qPrintable(QString("Cloth simulation\n%1 tile(s)").arg(tiles.size())));
+			}
+			progressCb->update(0);
+			progressCb->start();
+		}
+
+		std::atomic<bool> canceled(false);
+		std::atomic<bool> failed(false);
+
+		auto processTile = [&](int tileIndex)
+		{
+			if (canceled || failed)
+				return;
+
+			try
+			{
+				int tx = tileIndex % tileCountX;
+				int tz = tileIndex / tileCountX;
+
+				//extended tile limits
+				double minX = bbMin.x + tx * tileSize - tileOverlap;
+				double maxX = bbMin.x + (tx + 1) * tileSize + tileOverlap;
+				double minZ = bbMin.z + tz * tileSize - tileOverlap;
+				double maxZ = bbMin.z + (tz + 1) * tileSize + tileOverlap;
+
+				//the points of the tile itself come first
+				wl::PointCloud tileCloud;
+				std::vector<unsigned> tileToGlobal(sortedIndexes.begin() + tileStart[tileIndex], sortedIndexes.begin() + tileStart[tileIndex + 1]);
+				unsigned tilePointCount = static_cast<unsigned>(tileToGlobal.size());
+
+				//then the points of the overlapping margin
+				for (int nz = std::max(0, tz - overlapTileCount); nz <= std::min(tileCountZ - 1, tz + overlapTileCount); ++nz)
+				{
+					for (int nx = std::max(0, tx - overlapTileCount); nx <= std::min(tileCountX - 1, tx + overlapTileCount); ++nx)
+					{
+						int neighborIndex = nz * tileCountX + nx;
+						if (neighborIndex == tileIndex)
+							continue;
+
+						for (unsigned j = tileStart[neighborIndex]; j < tileStart[neighborIndex + 1]; ++j)
+						{
+							const wl::Point& P = point_cloud[sortedIndexes[j]];
+							if (P.x >= minX && P.x <= maxX && P.z >= minZ && P.z <= maxZ)
+							{
+								tileToGlobal.push_back(sortedIndexes[j]);
+							}
+						}
+					}
+				}
+
+				tileCloud.resize(tileToGlobal.size());
+				for (size_t j = 0; j < tileToGlobal.size(); ++j)
+				{
+					tileCloud[j] = point_cloud[tileToGlobal[j]];
+				}
+
+				std::vector<int> tileGroundIndexes, tileOffGroundIndexes;
+				if (!FilterCloud(tileCloud, params, !useParallelStrategy, tileGroundIndexes, tileOffGroundIndexes))
+				{
+					failed = true;
+					return;
+				}
+
+				//only the points of the tile itself are classified (not the ones of the margin)
+				for (int index : tileGroundIndexes)
+				{
+					if (static_cast<unsigned>(index) < tilePointCount)
+					{
+						isGround[tileToGlobal[index]] = 1;
+					}
+				}
+			}
+			catch (const std::bad_alloc&)
+			{
+				//not enough memory
+				failed = true;
+				return;
+			}
+
+			if (progressCb && !nProgress.oneStep())
+			{
+				canceled = true;
+			}
+		};
+
+		if (useParallelStrategy)
+		{
+			if (maxThreadCount == 0)
+			{
+				maxThreadCount = QThread::idealThreadCount();
+			}
+			QThreadPool::globalInstance()->setMaxThreadCount(maxThreadCount);
+			QtConcurrent::blockingMap(tiles, processTile);
+		}
+		else
+		{
+			for (int tileIndex : tiles)
+			{
+				processTile(tileIndex);
+			}
+		}
+
+		if (progressCb)
+		{
+			progressCb->stop();
+		}
+
+		if (app)
+		{
+			app->dispToConsole(QString("[CSF] %1 tile(s) processed: %2 ms").arg(tiles.size()).arg(timer.restart()));
+		}
+
+		if (canceled || failed)
+		{
+			return false;
+		}
+
+		for (unsigned i = 0; i < pointCount; ++i)
+		{
+			if (isGround[i])
+			{
+				groundIndexes.push_back(static_cast<int>(i));
+			}
+			else
+			{
+				offGroundIndexes.push_back(static_cast<int>(i));
+			}
+		}
+	}
+	catch (const std::bad_alloc&)
+	{
+		//not enough memory
+		return false;
+	}
+
+	return true;
+}
+
 //Exporting the ground points to file.
 void CSF::saveGroundPoints(const std::vector<int>& grp, std::string path)
 {
@@ -40,6 +40,11 @@ class ccMainAppInterface;
 class QWidget;
 class ccMesh;
 
+namespace CCLib
+{
+	class GenericProgressCallback;
+}
+
 class CSF
 {
 public:
@@ -61,6 +66,28 @@ public:
 						ccMainAppInterface* app = 0,
 						QWidget* parent = 0);
 
+	//! Tiled filtering (for very large clouds)
+	/** The cloud is split in square tiles (in the horizontal plane). The cloth
+		simulation is run on each tile extended by an overlap margin, and each
+		point is eventually classified by the tile it belongs to. The tiles are
+		processed in parallel: only the tiles being processed are held in memory.
+		\param groundIndexes output ground points indexes
+		\param offGroundIndexes output off-ground points indexes
+		\param tileSize tile size (0 = a single tile)
+		\param tileOverlap overlap margin around each tile
+		\param maxThreadCount max number of tiles processed in parallel (0 = all)
+		\param app application interface (for logging, optional)
+		\param progressCb progress callback (optional)
+		\return success
+	**/
+	bool do_filtering_tiled(std::vector<int>& groundIndexes,
+							std::vector<int>& offGroundIndexes,
+							double tileSize,
+							double tileOverlap,
+							int maxThreadCount = 0,
+							ccMainAppInterface* app = 0,
+							CCLib::GenericProgressCallback* progressCb = 0);
+
 private:
 	wl::PointCloud& point_cloud;
 
@@ -41,6 +41,29 @@
 #include <sstream>
 #include <queue>
 
+//we precompute the overall displacement of a particle accroding to the rigidness
+//const double singleMove1[15] = {0, 0.4, 0.64, 0.784, 0.8704, 0.92224, 0.95334, 0.97201, 0.9832, 0.98992, 0.99395, 0.99637, 0.99782, 0.99869, 0.99922 };
+static const double singleMove1[15] = { 0, 0.3, 0.51, 0.657, 0.7599, 0.83193, 0.88235, 0.91765, 0.94235, 0.95965, 0.97175, 0.98023, 0.98616, 0.99031, 0.99322 };
+//when both particles move
+//const double doubleMove1[15] = {0, 0.4, 0.48, 0.496, 0.4992, 0.49984, 0.49997, 0.49999, 0.5, 0.5, 0.5, 0.5, 0.5, 0.5, 0.5 };
+static const double doubleMove1[15] = { 0, 0.3, 0.42, 0.468, 0.4872, 0.4949, 0.498, 0.4992, 0.4997, 0.4999, 0.4999, 0.5, 0.5, 0.5, 0.5 };
+
+//! Relative positions of the particles constrained with a given particle
+/** Immediate neighbors (distance 1 and sqrt(2) in the grid) and secondary
+	neighbors (distance 2 and sqrt(8) in the grid).
+	\warning The order matters (the constraints are applied sequentially)
+**/
+static const int NeighborOffsets[Cloth::MAX_NEIGHBOR_COUNT][2] = {	{ -1, -1 }, { -1,  0 }, { -1,  1 }, {  0, -1 },
+																	{  1, -1 }, {  1,  0 }, {  0,  1 }, {  1,  1 },
+																	{ -2, -2 }, { -2,  0 }, { -2,  2 }, {  0, -2 },
+																	{  2, -2 }, {  2,  0 }, {  0,  2 }, {  2,  2 } };
+
+//! Relative positions of the direct neighbors (left, right, bottom and top)
+static const int DirectNeighborOffsets[4][2] = { { -1, 0 }, { 1, 0 }, { 0, -1 }, { 0, 1 } };
+
+//! Max distance (in rows) between two constrained particles
+static const int MAX_CONSTRAINT_ROW_DIST = 2;
+
 Cloth::Cloth(	const Vec3& _origin_pos,
 				int _num_particles_width,
 				int _num_particles_height,
@@ -52,80 +75,36 @@ Cloth::Cloth(	const Vec3& _origin_pos,
 				double time_step)
 	: constraint_iterations(rigidness)
 	, time_step(time_step)
+	, acceleration_y(0)
 	, smoothThreshold(_smoothThreshold)
 	, heightThreshold(_heightThreshold)
+	, multiThreaded(true)
 	, num_particles_width(_num_particles_width)
 	, num_particles_height(_num_particles_height)
 	, origin_pos(_origin_pos)
 	, step_x(_step_x)
 	, step_y(_step_y)
 {
-	particles.resize(num_particles_width*num_particles_height); //I am essentially using this vector as an array with room for num_particles_width*num_particles_height particles
-
-	double time_step2 = time_step*time_step;
-
-	// creating particles in a grid
-	for (int i = 0; i < num_particles_width; i++)
-	{
-		for (int j = 0; j < num_particles_height; j++)
-		{
-			Vec3 pos(	origin_pos.x + i * step_x,
-						origin_pos.y,
-						origin_pos.z + j * step_y);
-
-			particles[j*num_particles_width + i] = Particle(pos, time_step2); // insert particle in column i at j'th row
-			particles[j*num_particles_width + i].pos_x = i;
-			particles[j*num_particles_width + i].pos_y = j;
-		}
-	}
-
-	// Connecting immediate neighbor particles with constraints (distance 1 and sqrt(2) in the grid)
-	for (int x = 0; x<num_particles_width; x++)
-	{
-		for (int y = 0; y<num_particles_height; y++)
-		{
-			if (x < num_particles_width - 1)
-			{
-				addConstraint(&getParticle(x, y), &getParticle(x + 1, y));
-			}
-
-			if (y < num_particles_height - 1)
-			{
-				addConstraint(&getParticle(x, y), &getParticle(x, y + 1));
-			}
-
-			if (x < num_particles_width - 1 && y < num_particles_height - 1)
-			{
-				addConstraint(&getParticle(x, y), &getParticle(x + 1, y + 1));
-				addConstraint(&getParticle(x + 1, y), &getParticle(x, y + 1));
-			}
-		}
-	}
+	// creating particles in a grid (all at the same height)
+	int particleCount = getSize();
+	pos_y.resize(particleCount, origin_pos.y);
+	old_pos_y.resize(particleCount, origin_pos.y);
+	movable.resize(particleCount, 1);
+}
 
-	// Connecting secondary neighbors with constraints (distance 2 and sqrt(4) in the grid)
-	for (int x = 0; x < num_particles_width; x++)
+int Cloth::getNeighbors(int x, int y, int neighbors[]) const
+{
+	int count = 0;
+	for (int k = 0; k < MAX_NEIGHBOR_COUNT; ++k)
 	{
-		for (int y = 0; y < num_particles_height; y++)
+		int nx = x + NeighborOffsets[k][0];
+		int ny = y + NeighborOffsets[k][1];
+		if (nx >= 0 && nx < num_particles_width && ny >= 0 && ny < num_particles_height)
 		{
-			if (x < num_particles_width - 2)
-			{
-				addConstraint(&getParticle(x, y), &getParticle(x + 2, y));
-			}
-
-
-			if (y < num_particles_height - 2)
-			{
-				addConstraint(&getParticle(x, y), &getParticle(x, y + 2));
-			}
-
-
-			if (x < num_particles_width - 2 && y < num_particles_height - 2)
-			{
-				addConstraint(&getParticle(x, y), &getParticle(x + 2, y + 2));
-				addConstraint(&getParticle(x + 2, y), &getParticle(x, y + 2));
-			}
+			neighbors[count++] = getIndex(nx, ny);
 		}
 	}
+	return count;
 }
 
 ccMesh* Cloth::toMesh() const
@@ -148,10 +127,10 @@ ccMesh* Cloth::toMesh() const
 	//copy the vertices (particles)
 	for (int i = 0; i < getSize(); ++i)
 	{
-		const Particle& particle = particles[i];
-		vertices->addPoint(CCVector3(	static_cast<PointCoordinateType>(particle.pos.x),
-										static_cast<PointCoordinateType>(particle.pos.z),
-										static_cast<PointCoordinateType>(-particle.pos.y)));
+		Vec3 pos = getParticlePos(i);
+		vertices->addPoint(CCVector3(	static_cast<PointCoordinateType>(pos.x),
+										static_cast<PointCoordinateType>(pos.z),
+										static_cast<PointCoordinateType>(-pos.y)));
 	}
 
 	//and create the triangles
@@ -174,45 +153,99 @@ ccMesh* Cloth::toMesh() const
 	return mesh;
 }
 
+void Cloth::satisfyConstraints(int y)
+{
+	double singleMove = (constraint_iterations > 14 ? 1.0 : singleMove1[constraint_iterations]);
+	double doubleMove = (constraint_iterations > 14 ? 0.5 : doubleMove1[constraint_iterations]);
+
+	for (int x = 0; x < num_particles_width; ++x)
+	{
+		int i1 = getIndex(x, y);
+		for (int k = 0; k < MAX_NEIGHBOR_COUNT; ++k)
+		{
+			int nx = x + NeighborOffsets[k][0];
+			int ny = y + NeighborOffsets[k][1];
+			if (nx < 0 || nx >= num_particles_width || ny < 0 || ny >= num_particles_height)
+			{
+				continue;
+			}
+
+			int i2 = getIndex(nx, ny);
+			double correction = pos_y[i2] - pos_y[i1];
+			if (movable[i1] && movable[i2])
+			{
+				double correctionHalf = correction * doubleMove; // Lets make it half that length, so that we can move BOTH p1 and p2.
+				pos_y[i1] += correctionHalf;
+				pos_y[i2] -= correctionHalf;
+			}
+			else if (movable[i1])
+			{
+				pos_y[i1] += correction * singleMove;
+			}
+			else if (movable[i2])
+			{
+				pos_y[i2] -= correction * singleMove;
+			}
+		}
+	}
+}
+
 double Cloth::timeStep()
 {
-	int particleCount = static_cast<int>(particles.size());
+	int particleCount = static_cast<int>(pos_y.size());
+	double time_step2 = time_step * time_step;
 
-#pragma omp parallel for
+	//verlet integration
+#pragma omp parallel for if(multiThreaded)
 	for (int i = 0; i < particleCount; i++)
 	{
-		particles[i].timeStep();
+		if (movable[i])
+		{
+			double temp = pos_y[i];
+			pos_y[i] = pos_y[i] + (pos_y[i] - old_pos_y[i]) * (1.0 - DAMPING) + acceleration_y * time_step2;
+			old_pos_y[i] = temp;
+		}
 	}
+
 /*
 Instead of interating over all the constraints several times, we 
-compute the overall displacement of a particle accroding to the rigidness
-*/
+compute the overall displacement of a particle accroding to the rigidness.
 
-#pragma omp parallel for
-	for (int j = 0; j < particleCount; j++)
+A particle only moves the particles that are less than MAX_CONSTRAINT_ROW_DIST
+rows away: the rows are processed by interleaved groups, so that the rows of
+a same group can be processed concurrently without any race condition.
+*/
+	static const int rowGroupCount = 2 * MAX_CONSTRAINT_ROW_DIST + 1;
+	for (int g = 0; g < rowGroupCount; ++g)
 	{
-		particles[j].satisfyConstraintSelf(constraint_iterations);
+#pragma omp parallel for if(multiThreaded)
+		for (int y = g; y < num_particles_height; y += rowGroupCount)
+		{
+			satisfyConstraints(y);
+		}
 	}
 
-
-//	for (int i = 0; i<constraint_iterations; i++) // iterate over all constraints several times
-//	{
-//#pragma omp parallel for
-//		for (int j = 0; j < constraints.size(); j++)
-//		{
-//			constraints[j].satisfyConstraint();
-//		}
-//	}
-
+	//max displacement (each thread computes its own max. first)
 	double maxDiff = 0;
-#pragma omp parallel for
-	for (int i = 0; i < particleCount; i++)
+#pragma omp parallel if(multiThreaded)
 	{
-		if (particles[i].isMovable())
+		double threadMaxDiff = 0;
+
+#pragma omp for
+		for (int i = 0; i < particleCount; i++)
+		{
+			if (movable[i])
+			{
+				double diff = std::abs(old_pos_y[i] - pos_y[i]);
+				if (diff > threadMaxDiff)
+					threadMaxDiff = diff;
+			}
+		}
+
+#pragma omp critical
 		{
-			double diff = std::abs(particles[i].old_pos.y - particles[i].pos.y);
-			if (diff > maxDiff)
-				maxDiff = diff;
+			if (threadMaxDiff > maxDiff)
+				maxDiff = threadMaxDiff;
 		}
 	}
 
@@ -221,141 +254,84 @@ compute the overall displacement of a particle accroding to the rigidness
 
 void Cloth::addForce(const Vec3& direction)
 {
-	int particleCount = static_cast<int>(particles.size());
+	//the particles can only move vertically
+	assert(direction.x == 0 && direction.z == 0);
 
-	// add the forces to each particle
-#pragma omp parallel for
-	for (int i = 0; i < particleCount; i++)
-	{
-		particles[i].addForce(direction);
-	}
+	// add the forces to all particles
+	acceleration_y += direction.y;
 }
 
 //testing the collision
 void Cloth::terrainCollision()
 {
-	assert(particles.size() == heightvals.size());
+	assert(pos_y.size() == heightvals.size());
 
-	int particleCount = static_cast<int>(particles.size());
-#pragma omp parallel for
+	int particleCount = static_cast<int>(pos_y.size());
+#pragma omp parallel for if(multiThreaded)
 	for (int i = 0; i < particleCount; i++)
 	{
-		Particle& particle = particles[i];
-		if (particle.pos.y < heightvals[i]) // if the particle is inside the ball
+		if (pos_y[i] < heightvals[i]) // if the particle is inside the ball
 		{
-			particle.offsetPos(Vec3(0, heightvals[i] - particle.pos.y, 0));
-			particle.makeUnmovable();
+			offsetParticleHeight(i, heightvals[i] - pos_y[i]);
+			makeUnmovable(i);
 		}
 	}
 }
 
 void Cloth::movableFilter()
 {
+	std::vector<bool> visited(getSize(), false);
+	std::vector<int> c_pos(getSize(), 0); //position in the group of movable points
+
 	for (int x = 0; x < num_particles_width; x++)
 	{
 		for (int y = 0; y < num_particles_height; y++)
 		{
-			Particle& ptc = getParticle(x, y);
-			if (ptc.isMovable() && !ptc.isVisited)
+			int index = getIndex(x, y);
+			if (isMovable(index) && !visited[index])
 			{
 				std::queue<int> que;
 				std::vector<XY> connected; //store the connected component
 				std::vector< std::vector<int> > neibors;
 				int sum = 1;
-				int index = y*num_particles_width + x;
 				// visit the init node
 				connected.push_back(XY(x,y));
-				particles[index].isVisited = true;
+				visited[index] = true;
 				//enqueue the init node
 				que.push(index);
 				while (!que.empty())
 				{
-					Particle& ptc_f = particles[que.front()];
+					int cur_index = que.front();
 					que.pop();
-					int cur_x = ptc_f.pos_x;
-					int cur_y = ptc_f.pos_y;
+					int cur_x = cur_index % num_particles_width;
+					int cur_y = cur_index / num_particles_width;
 					std::vector<int> neighbor;
 
-					if (cur_x > 0)
-					{
-						Particle& ptc_left = getParticle(cur_x - 1, cur_y);
-						if (ptc_left.isMovable())
-						{
-							if (!ptc_left.isVisited)
-							{
-								sum++;
-								ptc_left.isVisited = true;
-								connected.push_back(XY(cur_x - 1, cur_y));
-								que.push(num_particles_width*cur_y + cur_x - 1);
-								neighbor.push_back(sum - 1);
-								ptc_left.c_pos = sum - 1;
-							}
-							else
-							{
-								neighbor.push_back(ptc_left.c_pos);
-							}
-						}
-					}
-
-					if (cur_x < num_particles_width - 1)
-					{
-						Particle& ptc_right = getParticle(cur_x + 1, cur_y);
-						if (ptc_right.isMovable())
-						{
-							if (!ptc_right.isVisited)
-							{
-								sum++;
-								ptc_right.isVisited = true;
-								connected.push_back(XY(cur_x + 1, cur_y));
-								que.push(num_particles_width*cur_y + cur_x + 1);
-								neighbor.push_back(sum - 1);
-								ptc_right.c_pos = sum - 1;
-							}
-							else
-							{
-								neighbor.push_back(ptc_right.c_pos);
-							}
-						}
-					}
-
-					if (cur_y > 0)
+					//left, right, bottom and top neighbors
+					for (int k = 0; k < 4; ++k)
 					{
-						Particle& ptc_bottom = getParticle(cur_x, cur_y - 1);
-						if (ptc_bottom.isMovable())
+						int nx = cur_x + DirectNeighborOffsets[k][0];
+						int ny = cur_y + DirectNeighborOffsets[k][1];
+						if (nx < 0 || nx >= num_particles_width || ny < 0 || ny >= num_particles_height)
 						{
-							if (!ptc_bottom.isVisited)
-							{
-								sum++;
-								ptc_bottom.isVisited = true;
-								connected.push_back(XY(cur_x, cur_y - 1));
-								que.push(num_particles_width*(cur_y - 1) + cur_x);
-								neighbor.push_back(sum - 1);
-								ptc_bottom.c_pos = sum - 1;
-							}
-							else
-							{
-								neighbor.push_back(ptc_bottom.c_pos);
-							}
+							continue;
 						}
-					}
 
-					if (cur_y < num_particles_height - 1)
-					{
-						Particle& ptc_top = getParticle(cur_x, cur_y + 1);
-						if (ptc_top.isMovable())
+						int n_index = getIndex(nx, ny);
+						if (isMovable(n_index))
 						{
-							if (!ptc_top.isVisited)
+							if (!visited[n_index])
 							{
 								sum++;
-								ptc_top.isVisited = true;
-								connected.push_back(XY(cur_x, cur_y + 1));
-								que.push(num_particles_width*(cur_y + 1) + cur_x);
+								visited[n_index] = true;
+								connected.push_back(XY(nx, ny));
+								que.push(n_index);
 								neighbor.push_back(sum - 1);
-								ptc_top.c_pos = sum - 1;
+								c_pos[n_index] = sum - 1;
 							}
 							else
 							{
-								neighbor.push_back(ptc_top.c_pos);
+								neighbor.push_back(c_pos[n_index]);
 							}
 						}
 					}
@@ -382,73 +358,27 @@ void Cloth::findUnmovablePoint(	const std::vector<XY>& connected,
 	{
 		int x = connected[i].x;
 		int y = connected[i].y;
-		int index = y*num_particles_width + x;
-		Particle& ptc = getParticle(x, y);
-		if (x > 0)
-		{
-			const Particle& ptc_x = getParticle(x - 1, y);
-			if (!ptc_x.isMovable())
-			{
-				int index_ref = y*num_particles_width + x - 1;
-				if (std::abs(heightvals[index] - heightvals[index_ref]) < smoothThreshold && ptc.pos.y - heightvals[index] < heightThreshold)
-				{
-					Vec3 offsetVec(0, heightvals[index] - ptc.pos.y, 0);
-					particles[index].offsetPos(offsetVec);
-					ptc.makeUnmovable();
-					edgePoints.push_back(static_cast<int>(i));
-					continue;
-				}
-			}
-		}
+		int index = getIndex(x, y);
 
-		if (x < num_particles_width - 1)
+		//left, right, bottom and top neighbors
+		for (int k = 0; k < 4; ++k)
 		{
-			const Particle& ptc_x = getParticle(x + 1, y);
-			if (!ptc_x.isMovable())
+			int nx = x + DirectNeighborOffsets[k][0];
+			int ny = y + DirectNeighborOffsets[k][1];
+			if (nx < 0 || nx >= num_particles_width || ny < 0 || ny >= num_particles_height)
 			{
-				int index_ref = y*num_particles_width + x + 1;
-				if (std::abs(heightvals[index] - heightvals[index_ref]) < smoothThreshold && ptc.pos.y - heightvals[index] < heightThreshold)
-				{
-					Vec3 offsetVec(0, heightvals[index] - ptc.pos.y, 0);
-					particles[index].offsetPos(offsetVec);
-					ptc.makeUnmovable();
-					edgePoints.push_back(static_cast<int>(i));
-					continue;
-				}
-			}
-		}
-
-		if (y > 0)
-		{
-			const Particle& ptc_y = getParticle(x, y - 1);
-			if (!ptc_y.isMovable())
-			{
-				int index_ref = (y - 1)*num_particles_width + x;
-				if (std::abs(heightvals[index] - heightvals[index_ref]) < smoothThreshold && ptc.pos.y - heightvals[index] < heightThreshold)
-				{
-					Vec3 offsetVec(0, heightvals[index] - ptc.pos.y, 0);
-					particles[index].offsetPos(offsetVec);
-					ptc.makeUnmovable();
-					edgePoints.push_back(static_cast<int>(i));
-					continue;
-				}
+				continue;
 			}
 
-		}
-
-		if (y < num_particles_height - 1)
-		{
-			const Particle& ptc_y = getParticle(x, y + 1);
-			if (!ptc_y.isMovable())
+			int index_ref = getIndex(nx, ny);
+			if (!isMovable(index_ref))
 			{
-				int index_ref = (y + 1)*num_particles_width + x;
-				if (std::abs(heightvals[index] - heightvals[index_ref]) < smoothThreshold && ptc.pos.y - heightvals[index] < heightThreshold)
+				if (std::abs(heightvals[index] - heightvals[index_ref]) < smoothThreshold && pos_y[index] - heightvals[index] < heightThreshold)
 				{
-					Vec3 offsetVec(0, heightvals[index] - ptc.pos.y, 0);
-					particles[index].offsetPos(offsetVec);
-					ptc.makeUnmovable();
+					offsetParticleHeight(index, heightvals[index] - pos_y[index]);
+					makeUnmovable(index);
 					edgePoints.push_back(static_cast<int>(i));
-					continue;
+					break;
 				}
 			}
 		}
@@ -479,11 +409,10 @@ void Cloth::handle_slop_connected(	const std::vector<int>& edgePoints,
 		for (size_t i = 0; i < neibors[index].size(); i++)
 		{
 			int index_neibor = connected[neibors[index][i]].y*num_particles_width + connected[neibors[index][i]].x;
-			if (std::abs(heightvals[index_center] - heightvals[index_neibor]) < smoothThreshold && fabs(particles[index_neibor].pos.y - heightvals[index_neibor]) < heightThreshold)
+			if (std::abs(heightvals[index_center] - heightvals[index_neibor]) < smoothThreshold && fabs(pos_y[index_neibor] - heightvals[index_neibor]) < heightThreshold)
 			{
-				Vec3 offsetVec(0, heightvals[index_neibor] - particles[index_neibor].pos.y, 0);
-				particles[index_neibor].offsetPos(offsetVec);
-				particles[index_neibor].makeUnmovable();
+				offsetParticleHeight(index_neibor, heightvals[index_neibor] - pos_y[index_neibor]);
+				makeUnmovable(index_neibor);
 				if (visited[neibors[index][i]] == false)
 				{
 					que.push(neibors[index][i]);
@@ -508,10 +437,10 @@ void Cloth::saveToFile(std::string path)
 	std::ofstream f1(filepath);
 	if (!f1)
 		return;
-	for (size_t i = 0; i < particles.size(); i++)
+	for (int i = 0; i < getSize(); i++)
 	{
-		//if (!particles[i].isMovable())
-		f1 << std::fixed << std::setprecision(8) << particles[i].pos.x << "	" << particles[i].pos.z << "	" << -particles[i].pos.y << std::endl;
+		Vec3 pos = getParticlePos(i);
+		f1 << std::fixed << std::setprecision(8) << pos.x << "	" << pos.z << "	" << -pos.y << std::endl;
 	}
 	f1.close();
 }
@@ -530,10 +459,13 @@ void Cloth::saveMovableToFile(std::string path)
 	std::ofstream f1(filepath);
 	if (!f1)
 		return;
-	for (size_t i = 0; i < particles.size(); i++)
+	for (int i = 0; i < getSize(); i++)
 	{
-		if (particles[i].isMovable())
-			f1 << std::fixed << std::setprecision(8) << particles[i].pos.x << "	" << particles[i].pos.z << "	" << -particles[i].pos.y << std::endl;
+		if (isMovable(i))
+		{
+			Vec3 pos = getParticlePos(i);
+			f1 << std::fixed << std::setprecision(8) << pos.x << "	" << pos.z << "	" << -pos.y << std::endl;
+		}
 	}
 	f1.close();
 }
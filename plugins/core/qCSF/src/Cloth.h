@@ -48,12 +48,16 @@
 
 //local
 #include "Vec3.h"
-#include "Particle.h"
 
 //system
 #include <vector>
 #include <string>
 
+/* Some physics constants */
+#define DAMPING 0.01 // how much to damp the cloth simulation each frame
+#define MAX_INF 9999999999 
+#define MIN_INF -9999999999
+
 class ccMesh;
 
 struct XY
@@ -75,8 +79,14 @@ private:
 
 	double time_step;
 
-	std::vector<Particle> particles; // all particles that are part of this cloth
-//	std::vector<Constraint> constraints; // alle constraints between particles as part of this cloth
+	//! Particles (structure-of-arrays layout)
+	/** The particles only move vertically: their X and Z coordinates are
+		defined by their position in the grid (see getParticlePos).
+	**/
+	std::vector<double> pos_y; // the current height of each particle
+	std::vector<double> old_pos_y; // the height of each particle at the previous time step (verlet integration)
+	std::vector<unsigned char> movable; // whether each particle can move or not
+	double acceleration_y; // the (vertical) acceleration, shared by all particles
 
 	//parameters of slope postpocessing
 	double smoothThreshold;
@@ -85,23 +95,16 @@ private:
 	//heightvalues
 	std::vector<double> heightvals;
 
-	//movable particle index
-	std::vector<int> movableIndex;
-	std::vector< std::vector<int> > particle_edges;
-	
-	//record 
-	inline void addConstraint(Particle *p1, Particle *p2) 
-	{ /*constraints.push_back(Constraint(p1, p2));*/ 
-		p1->neighborsList.push_back(p2);  //record the neighbor for each particle
-		p2->neighborsList.push_back(p1);
-	}
+	//whether OpenMP can be used inside this cloth methods
+	bool multiThreaded;
+
+	//applies the constraints of all the particles of a given row
+	void satisfyConstraints(int y);
 
 public:
 
-	inline Particle& getParticle(int x, int y) { return particles[y*num_particles_width + x]; }
-	inline const Particle& getParticle(int x, int y) const { return particles[y*num_particles_width + x]; }
-	inline Particle& getParticleByIndex(int index) { return particles[index]; }
-	inline const Particle getParticleByIndex(int index) const { return particles[index]; }
+	//! Max number of neighbors (constraints) per particle
+	static const int MAX_NEIGHBOR_COUNT = 16;
 
 	int num_particles_width; // number of particles in "width" direction
 	int num_particles_height; // number of particles in "height" direction
@@ -109,9 +112,31 @@ public:
 	double step_x, step_y;
 
 	inline int getSize() const { return num_particles_width * num_particles_height; }
+	inline int getIndex(int x, int y) const { return y*num_particles_width + x; }
+
+	inline Vec3 getParticlePos(int x, int y) const { return Vec3(origin_pos.x + x * step_x, pos_y[getIndex(x, y)], origin_pos.z + y * step_y); }
+	inline Vec3 getParticlePos(int index) const { return getParticlePos(index % num_particles_width, index / num_particles_width); }
+	inline double getParticleHeight(int x, int y) const { return pos_y[getIndex(x, y)]; }
+	inline double getParticleHeight(int index) const { return pos_y[index]; }
+	inline bool isMovable(int index) const { return movable[index] != 0; }
+	inline void makeUnmovable(int index) { movable[index] = 0; }
+	inline void offsetParticleHeight(int index, double dy) { if (movable[index]) pos_y[index] += dy; }
+
+	//! Returns the indexes of the particles connected to a given particle by a constraint
+	/** \param x particle position in the grid (width)
+		\param y particle position in the grid (height)
+		\param neighbors output indexes (array of at least MAX_NEIGHBOR_COUNT elements)
+		\return the number of neighbors
+	**/
+	int getNeighbors(int x, int y, int neighbors[]) const;
 
 	inline std::vector<double>& getHeightvals() { return heightvals; }
 
+	//! Sets whether OpenMP can be used by this cloth methods (true by default)
+	/** Should be disabled when several cloths are processed in parallel.
+	**/
+	inline void setMultiThreaded(bool state) { multiThreaded = state; }
+
 public:
 	
 	/* This is a important constructor for the entire system of particles and constraints */
@@ -131,7 +156,8 @@ public:
 	}
 
 	/** This is an important methods where the time is progressed one time step for the entire cloth.
-		This includes calling satisfyConstraint() for every constraint, and calling timeStep() for all particles
+		This includes moving all the particles (verlet integration) and satisfying the constraints.
+		\return the max vertical displacement of the movable particles
 	**/
 	double timeStep();
 
@@ -72,10 +72,10 @@ bool Cloud2CloudDist::Compute(const Cloth& cloth,
 			//cout << subdeltaX << " " << subdeltaZ << endl;
 			//˫Բֵ bilinear interpolation;
 			//f(x,y)=f(0,0)(1-x)(1-y)+f(0,1)(1-x)y+f(1,1)xy+f(1,0)x(1-y)
-			double fxy = cloth.getParticle(col0, row0).pos.y * (1 - subdeltaX)*(1 - subdeltaZ)
-				+ cloth.getParticle(col3, row3).pos.y * (1 - subdeltaX)*subdeltaZ
-				+ cloth.getParticle(col2, row2).pos.y * subdeltaX*subdeltaZ
-				+ cloth.getParticle(col1, row1).pos.y * subdeltaX*(1 - subdeltaZ);
+			double fxy = cloth.getParticleHeight(col0, row0) * (1 - subdeltaX)*(1 - subdeltaZ)
+				+ cloth.getParticleHeight(col3, row3) * (1 - subdeltaX)*subdeltaZ
+				+ cloth.getParticleHeight(col2, row2) * subdeltaX*subdeltaZ
+				+ cloth.getParticleHeight(col1, row1) * subdeltaX*(1 - subdeltaZ);
 			double height_var = fxy - pc[i].y;
 			if (std::fabs(height_var) < class_threshold)
 			{
@@ -130,12 +130,12 @@ bool Cloud2CloudDist::Compute(const Cloth& cloth,
 		// maping coordinates xy->z  to query the height value of each point
 		for (int i = 0; i < cloth.getSize(); i++)
 		{
-			const Particle& particle = cloth.getParticleByIndex(i);
+			Vec3 pos = cloth.getParticlePos(i);
 			std::ostringstream ostrx, ostrz;
-			ostrx << particle.pos.x;
-			ostrz << particle.pos.z;
-			mapstring.insert(std::pair<std::string, double>(ostrx.str() + ostrz.str(), particle.pos.y));
-			points_2d.push_back(Point_d(particle.pos.x, particle.pos.z));
+			ostrx << pos.x;
+			ostrz << pos.z;
+			mapstring.insert(std::pair<std::string, double>(ostrx.str() + ostrz.str(), pos.y));
+			points_2d.push_back(Point_d(pos.x, pos.z));
 		}
 
 		Tree tree(points_2d.begin(), points_2d.end());
@@ -221,7 +221,7 @@ static bool ComputeMeanNeighborAltitude(const CCLib::DgmOctree::octreeCell& cell
 		for (unsigned k = 0; k < kNN; ++k)
 		{
 			unsigned particleIndex = nNSS.pointsInNeighbourhood[k].pointIndex;
-			double y = cloth.getParticleByIndex(particleIndex).pos.y;
+			double y = cloth.getParticleHeight(static_cast<int>(particleIndex));
 			search_min += y;
 		}
 		search_min /= kNN;
@@ -247,8 +247,8 @@ bool Cloud2CloudDist::Compute(	const Cloth& cloth,
 	}
 	for (int i = 0; i < cloth.getSize(); i++)
 	{
-		const Particle& particle = cloth.getParticleByIndex(i);
-		particlePoints.addPoint(CCVector3(static_cast<PointCoordinateType>(particle.pos.x), 0, static_cast<PointCoordinateType>(particle.pos.z)));
+		Vec3 pos = cloth.getParticlePos(i);
+		particlePoints.addPoint(CCVector3(static_cast<PointCoordinateType>(pos.x), 0, static_cast<PointCoordinateType>(pos.z)));
 	}
 
 	CCLib::SimpleCloud pcPoints;
@@ -38,84 +38,68 @@ using namespace std;
 
 #if 1
 
-double Rasterization::findHeightValByScanline(Particle *p, Cloth &cloth)
+double Rasterization::findHeightValByScanline(int x, int y, const Cloth& cloth, const std::vector<double>& nearestPointHeight)
 {
-	int xpos = p->pos_x;
-	int ypos = p->pos_y;
 	//ɨ
-	for (int i = xpos + 1; i < cloth.num_particles_width; i++)
+	for (int i = x + 1; i < cloth.num_particles_width; i++)
 	{
-		double crresHeight = cloth.getParticle(i, ypos).nearestPointHeight;
+		double crresHeight = nearestPointHeight[cloth.getIndex(i, y)];
 		if (crresHeight > MIN_INF)
 			return crresHeight;
 	}
 	//ɨ
-	for (int i = xpos - 1; i >= 0; i--)
+	for (int i = x - 1; i >= 0; i--)
 	{
-		double crresHeight = cloth.getParticle(i, ypos).nearestPointHeight;
+		double crresHeight = nearestPointHeight[cloth.getIndex(i, y)];
 		if (crresHeight > MIN_INF)
 			return crresHeight;
 	}
 	//ɨ
-	for (int j = ypos - 1; j >= 0; j--)
+	for (int j = y - 1; j >= 0; j--)
 	{
-		double crresHeight = cloth.getParticle(xpos, j).nearestPointHeight;
+		double crresHeight = nearestPointHeight[cloth.getIndex(x, j)];
 		if (crresHeight > MIN_INF)
 			return crresHeight;
 	}
 	//ɨ
-	for (int j = ypos + 1; j < cloth.num_particles_height; j++)
+	for (int j = y + 1; j < cloth.num_particles_height; j++)
 	{
-		double crresHeight = cloth.getParticle(xpos, j).nearestPointHeight;
+		double crresHeight = nearestPointHeight[cloth.getIndex(x, j)];
 		if (crresHeight > MIN_INF)
 			return crresHeight;
 	}
 
-	return findHeightValByNeighbor(p, cloth);
+	return findHeightValByNeighbor(x, y, cloth, nearestPointHeight);
 }
 
-double Rasterization::findHeightValByNeighbor(Particle *p, Cloth &cloth)
+double Rasterization::findHeightValByNeighbor(int x, int y, const Cloth& cloth, const std::vector<double>& nearestPointHeight)
 {
-	queue<Particle*> nqueue;
-	vector<Particle *> pbacklist;
-	size_t neiborsize = p->neighborsList.size();
-	for (size_t i = 0; i < neiborsize; i++)
-	{
-		p->isVisited = true;
-		nqueue.push(p->neighborsList[i]);
-	}
+	std::vector<bool> visited(cloth.getSize(), false);
+	queue<int> nqueue;
+	int neighbors[Cloth::MAX_NEIGHBOR_COUNT];
+
+	int index = cloth.getIndex(x, y);
+	visited[index] = true;
+	nqueue.push(index);
 
 	//iterate over the nqueue
 	while (!nqueue.empty())
 	{
-		Particle *pneighbor = nqueue.front();
+		int current = nqueue.front();
 		nqueue.pop();
-		pbacklist.push_back(pneighbor);
-		if (pneighbor->nearestPointHeight > MIN_INF)
+		if (current != index && nearestPointHeight[current] > MIN_INF)
 		{
-			for (int i = 0; i < pbacklist.size(); i++)
-				pbacklist[i]->isVisited = false;
-			while (!nqueue.empty())
-			{
-				Particle *pp = nqueue.front();
-				pp->isVisited = false;
-				nqueue.pop();
-			}
-			return pneighbor->nearestPointHeight;
+			return nearestPointHeight[current];
 		}
-		else
+
+		int nsize = cloth.getNeighbors(current % cloth.num_particles_width, current / cloth.num_particles_width, neighbors);
+		for (int i = 0; i < nsize; i++)
 		{
-			size_t nsize = pneighbor->neighborsList.size();
-			for (size_t i = 0; i < nsize; i++)
+			if (!visited[neighbors[i]])
 			{
-				Particle *ptmp = pneighbor->neighborsList[i];
-				if (!ptmp->isVisited)
-				{
-					ptmp->isVisited = true;
-					nqueue.push(ptmp);
-				}
+				visited[neighbors[i]] = true;
+				nqueue.push(neighbors[i]);
 			}
-
 		}
 	}
 	return MIN_INF;
@@ -125,9 +109,13 @@ bool Rasterization::RasterTerrain(Cloth& cloth, const wl::PointCloud& pc, std::v
 {
 	try
 	{
+		int particleCount = cloth.getSize();
+		std::vector<double> nearestPointHeight(particleCount, MIN_INF); //the height(y) of the nearest lidar point
+		std::vector<double> nearestPointDist(particleCount, MAX_INF); //the (squared) horizontal distance to the nearest lidar point
+
 		//ȶÿlidarҵڲжӦĽڵ㣬¼
 		//find the nearest cloth particle for each lidar point by Rounding operation
-		for (int i = 0; i < pc.size(); i++)
+		for (size_t i = 0; i < pc.size(); i++)
 		{
 			double pc_x = pc[i].x;
 			double pc_z = pc[i].z;
@@ -136,28 +124,22 @@ bool Rasterization::RasterTerrain(Cloth& cloth, const wl::PointCloud& pc, std::v
 			double deltaZ = pc_z - cloth.origin_pos.z;
 			int col = int(deltaX / cloth.step_x + 0.5);
 			int row = int(deltaZ / cloth.step_y + 0.5);
-			if (col >= 0 && row >= 0 )
+			if (col >= 0 && row >= 0 && col < cloth.num_particles_width && row < cloth.num_particles_height)
 			{
-				Particle& pt = cloth.getParticle(col, row);
-				//Particle pt = cloth.getParticle(col, row); this give wrong results, since it made a copy
-				pt.correspondingLidarPointList.push_back(i);
-				double pc2particleDist = SQUARE_DIST(pc_x, pc_z, pt.pos.x, pt.pos.z);
-				if (pc2particleDist < pt.tmpDist)
+				int index = cloth.getIndex(col, row);
+				double pc2particleDist = SQUARE_DIST(pc_x, pc_z, cloth.origin_pos.x + col * cloth.step_x, cloth.origin_pos.z + row * cloth.step_y);
+				if (pc2particleDist < nearestPointDist[index])
 				{
-					pt.tmpDist = pc2particleDist;
-					pt.nearestPointHeight = pc[i].y;
-					pt.nearestPointIndex = i;
+					nearestPointDist[index] = pc2particleDist;
+					nearestPointHeight[index] = pc[i].y;
 				}
 			}
 		}
-		
 
-		heightVal.resize(cloth.getSize());
-		//#pragma omp parallel for
-		for (int i = 0; i < cloth.getSize(); i++)
+		heightVal.resize(particleCount);
+		for (int i = 0; i < particleCount; i++)
 		{
-			Particle& pcur = cloth.getParticleByIndex(i);
-			double nearestHeight = pcur.nearestPointHeight;
+			double nearestHeight = nearestPointHeight[i];
 			
 			if (nearestHeight > MIN_INF)
 			{
@@ -165,9 +147,8 @@ bool Rasterization::RasterTerrain(Cloth& cloth, const wl::PointCloud& pc, std::v
 			}
 			else
 			{
-				heightVal[i] = findHeightValByScanline(&pcur, cloth);
+				heightVal[i] = findHeightValByScanline(i % cloth.num_particles_width, i / cloth.num_particles_width, cloth, nearestPointHeight);
 			}
-		
 		}
 	}
 	catch (const std::bad_alloc&)
@@ -220,8 +201,8 @@ bool Rasterization::RasterTerrain(Cloth& cloth, const wl::PointCloud& pc, std::v
 		heightVal.resize(cloth.getSize());
 		for (int i = 0; i < cloth.getSize(); i++)
 		{
-			const Particle& particle = cloth.getParticleByIndex(i);
-			Point_d query(particle.pos.x, particle.pos.z);
+			Vec3 pos = cloth.getParticlePos(i);
+			Point_d query(pos.x, pos.z);
 			Neighbor_search search(tree, query, KNN);
 			double search_max = 0;
 			for (Neighbor_search::iterator it = search.begin(); it != search.end(); it++)
@@ -312,8 +293,8 @@ bool Rasterization::RasterTerrain(Cloth& cloth, const wl::PointCloud& pc, std::v
 	}
 	for (int i = 0; i < cloth.getSize(); i++)
 	{
-		const Particle& particle = cloth.getParticleByIndex(i);
-		particlePoints.addPoint(CCVector3(static_cast<PointCoordinateType>(particle.pos.x), 0, static_cast<PointCoordinateType>(particle.pos.z)));
+		Vec3 pos = cloth.getParticlePos(i);
+		particlePoints.addPoint(CCVector3(static_cast<PointCoordinateType>(pos.x), 0, static_cast<PointCoordinateType>(pos.z)));
 	}
 
 	//test
@@ -0,0 +1,335 @@
+﻿//#######################################################################################
+//#                                                                                     #
+//#                              CLOUDCOMPARE PLUGIN: qCSF                              #
+//#                                                                                     #
+//#        This program is free software; you can redistribute it and/or modify         #
+//#        it under the terms of the GNU General Public License as published by         #
+//#        the Free Software Foundation; version 2 or later of the License.             #
+//#                                                                                     #
+//#        This program is distributed in the hope that it will be useful,              #
+//#        but WITHOUT ANY WARRANTY; without even the implied warranty of               #
+//#        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the                 #
+//#        GNU General Public License for more details.                                 #
+//#                                                                                     #
+//#        Please cite the following paper, If you use this plugin in your work.        #
+//#                                                                                     #
+//#  Zhang W, Qi J, Wan P, Wang H, Xie D, Wang X, Yan G. An Easy-to-Use Airborne LiDAR  #
+//#  Data Filtering Method Based on Cloth Simulation. Remote Sensing. 2016; 8(6):501.   #
+//#                                                                                     #
+//#                                     Copyright ©                                     #
+//#               RAMM laboratory, School of Geography, Beijing Normal University       #
+//#                               (http://ramm.bnu.edu.cn/)                             #
+//#                                                                                     #
+//#                      Wuming Zhang; Jianbo Qi; Peng Wan; Hongtao Wang                #
+//#                                                                                     #
+//#                      contact us: 2009zwm@gmail.com; wpqjbzwm@126.com                #
+//#                                                                                     #
+//#######################################################################################
+
+#ifndef Q_CSF_PLUGIN_COMMANDS_HEADER
+#define Q_CSF_PLUGIN_COMMANDS_HEADER
+
+//CloudCompare
+#include "ccCommandLineInterface.h"
+
+//CCLib
+#include <ReferenceCloud.h>
+
+//qCC_db
+#include <ccPointCloud.h>
+#include <ccProgressDialog.h>
+
+//CSF
+#include "CSF.h"
+
+//Qt
+#include <QCoreApplication>
+#include <QScopedPointer>
+#include <QThread>
+
+//system
+#include <algorithm>
+
+static const char COMMAND_CSF[] = "CSF";
+static const char COMMAND_CSF_SCENE[] = "SCENES";
+static const char COMMAND_CSF_PROC_SLOPE[] = "PROC_SLOPE";
+static const char COMMAND_CSF_CLOTH_RESOLUTION[] = "CLOTH_RESOLUTION";
+static const char COMMAND_CSF_MAX_ITERATION[] = "MAX_ITERATION";
+static const char COMMAND_CSF_CLASS_THRESHOLD[] = "CLASS_THRESHOLD";
+static const char COMMAND_CSF_TILE_SIZE[] = "TILE_SIZE";
+static const char COMMAND_CSF_TILE_OVERLAP[] = "TILE_OVERLAP";
+static const char COMMAND_CSF_MAX_THREAD_COUNT[] = "MAX_TCOUNT";
+
+//! Default tile overlap (relatively to the tile size)
+static const double CSF_DEFAULT_RELATIVE_TILE_OVERLAP = 0.25;
+
+struct CommandCSF : public ccCommandLineInterface::Command
+{
+	CommandCSF() : ccCommandLineInterface::Command("CSF", COMMAND_CSF) {}
+
+	//! Reads a (strictly) positive value after a given option
+	static bool ReadValue(ccCommandLineInterface& cmd, const char* option, double& value)
+	{
+		if (cmd.arguments().empty())
+		{
+			return cmd.error(QString("Missing parameter: value after '%1'").arg(option));
+		}
+
+		bool ok = false;
+		value = cmd.arguments().takeFirst().toDouble(&ok);
+		if (!ok || value <= 0)
+		{
+			return cmd.error(QString("Invalid value after '%1'").arg(option));
+		}
+
+		return true;
+	}
+
+	virtual bool process(ccCommandLineInterface& cmd) override
+	{
+		cmd.print("[CSF]");
+
+		//default parameters (same as the dialog)
+		CSF::Parameters params;
+		params.k_nearest_points = 1;
+		params.bSloopSmooth = false;
+		params.time_step = 0.65;
+		params.class_threshold = 0.5;
+		params.cloth_resolution = 2.0;
+		params.rigidness = 2;
+		params.iterations = 500;
+
+		double tileSize = 0.0;
+		double tileOverlap = -1.0;
+		int maxThreadCount = 0;
+
+		//optional parameters
+		while (!cmd.arguments().empty())
+		{
+			QString argument = cmd.arguments().front();
+			if (ccCommandLineInterface::IsCommand(argument, COMMAND_CSF_SCENE))
+			{
+				//local option confirmed, we can move on
+				cmd.arguments().pop_front();
+
+				if (cmd.arguments().empty())
+				{
+					return cmd.error(QString("Missing parameter: scene type after '%1' (SLOPE/RELIEF/FLAT)").arg(COMMAND_CSF_SCENE));
+				}
+
+				QString scene = cmd.arguments().takeFirst().toUpper();
+				if (scene == "SLOPE")
+					params.rigidness = 1;
+				else if (scene == "RELIEF")
+					params.rigidness = 2;
+				else if (scene == "FLAT")
+					params.rigidness = 3;
+				else
+					return cmd.error(QString("Unknown scene type: %1 (should be SLOPE, RELIEF or FLAT)").arg(scene));
+
+				cmd.print(QString("Scene type: %1").arg(scene));
+			}
+			else if (ccCommandLineInterface::IsCommand(argument, COMMAND_CSF_PROC_SLOPE))
+			{
+				//local option confirmed, we can move on
+				cmd.arguments().pop_front();
+
+				params.bSloopSmooth = true;
+				cmd.print("Slope post-processing enabled");
+			}
+			else if (ccCommandLineInterface::IsCommand(argument, COMMAND_CSF_CLOTH_RESOLUTION))
+			{
+				//local option confirmed, we can move on
+				cmd.arguments().pop_front();
+
+				if (!ReadValue(cmd, COMMAND_CSF_CLOTH_RESOLUTION, params.cloth_resolution))
+					return false;
+				cmd.print(QString("Cloth resolution: %1").arg(params.cloth_resolution));
+			}
+			else if (ccCommandLineInterface::IsCommand(argument, COMMAND_CSF_CLASS_THRESHOLD))
+			{
+				//local option confirmed, we can move on
+				cmd.arguments().pop_front();
+
+				if (!ReadValue(cmd, COMMAND_CSF_CLASS_THRESHOLD, params.class_threshold))
+					return false;
+				cmd.print(QString("Classification threshold: %1").arg(params.class_threshold));
+			}
+			else if (ccCommandLineInterface::IsCommand(argument, COMMAND_CSF_MAX_ITERATION))
+			{
+				//local option confirmed, we can move on
+				cmd.arguments().pop_front();
+
+				if (cmd.arguments().empty())
+				{
+					return cmd.error(QString("Missing parameter: max iteration count after '%1'").arg(COMMAND_CSF_MAX_ITERATION));
+				}
+
+				bool ok = false;
+				params.iterations = cmd.arguments().takeFirst().toInt(&ok);
+				if (!ok || params.iterations <= 0)
+				{
+					return cmd.error(QString("Invalid max iteration count after '%1'").arg(COMMAND_CSF_MAX_ITERATION));
+				}
+				cmd.print(QString("Max iteration count: %1").arg(params.iterations));
+			}
+			else if (ccCommandLineInterface::IsCommand(argument, COMMAND_CSF_TILE_SIZE))
+			{
+				//local option confirmed, we can move on
+				cmd.arguments().pop_front();
+
+				if (!ReadValue(cmd, COMMAND_CSF_TILE_SIZE, tileSize))
+					return false;
+				cmd.print(QString("Tile size: %1").arg(tileSize));
+			}
+			else if (ccCommandLineInterface::IsCommand(argument, COMMAND_CSF_TILE_OVERLAP))
+			{
+				//local option confirmed, we can move on
+				cmd.arguments().pop_front();
+
+				if (!ReadValue(cmd, COMMAND_CSF_TILE_OVERLAP, tileOverlap))
+					return false;
+				cmd.print(QString("Tile overlap: %1").arg(tileOverlap));
+			}
+			else if (ccCommandLineInterface::IsCommand(argument, COMMAND_CSF_MAX_THREAD_COUNT))
+			{
+				//local option confirmed, we can move on
+				cmd.arguments().pop_front();
+
+				if (cmd.arguments().empty())
+				{
+					return cmd.error(QString("Missing parameter: max thread count after '%1'").arg(COMMAND_CSF_MAX_THREAD_COUNT));
+				}
+
+				bool ok = false;
+				maxThreadCount = cmd.arguments().takeFirst().toInt(&ok);
+				if (!ok || maxThreadCount < 0)
+				{
+					return cmd.error(QString("Invalid thread count! (after %1)").arg(COMMAND_CSF_MAX_THREAD_COUNT));
+				}
+
+				maxThreadCount = std::min(maxThreadCount, QThread::idealThreadCount());
+				cmd.print(QString("Max thread count set to %1").arg(maxThreadCount));
+			}
+			else
+			{
+				break;
+			}
+		}
+
+		if (tileSize > 0 && tileOverlap < 0)
+		{
+			tileOverlap = CSF_DEFAULT_RELATIVE_TILE_OVERLAP * tileSize;
+			cmd.print(QString("Tile overlap: %1 (default)").arg(tileOverlap));
+		}
+
+		if (cmd.clouds().empty())
+		{
+			return cmd.error("No cloud available. Be sure to open one first!");
+		}
+
+		QScopedPointer<ccProgressDialog> progressDialog(nullptr);
+		if (!cmd.silentMode())
+		{
+			progressDialog.reset(new ccProgressDialog(true, cmd.widgetParent()));
+			progressDialog->setAutoClose(false);
+		}
+
+		std::vector<CLCloudDesc> offGroundClouds;
+		for (CLCloudDesc& desc : cmd.clouds())
+		{
+			ccPointCloud* pc = desc.pc;
+			assert(pc);
+
+			//Convert CC point cloud to CSF type
+			unsigned count = pc->size();
+			wl::PointCloud csfPC;
+			try
+			{
+				csfPC.resize(count);
+			}
+			catch (const std::bad_alloc&)
+			{
+				return cmd.error("Not enough memory!");
+			}
+			for (unsigned i = 0; i < count; i++)
+			{
+				const CCVector3* P = pc->getPoint(i);
+				csfPC[i].x =  P->x;
+				csfPC[i].y = -P->z;
+				csfPC[i].z =  P->y;
+			}
+
+			CSF csf(csfPC);
+			csf.params = params;
+
+			std::vector<int> groundIndexes, offGroundIndexes;
+			if (!csf.do_filtering_tiled(groundIndexes, offGroundIndexes, tileSize, tileOverlap, maxThreadCount, nullptr, progressDialog.data()))
+			{
+				return cmd.error(QString("Failed to filter cloud '%1' (not enough memory or process canceled)").arg(desc.basename));
+			}
+			csfPC.clear();
+
+			cmd.print(QString("%1% of points classified as ground points").arg((groundIndexes.size() * 100.0) / count, 0, 'f', 2));
+
+			//extract the ground and off-ground subsets
+			ccPointCloud* subsets[2] = { nullptr, nullptr };
+			const std::vector<int>* subsetIndexes[2] = { &groundIndexes, &offGroundIndexes };
+			for (int s = 0; s < 2; ++s)
+			{
+				CCLib::ReferenceCloud subset(pc);
+				if (!subset.reserve(static_cast<unsigned>(subsetIndexes[s]->size())))
+				{
+					delete subsets[0];
+					return cmd.error("Not enough memory!");
+				}
+				for (int index : *subsetIndexes[s])
+				{
+					subset.addPointIndex(static_cast<unsigned>(index));
+				}
+				subsets[s] = pc->partialClone(&subset);
+				if (!subsets[s])
+				{
+					delete subsets[0];
+					return cmd.error("Not enough memory!");
+				}
+			}
+			subsets[0]->setName(pc->getName() + QString(".ground"));
+			subsets[1]->setName(pc->getName() + QString(".offground"));
+
+			CLCloudDesc groundDesc(subsets[0], desc.basename + QString("_GROUND"), desc.path, desc.indexInFile);
+			CLCloudDesc offGroundDesc(subsets[1], desc.basename + QString("_OFFGROUND"), desc.path, desc.indexInFile);
+			if (cmd.autoSaveMode())
+			{
+				QString errorStr = cmd.exportEntity(groundDesc);
+				if (errorStr.isEmpty())
+				{
+					errorStr = cmd.exportEntity(offGroundDesc);
+				}
+				if (!errorStr.isEmpty())
+				{
+					delete subsets[0];
+					delete subsets[1];
+					return cmd.error(errorStr);
+				}
+			}
+
+			//replace the current cloud by the ground points (the off-ground points are added after)
+			delete desc.pc;
+			desc = groundDesc;
+			offGroundClouds.push_back(offGroundDesc);
+		}
+
+		cmd.clouds().insert(cmd.clouds().end(), offGroundClouds.begin(), offGroundClouds.end());
+
+		if (progressDialog)
+		{
+			progressDialog->close();
+			QCoreApplication::processEvents();
+		}
+
+		return true;
+	}
+};
+
+#endif //Q_CSF_PLUGIN_COMMANDS_HEADER
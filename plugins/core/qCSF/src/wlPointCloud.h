@@ -57,7 +57,7 @@ namespace wl
 	{
 	public:
 		
-		void computeBoundingBox(Point& bbMin, Point& bbMax)
+		void computeBoundingBox(Point& bbMin, Point& bbMax) const
 		{
 			if (empty())
 			{
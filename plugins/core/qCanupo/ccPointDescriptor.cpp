@@ -23,7 +23,6 @@
 
 //CCLib
 #include <Neighbourhood.h>
-#include <Jacobi.h>
 
 //Qt
 #include <QMap>
@@ -59,6 +58,9 @@ public:
 	//inherited from ScaleParamsComputer
 	virtual unsigned dimPerScale() const { return 2; }
 
+	//inherited from ScaleParamsComputer
+	virtual ScaleParamsComputer* clone() const { return new DimensionalityScaleParamsComputer(*this); }
+
 	//inherited from ScaleParamsComputer
 	virtual void reset()
 	{
@@ -81,12 +83,9 @@ public:
 		{
 			CCLib::Neighbourhood Z(&neighbors);
 
-			CCLib::SquareMatrixd eigVectors;
-			std::vector<double> eigValues;
-			if (Jacobi<double>::ComputeEigenValuesAndVectors(Z.computeCovarianceMatrix(), eigVectors, eigValues, true))
+			const double* eigValues = Z.getEigenValues(); //sorted in decreasing order
+			if (eigValues)
 			{
-				Jacobi<double>::SortEigenValuesAndVectors(eigVectors, eigValues); //decreasing order of their associated eigenvalues
-
 				double totalVariance = 0;
 				CCVector3d sValues(0, 0, 0);
 				{
@@ -162,6 +161,9 @@ public:
 	//inherited from ScaleParamsComputer
 	virtual bool needSF() const { return true; }
 
+	//inherited from ScaleParamsComputer
+	virtual ScaleParamsComputer* clone() const { return new DimensionalityAndSFScaleParamsComputer(*this); }
+
 	//inherited from ScaleParamsComputer
 	virtual void reset()
 	{
@@ -213,19 +215,16 @@ public:
 
 			CCLib::Neighbourhood Z(&neighbors);
 
-			CCLib::SquareMatrixd eigVectors;
-			std::vector<double> eigValues;
-			if (Jacobi<double>::ComputeEigenValuesAndVectors(Z.computeCovarianceMatrix(), eigVectors, eigValues, true))
+			const double* eigValues = Z.getEigenValues(); //sorted in decreasing order
+			if (eigValues)
 			{
-				Jacobi<double>::SortEigenValuesAndVectors(eigVectors, eigValues); //decreasing order of their associated eigenvalues
-
 				double totalVariance = 0;
 				CCVector3d sValues(0, 0, 0);
 				{
 					// contrarily to Brodu's version, here we get directly the eigenvalues!
 					for (unsigned j = 0; j < 3; ++j)
 					{
-						sValues.u[j] = eigValues(j);
+						sValues.u[j] = eigValues[j];
 						totalVariance += sValues.u[j];
 					}
 				}
@@ -292,6 +291,9 @@ public:
 	//inherited from ScaleParamsComputer
 	virtual unsigned dimPerScale() const { return 1; }
 
+	//inherited from ScaleParamsComputer
+	virtual ScaleParamsComputer* clone() const { return new CurvatureScaleParamsComputer(*this); }
+
 	//inherited from ScaleParamsComputer
 	virtual void reset()
 	{
@@ -346,6 +348,9 @@ public:
 	//inherited from ScaleParamsComputer
 	virtual unsigned dimPerScale() const { return 1; }
 
+	//inherited from ScaleParamsComputer
+	virtual ScaleParamsComputer* clone() const { return new CustomScaleParamsComputer(*this); }
+
 	//inherited from ScaleParamsComputer
 	virtual void reset()
 	{
@@ -75,6 +75,11 @@ public:
 	//! Returns whether the computer requires a scalar field or not
 	virtual bool needSF() const { return false; }
 
+	//! Returns a new instance of the same computer
+	/** Computers are stateful (see reset): each concurrent task must use its own instance.
+	**/
+	virtual ScaleParamsComputer* clone() const = 0;
+
 	//! Called once before computing parameters at first scale
 	virtual void reset() = 0;
 	
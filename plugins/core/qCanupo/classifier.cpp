@@ -26,6 +26,13 @@
 //system
 #include <assert.h>
 #include <limits.h>
+#include <limits>
+
+//SIMD
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define CANUPO_CLASSIFIER_USE_SSE
+#endif
 
 Classifier::Classifier()
 	: class1(0)
@@ -169,6 +176,149 @@ float Classifier::classify(const CorePointDesc& mscdata) const
 	return classify2D(P);
 }
 
+#ifdef CANUPO_CLASSIFIER_USE_SSE
+//! Returns (mask ? a : b) for each lane
+static inline __m128 Select_SSE(__m128 mask, __m128 a, __m128 b)
+{
+	return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+
+//! Same as Classifier::classify2D_checkcondnum for 4 points at once (SSE version)
+/** The operations are the same (and in the same order) as the scalar version.
+**/
+static __m128 Classify2D_checkcondnum_SSE(	const std::vector<Classifier::Point2D>& path,
+											__m128 Px,
+											__m128 Py,
+											const Classifier::Point2D& R,
+											__m128& condnumber)
+{
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 allOnes = _mm_castsi128_ps(_mm_set1_epi32(-1));
+	const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+	const __m128 signMask = _mm_castsi128_ps(_mm_set1_epi32(0x80000000));
+
+	//PR and u = PR normalized
+	__m128 PRx = _mm_sub_ps(_mm_set1_ps(R.x), Px);
+	__m128 PRy = _mm_sub_ps(_mm_set1_ps(R.y), Py);
+	__m128 PRnorm2 = _mm_add_ps(_mm_mul_ps(PRx, PRx), _mm_mul_ps(PRy, PRy));
+	__m128 validNorm = _mm_cmpgt_ps(PRnorm2, zero);
+	__m128 PRnorm = _mm_sqrt_ps(PRnorm2);
+	__m128 ux = Select_SSE(validNorm, _mm_div_ps(PRx, PRnorm), PRx);
+	__m128 uy = Select_SSE(validNorm, _mm_div_ps(PRy, PRnorm), PRy);
+
+	condnumber = zero;
+	__m128i numcross = _mm_setzero_si128();
+	__m128 closestSquareDist = _mm_set1_ps(std::numeric_limits<float>::max());
+
+	size_t segCount = path.size() - 1;
+	for (size_t i = 0; i < segCount; ++i)
+	{
+		//current path segment (or half-line!)
+		const Classifier::Point2D& A = path[i];
+		const Classifier::Point2D& B = path[i + 1];
+		Classifier::Point2D AB = B - A;
+		Classifier::Point2D v = AB; v.normalize();
+
+		__m128 vx = _mm_set1_ps(v.x);
+		__m128 vy = _mm_set1_ps(v.y);
+		__m128 APx = _mm_sub_ps(Px, _mm_set1_ps(A.x));
+		__m128 APy = _mm_sub_ps(Py, _mm_set1_ps(A.y));
+
+		condnumber = _mm_max_ps(condnumber, _mm_and_ps(absMask, _mm_add_ps(_mm_mul_ps(vx, ux), _mm_mul_ps(vy, uy))));
+
+		// Compute whether PR[Pt-->Refpt] and that segment cross
+		__m128 denom = _mm_sub_ps(_mm_mul_ps(ux, vy), _mm_mul_ps(vx, uy));
+		__m128 alpha = _mm_div_ps(_mm_sub_ps(_mm_mul_ps(APy, vx), _mm_mul_ps(APx, vy)), denom);
+		__m128 crossing = _mm_and_ps(_mm_cmpneq_ps(denom, zero), _mm_and_ps(_mm_cmpge_ps(alpha, zero), _mm_cmple_ps(_mm_mul_ps(alpha, alpha), PRnorm2)));
+		__m128 beta = _mm_div_ps(_mm_sub_ps(_mm_mul_ps(APy, ux), _mm_mul_ps(APx, uy)), denom);
+		// first and last lines are projected to infinity
+		if (i != 0)
+			crossing = _mm_and_ps(crossing, _mm_cmpge_ps(beta, zero));
+		if (i + 1 != segCount)
+			crossing = _mm_and_ps(crossing, _mm_cmplt_ps(_mm_mul_ps(beta, beta), _mm_set1_ps(AB.norm2())));
+		numcross = _mm_sub_epi32(numcross, _mm_castps_si128(crossing)); //true = -1
+
+		// closest distance from the point to that segment
+		__m128 distAH = _mm_add_ps(_mm_mul_ps(vx, APx), _mm_mul_ps(vy, APy));
+		__m128 inSegment = allOnes;
+		if (i != 0)
+			inSegment = _mm_cmpge_ps(distAH, zero);
+		if (i + 1 != segCount)
+			inSegment = _mm_and_ps(inSegment, _mm_cmple_ps(distAH, _mm_set1_ps(AB.norm())));
+
+		__m128 PHx = _mm_sub_ps(_mm_add_ps(_mm_set1_ps(A.x), _mm_mul_ps(vx, distAH)), Px);
+		__m128 PHy = _mm_sub_ps(_mm_add_ps(_mm_set1_ps(A.y), _mm_mul_ps(vy, distAH)), Py);
+		__m128 squareDistToLine = _mm_add_ps(_mm_mul_ps(PHx, PHx), _mm_mul_ps(PHy, PHy));
+
+		__m128 BPx = _mm_sub_ps(Px, _mm_set1_ps(B.x));
+		__m128 BPy = _mm_sub_ps(Py, _mm_set1_ps(B.y));
+		__m128 squareDistToEnds = _mm_min_ps(	_mm_add_ps(_mm_mul_ps(APx, APx), _mm_mul_ps(APy, APy)),
+												_mm_add_ps(_mm_mul_ps(BPx, BPx), _mm_mul_ps(BPy, BPy)));
+
+		closestSquareDist = _mm_min_ps(closestSquareDist, Select_SSE(inSegment, squareDistToLine, squareDistToEnds));
+	}
+
+	__m128 deltaNorm = _mm_sqrt_ps(closestSquareDist);
+	__m128 odd = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(numcross, _mm_set1_epi32(1)), _mm_set1_epi32(1)));
+
+	return Select_SSE(odd, _mm_xor_ps(deltaNorm, signMask), deltaNorm);
+}
+#endif
+
+void Classifier::classify(	const CorePointDescSet& descriptors,
+							size_t first,
+							size_t count,
+							float distToBoundary[]) const
+{
+	assert(first + count <= descriptors.size());
+
+	size_t i = 0;
+
+#ifdef CANUPO_CLASSIFIER_USE_SSE
+	assert(weightsAxis1.size() == weightsAxis2.size());
+	if (path.size() >= 2 && weightsAxis1.size() > 1)
+	{
+		size_t weightCount = weightsAxis1.size() - 1;
+
+		for (; i + 4 <= count; i += 4)
+		{
+			//projection of 4 descriptors in the 2D space
+			const float* params[4];
+			for (unsigned k = 0; k < 4; ++k)
+			{
+				const std::vector<float>& descParams = descriptors[first + i + k].params;
+				assert(weightCount <= descParams.size());
+				//the matching scales are at the end (see 'project')
+				params[k] = descParams.data() + (descParams.size() - weightCount);
+			}
+
+			__m128 Px = _mm_set1_ps(weightsAxis1.back());
+			__m128 Py = _mm_set1_ps(weightsAxis2.back());
+			for (size_t j = 0; j < weightCount; ++j)
+			{
+				__m128 p = _mm_setr_ps(params[0][j], params[1][j], params[2][j], params[3][j]);
+				Px = _mm_add_ps(Px, _mm_mul_ps(_mm_set1_ps(weightsAxis1[j]), p));
+				Py = _mm_add_ps(Py, _mm_mul_ps(_mm_set1_ps(weightsAxis2[j]), p));
+			}
+
+			//classification in the 2D space (see 'classify2D')
+			__m128 condpos, condneg;
+			__m128 predpos = Classify2D_checkcondnum_SSE(path, Px, Py, refPointPos, condpos);
+			__m128 predneg = Classify2D_checkcondnum_SSE(path, Px, Py, refPointNeg, condneg);
+			__m128 minusPredneg = _mm_xor_ps(predneg, _mm_castsi128_ps(_mm_set1_epi32(0x80000000)));
+
+			_mm_storeu_ps(distToBoundary + i, Select_SSE(_mm_cmplt_ps(condpos, condneg), predpos, minusPredneg));
+		}
+	}
+#endif
+
+	//remaining descriptors
+	for (; i < count; ++i)
+	{
+		distToBoundary[i] = classify(descriptors[first + i]);
+	}
+}
+
 bool Classifier::Load(	QString filename,
 						std::vector<Classifier>& classifiers,
 						std::vector<float>& scales,
@@ -63,6 +63,20 @@ public: //methods
 	//! Classification in MSC space
 	float classify(const CorePointDesc& mscdata) const;
 
+	//! Classification in MSC space (batch version)
+	/** Same as calling 'classify' on each descriptor, except that
+		the descriptors are projected and classified 4 by 4 (SSE)
+		when possible.
+		\param descriptors set of descriptors
+		\param first index of the first descriptor to classify
+		\param count number of descriptors to classify
+		\param distToBoundary output distances to the boundary (count values)
+	**/
+	void classify(	const CorePointDescSet& descriptors,
+					size_t first,
+					size_t count,
+					float distToBoundary[]) const;
+
 	//! Classifier's file header info
 	struct FileHeader
 	{
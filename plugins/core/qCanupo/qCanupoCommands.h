@@ -24,8 +24,12 @@
 //Local
 #include "qCanupoProcess.h"
 
+//Qt
+#include <QThread>
+
 static const char COMMAND_CANUPO_CALSSIFY[] = "CANUPO_CLASSIFY";
 static const char COMMAND_CANUPO_CONFIDENCE[] = "USE_CONFIDENCE";
+static const char COMMAND_CANUPO_MAX_THREAD_COUNT[] = "MAX_TCOUNT";
 
 struct CommandCanupoClassif : public ccCommandLineInterface::Command
 {
@@ -71,6 +75,26 @@ struct CommandCanupoClassif : public ccCommandLineInterface::Command
 
 				cmd.print(QString("Confidence threshold set to %1").arg(params.confidenceThreshold));
 			}
+			else if (ccCommandLineInterface::IsCommand(argument, COMMAND_CANUPO_MAX_THREAD_COUNT))
+			{
+				//local option confirmed, we can move on
+				cmd.arguments().pop_front();
+
+				if (cmd.arguments().empty())
+				{
+					return cmd.error(QString("Missing parameter: max thread count after '%1'").arg(COMMAND_CANUPO_MAX_THREAD_COUNT));
+				}
+
+				bool ok;
+				params.maxThreadCount = cmd.arguments().takeFirst().toInt(&ok);
+				if (!ok || params.maxThreadCount < 0)
+				{
+					return cmd.error(QString("Invalid thread count! (after %1)").arg(COMMAND_CANUPO_MAX_THREAD_COUNT));
+				}
+
+				params.maxThreadCount = std::min(params.maxThreadCount, QThread::idealThreadCount());
+				cmd.print(QString("Max thread count set to %1").arg(params.maxThreadCount));
+			}
 			else
 			{
 				//we assume the parameter is the classifier filename
@@ -87,7 +111,7 @@ struct CommandCanupoClassif : public ccCommandLineInterface::Command
 
 		if (cmd.clouds().empty())
 		{
-			return cmd.error("Need at least At least one cloud must be loaded");
+			return cmd.error("At least one cloud must be loaded");
 		}
 
 		for (CLCloudDesc& desc : cmd.clouds())
@@ -122,7 +146,7 @@ struct CommandCanupoClassif : public ccCommandLineInterface::Command
 			else
 			{
 				//process failed
-				break;
+				return cmd.error(QString("Failed to classify cloud '%1'").arg(desc.basename));
 			}
 		}
 
@@ -38,6 +38,13 @@
 #include <QApplication>
 #include <QMessageBox>
 #include <QStringList>
+#include <QThread>
+#include <QThreadPool>
+#include <QtConcurrentMap>
+
+//system
+#include <algorithm>
+#include <atomic>
 
 // Default SF names
 #ifdef COMPILE_PRIVATE_CANUPO
@@ -241,6 +248,79 @@ float RefinePointClassif(	const Classifier& classifier,
 	return confidence;
 }
 
+//! Number of core points processed by each (parallel) classification task
+static const size_t CLASSIFICATION_CHUNK_SIZE = 4096;
+
+//! Computes the distances of all the core points to the boundary of each classifier
+/** The core points are processed by chunks (in parallel), and each chunk
+	is classified in batch (see Classifier::classify).
+	\param classifiers classifiers
+	\param descriptors core points descriptors
+	\param distancesToBoundary output distances (classifier by classifier)
+	\param maxThreadCount max thread count (0 = all)
+	\param progressCb progress callback (optional)
+	\return false if the process has been canceled
+**/
+static bool ComputeDistancesToBoundary(	const std::vector<Classifier>& classifiers,
+										const CorePointDescSet& descriptors,
+										std::vector<float>& distancesToBoundary,
+										int maxThreadCount,
+										CCLib::GenericProgressCallback* progressCb)
+{
+	size_t corePointCount = descriptors.size();
+	assert(distancesToBoundary.size() == classifiers.size() * corePointCount);
+
+	std::vector<size_t> chunks;
+	for (size_t first = 0; first < corePointCount; first += CLASSIFICATION_CHUNK_SIZE)
+	{
+		chunks.push_back(first);
+	}
+
+	CCLib::NormalizedProgress nProgress(progressCb, static_cast<unsigned>(chunks.size()));
+	std::atomic<bool> canceled(false);
+
+	auto classifyChunk = [&](size_t first)
+	{
+		if (canceled)
+			return;
+
+		size_t count = std::min(CLASSIFICATION_CHUNK_SIZE, corePointCount - first);
+		for (size_t c = 0; c < classifiers.size(); ++c)
+		{
+			classifiers[c].classify(descriptors, first, count, distancesToBoundary.data() + c * corePointCount + first);
+		}
+
+		if (progressCb && !nProgress.oneStep())
+		{
+			canceled = true;
+		}
+	};
+
+	bool useParallelStrategy = (chunks.size() > 1);
+#ifdef _DEBUG
+	useParallelStrategy = false;
+#endif
+
+	if (useParallelStrategy)
+	{
+		if (maxThreadCount == 0)
+		{
+			maxThreadCount = QThread::idealThreadCount();
+		}
+		QThreadPool::globalInstance()->setMaxThreadCount(maxThreadCount);
+		QtConcurrent::blockingMap(chunks, classifyChunk);
+	}
+	else
+	{
+		for (size_t first : chunks)
+		{
+			classifyChunk(first);
+		}
+	}
+
+	return !canceled;
+}
+
 bool qCanupoProcess::Classify(	QString classifierFilename,
 								const ClassifyParams& params,
 								ccPointCloud* cloud,
@@ -524,26 +604,39 @@ bool qCanupoProcess::Classify(	QString classifierFilename,
 				CCLib::ScalarField* sf = cloud->getCurrentDisplayedScalarField();
 				assert(!params.useActiveSFForConfidence || sf);
 
+				//distances of the core points to the boundary of each classifier
+				//(they don't depend on the classification of the neighbors, so we compute them once for all the passes)
+				size_t classifierCount = classifiers.size();
+				std::vector<float> distancesToBoundary(classifierCount * corePointCount); //classifier by classifier
+				{
+					pDlg.reset();
+					pDlg.setInfo(QObject::tr("Core points: %1\nClassifiers: %2").arg(corePointCount).arg(classifierCount));
+					pDlg.setMethodTitle(QObject::tr("Classification"));
+					pDlg.start();
+					QApplication::processEvents();
+
+					processCanceled = !ComputeDistancesToBoundary(classifiers, corePointsDescriptors, distancesToBoundary, params.maxThreadCount, &pDlg);
+				}
+
 				//while unreliable points remain
-				while (!pendingPoints.empty())
+				while (!pendingPoints.empty() && !processCanceled)
 				{
 					//progress notification
 					pDlg.reset();
 					pDlg.setInfo(QObject::tr("Remaining points to classify: %1\nSource points: %2").arg(pendingPoints.size()).arg(cloud->size()));
 					pDlg.setMethodTitle(QObject::tr("Classification"));
-					CCLib::NormalizedProgress nProgress(&pDlg, corePoints->size());
+					CCLib::NormalizedProgress nProgress(&pDlg, static_cast<unsigned>(pendingPoints.size()));
 					pDlg.start();
 
 					for (size_t i = 0; i < pendingPoints.size(); ++i)
 					{
 						unsigned coreIndex = pendingPoints[i];
-						CorePointDesc& coreDesc = corePointsDescriptors[coreIndex];
 
 						//most common case
 						if (classifiers.size() == 1)
 						{
 							const Classifier& classifier = classifiers.front();
-							float distToBoundary = classifier.classify(coreDesc);
+							float distToBoundary = distancesToBoundary[coreIndex];
 
 							float confidence = 1.0f / (exp(-fabs(distToBoundary)) + 1.0f); //in [0.5 ; 1]
 							confidence = 2 * (confidence - 0.5f); //map to [0;1]
@@ -586,13 +679,13 @@ bool qCanupoProcess::Classify(	QString classifierFilename,
 							if (!unreliable)
 							{
 								int theClass = (distToBoundary >= 0 ? classifier.class2 : classifier.class1);
-								corePointClasses[i] = theClass;
-								corePointConfidences[i] = confidence;
+								corePointClasses[coreIndex] = theClass;
+								corePointConfidences[coreIndex] = confidence;
 							}
 							else if (params.useActiveSFForConfidence)
 							{
 								//this point can't be classified this way
-								unreliablePointIndexes.push_back(static_cast<unsigned>(i));
+								unreliablePointIndexes.push_back(coreIndex);
 							}
 						}
 						else //more than one classifier
@@ -601,12 +694,12 @@ bool qCanupoProcess::Classify(	QString classifierFilename,
 							std::map< int, float > minConfidences;
 
 							// apply all classifiers and look for the most represented class
-							for (std::vector<Classifier>::const_iterator classifierIt = classifiers.begin(); classifierIt != classifiers.end(); ++classifierIt)
+							for (size_t c = 0; c < classifierCount; ++c)
 							{
-								const Classifier& classifier = *classifierIt;
+								const Classifier& classifier = classifiers[c];
 
 								// uniformize the order, distToBoundary>0 selects the larger class of both
-								float distToBoundary = classifier.classify(coreDesc); //DGM: the descriptors may have more values than the number of scales!
+								float distToBoundary = distancesToBoundary[c * corePointCount + coreIndex];
 								//if (classifier.class1 > classifier.class2)
 								//	distToBoundary = -distToBoundary;
 
@@ -705,13 +798,13 @@ bool qCanupoProcess::Classify(	QString classifierFilename,
 									}
 								}
 
-								corePointClasses[i] = bestClassLabel;
-								corePointConfidences[i] = minConfidences[bestClassLabel];
+								corePointClasses[coreIndex] = bestClassLabel;
+								corePointConfidences[coreIndex] = minConfidences[bestClassLabel];
 							}
 							else if (params.useActiveSFForConfidence)
 							{
 								//this point can't be classified this way
-								unreliablePointIndexes.push_back(static_cast<unsigned>(i));
+								unreliablePointIndexes.push_back(coreIndex);
 							}
 						}
 
@@ -42,67 +42,87 @@
 #include <QProgressDialog>
 #include <QtConcurrentMap>
 
-//ComputeCorePointsDescriptors parameters
-static struct
+//system
+#include <algorithm>
+#include <atomic>
+#include <memory>
+
+//! Number of core points processed by each (parallel) descriptors computation task
+static const unsigned DESCRIPTORS_CHUNK_SIZE = 1024;
+
+//! Descriptors computation context (see qCanupoTools::ComputeCorePointsDescriptors)
+struct DescriptorsContext
 {
 	CCLib::GenericIndexedCloud* corePoints;
 	ccGenericPointCloud* sourceCloud;
 	CCLib::DgmOctree* octree;
 	unsigned char octreeLevel;
 	CorePointDescSet* descriptors;
-	bool invalidDescriptors;
-
-	CCLib::NormalizedProgress* nProgress;
-	bool processCanceled;
-	bool errorOccurred;
-
-	ScaleParamsComputer* computer; //the per-scale parameters computer 
+	const ScaleParamsComputer* computer; //the per-scale parameters computer (model)
 
 	std::vector<ccScalarField*>* roughnessSFs; //for test
 
+	CCLib::NormalizedProgress* nProgress;
+	std::atomic<bool> invalidDescriptors;
+	std::atomic<bool> processCanceled;
+	std::atomic<bool> errorOccurred;
+};
 
-} s_computeCorePointsDescParams;
-
-//! Per-point descriptor computer (all the parameters are stored in s_computeCorePointsDescParams)
-void ComputeCorePointDescriptor(unsigned index)
+//! Working buffers of a descriptors computation task (reused for all its core points)
+struct DescriptorsBuffers
 {
-	if (s_computeCorePointsDescParams.processCanceled)
-		return;
+	explicit DescriptorsBuffers(ccGenericPointCloud* sourceCloud) : subset(sourceCloud) {}
 
-	const CCVector3* P = s_computeCorePointsDescParams.corePoints->getPoint(index);
+	//! Neighbors of the current core point (sorted by increasing distance)
 	CCLib::DgmOctree::NeighboursSet neighbours;
+	//! Neighbors subset (pruned at each scale)
+	CCLib::ReferenceCloud subset;
+};
+
+//! Per-point descriptor computer
+/** \param index core point index
+	\param context descriptors computation context
+	\param computer per-scale parameters computer (own instance of the task)
+	\param buffers working buffers (own instance of the task)
+	\return false if an error occurred
+**/
+static bool ComputeCorePointDescriptor(unsigned index, DescriptorsContext& context, ScaleParamsComputer& computer, DescriptorsBuffers& buffers)
+{
+	const CCVector3* P = context.corePoints->getPoint(index);
+	CCLib::DgmOctree::NeighboursSet& neighbours = buffers.neighbours;
+	CCLib::ReferenceCloud& subset = buffers.subset;
 
 	//extract the neighbors (maximum radius)
-	float maxRadius = s_computeCorePointsDescParams.descriptors->scales().front()/2;
-	int n = s_computeCorePointsDescParams.octree->getPointsInSphericalNeighbourhood(*P,
-																				maxRadius,
-																				neighbours,
-																				s_computeCorePointsDescParams.octreeLevel);
+	neighbours.clear();
+	float maxRadius = context.descriptors->scales().front() / 2;
+	int n = context.octree->getPointsInSphericalNeighbourhood(*P,
+															maxRadius,
+															neighbours,
+															context.octreeLevel);
 
 	if (n != 0)
 	{
-		size_t scaleCount = s_computeCorePointsDescParams.descriptors->scales().size();
+		size_t scaleCount = context.descriptors->scales().size();
 
 		//get reference on corresponding descriptor
-		assert(s_computeCorePointsDescParams.descriptors->size() > index);
-		CorePointDesc& desc = s_computeCorePointsDescParams.descriptors->at(index);
+		assert(context.descriptors->size() > index);
+		CorePointDesc& desc = context.descriptors->at(index);
 
-		unsigned dimPerScale = s_computeCorePointsDescParams.descriptors->dimPerScale();
+		unsigned dimPerScale = context.descriptors->dimPerScale();
 		assert(desc.params.size() == scaleCount*dimPerScale);
 
 		//init the whole neighborhood subset (we will prune it each time)
-		CCLib::ReferenceCloud subset(s_computeCorePointsDescParams.sourceCloud);
 		{
+			subset.clear(false);
 			if (!subset.reserve(n))
 			{
 				//not enough memory!
-				s_computeCorePointsDescParams.errorOccurred = true;
-				s_computeCorePointsDescParams.processCanceled = true; //to make the loop stop!
-				return;
+				return false;
 			}
 
-			//sort the neighbors by increasing distance
-			ParallelSort(neighbours.begin(), neighbours.end(), CCLib::DgmOctree::PointDescriptor::distComp);
+			//sort the neighbors by increasing distance (once for all the scales)
+			//the core points are already processed in parallel, so no need for a parallel sort here
+			std::sort(neighbours.begin(), neighbours.end(), CCLib::DgmOctree::PointDescriptor::distComp);
 
 			for (int j = 0; j < n; ++j)
 			{
@@ -110,11 +130,11 @@ void ComputeCorePointDescriptor(unsigned index)
 			}
 		}
 
-		s_computeCorePointsDescParams.computer->reset();
+		computer.reset();
 
 		for (size_t i=0; i<scaleCount; ++i)
 		{
-			const double radius = s_computeCorePointsDescParams.descriptors->scales()[i]/2; //we start from the biggest
+			const double radius = context.descriptors->scales()[i]/2; //we start from the biggest
 
 			if (i != 0)
 			{
@@ -132,7 +152,7 @@ void ComputeCorePointDescriptor(unsigned index)
 			}
 
 			//optional: compute per-level roughness
-			if (s_computeCorePointsDescParams.roughnessSFs)
+			if (context.roughnessSFs)
 			{
 				ScalarType roughness = NAN_VALUE;
 
@@ -153,7 +173,7 @@ void ComputeCorePointDescriptor(unsigned index)
 					if (lsPlane)
 					{
 						//distance to the LS plane fitted on the nearest neighbors
-						const CCVector3* centralPoint = s_computeCorePointsDescParams.sourceCloud->getPoint(globalIndex);
+						const CCVector3* centralPoint = context.sourceCloud->getPoint(globalIndex);
 						roughness = fabs(CCLib::DistanceComputationTools::computePoint2PlaneDistance(centralPoint,lsPlane));
 					}
 
@@ -162,32 +182,28 @@ void ComputeCorePointDescriptor(unsigned index)
 					subset.swap(0, lastIndex);
 				}
 
-				assert(s_computeCorePointsDescParams.roughnessSFs->size() == scaleCount);
-				ccScalarField* sf = s_computeCorePointsDescParams.roughnessSFs->at(i);
+				assert(context.roughnessSFs->size() == scaleCount);
+				ccScalarField* sf = context.roughnessSFs->at(i);
 				assert(sf && sf->currentSize() > index);
 				sf->setValue(index,roughness);
 			}
 
 			bool invalidScale = false;
-			if (!s_computeCorePointsDescParams.computer->computeScaleParams(subset, radius, &(desc.params[i*dimPerScale]), invalidScale))
+			if (!computer.computeScaleParams(subset, radius, &(desc.params[i*dimPerScale]), invalidScale))
 			{
 				//an error occurred!
-				s_computeCorePointsDescParams.errorOccurred = true;
-				s_computeCorePointsDescParams.processCanceled = true; //to make the loop stop!
-				return;
+				return false;
 			}
 
 			if (invalidScale)
 			{
-				s_computeCorePointsDescParams.invalidDescriptors = true;
+				context.invalidDescriptors = true;
 				//no need to compute the remaining scales!
 				for (size_t j=i+1; j<scaleCount; ++j)
 				{
 					//copy the same parameters for all scales (see CANUPO paper)
 					memcpy(&(desc.params[j*dimPerScale]), &(desc.params[i*dimPerScale]), sizeof(float)*dimPerScale);
 				}
-				//neighbours.clear();
-				//subset.clear(true);
 				break;
 			}
 		}
@@ -195,13 +211,46 @@ void ComputeCorePointDescriptor(unsigned index)
 	else
 	{
 		//if the widest neighborhood has less than 3 points, we can't compute a valid descriptor!
-		s_computeCorePointsDescParams.invalidDescriptors = true;
+		context.invalidDescriptors = true;
 	}
-	
+
+	return true;
+}
+
+//! Computes the descriptors of a range of core points (i.e. one task)
+static void ComputeCorePointsDescriptorsRange(unsigned first, unsigned last, DescriptorsContext& context)
+{
+	if (context.processCanceled)
+		return;
+
+	//each task has its own computer and buffers
+	try
+	{
+		std::unique_ptr<ScaleParamsComputer> computer(context.computer->clone());
+		DescriptorsBuffers buffers(context.sourceCloud);
+
+		for (unsigned i = first; i < last; ++i)
+		{
+			if (!ComputeCorePointDescriptor(i, context, *computer, buffers))
+			{
+				context.errorOccurred = true;
+				context.processCanceled = true; //to make the loop stop!
+				return;
+			}
+		}
+	}
+	catch (const std::bad_alloc&)
+	{
+		//not enough memory
+		context.errorOccurred = true;
+		context.processCanceled = true; //to make the loop stop!
+		return;
+	}
+
 	//progress notification
-	if (s_computeCorePointsDescParams.nProgress && !s_computeCorePointsDescParams.nProgress->oneStep())
+	if (context.nProgress && !context.nProgress->steps(last - first))
 	{
-		s_computeCorePointsDescParams.processCanceled = true;
+		context.processCanceled = true;
 	}
 }
 
@@ -237,20 +286,20 @@ bool qCanupoTools::ComputeCorePointsDescriptors(CCLib::GenericIndexedCloud* core
 	}
 
 	//descriptor (computer)
-	s_computeCorePointsDescParams.computer = ScaleParamsComputer::GetByID(descriptorID);
-	if (!s_computeCorePointsDescParams.computer)
+	const ScaleParamsComputer* computer = ScaleParamsComputer::GetByID(descriptorID);
+	if (!computer)
 	{
 		error = QString("Unhandled descriptor ID (%1)!").arg(descriptorID);
 		return false;
 	}
-	if (s_computeCorePointsDescParams.computer->needSF() && !corePoints->enableScalarField())
+	if (computer->needSF() && !corePoints->enableScalarField())
 	{
 		error = "Couldn't find a scalar field for core points!";
 		return false;
 	}
 
 	corePointsDescriptors.setDescriptorID(descriptorID);
-	corePointsDescriptors.setDimPerScale(s_computeCorePointsDescParams.computer->dimPerScale());
+	corePointsDescriptors.setDimPerScale(computer->dimPerScale());
 
 	CCLib::DgmOctree* theOctree = inputOctree;
 	if (!theOctree)
@@ -300,16 +349,18 @@ bool qCanupoTools::ComputeCorePointsDescriptors(CCLib::GenericIndexedCloud* core
 	PointCoordinateType biggestRadius = sortedScales.front()/2; //we extract the biggest neighborhood
 	unsigned char octreeLevel = theOctree->findBestLevelForAGivenNeighbourhoodSizeExtraction(biggestRadius);
 
-	s_computeCorePointsDescParams.corePoints = corePoints;
-	s_computeCorePointsDescParams.descriptors = &corePointsDescriptors;
-	s_computeCorePointsDescParams.sourceCloud = sourceCloud;
-	s_computeCorePointsDescParams.octree = theOctree;
-	s_computeCorePointsDescParams.octreeLevel = octreeLevel;
-	s_computeCorePointsDescParams.nProgress = progressCb ? &nProgress : nullptr;
-	s_computeCorePointsDescParams.processCanceled = false;
-	s_computeCorePointsDescParams.errorOccurred = false;
-	s_computeCorePointsDescParams.invalidDescriptors = false;
-	s_computeCorePointsDescParams.roughnessSFs = roughnessSFs;
+	DescriptorsContext context;
+	context.corePoints = corePoints;
+	context.descriptors = &corePointsDescriptors;
+	context.sourceCloud = sourceCloud;
+	context.octree = theOctree;
+	context.octreeLevel = octreeLevel;
+	context.computer = computer;
+	context.roughnessSFs = roughnessSFs;
+	context.nProgress = progressCb ? &nProgress : nullptr;
+	context.processCanceled = false;
+	context.errorOccurred = false;
+	context.invalidDescriptors = false;
 
 	//we try the parallel way (if we have enough memory)
 	bool useParallelStrategy = true;
@@ -317,12 +368,13 @@ bool qCanupoTools::ComputeCorePointsDescriptors(CCLib::GenericIndexedCloud* core
 	useParallelStrategy = false;
 #endif
 
-	std::vector<unsigned> corePointsIndexes;
+	//the core points are processed by chunks (each task reuses the same buffers for all its points)
+	std::vector< std::pair<unsigned, unsigned> > chunks;
 	if (useParallelStrategy)
 	{
 		try
 		{
-			corePointsIndexes.resize(corePtsCount);
+			chunks.reserve((corePtsCount + DESCRIPTORS_CHUNK_SIZE - 1) / DESCRIPTORS_CHUNK_SIZE);
 		}
 		catch (const std::bad_alloc&)
 		{
@@ -333,9 +385,9 @@ bool qCanupoTools::ComputeCorePointsDescriptors(CCLib::GenericIndexedCloud* core
 
 	if (useParallelStrategy)
 	{
-		for (unsigned i=0; i<corePtsCount; ++i)
+		for (unsigned first = 0; first < corePtsCount; first += DESCRIPTORS_CHUNK_SIZE)
 		{
-			corePointsIndexes[i] = i;
+			chunks.emplace_back(first, std::min(first + DESCRIPTORS_CHUNK_SIZE, corePtsCount));
 		}
 
 		if (maxThreadCount == 0)
@@ -344,37 +396,24 @@ bool qCanupoTools::ComputeCorePointsDescriptors(CCLib::GenericIndexedCloud* core
 		}
 		assert(maxThreadCount <= QThread::idealThreadCount());
 		QThreadPool::globalInstance()->setMaxThreadCount(maxThreadCount);
-		QtConcurrent::blockingMap(corePointsIndexes, ComputeCorePointDescriptor);
+		QtConcurrent::blockingMap(chunks, [&context](const std::pair<unsigned, unsigned>& chunk) { ComputeCorePointsDescriptorsRange(chunk.first, chunk.second, context); });
 	}
 	else
 	{
-		//manually call the static per-point method!
-		for (unsigned i=0; i<corePtsCount; ++i)
+		for (unsigned first = 0; first < corePtsCount && !context.processCanceled; first += DESCRIPTORS_CHUNK_SIZE)
 		{
-			ComputeCorePointDescriptor(i);
+			ComputeCorePointsDescriptorsRange(first, std::min(first + DESCRIPTORS_CHUNK_SIZE, corePtsCount), context);
 		}
 	}
 
 	//output flags
-	bool wasCanceled = s_computeCorePointsDescParams.processCanceled;
-	bool errorOccurred = s_computeCorePointsDescParams.errorOccurred;
+	bool wasCanceled = context.processCanceled;
+	bool errorOccurred = context.errorOccurred;
 	if (errorOccurred)
 		error = "An error occurred during descriptors computation!";
 	else if (wasCanceled)
 		error = "Process has been cancelled by the user";
-	invalidDescriptors = s_computeCorePointsDescParams.invalidDescriptors;
-
-	//reset static parameters (just to be clean ;)
-	s_computeCorePointsDescParams.corePoints = nullptr;
-	s_computeCorePointsDescParams.descriptors = nullptr;
-	s_computeCorePointsDescParams.sourceCloud = nullptr;
-	s_computeCorePointsDescParams.octree = nullptr;
-	s_computeCorePointsDescParams.octreeLevel = 0;
-	s_computeCorePointsDescParams.nProgress = nullptr;
-	s_computeCorePointsDescParams.processCanceled = false;
-	s_computeCorePointsDescParams.errorOccurred = false;
-	s_computeCorePointsDescParams.invalidDescriptors = false;
-	s_computeCorePointsDescParams.computer = nullptr;
+	invalidDescriptors = context.invalidDescriptors;
 
 	if (progressCb)
 	{
@@ -17,7 +17,7 @@
 
 #include "ccTrace.h"
 #include <queue>
-#include <bitset>
+#include <functional>
 
 ccTrace::ccTrace(ccPointCloud* associatedCloud) : ccPolyline(associatedCloud)
 {
@@ -288,69 +288,69 @@ std::deque<int> ccTrace::optimizeSegment(int start, int end, int offset)
 		m_end_rgb[0]   = 0; m_end_rgb[1]   = 0; m_end_rgb[2]   = 0;
 	}
 
+	//get (or build) the neighbour graph of the cloud
+	if (!m_graph || !m_graph->isValid(m_cloud))
+	{
+		m_graph = NeighbourGraph::Get(m_cloud, m_search_r);
+		if (!m_graph)
+		{
+			return std::deque<int>(); //error -> no octree
+		}
+	}
+
+	//retrieve the precomputed cost fields once for the whole search
+	updateCostFields();
+
+	//the slow curvature & gradient costs need the full neighbourhood of the expanded node
+	bool needNeighbourhood = ((COST_MODE & MODE::CURVE) && !m_curvatureSF)
+						|| ((COST_MODE & MODE::GRADIENT) && !m_gradientSF && m_cloud->hasColors());
+
 	//get location of target node - used to optimise algorithm to stop searching paths leading away from the target
 	const CCVector3* end_v = m_cloud->getPoint(end);
 
-	//code essentially taken from wikipedia page for Djikstra: https://en.wikipedia.org/wiki/Dijkstra%27s_algorithm
-	std::vector<bool> visited; //an array of bits to check if node has been visited
-	std::priority_queue<Node*,std::vector<Node*>,Compare> openQueue; //priority queue that stores nodes that haven't yet been explored/opened
-	std::vector<Node*> nodes; //list of visited nodes. Used to cleanup memory after re-constructing shortest path.
+	//A* heuristic: each edge is at most m_search_r long and costs at least 1 (+ the constant distance cost), hence
+	//(distance to the end / m_search_r) edges of minimum cost never over-estimate the remaining cost
+	const int minEdgeCost = 1 + ((COST_MODE & MODE::DISTANCE) ? getSegmentCostDist(start, end) : 0);
+	const float invSearchR = 1.0f / m_search_r;
 
-	//set size of visited such that there is one bit per point in the cloud
-	visited.resize(m_cloud->size(), false); //n.b. for 400 million points, this will still only be ~50Mb =)
+	//code essentially taken from wikipedia page for A*: https://en.wikipedia.org/wiki/A*_search_algorithm
+	//nodes are only created for the points actually reached by the search (sparse tracking instead of a per-point array)
+	std::vector<Node> nodes; //list of reached nodes
+	std::unordered_map<int, int> nodeIndexes; //point index -> position in 'nodes'
+	typedef std::pair<int, int> OpenEntry; //estimated total cost, position in 'nodes'
+	std::priority_queue<OpenEntry, std::vector<OpenEntry>, std::greater<OpenEntry>> openQueue; //nodes that haven't yet been explored/opened
 
 	//declare variables used in the loop
-	Node* current = nullptr;
+	int current = 0;
 	int current_idx = 0;
 	int cost = 0;
-	int smallest_cost = 999999;
 	int iter_count = 0;
 	float cur_d2, next_d2;
 
-	//setup buffer for storing nodes
-	int bufferSize = 500000; //500k node buffer (~1.5-2Mb). This should be enough for most small-medium size traces. More buffers will be created for bigger ones.
-	Node* node_buffer = new Node[bufferSize]; 
-	nodes.push_back(node_buffer); //store buffer in nodes list (for cleanup)
-	int nodeCount = 1; //start node will be added shortly
-
-	//setup octree & values for nearest neighbour searches
-	ccOctree::Shared oct = m_cloud->getOctree();
-	if (!oct)
-	{
-		oct = m_cloud->computeOctree(); //if the user clicked "no" when asked to compute the octree then tough....
-	}
-	unsigned char level = oct->findBestLevelForAGivenNeighbourhoodSizeExtraction(m_search_r);
-
-	//initialize start node on node_buffer and add to openQueue
-	node_buffer[0].set(start, 0, nullptr);
-	openQueue.push(&node_buffer[0]);
-
-	//mark start node as visited
-	visited[start] = true;
+	//initialize start node and add to openQueue
+	nodes.reserve(1024);
+	nodes.push_back(Node(start, 0, -1));
+	nodeIndexes[start] = 0;
+	openQueue.push(OpenEntry(0, 0));
 
-	while (openQueue.size() > 0) //while unvisited nodes exist
+	while (!openQueue.empty()) //while unvisited nodes exist
 	{
 		//check if we excede max iterations
 		if (iter_count > m_maxIterations)
 		{
-			//cleanup buffers
-			for (Node* n : nodes)
-			{
-				delete[] n;
-			}
-
-			//bail
 			return std::deque<int>(); //bail
 		}
 
-		iter_count++;
+		//get lowest cost node for expansion & remove it from open set
+		current = openQueue.top().second;
+		openQueue.pop();
 
-		//get lowest cost node for expansion
-		current = openQueue.top();
-		current_idx = current->index;
+		if (nodes[current].closed) //outdated entry (the node was reached again with a lower cost)
+			continue;
+		nodes[current].closed = true;
+		current_idx = nodes[current].index;
 
-		//remove node from open set
-		openQueue.pop(); //remove node from open set (queue)
+		iter_count++;
 
 		if (current_idx == end) //we've found it!
 		{
@@ -358,20 +358,14 @@ std::deque<int> ccTrace::optimizeSegment(int start, int end, int offset)
 			path.push_back(end); //add end node
 
 			//traverse backwards to reconstruct path
-			while (current->index != start)
+			while (nodes[current].index != start)
 			{
-				current = current->previous;
-				path.push_front(current->index);
+				current = nodes[current].previous;
+				path.push_front(nodes[current].index);
 			}
 
 			path.push_front(start);
 
-			//cleanup node buffers
-			for (Node* n : nodes)
-			{
-				delete[] n;
-			}
-
 			//return
 			return path;
 		}
@@ -382,62 +376,149 @@ std::deque<int> ccTrace::optimizeSegment(int start, int end, int offset)
 					(cur->y - end_v->y)*(cur->y - end_v->y) +
 					(cur->z - end_v->z)*(cur->z - end_v->z);
 
-		//fill "neighbours" with nodes - essentially get results of a "sphere" search around active current point
-		m_neighbours.clear();
-    
-		oct->getPointsInSphericalNeighbourhood(*cur, PointCoordinateType(m_search_r), m_neighbours, level);
+		//get the neighbours of the current point (from the cached graph)
+		const unsigned* neighbours = nullptr;
+		unsigned neighbourCount = m_graph->getNeighbours(static_cast<unsigned>(current_idx), neighbours);
+
+		if (needNeighbourhood)
+		{
+			m_neighbours.resize(neighbourCount);
+			for (unsigned i = 0; i < neighbourCount; i++)
+			{
+				const CCVector3* P = m_cloud->getPoint(neighbours[i]);
+				m_neighbours[i] = CCLib::DgmOctree::PointDescriptor(P, neighbours[i], (*P - *cur).norm2d());
+			}
+		}
 
 		//loop through neighbours
-		for (size_t i = 0; i < m_neighbours.size(); i++)
+		for (unsigned i = 0; i < neighbourCount; i++)
 		{
-			m_p = m_neighbours[i];
-			
-			if (visited[m_p.pointIndex]) //Has this node been visited before? If so then bail.
+			int next_idx = static_cast<int>(neighbours[i]);
+
+			std::unordered_map<int, int>::const_iterator it = nodeIndexes.find(next_idx);
+			if (it != nodeIndexes.end() && nodes[it->second].closed) //Has this node been expanded before? If so then bail.
 				continue;
 
 			//calculate (squared) distance from this neighbour to the end
-			next_d2 =	(m_p.point->x - end_v->x)*(m_p.point->x - end_v->x) +
-						(m_p.point->y - end_v->y)*(m_p.point->y - end_v->y) +
-						(m_p.point->z - end_v->z)*(m_p.point->z - end_v->z);
+			const CCVector3* P = m_cloud->getPoint(next_idx);
+			next_d2 =	(P->x - end_v->x)*(P->x - end_v->x) +
+						(P->y - end_v->y)*(P->y - end_v->y) +
+						(P->z - end_v->z)*(P->z - end_v->z);
 
 			if (next_d2 >= cur_d2) //Bigger than the original distance? If so then bail.
 				continue;
 
 			//calculate cost to this neighbour
-			cost = getSegmentCost(current_idx, m_p.pointIndex);
+			m_p = needNeighbourhood ? m_neighbours[i] : CCLib::DgmOctree::PointDescriptor(P, next_idx);
+			cost = getSegmentCost(current_idx, next_idx);
 
 			#ifdef DEBUG_PATH
-			m_cloud->setPointScalarValue(m_p.pointIndex, static_cast<ScalarType>(cost)); //STORE VISITED NODES (AND COST) FOR DEBUG VISUALISATIONS
+			m_cloud->setPointScalarValue(next_idx, static_cast<ScalarType>(cost)); //STORE VISITED NODES (AND COST) FOR DEBUG VISUALISATIONS
 			#endif
 
 			//transform into cost from start node
-			cost += current->total_cost;
+			cost += nodes[current].total_cost;
+
+			//estimated total cost (through this neighbour)
+			int estimate = cost + minEdgeCost * static_cast<int>(sqrt(next_d2) * invSearchR);
 
-			//check that the node buffer isn't full
-			if (nodeCount == bufferSize)
+			if (it == nodeIndexes.end()) //new node
 			{
-				//buffer is full - create a new one
-				node_buffer = new Node[bufferSize];
-				nodes.push_back(node_buffer);
-				nodeCount = 0;
+				int n = static_cast<int>(nodes.size());
+				nodes.push_back(Node(next_idx, cost, current));
+				nodeIndexes[next_idx] = n;
+				openQueue.push(OpenEntry(estimate, n));
 			}
+			else if (cost < nodes[it->second].total_cost) //cheaper path to an already reached node
+			{
+				nodes[it->second].total_cost = cost;
+				nodes[it->second].previous = current;
+				openQueue.push(OpenEntry(estimate, it->second));
+			}
+		}
+	}
 
-			//initialize node on node buffer
-			node_buffer[nodeCount].set(m_p.pointIndex, cost, current);
+	return std::deque<int>(); //no path (the end can't be reached without going backwards)
+}
+
+void ccTrace::updateCostFields()
+{
+	int idx = m_cloud->getScalarFieldIndexByName("Gradient"); //look for pre-existing gradient SF
+	m_gradientSF = (idx != -1 ? static_cast<ccScalarField*>(m_cloud->getScalarField(idx)) : nullptr);
+
+	idx = m_cloud->getScalarFieldIndexByName("Curvature"); //look for pre-existing curvature SF
+	m_curvatureSF = (idx != -1 ? static_cast<ccScalarField*>(m_cloud->getScalarField(idx)) : nullptr);
+}
+
+ccTrace::NeighbourGraph::NeighbourGraph(ccPointCloud* cloud, ccOctree::Shared octree, float search_r)
+	: m_octree(octree)
+	, m_cloudSize(cloud->size())
+	, m_search_r(search_r)
+	, m_level(octree->findBestLevelForAGivenNeighbourhoodSizeExtraction(search_r))
+{
+}
+
+bool ccTrace::NeighbourGraph::isValid(ccPointCloud* cloud) const
+{
+	return cloud->size() == m_cloudSize && cloud->getOctree() == m_octree;
+}
+
+unsigned ccTrace::NeighbourGraph::getNeighbours(unsigned pointIndex, const unsigned*& neighbours)
+{
+	std::unordered_map<unsigned, std::pair<size_t, unsigned>>::const_iterator it = m_lists.find(pointIndex);
+	if (it == m_lists.end())
+	{
+		//first time we meet this point: fill "neighbours" with the results of a "sphere" search around it
+		m_buffer.clear();
+		m_octree->getPointsInSphericalNeighbourhood(*m_octree->associatedCloud()->getPoint(pointIndex), PointCoordinateType(m_search_r), m_buffer, m_level);
+
+		std::pair<size_t, unsigned> list(m_indexes.size(), static_cast<unsigned>(m_buffer.size()));
+		for (const CCLib::DgmOctree::PointDescriptor& n : m_buffer)
+		{
+			m_indexes.push_back(n.pointIndex);
+		}
+		it = m_lists.insert(std::make_pair(pointIndex, list)).first;
+	}
 
-			//push node to open set
-			openQueue.push(&node_buffer[nodeCount]);
+	neighbours = m_indexes.data() + it->second.first;
+	return it->second.second;
+}
 
-			//we now have one more node
-			nodeCount++;
+ccTrace::NeighbourGraph::Shared ccTrace::NeighbourGraph::Get(ccPointCloud* cloud, float search_r)
+{
+	//graphs are only kept alive by the traces using them
+	static std::map<std::pair<unsigned, float>, QWeakPointer<NeighbourGraph>> s_graphs;
 
-			//mark node as visited
-			visited[m_p.pointIndex] = true;
+	//forget the released graphs
+	for (auto it = s_graphs.begin(); it != s_graphs.end();)
+	{
+		if (it->second.isNull())
+			it = s_graphs.erase(it);
+		else
+			++it;
+	}
+
+	std::pair<unsigned, float> key(cloud->getUniqueID(), search_r);
+	Shared graph = s_graphs[key].toStrongRef();
+	if (graph && graph->isValid(cloud))
+	{
+		return graph;
+	}
+
+	//setup octree for nearest neighbour searches
+	ccOctree::Shared oct = cloud->getOctree();
+	if (!oct)
+	{
+		oct = cloud->computeOctree(); //if the user clicked "no" when asked to compute the octree then tough....
+		if (!oct)
+		{
+			return Shared();
 		}
 	}
 
-	assert(false);
-	return std::deque<int>(); //shouldn't come here?
+	graph = Shared(new NeighbourGraph(cloud, oct, search_r));
+	s_graphs[key] = graph;
+	return graph;
 }
 
 int ccTrace::getSegmentCost(int p1, int p2)
@@ -520,14 +601,10 @@ int ccTrace::getSegmentCostLight(int p1, int p2)
 
 int ccTrace::getSegmentCostCurve(int p1, int p2)
 {
-	int idx = m_cloud->getScalarFieldIndexByName("Curvature"); //look for pre-existing gradient SF
-	if (isCurvaturePrecomputed()) //scalar field found - return from precomputed cost]
+	if (m_curvatureSF) //scalar field found - return from precomputed cost]
 	{
-		//activate SF
-		m_cloud->setCurrentScalarField(idx);
-
 		//return inverse of p2 value
-		return m_cloud->getScalarField(idx)->getMax() - m_cloud->getPointScalarValue(p2);
+		return m_curvatureSF->getMax() - m_curvatureSF->getValue(p2);
 	}
 	else //scalar field not found - do slow calculation...
 	{
@@ -561,14 +638,10 @@ int ccTrace::getSegmentCostCurve(int p1, int p2)
 
 int ccTrace::getSegmentCostGrad(int p1, int p2, float search_r)
 {
-	int idx = m_cloud->getScalarFieldIndexByName("Gradient"); //look for pre-existing gradient SF
-	if (idx != -1) //found precomputed gradient
+	if (m_gradientSF) //found precomputed gradient
 	{
-		//activate SF
-		m_cloud->setCurrentScalarField(idx);
-
 		//return inverse of p2 value
-		return m_cloud->getScalarField(idx)->getMax() - m_cloud->getPointScalarValue(p2);
+		return m_gradientSF->getMax() - m_gradientSF->getValue(p2);
 	}
 	else //not found... do expensive calculation
 	{
@@ -30,6 +30,7 @@
 #include <DgmOctreeReferenceCloud.h>
 #include <GenericIndexedCloudPersist.h>
 #include <ccPointCloud.h>
+#include <ccOctree.h>
 #include <ccColorTypes.h>
 #include <Neighbourhood.h>
 #include <ccPlane.h>
@@ -43,6 +44,7 @@
 #include <vector>
 #include <algorithm>
 #include <unordered_map>
+#include <map>
 #include <deque>
 #include <qmessagebox.h>
 
@@ -221,6 +223,9 @@ protected:
 	int getSegmentCostScalar(int p1, int p2);
 	int getSegmentCostScalarInv(int p1, int p2);
 
+	//retrieves the precomputed "Gradient" and "Curvature" cost fields (if any) once per search rather than once per edge
+	void updateCostFields();
+
 	//calculate the search radius that should be used for the shortest path calcs
 	float calculateOptimumSearchRadius();
 
@@ -233,35 +238,53 @@ protected:
 	std::vector<int> m_previous; //for undoing waypoints
 private:
 
-	//class for storing point index & path costs (from the path start) in sorted lists
+	//class for storing point index & path costs (from the path start) during the search
 	class Node
 	{
 	public:
 
-		void set(int node_index, int node_total_cost, Node* prev_node)
-		{
-			index = node_index;
-			total_cost = node_total_cost;
-			previous = prev_node;
-		}
+		Node(int node_index, int node_total_cost, int prev_node)
+			: index(node_index)
+			, total_cost(node_total_cost)
+			, previous(prev_node)
+		{}
 
 		int index=-1;
 		int total_cost=0;
-		Node* previous=nullptr;
+		int previous=-1; //position of the previous node in the search node list (-1 for the start node)
+		bool closed=false; //whether the node has already been expanded
 	};
 
-	//class for comparing Node pointers in priority_queue
-	class Compare
+	/*
+	Neighbour graph of a cloud (for a given search radius). The neighbours of each point are only computed (with an octree
+	sphere search) the first time the point is expanded, and then kept for all the following searches. Graphs are shared
+	between all the traces of the same cloud, so that re-routing after a waypoint edit mostly hits already known neighbourhoods.
+	*/
+	class NeighbourGraph
 	{
 	public:
-		bool operator() (Node* t1, Node* t2)
-		{
-			//n.b. the priority queue puts "higher" priorities at the front of the queue.
-			//in this case, lower total_cost = "higher priority"
-			//hence we compare total_cost with the > operator
-			//i.e. t1 is less important than t2 if this.total_cost > t1.total_cost 
-			return t1->total_cost > t2->total_cost; //compare based on cost
-		}
+		typedef QSharedPointer<NeighbourGraph> Shared;
+
+		NeighbourGraph(ccPointCloud* cloud, ccOctree::Shared octree, float search_r);
+
+		//returns true if this graph still matches the current state of the given cloud (same points & same octree)
+		bool isValid(ccPointCloud* cloud) const;
+
+		//retrieves the neighbours of a point (computed on the first call). The returned pointer is only valid until the next call.
+		unsigned getNeighbours(unsigned pointIndex, const unsigned*& neighbours);
+
+		//returns the graph associated to a cloud & search radius (creates it if necessary)
+		static Shared Get(ccPointCloud* cloud, float search_r);
+
+	protected:
+		ccOctree::Shared m_octree;
+		unsigned m_cloudSize;
+		float m_search_r;
+		unsigned char m_level;
+
+		std::unordered_map<unsigned, std::pair<size_t, unsigned>> m_lists; //point index -> (offset, count) in m_indexes
+		std::vector<unsigned> m_indexes; //concatenated neighbour lists
+		CCLib::DgmOctree::NeighboursSet m_buffer; //octree search buffer
 	};
 
 	//random vars that we keep to optimise speed
@@ -271,6 +294,9 @@ private:
 	CCLib::DgmOctree::PointDescriptor m_p;
 	float m_search_r;
 	float m_maxIterations;
+	NeighbourGraph::Shared m_graph; //(lazily built) neighbour graph of m_cloud
+	ccScalarField* m_gradientSF = nullptr; //precomputed gradient cost (if any)
+	ccScalarField* m_curvatureSF = nullptr; //precomputed curvature cost (if any)
 
 	/*
 	Test if a point falls within a circle who's diameter equals the line from segStart to segEnd. This is used to test if a newly added point should be
@@ -109,4 +109,5 @@ void qM3C2Plugin::registerCommands(ccCommandLineInterface* cmd)
 		return;
 	}
 	cmd->registerCommand(ccCommandLineInterface::Command::Shared(new CommandM3C2));
+	cmd->registerCommand(ccCommandLineInterface::Command::Shared(new CommandM3C2TimeSeries));
 }
@@ -25,6 +25,8 @@
 #include "qM3C2Process.h"
 
 static const char COMMAND_M3C2[] = "M3C2";
+static const char COMMAND_M3C2_TIME_SERIES[] = "M3C2_TIME_SERIES";
+static const char COMMAND_M3C2_REFERENCE[] = "REFERENCE";
 
 struct CommandM3C2 : public ccCommandLineInterface::Command
 {
@@ -86,4 +88,75 @@ struct CommandM3C2 : public ccCommandLineInterface::Command
 	}
 };
 
+struct CommandM3C2TimeSeries : public ccCommandLineInterface::Command
+{
+	CommandM3C2TimeSeries() : ccCommandLineInterface::Command("M3C2 time series", COMMAND_M3C2_TIME_SERIES) {}
+
+	virtual bool process(ccCommandLineInterface& cmd) override
+	{
+		cmd.print("[M3C2 TIME SERIES]");
+		if (cmd.arguments().empty())
+		{
+			return cmd.error(QString("Missing parameter: parameters filename after \"-%1\"").arg(COMMAND_M3C2_TIME_SERIES));
+		}
+
+		//open specified file
+		QString paramFilename(cmd.arguments().takeFirst());
+		cmd.print(QString("Parameters file: '%1'").arg(paramFilename));
+
+		//compare each epoch to the first one (instead of the previous one)?
+		bool consecutive = true;
+		if (!cmd.arguments().empty() && ccCommandLineInterface::IsCommand(cmd.arguments().front(), COMMAND_M3C2_REFERENCE))
+		{
+			//local option confirmed, we can move on
+			cmd.arguments().pop_front();
+			consecutive = false;
+		}
+		cmd.print(consecutive ? "Pairs: consecutive epochs" : "Pairs: each epoch vs. the first one");
+
+		if (cmd.clouds().size() < 2)
+		{
+			cmd.error("Not enough clouds loaded (at least 2 epochs are expected, in chronological order)");
+			return false;
+		}
+
+		std::vector<ccPointCloud*> epochs;
+		for (CLCloudDesc& desc : cmd.clouds())
+		{
+			epochs.push_back(ccHObjectCaster::ToPointCloud(desc.pc));
+		}
+
+		//display dialog
+		qM3C2Dialog dlg(epochs[0], epochs[1], nullptr);
+		if (!dlg.loadParamsFromFile(paramFilename))
+		{
+			return false;
+		}
+
+		QString errorMessage;
+		ccPointCloud* outputCloud = nullptr; //only necessary for the command line version in fact
+		if (!qM3C2Process::ComputeTimeSeries(dlg, epochs, consecutive, errorMessage, outputCloud, cmd.widgetParent()))
+		{
+			return cmd.error(errorMessage);
+		}
+
+		if (outputCloud)
+		{
+			CLCloudDesc cloudDesc(outputCloud, cmd.clouds()[0].basename + QObject::tr("_M3C2_TIME_SERIES"), cmd.clouds()[0].path);
+			if (cmd.autoSaveMode())
+			{
+				QString errorStr = cmd.exportEntity(cloudDesc, QString(), 0, false, true);
+				if (!errorStr.isEmpty())
+				{
+					cmd.error(errorStr);
+				}
+			}
+			//add cloud to the current pool
+			cmd.clouds().push_back(cloudDesc);
+		}
+
+		return true;
+	}
+};
+
 #endif //M3C2_PLUGIN_COMMANDS_HEADER
@@ -0,0 +1,805 @@
+//##########################################################################
+//#                                                                        #
+//#                       CLOUDCOMPARE PLUGIN: qM3C2                       #
+//#                                                                        #
+//#  This program is free software; you can redistribute it and/or modify  #
+//#  it under the terms of the GNU General Public License as published by  #
+//#  the Free Software Foundation; version 2 or later of the License.      #
+//#                                                                        #
+//#  This program is distributed in the hope that it will be useful,       #
+//#  but WITHOUT ANY WARRANTY; without even the implied warranty of        #
+//#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the          #
+//#  GNU General Public License for more details.                          #
+//#                                                                        #
+//#            COPYRIGHT: UNIVERSITE EUROPEENNE DE BRETAGNE                #
+//#                                                                        #
+//##########################################################################
+
+#include "qM3C2Engine.h"
+
+//local
+#include "qM3C2Tools.h"
+
+//qCC_db
+#include <ccPointCloud.h>
+#include <ccNormalVectors.h>
+#include <ccScalarField.h>
+
+//Qt
+#include <QThread>
+#include <QThreadPool>
+#include <QtConcurrentMap>
+
+//system
+#include <algorithm>
+#include <atomic>
+#include <limits>
+
+static ScalarType SCALAR_ONE = 1;
+
+//! Max number of core points per batch
+static const unsigned MAX_BATCH_SIZE = 256;
+
+// Computes the uncertainty based on 'precision maps' (as scattered scalar fields)
+static double ComputePMUncertainty(CCLib::DgmOctree::NeighboursSet& set, const CCVector3& N, const qM3C2Engine::PrecisionMaps& PM)
+{
+	size_t count = set.size();
+	if (count == 0)
+	{
+		assert(false);
+		return 0;
+	}
+
+	int minIndex = -1;
+	if (count == 1)
+	{
+		minIndex = 0;
+	}
+	else
+	{
+		//compute gravity center
+		CCVector3d G(0, 0, 0);
+		for (size_t i = 0; i < count; ++i)
+		{
+			G.x += set[i].point->x;
+			G.y += set[i].point->y;
+			G.z += set[i].point->z;
+		}
+
+		G.x /= count;
+		G.y /= count;
+		G.z /= count;
+
+		//now look for the point that is the closest to the gravity center
+		double minSquareDist = -1.0;
+		minIndex = -1;
+		for (size_t i = 0; i < count; ++i)
+		{
+			CCVector3d dG(	G.x - set[i].point->x,
+							G.y - set[i].point->y,
+							G.z - set[i].point->z );
+			double squareDist = dG.norm2();
+			if (minIndex < 0 || squareDist < minSquareDist)
+			{
+				minSquareDist = squareDist;
+				minIndex = static_cast<int>(i);
+			}
+		}
+	}
+
+	assert(minIndex >= 0);
+	unsigned pointIndex = set[minIndex].pointIndex;
+	CCVector3d sigma(	PM.sX->getValue(pointIndex) * PM.scale,
+						PM.sY->getValue(pointIndex) * PM.scale,
+						PM.sZ->getValue(pointIndex) * PM.scale);
+
+	CCVector3d NS(	N.x * sigma.x,
+					N.y * sigma.y,
+					N.z * sigma.z);
+
+	return NS.norm();
+}
+
+//! Cylinder of a core point
+struct CoreCylinder
+{
+	CCVector3 center;
+	CCVector3 dir;
+};
+
+//! Working buffers of a batch
+struct BatchBuffers
+{
+	//! Candidate points of the current cloud (shared by all the core points of the batch)
+	CCLib::DgmOctree::BoxNeighbourhood candidates;
+	//! Points inside the current cylinder
+	CCLib::DgmOctree::NeighboursSet members;
+	//! Current neighbourhood (progressive mode)
+	CCLib::DgmOctree::NeighboursSet neighbours;
+};
+
+//! Extracts the candidate points of a cloud for a set of cylinders
+/** The candidates are the points falling inside the bounding-box of all the cylinders
+	(see DgmOctree::getPointsInCylindricalNeighbourhood for the cylinder bounding-box).
+**/
+static void ExtractCandidates(	const CCLib::DgmOctree& octree,
+								unsigned char level,
+								const std::vector<CoreCylinder>& cylinders,
+								PointCoordinateType radius,
+								PointCoordinateType maxHalfLength,
+								bool onlyPositiveDir,
+								CCLib::DgmOctree::BoxNeighbourhood& candidates)
+{
+	candidates.neighbours.resize(0);
+	if (cylinders.empty())
+	{
+		return;
+	}
+
+	//dumb bounding-box estimation: place two spheres at the ends of each cylinder
+	//(slightly enlarged so that no point of the cylinders is missed because of rounding errors)
+	const PointCoordinateType margin = radius * static_cast<PointCoordinateType>(1.01);
+	const CCVector3 R(margin, margin, margin);
+	const PointCoordinateType minHalfLength = onlyPositiveDir ? 0 : -maxHalfLength;
+	CCVector3 minCorner = cylinders.front().center;
+	CCVector3 maxCorner = cylinders.front().center;
+	for (const CoreCylinder& cylinder : cylinders)
+	{
+		const CCVector3 ends[2] = { cylinder.center + cylinder.dir * maxHalfLength, cylinder.center + cylinder.dir * minHalfLength };
+		for (const CCVector3& C : ends)
+		{
+			minCorner.x = std::min(minCorner.x, C.x - R.x);
+			minCorner.y = std::min(minCorner.y, C.y - R.y);
+			minCorner.z = std::min(minCorner.z, C.z - R.z);
+			maxCorner.x = std::max(maxCorner.x, C.x + R.x);
+			maxCorner.y = std::max(maxCorner.y, C.y + R.y);
+			maxCorner.z = std::max(maxCorner.z, C.z + R.z);
+		}
+	}
+
+	candidates.center = (minCorner + maxCorner) / 2;
+	candidates.dimensions = maxCorner - minCorner;
+	candidates.axes = nullptr;
+	candidates.level = level;
+	octree.getPointsInBoxNeighbourhood(candidates);
+}
+
+//! Extracts the candidate points falling inside a cylinder
+/** Same test as DgmOctree::getPointsInCylindricalNeighbourhood (the signed
+	distance along the cylinder axis is stored in 'squareDistd').
+	In progressive mode, the points are sorted by increasing distance to
+	the cylinder center (along its axis).
+**/
+static void ExtractCylinder(const CCLib::DgmOctree::NeighboursSet& candidates,
+							const CoreCylinder& cylinder,
+							PointCoordinateType radius,
+							PointCoordinateType maxHalfLength,
+							bool onlyPositiveDir,
+							bool progressive,
+							CCLib::DgmOctree::NeighboursSet& members)
+{
+	members.resize(0);
+
+	double squareRadius = static_cast<double>(radius) * static_cast<double>(radius);
+	PointCoordinateType minHalfLength = onlyPositiveDir ? 0 : -maxHalfLength;
+
+	for (const CCLib::DgmOctree::PointDescriptor& candidate : candidates)
+	{
+		CCVector3 OP = (*candidate.point - cylinder.center);
+		PointCoordinateType dot = OP.dot(cylinder.dir);
+		double d2 = (OP - cylinder.dir * dot).norm2d();
+		if (d2 <= squareRadius && dot >= minHalfLength && dot <= maxHalfLength)
+		{
+			members.emplace_back(candidate.point, candidate.pointIndex, dot); //we save the distance relatively to the center projected on the axis!
+		}
+	}
+
+	if (progressive)
+	{
+		std::sort(members.begin(), members.end(), [](const CCLib::DgmOctree::PointDescriptor& a, const CCLib::DgmOctree::PointDescriptor& b)
+		{
+			return std::abs(a.squareDistd) < std::abs(b.squareDistd);
+		});
+	}
+}
+
+//! Computes the statistics of the points of a cloud inside a core point cylinder
+/** Reproduces the progressive search of DgmOctree::getPointsInCylindricalNeighbourhoodProgressive
+	(the cylinder height is increased until the statistics are sharp enough) on the sorted
+	cylinder points.
+	\param buffers working buffers (the cylinder points must be in 'members')
+	\param[out] validStats whether the statistics have been computed
+	\return the final neighbourhood ('members' in standard mode, 'neighbours' in progressive mode)
+**/
+static CCLib::DgmOctree::NeighboursSet& SearchNeighbourhood(const qM3C2Engine::Parameters& params,
+															BatchBuffers& buffers,
+															bool& validStats,
+															double& mean,
+															double& stdDev)
+{
+	validStats = false;
+	if (!params.progressiveSearch)
+	{
+		return buffers.members;
+	}
+
+	CCLib::DgmOctree::NeighboursSet& members = buffers.members;
+	CCLib::DgmOctree::NeighboursSet& neighbours = buffers.neighbours;
+	neighbours.resize(0);
+
+	const PointCoordinateType& radius = params.projectionRadius;
+	const PointCoordinateType& maxHalfLength = params.projectionDepth;
+	PointCoordinateType currentHalfLength = 0;
+	size_t memberIndex = 0;
+	size_t previousNeighbourCount = 0;
+	while (currentHalfLength < maxHalfLength)
+	{
+		//increase the search cylinder's height
+		currentHalfLength += radius;
+		//no need to chop the max cylinder if the parts are too small!
+		if (maxHalfLength - currentHalfLength < radius / 2)
+			currentHalfLength = maxHalfLength;
+
+		while (memberIndex < members.size() && std::abs(members[memberIndex].squareDistd) <= currentHalfLength)
+		{
+			neighbours.push_back(members[memberIndex++]);
+		}
+
+		size_t neighbourCount = neighbours.size();
+		if (neighbourCount != previousNeighbourCount)
+		{
+			//do we have enough points for computing stats?
+			if (neighbourCount >= params.minPoints4Stats)
+			{
+				qM3C2Tools::ComputeStatistics(neighbours, params.useMedian, mean, stdDev);
+				validStats = true;
+				//do we have a sharp enough 'mean' to stop?
+				if (fabs(mean) + 2 * stdDev < static_cast<double>(currentHalfLength))
+					break;
+			}
+			previousNeighbourCount = neighbourCount;
+		}
+	}
+
+	return neighbours;
+}
+
+//! Computes the statistics of the points of a cloud inside a core point cylinder
+/** The candidate points of the cloud must be in 'buffers.candidates'.
+	\param[out] mean mean (or median) position of the points along the cylinder axis
+	\param[out] sigma std. dev. (or interquartile range) of the points along the axis,
+	or the precision maps sigma if 'pmSigma' is true
+	\return the number of points of the (final) neighbourhood
+**/
+static size_t ComputeCylinderStats(	const qM3C2Engine::Parameters& params,
+									const qM3C2Engine::ComparedCloud& cloud,
+									const CoreCylinder& cylinder,
+									bool pmSigma,
+									BatchBuffers& buffers,
+									double& mean,
+									double& sigma)
+{
+	mean = 0;
+	sigma = 0;
+	bool validStats = false;
+
+	ExtractCylinder(buffers.candidates.neighbours, cylinder, params.projectionRadius, params.projectionDepth, params.onlyPositiveSearch, params.progressiveSearch, buffers.members);
+	CCLib::DgmOctree::NeighboursSet& neighbours = SearchNeighbourhood(params, buffers, validStats, mean, sigma);
+
+	size_t count = neighbours.size();
+	if (count != 0)
+	{
+		//compute stat. dispersion on the neighbours (if necessary)
+		if (!validStats)
+		{
+			qM3C2Tools::ComputeStatistics(neighbours, params.useMedian, mean, sigma);
+		}
+		assert(sigma != sigma || sigma >= 0); //first inequality fails if sigma is NaN ;)
+
+		if (pmSigma)
+		{
+			//compute the Precision Maps derived sigma
+			sigma = ComputePMUncertainty(neighbours, cylinder.dir, cloud.pm);
+		}
+	}
+
+	return count;
+}
+
+//! Processes batches of core points (in parallel if possible)
+template <class Batches, class Func> static void ProcessBatches(const Batches& batches, Func processBatch, int maxThreadCount)
+{
+	if (maxThreadCount <= 0)
+	{
+		maxThreadCount = QThread::idealThreadCount();
+	}
+	bool useParallelStrategy = (maxThreadCount > 1 && batches.size() > 1);
+#ifdef _DEBUG
+	useParallelStrategy = false;
+#endif
+
+	if (useParallelStrategy)
+	{
+		QThreadPool::globalInstance()->setMaxThreadCount(maxThreadCount);
+		QtConcurrent::blockingMap(batches.begin(), batches.end(), processBatch);
+	}
+	else
+	{
+		for (const auto& batch : batches)
+		{
+			processBatch(batch);
+		}
+	}
+}
+
+//! Extracts the cylinders of a batch of core points
+static void GetCylinders(	const ccPointCloud* corePoints,
+							const NormsIndexesTableType* coreNormals,
+							const std::vector<unsigned>& sortedCorePoints,
+							unsigned first,
+							unsigned last,
+							std::vector<CoreCylinder>& cylinders)
+{
+	cylinders.resize(last - first);
+	for (unsigned i = first; i < last; ++i)
+	{
+		unsigned index = sortedCorePoints[i];
+		CoreCylinder& cylinder = cylinders[i - first];
+		cylinder.center = *corePoints->getPoint(index);
+		cylinder.dir = (coreNormals ? ccNormalVectors::GetNormal(coreNormals->getValue(index)) : CCVector3(0, 0, 1));
+	}
+}
+
+//! Sets the M3C2 distance of a core point, and its uncertainty and significance (if necessary)
+/** \param sigma1 std. dev. (or interquartile range, or precision maps sigma) of cloud #1
+	\param sigma2 std. dev. (or interquartile range, or precision maps sigma) of cloud #2
+**/
+static void SetDistanceAndConfidence(	const qM3C2Engine::Parameters& params,
+										double mean1,
+										double sigma1,
+										size_t n1,
+										double mean2,
+										double sigma2,
+										size_t n2,
+										bool computeConfidence,
+										const qM3C2Engine::Output& output,
+										unsigned index)
+{
+	//m3c2 dist = distance between i1 and i2 (i.e. either the mean or the median of both neighborhoods)
+	ScalarType dist = static_cast<ScalarType>(mean2 - mean1);
+	output.m3c2DistSF->setValue(index, dist);
+
+	//confidence interval
+	if (computeConfidence)
+	{
+		ScalarType LODStdDev = NAN_VALUE;
+		if (params.usePrecisionMaps)
+		{
+			LODStdDev = sigma1*sigma1 + sigma2*sigma2; //equation (2) in M3C2-PM article
+		}
+		//standard M3C2 algortihm: have we enough points for computing the confidence interval?
+		else if (n1 >= params.minPoints4Stats && n2 >= params.minPoints4Stats)
+		{
+			LODStdDev = (sigma1*sigma1) / n1 + (sigma2*sigma2) / n2;
+		}
+
+		if (!std::isnan(LODStdDev))
+		{
+			//distance uncertainty (see eq. (1) in M3C2 article)
+			ScalarType LOD = static_cast<ScalarType>(1.96 * (sqrt(LODStdDev) + params.registrationRms));
+
+			if (output.distUncertaintySF)
+			{
+				output.distUncertaintySF->setValue(index, LOD);
+			}
+
+			if (output.sigChangeSF)
+			{
+				bool significant = (dist < -LOD || dist > LOD);
+				if (significant)
+				{
+					output.sigChangeSF->setValue(index, SCALAR_ONE); //already equal to SCALAR_ZERO otherwise
+				}
+			}
+		}
+		//else //scalar fields have already been initialized with the right 'default' values
+	}
+}
+
+qM3C2Engine::qM3C2Engine(const Parameters& params)
+	: m_params(params)
+	, m_corePoints(nullptr)
+	, m_coreNormals(nullptr)
+	, m_canceled(false)
+{
+}
+
+bool qM3C2Engine::setCorePoints(ccPointCloud* corePoints,
+								NormsIndexesTableType* coreNormals,
+								CCLib::GenericProgressCallback* progressCb/*=nullptr*/)
+{
+	m_corePoints = corePoints;
+	m_coreNormals = coreNormals;
+	m_sortedCorePoints.resize(0);
+	m_batches.resize(0);
+
+	if (!m_corePoints)
+	{
+		assert(false);
+		return false;
+	}
+	if (m_coreNormals && m_coreNormals->currentSize() != m_corePoints->size())
+	{
+		assert(false);
+		return false;
+	}
+
+	//we sort the core points by cell code (with a dedicated octree, so that the order doesn't depend on the compared clouds)
+	CCLib::DgmOctree octree(m_corePoints);
+	if (octree.build(progressCb) <= 0)
+	{
+		return false;
+	}
+
+	//the batches are made of core points lying in the same cell (not bigger than the cylinders diameter)
+	unsigned char batchLevel = 1;
+	while (batchLevel < CCLib::DgmOctree::MAX_OCTREE_LEVEL && octree.getCellSize(batchLevel + 1) >= 2 * m_params.projectionRadius)
+	{
+		++batchLevel;
+	}
+	const unsigned char bitDec = CCLib::DgmOctree::GET_BIT_SHIFT(batchLevel);
+
+	const CCLib::DgmOctree::cellsContainer& codes = octree.pointsAndTheirCellCodes();
+	const unsigned count = static_cast<unsigned>(codes.size());
+	try
+	{
+		m_sortedCorePoints.resize(count);
+		for (unsigned i = 0; i < count; ++i)
+		{
+			m_sortedCorePoints[i] = codes[i].theIndex;
+		}
+
+		unsigned first = 0;
+		while (first < count)
+		{
+			unsigned last = first + 1;
+			while (last < count && last - first < MAX_BATCH_SIZE && (codes[last].theCode >> bitDec) == (codes[first].theCode >> bitDec))
+			{
+				++last;
+			}
+			Batch batch;
+			batch.first = first;
+			batch.last = last;
+			m_batches.push_back(batch);
+			first = last;
+		}
+	}
+	catch (const std::bad_alloc&)
+	{
+		//not enough memory
+		m_sortedCorePoints.resize(0);
+		m_batches.resize(0);
+		return false;
+	}
+
+	return true;
+}
+
+bool qM3C2Engine::compute(	const ComparedCloud& cloud1,
+							const ComparedCloud& cloud2,
+							const Output& output,
+							CCLib::GenericProgressCallback* progressCb/*=nullptr*/)
+{
+	bool canceled = false;
+	bool success = compute(cloud1, cloud2, output, m_params.maxThreadCount, canceled, progressCb);
+	m_canceled = canceled;
+
+	return success;
+}
+
+bool qM3C2Engine::compute(	const ComparedCloud& cloud1,
+							const ComparedCloud& cloud2,
+							const Output& output,
+							int maxThreadCount,
+							bool& canceled,
+							CCLib::GenericProgressCallback* progressCb/*=nullptr*/) const
+{
+	canceled = false;
+
+	if (!m_corePoints || !cloud1.octree || !cloud2.octree || !output.m3c2DistSF)
+	{
+		assert(false);
+		return false;
+	}
+	if (m_params.usePrecisionMaps && (!cloud1.pm.valid() || !cloud2.pm.valid()))
+	{
+		assert(false);
+		return false;
+	}
+	if (output.outputCloud && output.exportNormal && !output.outputCloud->hasNormals())
+	{
+		assert(false);
+		return false;
+	}
+
+	//best levels for neighbourhood extraction on both octrees
+	const unsigned char level1 = cloud1.octree->findBestLevelForAGivenNeighbourhoodSizeExtraction(static_cast<PointCoordinateType>(2.5 * m_params.projectionRadius)); //2.5 = empirical!
+	const unsigned char level2 = cloud2.octree->findBestLevelForAGivenNeighbourhoodSizeExtraction(static_cast<PointCoordinateType>(2.5 * m_params.projectionRadius)); //2.5 = empirical!
+
+	const bool computeConfidence = (output.distUncertaintySF || output.sigChangeSF);
+	NormsIndexesTableType* outputNormals = (output.outputCloud && output.exportNormal && m_coreNormals ? output.outputCloud->normals() : nullptr);
+
+	CCLib::NormalizedProgress nProgress(progressCb, static_cast<unsigned>(m_sortedCorePoints.size()));
+	std::atomic<bool> processCanceled(false);
+	std::atomic<bool> error(false);
+
+	//process a batch of core points
+	auto processBatch = [&](const Batch& batch)
+	{
+		if (processCanceled || error)
+		{
+			return;
+		}
+
+		try
+		{
+			//get the core points and their normals
+			std::vector<CoreCylinder> cylinders;
+			GetCylinders(m_corePoints, m_coreNormals, m_sortedCorePoints, batch.first, batch.last, cylinders);
+
+			BatchBuffers buffers1;
+			BatchBuffers buffers2;
+			bool candidates2AreSet = false;
+
+			//the candidates of cloud #1 are shared by all the core points of the batch
+			ExtractCandidates(*cloud1.octree, level1, cylinders, m_params.projectionRadius, m_params.projectionDepth, m_params.onlyPositiveSearch, buffers1.candidates);
+
+			for (unsigned i = batch.first; i < batch.last; ++i)
+			{
+				const unsigned index = m_sortedCorePoints[i];
+				const CoreCylinder& cylinder = cylinders[i - batch.first];
+				const CCVector3& P = cylinder.center;
+				const CCVector3& N = cylinder.dir;
+
+				//output point
+				CCVector3 outputP = P;
+
+				//cloud #1's statistics
+				double mean1 = 0, stdDev1 = 0;
+				size_t n1 = ComputeCylinderStats(m_params, cloud1, cylinder, m_params.usePrecisionMaps && (computeConfidence || output.stdDevCloud1SF), buffers1, mean1, stdDev1);
+				if (n1 != 0)
+				{
+					if (output.exportOption == qM3C2Dialog::PROJECT_ON_CLOUD1)
+					{
+						//shift output point on the 1st cloud
+						outputP += static_cast<PointCoordinateType>(mean1) * N;
+					}
+
+					//save cloud #1's std. dev.
+					if (output.stdDevCloud1SF)
+					{
+						ScalarType val = static_cast<ScalarType>(stdDev1);
+						output.stdDevCloud1SF->setValue(index, val);
+					}
+				}
+
+				//save cloud #1's density
+				if (output.densityCloud1SF)
+				{
+					ScalarType val = static_cast<ScalarType>(n1);
+					output.densityCloud1SF->setValue(index, val);
+				}
+
+				//now we can process cloud #2
+				if (	n1 != 0
+					||	output.exportOption == qM3C2Dialog::PROJECT_ON_CLOUD2
+					||	output.stdDevCloud2SF
+					||	output.densityCloud2SF
+					)
+				{
+					//the candidates of cloud #2 are only extracted if necessary
+					if (!candidates2AreSet)
+					{
+						ExtractCandidates(*cloud2.octree, level2, cylinders, m_params.projectionRadius, m_params.projectionDepth, m_params.onlyPositiveSearch, buffers2.candidates);
+						candidates2AreSet = true;
+					}
+
+					//cloud #2's statistics
+					double mean2 = 0, stdDev2 = 0;
+					size_t n2 = ComputeCylinderStats(m_params, cloud2, cylinder, m_params.usePrecisionMaps && (computeConfidence || output.stdDevCloud2SF), buffers2, mean2, stdDev2);
+					if (n2 != 0)
+					{
+						if (output.exportOption == qM3C2Dialog::PROJECT_ON_CLOUD2)
+						{
+							//shift output point on the 2nd cloud
+							outputP += static_cast<PointCoordinateType>(mean2) * N;
+						}
+
+						if (n1 != 0)
+						{
+							SetDistanceAndConfidence(m_params, mean1, stdDev1, n1, mean2, stdDev2, n2, computeConfidence, output, index);
+						}
+
+						//save cloud #2's std. dev.
+						if (output.stdDevCloud2SF)
+						{
+							ScalarType val = static_cast<ScalarType>(stdDev2);
+							output.stdDevCloud2SF->setValue(index, val);
+						}
+					}
+
+					//save cloud #2's density
+					if (output.densityCloud2SF)
+					{
+						ScalarType val = static_cast<ScalarType>(n2);
+						output.densityCloud2SF->setValue(index, val);
+					}
+				}
+
+				//output point
+				if (output.outputCloud && output.outputCloud != m_corePoints)
+				{
+					*const_cast<CCVector3*>(output.outputCloud->getPoint(index)) = outputP;
+				}
+				if (outputNormals)
+				{
+					outputNormals->setValue(index, m_coreNormals->getValue(index));
+				}
+			}
+		}
+		catch (const std::bad_alloc&)
+		{
+			//not enough memory
+			error = true;
+			return;
+		}
+
+		//progress notification
+		if (progressCb && !nProgress.steps(batch.last - batch.first))
+		{
+			processCanceled = true;
+		}
+	};
+
+	ProcessBatches(m_batches, processBatch, maxThreadCount);
+
+	if (outputNormals)
+	{
+		output.outputCloud->normalsHaveChanged();
+	}
+
+	canceled = processCanceled;
+	return !processCanceled && !error;
+}
+
+bool qM3C2Engine::computeStatistics(const ComparedCloud& cloud,
+									CloudStatistics& stats,
+									int maxThreadCount,
+									bool& canceled,
+									CCLib::GenericProgressCallback* progressCb/*=nullptr*/) const
+{
+	canceled = false;
+
+	if (!m_corePoints || !cloud.octree)
+	{
+		assert(false);
+		return false;
+	}
+	if (m_params.usePrecisionMaps && !cloud.pm.valid())
+	{
+		assert(false);
+		return false;
+	}
+
+	const unsigned corePointCount = m_corePoints->size();
+	try
+	{
+		stats.mean.assign(corePointCount, std::numeric_limits<double>::quiet_NaN());
+		stats.sigma.assign(corePointCount, std::numeric_limits<double>::quiet_NaN());
+		stats.count.assign(corePointCount, 0);
+	}
+	catch (const std::bad_alloc&)
+	{
+		//not enough memory
+		return false;
+	}
+
+	//best level for neighbourhood extraction
+	const unsigned char level = cloud.octree->findBestLevelForAGivenNeighbourhoodSizeExtraction(static_cast<PointCoordinateType>(2.5 * m_params.projectionRadius)); //2.5 = empirical!
+
+	CCLib::NormalizedProgress nProgress(progressCb, static_cast<unsigned>(m_sortedCorePoints.size()));
+	std::atomic<bool> processCanceled(false);
+	std::atomic<bool> error(false);
+
+	//process a batch of core points
+	auto processBatch = [&](const Batch& batch)
+	{
+		if (processCanceled || error)
+		{
+			return;
+		}
+
+		try
+		{
+			std::vector<CoreCylinder> cylinders;
+			GetCylinders(m_corePoints, m_coreNormals, m_sortedCorePoints, batch.first, batch.last, cylinders);
+
+			//the candidates are shared by all the core points of the batch
+			BatchBuffers buffers;
+			ExtractCandidates(*cloud.octree, level, cylinders, m_params.projectionRadius, m_params.projectionDepth, m_params.onlyPositiveSearch, buffers.candidates);
+
+			for (unsigned i = batch.first; i < batch.last; ++i)
+			{
+				const unsigned index = m_sortedCorePoints[i];
+				double mean = 0, sigma = 0;
+				size_t count = ComputeCylinderStats(m_params, cloud, cylinders[i - batch.first], m_params.usePrecisionMaps, buffers, mean, sigma);
+				stats.count[index] = static_cast<unsigned>(count);
+				if (count != 0)
+				{
+					stats.mean[index] = mean;
+					stats.sigma[index] = sigma;
+				}
+			}
+		}
+		catch (const std::bad_alloc&)
+		{
+			//not enough memory
+			error = true;
+			return;
+		}
+
+		//progress notification
+		if (progressCb && !nProgress.steps(batch.last - batch.first))
+		{
+			processCanceled = true;
+		}
+	};
+
+	ProcessBatches(m_batches, processBatch, maxThreadCount);
+
+	canceled = processCanceled;
+	return !processCanceled && !error;
+}
+
+void qM3C2Engine::combineStatistics(const CloudStatistics& stats1,
+									const CloudStatistics& stats2,
+									const Output& output) const
+{
+	if (!output.m3c2DistSF || stats1.count.size() != stats2.count.size())
+	{
+		assert(false);
+		return;
+	}
+
+	const bool computeConfidence = (output.distUncertaintySF || output.sigChangeSF);
+
+	const unsigned corePointCount = static_cast<unsigned>(stats1.count.size());
+	for (unsigned index = 0; index < corePointCount; ++index)
+	{
+		const unsigned n1 = stats1.count[index];
+		const unsigned n2 = stats2.count[index];
+
+		if (n1 != 0 && n2 != 0)
+		{
+			SetDistanceAndConfidence(m_params, stats1.mean[index], stats1.sigma[index], n1, stats2.mean[index], stats2.sigma[index], n2, computeConfidence, output, index);
+		}
+
+		//std. dev. and density of both clouds
+		if (output.stdDevCloud1SF && n1 != 0)
+		{
+			output.stdDevCloud1SF->setValue(index, static_cast<ScalarType>(stats1.sigma[index]));
+		}
+		if (output.densityCloud1SF)
+		{
+			output.densityCloud1SF->setValue(index, static_cast<ScalarType>(n1));
+		}
+		if (output.stdDevCloud2SF && n2 != 0)
+		{
+			output.stdDevCloud2SF->setValue(index, static_cast<ScalarType>(stats2.sigma[index]));
+		}
+		if (output.densityCloud2SF)
+		{
+			output.densityCloud2SF->setValue(index, static_cast<ScalarType>(n2));
+		}
+	}
+}
@@ -0,0 +1,228 @@
+//##########################################################################
+//#                                                                        #
+//#                       CLOUDCOMPARE PLUGIN: qM3C2                       #
+//#                                                                        #
+//#  This program is free software; you can redistribute it and/or modify  #
+//#  it under the terms of the GNU General Public License as published by  #
+//#  the Free Software Foundation; version 2 or later of the License.      #
+//#                                                                        #
+//#  This program is distributed in the hope that it will be useful,       #
+//#  but WITHOUT ANY WARRANTY; without even the implied warranty of        #
+//#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the          #
+//#  GNU General Public License for more details.                          #
+//#                                                                        #
+//#            COPYRIGHT: UNIVERSITE EUROPEENNE DE BRETAGNE                #
+//#                                                                        #
+//##########################################################################
+
+#ifndef Q_M3C2_ENGINE_HEADER
+#define Q_M3C2_ENGINE_HEADER
+
+//Local
+#include "qM3C2Dialog.h"
+
+//qCC_db
+#include <ccOctree.h>
+
+//CCLib
+#include <GenericProgressCallback.h>
+
+//system
+#include <vector>
+
+class ccPointCloud;
+class ccScalarField;
+class NormsIndexesTableType;
+
+//! M3C2 distances computation engine
+/** All the computation state is held by the engine instance, so that several
+	engines can run at the same time (in the same process).
+	The core points are sorted by cell code (see setCorePoints) and processed by
+	batches of close core points: the candidate points of each compared cloud are
+	extracted once per batch (and then filtered by each core point cylinder).
+	The batches are processed in parallel.
+	\warning The compared clouds, their octrees, the core points and the output
+	scalar fields must all fit in memory: there's no tiled (out-of-core) processing,
+	i.e. the epochs can't be loaded and released tile by tile. Only the per-batch
+	working buffers are bounded.
+**/
+class qM3C2Engine
+{
+public:
+
+	//! Precision maps (see "3D uncertainty-based topographic change detection with SfM photogrammetry:
+	//! precision maps for ground control and directly georeferenced surveys" by James et al.)
+	struct PrecisionMaps
+	{
+		PrecisionMaps() : sX(nullptr), sY(nullptr), sZ(nullptr), scale(1.0) {}
+		bool valid() const { return (sX != nullptr && sY != nullptr && sZ != nullptr); }
+		CCLib::ScalarField *sX, *sY, *sZ;
+		double scale;
+	};
+
+	//! Computation parameters
+	struct Parameters
+	{
+		PointCoordinateType projectionRadius = 0;
+		PointCoordinateType projectionDepth = 0;
+		bool useMedian = false;
+		bool progressiveSearch = false;
+		bool onlyPositiveSearch = false;
+		unsigned minPoints4Stats = 3;
+		double registrationRms = 0;
+		//! Whether to use the precision maps (see ComparedCloud) to compute the uncertainty
+		bool usePrecisionMaps = false;
+		//! Max thread count (0 = all)
+		int maxThreadCount = 0;
+	};
+
+	//! Compared cloud
+	struct ComparedCloud
+	{
+		ccOctree::Shared octree;
+		PrecisionMaps pm;
+	};
+
+	//! Output (all the fields but 'm3c2DistSF' are optional)
+	/** The scalar fields must have as many values as core points (and be initialized
+		with their default value).
+	**/
+	struct Output
+	{
+		//! Output cloud (with as many points as core points)
+		/** The points are moved if the export option is PROJECT_ON_CLOUD1 or PROJECT_ON_CLOUD2
+			and the normals are exported if 'exportNormal' is true
+		**/
+		ccPointCloud* outputCloud = nullptr;
+		qM3C2Dialog::ExportOptions exportOption = qM3C2Dialog::PROJECT_ON_CORE_POINTS;
+		bool exportNormal = false;
+
+		ccScalarField* m3c2DistSF = nullptr;		//M3C2 distance
+		ccScalarField* distUncertaintySF = nullptr;	//distance uncertainty
+		ccScalarField* sigChangeSF = nullptr;		//significant change
+		ccScalarField* stdDevCloud1SF = nullptr;	//standard deviation information for cloud #1
+		ccScalarField* stdDevCloud2SF = nullptr;	//standard deviation information for cloud #2
+		ccScalarField* densityCloud1SF = nullptr;	//point density at projection scale for cloud #1
+		ccScalarField* densityCloud2SF = nullptr;	//point density at projection scale for cloud #2
+	};
+
+	//! Default constructor
+	explicit qM3C2Engine(const Parameters& params);
+
+	//! Returns the parameters
+	inline const Parameters& parameters() const { return m_params; }
+
+	//! Sets the core points and their normals
+	/** The core points are sorted by cell code (with a dedicated octree) and split in batches.
+		\param corePoints core points
+		\param coreNormals core points normals (or null for the vertical mode)
+		\param progressCb progress callback (optional)
+		\return success
+	**/
+	bool setCorePoints(	ccPointCloud* corePoints,
+						NormsIndexesTableType* coreNormals,
+						CCLib::GenericProgressCallback* progressCb = nullptr);
+
+	//! Returns the core points
+	inline ccPointCloud* corePoints() const { return m_corePoints; }
+
+	//! Computes the M3C2 distances between two clouds (on the core points)
+	/** The core points must have been set first.
+		\param cloud1 reference cloud
+		\param cloud2 compared cloud
+		\param output output fields
+		\param progressCb progress callback (optional)
+		\return success (see wasCanceled in case of failure)
+	**/
+	bool compute(	const ComparedCloud& cloud1,
+					const ComparedCloud& cloud2,
+					const Output& output,
+					CCLib::GenericProgressCallback* progressCb = nullptr);
+
+	//! Computes the M3C2 distances between two clouds (thread-safe version)
+	/** Same as the method above, except that several calls can run at the same time
+		on the same engine (e.g. to process several pairs of clouds on the same core points).
+		\param cloud1 reference cloud
+		\param cloud2 compared cloud
+		\param output output fields
+		\param maxThreadCount max thread count (overrides the engine parameter, 0 = all)
+		\param canceled whether the process has been canceled
+		\param progressCb progress callback (optional)
+		\return success
+	**/
+	bool compute(	const ComparedCloud& cloud1,
+					const ComparedCloud& cloud2,
+					const Output& output,
+					int maxThreadCount,
+					bool& canceled,
+					CCLib::GenericProgressCallback* progressCb = nullptr) const;
+
+	//! Returns whether the last call to 'compute' has been canceled
+	inline bool wasCanceled() const { return m_canceled; }
+
+	//! Per core point statistics of a cloud (see computeStatistics)
+	struct CloudStatistics
+	{
+		//! Mean (or median) position of the cloud points along each core point normal (NaN if no point)
+		std::vector<double> mean;
+		//! Std. dev. (or interquartile range, or precision maps sigma) of the cloud points along each core point normal (NaN if no point)
+		std::vector<double> sigma;
+		//! Number of cloud points in each core point cylinder
+		std::vector<unsigned> count;
+	};
+
+	//! Computes the per core point statistics of a cloud
+	/** These statistics only depend on the cloud (and the core points), so that they
+		can be computed once per epoch of a time series and then combined for each pair
+		of epochs (see combineStatistics). The sigma values are the precision maps ones
+		if Parameters::usePrecisionMaps is true.
+		\param cloud cloud
+		\param stats output statistics (indexed as the core points)
+		\param maxThreadCount max thread count (overrides the engine parameter, 0 = all)
+		\param canceled whether the process has been canceled
+		\param progressCb progress callback (optional)
+		\return success
+	**/
+	bool computeStatistics(	const ComparedCloud& cloud,
+							CloudStatistics& stats,
+							int maxThreadCount,
+							bool& canceled,
+							CCLib::GenericProgressCallback* progressCb = nullptr) const;
+
+	//! Computes the M3C2 distances from the statistics of two clouds
+	/** Gives the same distance, uncertainty, significance, std. dev. and density
+		values as 'compute'. The output cloud and the output normals are ignored.
+		\param stats1 statistics of the reference cloud
+		\param stats2 statistics of the compared cloud
+		\param output output fields
+	**/
+	void combineStatistics(	const CloudStatistics& stats1,
+							const CloudStatistics& stats2,
+							const Output& output) const;
+
+protected:
+
+	//! Range of (sorted) core points processed at once
+	struct Batch
+	{
+		unsigned first;
+		unsigned last;
+	};
+
+	//! Parameters
+	Parameters m_params;
+
+	//! Core points
+	ccPointCloud* m_corePoints;
+	//! Core points normals
+	NormsIndexesTableType* m_coreNormals;
+	//! Core points indexes (sorted by cell code)
+	std::vector<unsigned> m_sortedCorePoints;
+	//! Batches of core points
+	std::vector<Batch> m_batches;
+
+	//! Whether the last process has been canceled
+	bool m_canceled;
+};
+
+#endif //Q_M3C2_ENGINE_HEADER
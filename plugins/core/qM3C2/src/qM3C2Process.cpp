@@ -18,6 +18,7 @@
 #include "qM3C2Process.h"
 
 //local
+#include "qM3C2Engine.h"
 #include "qM3C2Tools.h"
 #include "qM3C2Dialog.h"
 #include "qM3C2DisclaimerDialog.h"
@@ -40,8 +41,15 @@
 #include <QtCore>
 #include <QApplication>
 #include <QElapsedTimer>
-#include <QtConcurrentMap>
+#include <QFutureSynchronizer>
 #include <QMessageBox>
+#include <QThread>
+#include <QtConcurrentRun>
+
+//system
+#include <algorithm>
+#include <memory>
+#include <vector>
 
 //! Default name for M3C2 scalar fields
 static const char M3C2_DIST_SF_NAME[]			= "M3C2 distance";
@@ -65,513 +73,99 @@ static void RemoveScalarField(ccPointCloud* cloud, const char sfName[])
 static ScalarType SCALAR_ZERO = 0;
 static ScalarType SCALAR_ONE = 1;
 
-// Precision maps (See "3D uncertainty-based topographic change detection with SfM photogrammetry: precision maps for ground control and directly georeferenced surveys" by James et al.)
-struct PrecisionMaps
-{
-	PrecisionMaps() : sX(nullptr), sY(nullptr), sZ(nullptr), scale(1.0) {}
-	bool valid() const { return (sX != nullptr && sY != nullptr && sZ != nullptr); }
-	CCLib::ScalarField *sX, *sY, *sZ;
-	double scale;
-};
-
-// Computes the uncertainty based on 'precision maps' (as scattered scalar fields)
-static double ComputePMUncertainty(CCLib::DgmOctree::NeighboursSet& set, const CCVector3& N, const PrecisionMaps& PM)
+//! Reads the M3C2 engine parameters from the dialog (except the precision maps)
+static void GetEngineParameters(const qM3C2Dialog& dlg, qM3C2Engine::Parameters& params)
 {
-	size_t count = set.size();
-	if (count == 0)
-	{
-		assert(false);
-		return 0;
-	}
-	
-	int minIndex = -1;
-	if (count == 1)
-	{
-		minIndex = 0;
-	}
-	else
-	{
-		//compute gravity center
-		CCVector3d G(0, 0, 0);
-		for (size_t i = 0; i < count; ++i)
-		{
-			G.x += set[i].point->x;
-			G.y += set[i].point->y;
-			G.z += set[i].point->z;
-		}
-
-		G.x /= count;
-		G.y /= count;
-		G.z /= count;
-
-		//now look for the point that is the closest to the gravity center
-		double minSquareDist = -1.0;
-		minIndex = -1;
-		for (size_t i = 0; i < count; ++i)
-		{
-			CCVector3d dG(	G.x - set[i].point->x,
-							G.y - set[i].point->y,
-							G.z - set[i].point->z );
-			double squareDist = dG.norm2();
-			if (minIndex < 0 || squareDist < minSquareDist)
-			{
-				minSquareDist = squareDist;
-				minIndex = static_cast<int>(i);
-			}
-		}
-	}
-	
-	assert(minIndex >= 0);
-	unsigned pointIndex = set[minIndex].pointIndex;
-	CCVector3d sigma(	PM.sX->getValue(pointIndex) * PM.scale,
-						PM.sY->getValue(pointIndex) * PM.scale,
-						PM.sZ->getValue(pointIndex) * PM.scale);
-
-	CCVector3d NS(	N.x * sigma.x,
-					N.y * sigma.y,
-					N.z * sigma.z);
-	
-	return NS.norm();
+	double projectionScale = dlg.cylDiameterDoubleSpinBox->value();
+	params.projectionRadius = static_cast<PointCoordinateType>(projectionScale / 2); //we want the radius in fact ;)
+	params.projectionDepth = static_cast<PointCoordinateType>(dlg.cylHalfHeightDoubleSpinBox->value());
+	params.registrationRms = dlg.rmsCheckBox->isChecked() ? dlg.rmsDoubleSpinBox->value() : 0.0;
+	params.useMedian = dlg.useMedianCheckBox->isChecked();
+	params.minPoints4Stats = dlg.getMinPointsForStats();
+	params.progressiveSearch = !dlg.useSinglePass4DepthCheckBox->isChecked();
+	params.onlyPositiveSearch = dlg.positiveSearchOnlyCheckBox->isChecked();
+	params.maxThreadCount = dlg.getMaxThreadCount();
 }
 
-// Structure for parallel call to ComputeM3C2DistForPoint
-struct M3C2Params
-{
-	//input data
-	ccPointCloud* outputCloud = nullptr;
-	ccPointCloud* corePoints = nullptr;
-	NormsIndexesTableType* coreNormals = nullptr;
-
-	//main options
-	PointCoordinateType projectionRadius = 0;
-	PointCoordinateType projectionDepth = 0;
-	bool updateNormal = false;
-	bool exportNormal = false;
-	bool useMedian = false;
-	bool computeConfidence = false;
-	bool progressiveSearch = false;
-	bool onlyPositiveSearch = false;
-	unsigned minPoints4Stats = 3;
-	double registrationRms = 0;
-
-	//export
-	qM3C2Dialog::ExportOptions exportOption;
-	bool keepOriginalCloud = false;
-
-	//octrees
-	ccOctree::Shared cloud1Octree;
-	unsigned char level1 = 0;
-	ccOctree::Shared cloud2Octree;
-	unsigned char level2 = 0;
-
-	//scalar fields
-	ccScalarField* m3c2DistSF = nullptr;		//M3C2 distance
-	ccScalarField* distUncertaintySF = nullptr;	//distance uncertainty
-	ccScalarField* sigChangeSF = nullptr;		//significant change
-	ccScalarField* stdDevCloud1SF = nullptr;	//standard deviation information for cloud #1
-	ccScalarField* stdDevCloud2SF = nullptr;	//standard deviation information for cloud #2
-	ccScalarField* densityCloud1SF = nullptr;	//export point density at projection scale for cloud #1
-	ccScalarField* densityCloud2SF = nullptr;	//export point density at projection scale for cloud #2
-
-	//precision maps
-	PrecisionMaps cloud1PM, cloud2PM;
-	bool usePrecisionMaps = false;
-
-	//progress notification
-	CCLib::NormalizedProgress* nProgress = nullptr;
-	bool processCanceled = false;
-};
-static M3C2Params s_M3C2Params;
-
-void ComputeM3C2DistForPoint(unsigned index)
+//! Returns the octree of a cloud (computes it if necessary)
+static ccOctree::Shared GetOctree(ccPointCloud* cloud, ccProgressDialog& pDlg, ccMainAppInterface* app)
 {
-	if (s_M3C2Params.processCanceled)
-		return;
-
-	ScalarType dist = NAN_VALUE;
-
-	//get core point #i
-	CCVector3 P;
-	s_M3C2Params.corePoints->getPoint(index, P);
-
-	//get core point's normal #i
-	CCVector3 N(0, 0, 1);
-	if (s_M3C2Params.updateNormal) //i.e. all cases but the VERTICAL mode
-	{
-		N = ccNormalVectors::GetNormal(s_M3C2Params.coreNormals->getValue(index));
-	}
-
-	//output point
-	CCVector3 outputP = P;
-
-	//compute M3C2 distance
+	ccOctree::Shared octree = cloud->getOctree();
+	if (!octree)
 	{
-		double mean1 = 0, stdDev1 = 0;
-		bool validStats1 = false;
-
-		//extract cloud #1's neighbourhood
-		CCLib::DgmOctree::ProgressiveCylindricalNeighbourhood cn1;
-		cn1.center = P;
-		cn1.dir = N;
-		cn1.level = s_M3C2Params.level1;
-		cn1.maxHalfLength = s_M3C2Params.projectionDepth;
-		cn1.radius = s_M3C2Params.projectionRadius;
-		cn1.onlyPositiveDir = s_M3C2Params.onlyPositiveSearch;
-
-		if (s_M3C2Params.progressiveSearch)
-		{
-			//progressive search
-			size_t previousNeighbourCount = 0;
-			while (cn1.currentHalfLength < cn1.maxHalfLength)
-			{
-				size_t neighbourCount = s_M3C2Params.cloud1Octree->getPointsInCylindricalNeighbourhoodProgressive(cn1);
-				if (neighbourCount != previousNeighbourCount)
-				{
-					//do we have enough points for computing stats?
-					if (neighbourCount >= s_M3C2Params.minPoints4Stats)
-					{
-						qM3C2Tools::ComputeStatistics(cn1.neighbours, s_M3C2Params.useMedian, mean1, stdDev1);
-						validStats1 = true;
-						//do we have a sharp enough 'mean' to stop?
-						if (fabs(mean1) + 2 * stdDev1 < static_cast<double>(cn1.currentHalfLength))
-							break;
-					}
-					previousNeighbourCount = neighbourCount;
-				}
-			}
-		}
-		else
-		{
-			s_M3C2Params.cloud1Octree->getPointsInCylindricalNeighbourhood(cn1);
-		}
-		
-		size_t n1 = cn1.neighbours.size();
-		if (n1 != 0)
-		{
-			//compute stat. dispersion on cloud #1 neighbours (if necessary)
-			if (!validStats1)
-			{
-				qM3C2Tools::ComputeStatistics(cn1.neighbours, s_M3C2Params.useMedian, mean1, stdDev1);
-			}
-
-			if (s_M3C2Params.usePrecisionMaps && (s_M3C2Params.computeConfidence || s_M3C2Params.stdDevCloud1SF))
-			{
-				//compute the Precision Maps derived sigma
-				stdDev1 = ComputePMUncertainty(cn1.neighbours, N, s_M3C2Params.cloud1PM);
-			}
-
-			if (s_M3C2Params.exportOption == qM3C2Dialog::PROJECT_ON_CLOUD1)
-			{
-				//shift output point on the 1st cloud
-				outputP += static_cast<PointCoordinateType>(mean1) * N;
-			}
-
-			//save cloud #1's std. dev.
-			if (s_M3C2Params.stdDevCloud1SF)
-			{
-				ScalarType val = static_cast<ScalarType>(stdDev1);
-				s_M3C2Params.stdDevCloud1SF->setValue(index, val);
-			}
-		}
-
-		//save cloud #1's density
-		if (s_M3C2Params.densityCloud1SF)
+		octree = cloud->computeOctree(&pDlg);
+		if (octree && cloud->getParent() && app)
 		{
-			ScalarType val = static_cast<ScalarType>(n1);
-			s_M3C2Params.densityCloud1SF->setValue(index, val);
-		}
-
-		//now we can process cloud #2
-		if (	n1 != 0
-			||	s_M3C2Params.exportOption == qM3C2Dialog::PROJECT_ON_CLOUD2
-			||	s_M3C2Params.stdDevCloud2SF
-			||	s_M3C2Params.densityCloud2SF
-			)
-		{
-			double mean2 = 0, stdDev2 = 0;
-			bool validStats2 = false;
-			
-			//extract cloud #2's neighbourhood
-			CCLib::DgmOctree::ProgressiveCylindricalNeighbourhood cn2;
-			cn2.center = P;
-			cn2.dir = N;
-			cn2.level = s_M3C2Params.level2;
-			cn2.maxHalfLength = s_M3C2Params.projectionDepth;
-			cn2.radius = s_M3C2Params.projectionRadius;
-			cn2.onlyPositiveDir = s_M3C2Params.onlyPositiveSearch;
-
-			if (s_M3C2Params.progressiveSearch)
-			{
-				//progressive search
-				size_t previousNeighbourCount = 0;
-				while (cn2.currentHalfLength < cn2.maxHalfLength)
-				{
-					size_t neighbourCount = s_M3C2Params.cloud2Octree->getPointsInCylindricalNeighbourhoodProgressive(cn2);
-					if (neighbourCount != previousNeighbourCount)
-					{
-						//do we have enough points for computing stats?
-						if (neighbourCount >= s_M3C2Params.minPoints4Stats)
-						{
-							qM3C2Tools::ComputeStatistics(cn2.neighbours, s_M3C2Params.useMedian, mean2, stdDev2);
-							validStats2 = true;
-							//do we have a sharp enough 'mean' to stop?
-							if (fabs(mean2) + 2 * stdDev2 < static_cast<double>(cn2.currentHalfLength))
-								break;
-						}
-						previousNeighbourCount = neighbourCount;
-					}
-				}
-			}
-			else
-			{
-				s_M3C2Params.cloud2Octree->getPointsInCylindricalNeighbourhood(cn2);
-			}
-
-			size_t n2 = cn2.neighbours.size();
-			if (n2 != 0)
-			{
-				//compute stat. dispersion on cloud #2 neighbours (if necessary)
-				if (!validStats2)
-				{
-					qM3C2Tools::ComputeStatistics(cn2.neighbours, s_M3C2Params.useMedian, mean2, stdDev2);
-				}
-				assert(stdDev2 != stdDev2 || stdDev2 >= 0); //first inequality fails if stdDev2 is NaN ;)
-
-				if (s_M3C2Params.exportOption == qM3C2Dialog::PROJECT_ON_CLOUD2)
-				{
-					//shift output point on the 2nd cloud
-					outputP += static_cast<PointCoordinateType>(mean2) * N;
-				}
-
-				if (s_M3C2Params.usePrecisionMaps && (s_M3C2Params.computeConfidence || s_M3C2Params.stdDevCloud2SF))
-				{
-					//compute the Precision Maps derived sigma
-					stdDev2 = ComputePMUncertainty(cn2.neighbours, N, s_M3C2Params.cloud2PM);
-				}
-
-				if (n1 != 0)
-				{
-					//m3c2 dist = distance between i1 and i2 (i.e. either the mean or the median of both neighborhoods)
-					dist = static_cast<ScalarType>(mean2 - mean1);
-					s_M3C2Params.m3c2DistSF->setValue(index, dist);
-
-					//confidence interval
-					if (s_M3C2Params.computeConfidence)
-					{
-						ScalarType LODStdDev = NAN_VALUE;
-						if (s_M3C2Params.usePrecisionMaps)
-						{
-							LODStdDev = stdDev1*stdDev1 + stdDev2*stdDev2; //equation (2) in M3C2-PM article
-						}
-						//standard M3C2 algortihm: have we enough points for computing the confidence interval?
-						else if (n1 >= s_M3C2Params.minPoints4Stats && n2 >= s_M3C2Params.minPoints4Stats)
-						{
-							LODStdDev = (stdDev1*stdDev1) / n1 + (stdDev2*stdDev2) / n2;
-						}
-
-						if (!std::isnan(LODStdDev))
-						{
-							//distance uncertainty (see eq. (1) in M3C2 article)
-							ScalarType LOD = static_cast<ScalarType>(1.96 * (sqrt(LODStdDev) + s_M3C2Params.registrationRms));
-
-							if (s_M3C2Params.distUncertaintySF)
-							{
-								s_M3C2Params.distUncertaintySF->setValue(index, LOD);
-							}
-
-							if (s_M3C2Params.sigChangeSF)
-							{
-								bool significant = (dist < -LOD || dist > LOD);
-								if (significant)
-								{
-									s_M3C2Params.sigChangeSF->setValue(index, SCALAR_ONE); //already equal to SCALAR_ZERO otherwise
-								}
-							}
-						}
-						//else //DGM: scalar fields have already been initialized with the right 'default' values
-						//{
-						//	if (distUncertaintySF)
-						//		distUncertaintySF->setValue(index, NAN_VALUE);
-						//	if (sigChangeSF)
-						//		sigChangeSF->setValue(index, SCALAR_ZERO);
-						//}
-					}
-				}
-
-				//save cloud #2's std. dev.
-				if (s_M3C2Params.stdDevCloud2SF)
-				{
-					ScalarType val = static_cast<ScalarType>(stdDev2);
-					s_M3C2Params.stdDevCloud2SF->setValue(index, val);
-				}
-			}
-
-			//save cloud #2's density
-			if (s_M3C2Params.densityCloud2SF)
-			{
-				ScalarType val = static_cast<ScalarType>(n2);
-				s_M3C2Params.densityCloud2SF->setValue(index, val);
-			}
+			app->addToDB(cloud->getOctreeProxy());
 		}
 	}
-
-	//output point
-	if (s_M3C2Params.outputCloud != s_M3C2Params.corePoints)
-	{
-		*const_cast<CCVector3*>(s_M3C2Params.outputCloud->getPoint(index)) = outputP;
-	}
-	if (s_M3C2Params.exportNormal)
-	{
-		s_M3C2Params.outputCloud->setPointNormal(index, N);
-	}
-
-	//progress notification
-	if (s_M3C2Params.nProgress && !s_M3C2Params.nProgress->oneStep())
-	{
-		s_M3C2Params.processCanceled = true;
-	}
+	return octree;
 }
 
-bool qM3C2Process::Compute(const qM3C2Dialog& dlg, QString& errorMessage, ccPointCloud*& outputCloud, bool allowDialogs, QWidget* parentWidget/*=nullptr*/, ccMainAppInterface* app/*=nullptr*/)
+//! Computes (or retrieves) the core points and their normals
+/** \param dlg M3C2 dialog (parameters)
+	\param cloud1 cloud #1
+	\param octree1 cloud #1's octree
+	\param maxThreadCount max thread count
+	\param corePoints core points (input, or output if they have to be sub-sampled)
+	\param coreNormals core points normals (output, or null in vertical mode)
+	\param normalScaleSF normal scale (output, multi-scale mode only)
+	\param corePointsHaveBeenSubsampled whether the core points have been sub-sampled (output)
+	\param outputName output cloud name (to be completed)
+	\param errorMessage error message (in case of failure)
+	\param pDlg progress dialog
+	\param app main application interface (optional)
+	\return success
+**/
+static bool ComputeCorePointsAndNormals(const qM3C2Dialog& dlg,
+										ccPointCloud* cloud1,
+										ccOctree::Shared octree1,
+										int maxThreadCount,
+										ccPointCloud*& corePoints,
+										NormsIndexesTableType*& coreNormals,
+										ccScalarField*& normalScaleSF,
+										bool& corePointsHaveBeenSubsampled,
+										QString& outputName,
+										QString& errorMessage,
+										ccProgressDialog& pDlg,
+										ccMainAppInterface* app)
 {
-	errorMessage.clear();
-	outputCloud = nullptr;
-
-	//get the clouds in the right order
-	ccPointCloud* cloud1 = dlg.getCloud1();
-	ccPointCloud* cloud2 = dlg.getCloud2();
-
-	if (!cloud1 || !cloud2)
-	{
-		assert(false);
-		return false;
-	}
-
 	//normals computation parameters
 	double normalScale = dlg.normalScaleDoubleSpinBox->value();
-	double projectionScale = dlg.cylDiameterDoubleSpinBox->value();
 	qM3C2Normals::ComputationMode normMode = dlg.getNormalsComputationMode();
 	double samplingDist = dlg.cpSubsamplingDoubleSpinBox->value();
-	ccScalarField* normalScaleSF = 0; //normal scale (multi-scale mode only)
-
-	//other parameters are stored in 's_M3C2Params' for parallel call
-	s_M3C2Params = M3C2Params();
-	s_M3C2Params.projectionRadius = static_cast<PointCoordinateType>(projectionScale / 2); //we want the radius in fact ;)
-	s_M3C2Params.projectionDepth = static_cast<PointCoordinateType>(dlg.cylHalfHeightDoubleSpinBox->value());
-	s_M3C2Params.corePoints = dlg.getCorePointsCloud();
-	s_M3C2Params.registrationRms = dlg.rmsCheckBox->isChecked() ? dlg.rmsDoubleSpinBox->value() : 0.0;
-	s_M3C2Params.exportOption = dlg.getExportOption();
-	s_M3C2Params.keepOriginalCloud = dlg.keepOriginalCloud();
-	s_M3C2Params.useMedian = dlg.useMedianCheckBox->isChecked();
-	s_M3C2Params.minPoints4Stats = dlg.getMinPointsForStats();
-	s_M3C2Params.progressiveSearch = !dlg.useSinglePass4DepthCheckBox->isChecked();
-	s_M3C2Params.onlyPositiveSearch = dlg.positiveSearchOnlyCheckBox->isChecked();
-
-	//precision maps
-	{
-		s_M3C2Params.usePrecisionMaps = dlg.precisionMapsGroupBox->isEnabled() && dlg.precisionMapsGroupBox->isChecked();
-		if (s_M3C2Params.usePrecisionMaps)
-		{
-			if (allowDialogs && QMessageBox::question(parentWidget, "Precision Maps", "Are you sure you want to compute the M3C2 distances with precision maps?", QMessageBox::Yes, QMessageBox::No) == QMessageBox::No)
-			{
-				s_M3C2Params.usePrecisionMaps = false;
-				dlg.precisionMapsGroupBox->setChecked(false);
-			}
-		}
-		if (s_M3C2Params.usePrecisionMaps)
-		{
-			s_M3C2Params.cloud1PM.sX = cloud1->getScalarField(dlg.c1SxComboBox->currentIndex());
-			s_M3C2Params.cloud1PM.sY = cloud1->getScalarField(dlg.c1SyComboBox->currentIndex());
-			s_M3C2Params.cloud1PM.sZ = cloud1->getScalarField(dlg.c1SzComboBox->currentIndex());
-			s_M3C2Params.cloud1PM.scale = dlg.pm1ScaleDoubleSpinBox->value();
-
-			s_M3C2Params.cloud2PM.sX = cloud2->getScalarField(dlg.c2SxComboBox->currentIndex());
-			s_M3C2Params.cloud2PM.sY = cloud2->getScalarField(dlg.c2SyComboBox->currentIndex());
-			s_M3C2Params.cloud2PM.sZ = cloud2->getScalarField(dlg.c2SzComboBox->currentIndex());
-			s_M3C2Params.cloud2PM.scale = dlg.pm2ScaleDoubleSpinBox->value();
-
-			if (!s_M3C2Params.cloud1PM.valid() || !s_M3C2Params.cloud2PM.valid())
-			{
-				errorMessage = "Invalid 'Precision maps' settings!";
-				return false;
-			}
-		}
-	}
-
-
-	//max thread count
-	int maxThreadCount = dlg.getMaxThreadCount();
-
-	//progress dialog
-	ccProgressDialog pDlg(parentWidget);
-
-	//Duration: initialization & normals computation
-	QElapsedTimer initTimer;
-	initTimer.start();
-
-	//compute octree(s) if necessary
-	s_M3C2Params.cloud1Octree = cloud1->getOctree();
-	if (!s_M3C2Params.cloud1Octree)
-	{
-		s_M3C2Params.cloud1Octree = cloud1->computeOctree(&pDlg);
-		if (s_M3C2Params.cloud1Octree && cloud1->getParent() && app)
-		{
-			app->addToDB(cloud1->getOctreeProxy());
-		}
-	}
-	if (!s_M3C2Params.cloud1Octree)
-	{
-		errorMessage = "Failed to compute cloud #1's octree!";
-		return false;
-	}
-
-	s_M3C2Params.cloud2Octree = cloud2->getOctree();
-	if (!s_M3C2Params.cloud2Octree)
-	{
-		s_M3C2Params.cloud2Octree = cloud2->computeOctree(&pDlg);
-		if (s_M3C2Params.cloud2Octree && cloud2->getParent() && app)
-		{
-			app->addToDB(cloud2->getOctreeProxy());
-		}
-	}
-	if (!s_M3C2Params.cloud2Octree)
-	{
-		errorMessage = "Failed to compute cloud #2's octree!";
-		return false;
-	}
 
-	//start the job
 	bool error = false;
 
 	//should we generate the core points?
-	bool corePointsHaveBeenSubsampled = false;
-	if (!s_M3C2Params.corePoints && samplingDist > 0)
+	corePointsHaveBeenSubsampled = false;
+	if (!corePoints && samplingDist > 0)
 	{
 		CCLib::CloudSamplingTools::SFModulationParams modParams(false);
 		CCLib::ReferenceCloud* subsampled = CCLib::CloudSamplingTools::resampleCloudSpatially(cloud1,
 			static_cast<PointCoordinateType>(samplingDist),
 			modParams,
-			s_M3C2Params.cloud1Octree.data(),
+			octree1.data(),
 			&pDlg);
 
 		if (subsampled)
 		{
-			s_M3C2Params.corePoints = static_cast<ccPointCloud*>(cloud1)->partialClone(subsampled);
+			corePoints = static_cast<ccPointCloud*>(cloud1)->partialClone(subsampled);
 
 			//don't need those references anymore
 			delete subsampled;
 			subsampled = 0;
 		}
 
-		if (s_M3C2Params.corePoints)
+		if (corePoints)
 		{
-			s_M3C2Params.corePoints->setName(QString("%1.subsampled [min dist. = %2]").arg(cloud1->getName()).arg(samplingDist));
-			s_M3C2Params.corePoints->setVisible(true);
-			s_M3C2Params.corePoints->setDisplay(cloud1->getDisplay());
+			corePoints->setName(QString("%1.subsampled [min dist. = %2]").arg(cloud1->getName()).arg(samplingDist));
+			corePoints->setVisible(true);
+			corePoints->setDisplay(cloud1->getDisplay());
 			if (app)
 			{
-				app->dispToConsole(QString("[M3C2] Sub-sampled cloud has been saved ('%1')").arg(s_M3C2Params.corePoints->getName()), ccMainAppInterface::STD_CONSOLE_MESSAGE);
-				app->addToDB(s_M3C2Params.corePoints);
+				app->dispToConsole(QString("[M3C2] Sub-sampled cloud has been saved ('%1')").arg(corePoints->getName()), ccMainAppInterface::STD_CONSOLE_MESSAGE);
+				app->addToDB(corePoints);
 			}
 			corePointsHaveBeenSubsampled = true;
 		}
@@ -582,30 +176,12 @@ bool qM3C2Process::Compute(const qM3C2Dialog& dlg, QString& errorMessage, ccPoin
 		}
 	}
 
-	//output
-	QString outputName(s_M3C2Params.usePrecisionMaps ? "M3C2-PM output" : "M3C2 output");
-
 	if (!error)
 	{
 		//whatever the case, at this point we should have core points
-		assert(s_M3C2Params.corePoints);
+		assert(corePoints);
 		if (app)
-			app->dispToConsole(QString("[M3C2] Core points: %1").arg(s_M3C2Params.corePoints->size()), ccMainAppInterface::STD_CONSOLE_MESSAGE);
-
-		if (s_M3C2Params.keepOriginalCloud)
-		{
-			s_M3C2Params.outputCloud = s_M3C2Params.corePoints;
-		}
-		else
-		{
-			s_M3C2Params.outputCloud = new ccPointCloud(/*outputName*/); //setName will be called at the end
-			if (!s_M3C2Params.outputCloud->resize(s_M3C2Params.corePoints->size())) //resize as we will 'set' the new points positions in 'ComputeM3C2DistForPoint'
-			{
-				errorMessage = "Not enough memory!";
-				error = true;
-			}
-			s_M3C2Params.corePoints->setEnabled(false); //we can hide the core points
-		}
+			app->dispToConsole(QString("[M3C2] Core points: %1").arg(corePoints->size()), ccMainAppInterface::STD_CONSOLE_MESSAGE);
 	}
 
 	//compute normals
@@ -621,8 +197,8 @@ bool qM3C2Process::Compute(const qM3C2Dialog& dlg, QString& errorMessage, ccPoin
 		case qM3C2Normals::DEFAULT_MODE:
 		case qM3C2Normals::MULTI_SCALE_MODE:
 		{
-			s_M3C2Params.coreNormals = new NormsIndexesTableType();
-			s_M3C2Params.coreNormals->link(); //will be released anyway at the end of the process
+			coreNormals = new NormsIndexesTableType();
+			coreNormals->link(); //will be released anyway at the end of the process
 
 			std::vector<PointCoordinateType> radii;
 			if (normMode == qM3C2Normals::MULTI_SCALE_MODE)
@@ -651,12 +227,12 @@ bool qM3C2Process::Compute(const qM3C2Dialog& dlg, QString& errorMessage, ccPoin
 			}
 
 			bool invalidNormals = false;
-			ccPointCloud* baseCloud = (useCorePointsOnly ? s_M3C2Params.corePoints : cloud1);
-			ccOctree* baseOctree = (baseCloud == cloud1 ? s_M3C2Params.cloud1Octree.data() : 0);
+			ccPointCloud* baseCloud = (useCorePointsOnly ? corePoints : cloud1);
+			ccOctree* baseOctree = (baseCloud == cloud1 ? octree1.data() : 0);
 
 			//dedicated core points method
-			normalsAreOk = qM3C2Normals::ComputeCorePointsNormals(s_M3C2Params.corePoints,
-				s_M3C2Params.coreNormals,
+			normalsAreOk = qM3C2Normals::ComputeCorePointsNormals(corePoints,
+				coreNormals,
 				baseCloud,
 				radii,
 				invalidNormals,
@@ -677,7 +253,7 @@ bool qM3C2Process::Compute(const qM3C2Dialog& dlg, QString& errorMessage, ccPoin
 				//make normals horizontal if necessary
 				if (normMode == qM3C2Normals::HORIZ_MODE)
 				{
-					qM3C2Normals::MakeNormalsHorizontal(*s_M3C2Params.coreNormals);
+					qM3C2Normals::MakeNormalsHorizontal(*coreNormals);
 				}
 
 				//then either use a simple heuristic
@@ -686,8 +262,8 @@ bool qM3C2Process::Compute(const qM3C2Dialog& dlg, QString& errorMessage, ccPoin
 				{
 					int preferredOrientation = dlg.normOriPreferredComboBox->currentIndex();
 					assert(preferredOrientation >= ccNormalVectors::MINUS_X && preferredOrientation <= ccNormalVectors::PLUS_ZERO);
-					if (!ccNormalVectors::UpdateNormalOrientations(s_M3C2Params.corePoints,
-						*s_M3C2Params.coreNormals,
+					if (!ccNormalVectors::UpdateNormalOrientations(corePoints,
+						*coreNormals,
 						static_cast<ccNormalVectors::Orientation>(preferredOrientation)))
 					{
 						errorMessage = "[M3C2] Failed to re-orient the normals (invalid parameter?)";
@@ -699,8 +275,8 @@ bool qM3C2Process::Compute(const qM3C2Dialog& dlg, QString& errorMessage, ccPoin
 					ccPointCloud* orientationCloud = dlg.getNormalsOrientationCloud();
 					assert(orientationCloud);
 
-					if (!qM3C2Normals::UpdateNormalOrientationsWithCloud(s_M3C2Params.corePoints,
-						*s_M3C2Params.coreNormals,
+					if (!qM3C2Normals::UpdateNormalOrientationsWithCloud(corePoints,
+						*coreNormals,
 						orientationCloud,
 						maxThreadCount,
 						&pDlg))
@@ -710,11 +286,6 @@ bool qM3C2Process::Compute(const qM3C2Dialog& dlg, QString& errorMessage, ccPoin
 					}
 				}
 
-				if (!error && s_M3C2Params.coreNormals)
-				{
-					s_M3C2Params.outputCloud->setNormsTable(s_M3C2Params.coreNormals);
-					s_M3C2Params.outputCloud->showNormals(true);
-				}
 			}
 		}
 		break;
@@ -722,10 +293,10 @@ bool qM3C2Process::Compute(const qM3C2Dialog& dlg, QString& errorMessage, ccPoin
 		case qM3C2Normals::USE_CLOUD1_NORMALS:
 		{
 			outputName += QString(" scale=%1").arg(normalScale);
-			ccPointCloud* sourceCloud = (corePointsHaveBeenSubsampled ? s_M3C2Params.corePoints : cloud1);
-			s_M3C2Params.coreNormals = sourceCloud->normals();
-			normalsAreOk = (s_M3C2Params.coreNormals && s_M3C2Params.coreNormals->currentSize() == sourceCloud->size());
-			s_M3C2Params.coreNormals->link(); //will be released anyway at the end of the process
+			ccPointCloud* sourceCloud = (corePointsHaveBeenSubsampled ? corePoints : cloud1);
+			coreNormals = sourceCloud->normals();
+			normalsAreOk = (coreNormals && coreNormals->currentSize() == sourceCloud->size());
+			coreNormals->link(); //will be released anyway at the end of the process
 
 			//DGM TODO: should we export the normals to the output cloud?
 		}
@@ -733,11 +304,11 @@ bool qM3C2Process::Compute(const qM3C2Dialog& dlg, QString& errorMessage, ccPoin
 
 		case qM3C2Normals::USE_CORE_POINTS_NORMALS:
 		{
-			normalsAreOk = s_M3C2Params.corePoints && s_M3C2Params.corePoints->hasNormals();
+			normalsAreOk = corePoints && corePoints->hasNormals();
 			if (normalsAreOk)
 			{
-				s_M3C2Params.coreNormals = s_M3C2Params.corePoints->normals();
-				s_M3C2Params.coreNormals->link(); //will be released anyway at the end of the process
+				coreNormals = corePoints->normals();
+				coreNormals->link(); //will be released anyway at the end of the process
 			}
 		}
 		break;
@@ -760,13 +331,13 @@ bool qM3C2Process::Compute(const qM3C2Dialog& dlg, QString& errorMessage, ccPoin
 		}
 	}
 
-	if (!error && s_M3C2Params.coreNormals && corePointsHaveBeenSubsampled)
+	if (!error && coreNormals && corePointsHaveBeenSubsampled)
 	{
-		if (s_M3C2Params.corePoints->hasNormals() || s_M3C2Params.corePoints->resizeTheNormsTable())
+		if (corePoints->hasNormals() || corePoints->resizeTheNormsTable())
 		{
-			for (unsigned i = 0; i < s_M3C2Params.coreNormals->currentSize(); ++i)
-				s_M3C2Params.corePoints->setPointNormalIndex(i, s_M3C2Params.coreNormals->getValue(i));
-			s_M3C2Params.corePoints->showNormals(true);
+			for (unsigned i = 0; i < coreNormals->currentSize(); ++i)
+				corePoints->setPointNormalIndex(i, coreNormals->getValue(i));
+			corePoints->showNormals(true);
 		}
 		else if (app)
 		{
@@ -774,188 +345,287 @@ bool qM3C2Process::Compute(const qM3C2Dialog& dlg, QString& errorMessage, ccPoin
 		}
 	}
 
-	qint64 initTime_ms = initTimer.elapsed();
+	return !error;
+}
 
-	while (!error) //fake loop for easy break
+bool qM3C2Process::Compute(const qM3C2Dialog& dlg, QString& errorMessage, ccPointCloud*& outputCloud, bool allowDialogs, QWidget* parentWidget/*=nullptr*/, ccMainAppInterface* app/*=nullptr*/)
+{
+	errorMessage.clear();
+	outputCloud = nullptr;
+
+	//get the clouds in the right order
+	ccPointCloud* cloud1 = dlg.getCloud1();
+	ccPointCloud* cloud2 = dlg.getCloud2();
+
+	if (!cloud1 || !cloud2)
 	{
-		//we display init. timing only if no error occurred!
-		if (app)
-			app->dispToConsole(QString("[M3C2] Initialization & normal computation: %1 s.").arg(initTime_ms / 1000.0, 0, 'f', 3), ccMainAppInterface::STD_CONSOLE_MESSAGE);
+		assert(false);
+		return false;
+	}
 
-		QElapsedTimer distCompTimer;
-		distCompTimer.start();
+	qM3C2Normals::ComputationMode normMode = dlg.getNormalsComputationMode();
+	ccScalarField* normalScaleSF = 0; //normal scale (multi-scale mode only)
 
-		//we are either in vertical mode or we have as many normals as core points
-		unsigned corePointCount = s_M3C2Params.corePoints->size();
-		assert(normMode == qM3C2Normals::VERT_MODE || (s_M3C2Params.coreNormals && corePointCount == s_M3C2Params.coreNormals->currentSize()));
+	//M3C2 parameters
+	qM3C2Engine::Parameters params;
+	qM3C2Engine::ComparedCloud compared1;
+	qM3C2Engine::ComparedCloud compared2;
+	qM3C2Engine::Output output;
+	NormsIndexesTableType* coreNormals = nullptr;
 
-		pDlg.reset();
-		CCLib::NormalizedProgress nProgress(&pDlg, corePointCount);
-		pDlg.setMethodTitle(QObject::tr("M3C2 Distances Computation"));
-		pDlg.setInfo(QObject::tr("Core points: %1").arg(corePointCount));
-		pDlg.start();
-		s_M3C2Params.nProgress = &nProgress;
+	GetEngineParameters(dlg, params);
+	ccPointCloud* corePoints = dlg.getCorePointsCloud();
+	output.exportOption = dlg.getExportOption();
+	bool keepOriginalCloud = dlg.keepOriginalCloud();
 
-		//allocate distances SF
-		s_M3C2Params.m3c2DistSF = new ccScalarField(M3C2_DIST_SF_NAME);
-		s_M3C2Params.m3c2DistSF->link();
-		if (!s_M3C2Params.m3c2DistSF->resizeSafe(corePointCount, true, NAN_VALUE))
-		{
-			errorMessage = "Failed to allocate memory for distance values!";
-			error = true;
-			break;
-		}
-		//allocate dist. uncertainty SF
-		s_M3C2Params.distUncertaintySF = new ccScalarField(DIST_UNCERTAINTY_SF_NAME);
-		s_M3C2Params.distUncertaintySF->link();
-		if (!s_M3C2Params.distUncertaintySF->resizeSafe(corePointCount, true, NAN_VALUE))
+	//precision maps
+	{
+		params.usePrecisionMaps = dlg.precisionMapsGroupBox->isEnabled() && dlg.precisionMapsGroupBox->isChecked();
+		if (params.usePrecisionMaps)
 		{
-			errorMessage = "Failed to allocate memory for dist. uncertainty values!";
-			error = true;
-			break;
+			if (allowDialogs && QMessageBox::question(parentWidget, "Precision Maps", "Are you sure you want to compute the M3C2 distances with precision maps?", QMessageBox::Yes, QMessageBox::No) == QMessageBox::No)
+			{
+				params.usePrecisionMaps = false;
+				dlg.precisionMapsGroupBox->setChecked(false);
+			}
 		}
-		//allocate change significance SF
-		s_M3C2Params.sigChangeSF = new ccScalarField(SIG_CHANGE_SF_NAME);
-		s_M3C2Params.sigChangeSF->link();
-		if (!s_M3C2Params.sigChangeSF->resizeSafe(corePointCount, true, SCALAR_ZERO))
+		if (params.usePrecisionMaps)
 		{
-			if (app)
-				app->dispToConsole("Failed to allocate memory for change significance values!", ccMainAppInterface::WRN_CONSOLE_MESSAGE);
-			s_M3C2Params.sigChangeSF->release();
-			s_M3C2Params.sigChangeSF = 0;
-			//no need to stop just for this SF!
-			//error = true;
-			//break;
-		}
+			compared1.pm.sX = cloud1->getScalarField(dlg.c1SxComboBox->currentIndex());
+			compared1.pm.sY = cloud1->getScalarField(dlg.c1SyComboBox->currentIndex());
+			compared1.pm.sZ = cloud1->getScalarField(dlg.c1SzComboBox->currentIndex());
+			compared1.pm.scale = dlg.pm1ScaleDoubleSpinBox->value();
 
-		if (dlg.exportStdDevInfoCheckBox->isChecked())
-		{
-			QString prefix("STD");
-			if (s_M3C2Params.usePrecisionMaps)
-			{
-				prefix = "SigmaN";
-			}
-			else if (s_M3C2Params.useMedian)
-			{
-				prefix = "IQR";
-			}
-			//allocate cloud #1 std. dev. SF
-			QString stdDevSFName1 = QString(STD_DEV_CLOUD1_SF_NAME).arg(prefix);
-			s_M3C2Params.stdDevCloud1SF = new ccScalarField(qPrintable(stdDevSFName1));
-			s_M3C2Params.stdDevCloud1SF->link();
-			if (!s_M3C2Params.stdDevCloud1SF->resizeSafe(corePointCount, true, NAN_VALUE))
+			compared2.pm.sX = cloud2->getScalarField(dlg.c2SxComboBox->currentIndex());
+			compared2.pm.sY = cloud2->getScalarField(dlg.c2SyComboBox->currentIndex());
+			compared2.pm.sZ = cloud2->getScalarField(dlg.c2SzComboBox->currentIndex());
+			compared2.pm.scale = dlg.pm2ScaleDoubleSpinBox->value();
+
+			if (!compared1.pm.valid() || !compared2.pm.valid())
 			{
-				if (app)
-					app->dispToConsole("Failed to allocate memory for cloud #1 std. dev. values!", ccMainAppInterface::WRN_CONSOLE_MESSAGE);
-				s_M3C2Params.stdDevCloud1SF->release();
-				s_M3C2Params.stdDevCloud1SF = 0;
+				errorMessage = "Invalid 'Precision maps' settings!";
+				return false;
 			}
-			//allocate cloud #2 std. dev. SF
-			QString stdDevSFName2 = QString(STD_DEV_CLOUD2_SF_NAME).arg(prefix);
-			s_M3C2Params.stdDevCloud2SF = new ccScalarField(qPrintable(stdDevSFName2));
-			s_M3C2Params.stdDevCloud2SF->link();
-			if (!s_M3C2Params.stdDevCloud2SF->resizeSafe(corePointCount, true, NAN_VALUE))
-			{
-				if (app)
+		}
+	}
+
+
+	//max thread count
+	int maxThreadCount = params.maxThreadCount;
+
+	//progress dialog
+	ccProgressDialog pDlg(parentWidget);
+
+	//Duration: initialization & normals computation
+	QElapsedTimer initTimer;
+	initTimer.start();
+
+	//compute octree(s) if necessary
+	compared1.octree = GetOctree(cloud1, pDlg, app);
+	if (!compared1.octree)
+	{
+		errorMessage = "Failed to compute cloud #1's octree!";
+		return false;
+	}
+
+	compared2.octree = GetOctree(cloud2, pDlg, app);
+	if (!compared2.octree)
+	{
+		errorMessage = "Failed to compute cloud #2's octree!";
+		return false;
+	}
+
+	//start the job
+	bool error = false;
+
+	//core points and normals
+	bool corePointsHaveBeenSubsampled = false;
+	QString outputName(params.usePrecisionMaps ? "M3C2-PM output" : "M3C2 output");
+	if (!ComputeCorePointsAndNormals(dlg,
+									cloud1,
+									compared1.octree,
+									maxThreadCount,
+									corePoints,
+									coreNormals,
+									normalScaleSF,
+									corePointsHaveBeenSubsampled,
+									outputName,
+									errorMessage,
+									pDlg,
+									app))
+	{
+		error = true;
+	}
+
+	//output
+	if (!error)
+	{
+		if (keepOriginalCloud)
+		{
+			output.outputCloud = corePoints;
+		}
+		else
+		{
+			output.outputCloud = new ccPointCloud(/*outputName*/); //setName will be called at the end
+			if (!output.outputCloud->resize(corePoints->size())) //resize as the engine will 'set' the new points positions
+			{
+				errorMessage = "Not enough memory!";
+				error = true;
+			}
+			corePoints->setEnabled(false); //we can hide the core points
+		}
+	}
+
+	//export the computed normals
+	if (!error && coreNormals && (normMode == qM3C2Normals::DEFAULT_MODE || normMode == qM3C2Normals::MULTI_SCALE_MODE || normMode == qM3C2Normals::HORIZ_MODE))
+	{
+		output.outputCloud->setNormsTable(coreNormals);
+		output.outputCloud->showNormals(true);
+	}
+
+	qint64 initTime_ms = initTimer.elapsed();
+
+	while (!error) //fake loop for easy break
+	{
+		//we display init. timing only if no error occurred!
+		if (app)
+			app->dispToConsole(QString("[M3C2] Initialization & normal computation: %1 s.").arg(initTime_ms / 1000.0, 0, 'f', 3), ccMainAppInterface::STD_CONSOLE_MESSAGE);
+
+		QElapsedTimer distCompTimer;
+		distCompTimer.start();
+
+		//we are either in vertical mode or we have as many normals as core points
+		unsigned corePointCount = corePoints->size();
+		assert(normMode == qM3C2Normals::VERT_MODE || (coreNormals && corePointCount == coreNormals->currentSize()));
+
+		//allocate distances SF
+		output.m3c2DistSF = new ccScalarField(M3C2_DIST_SF_NAME);
+		output.m3c2DistSF->link();
+		if (!output.m3c2DistSF->resizeSafe(corePointCount, true, NAN_VALUE))
+		{
+			errorMessage = "Failed to allocate memory for distance values!";
+			error = true;
+			break;
+		}
+		//allocate dist. uncertainty SF
+		output.distUncertaintySF = new ccScalarField(DIST_UNCERTAINTY_SF_NAME);
+		output.distUncertaintySF->link();
+		if (!output.distUncertaintySF->resizeSafe(corePointCount, true, NAN_VALUE))
+		{
+			errorMessage = "Failed to allocate memory for dist. uncertainty values!";
+			error = true;
+			break;
+		}
+		//allocate change significance SF
+		output.sigChangeSF = new ccScalarField(SIG_CHANGE_SF_NAME);
+		output.sigChangeSF->link();
+		if (!output.sigChangeSF->resizeSafe(corePointCount, true, SCALAR_ZERO))
+		{
+			if (app)
+				app->dispToConsole("Failed to allocate memory for change significance values!", ccMainAppInterface::WRN_CONSOLE_MESSAGE);
+			output.sigChangeSF->release();
+			output.sigChangeSF = 0;
+			//no need to stop just for this SF!
+			//error = true;
+			//break;
+		}
+
+		if (dlg.exportStdDevInfoCheckBox->isChecked())
+		{
+			QString prefix("STD");
+			if (params.usePrecisionMaps)
+			{
+				prefix = "SigmaN";
+			}
+			else if (params.useMedian)
+			{
+				prefix = "IQR";
+			}
+			//allocate cloud #1 std. dev. SF
+			QString stdDevSFName1 = QString(STD_DEV_CLOUD1_SF_NAME).arg(prefix);
+			output.stdDevCloud1SF = new ccScalarField(qPrintable(stdDevSFName1));
+			output.stdDevCloud1SF->link();
+			if (!output.stdDevCloud1SF->resizeSafe(corePointCount, true, NAN_VALUE))
+			{
+				if (app)
+					app->dispToConsole("Failed to allocate memory for cloud #1 std. dev. values!", ccMainAppInterface::WRN_CONSOLE_MESSAGE);
+				output.stdDevCloud1SF->release();
+				output.stdDevCloud1SF = 0;
+			}
+			//allocate cloud #2 std. dev. SF
+			QString stdDevSFName2 = QString(STD_DEV_CLOUD2_SF_NAME).arg(prefix);
+			output.stdDevCloud2SF = new ccScalarField(qPrintable(stdDevSFName2));
+			output.stdDevCloud2SF->link();
+			if (!output.stdDevCloud2SF->resizeSafe(corePointCount, true, NAN_VALUE))
+			{
+				if (app)
 					app->dispToConsole("Failed to allocate memory for cloud #2 std. dev. values!", ccMainAppInterface::WRN_CONSOLE_MESSAGE);
-				s_M3C2Params.stdDevCloud2SF->release();
-				s_M3C2Params.stdDevCloud2SF = 0;
+				output.stdDevCloud2SF->release();
+				output.stdDevCloud2SF = 0;
 			}
 		}
 		if (dlg.exportDensityAtProjScaleCheckBox->isChecked())
 		{
 			//allocate cloud #1 density SF
-			s_M3C2Params.densityCloud1SF = new ccScalarField(DENSITY_CLOUD1_SF_NAME);
-			s_M3C2Params.densityCloud1SF->link();
-			if (!s_M3C2Params.densityCloud1SF->resizeSafe(corePointCount, true, NAN_VALUE))
+			output.densityCloud1SF = new ccScalarField(DENSITY_CLOUD1_SF_NAME);
+			output.densityCloud1SF->link();
+			if (!output.densityCloud1SF->resizeSafe(corePointCount, true, NAN_VALUE))
 			{
 				if (app)
 					app->dispToConsole("Failed to allocate memory for cloud #1 density values!", ccMainAppInterface::WRN_CONSOLE_MESSAGE);
-				s_M3C2Params.densityCloud1SF->release();
-				s_M3C2Params.densityCloud1SF = 0;
+				output.densityCloud1SF->release();
+				output.densityCloud1SF = 0;
 			}
 			//allocate cloud #2 density SF
-			s_M3C2Params.densityCloud2SF = new ccScalarField(DENSITY_CLOUD2_SF_NAME);
-			s_M3C2Params.densityCloud2SF->link();
-			if (!s_M3C2Params.densityCloud2SF->resizeSafe(corePointCount, true, NAN_VALUE))
+			output.densityCloud2SF = new ccScalarField(DENSITY_CLOUD2_SF_NAME);
+			output.densityCloud2SF->link();
+			if (!output.densityCloud2SF->resizeSafe(corePointCount, true, NAN_VALUE))
 			{
 				if (app)
 					app->dispToConsole("Failed to allocate memory for cloud #2 density values!", ccMainAppInterface::WRN_CONSOLE_MESSAGE);
-				s_M3C2Params.densityCloud2SF->release();
-				s_M3C2Params.densityCloud2SF = 0;
+				output.densityCloud2SF->release();
+				output.densityCloud2SF = 0;
 			}
 		}
 
 		//get best levels for neighbourhood extraction on both octrees
-		assert(s_M3C2Params.cloud1Octree && s_M3C2Params.cloud2Octree);
+		assert(compared1.octree && compared2.octree);
 
-		s_M3C2Params.level1 = s_M3C2Params.cloud1Octree->findBestLevelForAGivenNeighbourhoodSizeExtraction(static_cast<PointCoordinateType>(2.5 * s_M3C2Params.projectionRadius)); //2.5 = empirical!
+		unsigned char level1 = compared1.octree->findBestLevelForAGivenNeighbourhoodSizeExtraction(static_cast<PointCoordinateType>(2.5 * params.projectionRadius)); //2.5 = empirical!
 		if (app)
-			app->dispToConsole(QString("[M3C2] Working subdivision level (cloud #1): %1").arg(s_M3C2Params.level1), ccMainAppInterface::STD_CONSOLE_MESSAGE);
+			app->dispToConsole(QString("[M3C2] Working subdivision level (cloud #1): %1").arg(level1), ccMainAppInterface::STD_CONSOLE_MESSAGE);
 
-		s_M3C2Params.level2 = s_M3C2Params.cloud2Octree->findBestLevelForAGivenNeighbourhoodSizeExtraction(static_cast<PointCoordinateType>(2.5 * s_M3C2Params.projectionRadius)); //2.5 = empirical!
+		unsigned char level2 = compared2.octree->findBestLevelForAGivenNeighbourhoodSizeExtraction(static_cast<PointCoordinateType>(2.5 * params.projectionRadius)); //2.5 = empirical!
 		if (app)
-			app->dispToConsole(QString("[M3C2] Working subdivision level (cloud #2): %1").arg(s_M3C2Params.level2), ccMainAppInterface::STD_CONSOLE_MESSAGE);
+			app->dispToConsole(QString("[M3C2] Working subdivision level (cloud #2): %1").arg(level2), ccMainAppInterface::STD_CONSOLE_MESSAGE);
 
 		//other options
-		s_M3C2Params.updateNormal = (normMode != qM3C2Normals::VERT_MODE);
-		s_M3C2Params.exportNormal = s_M3C2Params.updateNormal && !s_M3C2Params.outputCloud->hasNormals();
-		if (s_M3C2Params.exportNormal && !s_M3C2Params.outputCloud->resizeTheNormsTable()) //resize because we will 'set' the normal in ComputeM3C2DistForPoint
+		bool updateNormal = (normMode != qM3C2Normals::VERT_MODE);
+		output.exportNormal = updateNormal && !output.outputCloud->hasNormals();
+		if (output.exportNormal && !output.outputCloud->resizeTheNormsTable()) //resize because the engine will 'set' the normals
 		{
 			if (app)
 				app->dispToConsole("Failed to allocate memory for exporting normals!", ccMainAppInterface::WRN_CONSOLE_MESSAGE);
-			s_M3C2Params.exportNormal = false;
+			output.exportNormal = false;
 		}
-		s_M3C2Params.computeConfidence = (s_M3C2Params.distUncertaintySF || s_M3C2Params.sigChangeSF);
 
 		//compute distances
+		qM3C2Engine engine(params);
+		if (!engine.setCorePoints(corePoints, updateNormal ? coreNormals : nullptr, &pDlg))
 		{
-			std::vector<unsigned> pointIndexes;
-			bool useParallelStrategy = true;
-#ifdef _DEBUG
-			useParallelStrategy = false;
-#endif
-			if (useParallelStrategy)
-			{
-				try
-				{
-					pointIndexes.resize(corePointCount);
-				}
-				catch (const std::bad_alloc&)
-				{
-					//not enough memory
-					useParallelStrategy = false;
-				}
-			}
-
-			if (useParallelStrategy)
-			{
-				for (unsigned i = 0; i < corePointCount; ++i)
-				{
-					pointIndexes[i] = i;
-				}
-
-				if (maxThreadCount == 0)
-				{
-					maxThreadCount = QThread::idealThreadCount();
-				}
-				assert(maxThreadCount > 0 && maxThreadCount <= QThread::idealThreadCount());
-				QThreadPool::globalInstance()->setMaxThreadCount(maxThreadCount);
-				QtConcurrent::blockingMap(pointIndexes, ComputeM3C2DistForPoint);
-			}
-			else
-			{
-				//manually call the static per-point method!
-				for (unsigned i = 0; i < corePointCount; ++i)
-				{
-					ComputeM3C2DistForPoint(i);
-				}
-			}
+			errorMessage = "Failed to sort the core points (not enough memory?)";
+			error = true;
+			break;
 		}
 
-		if (s_M3C2Params.processCanceled)
+		pDlg.reset();
+		pDlg.setMethodTitle(QObject::tr("M3C2 Distances Computation"));
+		pDlg.setInfo(QObject::tr("Core points: %1").arg(corePointCount));
+		pDlg.start();
+
+		if (!engine.compute(compared1, compared2, output, &pDlg))
 		{
-			errorMessage = "Process canceled by user!";
+			errorMessage = (engine.wasCanceled() ? "Process canceled by user!" : "Not enough memory!");
 			error = true;
 		}
 		else
@@ -966,8 +636,6 @@ bool qM3C2Process::Compute(const qM3C2Dialog& dlg, QString& errorMessage, ccPoin
 				app->dispToConsole(QString("[M3C2] Distances computation: %1 s.").arg(static_cast<double>(distTime_ms) / 1000.0, 0, 'f', 3), ccMainAppInterface::STD_CONSOLE_MESSAGE);
 		}
 
-		s_M3C2Params.nProgress = 0;
-
 		break; //to break from fake loop
 	}
 
@@ -976,7 +644,7 @@ bool qM3C2Process::Compute(const qM3C2Dialog& dlg, QString& errorMessage, ccPoin
 	//the most important one at the end)
 	if (!error)
 	{
-		assert(s_M3C2Params.outputCloud && s_M3C2Params.corePoints);
+		assert(output.outputCloud && corePoints);
 		int sfIdx = -1;
 
 		//normal scales
@@ -984,101 +652,101 @@ bool qM3C2Process::Compute(const qM3C2Dialog& dlg, QString& errorMessage, ccPoin
 		{
 			normalScaleSF->computeMinAndMax();
 			//in case the output cloud is the original cloud, we must remove the former SF
-			RemoveScalarField(s_M3C2Params.outputCloud, normalScaleSF->getName());
-			sfIdx = s_M3C2Params.outputCloud->addScalarField(normalScaleSF);
+			RemoveScalarField(output.outputCloud, normalScaleSF->getName());
+			sfIdx = output.outputCloud->addScalarField(normalScaleSF);
 		}
 
 		//add clouds' density SFs to output cloud
-		if (s_M3C2Params.densityCloud1SF)
+		if (output.densityCloud1SF)
 		{
-			s_M3C2Params.densityCloud1SF->computeMinAndMax();
+			output.densityCloud1SF->computeMinAndMax();
 			//in case the output cloud is the original cloud, we must remove the former SF
-			RemoveScalarField(s_M3C2Params.outputCloud, s_M3C2Params.densityCloud1SF->getName());
-			sfIdx = s_M3C2Params.outputCloud->addScalarField(s_M3C2Params.densityCloud1SF);
+			RemoveScalarField(output.outputCloud, output.densityCloud1SF->getName());
+			sfIdx = output.outputCloud->addScalarField(output.densityCloud1SF);
 		}
-		if (s_M3C2Params.densityCloud2SF)
+		if (output.densityCloud2SF)
 		{
-			s_M3C2Params.densityCloud2SF->computeMinAndMax();
+			output.densityCloud2SF->computeMinAndMax();
 			//in case the output cloud is the original cloud, we must remove the former SF
-			RemoveScalarField(s_M3C2Params.outputCloud, s_M3C2Params.densityCloud2SF->getName());
-			sfIdx = s_M3C2Params.outputCloud->addScalarField(s_M3C2Params.densityCloud2SF);
+			RemoveScalarField(output.outputCloud, output.densityCloud2SF->getName());
+			sfIdx = output.outputCloud->addScalarField(output.densityCloud2SF);
 		}
 
 		//add clouds' std. dev. SFs to output cloud
-		if (s_M3C2Params.stdDevCloud1SF)
+		if (output.stdDevCloud1SF)
 		{
-			s_M3C2Params.stdDevCloud1SF->computeMinAndMax();
+			output.stdDevCloud1SF->computeMinAndMax();
 			//in case the output cloud is the original cloud, we must remove the former SF
-			RemoveScalarField(s_M3C2Params.outputCloud, s_M3C2Params.stdDevCloud1SF->getName());
-			sfIdx = s_M3C2Params.outputCloud->addScalarField(s_M3C2Params.stdDevCloud1SF);
+			RemoveScalarField(output.outputCloud, output.stdDevCloud1SF->getName());
+			sfIdx = output.outputCloud->addScalarField(output.stdDevCloud1SF);
 		}
-		if (s_M3C2Params.stdDevCloud2SF)
+		if (output.stdDevCloud2SF)
 		{
 			//add cloud #2 std. dev. SF to output cloud
-			s_M3C2Params.stdDevCloud2SF->computeMinAndMax();
+			output.stdDevCloud2SF->computeMinAndMax();
 			//in case the output cloud is the original cloud, we must remove the former SF
-			RemoveScalarField(s_M3C2Params.outputCloud, s_M3C2Params.stdDevCloud2SF->getName());
-			sfIdx = s_M3C2Params.outputCloud->addScalarField(s_M3C2Params.stdDevCloud2SF);
+			RemoveScalarField(output.outputCloud, output.stdDevCloud2SF->getName());
+			sfIdx = output.outputCloud->addScalarField(output.stdDevCloud2SF);
 		}
 
-		if (s_M3C2Params.sigChangeSF)
+		if (output.sigChangeSF)
 		{
 			//add significance SF to output cloud
-			s_M3C2Params.sigChangeSF->computeMinAndMax();
-			s_M3C2Params.sigChangeSF->setMinDisplayed(SCALAR_ONE);
+			output.sigChangeSF->computeMinAndMax();
+			output.sigChangeSF->setMinDisplayed(SCALAR_ONE);
 			//in case the output cloud is the original cloud, we must remove the former SF
-			RemoveScalarField(s_M3C2Params.outputCloud, s_M3C2Params.sigChangeSF->getName());
-			sfIdx = s_M3C2Params.outputCloud->addScalarField(s_M3C2Params.sigChangeSF);
+			RemoveScalarField(output.outputCloud, output.sigChangeSF->getName());
+			sfIdx = output.outputCloud->addScalarField(output.sigChangeSF);
 		}
 
-		if (s_M3C2Params.distUncertaintySF)
+		if (output.distUncertaintySF)
 		{
 			//add dist. uncertainty SF to output cloud
-			s_M3C2Params.distUncertaintySF->computeMinAndMax();
+			output.distUncertaintySF->computeMinAndMax();
 			//in case the output cloud is the original cloud, we must remove the former SF
-			RemoveScalarField(s_M3C2Params.outputCloud, s_M3C2Params.distUncertaintySF->getName());
-			sfIdx = s_M3C2Params.outputCloud->addScalarField(s_M3C2Params.distUncertaintySF);
+			RemoveScalarField(output.outputCloud, output.distUncertaintySF->getName());
+			sfIdx = output.outputCloud->addScalarField(output.distUncertaintySF);
 		}
 
-		if (s_M3C2Params.m3c2DistSF)
+		if (output.m3c2DistSF)
 		{
 			//add M3C2 distances SF to output cloud
-			s_M3C2Params.m3c2DistSF->computeMinAndMax();
-			s_M3C2Params.m3c2DistSF->setSymmetricalScale(true);
+			output.m3c2DistSF->computeMinAndMax();
+			output.m3c2DistSF->setSymmetricalScale(true);
 			//in case the output cloud is the original cloud, we must remove the former SF
-			RemoveScalarField(s_M3C2Params.outputCloud, s_M3C2Params.m3c2DistSF->getName());
-			sfIdx = s_M3C2Params.outputCloud->addScalarField(s_M3C2Params.m3c2DistSF);
+			RemoveScalarField(output.outputCloud, output.m3c2DistSF->getName());
+			sfIdx = output.outputCloud->addScalarField(output.m3c2DistSF);
 		}
 
-		s_M3C2Params.outputCloud->invalidateBoundingBox(); //see 'const_cast<...>' in ComputeM3C2DistForPoint ;)
-		s_M3C2Params.outputCloud->setCurrentDisplayedScalarField(sfIdx);
-		s_M3C2Params.outputCloud->showSF(true);
-		s_M3C2Params.outputCloud->showNormals(true);
-		s_M3C2Params.outputCloud->setVisible(true);
+		output.outputCloud->invalidateBoundingBox(); //see 'const_cast<...>' in qM3C2Engine::compute ;)
+		output.outputCloud->setCurrentDisplayedScalarField(sfIdx);
+		output.outputCloud->showSF(true);
+		output.outputCloud->showNormals(true);
+		output.outputCloud->setVisible(true);
 
-		if (s_M3C2Params.outputCloud != s_M3C2Params.corePoints)
+		if (output.outputCloud != corePoints)
 		{
-			s_M3C2Params.outputCloud->setName(outputName);
-			s_M3C2Params.outputCloud->setDisplay(s_M3C2Params.corePoints->getDisplay());
-			s_M3C2Params.outputCloud->importParametersFrom(s_M3C2Params.corePoints);
+			output.outputCloud->setName(outputName);
+			output.outputCloud->setDisplay(corePoints->getDisplay());
+			output.outputCloud->importParametersFrom(corePoints);
 			if (app)
 			{
-				app->addToDB(s_M3C2Params.outputCloud);
+				app->addToDB(output.outputCloud);
 			}
 			else
 			{
 				//command line mode
-				outputCloud = s_M3C2Params.outputCloud;
+				outputCloud = output.outputCloud;
 			}
 		}
 	}
-	else if (s_M3C2Params.outputCloud)
+	else if (output.outputCloud)
 	{
-		if (s_M3C2Params.outputCloud != s_M3C2Params.corePoints)
+		if (output.outputCloud != corePoints)
 		{
-			delete s_M3C2Params.outputCloud;
+			delete output.outputCloud;
 		}
-		s_M3C2Params.outputCloud = 0;
+		output.outputCloud = 0;
 	}
 
 	if (app)
@@ -1087,23 +755,477 @@ bool qM3C2Process::Compute(const qM3C2Dialog& dlg, QString& errorMessage, ccPoin
 	//release structures
 	if (normalScaleSF)
 		normalScaleSF->release();
-	if (s_M3C2Params.coreNormals)
-		s_M3C2Params.coreNormals->release();
-	if (s_M3C2Params.m3c2DistSF)
-		s_M3C2Params.m3c2DistSF->release();
-	if (s_M3C2Params.sigChangeSF)
-		s_M3C2Params.sigChangeSF->release();
-	if (s_M3C2Params.distUncertaintySF)
-		s_M3C2Params.distUncertaintySF->release();
-	if (s_M3C2Params.stdDevCloud1SF)
-		s_M3C2Params.stdDevCloud1SF->release();
-	if (s_M3C2Params.stdDevCloud2SF)
-		s_M3C2Params.stdDevCloud2SF->release();
-	if (s_M3C2Params.densityCloud1SF)
-		s_M3C2Params.densityCloud1SF->release();
-	if (s_M3C2Params.densityCloud2SF)
-		s_M3C2Params.densityCloud2SF->release();
+	if (coreNormals)
+		coreNormals->release();
+	if (output.m3c2DistSF)
+		output.m3c2DistSF->release();
+	if (output.sigChangeSF)
+		output.sigChangeSF->release();
+	if (output.distUncertaintySF)
+		output.distUncertaintySF->release();
+	if (output.stdDevCloud1SF)
+		output.stdDevCloud1SF->release();
+	if (output.stdDevCloud2SF)
+		output.stdDevCloud2SF->release();
+	if (output.densityCloud1SF)
+		output.densityCloud1SF->release();
+	if (output.densityCloud2SF)
+		output.densityCloud2SF->release();
 
 	return !error;
 }
 
+
+//! Allocates an output scalar field (with as many values as core points)
+static ccScalarField* CreateOutputSF(const QString& name, unsigned count, ScalarType defaultValue)
+{
+	ccScalarField* sf = new ccScalarField(qPrintable(name));
+	sf->link();
+	if (!sf->resizeSafe(count, true, defaultValue))
+	{
+		sf->release();
+		return nullptr;
+	}
+	return sf;
+}
+
+//! Pair of epochs of a time series
+struct EpochPair
+{
+	EpochPair(size_t i1, size_t i2)
+		: epoch1(i1)
+		, epoch2(i2)
+	{}
+
+	size_t epoch1;
+	size_t epoch2;
+	qM3C2Engine::Output output;
+};
+
+bool qM3C2Process::ComputeTimeSeries(	const qM3C2Dialog& dlg,
+										const std::vector<ccPointCloud*>& epochs,
+										bool consecutive,
+										QString& errorMessage,
+										ccPointCloud*& outputCloud,
+										QWidget* parentWidget/*=nullptr*/,
+										ccMainAppInterface* app/*=nullptr*/)
+{
+	errorMessage.clear();
+	outputCloud = nullptr;
+
+	if (epochs.size() < 2)
+	{
+		errorMessage = "At least 2 epochs are required!";
+		return false;
+	}
+
+	//the first epoch is used to compute the core points and their normals
+	ccPointCloud* cloud1 = epochs.front();
+	if (!cloud1 || dlg.getCloud1() != cloud1)
+	{
+		assert(false);
+		return false;
+	}
+
+	qM3C2Normals::ComputationMode normMode = dlg.getNormalsComputationMode();
+	ccScalarField* normalScaleSF = 0; //normal scale (multi-scale mode only)
+
+	//M3C2 parameters
+	qM3C2Engine::Parameters params;
+	GetEngineParameters(dlg, params);
+	ccPointCloud* corePoints = dlg.getCorePointsCloud();
+	bool keepOriginalCloud = dlg.keepOriginalCloud();
+	NormsIndexesTableType* coreNormals = nullptr;
+
+	//the distances of all the pairs are exported on the same (core) points
+	if (dlg.getExportOption() != qM3C2Dialog::PROJECT_ON_CORE_POINTS && app)
+	{
+		app->dispToConsole("[M3C2] Time series: the distances are always exported on the core points", ccMainAppInterface::WRN_CONSOLE_MESSAGE);
+	}
+
+	//epochs (the octrees and precision maps are computed/retrieved once per epoch)
+	std::vector<qM3C2Engine::ComparedCloud> compared;
+	try
+	{
+		compared.resize(epochs.size());
+	}
+	catch (const std::bad_alloc&)
+	{
+		errorMessage = "Not enough memory!";
+		return false;
+	}
+
+	//precision maps (we look for the same scalar fields as cloud #1's in each epoch)
+	params.usePrecisionMaps = dlg.precisionMapsGroupBox->isEnabled() && dlg.precisionMapsGroupBox->isChecked();
+	if (params.usePrecisionMaps)
+	{
+		QString sxName = dlg.c1SxComboBox->currentText();
+		QString syName = dlg.c1SyComboBox->currentText();
+		QString szName = dlg.c1SzComboBox->currentText();
+
+		for (size_t i = 0; i < epochs.size(); ++i)
+		{
+			ccPointCloud* epoch = epochs[i];
+			compared[i].pm.sX = epoch->getScalarField(epoch->getScalarFieldIndexByName(qPrintable(sxName)));
+			compared[i].pm.sY = epoch->getScalarField(epoch->getScalarFieldIndexByName(qPrintable(syName)));
+			compared[i].pm.sZ = epoch->getScalarField(epoch->getScalarFieldIndexByName(qPrintable(szName)));
+			compared[i].pm.scale = dlg.pm1ScaleDoubleSpinBox->value();
+
+			if (!compared[i].pm.valid())
+			{
+				errorMessage = QString("Epoch '%1' has no precision maps scalar fields ('%2', '%3' and '%4')").arg(epoch->getName()).arg(sxName).arg(syName).arg(szName);
+				return false;
+			}
+		}
+	}
+
+	//max thread count
+	int maxThreadCount = params.maxThreadCount;
+	if (maxThreadCount <= 0)
+	{
+		maxThreadCount = QThread::idealThreadCount();
+	}
+
+	//progress dialog
+	ccProgressDialog pDlg(parentWidget);
+
+	//Duration: initialization & normals computation
+	QElapsedTimer initTimer;
+	initTimer.start();
+
+	//compute octree(s) if necessary
+	for (size_t i = 0; i < epochs.size(); ++i)
+	{
+		compared[i].octree = GetOctree(epochs[i], pDlg, app);
+		if (!compared[i].octree)
+		{
+			errorMessage = QString("Failed to compute epoch #%1's octree!").arg(i + 1);
+			return false;
+		}
+	}
+
+	//start the job
+	bool error = false;
+
+	//core points and normals (computed once for all the pairs)
+	bool corePointsHaveBeenSubsampled = false;
+	QString outputName(params.usePrecisionMaps ? "M3C2-PM time series" : "M3C2 time series");
+	if (!ComputeCorePointsAndNormals(dlg,
+									cloud1,
+									compared.front().octree,
+									maxThreadCount,
+									corePoints,
+									coreNormals,
+									normalScaleSF,
+									corePointsHaveBeenSubsampled,
+									outputName,
+									errorMessage,
+									pDlg,
+									app))
+	{
+		error = true;
+	}
+
+	bool updateNormal = (normMode != qM3C2Normals::VERT_MODE);
+
+	//output cloud
+	ccPointCloud* output = nullptr;
+	if (!error)
+	{
+		if (keepOriginalCloud)
+		{
+			output = corePoints;
+		}
+		else
+		{
+			output = new ccPointCloud(/*outputName*/); //setName will be called at the end
+			if (!output->reserve(corePoints->size()))
+			{
+				errorMessage = "Not enough memory!";
+				error = true;
+			}
+			else
+			{
+				for (unsigned i = 0; i < corePoints->size(); ++i)
+				{
+					output->addPoint(*corePoints->getPoint(i));
+				}
+			}
+			corePoints->setEnabled(false); //we can hide the core points
+		}
+	}
+
+	//export the normals
+	if (!error && updateNormal && coreNormals && output->normals() != coreNormals)
+	{
+		if (output->hasNormals() || output->resizeTheNormsTable())
+		{
+			for (unsigned i = 0; i < coreNormals->currentSize(); ++i)
+				output->setPointNormalIndex(i, coreNormals->getValue(i));
+			output->showNormals(true);
+		}
+		else if (app)
+		{
+			app->dispToConsole("Failed to allocate memory for exporting normals!", ccMainAppInterface::WRN_CONSOLE_MESSAGE);
+		}
+	}
+
+	//pairs of epochs
+	std::vector<EpochPair> pairs;
+	if (!error)
+	{
+		try
+		{
+			for (size_t i = 1; i < epochs.size(); ++i)
+			{
+				pairs.push_back(EpochPair(consecutive ? i - 1 : 0, i));
+			}
+		}
+		catch (const std::bad_alloc&)
+		{
+			errorMessage = "Not enough memory!";
+			error = true;
+		}
+	}
+
+	qint64 initTime_ms = initTimer.elapsed();
+
+	while (!error) //fake loop for easy break
+	{
+		//we display init. timing only if no error occurred!
+		if (app)
+			app->dispToConsole(QString("[M3C2] Initialization & normal computation: %1 s.").arg(initTime_ms / 1000.0, 0, 'f', 3), ccMainAppInterface::STD_CONSOLE_MESSAGE);
+
+		QElapsedTimer distCompTimer;
+		distCompTimer.start();
+
+		//we are either in vertical mode or we have as many normals as core points
+		unsigned corePointCount = corePoints->size();
+		assert(!updateNormal || (coreNormals && corePointCount == coreNormals->currentSize()));
+
+		//allocate the scalar fields of each pair
+		for (EpochPair& pair : pairs)
+		{
+			QString suffix = QString(" [%1-%2]").arg(pair.epoch1 + 1).arg(pair.epoch2 + 1);
+
+			pair.output.m3c2DistSF = CreateOutputSF(M3C2_DIST_SF_NAME + suffix, corePointCount, NAN_VALUE);
+			if (!pair.output.m3c2DistSF)
+			{
+				errorMessage = "Failed to allocate memory for distance values!";
+				error = true;
+				break;
+			}
+			pair.output.distUncertaintySF = CreateOutputSF(DIST_UNCERTAINTY_SF_NAME + suffix, corePointCount, NAN_VALUE);
+			if (!pair.output.distUncertaintySF)
+			{
+				errorMessage = "Failed to allocate memory for dist. uncertainty values!";
+				error = true;
+				break;
+			}
+			pair.output.sigChangeSF = CreateOutputSF(SIG_CHANGE_SF_NAME + suffix, corePointCount, SCALAR_ZERO);
+			if (!pair.output.sigChangeSF && app)
+			{
+				//no need to stop just for this SF!
+				app->dispToConsole("Failed to allocate memory for change significance values!", ccMainAppInterface::WRN_CONSOLE_MESSAGE);
+			}
+		}
+		if (error)
+		{
+			break;
+		}
+
+		//sort the core points (once for all the pairs)
+		qM3C2Engine engine(params);
+		if (!engine.setCorePoints(corePoints, updateNormal ? coreNormals : nullptr, &pDlg))
+		{
+			errorMessage = "Failed to sort the core points (not enough memory?)";
+			error = true;
+			break;
+		}
+
+		if (app)
+		{
+			for (size_t i = 0; i < epochs.size(); ++i)
+			{
+				app->dispToConsole(QString("[M3C2] Epoch #%1: %2").arg(i + 1).arg(epochs[i]->getName()), ccMainAppInterface::STD_CONSOLE_MESSAGE);
+			}
+		}
+
+		pDlg.reset();
+		pDlg.setMethodTitle(QObject::tr("M3C2 Time Series"));
+		pDlg.setInfo(QObject::tr("Epochs: %1\nCore points: %2").arg(epochs.size()).arg(corePointCount));
+		pDlg.start();
+
+		//the per core point statistics of each epoch are computed once, and then combined for each pair.
+		//The statistics are immutable once computed: each pair is combined in the background (while the
+		//next epoch is processed), and the statistics are released as soon as no pair needs them anymore.
+		typedef std::shared_ptr<const qM3C2Engine::CloudStatistics> SharedStatistics;
+		SharedStatistics referenceStats;
+		QFutureSynchronizer<void> combinations;
+		std::vector<qint64> epochTimes_ms(epochs.size(), 0);
+		for (size_t i = 0; i < epochs.size(); ++i)
+		{
+			pDlg.setInfo(QObject::tr("Epoch #%1/%2\nCore points: %3").arg(i + 1).arg(epochs.size()).arg(corePointCount));
+
+			QElapsedTimer epochTimer;
+			epochTimer.start();
+
+			std::shared_ptr<qM3C2Engine::CloudStatistics> currentStats;
+			try
+			{
+				currentStats = std::make_shared<qM3C2Engine::CloudStatistics>();
+			}
+			catch (const std::bad_alloc&)
+			{
+				errorMessage = "Not enough memory!";
+				error = true;
+				break;
+			}
+
+			bool canceled = false;
+			if (!engine.computeStatistics(compared[i], *currentStats, maxThreadCount, canceled, &pDlg))
+			{
+				errorMessage = (canceled ? "Process canceled by user!" : "Not enough memory!");
+				error = true;
+				break;
+			}
+
+			if (i == 0)
+			{
+				referenceStats = currentStats;
+			}
+			else
+			{
+				//pair (i-1 or 0) / i (each pair has its own output scalar fields)
+				const EpochPair& pair = pairs[i - 1];
+				assert(pair.epoch2 == i);
+				SharedStatistics stats1 = referenceStats;
+				SharedStatistics stats2 = currentStats;
+				combinations.addFuture(QtConcurrent::run([&engine, &pair, stats1, stats2]() { engine.combineStatistics(*stats1, *stats2, pair.output); }));
+
+				if (consecutive)
+				{
+					//the current epoch is the reference of the next pair
+					referenceStats = currentStats;
+				}
+			}
+
+			epochTimes_ms[i] = epochTimer.elapsed();
+		}
+		//the engine and the pairs must outlive the background combinations
+		combinations.waitForFinished();
+		if (error)
+		{
+			break;
+		}
+
+		qint64 distTime_ms = distCompTimer.elapsed();
+		if (app)
+		{
+			for (size_t i = 0; i < epochs.size(); ++i)
+			{
+				app->dispToConsole(QString("[M3C2] Epoch #%1: %2 s.").arg(i + 1).arg(static_cast<double>(epochTimes_ms[i]) / 1000.0, 0, 'f', 3), ccMainAppInterface::STD_CONSOLE_MESSAGE);
+			}
+			app->dispToConsole(QString("[M3C2] Distances computation (%1 epochs, %2 pairs): %3 s.")
+				.arg(epochs.size())
+				.arg(pairs.size())
+				.arg(static_cast<double>(distTime_ms) / 1000.0, 0, 'f', 3), ccMainAppInterface::STD_CONSOLE_MESSAGE);
+		}
+
+		break; //to break from fake loop
+	}
+
+	//associate scalar fields to the output cloud
+	//(use reverse order so as to get the index of
+	//the most important one at the end)
+	if (!error)
+	{
+		assert(output && corePoints);
+		int sfIdx = -1;
+
+		//normal scales
+		if (normalScaleSF)
+		{
+			normalScaleSF->computeMinAndMax();
+			//in case the output cloud is the original cloud, we must remove the former SF
+			RemoveScalarField(output, normalScaleSF->getName());
+			sfIdx = output->addScalarField(normalScaleSF);
+		}
+
+		for (std::vector<EpochPair>::reverse_iterator it = pairs.rbegin(); it != pairs.rend(); ++it)
+		{
+			qM3C2Engine::Output& pairOutput = it->output;
+
+			if (pairOutput.sigChangeSF)
+			{
+				pairOutput.sigChangeSF->computeMinAndMax();
+				pairOutput.sigChangeSF->setMinDisplayed(SCALAR_ONE);
+				RemoveScalarField(output, pairOutput.sigChangeSF->getName());
+				sfIdx = output->addScalarField(pairOutput.sigChangeSF);
+			}
+
+			if (pairOutput.distUncertaintySF)
+			{
+				pairOutput.distUncertaintySF->computeMinAndMax();
+				RemoveScalarField(output, pairOutput.distUncertaintySF->getName());
+				sfIdx = output->addScalarField(pairOutput.distUncertaintySF);
+			}
+
+			if (pairOutput.m3c2DistSF)
+			{
+				pairOutput.m3c2DistSF->computeMinAndMax();
+				pairOutput.m3c2DistSF->setSymmetricalScale(true);
+				RemoveScalarField(output, pairOutput.m3c2DistSF->getName());
+				sfIdx = output->addScalarField(pairOutput.m3c2DistSF);
+			}
+		}
+
+		output->setCurrentDisplayedScalarField(sfIdx);
+		output->showSF(true);
+		output->setVisible(true);
+
+		if (output != corePoints)
+		{
+			output->setName(outputName + QString(consecutive ? " [consecutive]" : " [reference]"));
+			output->setDisplay(corePoints->getDisplay());
+			output->importParametersFrom(corePoints);
+			if (app)
+			{
+				app->addToDB(output);
+			}
+			else
+			{
+				//command line mode
+				outputCloud = output;
+			}
+		}
+	}
+	else if (output)
+	{
+		if (output != corePoints)
+		{
+			delete output;
+		}
+		output = nullptr;
+	}
+
+	if (app)
+		app->refreshAll();
+
+	//release structures
+	if (normalScaleSF)
+		normalScaleSF->release();
+	if (coreNormals)
+		coreNormals->release();
+	for (EpochPair& pair : pairs)
+	{
+		if (pair.output.m3c2DistSF)
+			pair.output.m3c2DistSF->release();
+		if (pair.output.distUncertaintySF)
+			pair.output.distUncertaintySF->release();
+		if (pair.output.sigChangeSF)
+			pair.output.sigChangeSF->release();
+	}
+
+	return !error;
+}
@@ -21,6 +21,9 @@
 //Local
 #include "qM3C2Dialog.h"
 
+//system
+#include <vector>
+
 class ccMainAppInterface;
 
 //! M3C2 process
@@ -39,6 +42,29 @@ public:
 						QWidget* parentWidget = nullptr,
 						ccMainAppInterface* app = nullptr);
 
+	//! Computes the M3C2 distances of a time series (i.e. between several epochs)
+	/** The core points and their normals are computed once (with the first epoch as
+		'cloud #1'), and the octree of each epoch is computed once as well. The per core
+		point statistics (mean/median, std. dev., number of points, precision maps sigma)
+		are computed once per epoch as well. They are then combined for each pair of
+		epochs into the distance, uncertainty and significance fields.
+		\param dlg M3C2 parameters (cloud #1 must be the first epoch)
+		\param epochs epochs (at least 2, in chronological order)
+		\param consecutive whether to compare the consecutive epochs (otherwise each epoch is compared to the first one)
+		\param errorMessage error message (in case of failure)
+		\param outputCloud output cloud (command line mode only)
+		\param parentWidget parent widget (optional)
+		\param app main application interface (optional)
+		\return success
+	**/
+	static bool ComputeTimeSeries(	const qM3C2Dialog& dlg,
+									const std::vector<ccPointCloud*>& epochs,
+									bool consecutive,
+									QString& errorMessage,
+									ccPointCloud*& outputCloud,
+									QWidget* parentWidget = nullptr,
+									ccMainAppInterface* app = nullptr);
+
 };
 
 #endif //Q_M3C2_PROCESS_HEADER
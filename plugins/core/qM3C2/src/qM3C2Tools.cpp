@@ -20,7 +20,6 @@
 //CCLib
 #include <Neighbourhood.h>
 #include <DistanceComputationTools.h>
-#include <Jacobi.h>
 
 //qCC_db
 #include <ccGenericPointCloud.h>
@@ -112,9 +111,9 @@ void ComputeCorePointNormal(unsigned index)
 			/*** we manually compute the least squares best fitting plane (so as to get the PCA eigen values) ***/
 
 			//we determine the plane normal by computing the smallest eigen value of M = 1/n * S[(p-)*(p-)']
-			CCLib::SquareMatrixd eigVectors;
-			std::vector<double> eigValues;
-			if (Jacobi<double>::ComputeEigenValuesAndVectors(Z.computeCovarianceMatrix(), eigVectors, eigValues, true))
+			const double* eigValues = Z.getEigenValues();
+			const CCVector3d* eigVectors = Z.getEigenVectors();
+			if (eigValues && eigVectors)
 			{
 				/*** code and comments below are from the original 'm3c2' code (N. Brodu) ***/
 
@@ -150,11 +149,8 @@ void ComputeCorePointNormal(unsigned index)
 					bestSamplePointCount = subset.size();
 
 					//the smallest eigen vector corresponds to the "least square best fitting plane" normal
-					double vec[3];
-					double minEigValue = 0;
-					Jacobi<double>::GetMinEigenValueAndVector(eigVectors, eigValues, minEigValue, vec);
-
-					CCVector3 N = CCVector3::fromArray(vec);
+					//(eigen values are sorted in decreasing order)
+					CCVector3 N = CCVector3::fromArray(eigVectors[2].u);
 					N.normalize();
 
 					bestNormal = N;
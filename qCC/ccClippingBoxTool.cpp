@@ -25,13 +25,23 @@
 #include "ccGLWindow.h"
 #include "mainwindow.h"
 
+//CCLib
+#include <PointsSpan.h>
+#include <ReferenceCloud.h>
+
 //qCC_db
 #include <ccClipBox.h>
 #include <ccPointCloud.h>
+#include <ccPolyline.h>
 #include <ccProgressDialog.h>
 
 //Qt
 #include <QMessageBox>
+#include <QThread>
+#include <QtConcurrentMap>
+
+//System
+#include <limits>
 
 //Last contour unique ID
 static std::vector<unsigned> s_lastContourUniqueIDs;
@@ -513,6 +523,254 @@ static unsigned ComputeGridDimensions(	const ccBBox& localBox,
 	return cellCount;
 }
 
+//! Range of indexes processed by a single task
+struct SliceTask
+{
+	//! First index
+	unsigned first;
+	//! Last index (excluded)
+	unsigned last;
+	//! Task index
+	unsigned index;
+};
+
+//! Splits [0 ; count[ in tasks (at least 'minTaskSize' wide, except the last one)
+static std::vector<SliceTask> SplitInTasks(unsigned count, unsigned minTaskSize, unsigned maxTaskCount)
+{
+	//a few tasks per thread for a better load balancing
+	unsigned taskCount = static_cast<unsigned>(std::max(1, 4 * QThread::idealThreadCount()));
+	taskCount = std::max(1u, std::min(std::min(taskCount, maxTaskCount), count / std::max(1u, minTaskSize)));
+
+	std::vector<SliceTask> tasks(taskCount);
+	for (unsigned i = 0; i < taskCount; ++i)
+	{
+		tasks[i].first = static_cast<unsigned>((static_cast<unsigned long long>(count) * i) / taskCount);
+		tasks[i].last = static_cast<unsigned>((static_cast<unsigned long long>(count) * (i + 1)) / taskCount);
+		tasks[i].index = i;
+	}
+	return tasks;
+}
+
+//! Applies a function to each task (in parallel if there are several tasks)
+template <class Func> static void ForEachTask(std::vector<SliceTask>& tasks, Func func)
+{
+	if (tasks.size() > 1)
+	{
+		QtConcurrent::blockingMap(tasks, func);
+		return;
+	}
+	for (SliceTask& task : tasks)
+	{
+		func(task);
+	}
+}
+
+//! Returns the coordinates of a point (thread-safe)
+static inline CCVector3 GetPoint(const ccGenericPointCloud* cloud, const CCLib::PointsSpan& span, unsigned index)
+{
+	if (span.points)
+	{
+		return span[index];
+	}
+	CCVector3 P;
+	cloud->getPoint(index, P);
+	return P;
+}
+
+//! Computes the bounding-box of a set of clouds in a local coordinate system (in parallel)
+static ccBBox ComputeLocalBox(const std::vector<ccGenericPointCloud*>& clouds, const ccGLMatrix& localTrans)
+{
+	ccBBox localBox;
+	for (ccGenericPointCloud* cloud : clouds)
+	{
+		CCLib::PointsSpan span;
+		cloud->getPointsSpan(span);
+
+		std::vector<SliceTask> tasks = SplitInTasks(cloud->size(), 1 << 16, std::numeric_limits<unsigned>::max());
+		std::vector<ccBBox> taskBoxes(tasks.size());
+		ForEachTask(tasks, [&](const SliceTask& task)
+		{
+			ccBBox& box = taskBoxes[task.index];
+			for (unsigned i = task.first; i < task.last; ++i)
+			{
+				CCVector3 P = GetPoint(cloud, span, i);
+				localTrans.apply(P);
+				box.add(P);
+			}
+		});
+
+		for (const ccBBox& box : taskBoxes)
+		{
+			localBox += box;
+		}
+	}
+	return localBox;
+}
+
+//! Repeated slices (in the local clipping box coordinate system)
+struct SlicingGrid
+{
+	//! Transformation to the local clipping box coordinate system
+	ccGLMatrix localTrans;
+	//! Grid origin
+	CCVector3 origin;
+	//! Slice size
+	CCVector3 cellSize;
+	//! Slice size plus the gap between slices
+	CCVector3 cellSizePlusGap;
+	//! Gap between slices
+	PointCoordinateType gap;
+	//! Min slice index (along each dimension)
+	int indexMins[3];
+	//! Max slice index (along each dimension)
+	int indexMaxs[3];
+	//! Grid dimensions
+	int gridDim[3];
+	//! Number of slices (i.e. number of grid cells)
+	unsigned cellCount;
+
+	//! Returns the index of the slice that includes a point (or 'cellCount' if the point falls in a gap)
+	unsigned sliceIndex(CCVector3 P) const
+	{
+		localTrans.apply(P);
+
+		//relative coordinates (between 0 and 1)
+		P -= origin;
+		P.x /= cellSizePlusGap.x;
+		P.y /= cellSizePlusGap.y;
+		P.z /= cellSizePlusGap.z;
+
+		int xi = static_cast<int>(floor(P.x));
+		xi = std::min(std::max(xi, indexMins[0]), indexMaxs[0]);
+		int yi = static_cast<int>(floor(P.y));
+		yi = std::min(std::max(yi, indexMins[1]), indexMaxs[1]);
+		int zi = static_cast<int>(floor(P.z));
+		zi = std::min(std::max(zi, indexMins[2]), indexMaxs[2]);
+
+		if (gap == 0 ||
+			(	(P.x - static_cast<PointCoordinateType>(xi))*cellSizePlusGap.x <= cellSize.x
+			&&	(P.y - static_cast<PointCoordinateType>(yi))*cellSizePlusGap.y <= cellSize.y
+			&&	(P.z - static_cast<PointCoordinateType>(zi))*cellSizePlusGap.z <= cellSize.z))
+		{
+			int index = ((zi - indexMins[2]) * gridDim[1] + (yi - indexMins[1])) * gridDim[0] + (xi - indexMins[0]);
+			assert(index >= 0 && static_cast<unsigned>(index) < cellCount);
+			return static_cast<unsigned>(index);
+		}
+
+		return cellCount;
+	}
+};
+
+//! Points of a cloud sorted by slice
+struct CloudSlices
+{
+	//! Indexes of the points, sorted by slice
+	std::vector<unsigned> pointIndexes;
+	//! Position of the first point of each slice in 'pointIndexes' (cellCount + 1 values)
+	std::vector<unsigned> sliceStart;
+
+	//! Returns the number of points in a given slice
+	unsigned count(unsigned sliceIndex) const { return sliceStart[sliceIndex + 1] - sliceStart[sliceIndex]; }
+};
+
+//! Sorts the points of a cloud by slice (counting sort, in parallel)
+/** All the slices are stored as ranges of a single (permuted) indexes buffer.
+	The points keep their original order inside each slice.
+	\return success (or false if not enough memory)
+**/
+static bool SortPointsBySlice(const ccGenericPointCloud* cloud, const SlicingGrid& grid, CloudSlices& slices)
+{
+	const unsigned pointCount = cloud->size();
+	const unsigned cellCount = grid.cellCount;
+
+	//the per-task slice counts shouldn't use too much memory (the number of slices may be huge)
+	std::vector<SliceTask> tasks = SplitInTasks(pointCount, 1 << 16, std::max(1u, (1u << 24) / std::max(1u, cellCount)));
+
+	std::vector<unsigned> sliceIndexes;
+	std::vector<unsigned> sliceOffsets;
+	try
+	{
+		sliceIndexes.resize(pointCount);
+		sliceOffsets.resize(tasks.size() * cellCount, 0);
+		slices.sliceStart.resize(static_cast<size_t>(cellCount) + 1);
+	}
+	catch (const std::bad_alloc&)
+	{
+		//not enough memory
+		return false;
+	}
+
+	CCLib::PointsSpan span;
+	cloud->getPointsSpan(span);
+
+	//compute the slice index of each point and count the points per slice
+	ForEachTask(tasks, [&](const SliceTask& task)
+	{
+		unsigned* sliceCounts = sliceOffsets.data() + static_cast<size_t>(task.index) * cellCount;
+		for (unsigned i = task.first; i < task.last; ++i)
+		{
+			unsigned sliceIndex = grid.sliceIndex(GetPoint(cloud, span, i));
+			sliceIndexes[i] = sliceIndex;
+			if (sliceIndex != cellCount)
+			{
+				++sliceCounts[sliceIndex];
+			}
+		}
+	});
+
+	//convert the counts to offsets (slices first, then tasks, so that the sort is stable)
+	unsigned offset = 0;
+	for (unsigned s = 0; s < cellCount; ++s)
+	{
+		slices.sliceStart[s] = offset;
+		for (size_t t = 0; t < tasks.size(); ++t)
+		{
+			unsigned& sliceOffset = sliceOffsets[t * cellCount + s];
+			unsigned sliceCount = sliceOffset;
+			sliceOffset = offset;
+			offset += sliceCount;
+		}
+	}
+	slices.sliceStart[cellCount] = offset;
+
+	try
+	{
+		slices.pointIndexes.resize(offset);
+	}
+	catch (const std::bad_alloc&)
+	{
+		//not enough memory
+		return false;
+	}
+
+	//sort the points by slice
+	ForEachTask(tasks, [&](const SliceTask& task)
+	{
+		unsigned* sliceOffset = sliceOffsets.data() + static_cast<size_t>(task.index) * cellCount;
+		for (unsigned i = task.first; i < task.last; ++i)
+		{
+			unsigned sliceIndex = sliceIndexes[i];
+			if (sliceIndex != cellCount)
+			{
+				slices.pointIndexes[sliceOffset[sliceIndex]++] = i;
+			}
+		}
+	});
+
+	return true;
+}
+
+//! Contour extraction job (for a single slice)
+struct ContourJob
+{
+	//! Slice
+	ccPointCloud* sliceCloud;
+	//! Contour parts
+	std::vector<ccPolyline*> polys;
+	//! Whether the extraction succeeded
+	bool success;
+};
+
 bool ccClippingBoxTool::ExtractSlicesAndContours
 (
 	const std::vector<ccGenericPointCloud*>& clouds,
@@ -597,23 +855,23 @@ bool ccClippingBoxTool::ExtractSlicesAndContours
 			if (!clouds.empty()) //extract sections from clouds
 			{
 				//compute 'grid' extents in the local clipping box ref.
-				ccBBox localBox;
-				for (ccGenericPointCloud* cloud : clouds)
+				ccBBox localBox = ComputeLocalBox(clouds, localTrans);
+
+				SlicingGrid grid;
+				grid.localTrans = localTrans;
+				grid.origin = gridOrigin;
+				grid.cellSize = cellSize;
+				grid.cellSizePlusGap = cellSizePlusGap;
+				grid.gap = gap;
+				grid.cellCount = ComputeGridDimensions(localBox, repeatDimensions, grid.indexMins, grid.indexMaxs, grid.gridDim, gridOrigin, cellSizePlusGap);
+				if (grid.cellCount == 0)
 				{
-					for (unsigned i = 0; i < cloud->size(); ++i)
-					{
-						CCVector3 P = *cloud->getPoint(i);
-						localTrans.apply(P);
-						localBox.add(P);
-					}
+					//error message already issued
+					return false;
 				}
-
-				int indexMins[3], indexMaxs[3], gridDim[3];
-				unsigned cellCount = ComputeGridDimensions(localBox, repeatDimensions, indexMins, indexMaxs, gridDim, gridOrigin, cellSizePlusGap);
-
-				//we'll potentially create up to one (ref.) cloud per input loud and per cell
-				std::vector<CCLib::ReferenceCloud*> refClouds;
-				refClouds.resize(cellCount * clouds.size(), 0);
+				const int* indexMins = grid.indexMins;
+				const int* indexMaxs = grid.indexMaxs;
+				const int* gridDim = grid.gridDim;
 
 				if (progressDialog)
 				{
@@ -623,9 +881,11 @@ bool ccClippingBoxTool::ExtractSlicesAndContours
 					progressDialog->setAutoClose(false);
 				}
 
+				//the points of each cloud are sorted by slice (each slice is a range of indexes)
+				std::vector<CloudSlices> cloudSlices(clouds.size());
 				unsigned subCloudsCount = 0;
 
-				//project points into grid
+				CCLib::NormalizedProgress nProgress(progressDialog, static_cast<unsigned>(clouds.size()));
 				for (size_t ci = 0; ci != clouds.size(); ++ci)
 				{
 					ccGenericPointCloud* cloud = clouds[ci];
@@ -639,51 +899,23 @@ bool ccClippingBoxTool::ExtractSlicesAndContours
 					}
 					QApplication::processEvents();
 
-					CCLib::NormalizedProgress nProgress(progressDialog, pointCount);
-					for (unsigned i = 0; i < pointCount; ++i)
+					if (!SortPointsBySlice(cloud, grid, cloudSlices[ci]))
 					{
-						CCVector3 P = *cloud->getPoint(i);
-						localTrans.apply(P);
-
-						//relative coordinates (between 0 and 1)
-						P -= gridOrigin;
-						P.x /= cellSizePlusGap.x;
-						P.y /= cellSizePlusGap.y;
-						P.z /= cellSizePlusGap.z;
-
-						int xi = static_cast<int>(floor(P.x));
-						xi = std::min(std::max(xi, indexMins[0]), indexMaxs[0]);
-						int yi = static_cast<int>(floor(P.y));
-						yi = std::min(std::max(yi, indexMins[1]), indexMaxs[1]);
-						int zi = static_cast<int>(floor(P.z));
-						zi = std::min(std::max(zi, indexMins[2]), indexMaxs[2]);
-
-						if (gap == 0 ||
-							(	(P.x - static_cast<PointCoordinateType>(xi))*cellSizePlusGap.x <= cellSize.x
-							&&	(P.y - static_cast<PointCoordinateType>(yi))*cellSizePlusGap.y <= cellSize.y
-							&&	(P.z - static_cast<PointCoordinateType>(zi))*cellSizePlusGap.z <= cellSize.z))
-						{
-							int cloudIndex = ((zi - indexMins[2]) * static_cast<int>(gridDim[1]) + (yi - indexMins[1])) * static_cast<int>(gridDim[0]) + (xi - indexMins[0]);
-							assert(cloudIndex >= 0 && static_cast<size_t>(cloudIndex)* clouds.size() + ci < refClouds.size());
-
-							CCLib::ReferenceCloud*& destCloud = refClouds[cloudIndex * clouds.size() + ci];
-							if (!destCloud)
-							{
-								destCloud = new CCLib::ReferenceCloud(cloud);
-								++subCloudsCount;
-							}
+						ccLog::Error("Not enough memory!");
+						error = true;
+						break;
+					}
 
-							if (!destCloud->addPointIndex(i))
-							{
-								ccLog::Error("Not enough memory!");
-								error = true;
-								break;
-							}
+					for (unsigned s = 0; s < grid.cellCount; ++s)
+					{
+						if (cloudSlices[ci].count(s) != 0)
+						{
+							++subCloudsCount;
 						}
 					}
 
 					nProgress.oneStep();
-				} //project points into grid
+				}
 
 				if (progressDialog)
 				{
@@ -698,24 +930,41 @@ bool ccClippingBoxTool::ExtractSlicesAndContours
 				subCloudsCount = 0;
 
 				//now create the real clouds
-				for (int i = indexMins[0]; i <= indexMaxs[0]; ++i)
+				for (int i = indexMins[0]; i <= indexMaxs[0] && !error; ++i)
 				{
 					for (int j = indexMins[1]; j <= indexMaxs[1]; ++j)
 					{
 						for (int k = indexMins[2]; k <= indexMaxs[2]; ++k)
 						{
 							int cloudIndex = ((k - indexMins[2]) * static_cast<int>(gridDim[1]) + (j - indexMins[1])) * static_cast<int>(gridDim[0]) + (i - indexMins[0]);
-							assert(cloudIndex >= 0 && static_cast<size_t>(cloudIndex)* clouds.size() < refClouds.size());
+							assert(cloudIndex >= 0 && static_cast<unsigned>(cloudIndex) < grid.cellCount);
 
 							for (size_t ci = 0; ci != clouds.size(); ++ci)
 							{
 								ccGenericPointCloud* cloud = clouds[ci];
-								CCLib::ReferenceCloud* destCloud = refClouds[cloudIndex * clouds.size() + ci];
-								if (destCloud) //some slices can be empty!
+								const CloudSlices& slices = cloudSlices[ci];
+								unsigned slicePointCount = slices.count(static_cast<unsigned>(cloudIndex));
+								if (slicePointCount != 0) //some slices can be empty!
 								{
-									//generate slice from previous selection
+									//generate slice from the corresponding range of indexes
+									CCLib::ReferenceCloud destCloud(cloud);
+									if (!destCloud.reserve(slicePointCount))
+									{
+										ccLog::Error("Not enough memory!");
+										error = true;
+										i = indexMaxs[0];
+										j = indexMaxs[1];
+										k = indexMaxs[2];
+										break;
+									}
+									const unsigned* sliceIndexes = slices.pointIndexes.data() + slices.sliceStart[cloudIndex];
+									for (unsigned n = 0; n < slicePointCount; ++n)
+									{
+										destCloud.addPointIndex(sliceIndexes[n]);
+									}
+
 									int warnings = 0;
-									ccPointCloud* sliceCloud = cloud->isA(CC_TYPES::POINT_CLOUD) ? static_cast<ccPointCloud*>(cloud)->partialClone(destCloud, &warnings) : ccPointCloud::From(destCloud, cloud);
+									ccPointCloud* sliceCloud = cloud->isA(CC_TYPES::POINT_CLOUD) ? static_cast<ccPointCloud*>(cloud)->partialClone(&destCloud, &warnings) : ccPointCloud::From(&destCloud, cloud);
 									warningsIssued |= (warnings != 0);
 
 									if (sliceCloud)
@@ -770,14 +1019,6 @@ bool ccClippingBoxTool::ExtractSlicesAndContours
 					}
 				} //now create the real clouds
 
-				//release memory
-				{
-					for (size_t i = 0; i < refClouds.size(); ++i)
-						if (refClouds[i])
-							delete refClouds[i];
-					refClouds.clear();
-				}
-
 				cloudSliceCount = outputSlices.size();
 
 			} //extract sections from clouds
@@ -785,17 +1026,13 @@ bool ccClippingBoxTool::ExtractSlicesAndContours
 			if (!meshes.empty()) //extract sections from meshes
 			{
 				//compute 'grid' extents in the local clipping box ref.
-				ccBBox localBox;
+				std::vector<ccGenericPointCloud*> vertices;
+				vertices.reserve(meshes.size());
 				for (ccGenericMesh* mesh : meshes)
 				{
-					ccGenericPointCloud* cloud = mesh->getAssociatedCloud();
-					for (unsigned i = 0; i < cloud->size(); ++i)
-					{
-						CCVector3 P = *cloud->getPoint(i);
-						localTrans.apply(P);
-						localBox.add(P);
-					}
+					vertices.push_back(mesh->getAssociatedCloud());
 				}
+				ccBBox localBox = ComputeLocalBox(vertices, localTrans);
 
 				int indexMins[3], indexMaxs[3], gridDim[3];
 				unsigned cellCount = ComputeGridDimensions(localBox, repeatDimensions, indexMins, indexMaxs, gridDim, gridOrigin, cellSizePlusGap);
@@ -916,50 +1153,87 @@ bool ccClippingBoxTool::ExtractSlicesAndContours
 			assert(cloudSliceCount <= outputSlices.size());
 
 			//process all the slices originating from point clouds
+			//(the contours are extracted in parallel, by batches so that the progress can be displayed)
+			std::vector<ContourJob> jobs(cloudSliceCount);
 			for (size_t i = 0; i < cloudSliceCount; ++i)
 			{
-				ccPointCloud* sliceCloud = ccHObjectCaster::ToPointCloud(outputSlices[i]);
-				assert(sliceCloud);
-
-				std::vector<ccPolyline*> polys;
-				if (ccContourExtractor::ExtractFlatContour(sliceCloud,
-					multiPass,
-					maxEdgeLength,
-					polys,
-					splitContours,
-					preferredOrientation,
-					visualDebugMode))
+				jobs[i].sliceCloud = ccHObjectCaster::ToPointCloud(outputSlices[i]);
+				jobs[i].success = false;
+				assert(jobs[i].sliceCloud);
+			}
+
+			auto extractContour = [&](ContourJob& job)
+			{
+				try
+				{
+					job.success = ccContourExtractor::ExtractFlatContour(job.sliceCloud,
+						multiPass,
+						maxEdgeLength,
+						job.polys,
+						splitContours,
+						preferredOrientation,
+						visualDebugMode);
+				}
+				catch (const std::bad_alloc&)
 				{
-					if (!polys.empty())
+					//not enough memory
+					job.success = false;
+				}
+			};
+
+			//the visual debug mode requires a sequential process
+			const size_t batchSize = (visualDebugMode ? 1 : static_cast<size_t>(std::max(1, 4 * QThread::idealThreadCount())));
+
+			for (size_t first = 0; first < cloudSliceCount; first += batchSize)
+			{
+				const size_t last = std::min(first + batchSize, cloudSliceCount);
+				if (last - first > 1)
+				{
+					QtConcurrent::blockingMap(jobs.begin() + first, jobs.begin() + last, extractContour);
+				}
+				else
+				{
+					extractContour(jobs[first]);
+				}
+
+				for (size_t i = first; i < last; ++i)
+				{
+					ccPointCloud* sliceCloud = jobs[i].sliceCloud;
+					std::vector<ccPolyline*>& polys = jobs[i].polys;
+
+					if (jobs[i].success)
 					{
-						for (size_t p = 0; p < polys.size(); ++p)
+						if (!polys.empty())
 						{
-							ccPolyline* poly = polys[p];
-							poly->setColor(ccColor::green);
-							poly->showColors(true);
-							poly->setGlobalScale(sliceCloud->getGlobalScale());
-							poly->setGlobalShift(sliceCloud->getGlobalShift());
-							QString contourName = sliceCloud->getName();
-							contourName.replace("slice", "contour");
-							if (polys.size() > 1)
+							for (size_t p = 0; p < polys.size(); ++p)
 							{
-								contourName += QString(" (part %1)").arg(p + 1);
+								ccPolyline* poly = polys[p];
+								poly->setColor(ccColor::green);
+								poly->showColors(true);
+								poly->setGlobalScale(sliceCloud->getGlobalScale());
+								poly->setGlobalShift(sliceCloud->getGlobalShift());
+								QString contourName = sliceCloud->getName();
+								contourName.replace("slice", "contour");
+								if (polys.size() > 1)
+								{
+									contourName += QString(" (part %1)").arg(p + 1);
+								}
+								poly->setName(contourName);
+								outputContours.push_back(poly);
 							}
-							poly->setName(contourName);
-							outputContours.push_back(poly);
+						}
+						else
+						{
+							ccLog::Warning(QString("%1: points are too far from each other! Increase the max edge length").arg(sliceCloud->getName()));
+							warningsIssued = true;
 						}
 					}
 					else
 					{
-						ccLog::Warning(QString("%1: points are too far from each other! Increase the max edge length").arg(sliceCloud->getName()));
+						ccLog::Warning(QString("%1: contour extraction failed!").arg(sliceCloud->getName()));
 						warningsIssued = true;
 					}
 				}
-				else
-				{
-					ccLog::Warning(QString("%1: contour extraction failed!").arg(sliceCloud->getName()));
-					warningsIssued = true;
-				}
 
 				if (progressDialog && !visualDebugMode)
 				{
@@ -970,7 +1244,7 @@ bool ccClippingBoxTool::ExtractSlicesAndContours
 						//early stop
 						break;
 					}
-					progressDialog->setValue(static_cast<int>(i));
+					progressDialog->setValue(static_cast<int>(last));
 				}
 			}
 
@@ -24,6 +24,7 @@
 //qCC_io
 #include <AsciiFilter.h>
 #include <FBXFilter.h>
+#include <LASFilter.h>
 #include <PlyFilter.h>
 
 //qCC
@@ -60,6 +61,7 @@ static const char COMMAND_DENSITY_TYPE[]					= "TYPE";			//+ density type
 static const char COMMAND_APPROX_DENSITY[]					= "APPROX_DENSITY";
 static const char COMMAND_SF_GRADIENT[]						= "SF_GRAD";
 static const char COMMAND_ROUGHNESS[]						= "ROUGH";
+static const char COMMAND_GEOM_FEATURES[]					= "FEATURES";		//+ features list (comma separated or ALL) + radii list (comma separated)
 static const char COMMAND_APPLY_TRANSFORMATION[]			= "APPLY_TRANS";
 static const char COMMAND_DROP_GLOBAL_SHIFT[]				= "DROP_GLOBAL_SHIFT";
 static const char COMMAND_SF_COLOR_SCALE[]					= "SF_COLOR_SCALE";
@@ -109,8 +111,13 @@ static const char COMMAND_ICP_ENABLE_FARTHEST_REMOVAL[]		= "FARTHEST_REMOVAL";
 static const char COMMAND_ICP_USE_MODEL_SF_AS_WEIGHT[]		= "MODEL_SF_AS_WEIGHTS";
 static const char COMMAND_ICP_USE_DATA_SF_AS_WEIGHT[]		= "DATA_SF_AS_WEIGHTS";
 static const char COMMAND_ICP_ROT[]				= "ROT";
+static const char COMMAND_ICP_ERROR_METRIC[]				= "METRIC";
+static const char COMMAND_ICP_TIMINGS[]						= "TIMINGS";
 static const char COMMAND_FBX_EXPORT_FORMAT[]				= "FBX_EXPORT_FMT";
 static const char COMMAND_PLY_EXPORT_FORMAT[]				= "PLY_EXPORT_FMT";
+static const char COMMAND_TILE_LAS[]						= "TILE_LAS";
+static const char COMMAND_TILE_LAS_DIM[]					= "DIM";
+static const char COMMAND_TILE_LAS_OUTPUT_DIR[]				= "OUTPUT_DIR";
 static const char COMMAND_COMPUTE_GRIDDED_NORMALS[]			= "COMPUTE_NORMALS";
 static const char COMMAND_COMPUTE_OCTREE_NORMALS[]			= "OCTREE_NORMALS";
 static const char COMMAND_CLEAR_NORMALS[]					= "CLEAR_NORMALS";
@@ -1292,6 +1299,119 @@ struct CommandRoughness : public ccCommandLineInterface::Command
 	}
 };
 
+struct CommandGeomFeatures : public ccCommandLineInterface::Command
+{
+	CommandGeomFeatures() : ccCommandLineInterface::Command("Geometric features", COMMAND_GEOM_FEATURES) {}
+
+	//! Reads a feature name (see the command description)
+	static bool ReadFeature(const QString& name, ccLibAlgorithms::GeomCharacteristicSet& features)
+	{
+		typedef CCLib::GeometricalAnalysisTools GAT;
+
+		if (name == "ALL")
+		{
+			for (int f = CCLib::Neighbourhood::EigenValuesSum; f <= CCLib::Neighbourhood::Verticality; ++f)
+				features.push_back(ccLibAlgorithms::GeomCharacteristic(GAT::Feature, f));
+		}
+		else if (name == "SUM_OF_EIGENVALUES")
+			features.push_back(ccLibAlgorithms::GeomCharacteristic(GAT::Feature, CCLib::Neighbourhood::EigenValuesSum));
+		else if (name == "OMNIVARIANCE")
+			features.push_back(ccLibAlgorithms::GeomCharacteristic(GAT::Feature, CCLib::Neighbourhood::Omnivariance));
+		else if (name == "EIGENENTROPY")
+			features.push_back(ccLibAlgorithms::GeomCharacteristic(GAT::Feature, CCLib::Neighbourhood::EigenEntropy));
+		else if (name == "ANISOTROPY")
+			features.push_back(ccLibAlgorithms::GeomCharacteristic(GAT::Feature, CCLib::Neighbourhood::Anisotropy));
+		else if (name == "PLANARITY")
+			features.push_back(ccLibAlgorithms::GeomCharacteristic(GAT::Feature, CCLib::Neighbourhood::Planarity));
+		else if (name == "LINEARITY")
+			features.push_back(ccLibAlgorithms::GeomCharacteristic(GAT::Feature, CCLib::Neighbourhood::Linearity));
+		else if (name == "PCA1")
+			features.push_back(ccLibAlgorithms::GeomCharacteristic(GAT::Feature, CCLib::Neighbourhood::PCA1));
+		else if (name == "PCA2")
+			features.push_back(ccLibAlgorithms::GeomCharacteristic(GAT::Feature, CCLib::Neighbourhood::PCA2));
+		else if (name == "SURFACE_VARIATION")
+			features.push_back(ccLibAlgorithms::GeomCharacteristic(GAT::Feature, CCLib::Neighbourhood::SurfaceVariation));
+		else if (name == "SPHERICITY")
+			features.push_back(ccLibAlgorithms::GeomCharacteristic(GAT::Feature, CCLib::Neighbourhood::Sphericity));
+		else if (name == "VERTICALITY")
+			features.push_back(ccLibAlgorithms::GeomCharacteristic(GAT::Feature, CCLib::Neighbourhood::Verticality));
+		else if (name == "ROUGHNESS")
+			features.push_back(ccLibAlgorithms::GeomCharacteristic(GAT::Roughness));
+		else if (name == "MEAN_CURV")
+			features.push_back(ccLibAlgorithms::GeomCharacteristic(GAT::Curvature, CCLib::Neighbourhood::MEAN_CURV));
+		else if (name == "GAUSS_CURV")
+			features.push_back(ccLibAlgorithms::GeomCharacteristic(GAT::Curvature, CCLib::Neighbourhood::GAUSSIAN_CURV));
+		else if (name == "NORMAL_CHANGE_RATE")
+			features.push_back(ccLibAlgorithms::GeomCharacteristic(GAT::Curvature, CCLib::Neighbourhood::NORMAL_CHANGE_RATE));
+		else if (name == "DENSITY_KNN")
+			features.push_back(ccLibAlgorithms::GeomCharacteristic(GAT::LocalDensity, GAT::DENSITY_KNN));
+		else if (name == "DENSITY_SURF")
+			features.push_back(ccLibAlgorithms::GeomCharacteristic(GAT::LocalDensity, GAT::DENSITY_2D));
+		else if (name == "DENSITY_VOL")
+			features.push_back(ccLibAlgorithms::GeomCharacteristic(GAT::LocalDensity, GAT::DENSITY_3D));
+		else if (name == "MOMENT_ORDER1")
+			features.push_back(ccLibAlgorithms::GeomCharacteristic(GAT::MomentOrder1));
+		else
+			return false;
+
+		return true;
+	}
+
+	virtual bool process(ccCommandLineInterface& cmd) override
+	{
+		cmd.print("[GEOMETRIC FEATURES]");
+
+		if (cmd.arguments().empty())
+			return cmd.error(QObject::tr("Missing parameter: features list after \"-%1\"").arg(COMMAND_GEOM_FEATURES));
+
+		ccLibAlgorithms::GeomCharacteristicSet features;
+		QStringList featureNames = cmd.arguments().takeFirst().toUpper().split(',', QString::SkipEmptyParts);
+		for (const QString& name : featureNames)
+		{
+			if (!ReadFeature(name, features))
+				return cmd.error(QObject::tr("Invalid feature name after \"-%1\": '%2'").arg(COMMAND_GEOM_FEATURES, name));
+		}
+		if (features.empty())
+			return cmd.error(QObject::tr("No feature after \"-%1\"").arg(COMMAND_GEOM_FEATURES));
+		cmd.print(QObject::tr("\tFeatures: %1").arg(features.size()));
+
+		if (cmd.arguments().empty())
+			return cmd.error(QObject::tr("Missing parameter: radii list after features list"));
+
+		std::vector<PointCoordinateType> radii;
+		QString radiiStr = cmd.arguments().takeFirst();
+		for (const QString& radiusStr : radiiStr.split(',', QString::SkipEmptyParts))
+		{
+			bool paramOk = false;
+			PointCoordinateType radius = static_cast<PointCoordinateType>(radiusStr.toDouble(&paramOk));
+			if (!paramOk || radius <= 0)
+				return cmd.error(QObject::tr("Failed to read a numerical parameter: radius (after features list). Got '%1' instead.").arg(radiusStr));
+			radii.push_back(radius);
+		}
+		if (radii.empty())
+			return cmd.error(QObject::tr("Missing parameter: radii list after features list"));
+		cmd.print(QObject::tr("\tRadii: %1").arg(radiiStr));
+
+		if (cmd.clouds().empty())
+			return cmd.error(QObject::tr("No point cloud on which to compute geometric features! (be sure to open one with \"-%1 [cloud filename]\" before \"-%2\")").arg(COMMAND_OPEN, COMMAND_GEOM_FEATURES));
+
+		//Call MainWindow generic method
+		ccHObject::Container entities;
+		entities.resize(cmd.clouds().size());
+		for (size_t i = 0; i < cmd.clouds().size(); ++i)
+			entities[i] = cmd.clouds()[i].pc;
+
+		if (ccLibAlgorithms::ComputeGeomCharacteristics(features, radii, entities, cmd.widgetParent()))
+		{
+			//save output
+			if (cmd.autoSaveMode() && !cmd.saveClouds("GEOM_FEATURES"))
+				return false;
+		}
+
+		return true;
+	}
+};
+
 struct CommandApplyTransformation : public ccCommandLineInterface::Command
 {
 	CommandApplyTransformation() : ccCommandLineInterface::Command("Apply Transformation", COMMAND_APPLY_TRANSFORMATION) {}
@@ -3517,6 +3637,8 @@ struct CommandICP : public ccCommandLineInterface::Command
 		int dataSFAsWeights = -1;
 		int maxThreadCount = 0;
 		int transformationFilters = 0;
+		CCLib::ICPRegistrationTools::ERROR_METRIC errorMetric = CCLib::ICPRegistrationTools::POINT_TO_POINT;
+		bool showTimings = false;
 
 		while (!cmd.arguments().empty())
 		{
@@ -3671,6 +3793,29 @@ struct CommandICP : public ccCommandLineInterface::Command
 					return cmd.error(QObject::tr("Missing parameter: rotation filter after \"-%1\" (XYZ/X/Y/Z/NONE)").arg(COMMAND_ICP_ROT));
 				}
 			}
+			else if (ccCommandLineInterface::IsCommand(argument, COMMAND_ICP_ERROR_METRIC))
+			{
+				//local option confirmed, we can move on
+				cmd.arguments().pop_front();
+
+				if (cmd.arguments().empty())
+					return cmd.error(QObject::tr("Missing parameter: error metric after \"-%1\" (POINT_TO_POINT/POINT_TO_PLANE)").arg(COMMAND_ICP_ERROR_METRIC));
+
+				QString metric = cmd.arguments().takeFirst().toUpper();
+				if (metric == "POINT_TO_POINT")
+					errorMetric = CCLib::ICPRegistrationTools::POINT_TO_POINT;
+				else if (metric == "POINT_TO_PLANE")
+					errorMetric = CCLib::ICPRegistrationTools::POINT_TO_PLANE;
+				else
+					return cmd.error(QObject::tr("Invalid parameter: unknown error metric \"%1\"").arg(metric));
+			}
+			else if (ccCommandLineInterface::IsCommand(argument, COMMAND_ICP_TIMINGS))
+			{
+				//local option confirmed, we can move on
+				cmd.arguments().pop_front();
+
+				showTimings = true;
+			}
 			else
 			{
 				break; //as soon as we encounter an unrecognized argument, we break the local loop to go back to the main one!
@@ -3737,28 +3882,51 @@ struct CommandICP : public ccCommandLineInterface::Command
 			}
 		}
 
+		if (errorMetric == CCLib::ICPRegistrationTools::POINT_TO_PLANE)
+		{
+			cmd.print(QObject::tr("[ICP] Point-to-plane error metric"));
+		}
+
 		ccGLMatrix transMat;
 		double finalError = 0.0;
 		double finalScale = 1.0;
 		unsigned finalPointCount = 0;
-		if (ccRegistrationTools::ICP(	dataAndModel[0]->getEntity(),
-										dataAndModel[1]->getEntity(),
-										transMat,
-										finalScale,
-										finalError,
-										finalPointCount,
-										minErrorDiff,
-										iterationCount,
-										randomSamplingLimit,
-										enableFarthestPointRemoval,
-										iterationCount != 0 ? CCLib::ICPRegistrationTools::MAX_ITER_CONVERGENCE : CCLib::ICPRegistrationTools::MAX_ERROR_CONVERGENCE,
-										adjustScale,
-										overlap / 100.0,
-										dataSFAsWeights >= 0,
-										modelSFAsWeights >= 0,
-										CCLib::ICPRegistrationTools::SKIP_NONE,
-										maxThreadCount,
-										cmd.widgetParent()))
+		std::vector<CCLib::ICPRegistrationTools::IterationStats> iterationStats;
+		bool success = ccRegistrationTools::ICP(	dataAndModel[0]->getEntity(),
+											dataAndModel[1]->getEntity(),
+											transMat,
+											finalScale,
+											finalError,
+											finalPointCount,
+											minErrorDiff,
+											iterationCount,
+											randomSamplingLimit,
+											enableFarthestPointRemoval,
+											iterationCount != 0 ? CCLib::ICPRegistrationTools::MAX_ITER_CONVERGENCE : CCLib::ICPRegistrationTools::MAX_ERROR_CONVERGENCE,
+											adjustScale,
+											overlap / 100.0,
+											dataSFAsWeights >= 0,
+											modelSFAsWeights >= 0,
+											CCLib::ICPRegistrationTools::SKIP_NONE,
+											maxThreadCount,
+											cmd.widgetParent(),
+											errorMetric,
+											showTimings ? &iterationStats : nullptr);
+
+		if (showTimings)
+		{
+			for (const CCLib::ICPRegistrationTools::IterationStats& stats : iterationStats)
+			{
+				cmd.print(QObject::tr("[ICP] Iteration #%1: RMS = %2 (%3 points) - closest points: %4 ms - registration: %5 ms")
+							.arg(stats.iteration)
+							.arg(stats.rms)
+							.arg(stats.pointCount)
+							.arg(stats.closestPointsTime_ms, 0, 'f', 1)
+							.arg(stats.registrationTime_ms, 0, 'f', 1));
+			}
+		}
+
+		if (success)
 		{
 			ccHObject* data = dataAndModel[0]->getEntity();
 			data->applyGLTransformation_recursive(&transMat);
@@ -3844,6 +4012,108 @@ struct CommandChangePLYExportFormat : public ccCommandLineInterface::Command
 	}
 };
 
+struct CommandTileLAS : public ccCommandLineInterface::Command
+{
+	CommandTileLAS() : ccCommandLineInterface::Command("Tile LAS file", COMMAND_TILE_LAS) {}
+
+	virtual bool process(ccCommandLineInterface& cmd) override
+	{
+		cmd.print("[TILE LAS FILE]");
+		if (cmd.arguments().size() < 3)
+			return cmd.error(QObject::tr("Missing parameter(s): number of tiles along both dimensions and filename after \"-%1\"").arg(COMMAND_TILE_LAS));
+
+		bool ok = true;
+		unsigned width = cmd.arguments().takeFirst().toUInt(&ok);
+		if (!ok || width == 0)
+			return cmd.error(QObject::tr("Invalid parameter: number of tiles (width) after '%1'").arg(COMMAND_TILE_LAS));
+		unsigned height = cmd.arguments().takeFirst().toUInt(&ok);
+		if (!ok || height == 0)
+			return cmd.error(QObject::tr("Invalid parameter: number of tiles (height) after '%1'").arg(COMMAND_TILE_LAS));
+
+		//optional parameters
+		unsigned char vertDim = 2;
+		QString outputDir;
+		while (!cmd.arguments().empty())
+		{
+			QString argument = cmd.arguments().front();
+			if (ccCommandLineInterface::IsCommand(argument, COMMAND_TILE_LAS_DIM))
+			{
+				//local option confirmed, we can move on
+				cmd.arguments().pop_front();
+
+				if (cmd.arguments().empty())
+					return cmd.error(QObject::tr("Missing parameter: tiling dimensions (XY, XZ or YZ) after '%1'").arg(COMMAND_TILE_LAS_DIM));
+
+				QString dimStr = cmd.arguments().takeFirst().toUpper();
+				if (dimStr == "XY")
+					vertDim = 2;
+				else if (dimStr == "XZ")
+					vertDim = 1;
+				else if (dimStr == "YZ")
+					vertDim = 0;
+				else
+					return cmd.error(QObject::tr("Invalid tiling dimensions! ('%1')").arg(dimStr));
+			}
+			else if (ccCommandLineInterface::IsCommand(argument, COMMAND_TILE_LAS_OUTPUT_DIR))
+			{
+				//local option confirmed, we can move on
+				cmd.arguments().pop_front();
+
+				if (cmd.arguments().empty())
+					return cmd.error(QObject::tr("Missing parameter: output directory after '%1'").arg(COMMAND_TILE_LAS_OUTPUT_DIR));
+
+				outputDir = cmd.arguments().takeFirst();
+			}
+			else
+			{
+				break;
+			}
+		}
+
+		if (cmd.arguments().empty())
+			return cmd.error(QObject::tr("Missing parameter: filename after \"-%1\"").arg(COMMAND_TILE_LAS));
+		QString filename = cmd.arguments().takeFirst();
+
+#ifdef CC_LAS_SUPPORT
+		QFileInfo fileInfo(filename);
+		if (outputDir.isEmpty())
+			outputDir = fileInfo.absolutePath();
+
+		LASFilter::TilingParameters params;
+		params.width = width;
+		params.height = height;
+		params.vertDim = vertDim;
+		params.outputBaseName = outputDir + "/" + fileInfo.baseName();
+		cmd.print(QObject::tr("\tTiles: %1 x %2 - output: %3_*").arg(width).arg(height).arg(params.outputBaseName));
+
+		QScopedPointer<ccProgressDialog> progressDialog(nullptr);
+		if (!cmd.silentMode())
+		{
+			progressDialog.reset(new ccProgressDialog(true, cmd.widgetParent()));
+			progressDialog->setAutoClose(false);
+		}
+
+		CC_FILE_ERROR result = LASFilter::TileFile(filename, params, progressDialog.data());
+
+		if (progressDialog)
+		{
+			progressDialog->close();
+			QCoreApplication::processEvents();
+		}
+
+		if (result != CC_FERR_NO_ERROR)
+		{
+			FileIOFilter::DisplayErrorMessage(result, "tiling", filename);
+			return false;
+		}
+
+		return true;
+#else
+		return cmd.error(QObject::tr("LAS format is not supported by this version of CloudCompare"));
+#endif
+	}
+};
+
 struct CommandForceNormalsComputation : public ccCommandLineInterface::Command
 {
 	CommandForceNormalsComputation() : ccCommandLineInterface::Command("Compute structured cloud normals", COMMAND_COMPUTE_GRIDDED_NORMALS) {}
@@ -146,6 +146,7 @@ ccCommandLineParser::ccCommandLineParser()
 	registerCommand(Command::Shared(new CommandDensity));
 	registerCommand(Command::Shared(new CommandSFGradient));
 	registerCommand(Command::Shared(new CommandRoughness));
+	registerCommand(Command::Shared(new CommandGeomFeatures));
 	registerCommand(Command::Shared(new CommandApplyTransformation));
 	registerCommand(Command::Shared(new CommandDropGlobalShift));
 	registerCommand(Command::Shared(new CommandFilterBySFValue));
@@ -176,6 +177,7 @@ ccCommandLineParser::ccCommandLineParser()
 	registerCommand(Command::Shared(new CommandChangeMeshOutputFormat));
 	registerCommand(Command::Shared(new CommandChangeFBXOutputFormat));
 	registerCommand(Command::Shared(new CommandChangePLYExportFormat));
+	registerCommand(Command::Shared(new CommandTileLAS));
 	registerCommand(Command::Shared(new CommandForceNormalsComputation));
 	registerCommand(Command::Shared(new CommandSaveClouds));
 	registerCommand(Command::Shared(new CommandSaveMeshes));
@@ -35,6 +35,9 @@ static const char COMMAND_RASTER_SF_PROJ_TYPE[]				= "SF_PROJ";
 static const char COMMAND_RASTER_PROJ_MIN[]					= "MIN";
 static const char COMMAND_RASTER_PROJ_MAX[]					= "MAX";
 static const char COMMAND_RASTER_PROJ_AVG[]					= "AVG";
+static const char COMMAND_RASTER_PROJ_MED[]					= "MED";
+static const char COMMAND_RASTER_PROJ_PERC[]				= "PERC";
+static const char COMMAND_RASTER_PERCENTILE[]				= "PERCENTILE";
 static const char COMMAND_RASTER_RESAMPLE[]					= "RESAMPLE";
 
 //2.5D Volume calculation specific commands
@@ -56,6 +59,14 @@ ccRasterGrid::ProjectionType GetProjectionType(QString option, ccCommandLineInte
 	{
 		return ccRasterGrid::PROJ_AVERAGE_VALUE;
 	}
+	else if (option == COMMAND_RASTER_PROJ_MED)
+	{
+		return ccRasterGrid::PROJ_MEDIAN_VALUE;
+	}
+	else if (option == COMMAND_RASTER_PROJ_PERC)
+	{
+		return ccRasterGrid::PROJ_PERCENTILE_VALUE;
+	}
 	else
 	{
 		assert(false);
@@ -109,6 +120,7 @@ struct CommandRasterize : public ccCommandLineInterface::Command
 		int vertDir = 2;
 		ccRasterGrid::ProjectionType projectionType = ccRasterGrid::PROJ_AVERAGE_VALUE;
 		ccRasterGrid::ProjectionType sfProjectionType = ccRasterGrid::PROJ_AVERAGE_VALUE;
+		double percentile = 50.0;
 		ccRasterGrid::EmptyCellFillOption emptyCellFillStrategy = ccRasterGrid::LEAVE_EMPTY;
 
 		while (!cmd.arguments().empty())
@@ -213,6 +225,18 @@ struct CommandRasterize : public ccCommandLineInterface::Command
 
 				sfProjectionType = GetProjectionType(cmd.arguments().takeFirst().toUpper(), cmd);
 			}
+			else if (ccCommandLineInterface::IsCommand(argument, COMMAND_RASTER_PERCENTILE))
+			{
+				//local option confirmed, we can move on
+				cmd.arguments().pop_front();
+
+				bool ok;
+				percentile = cmd.arguments().takeFirst().toDouble(&ok);
+				if (!ok || percentile < 0 || percentile > 100)
+				{
+					return cmd.error(QString("Invalid percentile value! (after %1)").arg(COMMAND_RASTER_PERCENTILE));
+				}
+			}
 			else if (ccCommandLineInterface::IsCommand(argument, COMMAND_RASTER_RESAMPLE))
 			{
 				//local option confirmed, we can move on
@@ -303,7 +327,8 @@ struct CommandRasterize : public ccCommandLineInterface::Command
 					projectionType,
 					emptyCellFillStrategy == ccRasterGrid::INTERPOLATE,
 					sfProjectionType,
-					pDlg.data()))
+					pDlg.data(),
+					percentile))
 				{
 					grid.fillEmptyCells(emptyCellFillStrategy, customHeight);
 					cmd.print(QString("[Rasterize] Raster grid: size: %1 x %2 / heights: [%3 ; %4]").arg(grid.width).arg(grid.height).arg(grid.minHeight).arg(grid.maxHeight));
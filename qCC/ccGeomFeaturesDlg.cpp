@@ -20,6 +20,11 @@
 //Qt
 #include <QPushButton>
 #include <QDialogButtonBox>
+#include <QRegExp>
+#include <QStringList>
+
+//system
+#include <algorithm>
 
 ccGeomFeaturesDlg::ccGeomFeaturesDlg(QWidget* parent/*=nullptr*/)
 	: QDialog(parent, Qt::Tool)
@@ -101,6 +106,31 @@ double ccGeomFeaturesDlg::getRadius() const
 	return radiusDoubleSpinBox->value();
 }
 
+bool ccGeomFeaturesDlg::getRadii(std::vector<PointCoordinateType>& radii) const
+{
+	radii.clear();
+	radii.push_back(static_cast<PointCoordinateType>(getRadius()));
+
+	QStringList tokens = additionalRadiiLineEdit->text().split(QRegExp("[\\s;]+"), QString::SkipEmptyParts);
+	for (const QString& token : tokens)
+	{
+		bool ok = false;
+		double r = token.toDouble(&ok);
+		if (!ok || r <= 0)
+		{
+			return false;
+		}
+
+		PointCoordinateType radius = static_cast<PointCoordinateType>(r);
+		if (std::find(radii.begin(), radii.end(), radius) == radii.end())
+		{
+			radii.push_back(radius);
+		}
+	}
+
+	return true;
+}
+
 void ccGeomFeaturesDlg::setRadius(double r)
 {
 	radiusDoubleSpinBox->setValue(r);
@@ -42,6 +42,10 @@ public:
 	void setRadius(double r);
 	//! Returns	the kernel radius (for 'precise' mode only)
 	double getRadius() const;
+	//! Returns all the kernel radii (the main one first, then the additional ones)
+	/** \return false if the additional radii are invalid
+	**/
+	bool getRadii(std::vector<PointCoordinateType>& radii) const;
 
 	//! Reset the whole dialog
 	void reset();
@@ -629,6 +629,37 @@ void ccGraphicalSegmentationTool::segment(bool keepPointsInside)
 	const double half_w = camera.viewport[2] / 2.0;
 	const double half_h = camera.viewport[3] / 2.0;
 
+	//segmentation polyline bounding-box (in pixels, relatively to the viewport center)
+	CCVector2d polyMin(0, 0), polyMax(0, 0);
+	bool polyIsARectangle = false;
+	{
+		const unsigned vertCount = m_segmentationPoly->size();
+		for (unsigned i = 0; i < vertCount; ++i)
+		{
+			const CCVector3* P = m_segmentationPoly->getPoint(i);
+			if (i == 0)
+			{
+				polyMin = polyMax = CCVector2d(P->x, P->y);
+			}
+			else
+			{
+				polyMin.x = std::min<double>(polyMin.x, P->x);
+				polyMin.y = std::min<double>(polyMin.y, P->y);
+				polyMax.x = std::max<double>(polyMax.x, P->x);
+				polyMax.y = std::max<double>(polyMax.y, P->y);
+			}
+		}
+
+		//if the polyline is an (axis aligned) rectangle, the points falling inside its bounding-box are inside
+		polyIsARectangle = (vertCount == 4);
+		for (unsigned i = 0; i < vertCount && polyIsARectangle; ++i)
+		{
+			const CCVector3* P = m_segmentationPoly->getPoint(i);
+			polyIsARectangle =	(P->x == polyMin.x || P->x == polyMax.x)
+							&&	(P->y == polyMin.y || P->y == polyMax.y);
+		}
+	}
+
 	//for each selected entity
 	for (QSet<ccHObject*>::const_iterator p = m_toSegment.constBegin(); p != m_toSegment.constEnd(); ++p)
 	{
@@ -638,27 +669,93 @@ void ccGraphicalSegmentationTool::segment(bool keepPointsInside)
 		ccGenericPointCloud::VisibilityTableType& visibilityArray = cloud->getTheVisibilityArray();
 		assert(!visibilityArray.empty());
 
-		unsigned cloudSize = cloud->size();
+		PointIndexType cloudSize = cloud->size();
 
-		//we project each point and we check if it falls inside the segmentation polyline
-#if defined(_OPENMP)
-#pragma omp parallel for
-#endif
-		for (int i = 0; i < static_cast<int>(cloudSize); ++i)
+		//tests whether a point falls inside the segmentation polyline
+		auto segmentPoint = [&](PointIndexType index)
 		{
-			if (visibilityArray[i] == POINT_VISIBLE)
+			if (visibilityArray[index] == POINT_VISIBLE)
 			{
-				const CCVector3* P3D = cloud->getPoint(i);
+				const CCVector3* P3D = cloud->getPoint(index);
 
 				CCVector3d Q2D;
 				camera.project(*P3D, Q2D);
 
 				CCVector2 P2D(	static_cast<PointCoordinateType>(Q2D.x-half_w),
 								static_cast<PointCoordinateType>(Q2D.y-half_h) );
-				
+
 				bool pointInside = CCLib::ManualSegmentationTools::isPointInsidePoly(P2D, m_segmentationPoly);
 
-				visibilityArray[i] = (keepPointsInside != pointInside ? POINT_HIDDEN : POINT_VISIBLE);
+				visibilityArray[index] = (keepPointsInside != pointInside ? POINT_HIDDEN : POINT_VISIBLE);
+			}
+		};
+
+		//if the octree is available, we only project the points lying in the cells that may intersect the polyline
+		ccOctree::Shared octree = cloud->getOctree();
+		ccOctree::CellsRanges ranges;
+		if (	octree
+			&&	octree->getNumberOfProjectedPoints() == cloudSize
+			&&	octree->getCellsInScreenRegion(camera, CCVector2d(polyMin.x + half_w, polyMin.y + half_h), CCVector2d(polyMax.x + half_w, polyMax.y + half_h), ranges) )
+		{
+			const CCLib::DgmOctree::cellsContainer& pointsAndCodes = octree->pointsAndTheirCellCodes();
+			const int rangeCount = static_cast<int>(ranges.size());
+
+			//each range is processed along with the (skipped) points preceding it
+#if defined(_OPENMP)
+#pragma omp parallel for
+#endif
+			for (int r = 0; r <= rangeCount; ++r)
+			{
+				//the skipped points are outside of the polyline
+				if (keepPointsInside)
+				{
+					PointIndexType firstSkipped = (r != 0 ? ranges[r - 1].last : 0);
+					PointIndexType lastSkipped = (r != rangeCount ? ranges[r].first : cloudSize);
+					for (PointIndexType i = firstSkipped; i < lastSkipped; ++i)
+					{
+						unsigned char& visibility = visibilityArray[pointsAndCodes[i].theIndex];
+						if (visibility == POINT_VISIBLE)
+							visibility = POINT_HIDDEN;
+					}
+				}
+
+				if (r == rangeCount)
+				{
+					continue;
+				}
+
+				const ccOctree::CellsRange& range = ranges[r];
+				if (range.fullyInside && polyIsARectangle)
+				{
+					//no need to project the points
+					if (!keepPointsInside)
+					{
+						for (PointIndexType i = range.first; i < range.last; ++i)
+						{
+							unsigned char& visibility = visibilityArray[pointsAndCodes[i].theIndex];
+							if (visibility == POINT_VISIBLE)
+								visibility = POINT_HIDDEN;
+						}
+					}
+				}
+				else
+				{
+					for (PointIndexType i = range.first; i < range.last; ++i)
+					{
+						segmentPoint(pointsAndCodes[i].theIndex);
+					}
+				}
+			}
+		}
+		else
+		{
+			//we project each point and we check if it falls inside the segmentation polyline
+#if defined(_OPENMP)
+#pragma omp parallel for
+#endif
+			for (long long i = 0; i < static_cast<long long>(cloudSize); ++i)
+			{
+				segmentPoint(static_cast<PointIndexType>(i));
 			}
 		}
 	}
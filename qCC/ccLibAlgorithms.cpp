@@ -74,6 +74,132 @@ namespace ccLibAlgorithms
 		return sfName;
 	}
 	
+	//! Returns the name of the scalar field associated to a geometric characteristic (empty if invalid)
+	static QString GetGeomCharacteristicSFName(CCLib::GeometricalAnalysisTools::GeomCharacteristic c, int subOption, PointCoordinateType radius)
+	{
+		QString sfName;
+
+		switch (c)
+		{
+		case CCLib::GeometricalAnalysisTools::Feature:
+		{
+			switch (subOption)
+			{
+			case CCLib::Neighbourhood::EigenValuesSum:
+				sfName = "Eigenvalues sum";
+				break;
+			case CCLib::Neighbourhood::Omnivariance:
+				sfName = "Omnivariance";
+				break;
+			case CCLib::Neighbourhood::EigenEntropy:
+				sfName = "Eigenentropy";
+				break;
+			case CCLib::Neighbourhood::Anisotropy:
+				sfName = "Anisotropy";
+				break;
+			case CCLib::Neighbourhood::Planarity:
+				sfName = "Planarity";
+				break;
+			case CCLib::Neighbourhood::Linearity:
+				sfName = "Linearity";
+				break;
+			case CCLib::Neighbourhood::PCA1:
+				sfName = "PCA1";
+				break;
+			case CCLib::Neighbourhood::PCA2:
+				sfName = "PCA2";
+				break;
+			case CCLib::Neighbourhood::SurfaceVariation:
+				sfName = "Surface variation";
+				break;
+			case CCLib::Neighbourhood::Sphericity:
+				sfName = "Sphericity";
+				break;
+			case CCLib::Neighbourhood::Verticality:
+				sfName = "Verticality";
+				break;
+			default:
+				assert(false);
+				ccLog::Error("Internal error: invalid sub option for Feature computation");
+				return QString();
+			}
+
+			sfName += QString(" (%1)").arg(radius);
+		}
+		break;
+
+		case CCLib::GeometricalAnalysisTools::Curvature:
+		{
+			switch (subOption)
+			{
+			case CCLib::Neighbourhood::GAUSSIAN_CURV:
+				sfName = CC_CURVATURE_GAUSSIAN_FIELD_NAME;
+				break;
+			case CCLib::Neighbourhood::MEAN_CURV:
+				sfName = CC_CURVATURE_MEAN_FIELD_NAME;
+				break;
+			case CCLib::Neighbourhood::NORMAL_CHANGE_RATE:
+				sfName = CC_CURVATURE_NORM_CHANGE_RATE_FIELD_NAME;
+				break;
+			default:
+				assert(false);
+				ccLog::Error("Internal error: invalid sub option for Curvature computation");
+				return QString();
+			}
+			sfName += QString(" (%1)").arg(radius);
+		}
+		break;
+
+		case CCLib::GeometricalAnalysisTools::LocalDensity:
+			sfName = GetDensitySFName(static_cast<CCLib::GeometricalAnalysisTools::Density>(subOption), false, radius);
+			break;
+
+		case CCLib::GeometricalAnalysisTools::ApproxLocalDensity:
+			sfName = GetDensitySFName(static_cast<CCLib::GeometricalAnalysisTools::Density>(subOption), true);
+			break;
+
+		case CCLib::GeometricalAnalysisTools::Roughness:
+			sfName = CC_ROUGHNESS_FIELD_NAME + QString(" (%1)").arg(radius);
+			break;
+
+		case CCLib::GeometricalAnalysisTools::MomentOrder1:
+			sfName = CC_MOMENT_ORDER1_FIELD_NAME + QString(" (%1)").arg(radius);
+			break;
+
+		default:
+			assert(false);
+			return QString();
+		}
+
+		return sfName;
+	}
+
+	//! Returns the message corresponding to a GeometricalAnalysisTools error code
+	static QString GetErrorMessage(CCLib::GeometricalAnalysisTools::ErrorCode errorCode)
+	{
+		switch (errorCode)
+		{
+		case CCLib::GeometricalAnalysisTools::InvalidInput:
+			return "Internal error (invalid input)";
+		case CCLib::GeometricalAnalysisTools::NotEnoughPoints:
+			return "Not enough points";
+		case CCLib::GeometricalAnalysisTools::OctreeComputationFailed:
+			return "Failed to compute octree (not enough memory?)";
+		case CCLib::GeometricalAnalysisTools::ProcessFailed:
+			return "Process failed";
+		case CCLib::GeometricalAnalysisTools::UnhandledCharacteristic:
+			return "Internal error (unhandled characteristic)";
+		case CCLib::GeometricalAnalysisTools::NotEnoughMemory:
+			return "Not enough memory";
+		case CCLib::GeometricalAnalysisTools::ProcessCancelledByUser:
+			return "Process cancelled by user";
+		default:
+			assert(false);
+			break;
+		}
+		return "Unknown error";
+	}
+	
 	PointCoordinateType GetDefaultCloudKernelSize(ccGenericPointCloud* cloud, unsigned knn/*=12*/)
 	{
 		assert(cloud);
@@ -120,21 +246,29 @@ namespace ccLibAlgorithms
 									PointCoordinateType radius,
 									ccHObject::Container& entities,
 									QWidget* parent/*=nullptr*/)
+	{
+		return ComputeGeomCharacteristics(characteristics, std::vector<PointCoordinateType>{ radius }, entities, parent);
+	}
+
+	bool ComputeGeomCharacteristics(const GeomCharacteristicSet& characteristics,
+									const std::vector<PointCoordinateType>& radii,
+									ccHObject::Container& entities,
+									QWidget* parent/*=nullptr*/)
 	{
 		//no feature case
-		if (characteristics.empty())
+		if (characteristics.empty() || radii.empty())
 		{
 			//nothing to do
 			assert(false);
 			return true;
 		}
 		
-		//single features case
-		if (characteristics.size() == 1)
+		//single feature case
+		if (characteristics.size() == 1 && radii.size() == 1)
 		{
 			return ComputeGeomCharacteristic(	characteristics.front().charac,
 												characteristics.front().subOption,
-												radius,
+												radii.front(),
 												entities,
 												parent);
 		}
@@ -146,18 +280,139 @@ namespace ccLibAlgorithms
 			pDlg.reset(new ccProgressDialog(true, parent));
 			pDlg->setAutoClose(false);
 		}
-		
+
+		GeomCharacteristicSet radiusCharacteristics;
 		for (const GeomCharacteristic& g : characteristics)
 		{
-			if (!ComputeGeomCharacteristic(	g.charac,
-											g.subOption,
-											radius,
-											entities,
-											parent,
-											pDlg.data()))
+			if (g.charac == CCLib::GeometricalAnalysisTools::ApproxLocalDensity)
+			{
+				//the approximate density doesn't depend on the radius (and can't be computed with the others)
+				if (!ComputeGeomCharacteristic(g.charac, g.subOption, 0, entities, parent, pDlg.data()))
+				{
+					return false;
+				}
+			}
+			else
+			{
+				radiusCharacteristics.push_back(g);
+			}
+		}
+
+		if (radiusCharacteristics.empty())
+		{
+			return true;
+		}
+
+		for (ccHObject* entity : entities)
+		{
+			if (!entity->isKindOf(CC_TYPES::POINT_CLOUD))
 			{
+				continue;
+			}
+
+			if (!entity->isA(CC_TYPES::POINT_CLOUD))
+			{
+				//we can only create the output scalar fields on real point clouds: one pass per characteristic
+				ccHObject::Container singleEntity{ entity };
+				for (PointCoordinateType radius : radii)
+				{
+					for (const GeomCharacteristic& g : radiusCharacteristics)
+					{
+						if (!ComputeGeomCharacteristic(g.charac, g.subOption, radius, singleEntity, parent, pDlg.data()))
+						{
+							return false;
+						}
+					}
+				}
+				continue;
+			}
+
+			ccPointCloud* pc = static_cast<ccPointCloud*>(entity);
+
+			//create (or reuse) one scalar field per characteristic and per radius
+			std::vector<CCLib::GeometricalAnalysisTools::CharacteristicDesc> descs;
+			std::vector<int> newSFIndexes;
+			int lastSFIndex = -1;
+			bool success = true;
+			for (PointCoordinateType radius : radii)
+			{
+				for (const GeomCharacteristic& g : radiusCharacteristics)
+				{
+					QString sfName = GetGeomCharacteristicSFName(g.charac, g.subOption, radius);
+					if (sfName.isEmpty())
+					{
+						success = false;
+						break;
+					}
+
+					int sfIdx = pc->getScalarFieldIndexByName(qPrintable(sfName));
+					if (sfIdx < 0)
+					{
+						sfIdx = pc->addScalarField(qPrintable(sfName));
+						if (sfIdx < 0)
+						{
+							ccConsole::Error(QString("Failed to create scalar field on cloud '%1' (not enough memory?)").arg(pc->getName()));
+							success = false;
+							break;
+						}
+						newSFIndexes.push_back(sfIdx);
+					}
+
+					descs.emplace_back(g.charac, g.subOption, radius, pc->getScalarField(sfIdx));
+					lastSFIndex = sfIdx;
+				}
+				if (!success)
+				{
+					break;
+				}
+			}
+
+			if (success)
+			{
+				ccOctree::Shared octree = pc->getOctree();
+				if (!octree)
+				{
+					if (pDlg)
+					{
+						pDlg->show();
+					}
+					octree = pc->computeOctree(pDlg.data());
+					if (!octree)
+					{
+						ccConsole::Error(QString("Couldn't compute octree for cloud '%1'!").arg(pc->getName()));
+						success = false;
+					}
+				}
+
+				if (success)
+				{
+					CCLib::GeometricalAnalysisTools::ErrorCode result = CCLib::GeometricalAnalysisTools::ComputeCharacteristics(descs, pc, pDlg.data(), octree.data());
+					if (result != CCLib::GeometricalAnalysisTools::NoError)
+					{
+						ccConsole::Warning(QString("Failed to apply processing to cloud '%1'").arg(pc->getName()));
+						ccConsole::Warning(GetErrorMessage(result));
+						success = false;
+					}
+				}
+			}
+
+			if (!success)
+			{
+				//remove the scalar fields we have created (in reverse order, as the indexes would be shifted otherwise)
+				for (std::vector<int>::const_reverse_iterator it = newSFIndexes.rbegin(); it != newSFIndexes.rend(); ++it)
+				{
+					pc->deleteScalarField(*it);
+				}
 				return false;
 			}
+
+			for (const CCLib::GeometricalAnalysisTools::CharacteristicDesc& desc : descs)
+			{
+				desc.sf->computeMinAndMax();
+			}
+			pc->setCurrentDisplayedScalarField(lastSFIndex);
+			pc->showSF(lastSFIndex >= 0);
+			pc->prepareDisplayForRefresh();
 		}
 
 		return true;
@@ -176,97 +431,9 @@ namespace ccLibAlgorithms
 			return false;
 
 		//generate the right SF name
-		QString sfName;
-
-		switch (c)
-		{
-		case CCLib::GeometricalAnalysisTools::Feature:
-		{
-			switch (subOption)
-			{
-			case CCLib::Neighbourhood::EigenValuesSum:
-				sfName = "Eigenvalues sum";
-				break;
-			case CCLib::Neighbourhood::Omnivariance:
-				sfName = "Omnivariance";
-				break;
-			case CCLib::Neighbourhood::EigenEntropy:
-				sfName = "Eigenentropy";
-				break;
-			case CCLib::Neighbourhood::Anisotropy:
-				sfName = "Anisotropy";
-				break;
-			case CCLib::Neighbourhood::Planarity:
-				sfName = "Planarity";
-				break;
-			case CCLib::Neighbourhood::Linearity:
-				sfName = "Linearity";
-				break;
-			case CCLib::Neighbourhood::PCA1:
-				sfName = "PCA1";
-				break;
-			case CCLib::Neighbourhood::PCA2:
-				sfName = "PCA2";
-				break;
-			case CCLib::Neighbourhood::SurfaceVariation:
-				sfName = "Surface variation";
-				break;
-			case CCLib::Neighbourhood::Sphericity:
-				sfName = "Sphericity";
-				break;
-			case CCLib::Neighbourhood::Verticality:
-				sfName = "Verticality";
-				break;
-			default:
-				assert(false);
-				ccLog::Error("Internal error: invalid sub option for Feature computation");
-				return false;
-			}
-
-			sfName += QString(" (%1)").arg(radius);
-		}
-		break;
-
-		case CCLib::GeometricalAnalysisTools::Curvature:
+		QString sfName = GetGeomCharacteristicSFName(c, subOption, radius);
+		if (sfName.isEmpty())
 		{
-			switch (subOption)
-			{
-			case CCLib::Neighbourhood::GAUSSIAN_CURV:
-				sfName = CC_CURVATURE_GAUSSIAN_FIELD_NAME;
-				break;
-			case CCLib::Neighbourhood::MEAN_CURV:
-				sfName = CC_CURVATURE_MEAN_FIELD_NAME;
-				break;
-			case CCLib::Neighbourhood::NORMAL_CHANGE_RATE:
-				sfName = CC_CURVATURE_NORM_CHANGE_RATE_FIELD_NAME;
-				break;
-			default:
-				assert(false);
-				ccLog::Error("Internal error: invalid sub option for Curvature computation");
-				return false;
-			}
-			sfName += QString(" (%1)").arg(radius);
-		}
-		break;
-
-		case CCLib::GeometricalAnalysisTools::LocalDensity:
-			sfName = GetDensitySFName(static_cast<CCLib::GeometricalAnalysisTools::Density>(subOption), false, radius);
-			break;
-
-		case CCLib::GeometricalAnalysisTools::ApproxLocalDensity:
-			sfName = GetDensitySFName(static_cast<CCLib::GeometricalAnalysisTools::Density>(subOption), true);
-			break;
-
-		case CCLib::GeometricalAnalysisTools::Roughness:
-			sfName = CC_ROUGHNESS_FIELD_NAME + QString(" (%1)").arg(radius);
-			break;
-
-		case CCLib::GeometricalAnalysisTools::MomentOrder1:
-			sfName = CC_MOMENT_ORDER1_FIELD_NAME + QString(" (%1)").arg(radius);
-			break;
-
-		default:
-			assert(false);
 			return false;
 		}
 
@@ -331,38 +498,8 @@ namespace ccLibAlgorithms
 				}
 				else
 				{
-					QString errorMessage;
-					switch (result)
-					{
-					case CCLib::GeometricalAnalysisTools::InvalidInput:
-						errorMessage = "Internal error (invalid input)";
-						break;
-					case CCLib::GeometricalAnalysisTools::NotEnoughPoints:
-						errorMessage = "Not enough points";
-						break;
-					case CCLib::GeometricalAnalysisTools::OctreeComputationFailed:
-						errorMessage = "Failed to compute octree (not enough memory?)";
-						break;
-					case CCLib::GeometricalAnalysisTools::ProcessFailed:
-						errorMessage = "Process failed";
-						break;
-					case CCLib::GeometricalAnalysisTools::UnhandledCharacteristic:
-						errorMessage = "Internal error (unhandled characteristic)";
-						break;
-					case CCLib::GeometricalAnalysisTools::NotEnoughMemory:
-						errorMessage = "Not enough memory";
-						break;
-					case CCLib::GeometricalAnalysisTools::ProcessCancelledByUser:
-						errorMessage = "Process cancelled by user";
-						break;
-					default:
-						assert(false);
-						errorMessage = "Unknown error";
-						break;
-					}
-					
 					ccConsole::Warning(QString("Failed to apply processing to cloud '%1'").arg(cloud->getName()));
-					ccConsole::Warning(errorMessage);
+					ccConsole::Warning(GetErrorMessage(result));
 					
 					if (pc && sfIdx >= 0)
 					{
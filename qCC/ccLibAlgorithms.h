@@ -56,6 +56,15 @@ namespace ccLibAlgorithms
 									PointCoordinateType radius,
 									ccHObject::Container& entities,
 									QWidget* parent = nullptr);
+
+	//! Computes geometrical characteristics at several radii on a set of entities
+	/** All the characteristics are computed at once (see GeometricalAnalysisTools::ComputeCharacteristics):
+		the neighbourhood of each point is only extracted once (with the largest radius).
+	**/
+	bool ComputeGeomCharacteristics(const GeomCharacteristicSet& characteristics,
+									const std::vector<PointCoordinateType>& radii,
+									ccHObject::Container& entities,
+									QWidget* parent = nullptr);
 	
 	//! Computes a geometrical characteristic (see GeometricalAnalysisTools::GeomCharacteristic) on a set of entities
 	bool ComputeGeomCharacteristic(	CCLib::GeometricalAnalysisTools::GeomCharacteristic algo,
@@ -80,6 +80,7 @@ ccRasterizeTool::ccRasterizeTool(ccGenericPointCloud* cloud, QWidget* parent/*=0
 	connect(dimensionComboBox,			SIGNAL(currentIndexChanged(int)),	this,	SLOT(projectionDirChanged(int)));
 	connect(heightProjectionComboBox,	SIGNAL(currentIndexChanged(int)),	this,	SLOT(projectionTypeChanged(int)));
 	connect(scalarFieldProjection,		SIGNAL(currentIndexChanged(int)),	this,	SLOT(sfProjectionTypeChanged(int)));
+	connect(percentileDoubleSpinBox,	SIGNAL(valueChanged(double)),		this,	SLOT(percentileChanged(double)));
 	connect(fillEmptyCellsComboBox,		SIGNAL(currentIndexChanged(int)),	this,	SLOT(fillEmptyCellStrategyChanged(int)));
 	connect(updateGridPushButton,		SIGNAL(clicked()),					this,	SLOT(updateGridAndDisplay()));
 	connect(generateCloudPushButton,	SIGNAL(clicked()),					this,	SLOT(generateCloud()));
@@ -221,7 +222,8 @@ unsigned char ccRasterizeTool::getProjectionDimension() const
 
 void ccRasterizeTool::resampleOptionToggled(bool state)
 {
-	warningResampleWithAverageLabel->setVisible(resampleCloudCheckBox->isChecked() && getTypeOfProjection() == ccRasterGrid::PROJ_AVERAGE_VALUE);
+	ccRasterGrid::ProjectionType projectionType = getTypeOfProjection();
+	warningResampleWithAverageLabel->setVisible(resampleCloudCheckBox->isChecked() && (projectionType == ccRasterGrid::PROJ_AVERAGE_VALUE || projectionType == ccRasterGrid::PROJ_MEDIAN_VALUE || projectionType == ccRasterGrid::PROJ_PERCENTILE_VALUE));
 	gridOptionChanged();
 }
 
@@ -230,15 +232,33 @@ void ccRasterizeTool::projectionTypeChanged(int index)
 	//we can't use the 'resample origin cloud' option with 'average height' projection
 	//resampleCloudCheckBox->setEnabled(index != PROJ_AVERAGE_VALUE);
 	//DGM: now we can! We simply display a warning message
-	warningResampleWithAverageLabel->setVisible(resampleCloudCheckBox->isChecked() && index == ccRasterGrid::PROJ_AVERAGE_VALUE);
+	warningResampleWithAverageLabel->setVisible(resampleCloudCheckBox->isChecked() && (index == ccRasterGrid::PROJ_AVERAGE_VALUE || index == ccRasterGrid::PROJ_MEDIAN_VALUE || index == ccRasterGrid::PROJ_PERCENTILE_VALUE));
+	updatePercentileState();
 	gridIsUpToDate(false);
 }
 
 void ccRasterizeTool::sfProjectionTypeChanged(int index)
+{
+	updatePercentileState();
+	gridIsUpToDate(false);
+}
+
+void ccRasterizeTool::percentileChanged(double)
 {
 	gridIsUpToDate(false);
 }
 
+void ccRasterizeTool::updatePercentileState()
+{
+	percentileDoubleSpinBox->setEnabled(	getTypeOfProjection() == ccRasterGrid::PROJ_PERCENTILE_VALUE
+										||	scalarFieldProjection->currentIndex() == 4 );
+}
+
+double ccRasterizeTool::getPercentile() const
+{
+	return percentileDoubleSpinBox->value();
+}
+
 void ccRasterizeTool::projectionDirChanged(int dir)
 {
 	updateGridInfo();
@@ -344,6 +364,10 @@ ccRasterGrid::ProjectionType ccRasterizeTool::getTypeOfProjection() const
 		return ccRasterGrid::PROJ_AVERAGE_VALUE;
 	case 2:
 		return ccRasterGrid::PROJ_MAXIMUM_VALUE;
+	case 3:
+		return ccRasterGrid::PROJ_MEDIAN_VALUE;
+	case 4:
+		return ccRasterGrid::PROJ_PERCENTILE_VALUE;
 	default:
 		//shouldn't be possible for this option!
 		assert(false);
@@ -365,6 +389,10 @@ ccRasterGrid::ProjectionType ccRasterizeTool::getTypeOfSFInterpolation() const
 		return ccRasterGrid::PROJ_AVERAGE_VALUE;
 	case 2:
 		return ccRasterGrid::PROJ_MAXIMUM_VALUE;
+	case 3:
+		return ccRasterGrid::PROJ_MEDIAN_VALUE;
+	case 4:
+		return ccRasterGrid::PROJ_PERCENTILE_VALUE;
 	default:
 		//shouldn't be possible for this option!
 		assert(false);
@@ -381,6 +409,7 @@ void ccRasterizeTool::loadSettings()
 	int projDim					= settings.value("ProjectionDim",         dimensionComboBox->currentIndex()).toInt();
 	bool sfProj					= settings.value("SfProjEnabled",         interpolateSFCheckBox->isChecked()).toBool();
 	int sfProjStrategy			= settings.value("SfProjStrategy",        scalarFieldProjection->currentIndex()).toInt();
+	double percentile			= settings.value("Percentile",            percentileDoubleSpinBox->value()).toDouble();
 	int fillStrategy			= settings.value("FillStrategy",          fillEmptyCellsComboBox->currentIndex()).toInt();
 	double step					= settings.value("GridStep",              gridStepDoubleSpinBox->value()).toDouble();
 	double emptyHeight			= settings.value("EmptyCellsHeight",      emptyValueDoubleSpinBox->value()).toDouble();
@@ -405,6 +434,7 @@ void ccRasterizeTool::loadSettings()
 	dimensionComboBox->setCurrentIndex(projDim);
 	interpolateSFCheckBox->setChecked(sfProj);
 	scalarFieldProjection->setCurrentIndex(sfProjStrategy);
+	percentileDoubleSpinBox->setValue(percentile);
 	generateCountSFcheckBox->setChecked(genCountSF);
 	resampleCloudCheckBox->setChecked(resampleCloud);
 	minVertexCountSpinBox->setValue(minVertexCount);
@@ -458,6 +488,7 @@ void ccRasterizeTool::saveSettings()
 	settings.setValue("ProjectionDim", dimensionComboBox->currentIndex());
 	settings.setValue("SfProjEnabled", interpolateSFCheckBox->isChecked());
 	settings.setValue("SfProjStrategy", scalarFieldProjection->currentIndex());
+	settings.setValue("Percentile", percentileDoubleSpinBox->value());
 	settings.setValue("FillStrategy", fillEmptyCellsComboBox->currentIndex());
 	settings.setValue("GridStep", gridStepDoubleSpinBox->value());
 	settings.setValue("EmptyCellsHeight", emptyValueDoubleSpinBox->value());
@@ -516,7 +547,7 @@ ccPointCloud* ccRasterizeTool::convertGridToCloud(	const std::vector<ccRasterGri
 																		interpolateSF,
 																		interpolateColors,
 																		/*resampleInputCloudXY=*/resampleOriginalCloud(),
-																		/*resampleInputCloudZ=*/getTypeOfProjection() != ccRasterGrid::PROJ_AVERAGE_VALUE,
+																		/*resampleInputCloudZ=*/getTypeOfProjection() != ccRasterGrid::PROJ_AVERAGE_VALUE && getTypeOfProjection() != ccRasterGrid::PROJ_MEDIAN_VALUE && getTypeOfProjection() != ccRasterGrid::PROJ_PERCENTILE_VALUE,
 																		/*inputCloud=*/m_cloud,
 																		/*fillEmptyCells=*/fillEmptyCellsStrategy != ccRasterGrid::LEAVE_EMPTY,
 																		emptyCellsHeight,
@@ -717,7 +748,8 @@ bool ccRasterizeTool::updateGrid(bool interpolateSF/*=false*/)
 							projectionType,
 							fillEmptyCells,
 							interpolateSFs,
-							&pDlg))
+							&pDlg,
+							getPercentile()))
 	{
 		return false;
 	}
@@ -111,6 +111,9 @@ protected slots:
 	//! Called when the SF projection type changes
 	void sfProjectionTypeChanged(int);
 
+	//! Called when the percentile changes
+	void percentileChanged(double);
+
 	//Inherited from cc2Point5DimEditor
 	virtual bool showGridBoxEditor() override;
 
@@ -156,6 +159,12 @@ protected: //standard methods
 	//! Returns type of SF interpolation
 	ccRasterGrid::ProjectionType getTypeOfSFInterpolation() const;
 
+	//! Returns the percentile (for the 'percentile' projections)
+	double getPercentile() const;
+
+	//! Enables the percentile field if at least one projection is a 'percentile' one
+	void updatePercentileState();
+
 	//Inherited from cc2Point5DimEditor
 	virtual void gridIsUpToDate(bool state) override;
 
@@ -60,7 +60,9 @@ bool ccRegistrationTools::ICP(	ccHObject* data,
 								bool useModelSFAsWeights/*=false*/,
 								int filters/*=CCLib::ICPRegistrationTools::SKIP_NONE*/,
 								int maxThreadCount/*=0*/,
-								QWidget* parent/*=0*/)
+								QWidget* parent/*=0*/,
+								CCLib::ICPRegistrationTools::ERROR_METRIC errorMetric/*=CCLib::ICPRegistrationTools::POINT_TO_POINT*/,
+								std::vector<CCLib::ICPRegistrationTools::IterationStats>* iterationStats/*=0*/)
 {
 	//progress bar
 	ccProgressDialog pDlg(false, parent);
@@ -80,6 +82,12 @@ bool ccRegistrationTools::ICP(	ccHObject* data,
 		modelCloud = ccHObjectCaster::ToGenericPointCloud(model);
 	}
 
+	if (errorMetric == CCLib::ICPRegistrationTools::POINT_TO_PLANE && (modelMesh || !modelCloud || !modelCloud->normalsAvailable()))
+	{
+		ccLog::Error("[ICP] The point-to-plane metric requires a model cloud with normals!");
+		return false;
+	}
+
 	//if the 'data' entity is a mesh, we need to sample points on it
 	CCLib::GenericIndexedCloudPersist* dataCloud = nullptr;
 	if (data->isKindOf(CC_TYPES::MESH))
@@ -275,6 +283,8 @@ bool ccRegistrationTools::ICP(	ccHObject* data,
 		params.dataWeights = dataWeights;
 		params.transformationFilters = filters;
 		params.maxThreadCount = maxThreadCount;
+		params.errorMetric = errorMetric;
+		params.iterationStats = iterationStats;
 	}
 
 	result = CCLib::ICPRegistrationTools::Register(	modelCloud,
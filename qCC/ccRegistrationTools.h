@@ -36,6 +36,7 @@ public:
 
 	//! Applies ICP registration on two entities
 	/** \warning Automatically samples points on meshes if necessary (see code for magic numbers ;)
+		\warning The point-to-plane error metric requires a model cloud with normals
 	**/
 	static bool ICP(ccHObject* data,
 					ccHObject* model,
@@ -54,7 +55,9 @@ public:
 					bool useModelSFAsWeights = false,
 					int transformationFilters = CCLib::ICPRegistrationTools::SKIP_NONE,
 					int maxThreadCount = 0,
-					QWidget* parent = nullptr);
+					QWidget* parent = nullptr,
+					CCLib::ICPRegistrationTools::ERROR_METRIC errorMetric = CCLib::ICPRegistrationTools::POINT_TO_POINT,
+					std::vector<CCLib::ICPRegistrationTools::IterationStats>* iterationStats = nullptr);
 
 };
 
@@ -518,6 +518,7 @@ void MainWindow::connectActions()
 	//"Edit > Octree" menu
 	connect(m_UI->actionComputeOctree,		&QAction::triggered, this, &MainWindow::doActionComputeOctree);
 	connect(m_UI->actionResampleWithOctree,	&QAction::triggered, this, &MainWindow::doActionResampleWithOctree);
+	connect(m_UI->actionSortPointsForLOD,	&QAction::triggered, this, &MainWindow::doActionSortPointsForLOD);
 
 	//"Edit > Grid" menu
 	connect(m_UI->actionDeleteScanGrid,		&QAction::triggered, this, &MainWindow::doActionDeleteScanGrids);
@@ -996,6 +997,66 @@ void MainWindow::doActionResampleWithOctree()
 	refreshAll();
 }
 
+void MainWindow::doActionSortPointsForLOD()
+{
+	ccProgressDialog pDlg(false, this);
+	pDlg.setAutoClose(false);
+
+	bool errors = false;
+
+	//the entities that may refer to the points of a cloud by their indexes (anywhere in the DB tree)
+	ccHObject::Container candidates;
+	if (m_ccRoot)
+	{
+		ccHObject* root = m_ccRoot->getRootEntity();
+		root->filterChildren(candidates, true, CC_TYPES::MESH);
+		root->filterChildren(candidates, true, CC_TYPES::POLY_LINE, true);
+		root->filterChildren(candidates, true, CC_TYPES::LABEL_2D, true);
+	}
+
+	for ( ccHObject *entity : getSelectedEntities() )
+	{
+		if (!entity->isKindOf(CC_TYPES::POINT_CLOUD))
+			continue;
+
+		ccPointCloud* cloud = static_cast<ccPointCloud*>(entity);
+
+		//the vertices of a mesh or a polyline, or the points of a label, can't be re-ordered
+		ccHObject* referencingEntity = nullptr;
+		for (ccHObject* other : candidates)
+		{
+			if (cloud->isReferencedBy(other))
+			{
+				referencingEntity = other;
+				break;
+			}
+		}
+		if (referencingEntity)
+		{
+			ccConsole::Warning(QString("[SortPointsForLOD] Cloud '%1' is referenced by entity '%2' (ignored)").arg(cloud->getName(), referencingEntity->getName()));
+			continue;
+		}
+
+		QElapsedTimer eTimer;
+		eTimer.start();
+		if (cloud->sortPointsForLOD(&pDlg))
+		{
+			ccConsole::Print(QString("[SortPointsForLOD] Cloud '%1' sorted in %2 s.").arg(cloud->getName()).arg(eTimer.elapsed() / 1.0e3, 0, 'f', 2));
+			cloud->prepareDisplayForRefresh();
+		}
+		else
+		{
+			errors = true;
+		}
+	}
+
+	if (errors)
+		ccLog::Error("[SortPointsForLOD] Errors occurred during the process! Some clouds may not be sorted");
+
+	refreshAll();
+	updateUI();
+}
+
 void MainWindow::doActionApplyTransformation()
 {
 	ccApplyTransformationDlg dlg(this);
@@ -7847,14 +7908,20 @@ void MainWindow::doComputeGeometricFeature()
 	if (!gfDlg.exec())
 		return;
 
-	radius = gfDlg.getRadius();
 	if (!gfDlg.getSelectedFeatures(s_selectedCharacteristics))
 	{
 		ccLog::Error("Not enough memory");
 		return;
 	}
 
-	ccLibAlgorithms::ComputeGeomCharacteristics(s_selectedCharacteristics, static_cast<PointCoordinateType>(radius), m_selectedEntities, this);
+	std::vector<PointCoordinateType> radii;
+	if (!gfDlg.getRadii(radii))
+	{
+		ccLog::Error("Invalid additional radii (positive values separated by spaces or semicolons expected)");
+		return;
+	}
+
+	ccLibAlgorithms::ComputeGeomCharacteristics(s_selectedCharacteristics, radii, m_selectedEntities, this);
 
 	refreshAll();
 	updateUI();
@@ -9967,6 +10034,7 @@ void MainWindow::enableUIItems(dbTreeSelectionInfo& selInfo)
 	m_UI->actionExportDepthBuffer->setEnabled(atLeastOneGBLSensor);
 	m_UI->actionComputePointsVisibility->setEnabled(atLeastOneGBLSensor);
 	m_UI->actionResampleWithOctree->setEnabled(atLeastOneCloud);
+	m_UI->actionSortPointsForLOD->setEnabled(atLeastOneCloud);
 	m_UI->actionApplyScale->setEnabled(atLeastOneCloud || atLeastOneMesh || atLeastOnePolyline);
 	m_UI->actionApplyTransformation->setEnabled(atLeastOneEntity);
 	m_UI->actionComputeOctree->setEnabled(atLeastOneCloud || atLeastOneMesh);
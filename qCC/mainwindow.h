@@ -323,6 +323,7 @@ private slots:
 	void doActionOrientNormalsFM();
 	void doActionOrientNormalsMST();
 	void doActionResampleWithOctree();
+	void doActionSortPointsForLOD();
 	void doActionComputeMeshAA();
 	void doActionComputeMeshLS();
 	void doActionMeshScanGrids();